@@ -0,0 +1,88 @@
+# Copyright 2021 AVSystem <avsystem@avsystem.com>
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+#.rst:
+# FindZstd
+# --------
+#
+# Find the Zstandard compression library.
+#
+# Imported Targets
+# ^^^^^^^^^^^^^^^^
+#
+# This module defines the following :prop_tgt:`IMPORTED` targets:
+#
+# ``zstd``
+#   The Zstandard ``zstd`` library, if found.
+#
+# Result Variables
+# ^^^^^^^^^^^^^^^^
+#
+# This module will set the following variables in your project:
+#
+# ``ZSTD_FOUND``
+#   System has the Zstandard library.
+# ``ZSTD_INCLUDE_DIR``
+#   The Zstandard include directory.
+# ``ZSTD_LIBRARIES``
+#   All Zstandard libraries.
+# ``ZSTD_VERSION``
+#   This is set to ``$major.$minor.$patch``.
+#
+# Hints
+# ^^^^^
+#
+# Set ``ZSTD_ROOT_DIR`` to the root directory of a Zstandard installation.
+
+if(ZSTD_ROOT_DIR)
+    set(_EXTRA_FIND_ARGS "NO_CMAKE_FIND_ROOT_PATH")
+endif()
+
+find_path(ZSTD_INCLUDE_DIR
+          NAMES zstd.h
+          PATH_SUFFIXES include
+          HINTS ${ZSTD_ROOT_DIR}
+          ${_EXTRA_FIND_ARGS})
+
+if(ZSTD_INCLUDE_DIR AND EXISTS "${ZSTD_INCLUDE_DIR}/zstd.h")
+    foreach(_PART MAJOR MINOR RELEASE)
+        file(STRINGS "${ZSTD_INCLUDE_DIR}/zstd.h" _VERSION_LINE
+             REGEX "^#define ZSTD_VERSION_${_PART}[ \\t]+[0-9]+")
+        string(REGEX REPLACE "^#define ZSTD_VERSION_${_PART}[ \\t]+([0-9]+).*" "\\1"
+               ZSTD_VERSION_${_PART} "${_VERSION_LINE}")
+    endforeach()
+    set(ZSTD_VERSION "${ZSTD_VERSION_MAJOR}.${ZSTD_VERSION_MINOR}.${ZSTD_VERSION_RELEASE}")
+endif()
+
+find_library(ZSTD_LIBRARIES
+             NAMES zstd
+             PATH_SUFFIXES lib
+             HINTS ${ZSTD_ROOT_DIR}
+             ${_EXTRA_FIND_ARGS})
+
+include(FindPackageHandleStandardArgs)
+find_package_handle_standard_args(Zstd
+                                  FOUND_VAR ZSTD_FOUND
+                                  REQUIRED_VARS
+                                        ZSTD_INCLUDE_DIR
+                                        ZSTD_LIBRARIES
+                                  VERSION_VAR ZSTD_VERSION)
+
+if(ZSTD_FOUND AND NOT TARGET zstd)
+    add_library(zstd UNKNOWN IMPORTED)
+    set_target_properties(zstd PROPERTIES
+                          INTERFACE_INCLUDE_DIRECTORIES "${ZSTD_INCLUDE_DIR}"
+                          IMPORTED_LINK_INTERFACE_LANGUAGES "C"
+                          IMPORTED_LOCATION "${ZSTD_LIBRARIES}")
+endif()
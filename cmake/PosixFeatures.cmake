@@ -23,6 +23,7 @@ check_include_files("net/if.h" AVS_COMMONS_HAVE_NET_IF_H)
 
 include(CheckFunctionExists)
 check_function_exists(getifaddrs AVS_COMMONS_NET_POSIX_AVS_SOCKET_HAVE_GETIFADDRS)
+check_function_exists(getpeereid AVS_COMMONS_NET_POSIX_AVS_SOCKET_HAVE_GETPEEREID)
 
 include(CheckSymbolExists)
 check_symbol_exists("gai_strerror" "netdb.h" AVS_COMMONS_NET_POSIX_AVS_SOCKET_HAVE_GAI_STRERROR)
@@ -30,6 +31,9 @@ check_symbol_exists("getnameinfo" "netdb.h" AVS_COMMONS_NET_POSIX_AVS_SOCKET_HAV
 check_symbol_exists("inet_ntop" "arpa/inet.h" AVS_COMMONS_NET_POSIX_AVS_SOCKET_HAVE_INET_NTOP)
 check_symbol_exists("poll" "poll.h" AVS_COMMONS_NET_POSIX_AVS_SOCKET_HAVE_POLL)
 check_symbol_exists("recvmsg" "sys/socket.h" AVS_COMMONS_NET_POSIX_AVS_SOCKET_HAVE_RECVMSG)
+# IORING_FEAT_FAST_POLL is checked for, as network operations require Linux 5.7+
+check_symbol_exists("IORING_FEAT_FAST_POLL" "linux/io_uring.h" AVS_COMMONS_NET_POSIX_AVS_SOCKET_HAVE_IO_URING)
+check_symbol_exists("timerfd_create" "sys/timerfd.h" AVS_COMMONS_SCHED_HAVE_TIMERFD)
 
 # When _POSIX_C_SOURCE is defined, but none of _BSD_SOURCE, _SVID_SOURCE and
 # _GNU_SOURCE, some toolchains (e.g. default GCC on Ubuntu 16.04 or CentOS 7)
@@ -79,6 +79,15 @@ typedef struct avs_net_addrinfo_struct avs_net_addrinfo_t;
  */
 #define AVS_NET_ADDRINFO_RESOLVE_F_NOADDRCONFIG (1 << 2)
 
+/**
+ * When calling @ref avs_net_addrinfo_resolve_ex with this bit set in the
+ * <c>flags</c> parameter, resolution fails unless <c>host</c> is a textual
+ * representation of an IP address, so that a DNS query is never performed.
+ *
+ * This is equivalent to <c>AI_NUMERICHOST</c> flag to <c>getaddrinfo()</c>.
+ */
+#define AVS_NET_ADDRINFO_RESOLVE_F_NUMERICHOST (1 << 3)
+
 /**
  * Resolves a text-represented host and port address to its binary
  * representation, possibly executing a DNS query as necessary.
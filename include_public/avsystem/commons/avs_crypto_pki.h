@@ -32,6 +32,10 @@
 #    include <avsystem/commons/avs_persistence.h>
 #endif // AVS_COMMONS_WITH_AVS_PERSISTENCE
 
+#ifdef AVS_COMMONS_WITH_AVS_STREAM
+#    include <avsystem/commons/avs_stream.h>
+#endif // AVS_COMMONS_WITH_AVS_STREAM
+
 #ifdef __cplusplus
 #    if __cplusplus >= 201103L
 #        include <vector> // used in AVS_CRYPTO_PKI_X509_NAME
@@ -1043,6 +1047,80 @@ avs_error_t avs_crypto_parse_pkcs7_certs_only(
         size_t buffer_size);
 #    endif // AVS_COMMONS_WITH_AVS_LIST
 
+#    ifdef AVS_COMMONS_WITH_AVS_STREAM
+/**
+ * Type of a function called by @ref avs_crypto_parse_pkcs7_certs_only_stream
+ * for each certificate or certificate revocation list found in the data.
+ *
+ * @param type     Either @ref AVS_CRYPTO_SECURITY_INFO_CERTIFICATE_CHAIN or
+ *                 @ref AVS_CRYPTO_SECURITY_INFO_CERT_REVOCATION_LIST.
+ *
+ * @param der      DER-encoded element. It points into the buffer passed to
+ *                 @ref avs_crypto_parse_pkcs7_certs_only_stream, and is only
+ *                 valid until the handler returns.
+ *
+ * @param der_size Size of the data pointed to by @p der.
+ *
+ * @param arg      Opaque argument passed to
+ *                 @ref avs_crypto_parse_pkcs7_certs_only_stream.
+ *
+ * @returns AVS_OK to continue parsing, or an error code that will abort parsing
+ *          and be returned from @ref avs_crypto_parse_pkcs7_certs_only_stream.
+ */
+typedef avs_error_t
+avs_crypto_pkcs7_item_handler_t(avs_crypto_security_info_tag_t type,
+                                const void *der,
+                                size_t der_size,
+                                void *arg);
+
+/**
+ * Parses a PKCS#7 "certs only" data encoded as BER or DER
+ * (application/pkcs7-mime;smime-type=certs-only), reading it incrementally from
+ * a stream.
+ *
+ * Unlike @ref avs_crypto_parse_pkcs7_certs_only, this function does not
+ * require the whole data to be held in memory, and does not allocate any
+ * memory. Each certificate and CRL is read into @p buffer and passed to
+ * @p handler as soon as it is complete, so the memory usage is bounded by
+ * @p buffer_size regardless of the number of elements in the bundle. The same
+ * subset of BER is accepted by both functions.
+ *
+ * The stream is expected to end right after the PKCS#7 data.
+ *
+ * NOTE: If an error occurs, @p handler may have already been called for some
+ * of the elements.
+ *
+ * @param stream      Stream to read the PKCS#7 data from.
+ *
+ * @param buffer      Buffer to use for holding a single element at a time.
+ *
+ * @param buffer_size Size of @p buffer. It needs to be large enough to hold
+ *                    the largest certificate or CRL in the data, and no
+ *                    smaller than 9 bytes or <c>2 + sizeof(size_t)</c>,
+ *                    whichever is larger.
+ *
+ * @param handler     Function to call for each certificate or CRL, in the
+ *                    order in which they appear in the data.
+ *
+ * @param handler_arg Opaque argument to pass to @p handler.
+ *
+ * @returns AVS_OK on success, or an error code on error, in particular:
+ *          - <c>avs_errno(AVS_EINVAL)</c> if any of the pointer arguments is
+ *            NULL or @p buffer_size is below the minimum,
+ *          - <c>avs_errno(AVS_EPROTO)</c> if the data is malformed or is not
+ *            PKCS#7 certs-only data,
+ *          - <c>avs_errno(AVS_EMSGSIZE)</c> if any of the elements does not
+ *            fit in @p buffer,
+ *          - an error returned by @p handler or by the stream operations.
+ */
+avs_error_t
+avs_crypto_parse_pkcs7_certs_only_stream(avs_stream_t *stream,
+                                         void *buffer,
+                                         size_t buffer_size,
+                                         avs_crypto_pkcs7_item_handler_t *handler,
+                                         void *handler_arg);
+#    endif // AVS_COMMONS_WITH_AVS_STREAM
+
 #endif // AVS_COMMONS_WITH_AVS_CRYPTO_ADVANCED_FEATURES
 
 #ifdef __cplusplus
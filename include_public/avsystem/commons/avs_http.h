@@ -294,6 +294,31 @@ void avs_http_tcp_configuration(
  */
 int avs_http_set_user_agent(avs_http_t *http, const char *user_agent);
 
+#ifdef AVS_COMMONS_NET_WITH_UNIX_SOCKETS
+/**
+ * Configures the HTTP client to connect to a Unix domain socket instead of the
+ * host and port specified in request URLs.
+ *
+ * The URL is still used for everything else, e.g. the request target, the
+ * <c>Host</c> header and the choice between HTTP and HTTPS. For HTTPS, the
+ * host from the URL is used for Server Name Indication and certificate
+ * verification, unless <c>server_name_indication</c> is explicitly set in the
+ * SSL configuration.
+ *
+ * @param http HTTP client to operate on.
+ *
+ * @param path Path of the Unix domain socket to connect to. A path starting
+ *             with <c>@</c> denotes an address in the Linux abstract namespace
+ *             (see <c>AVS_NET_AF_UNIX</c>). May be <c>NULL</c>, in which case
+ *             TCP/IP connections to hosts specified in URLs will be made, which
+ *             is the default. The string is copied, so there are no
+ *             requirements on the lifetime of the pointer passed.
+ *
+ * @return 0 for success, or a negative value in case of an out-of-memory error.
+ */
+int avs_http_set_unix_socket_path(avs_http_t *http, const char *path);
+#endif // AVS_COMMONS_NET_WITH_UNIX_SOCKETS
+
 /**
  * Creates a new HTTP stream, which may be used to perform a series of related
  * HTTP requests, nominally within a single connection to the same server.
@@ -352,7 +377,8 @@ int avs_http_set_user_agent(avs_http_t *http, const char *user_agent);
  * <c>body_send</c> field of the @ref avs_http_buffer_sizes_t (4 KiB by
  * default), are sent directly using the default transfer encoding and the
  * Content-Length header. Larger requests are automatically split and sent using
- * chunked encoding.
+ * chunked encoding, unless their length has been declared beforehand using
+ * @ref avs_http_set_content_length.
  *
  * If authentication credentials are specified, they are automatically sent
  * using the Basic scheme if HTTPS encryption is used. For plain unencrypted
@@ -440,6 +466,43 @@ int avs_http_add_header(avs_stream_t *stream,
                         const char *key,
                         const char *value);
 
+/**
+ * Declares the length of the content of the next request.
+ *
+ * By default, the request content is buffered, and if it does not fit in a
+ * single buffer of size configured by the <c>body_send</c> field of the
+ * @ref avs_http_buffer_sizes_t, it is sent using chunked encoding. If the
+ * content length is known in advance, declaring it with this function causes
+ * the headers to be sent with the <em>Content-Length</em> header instead, and
+ * the content to be passed straight to the underlying socket, without any
+ * per-chunk framing.
+ *
+ * If the content does not fit in a single buffer, the request headers will
+ * include "Expect: 100-continue", and the content will only be sent after the
+ * server responds with "100 Continue" (or after the socket receive timeout
+ * elapses without any response). This way, responses such as 401 Unauthorized
+ * or 3xx redirects are received before the content is transmitted, and the
+ * request is retried automatically. If the server responds with 417
+ * Expectation Failed, the request is retried without the Expect header.
+ *
+ * This function shall be called under the same conditions as
+ * @ref avs_http_add_header. The declared length is reset after each successful
+ * request, and needs to be declared again for subsequent requests. Writing
+ * more data than declared, or finishing the message after writing less data
+ * than declared, results in an error; the connection is then closed at the
+ * next @ref avs_stream_reset call.
+ *
+ * @param stream         Stream to operate on. Need to be a stream created by
+ *                       @ref avs_http_open_stream with the
+ *                       @ref AVS_HTTP_CONTENT_IDENTITY encoding, as the length
+ *                       of compressed content is not known in advance.
+ * @param content_length Exact number of bytes of the request content.
+ *
+ * @return 0 for success, or a negative value if the stream uses a compressing
+ *         content encoding or if some content has already been written.
+ */
+int avs_http_set_content_length(avs_stream_t *stream, size_t content_length);
+
 /**
  * Enables storage of received HTTP headers and sets the storage location to the
  * specified list variable.
@@ -0,0 +1,352 @@
+/*
+ * Copyright 2021 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AVS_COMMONS_HTTP_SERVER_H
+#define AVS_COMMONS_HTTP_SERVER_H
+
+#include <avsystem/commons/avs_http.h>
+#include <avsystem/commons/avs_net.h>
+#include <avsystem/commons/avs_sched.h>
+#include <avsystem/commons/avs_stream.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file avs_http_server.h
+ *
+ * Minimal embedded HTTP/1.1 server, meant for small local endpoints such as
+ * health checks, metrics scraping or provisioning.
+ *
+ * The server is single-threaded and driven by an @ref avs_sched_t scheduler.
+ * Each request is handled synchronously from within a scheduler job, so the
+ * handlers shall not block for long periods of time. Typical event loop looks
+ * like this:
+ *
+ * @code
+ * while (running) {
+ *     avs_http_server_wait(server, avs_sched_time_to_next(sched));
+ *     avs_sched_run(sched);
+ * }
+ * @endcode
+ *
+ * The sockets are served from a scheduler job. @ref avs_http_server_wait only
+ * schedules that job to run immediately when any socket becomes ready. In
+ * addition, the job polls the sockets periodically, as configured by
+ * @ref avs_http_server_config_t.poll_interval, so that the server also works
+ * if the application does not call @ref avs_http_server_wait. Applications
+ * that do may disable the periodic polling.
+ *
+ * Request lines and headers are received using non-blocking reads, so a client
+ * sending them slowly does not stall other connections. However, the following
+ * operations block, for at most
+ * @ref avs_http_server_config_t.recv_timeout per read:
+ *
+ * - reading the request body by the handler,
+ * - the TLS handshake, as non-blocking handshakes are not supported by
+ *   avs_net. It is only started once the client sends any data.
+ *
+ * Only available if <c>AVS_COMMONS_HTTP_WITH_SERVER</c> is enabled.
+ */
+
+typedef struct avs_http_server avs_http_server_t;
+
+/**
+ * Opaque type representing an HTTP request currently being handled. It is only
+ * valid within the @ref avs_http_server_handler_t call it has been passed to.
+ */
+typedef struct avs_http_server_request avs_http_server_request_t;
+
+/**
+ * Request handler.
+ *
+ * The handler is expected to call either @ref avs_http_server_respond, or
+ * @ref avs_http_server_respond_begin, followed by any number of
+ * @ref avs_http_server_respond_write calls and
+ * @ref avs_http_server_respond_finish.
+ *
+ * If the handler returns an error without sending a response, a
+ * <em>500 Internal Server Error</em> response is sent. If it returns an error
+ * after beginning a chunked response, the connection is closed.
+ *
+ * @param request Request to handle.
+ *
+ * @param arg     Opaque argument passed to @ref avs_http_server_add_route.
+ */
+typedef avs_error_t
+avs_http_server_handler_t(avs_http_server_request_t *request, void *arg);
+
+typedef struct {
+    /**
+     * Local address to bind to. If NULL, the server listens on all
+     * interfaces.
+     */
+    const char *address;
+
+    /**
+     * Local port to listen on. If NULL or "0", an ephemeral port is chosen;
+     * use @ref avs_http_server_get_local_port to retrieve it.
+     */
+    const char *port;
+
+    /**
+     * Configuration of the TCP sockets. May be NULL, in which case the default
+     * configuration is used. Ignored if @ref ssl is not NULL - the
+     * <c>backend_configuration</c> field of @ref ssl is used instead.
+     */
+    const avs_net_socket_configuration_t *tcp;
+
+#ifdef AVS_COMMONS_WITH_AVS_CRYPTO
+    /**
+     * If not NULL, each accepted connection is wrapped in a TLS socket created
+     * using @ref avs_net_ssl_socket_create with this configuration. The
+     * configuration, including any security information it refers to, needs
+     * to remain valid for the lifetime of the server.
+     */
+    const avs_net_ssl_configuration_t *ssl;
+#endif // AVS_COMMONS_WITH_AVS_CRYPTO
+
+    /**
+     * Buffer sizes. If NULL, @ref AVS_HTTP_DEFAULT_BUFFER_SIZES is used. The
+     * buffers used for each connection are:
+     *
+     * - <c>body_recv</c> bytes for the receive buffer,
+     * - <c>body_send</c> bytes for the send buffer,
+     * - <c>header_line</c> bytes for decoding chunked request bodies.
+     */
+    const avs_http_buffer_sizes_t *buffer_sizes;
+
+    /**
+     * Maximum size of the request line and all request headers, including
+     * their terminating null bytes. Also bounds the headers added using
+     * @ref avs_http_server_add_header. Requests exceeding this limit are
+     * answered with <em>431 Request Header Fields Too Large</em>. Default:
+     * 2048.
+     */
+    size_t max_header_size;
+
+    /**
+     * Maximum number of simultaneous connections. Further connections are not
+     * accepted until some of the current ones are closed. Default: 8.
+     */
+    size_t max_connections;
+
+    /**
+     * Time within which the complete request line and headers need to be
+     * received, counted from accepting the connection or sending the previous
+     * response. Connections on which this does not happen, including idle
+     * keep-alive connections, are closed. Default: 5 s.
+     */
+    avs_time_duration_t idle_timeout;
+
+    /**
+     * Timeout for receiving a single chunk of data while reading the request
+     * body or performing the TLS handshake. Default: 5 s.
+     */
+    avs_time_duration_t recv_timeout;
+
+    /**
+     * Interval at which the sockets are polled if no activity has been
+     * detected. Each poll is a <c>poll()</c> system call on all the sockets.
+     * Default: 100 ms. If set to @ref AVS_TIME_DURATION_INVALID, the sockets
+     * are only polled by @ref avs_http_server_wait, which then needs to be
+     * called by the application.
+     */
+    avs_time_duration_t poll_interval;
+} avs_http_server_config_t;
+
+/**
+ * Creates a new HTTP server and starts listening for connections.
+ *
+ * @param sched  Scheduler that will drive the server. It needs to outlive the
+ *               server object.
+ *
+ * @param config Server configuration. Zero-valued fields are replaced with
+ *               their defaults. The structure itself is not referenced after
+ *               this function returns.
+ *
+ * @returns Newly created server, or NULL in case of error.
+ */
+avs_http_server_t *avs_http_server_new(avs_sched_t *sched,
+                                       const avs_http_server_config_t *config);
+
+/**
+ * Closes all connections and the listening socket, and frees the server.
+ *
+ * MUST NOT be called from within a request handler.
+ *
+ * @param server_ptr Pointer to a variable holding the server. It will be set
+ *                   to NULL.
+ */
+void avs_http_server_cleanup(avs_http_server_t **server_ptr);
+
+/**
+ * Retrieves the local port the server is listening on.
+ */
+avs_error_t avs_http_server_get_local_port(avs_http_server_t *server,
+                                           char *out_buffer,
+                                           size_t out_buffer_size);
+
+/**
+ * Registers a request handler.
+ *
+ * A route matches a request if its @p path is equal to the request path (with
+ * the query string removed), or if @p path ends with a slash and is a prefix
+ * of the request path. If multiple routes match, the one with the longest
+ * @p path is used.
+ *
+ * If some routes match the path, but none of them matches the method, the
+ * request is answered with <em>405 Method Not Allowed</em>. If no routes match
+ * the path, <em>404 Not Found</em> is sent.
+ *
+ * @param server  Server to register the route in.
+ *
+ * @param method  Request method to match, e.g. "GET". NULL matches any method.
+ *                <c>HEAD</c> requests are also matched by routes registered
+ *                for <c>GET</c>.
+ *
+ * @param path    Path to match, as described above.
+ *
+ * @param handler Handler to call.
+ *
+ * @param arg     Opaque argument to pass to @p handler.
+ *
+ * @returns 0 for success, or a negative value in case of error.
+ */
+int avs_http_server_add_route(avs_http_server_t *server,
+                              const char *method,
+                              const char *path,
+                              avs_http_server_handler_t *handler,
+                              void *arg);
+
+/**
+ * Waits until any of the server's sockets become ready, or until @p timeout
+ * expires, and schedules processing of the pending events in the scheduler, so
+ * that they will be handled by the next call to @ref avs_sched_run.
+ *
+ * @param server  Server to operate on.
+ *
+ * @param timeout Maximum time to wait. Invalid duration means waiting
+ *                indefinitely.
+ *
+ * @returns @ref AVS_OK for success (including timeout), or an error condition
+ *          for which polling the sockets failed.
+ */
+avs_error_t avs_http_server_wait(avs_http_server_t *server,
+                                 avs_time_duration_t timeout);
+
+/**
+ * Returns the request method, e.g. "GET".
+ */
+const char *
+avs_http_server_request_method(const avs_http_server_request_t *request);
+
+/**
+ * Returns the path part of the request target. Percent-encoding is NOT decoded.
+ */
+const char *
+avs_http_server_request_path(const avs_http_server_request_t *request);
+
+/**
+ * Returns the query part of the request target (without the question mark), or
+ * NULL if not present. Percent-encoding is NOT decoded.
+ */
+const char *
+avs_http_server_request_query(const avs_http_server_request_t *request);
+
+/**
+ * Returns the value of the first request header with the given name (compared
+ * case-insensitively), or NULL if not present.
+ */
+const char *
+avs_http_server_request_header(const avs_http_server_request_t *request,
+                               const char *name);
+
+/**
+ * Returns a stream that can be used to read the request body. Chunked transfer
+ * encoding is decoded transparently. If the request has no body, the stream is
+ * empty.
+ *
+ * The stream is owned by the server and MUST NOT be cleaned up by the handler.
+ * Any part of the body that has not been read by the handler is discarded
+ * after sending the response.
+ */
+avs_stream_t *avs_http_server_request_body(avs_http_server_request_t *request);
+
+/**
+ * Adds a header to the response. Must be called before
+ * @ref avs_http_server_respond or @ref avs_http_server_respond_begin.
+ *
+ * The key and value are copied into the per-connection header buffer.
+ *
+ * @returns 0 for success, or a negative value if the header buffer is too
+ *          small or the response has already been started.
+ */
+int avs_http_server_add_header(avs_http_server_request_t *request,
+                               const char *key,
+                               const char *value);
+
+/**
+ * Sends a complete response with a <c>Content-Length</c> header.
+ *
+ * @param request      Request to respond to.
+ *
+ * @param status_code  HTTP status code.
+ *
+ * @param content_type Value of the <c>Content-Type</c> header, or NULL if the
+ *                     header shall not be sent.
+ *
+ * @param body         Response body. May be NULL if @p body_size is 0.
+ *
+ * @param body_size    Size of the response body.
+ */
+avs_error_t avs_http_server_respond(avs_http_server_request_t *request,
+                                    int status_code,
+                                    const char *content_type,
+                                    const void *body,
+                                    size_t body_size);
+
+/**
+ * Starts a response that uses chunked transfer encoding. The body shall then
+ * be sent using @ref avs_http_server_respond_write and finished with
+ * @ref avs_http_server_respond_finish.
+ *
+ * If the request was made using HTTP/1.0, the response body is delimited by
+ * closing the connection instead.
+ */
+avs_error_t avs_http_server_respond_begin(avs_http_server_request_t *request,
+                                          int status_code,
+                                          const char *content_type);
+
+/**
+ * Sends a part of the response body started with
+ * @ref avs_http_server_respond_begin.
+ */
+avs_error_t avs_http_server_respond_write(avs_http_server_request_t *request,
+                                          const void *data,
+                                          size_t data_size);
+
+/**
+ * Finishes the response started with @ref avs_http_server_respond_begin.
+ */
+avs_error_t avs_http_server_respond_finish(avs_http_server_request_t *request);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AVS_COMMONS_HTTP_SERVER_H */
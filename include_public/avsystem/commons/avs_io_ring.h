@@ -0,0 +1,278 @@
+/*
+ * Copyright 2021 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AVS_COMMONS_IO_RING_H
+#define AVS_COMMONS_IO_RING_H
+
+#include <avsystem/commons/avs_commons_config.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <avsystem/commons/avs_errno.h>
+#include <avsystem/commons/avs_socket.h>
+#include <avsystem/commons/avs_time.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifdef AVS_COMMONS_NET_WITH_IO_RING
+
+/**
+ * @file avs_io_ring.h
+ *
+ * Completion-based asynchronous I/O on file descriptors.
+ *
+ * Operations are queued using functions such as @ref avs_io_ring_recv, passed
+ * to the operating system in batches, and their results are delivered through
+ * callbacks called from @ref avs_io_ring_wait.
+ *
+ * On Linux, io_uring is used, through raw system calls. If it is not available
+ * (e.g. the kernel is older than 5.7, or io_uring has been disabled), or
+ * explicitly disabled in @ref avs_io_ring_config_t, operations are performed
+ * using <c>poll()</c> and non-blocking system calls instead, with the same
+ * semantics.
+ *
+ * The file descriptors of network sockets may be obtained using
+ * @ref avs_net_socket_get_system. Note that operations on the descriptor of a
+ * (D)TLS socket would bypass the security layer, so only plain TCP and UDP
+ * sockets shall be used this way.
+ *
+ * The ring is not thread-safe. It is intended to be driven from a single event
+ * loop, e.g. together with @ref avs_sched :
+ *
+ * @code
+ * while (running) {
+ *     avs_io_ring_wait(ring, avs_sched_time_of_next(sched));
+ *     avs_sched_run(sched);
+ * }
+ * @endcode
+ */
+
+/**
+ * Asynchronous I/O context.
+ */
+typedef struct avs_io_ring_struct avs_io_ring_t;
+
+/**
+ * Configuration of the asynchronous I/O context.
+ */
+typedef struct {
+    /**
+     * Maximum number of operations that may be in progress at the same time.
+     * If 0, a default of 64 is used.
+     */
+    size_t queue_size;
+
+    /**
+     * If true, io_uring is not used even if it is available.
+     */
+    bool disable_io_uring;
+} avs_io_ring_config_t;
+
+/**
+ * A memory region that may be registered with the ring using
+ * @ref avs_io_ring_register_buffers.
+ */
+typedef struct {
+    void *buf;
+    size_t size;
+} avs_io_ring_buffer_t;
+
+/**
+ * Callback called when an operation completes.
+ *
+ * @param arg    Opaque argument passed when the operation was queued.
+ *
+ * @param err    Result of the operation.
+ *
+ * @param result If @p err is a success, the number of bytes transferred
+ *               (0 means end of stream for receive and read operations), or
+ *               the new file descriptor for @ref avs_io_ring_accept. Undefined
+ *               otherwise.
+ */
+typedef void avs_io_ring_callback_t(void *arg, avs_error_t err, size_t result);
+
+/**
+ * Creates an asynchronous I/O context.
+ *
+ * @param out_ring Pointer to a variable that will be set to the newly created
+ *                 context. <c>*out_ring</c> MUST be NULL.
+ *
+ * @param config   Configuration of the context, or NULL to use the defaults.
+ *
+ * @returns AVS_OK for success, or an error condition for which the operation
+ *          failed. Lack of io_uring support is NOT an error.
+ */
+avs_error_t avs_io_ring_create(avs_io_ring_t **out_ring,
+                               const avs_io_ring_config_t *config);
+
+/**
+ * Destroys an asynchronous I/O context and sets <c>*ring_ptr</c> to NULL.
+ *
+ * Callbacks of operations still in progress are not called. Note that when
+ * io_uring is used, the kernel may still access their buffers until they are
+ * cancelled, so it is safest to wait for all operations to complete first.
+ */
+void avs_io_ring_cleanup(avs_io_ring_t **ring_ptr);
+
+/**
+ * @returns Whether the context uses io_uring, as opposed to the
+ *          <c>poll()</c>-based fallback.
+ */
+bool avs_io_ring_is_native(const avs_io_ring_t *ring);
+
+/**
+ * @returns Number of operations that have been queued and not completed yet.
+ */
+size_t avs_io_ring_pending(const avs_io_ring_t *ring);
+
+/**
+ * Registers memory regions with the kernel, so that read and write operations
+ * on buffers within them may avoid mapping the pages for each operation.
+ * Previously registered buffers, if any, are unregistered.
+ *
+ * This is only an optimization - it is a no-op in the fallback mode, and
+ * buffers do not need to be registered to be used.
+ *
+ * MUST NOT be called while any operations are in progress.
+ *
+ * @returns AVS_OK for success, or an error condition for which the operation
+ *          failed (e.g. exceeding <c>RLIMIT_MEMLOCK</c>).
+ */
+avs_error_t avs_io_ring_register_buffers(avs_io_ring_t *ring,
+                                         const avs_io_ring_buffer_t *buffers,
+                                         size_t buffer_count);
+
+/**
+ * Queues receiving up to @p size bytes from socket @p fd into @p buf.
+ *
+ * The operation is not passed to the operating system until
+ * @ref avs_io_ring_submit or @ref avs_io_ring_wait is called. @p buf MUST
+ * remain valid until the operation completes.
+ *
+ * @returns AVS_OK for success, or <c>AVS_ENOBUFS</c> if the maximum number of
+ *          operations is already in progress.
+ */
+avs_error_t avs_io_ring_recv(avs_io_ring_t *ring,
+                             int fd,
+                             void *buf,
+                             size_t size,
+                             avs_io_ring_callback_t *callback,
+                             void *arg);
+
+/**
+ * Queues sending up to @p size bytes from @p buf on socket @p fd. A partial
+ * send is reported as success with the number of bytes actually sent.
+ *
+ * See @ref avs_io_ring_recv for details.
+ */
+avs_error_t avs_io_ring_send(avs_io_ring_t *ring,
+                             int fd,
+                             const void *buf,
+                             size_t size,
+                             avs_io_ring_callback_t *callback,
+                             void *arg);
+
+/**
+ * Queues accepting a connection on listening socket @p fd. The new file
+ * descriptor is passed to the callback, and needs to be closed by the user.
+ *
+ * See @ref avs_io_ring_recv for details.
+ */
+avs_error_t avs_io_ring_accept(avs_io_ring_t *ring,
+                               int fd,
+                               avs_io_ring_callback_t *callback,
+                               void *arg);
+
+/**
+ * Queues connecting socket @p fd to @p endpoint, which is copied.
+ *
+ * In the fallback mode, @p fd needs to be in non-blocking mode for the
+ * operation not to block.
+ *
+ * See @ref avs_io_ring_recv for details.
+ */
+avs_error_t avs_io_ring_connect(avs_io_ring_t *ring,
+                                int fd,
+                                const avs_net_resolved_endpoint_t *endpoint,
+                                avs_io_ring_callback_t *callback,
+                                void *arg);
+
+/**
+ * Queues reading up to @p size bytes at @p offset of file @p fd into @p buf.
+ *
+ * See @ref avs_io_ring_recv for details.
+ */
+avs_error_t avs_io_ring_read(avs_io_ring_t *ring,
+                             int fd,
+                             void *buf,
+                             size_t size,
+                             uint64_t offset,
+                             avs_io_ring_callback_t *callback,
+                             void *arg);
+
+/**
+ * Queues writing up to @p size bytes from @p buf at @p offset of file @p fd.
+ *
+ * See @ref avs_io_ring_recv for details.
+ */
+avs_error_t avs_io_ring_write(avs_io_ring_t *ring,
+                              int fd,
+                              const void *buf,
+                              size_t size,
+                              uint64_t offset,
+                              avs_io_ring_callback_t *callback,
+                              void *arg);
+
+/**
+ * Passes all queued operations to the operating system, using a single system
+ * call if io_uring is used. Does not wait for any of them to complete.
+ *
+ * @returns AVS_OK for success, or an error condition for which the operation
+ *          failed.
+ */
+avs_error_t avs_io_ring_submit(avs_io_ring_t *ring);
+
+/**
+ * Submits all queued operations, waits until at least one operation completes
+ * or @p deadline passes, and calls the callbacks of all completed operations.
+ *
+ * The callbacks may queue new operations.
+ *
+ * @param ring     Asynchronous I/O context.
+ *
+ * @param deadline Time until which to wait. If it is invalid, there is no time
+ *                 limit.
+ *
+ * @returns
+ * - AVS_OK if at least one operation has completed, or no operations are in
+ *   progress
+ * - <c>AVS_ETIMEDOUT</c> if @p deadline has passed
+ * - any other error condition if waiting failed
+ */
+avs_error_t avs_io_ring_wait(avs_io_ring_t *ring,
+                             avs_time_monotonic_t deadline);
+
+#endif // AVS_COMMONS_NET_WITH_IO_RING
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AVS_COMMONS_IO_RING_H */
@@ -21,7 +21,14 @@
 
 #include <avsystem/commons/avs_defs.h>
 
+#ifdef AVS_COMMONS_LOG_WITH_RATE_LIMIT
+#    include <avsystem/commons/avs_time.h>
+#endif // AVS_COMMONS_LOG_WITH_RATE_LIMIT
+
 #ifdef __cplusplus
+#    if defined(AVS_COMMONS_LOG_WITH_STRUCTURED) && __cplusplus >= 201103L
+#        include <vector> // used in avs_log_kv
+#    endif // defined(AVS_COMMONS_LOG_WITH_STRUCTURED) && __cplusplus >= 201103L
 extern "C" {
 #endif
 
@@ -121,6 +128,11 @@ void avs_log_reset(void);
 /**@{*/
 int avs_log_should_log__(avs_log_level_t level, const char *module);
 
+int avs_log_should_log_at__(avs_log_level_t level,
+                            const char *module,
+                            const char *file,
+                            unsigned line);
+
 void avs_log_internal_forced_v__(avs_log_level_t level,
                                  const char *module,
                                  const char *file,
@@ -160,7 +172,7 @@ void avs_log_internal_l__(avs_log_level_t level,
             Level, ModuleStr, __FILE__, __LINE__, __VA_ARGS__)
 
 #define AVS_LOG_LAZY_IMPL__(Level, Variant, ModuleStr, ...)               \
-    (avs_log_should_log__(Level, ModuleStr)                               \
+    (avs_log_should_log_at__(Level, ModuleStr, __FILE__, __LINE__)        \
              ? avs_log_internal_forced_##Variant##__(                     \
                        Level, ModuleStr, __FILE__, __LINE__, __VA_ARGS__) \
              : (void) 0)
@@ -310,6 +322,404 @@ int avs_log_set_level__(const char *module, avs_log_level_t level);
 #define avs_log_set_default_level(Level) \
     ((void) avs_log_set_level__(NULL, Level))
 
+#ifdef AVS_COMMONS_LOG_WITH_RATE_LIMIT
+/**
+ * @name Logging subsystem internals
+ */
+/**@{*/
+int avs_log_set_rate_limit__(const char *module,
+                             avs_log_level_t level,
+                             unsigned burst,
+                             avs_time_duration_t interval);
+/**@}*/
+
+/**
+ * Limits the rate of messages of a given level generated by a given module.
+ *
+ * The limit applies to each call site (i.e. each invocation of @ref avs_log in
+ * the source code, identified by its file name and line number) separately.
+ * Each call site may log up to @p Burst messages at once; after that, it
+ * regains the ability to log one more message every @p Interval. Messages over
+ * the limit are suppressed without being formatted. When the call site is
+ * allowed to log again, a "last message repeated N times" message is logged
+ * first, with N being the number of suppressed messages.
+ *
+ * If not set, the value set via @ref avs_log_set_default_rate_limit is used.
+ *
+ * Call sites are tracked in a table of a fixed size, configured with the
+ * <c>AVS_COMMONS_LOG_RATE_LIMIT_CALL_SITES</c> macro. If more call sites are
+ * being rate limited at the same time, some of them may be forgotten and
+ * allowed a new burst.
+ *
+ * @param Module   Name of the module that generates the messages, given as a
+ *                 raw token.
+ *
+ * @param Level    Log level of the messages to limit, other than
+ *                 @ref AVS_LOG_QUIET.
+ *
+ * @param Burst    Maximum number of messages that may be logged at once. 0
+ *                 disables rate limiting.
+ *
+ * @param Interval Period after which the call site is allowed to log one more
+ *                 message, as @ref avs_time_duration_t. Ignored if @p Burst is
+ *                 0, otherwise it needs to be positive.
+ *
+ * @return 0 on success, negative value in case of an error (i.e. invalid
+ *         arguments or out of memory)
+ *
+ * <example>
+ * @code
+ * int main() {
+ *     // at most 10 errors at once, then one per second from each call site
+ *     avs_log_set_rate_limit(net, AVS_LOG_ERROR, 10,
+ *                            avs_time_duration_from_scalar(1, AVS_TIME_S));
+ *     // ...
+ * }
+ * @endcode
+ * </example>
+ */
+#    define avs_log_set_rate_limit(Module, Level, Burst, Interval) \
+        avs_log_set_rate_limit__(AVS_QUOTE_MACRO(Module), Level, Burst, \
+                                 Interval)
+
+/**
+ * Sets the rate limit for messages of a given level, for modules that do not
+ * have one set using @ref avs_log_set_rate_limit.
+ *
+ * By default, no rate limits are applied.
+ *
+ * @param Level    Log level of the messages to limit, other than
+ *                 @ref AVS_LOG_QUIET.
+ *
+ * @param Burst    Maximum number of messages that may be logged at once. 0
+ *                 disables rate limiting.
+ *
+ * @param Interval Period after which a call site is allowed to log one more
+ *                 message.
+ *
+ * @return 0 on success, negative value in case of invalid arguments.
+ */
+#    define avs_log_set_default_rate_limit(Level, Burst, Interval) \
+        avs_log_set_rate_limit__(NULL, Level, Burst, Interval)
+
+/**
+ * Returns the number of messages suppressed by rate limiting since the last
+ * call to @ref avs_log_reset.
+ *
+ * @param level Log level of the messages to count. If @ref AVS_LOG_QUIET,
+ *              suppressed messages of all levels are counted.
+ */
+uint64_t avs_log_dropped_count(avs_log_level_t level);
+#endif // AVS_COMMONS_LOG_WITH_RATE_LIMIT
+
+#ifdef AVS_COMMONS_LOG_WITH_STRUCTURED
+/**
+ * Type of the value of a structured log field.
+ */
+typedef enum {
+    AVS_LOG_FIELD_TYPE_STR,
+    AVS_LOG_FIELD_TYPE_I64,
+    AVS_LOG_FIELD_TYPE_U64,
+    AVS_LOG_FIELD_TYPE_DOUBLE,
+    AVS_LOG_FIELD_TYPE_BOOL
+} avs_log_field_type_t;
+
+/**
+ * A single key-value pair attached to a log message. Fields are normally
+ * created using the <c>AVS_LOG_FIELD_*</c> macros.
+ */
+typedef struct {
+    /**
+     * Name of the field. It is expected to consist of characters that do not
+     * need escaping, e.g. letters, digits and underscores. NULL terminates
+     * arrays of fields.
+     */
+    const char *key;
+    avs_log_field_type_t type;
+    union {
+        const char *str;
+        int64_t i64;
+        uint64_t u64;
+        double dbl;
+        bool boolean;
+    } value;
+} avs_log_field_t;
+
+/**
+ * A log message, as passed to @ref avs_log_record_handler_t.
+ */
+typedef struct {
+    avs_log_level_t level;
+    const char *module;
+    const char *file;
+    unsigned line;
+
+    /**
+     * The message itself, without the level, module and code location.
+     */
+    const char *message;
+
+    /**
+     * Fields passed to @ref avs_log_kv, if any.
+     */
+    const avs_log_field_t *fields;
+    size_t field_count;
+
+    /**
+     * Fields attached to the context of the logging thread using
+     * @ref avs_log_context_push.
+     */
+    const avs_log_field_t *context_fields;
+    size_t context_field_count;
+} avs_log_record_t;
+
+/**
+ * User-defined handler for structured logging.
+ *
+ * If set, it receives all log messages, including the ones generated using
+ * @ref avs_log, instead of @ref avs_log_handler_t. The record, including all
+ * strings it points to, is only valid during the call.
+ *
+ * @param record Message to log.
+ */
+typedef void avs_log_record_handler_t(const avs_log_record_t *record);
+
+/**
+ * Sets the handler for structured log messages.
+ *
+ * If no such handler is set (the default), messages logged using
+ * @ref avs_log_kv are formatted as text, with fields appended in the logfmt
+ * format (<c>key=value</c>), and passed to the handler set using
+ * @ref avs_log_set_handler.
+ *
+ * @param record_handler New handler to use, or NULL to go back to passing
+ *                       formatted messages to @ref avs_log_handler_t.
+ */
+void avs_log_set_record_handler(avs_log_record_handler_t *record_handler);
+
+/**
+ * Encodes a log record as a single line in the logfmt format, e.g.:
+ *
+ * <c>level=INFO module=net file=net.c line=42 msg="connected" peer=10.0.0.1</c>
+ *
+ * @param out_buf  Buffer to write the result to.
+ *
+ * @param buf_size Size of @p out_buf, including space for the terminating
+ *                 null character.
+ *
+ * @param record   Log record to encode.
+ *
+ * @returns Length of the encoded string on success, or a negative value if it
+ *          did not fit in the buffer - in that case, @p out_buf contains the
+ *          truncated string.
+ */
+int avs_log_record_to_logfmt(char *out_buf,
+                             size_t buf_size,
+                             const avs_log_record_t *record);
+
+/**
+ * Encodes a log record as a JSON object, e.g.:
+ *
+ * <c>{"level":"INFO","module":"net","file":"net.c","line":42,
+ * "msg":"connected","peer":"10.0.0.1"}</c>
+ *
+ * Non-finite floating-point values are encoded as <c>null</c>.
+ *
+ * @param out_buf  Buffer to write the result to.
+ *
+ * @param buf_size Size of @p out_buf, including space for the terminating
+ *                 null character.
+ *
+ * @param record   Log record to encode.
+ *
+ * @returns Length of the encoded string on success, or a negative value if it
+ *          did not fit in the buffer - in that case, @p out_buf contains the
+ *          truncated string, which is not valid JSON.
+ */
+int avs_log_record_to_json(char *out_buf,
+                           size_t buf_size,
+                           const avs_log_record_t *record);
+
+/**
+ * Attaches a field to all messages subsequently logged from the current
+ * thread, until it is removed using @ref avs_log_context_pop. This is intended
+ * for correlation identifiers, e.g. of the request being handled.
+ *
+ * Neither the key nor string values are copied, so they need to remain valid
+ * until the field is removed.
+ *
+ * Per-thread storage requires a compiler that supports the GCC <c>__thread</c>
+ * extension; with other compilers, a single context is shared by all threads.
+ *
+ * @param field Field to attach.
+ *
+ * @return 0 on success, negative value if
+ *         <c>AVS_COMMONS_LOG_CONTEXT_MAX_FIELDS</c> fields are already
+ *         attached or @p field is invalid.
+ */
+int avs_log_context_push(avs_log_field_t field);
+
+/**
+ * Removes the field most recently attached using @ref avs_log_context_push.
+ */
+void avs_log_context_pop(void);
+
+/**
+ * @name Logging subsystem internals
+ */
+/**@{*/
+static inline avs_log_field_t avs_log_field__(const char *key,
+                                              avs_log_field_type_t type) {
+    avs_log_field_t field;
+    field.key = key;
+    field.type = type;
+    field.value.u64 = 0;
+    return field;
+}
+
+static inline avs_log_field_t avs_log_field_str__(const char *key,
+                                                  const char *value) {
+    avs_log_field_t field = avs_log_field__(key, AVS_LOG_FIELD_TYPE_STR);
+    field.value.str = value;
+    return field;
+}
+
+static inline avs_log_field_t avs_log_field_i64__(const char *key,
+                                                  int64_t value) {
+    avs_log_field_t field = avs_log_field__(key, AVS_LOG_FIELD_TYPE_I64);
+    field.value.i64 = value;
+    return field;
+}
+
+static inline avs_log_field_t avs_log_field_u64__(const char *key,
+                                                  uint64_t value) {
+    avs_log_field_t field = avs_log_field__(key, AVS_LOG_FIELD_TYPE_U64);
+    field.value.u64 = value;
+    return field;
+}
+
+static inline avs_log_field_t avs_log_field_double__(const char *key,
+                                                     double value) {
+    avs_log_field_t field = avs_log_field__(key, AVS_LOG_FIELD_TYPE_DOUBLE);
+    field.value.dbl = value;
+    return field;
+}
+
+static inline avs_log_field_t avs_log_field_bool__(const char *key,
+                                                   bool value) {
+    avs_log_field_t field = avs_log_field__(key, AVS_LOG_FIELD_TYPE_BOOL);
+    field.value.boolean = value;
+    return field;
+}
+
+void avs_log_internal_kv__(avs_log_level_t level,
+                           const char *module,
+                           const char *file,
+                           unsigned line,
+                           const char *msg,
+                           const avs_log_field_t *fields);
+
+#    if defined(__cplusplus) && __cplusplus >= 201103L
+#        define AVS_LOG_FIELDS__(...) \
+            (::std::vector<avs_log_field_t>{ __VA_ARGS__ }.data())
+#    else // defined(__cplusplus) && __cplusplus >= 201103L
+#        define AVS_LOG_FIELDS__(...) \
+            (&(const avs_log_field_t[]) { __VA_ARGS__ }[0])
+#    endif // defined(__cplusplus) && __cplusplus >= 201103L
+
+#    define AVS_LOG_KV_IMPL__(Level, ModuleStr, Msg, ...)                 \
+        (avs_log_should_log_at__(Level, ModuleStr, __FILE__, __LINE__)    \
+                 ? avs_log_internal_kv__(Level, ModuleStr, __FILE__,      \
+                                         __LINE__, Msg,                   \
+                                         AVS_LOG_FIELDS__(__VA_ARGS__))   \
+                 : (void) 0)
+
+#    define AVS_LOG_KV__TRACE(...) AVS_LOG_KV_IMPL__(AVS_LOG_TRACE, __VA_ARGS__)
+#    define AVS_LOG_KV__DEBUG(...) AVS_LOG_KV_IMPL__(AVS_LOG_DEBUG, __VA_ARGS__)
+#    define AVS_LOG_KV__INFO(...) AVS_LOG_KV_IMPL__(AVS_LOG_INFO, __VA_ARGS__)
+#    define AVS_LOG_KV__WARNING(...) \
+        AVS_LOG_KV_IMPL__(AVS_LOG_WARNING, __VA_ARGS__)
+#    define AVS_LOG_KV__ERROR(...) AVS_LOG_KV_IMPL__(AVS_LOG_ERROR, __VA_ARGS__)
+
+#    ifndef AVS_LOG_WITH_TRACE
+#        undef AVS_LOG_KV__TRACE
+#        define AVS_LOG_KV__TRACE(...) \
+            ((void) sizeof(AVS_LOG_KV_IMPL__(AVS_LOG_TRACE, __VA_ARGS__), 0))
+#    endif
+
+#    ifdef AVS_LOG_WITHOUT_DEBUG
+#        undef AVS_LOG_KV__DEBUG
+#        define AVS_LOG_KV__DEBUG(...) \
+            ((void) sizeof(AVS_LOG_KV_IMPL__(AVS_LOG_DEBUG, __VA_ARGS__), 0))
+#    endif
+/**@}*/
+
+/**
+ * Creates a structured log field with a string value.
+ *
+ * @param Key   Name of the field, as a string.
+ *
+ * @param Value Value of the field, as <c>const char *</c>.
+ */
+#    define AVS_LOG_FIELD_STR(Key, Value) avs_log_field_str__((Key), (Value))
+
+/**
+ * Creates a structured log field with a signed integer value.
+ */
+#    define AVS_LOG_FIELD_I64(Key, Value) \
+        avs_log_field_i64__((Key), (int64_t) (Value))
+
+/**
+ * Creates a structured log field with an unsigned integer value.
+ */
+#    define AVS_LOG_FIELD_U64(Key, Value) \
+        avs_log_field_u64__((Key), (uint64_t) (Value))
+
+/**
+ * Creates a structured log field with a floating-point value.
+ */
+#    define AVS_LOG_FIELD_DOUBLE(Key, Value) \
+        avs_log_field_double__((Key), (double) (Value))
+
+/**
+ * Creates a structured log field with a boolean value.
+ */
+#    define AVS_LOG_FIELD_BOOL(Key, Value) \
+        avs_log_field_bool__((Key), (bool) (Value))
+
+/**
+ * Creates a log message with structured fields attached.
+ *
+ * The message is passed to the handler set using
+ * @ref avs_log_set_record_handler, or, if there is none, formatted as text and
+ * passed to the handler set using @ref avs_log_set_handler.
+ *
+ * The fields are not evaluated if the current log level for the module is
+ * higher than @p Level, or if the message is suppressed by rate limiting.
+ *
+ * @param Module Name of the module that generates the message, given as a raw
+ *               token.
+ *
+ * @param Level  Log level, specified as a name of @ref avs_log_level_t (other
+ *               than <c>QUIET</c>) with the leading <c>AVS_LOG_</c> omitted.
+ *
+ * The remaining arguments are the message, as a constant string that is NOT
+ * interpreted as a format string, followed by any number of fields created
+ * using the <c>AVS_LOG_FIELD_*</c> macros.
+ *
+ * <example>
+ * @code
+ * avs_log_kv(net, INFO, "packet received",
+ *            AVS_LOG_FIELD_STR("peer", peer_address),
+ *            AVS_LOG_FIELD_U64("bytes", packet_size));
+ * @endcode
+ * </example>
+ */
+#    define avs_log_kv(Module, Level, ...)                             \
+        AVS_LOG_KV__##Level(AVS_QUOTE_MACRO(Module), __VA_ARGS__,      \
+                            avs_log_field__(NULL, AVS_LOG_FIELD_TYPE_STR))
+#endif // AVS_COMMONS_LOG_WITH_STRUCTURED
+
 #ifdef __cplusplus
 }
 #endif
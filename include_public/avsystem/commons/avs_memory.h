@@ -96,6 +96,49 @@ void *avs_calloc(size_t nmemb, size_t size);
  */
 void *avs_realloc(void *ptr, size_t size);
 
+#ifdef AVS_COMMONS_UTILS_WITH_STANDARD_ALLOCATOR_HOOKS
+/**
+ * Set of callbacks invoked by the standard implementation of avs_malloc(),
+ * avs_calloc(), avs_realloc() and avs_free().
+ *
+ * These are meant for test harnesses that need to simulate allocation failures
+ * or track outstanding allocations, and are only available if avs_commons is
+ * compiled with <c>AVS_COMMONS_UTILS_WITH_STANDARD_ALLOCATOR_HOOKS</c>. Any of
+ * the callbacks may be NULL.
+ */
+typedef struct {
+    /**
+     * Called before each attempt to allocate or enlarge a memory block. If it
+     * returns false, the allocation fails without calling the system
+     * allocator.
+     */
+    bool (*allow_allocation)(size_t size);
+
+    /**
+     * Called after a memory block has been successfully allocated or resized.
+     * @p old_ptr is NULL for new allocations.
+     */
+    void (*allocated)(void *old_ptr, void *new_ptr, size_t size);
+
+    /**
+     * Called before a non-NULL memory block is freed, also if it is freed by
+     * calling avs_realloc() with size 0.
+     */
+    void (*freed)(void *ptr);
+} avs_memory_hooks_t;
+
+/**
+ * Installs allocator hooks.
+ *
+ * NOTE: This function is not thread-safe, and the hooks are called without any
+ * synchronization.
+ *
+ * @param hooks Hooks to install. The structure is copied. NULL uninstalls any
+ *              previously installed hooks.
+ */
+void avs_memory_set_hooks(const avs_memory_hooks_t *hooks);
+#endif // AVS_COMMONS_UTILS_WITH_STANDARD_ALLOCATOR_HOOKS
+
 /**
  * Swaps <c>[memptr1, memptr1+n)</c> and <c>[memptr2, memptr2+n)</c> memory
  * fragments. Contains assertion that the fragments do not intersect.
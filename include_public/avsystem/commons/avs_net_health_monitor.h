@@ -0,0 +1,239 @@
+/*
+ * Copyright 2021 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AVS_COMMONS_NET_HEALTH_MONITOR_H
+#define AVS_COMMONS_NET_HEALTH_MONITOR_H
+
+#include <avsystem/commons/avs_commons_config.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <avsystem/commons/avs_errno.h>
+#include <avsystem/commons/avs_sched.h>
+#include <avsystem/commons/avs_socket.h>
+#include <avsystem/commons/avs_time.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifdef AVS_COMMONS_NET_WITH_HEALTH_MONITOR
+
+/**
+ * @file avs_net_health_monitor.h
+ *
+ * Detection of dead peers of long-lived connections.
+ *
+ * The monitor periodically checks whether any data has been received on the
+ * socket, using <c>AVS_NET_SOCKET_OPT_BYTES_RECEIVED</c>. After the configured
+ * period of inactivity, it sends a heartbeat using a callback provided by the
+ * application, and waits for any data to arrive. If the configured number of
+ * consecutive heartbeats remains unanswered, the peer is reported dead.
+ *
+ * The heartbeat is an application-level message that elicits a response from
+ * the peer, e.g. an empty Confirmable message in CoAP. DTLS heartbeats
+ * (RFC 6520) are not used, as none of the supported (D)TLS backends implement
+ * them. For TCP connections, kernel-level keepalive probes (see
+ * @ref avs_net_socket_configuration_t#tcp_keepalive) may be used instead.
+ *
+ * If the application reports reception of heartbeat responses using
+ * @ref avs_net_health_monitor_heartbeat_acked, the round-trip time is also
+ * tracked, as specified for TCP in RFC 6298.
+ *
+ * The monitor is not thread-safe. The scheduler needs to be run in the same
+ * thread that uses the monitor.
+ *
+ * Only available if <c>AVS_COMMONS_NET_WITH_HEALTH_MONITOR</c> is enabled.
+ */
+
+typedef struct avs_net_health_monitor_struct avs_net_health_monitor_t;
+
+typedef enum {
+    /**
+     * The configured number of consecutive heartbeats have not been answered.
+     * No more heartbeats are sent until activity of the peer is reported.
+     */
+    AVS_NET_HEALTH_PEER_DEAD,
+
+    /**
+     * Activity of a peer previously reported dead has been reported using
+     * @ref avs_net_health_monitor_activity or
+     * @ref avs_net_health_monitor_heartbeat_acked. Monitoring is resumed.
+     */
+    AVS_NET_HEALTH_PEER_ALIVE
+} avs_net_health_event_t;
+
+/**
+ * Sends a heartbeat to the peer.
+ *
+ * @param socket    Monitored socket.
+ * @param user_data Opaque pointer passed in the configuration.
+ *
+ * @returns @ref AVS_OK for success, or an error condition. A heartbeat that
+ *          could not be sent counts as unanswered.
+ */
+typedef avs_error_t avs_net_health_send_heartbeat_t(avs_net_socket_t *socket,
+                                                     void *user_data);
+
+/**
+ * Called when the monitor detects a change of the peer's state.
+ *
+ * The handler may call @ref avs_net_health_monitor_cleanup on the monitor.
+ *
+ * @param monitor   Monitor that detected the change.
+ * @param event     Type of the change.
+ * @param user_data Opaque pointer passed in the configuration.
+ */
+typedef void avs_net_health_event_handler_t(avs_net_health_monitor_t *monitor,
+                                            avs_net_health_event_t event,
+                                            void *user_data);
+
+typedef struct {
+    /**
+     * Time without any data received from the peer after which a heartbeat is
+     * sent. Default: 30 s.
+     */
+    avs_time_duration_t idle_interval;
+
+    /**
+     * Time to wait for any data after sending a heartbeat, before considering
+     * it unanswered and sending the next one. Default: 5 s.
+     */
+    avs_time_duration_t response_timeout;
+
+    /**
+     * Number of consecutive unanswered heartbeats after which the peer is
+     * reported dead. Default: 3.
+     */
+    unsigned max_missed_heartbeats;
+
+    /**
+     * Function that sends a heartbeat. Required.
+     */
+    avs_net_health_send_heartbeat_t *send_heartbeat;
+
+    /**
+     * Function called on changes of the peer's state. May be NULL.
+     */
+    avs_net_health_event_handler_t *on_event;
+
+    /**
+     * Opaque pointer passed to @ref send_heartbeat and @ref on_event.
+     */
+    void *user_data;
+} avs_net_health_monitor_config_t;
+
+typedef struct {
+    /**
+     * Most recent round-trip time sample. Invalid if no heartbeat has been
+     * acknowledged yet.
+     */
+    avs_time_duration_t last_rtt;
+
+    /**
+     * Smoothed round-trip time (SRTT). Invalid if no heartbeat has been
+     * acknowledged yet.
+     */
+    avs_time_duration_t smoothed_rtt;
+
+    /**
+     * Round-trip time variation (RTTVAR). Invalid if no heartbeat has been
+     * acknowledged yet.
+     */
+    avs_time_duration_t rtt_variation;
+
+    /** Number of heartbeats sent. */
+    uint64_t heartbeats_sent;
+
+    /** Number of heartbeats not answered within the response timeout. */
+    uint64_t heartbeats_missed;
+
+    /** True if the peer is currently considered dead. */
+    bool peer_dead;
+} avs_net_health_monitor_stats_t;
+
+/**
+ * Creates a monitor of the given socket, and schedules its first check.
+ *
+ * @param out_monitor Pointer to a variable in which the created monitor will
+ *                    be stored.
+ *
+ * @param sched       Scheduler used to run the checks. It needs to outlive
+ *                    the monitor.
+ *
+ * @param socket      Socket to monitor. It needs to outlive the monitor.
+ *
+ * @param config      Monitor configuration. Zero-valued fields are replaced
+ *                    with defaults.
+ *
+ * @returns @ref AVS_OK for success, or an error condition.
+ *          <c>avs_errno(AVS_EINVAL)</c> is returned if any of the arguments is
+ *          NULL, or <c>send_heartbeat</c> is not set.
+ */
+avs_error_t
+avs_net_health_monitor_create(avs_net_health_monitor_t **out_monitor,
+                              avs_sched_t *sched,
+                              avs_net_socket_t *socket,
+                              const avs_net_health_monitor_config_t *config);
+
+/**
+ * Cancels monitoring, frees the monitor and sets @p *monitor_ptr to NULL.
+ *
+ * @param monitor_ptr Pointer to a variable holding the monitor. If it holds
+ *                    NULL, this function is a no-op.
+ */
+void avs_net_health_monitor_cleanup(avs_net_health_monitor_t **monitor_ptr);
+
+/**
+ * Reports that data has been received from the peer.
+ *
+ * Calling this function is optional, as data received on the monitored socket
+ * is detected automatically. It allows reporting activity that cannot be
+ * detected this way, e.g. if the socket has been closed and reconnected.
+ *
+ * @param monitor Monitor to update.
+ */
+void avs_net_health_monitor_activity(avs_net_health_monitor_t *monitor);
+
+/**
+ * Reports that a response to the most recent heartbeat has been received.
+ *
+ * In addition to reporting activity, the time elapsed since sending the
+ * heartbeat is used as a round-trip time sample. The call is equivalent to
+ * @ref avs_net_health_monitor_activity if no heartbeat is outstanding.
+ *
+ * @param monitor Monitor to update.
+ */
+void avs_net_health_monitor_heartbeat_acked(avs_net_health_monitor_t *monitor);
+
+/**
+ * Retrieves the round-trip time estimates and heartbeat statistics.
+ *
+ * @param monitor   Monitor to query.
+ * @param out_stats Structure to fill.
+ */
+void avs_net_health_monitor_get_stats(
+        const avs_net_health_monitor_t *monitor,
+        avs_net_health_monitor_stats_t *out_stats);
+
+#endif // AVS_COMMONS_NET_WITH_HEALTH_MONITOR
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AVS_COMMONS_NET_HEALTH_MONITOR_H */
@@ -18,6 +18,7 @@
 #define AVS_COMMONS_PERSISTENCE_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <string.h>
 
@@ -57,6 +58,10 @@ typedef avs_error_t avs_persistence_handler_custom_allocated_tree_element_t(
 
 typedef void avs_persistence_cleanup_collection_element_t(void *element);
 
+typedef avs_error_t
+avs_persistence_handler_record_t(avs_persistence_context_t *ctx,
+                                 void *user_data);
+
 /**
  * Creates an initialized persistence context so that each underlying operation
  * writes passed value to the stream.
@@ -463,6 +468,232 @@ avs_error_t avs_persistence_version(avs_persistence_context_t *ctx,
                                     const uint8_t *supported_versions,
                                     size_t supported_versions_count);
 
+/**
+ * Types of structure fields that may be described by
+ * @ref avs_persistence_field_t. Each type is persisted in exactly the same
+ * format as by the corresponding function, e.g. @ref avs_persistence_u32 for
+ * @ref AVS_PERSISTENCE_FIELD_U32.
+ */
+typedef enum {
+    AVS_PERSISTENCE_FIELD_BOOL,   /**< <c>bool</c> */
+    AVS_PERSISTENCE_FIELD_U8,     /**< <c>uint8_t</c> */
+    AVS_PERSISTENCE_FIELD_U16,    /**< <c>uint16_t</c> */
+    AVS_PERSISTENCE_FIELD_U32,    /**< <c>uint32_t</c> */
+    AVS_PERSISTENCE_FIELD_U64,    /**< <c>uint64_t</c> */
+    AVS_PERSISTENCE_FIELD_I8,     /**< <c>int8_t</c> */
+    AVS_PERSISTENCE_FIELD_I16,    /**< <c>int16_t</c> */
+    AVS_PERSISTENCE_FIELD_I32,    /**< <c>int32_t</c> */
+    AVS_PERSISTENCE_FIELD_I64,    /**< <c>int64_t</c> */
+    AVS_PERSISTENCE_FIELD_FLOAT,  /**< <c>float</c> */
+    AVS_PERSISTENCE_FIELD_DOUBLE, /**< <c>double</c> */
+    /** Fixed-size array of any type, persisted as raw bytes, as by
+     * @ref avs_persistence_bytes. */
+    AVS_PERSISTENCE_FIELD_BYTES,
+    /** Heap-allocated <c>char *</c>, as by @ref avs_persistence_string. */
+    AVS_PERSISTENCE_FIELD_STRING
+} avs_persistence_field_type_t;
+
+/**
+ * Descriptor of a single structure field, for use with
+ * @ref avs_persistence_fields. It is recommended to initialize it using the
+ * @ref AVS_PERSISTENCE_FIELD macro.
+ */
+typedef struct {
+    /** Type of the field. */
+    avs_persistence_field_type_t type;
+    /** Offset of the field within the structure. */
+    size_t offset;
+    /** Size of the field, in bytes. */
+    size_t size;
+    /** First format version in which the field is present. */
+    uint8_t since_version;
+} avs_persistence_field_t;
+
+/**
+ * Initializer of @ref avs_persistence_field_t describing the field @p Field of
+ * structure type @p Struct.
+ *
+ * @param Type         Field type, without the <c>AVS_PERSISTENCE_FIELD_</c>
+ *                     prefix, e.g. <c>U32</c>.
+ * @param Struct       Type of the structure that contains the field.
+ * @param Field        Name of the field.
+ * @param SinceVersion First format version in which the field is present.
+ */
+#define AVS_PERSISTENCE_FIELD(Type, Struct, Field, SinceVersion) \
+    {                                                            \
+        AVS_PERSISTENCE_FIELD_##Type, offsetof(Struct, Field),   \
+                sizeof(((Struct *) 0)->Field), (SinceVersion)    \
+    }
+
+/**
+ * Persists or restores (depending on the @p ctx) fields of a structure, as
+ * described by the @p fields array.
+ *
+ * Fields are processed in the order of the array; fields for which
+ * <c>since_version</c> is greater than @p version are skipped, and thus left
+ * intact on restore operation. The resulting format is byte-for-byte identical
+ * to calling the functions corresponding to each field's type in the same
+ * order, i.e. data written using descriptors may be read by hand-written code
+ * and vice versa. Consecutive fixed-width fields are transferred using a single
+ * stream operation.
+ *
+ * Like with @ref avs_persistence_string, all <c>STRING</c> fields are required
+ * to be NULL before restore operation.
+ *
+ * @param ctx         Context that determines the actual operation.
+ * @param object      Pointer to the structure to persist or restore.
+ * @param fields      Array of field descriptors.
+ * @param field_count Number of elements in the @p fields array.
+ * @param version     Format version of the data.
+ *
+ * @returns @ref AVS_OK for success, or an error condition for which the
+ *          operation failed. <c>avs_errno(AVS_EINVAL)</c> is returned, without
+ *          any data being processed, if the size of any field does not match
+ *          its type.
+ */
+avs_error_t avs_persistence_fields(avs_persistence_context_t *ctx,
+                                   void *object,
+                                   const avs_persistence_field_t *fields,
+                                   size_t field_count,
+                                   uint8_t version);
+
+/**
+ * Persists or restores (depending on the @p ctx) a format version number
+ * followed by fields of a structure, as described by the @p fields array.
+ *
+ * On persist operation, @p current_version is stored, followed by all fields
+ * with <c>since_version</c> not greater than it. On restore operation, any
+ * version number not greater than @p current_version is accepted, and only the
+ * fields present in that version are restored, so that data persisted by older
+ * versions of the code can be restored without any explicit handling; fields
+ * added later keep their previous values. See @ref avs_persistence_fields for
+ * details.
+ *
+ * @param ctx             Context that determines the actual operation.
+ * @param object          Pointer to the structure to persist or restore.
+ * @param fields          Array of field descriptors.
+ * @param field_count     Number of elements in the @p fields array.
+ * @param current_version Newest format version, used for persist operation.
+ *
+ * @returns @ref AVS_OK for success, or an error condition for which the
+ *          operation failed. <c>avs_errno(AVS_EBADMSG)</c> is returned if the
+ *          restored version number is greater than @p current_version.
+ */
+avs_error_t
+avs_persistence_versioned_fields(avs_persistence_context_t *ctx,
+                                 void *object,
+                                 const avs_persistence_field_t *fields,
+                                 size_t field_count,
+                                 uint8_t current_version);
+
+/**
+ * Persists or restores (depending on the @p ctx) a single record, framed with
+ * its length and CRC32C checksums, using @p handler to operate on the record's
+ * contents.
+ *
+ * The record is represented as:
+ * - length of the contents (32-bit big-endian),
+ * - CRC32C of the contents (32-bit big-endian),
+ * - CRC32C of the two fields above (32-bit big-endian),
+ * - the contents, as persisted by @p handler.
+ *
+ * On persist operation, @p handler is called with a context that writes into
+ * a temporary in-memory buffer, so that the length is known before anything is
+ * written to the underlying stream.
+ *
+ * On restore operation, the whole record is read into memory and validated
+ * before @p handler is called, so that it never operates on corrupted data.
+ * @p handler is required to restore the entire contents. If the record is
+ * truncated or any of the checksums does not match, the function logs the
+ * reason along with the offset of the record in the underlying stream (if the
+ * stream supports @ref avs_stream_offset) and fails with
+ * <c>avs_errno(AVS_EBADMSG)</c>. If the stream ends exactly before the record,
+ * @ref AVS_EOF is returned instead, so that sequences of records can be
+ * restored until the end of the stream.
+ *
+ * Framing each top-level record allows detecting the exact record at which
+ * corruption begins, and restoring all the records that precede it.
+ *
+ * @param ctx       Context that determines the actual operation.
+ * @param handler   Function that persists or restores the record's contents
+ *                  using the context passed to it.
+ * @param user_data Opaque pointer passed to @p handler.
+ *
+ * @returns @ref AVS_OK for success, or an error condition for which the
+ *          operation failed.
+ */
+avs_error_t
+avs_persistence_framed_record(avs_persistence_context_t *ctx,
+                              avs_persistence_handler_record_t *handler,
+                              void *user_data);
+
+#ifdef AVS_COMMONS_PERSISTENCE_WITH_SNAPSHOTS
+/**
+ * Atomically replaces the contents of the file at @p path with data persisted
+ * by @p handler.
+ *
+ * The data is first written to a temporary file named by appending
+ * <c>.tmp</c> to @p path, which is then flushed to persistent storage using
+ * <c>fsync()</c> and renamed to @p path. The containing directory is also
+ * synchronized, so that after a successful return, the new snapshot survives
+ * power loss. If the process dies at any point, the file at @p path contains
+ * either the previous or the new snapshot in its entirety.
+ *
+ * Each snapshot starts with a framed header (see
+ * @ref avs_persistence_framed_record) containing a generation counter, which
+ * is one more than the counter of the snapshot being replaced, or 1 if there
+ * was no previous snapshot. The counter never decreases: a temporary file left
+ * by an interrupted store is also taken into account, and if the header of the
+ * existing snapshot is corrupted and no valid temporary file exists, the store
+ * fails without modifying the file. In that case, the file needs to be removed
+ * to start over. The data persisted by @p handler follows the header as is;
+ * use @ref avs_persistence_framed_record inside @p handler to also protect it
+ * with checksums.
+ *
+ * This function is only available if avs_commons is compiled with
+ * <c>AVS_COMMONS_PERSISTENCE_WITH_SNAPSHOTS</c>.
+ *
+ * @param path           Path of the snapshot file.
+ * @param handler        Function that persists the data, called with a persist
+ *                       context.
+ * @param user_data      Opaque pointer passed to @p handler.
+ * @param out_generation If not NULL, set to the generation counter of the newly
+ *                       written snapshot on success.
+ *
+ * @returns @ref AVS_OK for success, or an error condition for which the
+ *          operation failed. <c>avs_errno(AVS_EBADMSG)</c> is returned if the
+ *          generation counter of the previous snapshot cannot be read. On
+ *          failure, the previous snapshot is left intact, and if the temporary
+ *          file has been written, it is removed.
+ */
+avs_error_t
+avs_persistence_snapshot_store(const char *path,
+                               avs_persistence_handler_record_t *handler,
+                               void *user_data,
+                               uint64_t *out_generation);
+
+/**
+ * Restores data from a snapshot file written by
+ * @ref avs_persistence_snapshot_store.
+ *
+ * @param path           Path of the snapshot file.
+ * @param handler        Function that restores the data, called with a restore
+ *                       context.
+ * @param user_data      Opaque pointer passed to @p handler.
+ * @param out_generation If not NULL, set to the generation counter of the
+ *                       snapshot after its header has been validated.
+ *
+ * @returns @ref AVS_OK for success, or an error condition for which the
+ *          operation failed. <c>avs_errno(AVS_EBADMSG)</c> is returned if the
+ *          header is corrupted.
+ */
+avs_error_t
+avs_persistence_snapshot_restore(const char *path,
+                                 avs_persistence_handler_record_t *handler,
+                                 void *user_data,
+                                 uint64_t *out_generation);
+#endif // AVS_COMMONS_PERSISTENCE_WITH_SNAPSHOTS
+
 #ifdef __cplusplus
 }
 #endif
@@ -57,6 +57,24 @@ typedef int avs_rbtree_element_comparator_t(const void *a, const void *b);
 /** RB element type alias. */
 #define AVS_RBTREE_ELEM(type) type *
 
+/**
+ * Internal layout of the RB-tree node header, as described in
+ * @ref AVS_RBTREE_ELEM_NEW_BUFFER. It is exposed only so that
+ * <c>avs_rbtree_cxx.hpp</c> can perform lookups without calling the
+ * comparator through a function pointer. Do not use it directly.
+ */
+typedef struct {
+    int color;
+    void *parent;
+    /* left and right child, so that they can be selected without branching */
+    void *children[2];
+} avs_rbtree_node_links__;
+
+typedef struct {
+    avs_rbtree_node_links__ links;
+    avs_max_align_t value;
+} avs_rbtree_node_space__;
+
 /* Internal functions. Use macros defined above instead. */
 AVS_RBTREE(void) avs_rbtree_new__(avs_rbtree_element_comparator_t *cmp);
 void avs_rbtree_delete__(AVS_RBTREE(void) *tree);
@@ -74,6 +92,10 @@ AVS_RBTREE_ELEM(void) avs_rbtree_attach__(AVS_RBTREE(void) tree,
                                           AVS_RBTREE_ELEM(void) node);
 AVS_RBTREE_ELEM(void) avs_rbtree_detach__(AVS_RBTREE(void) tree,
                                           AVS_RBTREE_ELEM(void) node);
+void avs_rbtree_attach_at__(AVS_RBTREE(void) tree,
+                            AVS_RBTREE_ELEM(void) parent,
+                            AVS_RBTREE_ELEM(void) *dst,
+                            AVS_RBTREE_ELEM(void) node);
 
 AVS_RBTREE_ELEM(void) avs_rbtree_first__(AVS_RBTREE(void) tree);
 AVS_RBTREE_ELEM(void) avs_rbtree_last__(AVS_RBTREE(void) tree);
@@ -87,6 +109,15 @@ AVS_RBTREE_ELEM(void) avs_rbtree_elem_prev__(AVS_RBTREE_ELEM(void) elem);
 AVS_RBTREE_ELEM(void) avs_rbtree_cleanup_first__(AVS_RBTREE(void) tree);
 AVS_RBTREE_ELEM(void) avs_rbtree_cleanup_next__(AVS_RBTREE(void) tree);
 
+void avs_rbtree_split__(AVS_RBTREE(void) tree,
+                        const void *value,
+                        AVS_RBTREE(void) dst);
+int avs_rbtree_join__(AVS_RBTREE(void) dst, AVS_RBTREE(void) src);
+size_t avs_rbtree_erase_range__(AVS_RBTREE(void) tree,
+                                const void *begin,
+                                const void *end);
+size_t avs_rbtree_merge__(AVS_RBTREE(void) dst, AVS_RBTREE(void) src);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
@@ -525,6 +556,102 @@ static inline AVS_RBTREE(T) avs_rbtree_simple_clone_impl__(AVS_RBTREE_CONST(T)
 #define AVS_RBTREE_LAST(tree) \
     AVS_RBTREE_CALL_WITH_ELEM_CAST__(avs_rbtree_last__, (tree))
 
+/**
+ * Moves all elements of @p tree that are greater or equal to @p val_ptr into
+ * @p dst_tree. Elements are relinked, not reallocated.
+ *
+ * Complexity: O((log n) * c + min(k, n - k)), where:
+ * - n - number of nodes in @p tree,
+ * - k - number of nodes moved to @p dst_tree,
+ * - c - complexity of tree element comparator.
+ *
+ * NOTE: the min(k, n - k) term comes from recalculating sizes of both trees.
+ *
+ * @param tree     Tree to split.
+ * @param val_ptr  Pointer to a node value to split at.
+ *                 NOTE: this does not need to be an AVS_RBTREE_ELEM object.
+ * @param dst_tree Tree to move elements into. It MUST be empty and use the same
+ *                 ordering as @p tree.
+ */
+#define AVS_RBTREE_SPLIT(tree, val_ptr, dst_tree)             \
+    (_AVS_RB_TYPECHECK(*(tree), (val_ptr)),                   \
+     _AVS_RB_TYPECHECK(*(tree), *(dst_tree)),                 \
+     avs_rbtree_split__((AVS_RBTREE(void)) (tree), (val_ptr), \
+                        (AVS_RBTREE(void)) (dst_tree)))
+
+/**
+ * Moves all elements of @p src_tree to the end of @p dst_tree, leaving
+ * @p src_tree empty. Elements are relinked, not reallocated.
+ *
+ * All elements of @p src_tree MUST be strictly greater than all elements of
+ * @p dst_tree. This is verified using a single comparator call.
+ *
+ * Complexity: O((log n) + c), where:
+ * - n - total number of nodes in both trees,
+ * - c - complexity of tree element comparator.
+ *
+ * @param dst_tree Tree to append elements to.
+ * @param src_tree Tree to take elements from. It MUST use the same ordering as
+ *                 @p dst_tree.
+ *
+ * @returns 0 on success, or a negative value if the elements of @p src_tree
+ *          are not strictly greater than elements of @p dst_tree. In the latter
+ *          case, neither tree is modified.
+ */
+#define AVS_RBTREE_JOIN(dst_tree, src_tree)           \
+    (_AVS_RB_TYPECHECK(*(dst_tree), *(src_tree)),     \
+     avs_rbtree_join__((AVS_RBTREE(void)) (dst_tree), \
+                       (AVS_RBTREE(void)) (src_tree)))
+
+/**
+ * Removes and releases all elements of @p tree that are greater or equal to
+ * @p begin_ptr and strictly less than @p end_ptr.
+ *
+ * Complexity: O((log n) * c + k * f), where:
+ * - n - number of nodes in @p tree,
+ * - k - number of removed nodes,
+ * - c - complexity of tree element comparator,
+ * - f - avs_free() complexity.
+ *
+ * NOTE: If the elements require additional cleanup, use
+ * @ref AVS_RBTREE_SPLIT to move them into a separate tree, and release it using
+ * @ref AVS_RBTREE_DELETE instead.
+ *
+ * @param tree      Tree to remove elements from.
+ * @param begin_ptr Pointer to a value of the lower (inclusive) bound.
+ *                  NOTE: this does not need to be an AVS_RBTREE_ELEM object.
+ * @param end_ptr   Pointer to a value of the upper (exclusive) bound.
+ *                  NOTE: this does not need to be an AVS_RBTREE_ELEM object.
+ *
+ * @returns Number of removed elements.
+ */
+#define AVS_RBTREE_ERASE_RANGE(tree, begin_ptr, end_ptr) \
+    (_AVS_RB_TYPECHECK(*(tree), (begin_ptr)),            \
+     _AVS_RB_TYPECHECK(*(tree), (end_ptr)),              \
+     avs_rbtree_erase_range__((AVS_RBTREE(void)) (tree), \
+                              (begin_ptr), (end_ptr)))
+
+/**
+ * Moves all elements of @p src_tree that do not have an equivalent element in
+ * @p dst_tree into @p dst_tree. Elements are relinked, not reallocated.
+ * Elements that already had an equivalent in @p dst_tree are left in
+ * @p src_tree.
+ *
+ * Complexity: O((m log(n/m + 1)) * c), where:
+ * - m, n - number of nodes in the smaller and the larger tree, respectively,
+ * - c - complexity of tree element comparator.
+ *
+ * @param dst_tree Tree to move elements into.
+ * @param src_tree Tree to take elements from. It MUST use the same ordering as
+ *                 @p dst_tree.
+ *
+ * @returns Number of elements moved from @p src_tree into @p dst_tree.
+ */
+#define AVS_RBTREE_MERGE(dst_tree, src_tree)           \
+    (_AVS_RB_TYPECHECK(*(dst_tree), *(src_tree)),      \
+     avs_rbtree_merge__((AVS_RBTREE(void)) (dst_tree), \
+                        (AVS_RBTREE(void)) (src_tree)))
+
 /** Convenience macro for forward iteration on elements of @p tree. */
 #define AVS_RBTREE_FOREACH(it, tree)                                      \
     for (_AVS_RB_TYPECHECK(*(tree), (it)), (it) = AVS_RBTREE_FIRST(tree); \
@@ -0,0 +1,498 @@
+/*
+ * Copyright 2021 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AVS_COMMONS_RBTREE_CXX_H
+#define AVS_COMMONS_RBTREE_CXX_H
+
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <new>
+#include <utility>
+
+#include <avsystem/commons/avs_rbtree.h>
+
+/**
+ * @file avs_rbtree_cxx.hpp
+ *
+ * A C++ wrapper over @ref AVS_RBTREE macros.
+ *
+ * Lookups and insertions performed through @ref avs::RbTree walk the tree
+ * directly, with the comparison functor inlined, instead of calling
+ * @ref avs_rbtree_element_comparator_t through a function pointer for every
+ * visited node. The underlying object is still a regular @ref AVS_RBTREE, so
+ * it can be passed to C code (e.g. <c>avs_persistence_rbtree()</c>) using
+ * @ref avs::RbTree::get.
+ *
+ * <example>
+ * @code
+ * #include <stdio.h>
+ * #include <avsystem/commons/avs_rbtree_cxx.hpp>
+ *
+ * int main() {
+ *     avs::RbTree<int> tree;
+ *     for (int i = 10; i > 0; --i) {
+ *         tree.insert(i);
+ *     }
+ *     for (avs::RbTree<int>::iterator it = tree.begin(); it != tree.end();
+ *          ++it) {
+ *         printf("%d\n", *it);
+ *     }
+ * }
+ * @endcode
+ *
+ * Another starting point for examples might be the testing code
+ * (<c>test_rbtree_cxx.cpp</c>).
+ * </example>
+ */
+
+namespace avs {
+
+namespace detail {
+
+inline avs_rbtree_node_links__ *rbtree_links(const void *elem) {
+    return reinterpret_cast<avs_rbtree_node_links__ *>(
+            const_cast<char *>(static_cast<const char *>(elem))
+            - offsetof(avs_rbtree_node_space__, value));
+}
+
+/**
+ * C-compatible comparator that makes the underlying tree usable from C code.
+ * Since it has no access to any context, @p Compare MUST be stateless.
+ */
+template <typename T, typename Compare>
+int rbtree_compare(const void *a_, const void *b_) {
+    const T &a = *static_cast<const T *>(a_);
+    const T &b = *static_cast<const T *>(b_);
+    Compare cmp;
+    if (cmp(a, b)) {
+        return -1;
+    } else if (cmp(b, a)) {
+        return 1;
+    }
+    return 0;
+}
+
+} // namespace detail
+
+template <typename T, typename Compare>
+class RbTree;
+
+/** Bidirectional iterator over elements of @ref avs::RbTree */
+template <typename T>
+class RbTreeIterator {
+    template <typename U, typename Compare>
+    friend class RbTree;
+    template <typename U>
+    friend class RbTreeIterator;
+
+    void **tree_;
+    T *elem_;
+
+    RbTreeIterator(void **tree, T *elem) : tree_(tree), elem_(elem) {}
+
+public:
+    typedef T value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef T &reference;
+    typedef T *pointer;
+    typedef std::bidirectional_iterator_tag iterator_category;
+
+    RbTreeIterator() : tree_(NULL), elem_(NULL) {}
+
+    template <typename U>
+    RbTreeIterator(const RbTreeIterator<U> &other)
+            : tree_(other.tree_), elem_(other.elem_) {}
+
+    T &operator*() const {
+        return *elem_;
+    }
+
+    T *operator->() const {
+        return elem_;
+    }
+
+    RbTreeIterator<T> &operator++() {
+        elem_ = static_cast<T *>(avs_rbtree_elem_next__(
+                const_cast<void *>(static_cast<const void *>(elem_))));
+        return *this;
+    }
+
+    RbTreeIterator<T> operator++(int) {
+        RbTreeIterator<T> copy = *this;
+        ++*this;
+        return copy;
+    }
+
+    RbTreeIterator<T> &operator--() {
+        if (elem_) {
+            elem_ = static_cast<T *>(avs_rbtree_elem_prev__(
+                    const_cast<void *>(static_cast<const void *>(elem_))));
+        } else if (tree_) {
+            elem_ = static_cast<T *>(avs_rbtree_last__(tree_));
+        }
+        return *this;
+    }
+
+    RbTreeIterator<T> operator--(int) {
+        RbTreeIterator<T> copy = *this;
+        --*this;
+        return copy;
+    }
+
+    bool operator==(const RbTreeIterator<T> &other) const {
+        return elem_ == other.elem_;
+    }
+
+    bool operator!=(const RbTreeIterator<T> &other) const {
+        return !(*this == other);
+    }
+};
+
+/**
+ * Self-owning ordered set based on @ref AVS_RBTREE.
+ *
+ * @p Compare is a strict weak ordering functor, like the one used by
+ * <c>std::set</c>. It MUST be stateless and default-constructible, as it is
+ * also used to generate the C comparator of the underlying tree.
+ *
+ * Elements are constructed in place in tree nodes and are never moved or
+ * copied afterwards, so move-only and non-movable types are supported.
+ *
+ * Allocation failures are not reported with exceptions. Operations that
+ * allocate memory return <c>end()</c> or <c>false</c> instead.
+ */
+template <typename T, typename Compare = std::less<T> >
+class RbTree {
+    AVS_RBTREE(T) tree_;
+    Compare cmp_;
+
+    RbTree(const RbTree &);
+    RbTree &operator=(const RbTree &);
+
+    static void **child_slot(const T *elem, bool right) {
+        return &detail::rbtree_links(elem)->children[right];
+    }
+
+    void **raw() const {
+        return reinterpret_cast<void **>(tree_);
+    }
+
+    T *root() const {
+        return tree_ ? *tree_ : NULL;
+    }
+
+    bool ensure_tree() {
+        if (!tree_) {
+            avs_rbtree_element_comparator_t *cmp =
+                    &detail::rbtree_compare<T, Compare>;
+            tree_ = AVS_RBTREE_NEW(T, cmp);
+        }
+        return tree_ != NULL;
+    }
+
+    /*
+     * The lookups below descend with a single comparison per level and pick
+     * the child by indexing instead of branching, as the direction is
+     * effectively random and would be mispredicted about half of the time.
+     * Equivalence is checked once, against the last node not less than the
+     * searched value.
+     */
+
+    /**
+     * Finds a place to attach a node equivalent to @p value. Returns the
+     * equivalent element if one already exists.
+     */
+    T *find_insert_position(const T &value,
+                            void **out_parent,
+                            void ***out_dst) {
+        void *parent = NULL;
+        void **dst = raw();
+        T *candidate = NULL;
+        while (*dst) {
+            T *elem = static_cast<T *>(*dst);
+            const bool less = cmp_(*elem, value);
+            candidate = less ? candidate : elem;
+            parent = elem;
+            dst = child_slot(elem, less);
+        }
+        if (candidate && !cmp_(value, *candidate)) {
+            return candidate;
+        }
+        *out_parent = parent;
+        *out_dst = dst;
+        return NULL;
+    }
+
+    T *find_elem(const T &value) const {
+        T *result = lower_bound_elem(value);
+        return result && !cmp_(value, *result) ? result : NULL;
+    }
+
+    T *lower_bound_elem(const T &value) const {
+        T *curr = root();
+        T *result = NULL;
+        while (curr) {
+            const bool less = cmp_(*curr, value);
+            result = less ? result : curr;
+            curr = static_cast<T *>(*child_slot(curr, less));
+        }
+        return result;
+    }
+
+    T *upper_bound_elem(const T &value) const {
+        T *curr = root();
+        T *result = NULL;
+        while (curr) {
+            const bool greater = cmp_(value, *curr);
+            result = greater ? curr : result;
+            curr = static_cast<T *>(*child_slot(curr, !greater));
+        }
+        return result;
+    }
+
+    std::pair<RbTreeIterator<T>, bool> attach(void *parent,
+                                              void **dst,
+                                              T *node) {
+        avs_rbtree_attach_at__(raw(), parent, dst, node);
+        return std::make_pair(iterator(raw(), node), true);
+    }
+
+public:
+    typedef T value_type;
+    typedef T key_type;
+    typedef Compare key_compare;
+    typedef std::size_t size_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef T &reference;
+    typedef const T &const_reference;
+    typedef T *pointer;
+    typedef const T *const_pointer;
+    typedef RbTreeIterator<T> iterator;
+    typedef RbTreeIterator<const T> const_iterator;
+
+    RbTree() : tree_(NULL), cmp_() {}
+
+    /**
+     * Takes ownership of a tree created with @ref AVS_RBTREE_NEW. Elements of
+     * @p tree MUST be ordered consistently with @p Compare.
+     */
+    explicit RbTree(AVS_RBTREE(T) tree) : tree_(tree), cmp_() {}
+
+#if __cplusplus >= 201103L
+    RbTree(RbTree &&other) : tree_(other.tree_), cmp_() {
+        other.tree_ = NULL;
+    }
+
+    RbTree &operator=(RbTree &&other) {
+        if (this != &other) {
+            clear();
+            AVS_RBTREE_DELETE(&tree_);
+            tree_ = other.tree_;
+            other.tree_ = NULL;
+        }
+        return *this;
+    }
+#endif
+
+    ~RbTree() {
+        clear();
+        AVS_RBTREE_DELETE(&tree_);
+    }
+
+    /**
+     * Returns the underlying @ref AVS_RBTREE object, or NULL if nothing has
+     * been inserted yet. The ownership is retained.
+     */
+    AVS_RBTREE(T) get() const {
+        return tree_;
+    }
+
+    /** Releases the ownership of the underlying @ref AVS_RBTREE object. */
+    AVS_RBTREE(T) release() {
+        AVS_RBTREE(T) result = tree_;
+        tree_ = NULL;
+        return result;
+    }
+
+    bool empty() const {
+        return !root();
+    }
+
+    size_type size() const {
+        return tree_ ? AVS_RBTREE_SIZE(tree_) : 0;
+    }
+
+    iterator begin() {
+        return iterator(raw(), tree_ ? AVS_RBTREE_FIRST(tree_) : NULL);
+    }
+
+    const_iterator begin() const {
+        return const_iterator(raw(), tree_ ? AVS_RBTREE_FIRST(tree_) : NULL);
+    }
+
+    const_iterator cbegin() const {
+        return begin();
+    }
+
+    iterator end() {
+        return iterator(raw(), NULL);
+    }
+
+    const_iterator end() const {
+        return const_iterator(raw(), NULL);
+    }
+
+    const_iterator cend() const {
+        return end();
+    }
+
+    iterator find(const T &value) {
+        return iterator(raw(), find_elem(value));
+    }
+
+    const_iterator find(const T &value) const {
+        return const_iterator(raw(), find_elem(value));
+    }
+
+    /** Finds the first element that is not less than @p value. */
+    iterator lower_bound(const T &value) {
+        return iterator(raw(), lower_bound_elem(value));
+    }
+
+    const_iterator lower_bound(const T &value) const {
+        return const_iterator(raw(), lower_bound_elem(value));
+    }
+
+    /** Finds the first element that is greater than @p value. */
+    iterator upper_bound(const T &value) {
+        return iterator(raw(), upper_bound_elem(value));
+    }
+
+    const_iterator upper_bound(const T &value) const {
+        return const_iterator(raw(), upper_bound_elem(value));
+    }
+
+    size_type count(const T &value) const {
+        return find_elem(value) ? 1 : 0;
+    }
+
+    /**
+     * Inserts a copy of @p value, unless an equivalent element already exists.
+     *
+     * @returns Iterator to the inserted or already existing element, and a flag
+     *          that is true if the insertion took place. If memory allocation
+     *          failed, <c>(end(), false)</c> is returned.
+     */
+    std::pair<iterator, bool> insert(const T &value) {
+        void *parent = NULL;
+        void **dst = NULL;
+        T *existing;
+        if (!ensure_tree()) {
+            return std::make_pair(end(), false);
+        }
+        if ((existing = find_insert_position(value, &parent, &dst))) {
+            return std::make_pair(iterator(raw(), existing), false);
+        }
+        T *node = AVS_RBTREE_ELEM_NEW(T);
+        if (!node) {
+            return std::make_pair(end(), false);
+        }
+        new (node) T(value);
+        return attach(parent, dst, node);
+    }
+
+#if __cplusplus >= 201103L
+    /** Same as the copying variant, but moves @p value into the tree. */
+    std::pair<iterator, bool> insert(T &&value) {
+        void *parent = NULL;
+        void **dst = NULL;
+        T *existing;
+        if (!ensure_tree()) {
+            return std::make_pair(end(), false);
+        }
+        if ((existing = find_insert_position(value, &parent, &dst))) {
+            return std::make_pair(iterator(raw(), existing), false);
+        }
+        T *node = AVS_RBTREE_ELEM_NEW(T);
+        if (!node) {
+            return std::make_pair(end(), false);
+        }
+        new (node) T(std::move(value));
+        return attach(parent, dst, node);
+    }
+
+    /**
+     * Constructs an element in place. The node is allocated and constructed
+     * before looking for an equivalent element, and destroyed if one is found.
+     */
+    template <typename... Args>
+    std::pair<iterator, bool> emplace(Args &&... args) {
+        void *parent = NULL;
+        void **dst = NULL;
+        T *existing;
+        if (!ensure_tree()) {
+            return std::make_pair(end(), false);
+        }
+        T *node = AVS_RBTREE_ELEM_NEW(T);
+        if (!node) {
+            return std::make_pair(end(), false);
+        }
+        new (node) T(std::forward<Args>(args)...);
+        if ((existing = find_insert_position(*node, &parent, &dst))) {
+            node->~T();
+            AVS_RBTREE_ELEM_DELETE_DETACHED(&node);
+            return std::make_pair(iterator(raw(), existing), false);
+        }
+        return attach(parent, dst, node);
+    }
+#endif
+
+    /**
+     * Removes and destroys the element pointed to by @p it.
+     *
+     * @returns Iterator to the element following the removed one.
+     */
+    iterator erase(iterator it) {
+        iterator next = it;
+        ++next;
+        T *elem = static_cast<T *>(AVS_RBTREE_DETACH(tree_, it.elem_));
+        elem->~T();
+        AVS_RBTREE_ELEM_DELETE_DETACHED(&elem);
+        return next;
+    }
+
+    size_type erase(const T &value) {
+        iterator it = find(value);
+        if (it == end()) {
+            return 0;
+        }
+        erase(it);
+        return 1;
+    }
+
+    void clear() {
+        if (tree_) {
+            AVS_RBTREE_CLEAR(tree_) {
+                (*tree_)->~T();
+            }
+        }
+    }
+};
+
+} // namespace avs
+
+#endif /* AVS_COMMONS_RBTREE_CXX_H */
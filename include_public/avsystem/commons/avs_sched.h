@@ -205,6 +205,54 @@ static inline int avs_sched_wait_for_next(avs_sched_t *sched,
             sched, avs_time_monotonic_add(avs_time_monotonic_now(), timeout));
 }
 
+#ifdef AVS_COMMONS_SCHED_WITH_POLLABLE_FD
+/**
+ * Retrieves a file descriptor that allows integrating the scheduler with an
+ * external event loop based on <c>poll()</c>, <c>epoll</c> or similar, without
+ * a dedicated scheduler thread.
+ *
+ * The descriptor is created on the first call, and is owned by the scheduler -
+ * it MUST NOT be read from or closed by the caller, and is valid until
+ * @ref avs_sched_cleanup. It becomes readable for input:
+ *
+ * - when the earliest scheduled job is due, if timerfd is available (Linux);
+ * - when the time of the earliest scheduled job changes, otherwise (a pipe is
+ *   used in that case).
+ *
+ * Subsequent calls to @ref avs_sched_run make it non-readable again, until one
+ * of the above conditions recurs. As the time of the next job is not signalled
+ * if a pipe is used, the event loop shall always limit its waiting time using
+ * @ref avs_sched_time_to_next, e.g.:
+ *
+ * @code
+ * struct pollfd fds[2] = {
+ *     { .fd = avs_sched_get_pollable_fd(sched), .events = POLLIN },
+ *     { .fd = *(const int *) avs_net_socket_get_system(socket),
+ *       .events = POLLIN }
+ * };
+ * while (running) {
+ *     int64_t timeout_ms = -1;
+ *     avs_time_duration_to_scalar(&timeout_ms, AVS_TIME_MS,
+ *                                 avs_sched_time_to_next(sched));
+ *     if (poll(fds, 2, (int) AVS_MIN(timeout_ms, INT_MAX)) > 0
+ *             && (fds[1].revents & POLLIN)) {
+ *         handle_socket(socket);
+ *     }
+ *     avs_sched_run(sched);
+ * }
+ * @endcode
+ *
+ * This works regardless of whether the scheduler has been compiled with thread
+ * safety enabled; if it has, jobs scheduled from other threads wake up the
+ * event loop as well.
+ *
+ * @param sched Scheduler object to access.
+ *
+ * @returns The file descriptor, or a negative value in case of error.
+ */
+int avs_sched_get_pollable_fd(avs_sched_t *sched);
+#endif // AVS_COMMONS_SCHED_WITH_POLLABLE_FD
+
 /**
  * Executes jobs scheduled for execution before or at the current point in time.
  *
@@ -445,6 +493,335 @@ void avs_sched_detach(avs_sched_handle_t *handle_ptr);
  */
 int avs_sched_leap_time(avs_sched_t *sched, avs_time_duration_t diff);
 
+#ifdef AVS_COMMONS_SCHED_WITH_METRICS
+/**
+ * @name Scheduler metrics
+ *
+ * Available only if avs_commons is compiled with
+ * <c>AVS_COMMONS_SCHED_WITH_METRICS</c> (<c>WITH_SCHEDULER_METRICS</c> CMake
+ * option). When it is disabled, no additional work is performed by the
+ * scheduler.
+ */
+/**@{*/
+
+/**
+ * Number of linear sub-buckets into which each power-of-two range of
+ * @ref avs_sched_histogram_t is divided.
+ */
+#    define AVS_SCHED_HISTOGRAM_SUB_BUCKETS 4
+
+/**
+ * Number of buckets in @ref avs_sched_histogram_t. Covers durations from 0 up
+ * to 2^32 microseconds (over 71 minutes); longer durations are counted in the
+ * last bucket.
+ */
+#    define AVS_SCHED_HISTOGRAM_BUCKETS 124
+
+/**
+ * Log-linear histogram of durations, with microsecond resolution.
+ *
+ * Durations below @ref AVS_SCHED_HISTOGRAM_SUB_BUCKETS microseconds have a
+ * bucket each. Every range between consecutive powers of two above that is
+ * divided into @ref AVS_SCHED_HISTOGRAM_SUB_BUCKETS equal buckets, so the
+ * relative error of each bucket is at most 25%. Use
+ * @ref avs_sched_histogram_bucket_lower_bound to map bucket indices to
+ * durations.
+ */
+typedef struct {
+    /** Number of samples in each bucket. */
+    uint32_t buckets[AVS_SCHED_HISTOGRAM_BUCKETS];
+    /** Total number of samples. */
+    uint32_t count;
+    /** Sum of all samples. */
+    avs_time_duration_t total;
+    /** Largest sample. */
+    avs_time_duration_t max;
+} avs_sched_histogram_t;
+
+/**
+ * Snapshot of scheduler metrics, as returned by @ref avs_sched_metrics_get.
+ */
+typedef struct {
+    /**
+     * Histogram of differences between the time at which each job was actually
+     * started and the time at which it was scheduled.
+     */
+    avs_sched_histogram_t lateness;
+
+    /** Histogram of execution times of job callbacks. */
+    avs_sched_histogram_t execution_time;
+
+    /** Number of jobs executed. */
+    uint64_t jobs_executed;
+
+    /** Number of jobs currently scheduled. */
+    size_t queue_depth;
+
+    /** Largest number of jobs that were scheduled at the same time. */
+    size_t max_queue_depth;
+} avs_sched_metrics_t;
+
+/**
+ * Type of a function called after executing a job whose execution time
+ * exceeded the threshold set with @ref avs_sched_set_slow_job_handler.
+ *
+ * @param sched          Scheduler object on which the job has been executed.
+ *
+ * @param job_name       Stringified value of the callback function passed to
+ *                       @ref AVS_SCHED_AT, or <c>NULL</c> if
+ *                       <c>AVS_LOG_WITH_TRACE</c> was not defined at the
+ *                       scheduling site.
+ *
+ * @param clb            Callback function of the job.
+ *
+ * @param lateness       Difference between the time at which the job was
+ *                       started and the time at which it was scheduled.
+ *
+ * @param execution_time Time it took to execute the job's callback.
+ *
+ * @param arg            Opaque argument passed to
+ *                       @ref avs_sched_set_slow_job_handler.
+ */
+typedef void avs_sched_slow_job_handler_t(avs_sched_t *sched,
+                                          const char *job_name,
+                                          avs_sched_clb_t *clb,
+                                          avs_time_duration_t lateness,
+                                          avs_time_duration_t execution_time,
+                                          void *arg);
+
+/**
+ * Retrieves the lower bound of the range of durations counted in a given
+ * bucket of @ref avs_sched_histogram_t.
+ *
+ * @param index Bucket index, less than @ref AVS_SCHED_HISTOGRAM_BUCKETS.
+ *
+ * @returns Smallest duration that is counted in the bucket.
+ */
+avs_time_duration_t avs_sched_histogram_bucket_lower_bound(size_t index);
+
+/**
+ * Retrieves a consistent snapshot of metrics of a scheduler.
+ *
+ * The metrics are copied while holding the lock that protects the job queue
+ * (if thread safety is enabled), so this function may be called while another
+ * thread is executing @ref avs_sched_run. It does not wait for the currently
+ * executed job to finish.
+ *
+ * A job's measurements are added to the metrics in the same critical section in
+ * which @ref avs_sched_run fetches the next job, or notices that there are no
+ * more jobs due. Until then, e.g. when called from another job's callback, the
+ * metrics do not include it.
+ *
+ * @param sched       Scheduler object to access.
+ *
+ * @param out_metrics Structure to fill with the metrics.
+ */
+void avs_sched_metrics_get(avs_sched_t *sched,
+                           avs_sched_metrics_t *out_metrics);
+
+/**
+ * Resets the histograms and counters of a scheduler. The maximum queue depth is
+ * reset to the current queue depth.
+ *
+ * @param sched Scheduler object to access.
+ */
+void avs_sched_metrics_reset(avs_sched_t *sched);
+
+/**
+ * Sets a function that will be called after each job that took at least
+ * @p threshold to execute.
+ *
+ * The handler is called from the thread executing @ref avs_sched_run, after
+ * the job's callback returns, and without holding any scheduler locks, so it
+ * may schedule or cancel jobs. The settings are read before the job is
+ * started, so changing them from a job's callback only affects subsequent
+ * jobs.
+ *
+ * @param sched     Scheduler object to access.
+ *
+ * @param threshold Minimum execution time of a job that causes the handler to
+ *                  be called.
+ *
+ * @param handler   Function to call, or <c>NULL</c> to disable the watchdog.
+ *
+ * @param arg       Opaque argument that will be passed to @p handler.
+ */
+void avs_sched_set_slow_job_handler(avs_sched_t *sched,
+                                    avs_time_duration_t threshold,
+                                    avs_sched_slow_job_handler_t *handler,
+                                    void *arg);
+/**@}*/
+#endif // AVS_COMMONS_SCHED_WITH_METRICS
+
+#ifdef AVS_COMMONS_SCHED_WITH_GROUPS
+/**
+ * @name Scheduler groups
+ *
+ * Available only if avs_commons is compiled with
+ * <c>AVS_COMMONS_SCHED_WITH_GROUPS</c> (<c>WITH_SCHEDULER_GROUPS</c> CMake
+ * option), which requires thread safety to be enabled and POSIX threads to be
+ * available.
+ *
+ * A scheduler group owns a number of schedulers (shards), each of which is
+ * driven by its own thread. Jobs are distributed between the shards by an
+ * affinity key: all jobs scheduled with the same key are executed on the same
+ * shard, and thus in the same thread, in the order of their scheduled time.
+ *
+ * Each shard is an ordinary @ref avs_sched_t object, so all other scheduler
+ * functions may be used with it. In particular, @ref avs_sched_del,
+ * @ref avs_sched_detach, @ref avs_sched_time and @ref AVS_RESCHED_AT may be
+ * called with a handle to a job scheduled on any shard, from any thread.
+ * However, replacing a job through the <c>OutHandle</c> argument of
+ * @ref AVS_SCHED_AT is only supported if the new job is scheduled on the same
+ * shard, i.e. with the same affinity key.
+ */
+/**@{*/
+
+/**
+ * Object type of a scheduler group.
+ */
+typedef struct avs_sched_group_struct avs_sched_group_t;
+
+/**
+ * Configuration of a scheduler group, passed to @ref avs_sched_group_new.
+ */
+typedef struct {
+    /**
+     * Number of shards to create. If 0, the number of CPUs that the calling
+     * thread is allowed to run on is used.
+     */
+    size_t num_shards;
+
+    /**
+     * If true, the thread driving each shard will be pinned to a single CPU.
+     * Thread pinning is currently only supported on Linux.
+     */
+    bool pin_threads;
+
+    /**
+     * Array of @ref avs_sched_group_config_t.num_shards CPU numbers to pin the
+     * shard threads to, or NULL. If NULL and pinning is enabled, the thread for
+     * the i-th shard is pinned to the <c>(i % num_cpus)</c>-th CPU of those
+     * that the calling thread is allowed to run on (see
+     * <c>sched_getaffinity()</c>).
+     * Ignored if @ref avs_sched_group_config_t.pin_threads is false.
+     */
+    const unsigned *cpus;
+} avs_sched_group_config_t;
+
+/**
+ * Creates a new scheduler group and starts the threads that drive its shards.
+ *
+ * @param name   The name of the group. Shards will be named
+ *               <c>"<name>/<index>"</c> in log messages. If NULL,
+ *               <c>"(unknown)"</c> will be used instead.
+ *
+ * @param data   An opaque pointer that will be possible to retrieve from each
+ *               shard using @ref avs_sched_data .
+ *
+ * @param config Configuration of the group, or NULL to use the defaults (one
+ *               shard per online CPU, without pinning).
+ *
+ * @returns Created scheduler group object, or NULL if there is a fatal error
+ *          (not enough memory, failure to create or pin a thread).
+ */
+avs_sched_group_t *avs_sched_group_new(const char *name,
+                                       void *data,
+                                       const avs_sched_group_config_t *config);
+
+/**
+ * Stops the threads driving the shards of a scheduler group, and destroys all
+ * the shards as if with @ref avs_sched_cleanup .
+ *
+ * Jobs that are currently executing are allowed to finish. Jobs scheduled
+ * before or at current time are executed, and all other jobs are aborted.
+ *
+ * NOTE: This function shall not be called from within a job executed by any
+ * of the group's shards.
+ *
+ * @param group_ptr Pointer to a variable that holds the group to destroy. It
+ *                  will be reset to <c>NULL</c> afterwards.
+ */
+void avs_sched_group_cleanup(avs_sched_group_t **group_ptr);
+
+/**
+ * @param group Scheduler group object to access.
+ *
+ * @returns Number of shards in the group.
+ */
+size_t avs_sched_group_size(avs_sched_group_t *group);
+
+/**
+ * @param group Scheduler group object to access.
+ *
+ * @param index Index of the shard, less than @ref avs_sched_group_size.
+ *
+ * @returns Scheduler object of the specified shard.
+ */
+avs_sched_t *avs_sched_group_shard(avs_sched_group_t *group, size_t index);
+
+/**
+ * Maps an affinity key to a shard of the group.
+ *
+ * The keys are hashed, so any values (e.g. sequential identifiers or pointers
+ * converted to integers) are distributed evenly between the shards.
+ *
+ * @param group Scheduler group object to access.
+ *
+ * @param key   Affinity key.
+ *
+ * @returns Scheduler object of the shard responsible for @p key.
+ */
+avs_sched_t *avs_sched_group_shard_for_key(avs_sched_group_t *group,
+                                           uint64_t key);
+
+/**
+ * A variant of @ref AVS_SCHED_AT that schedules the job on a shard of a
+ * scheduler group, selected by the affinity key @p Key (<c>uint64_t</c>). See
+ * that macro's documentation for details.
+ */
+#    define AVS_SCHED_GROUP_AT(Group, Key, OutHandle, Instant, Clb, ClbData, \
+                               ClbDataSize)                                 \
+        AVS_SCHED_AT(avs_sched_group_shard_for_key((Group), (Key)),         \
+                     OutHandle, Instant, Clb, ClbData, ClbDataSize)
+
+/**
+ * A variant of @ref AVS_SCHED_DELAYED that schedules the job on a shard of a
+ * scheduler group, selected by the affinity key @p Key.
+ */
+#    define AVS_SCHED_GROUP_DELAYED(Group, Key, OutHandle, Delay, Clb, ClbData, \
+                                    ClbDataSize)                               \
+        AVS_SCHED_DELAYED(avs_sched_group_shard_for_key((Group), (Key)),       \
+                          OutHandle, Delay, Clb, ClbData, ClbDataSize)
+
+/**
+ * A variant of @ref AVS_SCHED_NOW that schedules the job on a shard of a
+ * scheduler group, selected by the affinity key @p Key.
+ */
+#    define AVS_SCHED_GROUP_NOW(Group, Key, OutHandle, Clb, ClbData, \
+                                ClbDataSize)                        \
+        AVS_SCHED_NOW(avs_sched_group_shard_for_key((Group), (Key)), \
+                      OutHandle, Clb, ClbData, ClbDataSize)
+
+#    ifdef AVS_COMMONS_SCHED_WITH_METRICS
+/**
+ * Retrieves metrics aggregated over all shards of a scheduler group.
+ *
+ * Histograms and counters are summed, and maximum values, including the
+ * maximum queue depth, are the maxima over all shards. Metrics of individual
+ * shards may be retrieved by calling @ref avs_sched_metrics_get on
+ * @ref avs_sched_group_shard.
+ *
+ * @param group       Scheduler group object to access.
+ *
+ * @param out_metrics Structure to fill with the metrics.
+ */
+void avs_sched_group_metrics_get(avs_sched_group_t *group,
+                                 avs_sched_metrics_t *out_metrics);
+#    endif // AVS_COMMONS_SCHED_WITH_METRICS
+/**@}*/
+#endif // AVS_COMMONS_SCHED_WITH_GROUPS
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,157 @@
+/*
+ * Copyright 2021 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AVS_COMMONS_STREAM_COMPRESSION_H
+#define AVS_COMMONS_STREAM_COMPRESSION_H
+
+#include <avsystem/commons/avs_stream.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file avs_stream_compression.h
+ *
+ * Stream decorators that transparently compress data written to, or
+ * decompress data read from, an underlying stream.
+ *
+ * Only available if <c>AVS_COMMONS_STREAM_WITH_ZLIB</c> or
+ * <c>AVS_COMMONS_STREAM_WITH_ZSTD</c> is enabled. Formats whose backend is not
+ * compiled in are rejected at creation time.
+ */
+
+typedef enum {
+    /** zlib format (RFC 1950), as used by the "deflate" HTTP content coding */
+    AVS_STREAM_COMPRESSION_ZLIB,
+    /** gzip format (RFC 1952) */
+    AVS_STREAM_COMPRESSION_GZIP,
+    /** Raw DEFLATE data (RFC 1951), without any header or checksum */
+    AVS_STREAM_COMPRESSION_RAW_DEFLATE,
+    /** Zstandard frames (RFC 8878) */
+    AVS_STREAM_COMPRESSION_ZSTD
+} avs_stream_compression_format_t;
+
+typedef struct {
+    /**
+     * Compressed data format.
+     */
+    avs_stream_compression_format_t format;
+
+    /**
+     * Compression level. 0 selects the default level of the backend. Valid
+     * levels are 1-9 for the DEFLATE-based formats, and any level supported by
+     * the library (including negative ones) for Zstandard. Ignored when
+     * decompressing.
+     */
+    int level;
+
+    /**
+     * Base-two logarithm of the window size. 0 selects the default, which is
+     * 15 for the DEFLATE-based formats (valid range: 9-15) and depends on the
+     * compression level for Zstandard. When decompressing, this is the
+     * largest window that is accepted.
+     */
+    int window_bits;
+
+    /**
+     * Preset dictionary, or NULL. The same dictionary needs to be used for
+     * compression and decompression. Not supported for the gzip format.
+     *
+     * The dictionary is not copied and needs to remain valid for the lifetime
+     * of the stream.
+     */
+    const void *dictionary;
+
+    /**
+     * Size of @ref dictionary in bytes.
+     */
+    size_t dictionary_size;
+
+    /**
+     * Size of the internal buffer for compressed data. 0 selects the default
+     * of 4096 bytes.
+     */
+    size_t buffer_size;
+} avs_stream_compression_config_t;
+
+/**
+ * Creates a compressing stream decorator.
+ *
+ * <c>avs_stream_t</c> methods are implemented as follows:
+ *
+ * - <c>avs_stream_write</c> - compresses the data and writes the compressed
+ *   output to the underlying stream, as soon as the compressor produces it.
+ * - <c>avs_stream_finish_message</c> - finishes the compressed stream, writes
+ *   its remaining part and calls <c>avs_stream_finish_message</c> on the
+ *   underlying stream. Subsequent writes start a new, independent compressed
+ *   stream.
+ * - <c>avs_stream_reset</c> - discards the current compression state and
+ *   resets the underlying stream. Internal buffers and compressor contexts are
+ *   reused.
+ * - <c>avs_stream_cleanup</c> - finishes the compressed stream if any data has
+ *   been written since the last <c>avs_stream_finish_message</c> call, and
+ *   deletes the underlying stream.
+ *
+ * Reading is not supported.
+ *
+ * @param inout_stream Pointer to the underlying stream. After successful
+ *                     return, it will point to the newly created decorator,
+ *                     which takes ownership of the underlying stream.
+ *
+ * @param config       Compression configuration. Must not be NULL.
+ *
+ * @returns 0 on success, negative value in case of error. If it fails,
+ *          @p inout_stream is not affected and the underlying stream should
+ *          be deleted manually.
+ */
+int avs_stream_deflate_create(avs_stream_t **inout_stream,
+                              const avs_stream_compression_config_t *config);
+
+/**
+ * Creates a decompressing stream decorator.
+ *
+ * <c>avs_stream_read</c> reads compressed data from the underlying stream and
+ * returns the decompressed data. <c>out_message_finished</c> is set at the end
+ * of each compressed stream. If more data follows it (e.g. multiple gzip
+ * members in a single file), the next read starts decompressing the next
+ * compressed stream. If the underlying stream finishes its message before the
+ * end of the compressed stream, reading fails with <c>AVS_EIO</c>.
+ *
+ * <c>avs_stream_reset</c> discards the decompression state and resets the
+ * underlying stream, reusing internal buffers and decompressor contexts.
+ *
+ * Writing is not supported.
+ *
+ * @param inout_stream Pointer to the underlying stream. After successful
+ *                     return, it will point to the newly created decorator,
+ *                     which takes ownership of the underlying stream.
+ *
+ * @param config       Decompression configuration. Must not be NULL. The
+ *                     <c>level</c> field is ignored.
+ *
+ * @returns 0 on success, negative value in case of error. If it fails,
+ *          @p inout_stream is not affected and the underlying stream should
+ *          be deleted manually.
+ */
+int avs_stream_inflate_create(avs_stream_t **inout_stream,
+                              const avs_stream_compression_config_t *config);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AVS_COMMONS_STREAM_COMPRESSION_H */
@@ -0,0 +1,160 @@
+/*
+ * Copyright 2021 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AVS_COMMONS_UTILS_TRACE_H
+#define AVS_COMMONS_UTILS_TRACE_H
+
+#include <avsystem/commons/avs_defs.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file avs_trace.h
+ *
+ * Low-overhead tracing spans.
+ *
+ * Tracing is available only if avs_commons is compiled with
+ * <c>AVS_COMMONS_UTILS_WITH_TRACE</c> (<c>WITH_AVS_TRACE</c> CMake option).
+ * Otherwise, @ref AVS_TRACE_BEGIN and @ref AVS_TRACE_END expand to no-ops, and
+ * the remaining functions are not defined.
+ *
+ * Each event is a fixed-size record, stored in a ring buffer owned by the
+ * thread that generated it, along with a monotonic clock timestamp. Recording
+ * an event does not take any locks, nor allocate memory (except for allocating
+ * the ring buffer on the first event in each thread). When a ring buffer is
+ * full, the oldest events are overwritten.
+ *
+ * Recorded events can be exported in the Chrome trace event JSON format using
+ * @ref avs_trace_export_chrome_json. Such files can be opened in
+ * <c>chrome://tracing</c> or in the Perfetto UI.
+ *
+ * The following spans are recorded by avs_commons itself, as
+ * <c>category/name</c>:
+ * - <c>net/connect</c>, <c>net/accept</c>, <c>net/send</c>,
+ *   <c>net/send_to</c>, <c>net/receive</c>, <c>net/receive_from</c> - calls to
+ *   the respective @ref avs_net_socket_t methods,
+ * - <c>tls/handshake</c> - (D)TLS handshakes, including session resumption,
+ * - <c>http/receive_headers</c> - receiving and parsing HTTP response headers,
+ * - <c>sched/job</c> - execution of scheduler jobs.
+ */
+
+/**
+ * Begins a tracing span in the current thread.
+ *
+ * @param Category Category of the span (<c>const char *</c>). It is stored by
+ *                 pointer, so it shall be a string literal or otherwise have
+ *                 static storage duration.
+ *
+ * @param Name     Name of the span (<c>const char *</c>). The same lifetime
+ *                 requirements as for @p Category apply.
+ */
+#ifdef AVS_COMMONS_UTILS_WITH_TRACE
+#    define AVS_TRACE_BEGIN(Category, Name) \
+        avs_trace_event__('B', (Category), (Name))
+#else // AVS_COMMONS_UTILS_WITH_TRACE
+#    define AVS_TRACE_BEGIN(Category, Name) ((void) 0)
+#endif // AVS_COMMONS_UTILS_WITH_TRACE
+
+/**
+ * Ends a tracing span in the current thread. Spans shall be properly nested
+ * within each thread.
+ *
+ * @param Category Category of the span, as passed to @ref AVS_TRACE_BEGIN.
+ *
+ * @param Name     Name of the span, as passed to @ref AVS_TRACE_BEGIN.
+ */
+#ifdef AVS_COMMONS_UTILS_WITH_TRACE
+#    define AVS_TRACE_END(Category, Name) \
+        avs_trace_event__('E', (Category), (Name))
+#else // AVS_COMMONS_UTILS_WITH_TRACE
+#    define AVS_TRACE_END(Category, Name) ((void) 0)
+#endif // AVS_COMMONS_UTILS_WITH_TRACE
+
+#ifdef AVS_COMMONS_UTILS_WITH_TRACE
+
+/**
+ * Internal function used by @ref AVS_TRACE_BEGIN and @ref AVS_TRACE_END. Not
+ * meant to be called directly.
+ */
+void avs_trace_event__(char phase, const char *category, const char *name);
+
+/**
+ * Enables recording of tracing events.
+ *
+ * Until this function is called, @ref AVS_TRACE_BEGIN and @ref AVS_TRACE_END
+ * only check a global variable and return.
+ *
+ * @param events_per_thread Capacity of the ring buffer allocated for each
+ *                          thread that records events. Will be rounded up to a
+ *                          power of two.
+ *
+ * @returns 0 on success, or a negative value if tracing is already enabled or
+ *          @p events_per_thread is 0.
+ */
+int avs_trace_init(size_t events_per_thread);
+
+/**
+ * Disables recording of tracing events and frees all ring buffers.
+ *
+ * NOTE: This function shall only be called when no other threads may record
+ * tracing events. Otherwise, the behaviour is undefined.
+ */
+void avs_trace_cleanup(void);
+
+/**
+ * Type of a function used by @ref avs_trace_export_chrome_json to write the
+ * output.
+ *
+ * @param arg  Opaque argument passed to @ref avs_trace_export_chrome_json.
+ *
+ * @param data Data to write.
+ *
+ * @param size Number of bytes at @p data.
+ *
+ * @returns 0 on success, or a non-zero value to abort the export.
+ */
+typedef int avs_trace_writer_t(void *arg, const char *data, size_t size);
+
+/**
+ * Writes all events currently held in the ring buffers, in the Chrome trace
+ * event JSON format.
+ *
+ * Events from each thread are written in the order they were recorded. Each
+ * thread that ever recorded an event is assigned a distinct <c>tid</c>,
+ * starting from 1. Timestamps are relative to the monotonic clock epoch.
+ *
+ * NOTE: Events recorded concurrently with the export may or may not be
+ * included, and may appear corrupted. For reliable results, make sure that no
+ * other threads are recording events during the export.
+ *
+ * @param writer Function that will be called to write the output.
+ *
+ * @param arg    Opaque argument to pass to @p writer.
+ *
+ * @returns 0 on success, or a negative value if tracing is not enabled or
+ *          @p writer failed.
+ */
+int avs_trace_export_chrome_json(avs_trace_writer_t *writer, void *arg);
+
+#endif // AVS_COMMONS_UTILS_WITH_TRACE
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AVS_COMMONS_UTILS_TRACE_H */
@@ -180,6 +180,107 @@ int avs_url_validate(const avs_url_t *url);
  */
 avs_url_t *avs_url_copy(const avs_url_t *url);
 
+/**
+ * Resolves a URI reference against a base URL, as described in RFC 3986
+ * section 5.2, and stores the result in a newly allocated @ref avs_url_t
+ * object.
+ *
+ * The reference may be either absolute (e.g. <c>"http://example.com/"</c>) or
+ * relative (e.g. <c>"../index.html"</c>, <c>"?query"</c> or
+ * <c>"//example.com/"</c>). Dot segments are removed from the path of the
+ * resulting URL. The "strict" variant of the algorithm is used, i.e. a
+ * reference such as <c>"http:g"</c> is not treated as relative, even if the
+ * base URL uses the same scheme.
+ *
+ * The result is parsed as if using @ref avs_url_parse_lenient. Use
+ * @ref avs_url_validate if stricter validation is necessary.
+ *
+ * @param base Base URL. It MUST contain the protocol (scheme) portion.
+ *
+ * @param ref  A null-terminated URI reference to resolve.
+ *
+ * @return New heap-allocated parsed URL object, or <c>NULL</c> in case of
+ *         error.
+ */
+avs_url_t *avs_url_resolve(const avs_url_t *base, const char *ref);
+
+/**
+ * Normalizes a parsed URL in place, as described in RFC 3986 section 6.2.2
+ * and 6.2.3:
+ *
+ * - protocol and hostname are converted to lowercase,
+ * - port is removed if it is empty or equal to the default port of a known
+ *   protocol (http, https, ws, wss, coap, coaps, coap+tcp, coaps+tcp),
+ * - percent-encoded unreserved characters in the path are decoded, and hex
+ *   digits of all other percent-encoded octets are converted to uppercase,
+ * - dot segments are removed from the path, if the protocol is present.
+ *
+ * @param url URL to normalize.
+ */
+void avs_url_normalize(avs_url_t *url);
+
+/**
+ * Components of a URL to be formatted using @ref avs_url_build. Any field may
+ * be <c>NULL</c>, in which case the corresponding portion is omitted.
+ */
+typedef struct {
+    /** Protocol (scheme name), without the trailing colon. */
+    const char *protocol;
+    /**
+     * Username. Written with percent-encoding applied to all characters that
+     * are not allowed in the userinfo portion.
+     */
+    const char *user;
+    /** Password. Percent-encoded in the same way as @ref user. */
+    const char *password;
+    /** Hostname. Enclosed in brackets if it contains a colon. */
+    const char *host;
+    /** Port, without the leading colon. */
+    const char *port;
+    /**
+     * Path, written verbatim - any necessary percent-encoding shall already be
+     * applied. If @ref host is present, the path MUST either be empty or begin
+     * with a slash.
+     */
+    const char *path;
+    /** Query string, without the leading question mark, written verbatim. */
+    const char *query;
+} avs_url_components_t;
+
+/**
+ * Formats a URL from its components into a caller-provided buffer. No memory
+ * is allocated.
+ *
+ * @param buf        Buffer to write the null-terminated URL to.
+ *
+ * @param buf_size   Size of @p buf in bytes.
+ *
+ * @param components URL components to format.
+ *
+ * @return 0 for success, or -1 if the components are invalid (e.g. user or
+ *         port specified without a host) or if the buffer is too small.
+ */
+int avs_url_build(char *buf,
+                  size_t buf_size,
+                  const avs_url_components_t *components);
+
+/**
+ * Formats a parsed URL back into its textual representation, writing it into a
+ * caller-provided buffer. No memory is allocated.
+ *
+ * Username and password are percent-encoded if necessary. Other portions are
+ * written as stored in @p url.
+ *
+ * @param url      A parsed URL object.
+ *
+ * @param buf      Buffer to write the null-terminated URL to.
+ *
+ * @param buf_size Size of @p buf in bytes.
+ *
+ * @return 0 for success, or -1 if the buffer is too small.
+ */
+int avs_url_format(const avs_url_t *url, char *buf, size_t buf_size);
+
 /**
  * Returns the protocol (scheme name) portion of the parsed URL, or <c>NULL</c>
  * if it was not present (only possible for @ref avs_url_parse_lenient).
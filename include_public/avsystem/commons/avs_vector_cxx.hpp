@@ -0,0 +1,436 @@
+/*
+ * Copyright 2021 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AVS_COMMONS_VECTOR_CXX_H
+#define AVS_COMMONS_VECTOR_CXX_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <utility>
+
+#include <avsystem/commons/avs_vector.h>
+
+/**
+ * @file avs_vector_cxx.hpp
+ *
+ * A C++ wrapper over @ref AVS_VECTOR macros.
+ *
+ * Sorting and binary search are implemented in C++, so the comparison functor
+ * is inlined instead of being called through @ref avs_vector_comparator_func_t
+ * by <c>qsort()</c>. The underlying object is still a regular
+ * @ref AVS_VECTOR, available through @ref avs::Vector::get.
+ *
+ * As with @ref AVS_VECTOR, elements are relocated using <c>memmove()</c> when
+ * the vector grows or when elements are inserted or removed in the middle, so
+ * @p T MUST be trivially relocatable. Most move-only types, such as
+ * <c>std::unique_ptr</c>, satisfy this requirement in practice.
+ *
+ * <example>
+ * @code
+ * #include <stdio.h>
+ * #include <avsystem/commons/avs_vector_cxx.hpp>
+ *
+ * int main() {
+ *     avs::Vector<int> vec;
+ *     for (int i = 10; i > 0; --i) {
+ *         vec.insert_sorted(i);
+ *     }
+ *     for (avs::Vector<int>::iterator it = vec.begin(); it != vec.end();
+ *          ++it) {
+ *         printf("%d\n", *it);
+ *     }
+ * }
+ * @endcode
+ * </example>
+ */
+
+namespace avs {
+
+namespace detail {
+
+template <typename T, typename Compare>
+struct VectorElementLess {
+    const T &value;
+    Compare cmp;
+
+    VectorElementLess(const T &value, Compare cmp) : value(value), cmp(cmp) {}
+
+    bool operator()(const T &elem) const {
+        return cmp(elem, value);
+    }
+};
+
+template <typename T, typename Compare>
+struct VectorElementNotGreater {
+    const T &value;
+    Compare cmp;
+
+    VectorElementNotGreater(const T &value, Compare cmp)
+            : value(value), cmp(cmp) {}
+
+    bool operator()(const T &elem) const {
+        return !cmp(value, elem);
+    }
+};
+
+/**
+ * Returns the first element of a range of @p count elements starting at
+ * @p first for which @p pred is false, assuming that the range is partitioned
+ * with respect to @p pred.
+ *
+ * Unlike <c>std::partition_point()</c>, the range is narrowed without
+ * branching on the result of @p pred, which for random keys would be
+ * mispredicted about half of the time.
+ */
+template <typename T, typename Predicate>
+T *vector_partition_point(T *first, std::size_t count, Predicate pred) {
+    if (!count) {
+        return first;
+    }
+    while (count > 1) {
+        const std::size_t half = count / 2;
+        first = pred(first[half]) ? first + half : first;
+        count -= half;
+    }
+    return first + static_cast<std::size_t>(pred(*first));
+}
+
+} // namespace detail
+
+/**
+ * Self-owning dynamic array based on @ref AVS_VECTOR.
+ *
+ * Allocation failures are not reported with exceptions. Operations that
+ * allocate memory return <c>end()</c> or <c>false</c> instead.
+ */
+template <typename T>
+class Vector {
+    AVS_VECTOR(T) vec_;
+
+    Vector(const Vector &);
+    Vector &operator=(const Vector &);
+
+    bool ensure_vector() {
+        if (!vec_) {
+            vec_ = AVS_VECTOR_NEW(T);
+        }
+        return vec_ != NULL;
+    }
+
+    /**
+     * Grows the vector by one element at @p index, without constructing it.
+     * Elements at and after @p index are relocated one position forward.
+     */
+    T *insert_uninitialized(std::size_t index) {
+        union {
+            unsigned char bytes[sizeof(T)];
+            avs_max_align_t align;
+        } placeholder;
+
+        if (!ensure_vector()) {
+            return NULL;
+        }
+        // the placeholder is copied into the new slot, which is immediately
+        // overwritten by the caller using placement new
+        std::memset(&placeholder, 0, sizeof(placeholder));
+        if (AVS_VECTOR_PUSH(&vec_, reinterpret_cast<T *>(&placeholder))) {
+            return NULL;
+        }
+        T *data = *vec_;
+        std::size_t tail = AVS_VECTOR_SIZE(vec_) - 1 - index;
+        if (tail) {
+            std::memmove(static_cast<void *>(data + index + 1),
+                         static_cast<const void *>(data + index),
+                         tail * sizeof(T));
+        }
+        return data + index;
+    }
+
+public:
+    typedef T value_type;
+    typedef std::size_t size_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef T &reference;
+    typedef const T &const_reference;
+    typedef T *pointer;
+    typedef const T *const_pointer;
+    typedef T *iterator;
+    typedef const T *const_iterator;
+
+    Vector() : vec_(NULL) {}
+
+    /** Takes ownership of a vector created with @ref AVS_VECTOR_NEW. */
+    explicit Vector(AVS_VECTOR(T) vec) : vec_(vec) {}
+
+#if __cplusplus >= 201103L
+    Vector(Vector &&other) : vec_(other.vec_) {
+        other.vec_ = NULL;
+    }
+
+    Vector &operator=(Vector &&other) {
+        if (this != &other) {
+            clear();
+            AVS_VECTOR_DELETE(&vec_);
+            vec_ = other.vec_;
+            other.vec_ = NULL;
+        }
+        return *this;
+    }
+#endif
+
+    ~Vector() {
+        clear();
+        AVS_VECTOR_DELETE(&vec_);
+    }
+
+    /**
+     * Returns the underlying @ref AVS_VECTOR object, or NULL if nothing has
+     * been inserted yet. The ownership is retained.
+     */
+    AVS_VECTOR(T) get() const {
+        return vec_;
+    }
+
+    /** Releases the ownership of the underlying @ref AVS_VECTOR object. */
+    AVS_VECTOR(T) release() {
+        AVS_VECTOR(T) result = vec_;
+        vec_ = NULL;
+        return result;
+    }
+
+    bool empty() const {
+        return size() == 0;
+    }
+
+    size_type size() const {
+        return vec_ ? AVS_VECTOR_SIZE(vec_) : 0;
+    }
+
+    size_type capacity() const {
+        return vec_ ? AVS_VECTOR_CAPACITY(vec_) : 0;
+    }
+
+    bool reserve(size_type num_elements) {
+        return ensure_vector() && !AVS_VECTOR_RESERVE(&vec_, num_elements);
+    }
+
+    T *data() {
+        return vec_ ? *vec_ : NULL;
+    }
+
+    const T *data() const {
+        return vec_ ? *vec_ : NULL;
+    }
+
+    iterator begin() {
+        return data();
+    }
+
+    const_iterator begin() const {
+        return data();
+    }
+
+    const_iterator cbegin() const {
+        return data();
+    }
+
+    iterator end() {
+        return data() + size();
+    }
+
+    const_iterator end() const {
+        return data() + size();
+    }
+
+    const_iterator cend() const {
+        return end();
+    }
+
+    T &operator[](size_type index) {
+        return data()[index];
+    }
+
+    const T &operator[](size_type index) const {
+        return data()[index];
+    }
+
+    T &front() {
+        return *begin();
+    }
+
+    const T &front() const {
+        return *begin();
+    }
+
+    T &back() {
+        return end()[-1];
+    }
+
+    const T &back() const {
+        return end()[-1];
+    }
+
+    /**
+     * Inserts a copy of @p value before @p pos. @p value may refer to an
+     * element of this vector.
+     *
+     * @returns Iterator to the inserted element, or <c>end()</c> if memory
+     *          allocation failed.
+     */
+    iterator insert(const_iterator pos, const T &value) {
+        // growing the vector may invalidate value, so it is copied first
+        T tmp(value);
+        T *slot = insert_uninitialized(static_cast<size_type>(pos - begin()));
+        if (!slot) {
+            return end();
+        }
+#if __cplusplus >= 201103L
+        new (slot) T(std::move(tmp));
+#else
+        new (slot) T(tmp);
+#endif
+        return slot;
+    }
+
+    iterator push_back(const T &value) {
+        return insert(end(), value);
+    }
+
+#if __cplusplus >= 201103L
+    iterator insert(const_iterator pos, T &&value) {
+        return emplace(pos, std::move(value));
+    }
+
+    iterator push_back(T &&value) {
+        return emplace(end(), std::move(value));
+    }
+
+    /**
+     * Constructs an element from @p args before @p pos. @p args may refer to
+     * elements of this vector.
+     *
+     * @returns Iterator to the inserted element, or <c>end()</c> if memory
+     *          allocation failed.
+     */
+    template <typename... Args>
+    iterator emplace(const_iterator pos, Args &&... args) {
+        T tmp(std::forward<Args>(args)...);
+        T *slot = insert_uninitialized(static_cast<size_type>(pos - begin()));
+        if (!slot) {
+            return end();
+        }
+        new (slot) T(std::move(tmp));
+        return slot;
+    }
+
+    template <typename... Args>
+    iterator emplace_back(Args &&... args) {
+        return emplace(end(), std::forward<Args>(args)...);
+    }
+#endif
+
+    /**
+     * Destroys the element at @p pos and relocates the following ones.
+     *
+     * @returns Iterator to the element that followed the removed one.
+     */
+    iterator erase(const_iterator pos) {
+        size_type index = static_cast<size_type>(pos - begin());
+        (*this)[index].~T();
+        AVS_VECTOR_REMOVE_AT(&vec_, index);
+        return begin() + index;
+    }
+
+    void pop_back() {
+        AVS_VECTOR_POP(&vec_)->~T();
+    }
+
+    void clear() {
+        if (vec_) {
+            T *elem;
+            AVS_VECTOR_CLEAR(&vec_, elem) {
+                elem->~T();
+            }
+        }
+    }
+
+    template <typename Compare>
+    void sort(Compare cmp) {
+        std::sort(begin(), end(), cmp);
+    }
+
+    void sort() {
+        sort(std::less<T>());
+    }
+
+    /** Finds the first element not less than @p value in a sorted vector. */
+    template <typename Compare>
+    iterator lower_bound(const T &value, Compare cmp) {
+        return detail::vector_partition_point(
+                begin(), size(),
+                detail::VectorElementLess<T, Compare>(value, cmp));
+    }
+
+    iterator lower_bound(const T &value) {
+        return lower_bound(value, std::less<T>());
+    }
+
+    /** Finds the first element greater than @p value in a sorted vector. */
+    template <typename Compare>
+    iterator upper_bound(const T &value, Compare cmp) {
+        return detail::vector_partition_point(
+                begin(), size(),
+                detail::VectorElementNotGreater<T, Compare>(value, cmp));
+    }
+
+    iterator upper_bound(const T &value) {
+        return upper_bound(value, std::less<T>());
+    }
+
+    /**
+     * Inserts a copy of @p value into a sorted vector, after all elements
+     * equivalent to it.
+     *
+     * @returns Iterator to the inserted element, or <c>end()</c> if memory
+     *          allocation failed.
+     */
+    template <typename Compare>
+    iterator insert_sorted(const T &value, Compare cmp) {
+        return insert(upper_bound(value, cmp), value);
+    }
+
+    iterator insert_sorted(const T &value) {
+        return insert_sorted(value, std::less<T>());
+    }
+
+#if __cplusplus >= 201103L
+    template <typename Compare>
+    iterator insert_sorted(T &&value, Compare cmp) {
+        return insert(upper_bound(value, cmp), std::move(value));
+    }
+
+    iterator insert_sorted(T &&value) {
+        return insert_sorted(std::move(value), std::less<T>());
+    }
+#endif
+};
+
+} // namespace avs
+
+#endif /* AVS_COMMONS_VECTOR_CXX_H */
@@ -0,0 +1,209 @@
+/*
+ * Copyright 2021 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AVS_COMMONS_WEBSOCKET_H
+#define AVS_COMMONS_WEBSOCKET_H
+
+#include <avsystem/commons/avs_http.h>
+#ifdef AVS_COMMONS_WITH_AVS_CRYPTO
+#    include <avsystem/commons/avs_prng.h>
+#endif // AVS_COMMONS_WITH_AVS_CRYPTO
+#include <avsystem/commons/avs_sched.h>
+#include <avsystem/commons/avs_stream.h>
+#include <avsystem/commons/avs_url.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file avs_websocket.h
+ *
+ * WebSocket client (RFC 6455).
+ *
+ * The connection is established using an ordinary @ref avs_http_t client, so
+ * its TLS configuration, cookies and authentication credentials are used for
+ * the opening handshake. Afterwards, the connection is represented by an
+ * @ref avs_stream_t object:
+ *
+ * - <c>avs_stream_write</c> appends data to the message currently being sent.
+ *   Whenever the configured fragment size is exceeded, a non-final frame is
+ *   sent.
+ * - <c>avs_stream_finish_message</c> sends the final frame of the message.
+ * - <c>avs_stream_read</c> reads the payload of the message currently being
+ *   received. <c>out_message_finished</c> is set at the end of each message.
+ *   After the peer closes the connection, @ref AVS_EOF is returned.
+ * - <c>avs_stream_nonblock_read_ready</c> and <c>avs_stream_net_getsock</c>
+ *   may be used to integrate the stream with an event loop.
+ *
+ * Control frames are handled transparently: pings are answered while reading,
+ * and Close frames are answered and reported as end of stream. Cleaning up the
+ * stream sends a Close frame with the 1000 (Normal Closure) code, unless a
+ * Close frame has already been sent.
+ *
+ * The stream is not thread-safe. In particular, the scheduler used for
+ * keep-alive pings (see @ref avs_websocket_config_t.sched) needs to be run in
+ * the same thread that uses the stream.
+ *
+ * The handshake key and the masking keys of outgoing frames are generated using
+ * the avs_crypto PRNG. If avs_commons is compiled without
+ * <c>AVS_COMMONS_WITH_AVS_CRYPTO</c>, they are generated by @ref avs_rand32_r
+ * seeded with the current time instead. The same applies to the PRNG of the
+ * generic avs_crypto backend, used if neither OpenSSL nor mbed TLS is
+ * available. Such keys are predictable, so the masking does not protect
+ * intermediaries from cache poisoning attacks as intended by RFC 6455. This is
+ * only acceptable if untrusted code cannot influence the data being sent.
+ *
+ * Only available if <c>AVS_COMMONS_HTTP_WITH_WEBSOCKET</c> is enabled.
+ */
+
+typedef enum {
+    AVS_WEBSOCKET_TEXT = 1,
+    AVS_WEBSOCKET_BINARY = 2
+} avs_websocket_message_type_t;
+
+typedef struct {
+    /**
+     * Value of the <c>Sec-WebSocket-Protocol</c> header to send, i.e. a
+     * comma-separated list of requested subprotocols. May be NULL.
+     */
+    const char *subprotocols;
+
+    /**
+     * If true, the permessage-deflate extension (RFC 7692) is offered to the
+     * server, without context takeover in either direction. Requires
+     * <c>AVS_COMMONS_HTTP_WITH_ZLIB</c>; ignored otherwise.
+     */
+    bool permessage_deflate;
+
+    /**
+     * Maximum payload size of outgoing data frames. Longer messages are split
+     * into multiple fragments. Default: 4096.
+     */
+    size_t fragment_size;
+
+    /**
+     * If not NULL, a Ping frame is sent every @ref ping_interval using this
+     * scheduler. If no Pong frame is received before sending the next Ping,
+     * the connection is shut down, so that any pending or subsequent
+     * operations fail. The scheduler needs to outlive the stream.
+     */
+    avs_sched_t *sched;
+
+    /**
+     * Interval between keep-alive pings. Zero means the default of 30 s.
+     * @ref AVS_TIME_DURATION_INVALID disables the pings even if @ref sched is
+     * set. Negative values are rejected.
+     */
+    avs_time_duration_t ping_interval;
+
+#ifdef AVS_COMMONS_WITH_AVS_CRYPTO
+    /**
+     * PRNG used to generate the handshake key and the masking keys. It needs to
+     * outlive the stream. If NULL, a PRNG with the default entropy source is
+     * created for the stream.
+     */
+    avs_crypto_prng_ctx_t *prng_ctx;
+#endif // AVS_COMMONS_WITH_AVS_CRYPTO
+} avs_websocket_config_t;
+
+/**
+ * Performs the WebSocket opening handshake and creates a stream representing
+ * the connection.
+ *
+ * @param out_stream    Pointer to a variable in which the created stream will
+ *                      be stored.
+ *
+ * @param http          HTTP client to use for the handshake. Its TCP and TLS
+ *                      configuration, cookies and user agent are used.
+ *
+ * @param url           URL to connect to. The <c>ws</c>, <c>wss</c>,
+ *                      <c>http</c> and <c>https</c> schemes are supported.
+ *
+ * @param auth_username Username for HTTP authentication, as in
+ *                      @ref avs_http_open_stream. May be NULL.
+ *
+ * @param auth_password Password for HTTP authentication, as in
+ *                      @ref avs_http_open_stream. May be NULL.
+ *
+ * @param config        Connection configuration. May be NULL, in which case
+ *                      defaults are used. Zero-valued fields are replaced with
+ *                      their defaults.
+ *
+ * @returns @ref AVS_OK for success, an HTTP error category if the server
+ *          responded with a status code other than 101, or another error
+ *          condition for which the handshake failed.
+ */
+avs_error_t avs_websocket_connect(avs_stream_t **out_stream,
+                                  avs_http_t *http,
+                                  const avs_url_t *url,
+                                  const char *auth_username,
+                                  const char *auth_password,
+                                  const avs_websocket_config_t *config);
+
+/**
+ * Sets the type of the messages sent subsequently. The default type is
+ * @ref AVS_WEBSOCKET_BINARY.
+ *
+ * @returns 0 for success, or a negative value if a message is currently being
+ *          sent and some of its fragments have already been transmitted.
+ */
+int avs_websocket_set_message_type(avs_stream_t *stream,
+                                   avs_websocket_message_type_t type);
+
+/**
+ * Returns the type of the message currently being received, or of the most
+ * recently received one.
+ */
+avs_websocket_message_type_t avs_websocket_message_type(avs_stream_t *stream);
+
+/**
+ * Returns the subprotocol selected by the server, or NULL if none.
+ */
+const char *avs_websocket_subprotocol(avs_stream_t *stream);
+
+/**
+ * Sends a Ping frame with an application-defined payload of at most 125 bytes.
+ */
+avs_error_t avs_websocket_ping(avs_stream_t *stream,
+                               const void *payload,
+                               size_t payload_size);
+
+/**
+ * Starts the closing handshake by sending a Close frame. Subsequent reads
+ * return the remaining messages sent by the peer, followed by @ref AVS_EOF once
+ * the peer's Close frame is received.
+ *
+ * @param stream WebSocket stream.
+ *
+ * @param code   Status code to send, e.g. 1000 for Normal Closure.
+ *
+ * @param reason Textual reason to send, at most 123 bytes. May be NULL.
+ */
+avs_error_t
+avs_websocket_close(avs_stream_t *stream, uint16_t code, const char *reason);
+
+/**
+ * Returns the status code from the Close frame received from the peer, 1005 if
+ * the frame did not contain one, or 0 if no Close frame has been received.
+ */
+uint16_t avs_websocket_close_code(avs_stream_t *stream);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AVS_COMMONS_WEBSOCKET_H */
@@ -135,7 +135,10 @@
 #    pragma GCC poison vfscanf
 #    pragma GCC poison vscanf
 #    pragma GCC poison remove
-#    pragma GCC poison rename
+#    ifndef AVS_PERSISTENCE_PERSISTENCE_SNAPSHOT_C
+// rename is used in persistence/src/avs_persistence_snapshot.c
+#        pragma GCC poison rename
+#    endif // AVS_PERSISTENCE_PERSISTENCE_SNAPSHOT_C
 #    pragma GCC poison tmpfile
 #    pragma GCC poison tmpnam
 #    pragma GCC poison freopen
@@ -37,6 +37,7 @@
 #    include <net/if.h>
 #    include <netdb.h>
 #    include <netinet/in.h>
+#    include <netinet/tcp.h>
 #    include <poll.h>
 #    include <strings.h>
 #    include <sys/select.h>
@@ -0,0 +1,449 @@
+/*
+ * Copyright 2021 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <avs_commons_init.h>
+
+#if defined(AVS_COMMONS_WITH_AVS_CRYPTO)                          \
+        && defined(AVS_COMMONS_WITH_AVS_CRYPTO_ADVANCED_FEATURES) \
+        && defined(AVS_COMMONS_WITH_AVS_CRYPTO_PKI)               \
+        && defined(AVS_COMMONS_WITH_AVS_STREAM)
+
+#    include <string.h>
+
+#    include <avsystem/commons/avs_crypto_pki.h>
+#    include <avsystem/commons/avs_defs.h>
+#    include <avsystem/commons/avs_errno.h>
+#    include <avsystem/commons/avs_stream.h>
+
+#    define MODULE_NAME avs_crypto_pki
+#    include <avs_x_log_config.h>
+
+VISIBILITY_SOURCE_BEGIN
+
+// NOTE: This is a streaming counterpart of the PKCS#7 parser that lives in
+// avs_mbedtls_pki.c, and accepts exactly the same subset of BER. As there, the
+// comments below use RFC 2315 definitions of the PKCS#7 syntax elements.
+
+#    define ASN1_BER_EOC_TAG 0x00
+#    define ASN1_INTEGER_TAG 0x02
+#    define ASN1_OID_TAG 0x06
+#    define ASN1_SEQUENCE_TAG 0x30
+#    define ASN1_SET_TAG 0x31
+#    define ASN1_CONTEXT_TAG(Num) (0xA0 | (Num))
+
+/** Maximum size of a tag-and-length header that we support. */
+#    define ASN1_MAX_HEADER_SIZE (2 + sizeof(size_t))
+
+/** Size of the PKCS#7 content type OIDs, compared using the buffer. */
+#    define PKCS7_OID_SIZE 9
+
+/** Minimum buffer size accepted by the parser. */
+#    define PKCS7_MIN_BUFFER_SIZE AVS_MAX(ASN1_MAX_HEADER_SIZE, PKCS7_OID_SIZE)
+
+/** Length value signifying BER indefinite length encoding. */
+#    define BER_INDEFINITE_LENGTH SIZE_MAX
+
+typedef struct {
+    avs_stream_t *stream;
+    unsigned char *buffer;
+    size_t buffer_size;
+    avs_crypto_pkcs7_item_handler_t *handler;
+    void *handler_arg;
+    /** Number of bytes consumed from the stream so far. */
+    size_t offset;
+} pkcs7_stream_ctx_t;
+
+typedef struct {
+    unsigned char tag;
+    /** Content length, or @ref BER_INDEFINITE_LENGTH. */
+    size_t length;
+    /** Number of bytes that the tag and length octets themselves took. */
+    size_t header_size;
+    /** Offset at which the contents end; only valid for definite lengths. */
+    size_t end;
+} ber_header_t;
+
+/**
+ * Checks whether @p err means that the data is not a valid PKCS#7 structure, as
+ * opposed to errors reported by the stream or the handler, which are passed
+ * through unchanged. Success is also treated as such, to simplify checks for
+ * unexpected values of successfully decoded elements.
+ */
+static bool is_malformed(avs_error_t err) {
+    return avs_is_ok(err)
+           || (err.category == AVS_ERRNO_CATEGORY && err.code == AVS_EPROTO);
+}
+
+static avs_error_t
+read_bytes(pkcs7_stream_ctx_t *ctx, unsigned char *out, size_t size) {
+    avs_error_t err = avs_stream_read_reliably(ctx->stream, out, size);
+    if (avs_is_eof(err)) {
+        LOG(ERROR, _("PKCS#7 data truncated at offset ") "%lu",
+            (unsigned long) ctx->offset);
+        return avs_errno(AVS_EPROTO);
+    }
+    if (avs_is_ok(err)) {
+        ctx->offset += size;
+    }
+    return err;
+}
+
+static avs_error_t skip_bytes(pkcs7_stream_ctx_t *ctx, size_t size) {
+    while (size > 0) {
+        size_t chunk_size = AVS_MIN(size, ctx->buffer_size);
+        avs_error_t err = read_bytes(ctx, ctx->buffer, chunk_size);
+        if (avs_is_err(err)) {
+            return err;
+        }
+        size -= chunk_size;
+    }
+    return AVS_OK;
+}
+
+/**
+ * Reads tag and length octets into @p out_raw (which needs to be at least
+ * @ref ASN1_MAX_HEADER_SIZE bytes long) and decodes them into @p out_header.
+ */
+static avs_error_t read_header_raw(pkcs7_stream_ctx_t *ctx,
+                                   unsigned char *out_raw,
+                                   ber_header_t *out_header) {
+    avs_error_t err = read_bytes(ctx, out_raw, 2);
+    if (avs_is_err(err)) {
+        return err;
+    }
+    // high-tag-number form is not used by any of the structures we parse
+    if ((out_raw[0] & 0x1F) == 0x1F) {
+        return avs_errno(AVS_EPROTO);
+    }
+    out_header->tag = out_raw[0];
+    out_header->header_size = 2;
+    if (out_raw[1] == 0x80) {
+        // indefinite length is only valid for constructed encodings
+        if (!(out_raw[0] & 0x20)) {
+            return avs_errno(AVS_EPROTO);
+        }
+        out_header->length = BER_INDEFINITE_LENGTH;
+        return AVS_OK;
+    }
+    if (out_raw[1] < 0x80) {
+        out_header->length = out_raw[1];
+    } else {
+        size_t length_size = (size_t) (out_raw[1] & 0x7F);
+        if (length_size > sizeof(size_t)) {
+            return avs_errno(AVS_EPROTO);
+        }
+        if (avs_is_err((err = read_bytes(ctx, &out_raw[2], length_size)))) {
+            return err;
+        }
+        out_header->header_size += length_size;
+        out_header->length = 0;
+        for (size_t i = 0; i < length_size; ++i) {
+            out_header->length = (out_header->length << 8) | out_raw[2 + i];
+        }
+    }
+    if (out_header->length == BER_INDEFINITE_LENGTH
+            || out_header->length > SIZE_MAX - ctx->offset) {
+        return avs_errno(AVS_EPROTO);
+    }
+    out_header->end = ctx->offset + out_header->length;
+    return AVS_OK;
+}
+
+static avs_error_t read_header(pkcs7_stream_ctx_t *ctx,
+                               ber_header_t *out_header,
+                               unsigned char expected_tag) {
+    unsigned char raw[ASN1_MAX_HEADER_SIZE];
+    avs_error_t err = read_header_raw(ctx, raw, out_header);
+    if (avs_is_ok(err) && out_header->tag != expected_tag) {
+        err = avs_errno(AVS_EPROTO);
+    }
+    return err;
+}
+
+/**
+ * Verifies that a constructed element described by @p header is properly
+ * terminated: for indefinite length, reads the end-of-contents octets; for
+ * definite length, checks that exactly the declared number of bytes has been
+ * consumed.
+ */
+static avs_error_t finish_constructed(pkcs7_stream_ctx_t *ctx,
+                                      const ber_header_t *header) {
+    if (header->length != BER_INDEFINITE_LENGTH) {
+        return ctx->offset == header->end ? AVS_OK : avs_errno(AVS_EPROTO);
+    }
+    ber_header_t eoc;
+    avs_error_t err = read_header(ctx, &eoc, ASN1_BER_EOC_TAG);
+    if (avs_is_ok(err) && eoc.length != 0) {
+        err = avs_errno(AVS_EPROTO);
+    }
+    return err;
+}
+
+static avs_error_t read_expected_oid(pkcs7_stream_ctx_t *ctx,
+                                     const unsigned char *oid,
+                                     size_t oid_size) {
+    ber_header_t header;
+    avs_error_t err = read_header(ctx, &header, ASN1_OID_TAG);
+    if (avs_is_err(err)) {
+        return err;
+    }
+    if (header.length != oid_size) {
+        return avs_errno(AVS_EPROTO);
+    }
+    if (oid_size > ctx->buffer_size) {
+        return avs_errno(AVS_EINVAL);
+    }
+    if (avs_is_err((err = read_bytes(ctx, ctx->buffer, oid_size)))) {
+        return err;
+    }
+    return memcmp(ctx->buffer, oid, oid_size) ? avs_errno(AVS_EPROTO) : AVS_OK;
+}
+
+static avs_error_t pkcs7_inner_content_info_verify(pkcs7_stream_ctx_t *ctx) {
+    // ContentInfo ::= SEQUENCE {
+    //   contentType ContentType,
+    //   content
+    //     [0] EXPLICIT ANY DEFINED BY contentType }
+    //
+    // ContentType ::= OBJECT IDENTIFIER
+    static const unsigned char ID_DATA_OID[] = { 0x2A, 0x86, 0x48, 0x86, 0xF7,
+                                                 0x0D, 0x01, 0x07, 0x01 };
+    ber_header_t header;
+    avs_error_t err;
+    if (avs_is_err((err = read_header(ctx, &header, ASN1_SEQUENCE_TAG)))
+            || avs_is_err((err = read_expected_oid(ctx, ID_DATA_OID,
+                                                   sizeof(ID_DATA_OID))))
+            || avs_is_err((err = finish_constructed(ctx, &header)))) {
+        if (!is_malformed(err)) {
+            return err;
+        }
+        LOG(ERROR,
+            _("Encapsulated content for PKCS#7 certs-only MUST be absent"));
+        return avs_errno(AVS_EPROTO);
+    }
+    return AVS_OK;
+}
+
+static avs_error_t pkcs7_x509_set_parse(pkcs7_stream_ctx_t *ctx,
+                                        const ber_header_t *set_header,
+                                        avs_crypto_security_info_tag_t type) {
+    // Note: we are inside an implicit SET
+    while (set_header->length == BER_INDEFINITE_LENGTH
+           || ctx->offset < set_header->end) {
+        ber_header_t header;
+        avs_error_t err = read_header_raw(ctx, ctx->buffer, &header);
+        if (avs_is_err(err)) {
+            return err;
+        }
+        if (header.tag == ASN1_BER_EOC_TAG
+                && set_header->length == BER_INDEFINITE_LENGTH) {
+            return header.length == 0 ? AVS_OK : avs_errno(AVS_EPROTO);
+        }
+        // We don't support indefinite length here, because neither of the
+        // crypto backends would be able to parse that anyway.
+        if (header.length == BER_INDEFINITE_LENGTH
+                || (set_header->length != BER_INDEFINITE_LENGTH
+                    && header.end > set_header->end)) {
+            return avs_errno(AVS_EPROTO);
+        }
+        if (header.length > ctx->buffer_size - header.header_size) {
+            LOG(ERROR,
+                _("PKCS#7 element at offset ") "%lu" _(
+                        " is too large: ") "%lu" _(" bytes, buffer size ") "%lu",
+                (unsigned long) (ctx->offset - header.header_size),
+                (unsigned long) (header.header_size + header.length),
+                (unsigned long) ctx->buffer_size);
+            return avs_errno(AVS_EMSGSIZE);
+        }
+        if (avs_is_err((err = read_bytes(ctx, ctx->buffer + header.header_size,
+                                         header.length)))
+                || avs_is_err((err = ctx->handler(
+                                       type, ctx->buffer,
+                                       header.header_size + header.length,
+                                       ctx->handler_arg)))) {
+            return err;
+        }
+    }
+    return AVS_OK;
+}
+
+static avs_error_t pkcs7_signed_data_parse(pkcs7_stream_ctx_t *ctx) {
+    // SignedData ::= SEQUENCE {
+    //   version Version,
+    //   digestAlgorithms DigestAlgorithmIdentifiers,
+    //   contentInfo ContentInfo,
+    //   certificates
+    //      [0] IMPLICIT ExtendedCertificatesAndCertificates
+    //        OPTIONAL,
+    //   crls
+    //     [1] IMPLICIT CertificateRevocationLists OPTIONAL,
+    //   signerInfos SignerInfos }
+    ber_header_t signed_data;
+    ber_header_t header;
+    unsigned char raw[ASN1_MAX_HEADER_SIZE];
+    avs_error_t err;
+    if (avs_is_err((err = read_header(ctx, &signed_data, ASN1_SEQUENCE_TAG)))
+            || avs_is_err((err = read_header(ctx, &header, ASN1_INTEGER_TAG)))
+            || header.length != 1
+            || avs_is_err((err = read_bytes(ctx, raw, 1)))) {
+        goto malformed;
+    }
+    if (raw[0] != 1) {
+        LOG(ERROR, _("Only version 1 of SignedData is currently supported"));
+        return avs_errno(AVS_EPROTO);
+    }
+
+    // skip digestAlgorithms, we don't care about those
+    if (avs_is_err((err = read_header(ctx, &header, ASN1_SET_TAG)))
+            || (header.length == BER_INDEFINITE_LENGTH
+                        // we don't support indefinite-length digestAlgorithms
+                        // properly, but let's try to support zero-length case
+                        // as best-effort
+                        ? avs_is_err((err = finish_constructed(ctx, &header)))
+                        : avs_is_err((err = skip_bytes(ctx, header.length))))) {
+        goto malformed;
+    }
+
+    if (avs_is_err((err = pkcs7_inner_content_info_verify(ctx)))) {
+        return err;
+    }
+
+    if (avs_is_err((err = read_header_raw(ctx, raw, &header)))) {
+        goto malformed;
+    }
+    if (header.tag == ASN1_CONTEXT_TAG(0)) {
+        if (avs_is_err((err = pkcs7_x509_set_parse(
+                                ctx, &header,
+                                AVS_CRYPTO_SECURITY_INFO_CERTIFICATE_CHAIN)))) {
+            goto malformed;
+        }
+        if (avs_is_err((err = read_header_raw(ctx, raw, &header)))) {
+            goto malformed;
+        }
+    }
+    if (header.tag == ASN1_CONTEXT_TAG(1)) {
+        if (avs_is_err(
+                    (err = pkcs7_x509_set_parse(
+                             ctx, &header,
+                             AVS_CRYPTO_SECURITY_INFO_CERT_REVOCATION_LIST)))) {
+            goto malformed;
+        }
+        if (avs_is_err((err = read_header_raw(ctx, raw, &header)))) {
+            goto malformed;
+        }
+    }
+
+    if (header.tag != ASN1_SET_TAG
+            || (header.length != 0
+                && (header.length != BER_INDEFINITE_LENGTH
+                    || avs_is_err(finish_constructed(ctx, &header))))) {
+        LOG(ERROR, _("signerInfos field for PKCS#7 certs-only MUST be empty"));
+        return avs_errno(AVS_EPROTO);
+    }
+
+    if (avs_is_err((err = finish_constructed(ctx, &signed_data)))) {
+        goto malformed;
+    }
+    return AVS_OK;
+malformed:
+    if (!is_malformed(err)) {
+        return err;
+    }
+    LOG(ERROR, _("Malformed data when parsing PKCS#7 SignedData"));
+    return avs_errno(AVS_EPROTO);
+}
+
+static avs_error_t pkcs7_content_info_parse(pkcs7_stream_ctx_t *ctx) {
+    // ContentInfo ::= SEQUENCE {
+    //   contentType ContentType,
+    //   content
+    //     [0] EXPLICIT ANY DEFINED BY contentType }
+    //
+    // ContentType ::= OBJECT IDENTIFIER
+    static const unsigned char SIGNED_DATA_OID[] = { 0x2A, 0x86, 0x48,
+                                                     0x86, 0xF7, 0x0D,
+                                                     0x01, 0x07, 0x02 };
+    ber_header_t content_info;
+    ber_header_t content;
+    avs_error_t err;
+    if (avs_is_err(
+                (err = read_header(ctx, &content_info, ASN1_SEQUENCE_TAG)))) {
+        goto malformed;
+    }
+    if (avs_is_err((err = read_expected_oid(ctx, SIGNED_DATA_OID,
+                                            sizeof(SIGNED_DATA_OID))))) {
+        if (!is_malformed(err)) {
+            return err;
+        }
+        LOG(ERROR, _("CMS Type for PKCS#7 certs-only MUST be SignedData"));
+        return avs_errno(AVS_EPROTO);
+    }
+    if (avs_is_err((err = read_header(ctx, &content, ASN1_CONTEXT_TAG(0))))) {
+        goto malformed;
+    }
+    if (avs_is_err((err = pkcs7_signed_data_parse(ctx)))) {
+        return err;
+    }
+    if (avs_is_err((err = finish_constructed(ctx, &content)))
+            || avs_is_err((err = finish_constructed(ctx, &content_info)))) {
+        goto malformed;
+    }
+    return AVS_OK;
+malformed:
+    if (!is_malformed(err)) {
+        return err;
+    }
+    LOG(ERROR, _("Malformed data when parsing PKCS#7 ContentInfo"));
+    return avs_errno(AVS_EPROTO);
+}
+
+avs_error_t
+avs_crypto_parse_pkcs7_certs_only_stream(avs_stream_t *stream,
+                                         void *buffer,
+                                         size_t buffer_size,
+                                         avs_crypto_pkcs7_item_handler_t *handler,
+                                         void *handler_arg) {
+    // the buffer is also used to compare OIDs
+    if (!stream || !buffer || buffer_size < PKCS7_MIN_BUFFER_SIZE
+            || !handler) {
+        return avs_errno(AVS_EINVAL);
+    }
+    pkcs7_stream_ctx_t ctx = {
+        .stream = stream,
+        .buffer = (unsigned char *) buffer,
+        .buffer_size = buffer_size,
+        .handler = handler,
+        .handler_arg = handler_arg
+    };
+    avs_error_t err = pkcs7_content_info_parse(&ctx);
+    if (avs_is_err(err)) {
+        return err;
+    }
+    // make sure that there is no trailing garbage
+    err = avs_stream_read_reliably(stream, ctx.buffer, 1);
+    if (avs_is_eof(err)) {
+        return AVS_OK;
+    } else if (avs_is_ok(err)) {
+        LOG(ERROR, _("Superfluous data after PKCS#7 ContentInfo"));
+        return avs_errno(AVS_EPROTO);
+    }
+    return err;
+}
+
+#endif // defined(AVS_COMMONS_WITH_AVS_CRYPTO) &&
+       // defined(AVS_COMMONS_WITH_AVS_CRYPTO_ADVANCED_FEATURES) &&
+       // defined(AVS_COMMONS_WITH_AVS_CRYPTO_PKI) &&
+       // defined(AVS_COMMONS_WITH_AVS_STREAM)
@@ -27,6 +27,7 @@
 
 #    include "avs_mbedtls_data_loader.h"
 #    include "avs_mbedtls_engine.h"
+#    include "avs_mbedtls_lazy_ca.h"
 
 #    include <assert.h>
 #    include <stdio.h>
@@ -149,8 +150,14 @@ static avs_error_t append_ca_from_path(mbedtls_x509_crt *chain,
 #    endif // MBEDTLS_FS_IO
 }
 
+/**
+ * Appends certificates described by @p info to @p out. If @p lazy_ca is not
+ * NULL, certificates from paths are not loaded, but added to @p *lazy_ca
+ * instead.
+ */
 static avs_error_t
 append_certs(mbedtls_x509_crt *out,
+             avs_crypto_mbedtls_lazy_ca_t **lazy_ca,
              const avs_crypto_certificate_chain_info_t *info) {
     switch (info->desc.source) {
     case AVS_CRYPTO_DATA_SOURCE_EMPTY:
@@ -178,6 +185,12 @@ append_certs(mbedtls_x509_crt *out,
                          "path=NULL"));
             return avs_errno(AVS_EINVAL);
         }
+#    ifdef AVS_COMMONS_WITH_MBEDTLS_LAZY_CA_PATH
+        if (lazy_ca) {
+            return _avs_crypto_mbedtls_lazy_ca_add_path(
+                    lazy_ca, info->desc.info.path.path);
+        }
+#    endif // AVS_COMMONS_WITH_MBEDTLS_LAZY_CA_PATH
         return append_ca_from_path(out, info->desc.info.path.path);
     case AVS_CRYPTO_DATA_SOURCE_BUFFER:
         if (!info->desc.info.buffer.buffer) {
@@ -194,7 +207,7 @@ append_certs(mbedtls_x509_crt *out,
              avs_is_ok(err) && i < info->desc.info.array.element_count;
              ++i) {
             err = append_certs(
-                    out,
+                    out, lazy_ca,
                     AVS_CONTAINER_OF(&info->desc.info.array.array_ptr[i],
                                      const avs_crypto_certificate_chain_info_t,
                                      desc));
@@ -206,7 +219,7 @@ append_certs(mbedtls_x509_crt *out,
         AVS_LIST(avs_crypto_security_info_union_t) entry;
         AVS_LIST_FOREACH(entry, info->desc.info.list.list_head) {
             avs_error_t err = append_certs(
-                    out,
+                    out, lazy_ca,
                     AVS_CONTAINER_OF(entry,
                                      const avs_crypto_certificate_chain_info_t,
                                      desc));
@@ -231,9 +244,10 @@ void _avs_crypto_mbedtls_x509_crt_cleanup(mbedtls_x509_crt **crt) {
     }
 }
 
-avs_error_t _avs_crypto_mbedtls_load_certs(
-        mbedtls_x509_crt **out,
-        const avs_crypto_certificate_chain_info_t *info) {
+static avs_error_t
+load_certs(mbedtls_x509_crt **out,
+           avs_crypto_mbedtls_lazy_ca_t **lazy_ca,
+           const avs_crypto_certificate_chain_info_t *info) {
     if (info == NULL) {
         LOG(ERROR, "Given cert info is empty.");
         return avs_errno(AVS_EINVAL);
@@ -246,13 +260,35 @@ avs_error_t _avs_crypto_mbedtls_load_certs(
         return avs_errno(AVS_ENOMEM);
     }
     mbedtls_x509_crt_init(*out);
-    avs_error_t err = append_certs(*out, info);
+    avs_error_t err = append_certs(*out, lazy_ca, info);
     if (avs_is_err(err)) {
         _avs_crypto_mbedtls_x509_crt_cleanup(out);
     }
     return err;
 }
 
+avs_error_t _avs_crypto_mbedtls_load_certs(
+        mbedtls_x509_crt **out,
+        const avs_crypto_certificate_chain_info_t *info) {
+    return load_certs(out, NULL, info);
+}
+
+#    ifdef AVS_COMMONS_WITH_MBEDTLS_LAZY_CA_PATH
+avs_error_t _avs_crypto_mbedtls_load_trust_store(
+        mbedtls_x509_crt **out,
+        avs_crypto_mbedtls_lazy_ca_t **out_lazy_ca,
+        const avs_crypto_certificate_chain_info_t *info) {
+    assert(!*out_lazy_ca);
+    avs_error_t err = load_certs(out, out_lazy_ca, info);
+    if (avs_is_err(err)) {
+        _avs_crypto_mbedtls_lazy_ca_cleanup(out_lazy_ca);
+    } else if (*out_lazy_ca) {
+        _avs_crypto_mbedtls_lazy_ca_set_certs(*out_lazy_ca, *out);
+    }
+    return err;
+}
+#    endif // AVS_COMMONS_WITH_MBEDTLS_LAZY_CA_PATH
+
 static avs_error_t
 append_crls(mbedtls_x509_crl *out,
             const avs_crypto_cert_revocation_list_info_t *info) {
@@ -22,6 +22,7 @@
 #include <avsystem/commons/avs_crypto_pki.h>
 
 #include "../avs_crypto_utils.h"
+#include "avs_mbedtls_lazy_ca.h"
 
 VISIBILITY_PRIVATE_HEADER_BEGIN
 
@@ -31,6 +32,19 @@ avs_error_t
 _avs_crypto_mbedtls_load_certs(mbedtls_x509_crt **out,
                                const avs_crypto_certificate_chain_info_t *info);
 
+#ifdef AVS_COMMONS_WITH_MBEDTLS_LAZY_CA_PATH
+/**
+ * Loads a trust store. Works like @ref _avs_crypto_mbedtls_load_certs, but
+ * certificates from paths are not loaded upfront. If any paths are present in
+ * @p info, @p *out_lazy_ca is set to a trust store that shall be used for
+ * verification through <c>mbedtls_ssl_conf_ca_cb()</c> instead of @p *out.
+ */
+avs_error_t _avs_crypto_mbedtls_load_trust_store(
+        mbedtls_x509_crt **out,
+        avs_crypto_mbedtls_lazy_ca_t **out_lazy_ca,
+        const avs_crypto_certificate_chain_info_t *info);
+#endif // AVS_COMMONS_WITH_MBEDTLS_LAZY_CA_PATH
+
 void _avs_crypto_mbedtls_x509_crl_cleanup(mbedtls_x509_crl **crl);
 
 avs_error_t _avs_crypto_mbedtls_load_crls(
@@ -0,0 +1,754 @@
+/*
+ * Copyright 2021 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define AVS_SUPPRESS_POISONING
+#include <avsystem/commons/avs_commons_config.h>
+
+#if defined(AVS_COMMONS_WITH_AVS_CRYPTO) && defined(AVS_COMMONS_WITH_MBEDTLS) \
+        && defined(AVS_COMMONS_WITH_AVS_CRYPTO_PKI)                          \
+        && defined(AVS_COMMONS_WITH_MBEDTLS_LAZY_CA_PATH)
+
+#    include <avs_commons_posix_init.h>
+
+#    include <avs_commons_init.h>
+
+#    include <dirent.h>
+#    include <sys/stat.h>
+
+// this uses some symbols such as "printf" - include it before poisoning them
+#    include <mbedtls/platform.h>
+
+#    include <mbedtls/asn1.h>
+#    include <mbedtls/pem.h>
+#    include <mbedtls/pk.h>
+#    include <mbedtls/x509_crt.h>
+
+#    include <avs_commons_poison.h>
+
+#    include "avs_mbedtls_lazy_ca.h"
+
+#    include <assert.h>
+#    include <stdlib.h>
+#    include <string.h>
+
+#    include <avsystem/commons/avs_init_once.h>
+#    include <avsystem/commons/avs_memory.h>
+#    include <avsystem/commons/avs_mutex.h>
+#    include <avsystem/commons/avs_utils.h>
+
+#    define MODULE_NAME avs_crypto_lazy_ca
+#    include <avs_x_log_config.h>
+
+#    ifndef MBEDTLS_X509_TRUSTED_CERTIFICATE_CALLBACK
+#        error "AVS_COMMONS_WITH_MBEDTLS_LAZY_CA_PATH requires Mbed TLS configured with MBEDTLS_X509_TRUSTED_CERTIFICATE_CALLBACK"
+#    endif // MBEDTLS_X509_TRUSTED_CERTIFICATE_CALLBACK
+
+#    ifndef AVS_COMMONS_MBEDTLS_LAZY_CA_CACHE_SIZE
+#        define AVS_COMMONS_MBEDTLS_LAZY_CA_CACHE_SIZE 16
+#    endif // AVS_COMMONS_MBEDTLS_LAZY_CA_CACHE_SIZE
+
+VISIBILITY_SOURCE_BEGIN
+
+#    define PEM_BEGIN_CRT "-----BEGIN CERTIFICATE-----"
+#    define PEM_END_CRT "-----END CERTIFICATE-----"
+
+#    define ASN1_SEQUENCE (MBEDTLS_ASN1_CONSTRUCTED | MBEDTLS_ASN1_SEQUENCE)
+
+/** Value of ca_entry_t::offset for files that contain a single DER cert. */
+#    define CA_ENTRY_DER_FILE UINT32_MAX
+
+/** Return value of cache_get_copy() if the certificate is not cached. */
+#    define CACHE_MISS 1
+
+typedef struct {
+    /** Hash of the DER-encoded subject name. */
+    uint32_t subject_hash;
+    /** Offset of the file name within ca_dir_t::names. */
+    uint32_t name_offset;
+    /** Offset of the PEM block within the file, or CA_ENTRY_DER_FILE. */
+    uint32_t offset;
+} ca_entry_t;
+
+typedef struct ca_dir_struct {
+    struct ca_dir_struct *next;
+    size_t refcount;
+    char *path;
+
+    /** Concatenated, NUL-terminated names of the indexed files. */
+    char *names;
+    size_t names_size;
+    size_t names_capacity;
+
+    /** Index entries, sorted by subject_hash after the scan is finished. */
+    ca_entry_t *entries;
+    size_t entry_count;
+    size_t entry_capacity;
+} ca_dir_t;
+
+typedef struct {
+    const ca_dir_t *dir;
+    size_t entry;
+    unsigned char *der;
+    size_t der_size;
+    uint64_t last_used;
+} ca_cache_slot_t;
+
+struct avs_crypto_mbedtls_lazy_ca_struct {
+    const mbedtls_x509_crt *certs;
+    size_t dir_count;
+    ca_dir_t *dirs[];
+};
+
+static avs_init_once_handle_t g_lazy_ca_init_handle;
+
+static struct {
+    /**
+     * Guards all other fields, and the next and refcount fields of all
+     * ca_dir_t objects. Other fields of ca_dir_t are immutable after the
+     * object is published on the list, and are read without locking.
+     */
+    avs_mutex_t *mutex;
+    ca_dir_t *dirs;
+    ca_cache_slot_t cache[AVS_COMMONS_MBEDTLS_LAZY_CA_CACHE_SIZE];
+    uint64_t cache_clock;
+} g_lazy_ca;
+
+static int init_globals(void *unused) {
+    (void) unused;
+    return avs_mutex_create(&g_lazy_ca.mutex);
+}
+
+static void nonfailing_mutex_lock(avs_mutex_t *mutex) {
+    if (avs_mutex_lock(mutex)) {
+        AVS_UNREACHABLE("could not lock mutex");
+    }
+}
+
+static uint32_t hash_name(const unsigned char *data, size_t size) {
+    // 32-bit FNV-1a
+    uint32_t hash = 2166136261U;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= data[i];
+        hash *= 16777619U;
+    }
+    return hash;
+}
+
+/**
+ * Finds the DER-encoded subject name in a DER-encoded certificate without
+ * parsing the whole certificate. The result is compatible with the
+ * <c>subject_raw</c> and <c>issuer_raw</c> fields of <c>mbedtls_x509_crt</c>.
+ */
+static int find_subject(const unsigned char *der,
+                        size_t der_size,
+                        const unsigned char **out_subject,
+                        size_t *out_subject_size) {
+    unsigned char *p = (unsigned char *) (intptr_t) der;
+    const unsigned char *end = der + der_size;
+    size_t len;
+    // Certificate ::= SEQUENCE { tbsCertificate TBSCertificate, ... }
+    if (mbedtls_asn1_get_tag(&p, end, &len, ASN1_SEQUENCE)) {
+        return -1;
+    }
+    end = p + len;
+    if (mbedtls_asn1_get_tag(&p, end, &len, ASN1_SEQUENCE)) {
+        return -1;
+    }
+    end = p + len;
+    // version [0] EXPLICIT Version DEFAULT v1
+    if (!mbedtls_asn1_get_tag(&p, end, &len,
+                              MBEDTLS_ASN1_CONTEXT_SPECIFIC
+                                      | MBEDTLS_ASN1_CONSTRUCTED | 0)) {
+        p += len;
+    }
+    // serialNumber, signature, issuer, validity
+    if (mbedtls_asn1_get_tag(&p, end, &len, MBEDTLS_ASN1_INTEGER)) {
+        return -1;
+    }
+    p += len;
+    for (int i = 0; i < 3; ++i) {
+        if (mbedtls_asn1_get_tag(&p, end, &len, ASN1_SEQUENCE)) {
+            return -1;
+        }
+        p += len;
+    }
+    const unsigned char *subject = p;
+    if (mbedtls_asn1_get_tag(&p, end, &len, ASN1_SEQUENCE)) {
+        return -1;
+    }
+    *out_subject = subject;
+    *out_subject_size = (size_t) (p + len - subject);
+    return 0;
+}
+
+static bool names_equal(const unsigned char *subject,
+                        size_t subject_size,
+                        const mbedtls_x509_buf *name) {
+    return subject_size == name->len && !memcmp(subject, name->p, name->len);
+}
+
+/**
+ * Grows an array allocated with avs_realloc() so that it can hold at least
+ * @p needed elements. Returns the new array, or NULL on allocation failure
+ * (the original array is left intact in that case).
+ */
+static void *ensure_capacity(void *ptr,
+                             size_t *capacity,
+                             size_t needed,
+                             size_t element_size) {
+    if (needed <= *capacity) {
+        return ptr;
+    }
+    size_t new_capacity = *capacity ? *capacity : 16;
+    while (new_capacity < needed) {
+        new_capacity *= 2;
+    }
+    void *new_ptr = avs_realloc(ptr, new_capacity * element_size);
+    if (new_ptr) {
+        *capacity = new_capacity;
+    }
+    return new_ptr;
+}
+
+static avs_error_t add_name(ca_dir_t *dir,
+                            const char *name,
+                            uint32_t *out_name_offset) {
+    size_t size = strlen(name) + 1;
+    if (dir->names_size + size > UINT32_MAX) {
+        return avs_errno(AVS_E2BIG);
+    }
+    char *names = (char *) ensure_capacity(dir->names, &dir->names_capacity,
+                                           dir->names_size + size, 1);
+    if (!names) {
+        return avs_errno(AVS_ENOMEM);
+    }
+    dir->names = names;
+    memcpy(dir->names + dir->names_size, name, size);
+    *out_name_offset = (uint32_t) dir->names_size;
+    dir->names_size += size;
+    return AVS_OK;
+}
+
+static avs_error_t add_entry(ca_dir_t *dir,
+                             const unsigned char *der,
+                             size_t der_size,
+                             uint32_t name_offset,
+                             uint32_t offset) {
+    const unsigned char *subject;
+    size_t subject_size;
+    if (find_subject(der, der_size, &subject, &subject_size)) {
+        // not a certificate - ignore, just like mbedtls_x509_crt_parse_path()
+        return AVS_OK;
+    }
+    ca_entry_t *entries = (ca_entry_t *) ensure_capacity(
+            dir->entries, &dir->entry_capacity, dir->entry_count + 1,
+            sizeof(ca_entry_t));
+    if (!entries) {
+        return avs_errno(AVS_ENOMEM);
+    }
+    dir->entries = entries;
+    ca_entry_t *entry = &dir->entries[dir->entry_count++];
+    entry->subject_hash = hash_name(subject, subject_size);
+    entry->name_offset = name_offset;
+    entry->offset = offset;
+    return AVS_OK;
+}
+
+static char *make_file_path(const char *dir_path, const char *name) {
+    size_t dir_path_len = strlen(dir_path);
+    size_t name_len = strlen(name);
+    char *result = (char *) avs_malloc(dir_path_len + name_len + 2);
+    if (result) {
+        memcpy(result, dir_path, dir_path_len);
+        result[dir_path_len] = '/';
+        memcpy(result + dir_path_len + 1, name, name_len + 1);
+    }
+    return result;
+}
+
+#    ifdef MBEDTLS_PEM_PARSE_C
+/**
+ * Decodes the PEM certificate block that starts at @p block. On success,
+ * @p *out_der is allocated using mbedtls_calloc().
+ */
+static int decode_pem_block(const unsigned char *block,
+                            unsigned char **out_der,
+                            size_t *out_der_size,
+                            size_t *out_block_size) {
+    mbedtls_pem_context pem;
+    mbedtls_pem_init(&pem);
+    int result = mbedtls_pem_read_buffer(&pem, PEM_BEGIN_CRT, PEM_END_CRT,
+                                         block, NULL, 0, out_block_size);
+    if (!result) {
+        if (!(*out_der = (unsigned char *) mbedtls_calloc(1, pem.buflen))) {
+            result = MBEDTLS_ERR_X509_ALLOC_FAILED;
+        } else {
+            memcpy(*out_der, pem.buf, pem.buflen);
+            *out_der_size = pem.buflen;
+        }
+    }
+    mbedtls_pem_free(&pem);
+    return result;
+}
+#    endif // MBEDTLS_PEM_PARSE_C
+
+static avs_error_t index_file(ca_dir_t *dir, const char *name) {
+    char *file_path = make_file_path(dir->path, name);
+    if (!file_path) {
+        return avs_errno(AVS_ENOMEM);
+    }
+    struct stat st;
+    unsigned char *buf = NULL;
+    size_t size;
+    // mbedtls_pk_load_file() NUL-terminates the buffer
+    if (stat(file_path, &st) || !S_ISREG(st.st_mode)
+            || (uint64_t) st.st_size >= UINT32_MAX
+            || mbedtls_pk_load_file(file_path, &buf, &size)) {
+        avs_free(file_path);
+        // skip unreadable files, just like mbedtls_x509_crt_parse_path()
+        return AVS_OK;
+    }
+    avs_free(file_path);
+
+    uint32_t name_offset;
+    avs_error_t err = add_name(dir, name, &name_offset);
+    if (avs_is_err(err)) {
+        mbedtls_free(buf);
+        return err;
+    }
+
+    size_t entry_count = dir->entry_count;
+#    ifdef MBEDTLS_PEM_PARSE_C
+    const char *block = strstr((const char *) buf, PEM_BEGIN_CRT);
+    if (block) {
+        while (avs_is_ok(err) && block) {
+            unsigned char *der;
+            size_t der_size;
+            size_t block_size;
+            int result = decode_pem_block((const unsigned char *) block, &der,
+                                          &der_size, &block_size);
+            if (result == MBEDTLS_ERR_X509_ALLOC_FAILED) {
+                err = avs_errno(AVS_ENOMEM);
+            } else if (result) {
+                block = strstr(block + 1, PEM_BEGIN_CRT);
+            } else {
+                err = add_entry(dir, der, der_size, name_offset,
+                                (uint32_t) ((const unsigned char *) block
+                                            - buf));
+                mbedtls_free(der);
+                block = strstr(block + block_size, PEM_BEGIN_CRT);
+            }
+        }
+    } else
+#    endif // MBEDTLS_PEM_PARSE_C
+    {
+        err = add_entry(dir, buf, size, name_offset, CA_ENTRY_DER_FILE);
+    }
+    mbedtls_free(buf);
+
+    if (avs_is_ok(err) && dir->entry_count == entry_count) {
+        // nothing indexed - forget the file name
+        dir->names_size = name_offset;
+    }
+    return err;
+}
+
+static int entry_cmp(const void *a_, const void *b_) {
+    const ca_entry_t *a = (const ca_entry_t *) a_;
+    const ca_entry_t *b = (const ca_entry_t *) b_;
+    return a->subject_hash < b->subject_hash
+                   ? -1
+                   : (a->subject_hash > b->subject_hash ? 1 : 0);
+}
+
+static avs_error_t scan_dir(ca_dir_t *dir) {
+    DIR *dirp = opendir(dir->path);
+    if (!dirp) {
+        LOG(ERROR, _("certificates from path <") "%s" _(">: cannot open"),
+            dir->path);
+        return avs_errno(AVS_EIO);
+    }
+    avs_error_t err = AVS_OK;
+    const struct dirent *ent;
+    while (avs_is_ok(err) && (ent = readdir(dirp))) {
+        if (strcmp(ent->d_name, ".") && strcmp(ent->d_name, "..")) {
+            err = index_file(dir, ent->d_name);
+        }
+    }
+    closedir(dirp);
+    if (avs_is_ok(err)) {
+        qsort(dir->entries, dir->entry_count, sizeof(ca_entry_t), entry_cmp);
+        LOG(DEBUG,
+            _("certificates from path <") "%s" _(">: indexed ") "%lu" _(
+                    " certificates"),
+            dir->path, (unsigned long) dir->entry_count);
+    }
+    return err;
+}
+
+static void dir_free(ca_dir_t *dir) {
+    avs_free(dir->path);
+    avs_free(dir->names);
+    avs_free(dir->entries);
+    avs_free(dir);
+}
+
+static ca_dir_t *dir_find_locked(const char *path) {
+    for (ca_dir_t *dir = g_lazy_ca.dirs; dir; dir = dir->next) {
+        if (!strcmp(dir->path, path)) {
+            return dir;
+        }
+    }
+    return NULL;
+}
+
+static avs_error_t dir_acquire(const char *path, ca_dir_t **out_dir) {
+    nonfailing_mutex_lock(g_lazy_ca.mutex);
+    ca_dir_t *dir = dir_find_locked(path);
+    if (dir) {
+        ++dir->refcount;
+    }
+    avs_mutex_unlock(g_lazy_ca.mutex);
+    if (dir) {
+        *out_dir = dir;
+        return AVS_OK;
+    }
+
+    // the directory is scanned without holding the lock, so that certificate
+    // verifications in other threads are not blocked by the disk I/O
+    dir = (ca_dir_t *) avs_calloc(1, sizeof(ca_dir_t));
+    if (!dir || !(dir->path = avs_strdup(path))) {
+        avs_free(dir);
+        return avs_errno(AVS_ENOMEM);
+    }
+    avs_error_t err = scan_dir(dir);
+    if (avs_is_err(err)) {
+        dir_free(dir);
+        return err;
+    }
+
+    nonfailing_mutex_lock(g_lazy_ca.mutex);
+    ca_dir_t *existing = dir_find_locked(path);
+    if (existing) {
+        // scanned concurrently by another thread
+        ++existing->refcount;
+    } else {
+        dir->refcount = 1;
+        dir->next = g_lazy_ca.dirs;
+        g_lazy_ca.dirs = dir;
+    }
+    avs_mutex_unlock(g_lazy_ca.mutex);
+    if (existing) {
+        dir_free(dir);
+        dir = existing;
+    }
+    *out_dir = dir;
+    return AVS_OK;
+}
+
+static void dir_release_locked(ca_dir_t *dir) {
+    if (--dir->refcount) {
+        return;
+    }
+    for (size_t i = 0; i < AVS_ARRAY_SIZE(g_lazy_ca.cache); ++i) {
+        if (g_lazy_ca.cache[i].dir == dir) {
+            mbedtls_free(g_lazy_ca.cache[i].der);
+            memset(&g_lazy_ca.cache[i], 0, sizeof(g_lazy_ca.cache[i]));
+        }
+    }
+    ca_dir_t **dir_ptr = &g_lazy_ca.dirs;
+    while (*dir_ptr != dir) {
+        dir_ptr = &(*dir_ptr)->next;
+    }
+    *dir_ptr = dir->next;
+    dir_free(dir);
+}
+
+static int load_entry(const ca_dir_t *dir,
+                      const ca_entry_t *entry,
+                      unsigned char **out_der,
+                      size_t *out_der_size) {
+    char *file_path =
+            make_file_path(dir->path, dir->names + entry->name_offset);
+    if (!file_path) {
+        return MBEDTLS_ERR_X509_ALLOC_FAILED;
+    }
+    unsigned char *buf;
+    size_t size;
+    int result = mbedtls_pk_load_file(file_path, &buf, &size);
+    if (result) {
+        LOG(WARNING, _("certificate <") "%s" _(">: failed to load"),
+            file_path);
+    }
+    avs_free(file_path);
+    if (result) {
+        return result;
+    }
+    if (entry->offset == CA_ENTRY_DER_FILE) {
+        *out_der = buf;
+        *out_der_size = size;
+        return 0;
+    }
+#    ifdef MBEDTLS_PEM_PARSE_C
+    size_t block_size;
+    if (entry->offset >= size) {
+        // the file has been truncated since it was indexed
+        result = MBEDTLS_ERR_X509_FILE_IO_ERROR;
+    } else {
+        result = decode_pem_block(buf + entry->offset, out_der, out_der_size,
+                                  &block_size);
+    }
+#    else  // MBEDTLS_PEM_PARSE_C
+    result = MBEDTLS_ERR_X509_FEATURE_UNAVAILABLE;
+#    endif // MBEDTLS_PEM_PARSE_C
+    mbedtls_free(buf);
+    return result;
+}
+
+static ca_cache_slot_t *cache_find_locked(const ca_dir_t *dir,
+                                          size_t entry_index) {
+    for (size_t i = 0; i < AVS_ARRAY_SIZE(g_lazy_ca.cache); ++i) {
+        if (g_lazy_ca.cache[i].dir == dir
+                && g_lazy_ca.cache[i].entry == entry_index) {
+            return &g_lazy_ca.cache[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Copies the cached DER-encoded certificate for dir->entries[entry_index].
+ * The copy is allocated using mbedtls_calloc().
+ *
+ * @returns 0 on success, CACHE_MISS if the certificate is not cached, or
+ *          MBEDTLS_ERR_X509_ALLOC_FAILED.
+ */
+static int cache_get_copy(const ca_dir_t *dir,
+                          size_t entry_index,
+                          unsigned char **out_der,
+                          size_t *out_der_size) {
+    int result = CACHE_MISS;
+    nonfailing_mutex_lock(g_lazy_ca.mutex);
+    ca_cache_slot_t *slot = cache_find_locked(dir, entry_index);
+    if (slot) {
+        if (!(*out_der = (unsigned char *) mbedtls_calloc(1, slot->der_size))) {
+            result = MBEDTLS_ERR_X509_ALLOC_FAILED;
+        } else {
+            memcpy(*out_der, slot->der, slot->der_size);
+            *out_der_size = slot->der_size;
+            slot->last_used = ++g_lazy_ca.cache_clock;
+            result = 0;
+        }
+    }
+    avs_mutex_unlock(g_lazy_ca.mutex);
+    return result;
+}
+
+/**
+ * Stores the DER-encoded certificate for dir->entries[entry_index] in the
+ * cache, evicting the least recently used one. Takes ownership of @p der.
+ */
+static void cache_put(const ca_dir_t *dir,
+                      size_t entry_index,
+                      unsigned char *der,
+                      size_t der_size) {
+    nonfailing_mutex_lock(g_lazy_ca.mutex);
+    ca_cache_slot_t *slot = cache_find_locked(dir, entry_index);
+    if (slot) {
+        // loaded concurrently by another thread
+        mbedtls_free(der);
+    } else {
+        slot = &g_lazy_ca.cache[0];
+        for (size_t i = 1; i < AVS_ARRAY_SIZE(g_lazy_ca.cache); ++i) {
+            if (g_lazy_ca.cache[i].last_used < slot->last_used) {
+                slot = &g_lazy_ca.cache[i];
+            }
+        }
+        mbedtls_free(slot->der);
+        slot->dir = dir;
+        slot->entry = entry_index;
+        slot->der = der;
+        slot->der_size = der_size;
+    }
+    slot->last_used = ++g_lazy_ca.cache_clock;
+    avs_mutex_unlock(g_lazy_ca.mutex);
+}
+
+static int append_candidate(mbedtls_x509_crt **candidates,
+                            const unsigned char *der,
+                            size_t der_size) {
+    if (!*candidates) {
+        if (!(*candidates = (mbedtls_x509_crt *) mbedtls_calloc(
+                      1, sizeof(**candidates)))) {
+            return MBEDTLS_ERR_X509_ALLOC_FAILED;
+        }
+        mbedtls_x509_crt_init(*candidates);
+    }
+    for (const mbedtls_x509_crt *crt = *candidates; crt && crt->version;
+         crt = crt->next) {
+        if (crt->raw.len == der_size && !memcmp(crt->raw.p, der, der_size)) {
+            // the same certificate is present in multiple files
+            return 0;
+        }
+    }
+    int result = mbedtls_x509_crt_parse_der(*candidates, der, der_size);
+    // ignore certificates that cannot be parsed
+    return result == MBEDTLS_ERR_X509_ALLOC_FAILED ? result : 0;
+}
+
+/**
+ * Appends the certificates from @p dir whose subject is @p issuer to
+ * @p candidates. The index is immutable once published, so it is searched
+ * without locking; the mutex is only held to access the cache, and files
+ * are loaded and parsed outside of it.
+ */
+static int find_in_dir(const ca_dir_t *dir,
+                       const mbedtls_x509_buf *issuer,
+                       uint32_t issuer_hash,
+                       mbedtls_x509_crt **candidates) {
+    size_t lo = 0;
+    size_t hi = dir->entry_count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (dir->entries[mid].subject_hash < issuer_hash) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    for (; lo < dir->entry_count
+           && dir->entries[lo].subject_hash == issuer_hash;
+         ++lo) {
+        unsigned char *der;
+        size_t der_size;
+        bool loaded = false;
+        int result = cache_get_copy(dir, lo, &der, &der_size);
+        if (result == CACHE_MISS) {
+            result = load_entry(dir, &dir->entries[lo], &der, &der_size);
+            loaded = !result;
+        }
+        if (result == MBEDTLS_ERR_X509_ALLOC_FAILED) {
+            return result;
+        } else if (result) {
+            continue;
+        }
+        const unsigned char *subject;
+        size_t subject_size;
+        if (!find_subject(der, der_size, &subject, &subject_size)
+                && names_equal(subject, subject_size, issuer)) {
+            result = append_candidate(candidates, der, der_size);
+        }
+        if (loaded) {
+            cache_put(dir, lo, der, der_size);
+        } else {
+            mbedtls_free(der);
+        }
+        if (result) {
+            return result;
+        }
+    }
+    return 0;
+}
+
+int _avs_crypto_mbedtls_lazy_ca_find_issuers(
+        void *lazy_ca_,
+        const mbedtls_x509_crt *child,
+        mbedtls_x509_crt **out_candidate_cas) {
+    const avs_crypto_mbedtls_lazy_ca_t *lazy_ca =
+            (const avs_crypto_mbedtls_lazy_ca_t *) lazy_ca_;
+    int result = 0;
+    *out_candidate_cas = NULL;
+    for (const mbedtls_x509_crt *crt = lazy_ca->certs; !result && crt;
+         crt = crt->next) {
+        if (crt->version
+                && names_equal(crt->subject_raw.p, crt->subject_raw.len,
+                               &child->issuer_raw)) {
+            result = append_candidate(out_candidate_cas, crt->raw.p,
+                                      crt->raw.len);
+        }
+    }
+    if (!result && lazy_ca->dir_count) {
+        uint32_t issuer_hash =
+                hash_name(child->issuer_raw.p, child->issuer_raw.len);
+        for (size_t i = 0; !result && i < lazy_ca->dir_count; ++i) {
+            result = find_in_dir(lazy_ca->dirs[i], &child->issuer_raw,
+                                 issuer_hash, out_candidate_cas);
+        }
+    }
+    if (result && *out_candidate_cas) {
+        mbedtls_x509_crt_free(*out_candidate_cas);
+        mbedtls_free(*out_candidate_cas);
+        *out_candidate_cas = NULL;
+    }
+    return result;
+}
+
+avs_error_t
+_avs_crypto_mbedtls_lazy_ca_add_path(avs_crypto_mbedtls_lazy_ca_t **lazy_ca_ptr,
+                                     const char *path) {
+    assert(lazy_ca_ptr);
+    assert(path);
+    if (avs_init_once(&g_lazy_ca_init_handle, init_globals, NULL)) {
+        return avs_errno(AVS_ENOMEM);
+    }
+    size_t dir_count = *lazy_ca_ptr ? (*lazy_ca_ptr)->dir_count : 0;
+    avs_crypto_mbedtls_lazy_ca_t *lazy_ca =
+            (avs_crypto_mbedtls_lazy_ca_t *) avs_realloc(
+                    *lazy_ca_ptr,
+                    sizeof(avs_crypto_mbedtls_lazy_ca_t)
+                            + (dir_count + 1) * sizeof(ca_dir_t *));
+    if (!lazy_ca) {
+        return avs_errno(AVS_ENOMEM);
+    }
+    if (!*lazy_ca_ptr) {
+        lazy_ca->certs = NULL;
+        lazy_ca->dir_count = 0;
+    }
+    *lazy_ca_ptr = lazy_ca;
+
+    ca_dir_t *dir;
+    avs_error_t err = dir_acquire(path, &dir);
+    if (avs_is_ok(err)) {
+        lazy_ca->dirs[lazy_ca->dir_count++] = dir;
+    }
+    return err;
+}
+
+void _avs_crypto_mbedtls_lazy_ca_set_certs(
+        avs_crypto_mbedtls_lazy_ca_t *lazy_ca, const mbedtls_x509_crt *certs) {
+    lazy_ca->certs = certs;
+}
+
+void _avs_crypto_mbedtls_lazy_ca_cleanup(
+        avs_crypto_mbedtls_lazy_ca_t **lazy_ca_ptr) {
+    if (!lazy_ca_ptr || !*lazy_ca_ptr) {
+        return;
+    }
+    if ((*lazy_ca_ptr)->dir_count) {
+        nonfailing_mutex_lock(g_lazy_ca.mutex);
+        for (size_t i = 0; i < (*lazy_ca_ptr)->dir_count; ++i) {
+            dir_release_locked((*lazy_ca_ptr)->dirs[i]);
+        }
+        avs_mutex_unlock(g_lazy_ca.mutex);
+    }
+    avs_free(*lazy_ca_ptr);
+    *lazy_ca_ptr = NULL;
+}
+
+#endif // defined(AVS_COMMONS_WITH_AVS_CRYPTO) &&
+       // defined(AVS_COMMONS_WITH_MBEDTLS) &&
+       // defined(AVS_COMMONS_WITH_AVS_CRYPTO_PKI) &&
+       // defined(AVS_COMMONS_WITH_MBEDTLS_LAZY_CA_PATH)
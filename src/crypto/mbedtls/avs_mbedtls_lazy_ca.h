@@ -0,0 +1,97 @@
+/*
+ * Copyright 2021 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CRYPTO_MBEDTLS_LAZY_CA_H
+#define CRYPTO_MBEDTLS_LAZY_CA_H
+
+#include <mbedtls/x509_crt.h>
+
+#include <avsystem/commons/avs_errno.h>
+
+VISIBILITY_PRIVATE_HEADER_BEGIN
+
+/**
+ * Trust store that consists of certificate directories that are indexed by
+ * subject name and loaded only when needed during chain verification, and
+ * optionally of a chain of certificates loaded upfront from other sources.
+ *
+ * Directory indexes and the cache of loaded certificates are shared between
+ * all trust stores in the process.
+ */
+typedef struct avs_crypto_mbedtls_lazy_ca_struct avs_crypto_mbedtls_lazy_ca_t;
+
+#ifdef AVS_COMMONS_WITH_MBEDTLS_LAZY_CA_PATH
+
+/**
+ * Adds a certificate directory to the trust store, allocating it if necessary.
+ *
+ * The directory is scanned only if no other trust store currently refers to
+ * the same @p path. The scan only decodes PEM blocks to find subject names;
+ * certificates are not parsed.
+ *
+ * @param lazy_ca_ptr Pointer to a variable holding the trust store. If it
+ *                    points to NULL, a new trust store is allocated.
+ *
+ * @param path        Path to the directory.
+ */
+avs_error_t
+_avs_crypto_mbedtls_lazy_ca_add_path(avs_crypto_mbedtls_lazy_ca_t **lazy_ca_ptr,
+                                     const char *path);
+
+/**
+ * Sets the chain of certificates loaded upfront, to be searched in addition to
+ * the directories. The chain is NOT owned by the trust store, and needs to
+ * outlive it.
+ */
+void _avs_crypto_mbedtls_lazy_ca_set_certs(
+        avs_crypto_mbedtls_lazy_ca_t *lazy_ca, const mbedtls_x509_crt *certs);
+
+void _avs_crypto_mbedtls_lazy_ca_cleanup(
+        avs_crypto_mbedtls_lazy_ca_t **lazy_ca_ptr);
+
+/**
+ * Finds the trusted certificates that may be issuers of @p child.
+ *
+ * This function is compatible with <c>mbedtls_x509_crt_ca_cb_t</c>, and is
+ * meant to be passed to <c>mbedtls_ssl_conf_ca_cb()</c> or
+ * <c>mbedtls_x509_crt_verify_with_ca_cb()</c>.
+ *
+ * @param lazy_ca            Trust store (@ref avs_crypto_mbedtls_lazy_ca_t).
+ *
+ * @param child              Certificate to find issuers for.
+ *
+ * @param out_candidate_cas  Pointer to a variable that will be set to a newly
+ *                           allocated chain of candidate certificates, or NULL
+ *                           if none are found. The chain shall be freed using
+ *                           <c>mbedtls_x509_crt_free()</c> and
+ *                           <c>mbedtls_free()</c>.
+ *
+ * @returns 0 on success, or a negative Mbed TLS error code.
+ */
+int _avs_crypto_mbedtls_lazy_ca_find_issuers(
+        void *lazy_ca,
+        const mbedtls_x509_crt *child,
+        mbedtls_x509_crt **out_candidate_cas);
+
+#else // AVS_COMMONS_WITH_MBEDTLS_LAZY_CA_PATH
+
+#    define _avs_crypto_mbedtls_lazy_ca_cleanup(...) ((void) 0)
+
+#endif // AVS_COMMONS_WITH_MBEDTLS_LAZY_CA_PATH
+
+VISIBILITY_PRIVATE_HEADER_END
+
+#endif // CRYPTO_MBEDTLS_LAZY_CA_H
@@ -57,6 +57,9 @@ void avs_http_free(avs_http_t *http) {
     if (http) {
         avs_http_clear_cookies(http);
         avs_free(http->user_agent);
+#    ifdef AVS_COMMONS_NET_WITH_UNIX_SOCKETS
+        avs_free(http->unix_socket_path);
+#    endif // AVS_COMMONS_NET_WITH_UNIX_SOCKETS
         avs_free(http);
     }
 }
@@ -95,6 +98,21 @@ int avs_http_set_user_agent(avs_http_t *http, const char *user_agent) {
     return 0;
 }
 
+#    ifdef AVS_COMMONS_NET_WITH_UNIX_SOCKETS
+int avs_http_set_unix_socket_path(avs_http_t *http, const char *path) {
+    char *new_path = NULL;
+    if (path) {
+        if (!(new_path = avs_strdup(path))) {
+            LOG(ERROR, _("Out of memory"));
+            return -1;
+        }
+    }
+    avs_free(http->unix_socket_path);
+    http->unix_socket_path = new_path;
+    return 0;
+}
+#    endif // AVS_COMMONS_NET_WITH_UNIX_SOCKETS
+
 void avs_http_clear_cookies(avs_http_t *http) {
     AVS_LIST_CLEAR(&http->cookies);
     http->use_cookie2 = false;
@@ -35,6 +35,10 @@ struct avs_http {
 
     char *user_agent;
 
+#ifdef AVS_COMMONS_NET_WITH_UNIX_SOCKETS
+    char *unix_socket_path;
+#endif // AVS_COMMONS_NET_WITH_UNIX_SOCKETS
+
     avs_http_ssl_pre_connect_cb_t *ssl_pre_connect_cb;
     void *ssl_pre_connect_cb_arg;
 
@@ -212,7 +212,8 @@ int _avs_http_content_decoder_create(
 
     case AVS_HTTP_CONTENT_GZIP:
         *out_decoder = _avs_http_create_decompressor(
-                HTTP_COMPRESSION_GZIP, HTTP_DECOMPRESSOR_WINDOW_BITS_DEFAULT,
+                AVS_STREAM_COMPRESSION_GZIP,
+                HTTP_COMPRESSOR_WINDOW_BITS_DEFAULT,
                 buffer_sizes->content_coding_input,
                 HTTP_CONTENT_CODING_OUT_BUF_SIZE(buffer_sizes));
         return *out_decoder ? 0 : -1;
@@ -223,7 +224,8 @@ int _avs_http_content_decoder_create(
 
     case AVS_HTTP_CONTENT_DEFLATE:
         *out_decoder = _avs_http_create_decompressor(
-                HTTP_COMPRESSION_ZLIB, HTTP_DECOMPRESSOR_WINDOW_BITS_DEFAULT,
+                AVS_STREAM_COMPRESSION_ZLIB,
+                HTTP_COMPRESSOR_WINDOW_BITS_DEFAULT,
                 buffer_sizes->content_coding_input,
                 HTTP_CONTENT_CODING_OUT_BUF_SIZE(buffer_sizes));
         return *out_decoder ? 0 : -1;
@@ -240,10 +242,10 @@ int _avs_http_encoding_init(http_stream_t *stream) {
         return 0;
     }
     stream->encoder = _avs_http_create_compressor(
-            stream->encoding == AVS_HTTP_CONTENT_GZIP ? HTTP_COMPRESSION_GZIP
-                                                      : HTTP_COMPRESSION_ZLIB,
-            HTTP_COMPRESSOR_LEVEL_DEFAULT, HTTP_COMPRESSOR_WINDOW_BITS_DEFAULT,
-            HTTP_COMPRESSOR_MEM_LEVEL_DEFAULT,
+            stream->encoding == AVS_HTTP_CONTENT_GZIP
+                    ? AVS_STREAM_COMPRESSION_GZIP
+                    : AVS_STREAM_COMPRESSION_ZLIB,
+            HTTP_COMPRESSOR_WINDOW_BITS_DEFAULT,
             stream->http->buffer_sizes.content_coding_input,
             HTTP_CONTENT_CODING_OUT_BUF_SIZE(&stream->http->buffer_sizes));
     return stream->encoder ? 0 : -1;
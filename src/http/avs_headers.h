@@ -33,6 +33,23 @@ avs_error_t _avs_http_send_headers(http_stream_t *stream,
 
 avs_error_t _avs_http_receive_headers(http_stream_t *stream);
 
+/**
+ * Parses a decimal size value, such as the value of a Content-Length header.
+ * Leading whitespace is allowed.
+ *
+ * @returns 0 for success, or -1 if the value is not a valid size.
+ */
+int _avs_http_parse_size(size_t *out, const char *in);
+
+/**
+ * Splits a "Key: Value" header line in place, replacing the colon and any
+ * whitespace after it with null bytes.
+ *
+ * @returns Pointer to the header value within @p line, or NULL if there is no
+ *          colon in the line.
+ */
+const char *_avs_http_header_split(char *line);
+
 VISIBILITY_PRIVATE_HEADER_END
 
 #endif /* AVS_COMMONS_HTTP_HEADERS_H */
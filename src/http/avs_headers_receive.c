@@ -26,6 +26,7 @@
 
 #    include <avsystem/commons/avs_errno.h>
 #    include <avsystem/commons/avs_memory.h>
+#    include <avsystem/commons/avs_trace.h>
 #    include <avsystem/commons/avs_utils.h>
 
 #    include "avs_body_receivers.h"
@@ -47,7 +48,7 @@ typedef struct {
     char header_buf[];
 } header_parser_state_t;
 
-static int parse_size(size_t *out, const char *in) {
+int _avs_http_parse_size(size_t *out, const char *in) {
     char *endptr = NULL;
     while (*in && isspace((unsigned char) *in)) {
         ++in;
@@ -81,7 +82,7 @@ static int http_handle_header(const char *key,
         }
     } else if (avs_strcasecmp(key, "Content-Length") == 0) {
         if (state->transfer_encoding != TRANSFER_IDENTITY
-                || parse_size(&state->content_length, value)) {
+                || _avs_http_parse_size(&state->content_length, value)) {
             return -1;
         }
         state->transfer_encoding = TRANSFER_LENGTH;
@@ -112,7 +113,12 @@ static int http_handle_header(const char *key,
     } else if (state->stream->status / 100 == 3
                && avs_strcasecmp(key, "Location") == 0) {
         avs_url_free(state->redirect_url);
-        state->redirect_url = avs_url_parse(value);
+        // relative references are allowed since RFC 7231
+        if ((state->redirect_url = avs_url_resolve(state->stream->url, value))
+                && avs_url_validate(state->redirect_url)) {
+            avs_url_free(state->redirect_url);
+            state->redirect_url = NULL;
+        }
     } else {
         *out_header_handled = false;
         LOG(DEBUG, _("Unhandled HTTP header: ") "%s" _(": ") "%s", key, value);
@@ -161,7 +167,7 @@ static avs_error_t get_http_header_line(avs_stream_t *stream,
     return AVS_OK;
 }
 
-static const char *http_header_split(char *line) {
+const char *_avs_http_header_split(char *line) {
     char *value = strchr(line, ':');
     if (value && *value) {
         *value++ = '\0';
@@ -188,7 +194,7 @@ static avs_error_t http_receive_headers_internal(header_parser_state_t *state) {
         }
         LOG(TRACE, _("HTTP header: ") "%s", state->header_buf);
         bool header_handled;
-        if (!(value = http_header_split(state->header_buf))
+        if (!(value = _avs_http_header_split(state->header_buf))
                 || http_handle_header(state->header_buf, value, state,
                                       &header_handled)) {
             LOG(ERROR, _("Error parsing or handling headers"));
@@ -352,11 +358,13 @@ update_flags_after_receiving_headers(http_stream_t *stream,
 
 avs_error_t _avs_http_receive_headers(http_stream_t *stream) {
     avs_error_t err = AVS_OK;
+    AVS_TRACE_BEGIN("http", "receive_headers");
 
     /* The only case where we don't want to ignore 100-Continue messages is
-     * just after sending chunked message headers - in such case, we need to
-     * return to the upper layer to prepare chunked message body. */
-    bool skip_100_continue = !stream->flags.chunked_sending;
+     * just after sending chunked or known-length message headers - in such
+     * case, we need to return to the upper layer to send the message body. */
+    bool skip_100_continue =
+            !stream->flags.chunked_sending && !stream->flags.length_sending;
 
     LOG(TRACE, _("receiving headers, ") "%ssk" _("ipping 100 Continue"),
         skip_100_continue ? "" : "NOT ");
@@ -397,6 +405,7 @@ avs_error_t _avs_http_receive_headers(http_stream_t *stream) {
     }
 
     update_flags_after_receiving_headers(stream, err);
+    AVS_TRACE_END("http", "receive_headers");
     return err;
 }
 
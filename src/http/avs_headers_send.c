@@ -106,14 +106,17 @@ avs_error_t _avs_http_send_headers(http_stream_t *stream,
             return err;
         }
     }
+    if ((content_length == (size_t) -1 || stream->flags.length_sending)
+            && !stream->flags.no_expect
+            && avs_is_err((err = avs_stream_write_f(
+                                   stream->backend,
+                                   "Expect: 100-continue\r\n")))) {
+        return err;
+    }
     if (content_length == (size_t) -1) {
-        if ((!stream->flags.no_expect
-             && avs_is_err(
-                        (err = avs_stream_write_f(stream->backend,
-                                                  "Expect: 100-continue\r\n"))))
-                || avs_is_err((err = avs_stream_write_f(
-                                       stream->backend,
-                                       "Transfer-Encoding: chunked\r\n")))) {
+        if (avs_is_err((err = avs_stream_write_f(
+                                stream->backend,
+                                "Transfer-Encoding: chunked\r\n")))) {
             return err;
         }
     } else if (content_length > 0 || stream->method != AVS_HTTP_GET) {
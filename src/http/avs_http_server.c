@@ -0,0 +1,1132 @@
+/*
+ * Copyright 2021 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <avs_commons_init.h>
+
+#if defined(AVS_COMMONS_WITH_AVS_HTTP) && defined(AVS_COMMONS_HTTP_WITH_SERVER)
+
+#    include <avs_commons_posix_init.h>
+
+#    include <assert.h>
+#    include <limits.h>
+#    include <string.h>
+
+#    include <avsystem/commons/avs_errno.h>
+#    include <avsystem/commons/avs_http_server.h>
+#    include <avsystem/commons/avs_list.h>
+#    include <avsystem/commons/avs_memory.h>
+#    include <avsystem/commons/avs_stream_net.h>
+#    include <avsystem/commons/avs_stream_netbuf.h>
+#    include <avsystem/commons/avs_utils.h>
+
+#    include "avs_body_receivers.h"
+#    include "avs_headers.h"
+
+#    include "avs_http_log.h"
+
+VISIBILITY_SOURCE_BEGIN
+
+#    define DEFAULT_MAX_HEADER_SIZE 2048
+#    define DEFAULT_MAX_CONNECTIONS 8
+
+#    define HEAD_INCOMPLETE (-2)
+
+static const avs_time_duration_t DEFAULT_IDLE_TIMEOUT = { 5, 0 };
+static const avs_time_duration_t DEFAULT_RECV_TIMEOUT = { 5, 0 };
+static const avs_time_duration_t DEFAULT_POLL_INTERVAL = { 0, 100000000 };
+
+typedef enum {
+    RESPONSE_NONE,
+    RESPONSE_STARTED,
+    RESPONSE_FINISHED
+} response_state_t;
+
+typedef struct http_server_conn_struct http_server_conn_t;
+
+struct avs_http_server_request {
+    http_server_conn_t *conn;
+    const char *method;
+    const char *path;
+    const char *query;
+    /* request headers are stored as "key\0value\0" pairs in header_buf */
+    size_t headers_begin;
+    size_t headers_end;
+    /* response headers are appended after request headers in the same way */
+    size_t response_headers_end;
+    unsigned http_minor;
+    bool keep_alive;
+    bool close_delimited;
+    response_state_t response_state;
+    avs_stream_t *body;
+    /* backend of body, owned by it; NULL if the request has no body */
+    avs_stream_t *body_netbuf;
+};
+
+struct http_server_conn_struct {
+    avs_http_server_t *server;
+    avs_stream_t *netbuf;
+    avs_sched_handle_t idle_job;
+#    ifdef AVS_COMMONS_WITH_AVS_CRYPTO
+    /* the TLS handshake is deferred until the client sends any data */
+    bool handshake_pending;
+#    endif // AVS_COMMONS_WITH_AVS_CRYPTO
+    /* request head parser state: length of the partially received line,
+     * stored at header_buf[request.headers_end] */
+    size_t line_length;
+    /* '\r' has been received, but not stored in the line yet */
+    bool line_cr;
+    avs_http_server_request_t request;
+    char header_buf[];
+};
+
+typedef struct {
+    avs_http_server_handler_t *handler;
+    void *arg;
+    const char *method;
+    size_t path_length;
+    char path[];
+} http_server_route_t;
+
+struct avs_http_server {
+    avs_sched_t *sched;
+    avs_net_socket_t *listen_socket;
+    avs_net_socket_configuration_t tcp_configuration;
+#    ifdef AVS_COMMONS_WITH_AVS_CRYPTO
+    const avs_net_ssl_configuration_t *ssl;
+#    endif // AVS_COMMONS_WITH_AVS_CRYPTO
+    avs_http_buffer_sizes_t buffer_sizes;
+    size_t max_header_size;
+    size_t max_connections;
+    avs_time_duration_t idle_timeout;
+    avs_time_duration_t recv_timeout;
+    avs_time_duration_t poll_interval;
+    AVS_LIST(http_server_route_t) routes;
+    AVS_LIST(http_server_conn_t) connections;
+    avs_sched_handle_t poll_job;
+    /* index 0 is the listening socket, followed by the connections */
+    struct pollfd pollfds[];
+};
+
+static const char *reason_phrase(int status_code) {
+    static const struct {
+        int code;
+        const char *phrase;
+    } PHRASES[] = {
+        { 100, "Continue" },
+        { 200, "OK" },
+        { 201, "Created" },
+        { 202, "Accepted" },
+        { 204, "No Content" },
+        { 301, "Moved Permanently" },
+        { 302, "Found" },
+        { 304, "Not Modified" },
+        { 400, "Bad Request" },
+        { 401, "Unauthorized" },
+        { 403, "Forbidden" },
+        { 404, "Not Found" },
+        { 405, "Method Not Allowed" },
+        { 408, "Request Timeout" },
+        { 411, "Length Required" },
+        { 413, "Payload Too Large" },
+        { 431, "Request Header Fields Too Large" },
+        { 500, "Internal Server Error" },
+        { 501, "Not Implemented" },
+        { 503, "Service Unavailable" }
+    };
+    for (size_t i = 0; i < AVS_ARRAY_SIZE(PHRASES); ++i) {
+        if (PHRASES[i].code == status_code) {
+            return PHRASES[i].phrase;
+        }
+    }
+    return "";
+}
+
+static bool is_head_request(const avs_http_server_request_t *request) {
+    return strcmp(request->method, "HEAD") == 0;
+}
+
+static bool response_has_body(int status_code) {
+    return status_code / 100 != 1 && status_code != 204 && status_code != 304;
+}
+
+static avs_error_t send_response_headers(avs_http_server_request_t *request,
+                                         int status_code,
+                                         const char *content_type,
+                                         bool chunked,
+                                         size_t content_length) {
+    avs_stream_t *netbuf = request->conn->netbuf;
+    if (request->response_state != RESPONSE_NONE) {
+        LOG(ERROR, _("response already started"));
+        return avs_errno(AVS_EINVAL);
+    }
+    request->response_state = RESPONSE_STARTED;
+    if (chunked && request->http_minor == 0) {
+        /* HTTP/1.0 does not support chunked encoding */
+        request->close_delimited = true;
+        request->keep_alive = false;
+    }
+    avs_error_t err =
+            avs_stream_write_f(netbuf, "HTTP/1.1 %d %s\r\n", status_code,
+                               reason_phrase(status_code));
+    if (avs_is_ok(err) && content_type) {
+        err = avs_stream_write_f(netbuf, "Content-Type: %s\r\n", content_type);
+    }
+    if (avs_is_ok(err) && response_has_body(status_code)) {
+        if (!chunked) {
+            err = avs_stream_write_f(netbuf, "Content-Length: %lu\r\n",
+                                     (unsigned long) content_length);
+        } else if (!request->close_delimited) {
+            err = avs_stream_write_f(netbuf,
+                                     "Transfer-Encoding: chunked\r\n");
+        }
+    }
+    if (avs_is_ok(err)) {
+        if (!request->keep_alive) {
+            err = avs_stream_write_f(netbuf, "Connection: close\r\n");
+        } else if (request->http_minor == 0) {
+            err = avs_stream_write_f(netbuf, "Connection: keep-alive\r\n");
+        }
+    }
+    const char *header = &request->conn->header_buf[request->headers_end];
+    const char *headers_end =
+            &request->conn->header_buf[request->response_headers_end];
+    while (avs_is_ok(err) && header < headers_end) {
+        const char *value = header + strlen(header) + 1;
+        err = avs_stream_write_f(netbuf, "%s: %s\r\n", header, value);
+        header = value + strlen(value) + 1;
+    }
+    if (avs_is_ok(err)) {
+        err = avs_stream_write(netbuf, "\r\n", 2);
+    }
+    return err;
+}
+
+avs_error_t avs_http_server_respond(avs_http_server_request_t *request,
+                                    int status_code,
+                                    const char *content_type,
+                                    const void *body,
+                                    size_t body_size) {
+    assert(request);
+    assert(body || !body_size);
+    avs_error_t err = send_response_headers(request, status_code, content_type,
+                                            false, body_size);
+    if (avs_is_ok(err) && body_size && response_has_body(status_code)
+            && !is_head_request(request)) {
+        err = avs_stream_write(request->conn->netbuf, body, body_size);
+    }
+    if (avs_is_err(err)) {
+        request->keep_alive = false;
+    }
+    request->response_state = RESPONSE_FINISHED;
+    return err;
+}
+
+avs_error_t avs_http_server_respond_begin(avs_http_server_request_t *request,
+                                          int status_code,
+                                          const char *content_type) {
+    assert(request);
+    avs_error_t err = send_response_headers(request, status_code, content_type,
+                                            true, 0);
+    if (avs_is_err(err)) {
+        request->keep_alive = false;
+    }
+    return err;
+}
+
+avs_error_t avs_http_server_respond_write(avs_http_server_request_t *request,
+                                          const void *data,
+                                          size_t data_size) {
+    assert(request);
+    if (request->response_state != RESPONSE_STARTED) {
+        LOG(ERROR, _("chunked response not started"));
+        return avs_errno(AVS_EINVAL);
+    }
+    if (!data_size || is_head_request(request)) {
+        return AVS_OK;
+    }
+    avs_stream_t *netbuf = request->conn->netbuf;
+    avs_error_t err = AVS_OK;
+    if (!request->close_delimited) {
+        err = avs_stream_write_f(netbuf, "%lX\r\n", (unsigned long) data_size);
+    }
+    if (avs_is_ok(err)) {
+        err = avs_stream_write(netbuf, data, data_size);
+    }
+    if (avs_is_ok(err) && !request->close_delimited) {
+        err = avs_stream_write(netbuf, "\r\n", 2);
+    }
+    if (avs_is_err(err)) {
+        request->keep_alive = false;
+    }
+    return err;
+}
+
+avs_error_t avs_http_server_respond_finish(avs_http_server_request_t *request) {
+    assert(request);
+    if (request->response_state != RESPONSE_STARTED) {
+        LOG(ERROR, _("chunked response not started"));
+        return avs_errno(AVS_EINVAL);
+    }
+    avs_error_t err = AVS_OK;
+    if (!request->close_delimited && !is_head_request(request)) {
+        err = avs_stream_write(request->conn->netbuf, "0\r\n\r\n", 5);
+    }
+    if (avs_is_err(err)) {
+        request->keep_alive = false;
+    }
+    request->response_state = RESPONSE_FINISHED;
+    return err;
+}
+
+int avs_http_server_add_header(avs_http_server_request_t *request,
+                               const char *key,
+                               const char *value) {
+    assert(request);
+    assert(key);
+    assert(value);
+    if (request->response_state != RESPONSE_NONE) {
+        LOG(ERROR, _("cannot add headers after starting the response"));
+        return -1;
+    }
+    size_t key_size = strlen(key) + 1;
+    size_t value_size = strlen(value) + 1;
+    size_t max_header_size = request->conn->server->max_header_size;
+    if (key_size + value_size
+            > max_header_size - request->response_headers_end) {
+        LOG(ERROR, _("no space left for response header: ") "%s", key);
+        return -1;
+    }
+    char *ptr = &request->conn->header_buf[request->response_headers_end];
+    memcpy(ptr, key, key_size);
+    memcpy(ptr + key_size, value, value_size);
+    request->response_headers_end += key_size + value_size;
+    return 0;
+}
+
+const char *
+avs_http_server_request_method(const avs_http_server_request_t *request) {
+    return request->method;
+}
+
+const char *
+avs_http_server_request_path(const avs_http_server_request_t *request) {
+    return request->path;
+}
+
+const char *
+avs_http_server_request_query(const avs_http_server_request_t *request) {
+    return request->query;
+}
+
+const char *
+avs_http_server_request_header(const avs_http_server_request_t *request,
+                               const char *name) {
+    const char *header = &request->conn->header_buf[request->headers_begin];
+    const char *headers_end = &request->conn->header_buf[request->headers_end];
+    while (header < headers_end) {
+        const char *value = header + strlen(header) + 1;
+        if (avs_strcasecmp(header, name) == 0) {
+            return value;
+        }
+        header = value + strlen(value) + 1;
+    }
+    return NULL;
+}
+
+avs_stream_t *avs_http_server_request_body(avs_http_server_request_t *request) {
+    return request->body;
+}
+
+static int parse_request_line(avs_http_server_request_t *request, char *line) {
+    char *target = strchr(line, ' ');
+    if (!target) {
+        return -1;
+    }
+    *target++ = '\0';
+    char *version = strchr(target, ' ');
+    if (!version) {
+        return -1;
+    }
+    *version++ = '\0';
+    if (!*line || *target != '/') {
+        return -1;
+    }
+    if (strcmp(version, "HTTP/1.1") == 0) {
+        request->http_minor = 1;
+    } else if (strcmp(version, "HTTP/1.0") == 0) {
+        request->http_minor = 0;
+    } else {
+        return -1;
+    }
+    char *query = strchr(target, '?');
+    if (query) {
+        *query++ = '\0';
+    }
+    request->method = line;
+    request->path = target;
+    request->query = query;
+    return 0;
+}
+
+static void store_header(avs_http_server_request_t *request,
+                         char *line,
+                         const char *value) {
+    size_t key_size = strlen(line) + 1;
+    size_t value_length = strlen(value);
+    while (value_length > 0
+           && (value[value_length - 1] == ' '
+               || value[value_length - 1] == '\t')) {
+        --value_length;
+    }
+    memmove(line + key_size, value, value_length);
+    line[key_size + value_length] = '\0';
+    request->headers_end =
+            (size_t) (line - request->conn->header_buf) + key_size
+            + value_length + 1;
+}
+
+/**
+ * Handles a complete line of the request head, stored at
+ * header_buf[request.headers_end]. Returns the HTTP status code to send in case
+ * of malformed requests, 0 if the head is complete, or HEAD_INCOMPLETE if more
+ * lines are expected.
+ */
+static int process_head_line(http_server_conn_t *conn) {
+    avs_http_server_request_t *request = &conn->request;
+    char *line = &conn->header_buf[request->headers_end];
+    line[conn->line_length] = '\0';
+    size_t line_length = conn->line_length;
+    conn->line_length = 0;
+    if (!request->method) {
+        if (!line_length) {
+            /* ignore empty lines before the request line, see RFC 7230 3.5 */
+            return HEAD_INCOMPLETE;
+        }
+        LOG(TRACE, _("HTTP request: ") "%s", line);
+        request->headers_begin = request->headers_end = line_length + 1;
+        return parse_request_line(request, line) ? 400 : HEAD_INCOMPLETE;
+    }
+    if (!line_length) {
+        request->response_headers_end = request->headers_end;
+        return 0;
+    }
+    const char *value = _avs_http_header_split(line);
+    if (!value) {
+        return 400;
+    }
+    store_header(request, line, value);
+    return HEAD_INCOMPLETE;
+}
+
+/**
+ * Appends a received character to the request head. Line terminators are
+ * handled like in avs_stream_getline(). Returns the same values as
+ * process_head_line().
+ */
+static int process_head_char(http_server_conn_t *conn, char ch) {
+    size_t line_space = conn->server->max_header_size
+                        - conn->request.headers_end - conn->line_length;
+    if (ch == '\n') {
+        conn->line_cr = false;
+        return process_head_line(conn);
+    }
+    if (ch == '\0') {
+        return 400;
+    }
+    size_t bytes_to_store = (conn->line_cr ? 1u : 0u) + (ch != '\r' ? 1u : 0u);
+    /* one byte is always left for the terminating null byte */
+    if (line_space <= bytes_to_store) {
+        return 431;
+    }
+    char *line = &conn->header_buf[conn->request.headers_end];
+    if (conn->line_cr) {
+        line[conn->line_length++] = '\r';
+    }
+    conn->line_cr = (ch == '\r');
+    if (!conn->line_cr) {
+        line[conn->line_length++] = ch;
+    }
+    return HEAD_INCOMPLETE;
+}
+
+/**
+ * Receives as much of the request line and headers as is available, without
+ * blocking. Returns the HTTP status code to send in case of malformed
+ * requests, 0 if the head is complete, HEAD_INCOMPLETE if more data is
+ * needed, or -1 if the connection shall be closed without sending a response.
+ *
+ * The data is read one character at a time, so that anything following the
+ * head is left in the netbuf. This does not cause additional system calls, as
+ * the netbuf receives all the available data into its buffer.
+ */
+static int receive_request_head(http_server_conn_t *conn) {
+    int result = HEAD_INCOMPLETE;
+    while (result == HEAD_INCOMPLETE) {
+        size_t bytes_read;
+        bool message_finished;
+        char ch;
+        avs_error_t err = avs_stream_read(conn->netbuf, &bytes_read,
+                                          &message_finished, &ch, 1);
+        if (err.category == AVS_ERRNO_CATEGORY && err.code == AVS_ETIMEDOUT) {
+            /* no more data available at the moment */
+            break;
+        }
+        if (avs_is_err(err) || !bytes_read) {
+            if (conn->request.method || conn->line_length) {
+                LOG(DEBUG, _("could not receive request head"));
+            }
+            return -1;
+        }
+        result = process_head_char(conn, ch);
+    }
+    return result;
+}
+
+/**
+ * Parses the Content-Length headers of the request. Returns 0 on success,
+ * including when there are none, or 400 if any of them is invalid or they
+ * differ from each other (see RFC 9112 6.3).
+ */
+static int get_content_length(const avs_http_server_request_t *request,
+                              bool *out_present,
+                              size_t *out_content_length) {
+    const char *header = &request->conn->header_buf[request->headers_begin];
+    const char *headers_end = &request->conn->header_buf[request->headers_end];
+    *out_present = false;
+    *out_content_length = 0;
+    while (header < headers_end) {
+        const char *value = header + strlen(header) + 1;
+        if (avs_strcasecmp(header, "Content-Length") == 0) {
+            size_t content_length;
+            if (_avs_http_parse_size(&content_length, value)
+                    || (*out_present
+                        && content_length != *out_content_length)) {
+                return 400;
+            }
+            *out_present = true;
+            *out_content_length = content_length;
+        }
+        header = value + strlen(value) + 1;
+    }
+    return 0;
+}
+
+static int setup_request(http_server_conn_t *conn) {
+    avs_http_server_request_t *request = &conn->request;
+    const char *connection =
+            avs_http_server_request_header(request, "Connection");
+    request->keep_alive = request->http_minor > 0;
+    if (connection) {
+        if (avs_strcasecmp(connection, "close") == 0) {
+            request->keep_alive = false;
+        } else if (avs_strcasecmp(connection, "keep-alive") == 0) {
+            request->keep_alive = true;
+        }
+    }
+
+    http_transfer_encoding_t transfer_encoding = TRANSFER_LENGTH;
+    size_t content_length = 0;
+    const char *value;
+    if ((value = avs_http_server_request_header(request, "Transfer-Encoding"))
+            && avs_strcasecmp(value, "identity") != 0) {
+        if (avs_strcasecmp(value, "chunked") != 0) {
+            return 501;
+        }
+        transfer_encoding = TRANSFER_CHUNKED;
+    }
+    bool content_length_present;
+    int status = get_content_length(request, &content_length_present,
+                                    &content_length);
+    if (status) {
+        return status;
+    }
+    if (content_length_present && transfer_encoding == TRANSFER_CHUNKED) {
+        return 400;
+    }
+
+    /* The body receivers take ownership of their backend stream, so a separate
+     * netbuf is used, with the same buffer size, so that any data buffered
+     * after the request can be transferred back after handling it. The body
+     * netbuf has no output buffer, so any responses to previous pipelined
+     * requests need to be flushed first. If there is no body, the receiver
+     * does not touch the backend, so no netbuf is created at all. */
+    avs_stream_t *body_netbuf = NULL;
+    if ((transfer_encoding == TRANSFER_CHUNKED || content_length > 0)
+            && (avs_stream_netbuf_create(
+                        &body_netbuf, avs_stream_net_getsock(conn->netbuf),
+                        conn->server->buffer_sizes.body_recv, 0)
+                || avs_is_err(avs_stream_finish_message(conn->netbuf))
+                || avs_stream_netbuf_transfer(body_netbuf, conn->netbuf))) {
+        goto error;
+    }
+    if (transfer_encoding == TRANSFER_CHUNKED) {
+        request->body = _avs_http_body_receiver_chunked_create(
+                body_netbuf, &conn->server->buffer_sizes);
+    } else {
+        request->body = _avs_http_body_receiver_content_length_create(
+                body_netbuf, content_length);
+    }
+    if (!request->body) {
+        goto error;
+    }
+    request->body_netbuf = body_netbuf;
+
+    if ((value = avs_http_server_request_header(request, "Expect"))
+            && avs_strcasecmp(value, "100-continue") == 0
+            && request->http_minor > 0) {
+        if (avs_is_err(avs_stream_write_f(conn->netbuf,
+                                          "HTTP/1.1 100 Continue\r\n\r\n"))
+                || avs_is_err(avs_stream_finish_message(conn->netbuf))) {
+            return -1;
+        }
+    }
+    return 0;
+
+error:
+    LOG(ERROR, _("could not create request body receiver"));
+    if (body_netbuf) {
+        avs_stream_net_setsock(body_netbuf, NULL); /* don't close the socket */
+        avs_stream_cleanup(&body_netbuf);
+    }
+    return 500;
+}
+
+static bool route_method_matches(const http_server_route_t *route,
+                                 const char *method) {
+    return !route->method || strcmp(route->method, method) == 0
+           || (strcmp(method, "HEAD") == 0
+               && strcmp(route->method, "GET") == 0);
+}
+
+static bool route_path_matches(const http_server_route_t *route,
+                               const char *path) {
+    if (route->path_length && route->path[route->path_length - 1] == '/') {
+        return strncmp(path, route->path, route->path_length) == 0;
+    }
+    return strcmp(path, route->path) == 0;
+}
+
+static avs_error_t
+respond_method_not_allowed(avs_http_server_t *server,
+                           avs_http_server_request_t *request) {
+    char allow[128] = "";
+    size_t allow_length = 0;
+    AVS_LIST(http_server_route_t) route;
+    AVS_LIST_FOREACH(route, server->routes) {
+        if (route_path_matches(route, request->path)) {
+            assert(route->method);
+            /* the list is informative, so truncating it is fine */
+            int result = avs_simple_snprintf(
+                    allow + allow_length, sizeof(allow) - allow_length, "%s%s",
+                    allow_length ? ", " : "", route->method);
+            if (result < 0) {
+                break;
+            }
+            allow_length += (size_t) result;
+        }
+    }
+    (void) avs_http_server_add_header(request, "Allow", allow);
+    return avs_http_server_respond(request, 405, NULL, NULL, 0);
+}
+
+static avs_error_t dispatch_request(avs_http_server_t *server,
+                                    avs_http_server_request_t *request) {
+    const http_server_route_t *best_route = NULL;
+    bool path_matched = false;
+    AVS_LIST(http_server_route_t) route;
+    AVS_LIST_FOREACH(route, server->routes) {
+        if (route_path_matches(route, request->path)) {
+            path_matched = true;
+            if (route_method_matches(route, request->method)
+                    && (!best_route
+                        || route->path_length > best_route->path_length)) {
+                best_route = route;
+            }
+        }
+    }
+    if (!best_route) {
+        return path_matched ? respond_method_not_allowed(server, request)
+                            : avs_http_server_respond(request, 404, NULL, NULL,
+                                                      0);
+    }
+    avs_error_t err = best_route->handler(request, best_route->arg);
+    switch (request->response_state) {
+    case RESPONSE_NONE:
+        LOG(ERROR, _("handler for ") "%s %s" _(" did not respond"),
+            request->method, request->path);
+        err = avs_http_server_respond(request, 500, NULL, NULL, 0);
+        break;
+    case RESPONSE_STARTED:
+        if (avs_is_err(err)) {
+            request->keep_alive = false;
+        } else {
+            err = avs_http_server_respond_finish(request);
+        }
+        break;
+    case RESPONSE_FINISHED:
+        break;
+    }
+    return err;
+}
+
+static void finish_request(http_server_conn_t *conn) {
+    avs_http_server_request_t *request = &conn->request;
+    if (!request->body) {
+        return;
+    }
+    /* discard the unread part of the body and retrieve any data buffered
+     * after it, which may be the next pipelined request */
+    if (request->keep_alive
+            && (avs_is_err(avs_stream_ignore_to_end(request->body))
+                || (request->body_netbuf
+                    && avs_stream_netbuf_transfer(conn->netbuf,
+                                                  request->body_netbuf)))) {
+        request->keep_alive = false;
+    }
+    avs_stream_cleanup(&request->body);
+    request->body_netbuf = NULL;
+}
+
+/**
+ * Handles a request, without flushing the response. @p status is the result of
+ * receive_request_head(). Returns true if the connection may be kept open.
+ */
+static bool handle_request(http_server_conn_t *conn, int status) {
+    avs_http_server_request_t *request = &conn->request;
+    /* the body is read synchronously by the handler */
+    avs_stream_netbuf_set_recv_timeout(conn->netbuf,
+                                       conn->server->recv_timeout);
+    if (status == 0) {
+        status = setup_request(conn);
+    }
+    if (status < 0) {
+        finish_request(conn);
+        return false;
+    }
+    if (status > 0) {
+        LOG(DEBUG, _("rejecting malformed request with status ") "%d",
+            status);
+        request->keep_alive = false;
+        if (!request->method) {
+            /* the request line could not be parsed */
+            request->method = "";
+            request->path = "";
+        }
+        (void) avs_http_server_respond(request, status, NULL, NULL, 0);
+    } else {
+        (void) dispatch_request(conn->server, request);
+    }
+    finish_request(conn);
+    return request->keep_alive;
+}
+
+/**
+ * Prepares the connection for receiving the next request head, which is done
+ * using non-blocking reads.
+ */
+static void reset_request(http_server_conn_t *conn) {
+    memset(&conn->request, 0, sizeof(conn->request));
+    conn->request.conn = conn;
+    conn->line_length = 0;
+    conn->line_cr = false;
+    avs_stream_netbuf_set_recv_timeout(conn->netbuf, AVS_TIME_DURATION_ZERO);
+}
+
+static void close_connection(AVS_LIST(http_server_conn_t) *conn_ptr) {
+    http_server_conn_t *conn = *conn_ptr;
+    avs_sched_del(&conn->idle_job);
+    avs_stream_cleanup(&conn->netbuf);
+    AVS_LIST_DELETE(conn_ptr);
+}
+
+static void idle_timeout_job(avs_sched_t *sched, const void *conn_ptr) {
+    (void) sched;
+    http_server_conn_t *conn = *(http_server_conn_t *const *) conn_ptr;
+    AVS_LIST(http_server_conn_t) *list_ptr =
+            AVS_LIST_FIND_PTR(&conn->server->connections, conn);
+    assert(list_ptr);
+    LOG(DEBUG, _("closing idle HTTP connection"));
+    close_connection(list_ptr);
+}
+
+static int schedule_idle_timeout(http_server_conn_t *conn) {
+    return AVS_SCHED_DELAYED(conn->server->sched, &conn->idle_job,
+                             conn->server->idle_timeout, idle_timeout_job,
+                             &conn, sizeof(conn));
+}
+
+#    ifdef AVS_COMMONS_WITH_AVS_CRYPTO
+/**
+ * Performs the TLS handshake on a connection, once the client has sent any
+ * data. avs_net does not support non-blocking handshakes, so it is performed
+ * synchronously, with recv_timeout applied to each read.
+ */
+static avs_error_t perform_handshake(http_server_conn_t *conn) {
+    avs_net_socket_t *tcp_socket = avs_stream_net_getsock(conn->netbuf);
+    avs_net_socket_t *ssl_socket = NULL;
+    avs_error_t err;
+    conn->handshake_pending = false;
+    avs_stream_netbuf_set_recv_timeout(conn->netbuf,
+                                       conn->server->recv_timeout);
+    /* decorating an accepted socket performs the server-side handshake */
+    if (avs_is_err((err = avs_net_ssl_socket_create(&ssl_socket,
+                                                    conn->server->ssl)))
+            || avs_is_err((err = avs_net_socket_decorate(ssl_socket,
+                                                         tcp_socket)))) {
+        /* the TCP socket is still owned by the netbuf */
+        avs_net_socket_cleanup(&ssl_socket);
+        LOG(DEBUG, _("TLS handshake failed"));
+        return err;
+    }
+    (void) avs_stream_net_setsock(conn->netbuf, ssl_socket);
+    avs_stream_netbuf_set_recv_timeout(conn->netbuf, AVS_TIME_DURATION_ZERO);
+    return AVS_OK;
+}
+#    endif // AVS_COMMONS_WITH_AVS_CRYPTO
+
+static avs_error_t create_client_socket(avs_http_server_t *server,
+                                        avs_net_socket_t **out_socket) {
+    avs_net_socket_t *tcp_socket = NULL;
+    avs_error_t err;
+    if (avs_is_err((err = avs_net_tcp_socket_create(
+                            &tcp_socket, &server->tcp_configuration)))
+            || avs_is_err((err = avs_net_socket_accept(server->listen_socket,
+                                                       tcp_socket)))) {
+        avs_net_socket_cleanup(&tcp_socket);
+        return err;
+    }
+    *out_socket = tcp_socket;
+    return AVS_OK;
+}
+
+static void accept_connection(avs_http_server_t *server) {
+    avs_net_socket_t *socket = NULL;
+    avs_error_t err = create_client_socket(server, &socket);
+    if (avs_is_err(err)) {
+        LOG(WARNING, _("could not accept HTTP connection"));
+        return;
+    }
+    AVS_LIST(http_server_conn_t) conn = (AVS_LIST(http_server_conn_t))
+            AVS_LIST_NEW_BUFFER(sizeof(http_server_conn_t)
+                                + server->max_header_size);
+    if (!conn) {
+        LOG(ERROR, _("Out of memory"));
+        avs_net_socket_cleanup(&socket);
+        return;
+    }
+    conn->server = server;
+    if (avs_stream_netbuf_create(&conn->netbuf, socket,
+                                 server->buffer_sizes.body_recv,
+                                 server->buffer_sizes.body_send)
+            || schedule_idle_timeout(conn)) {
+        LOG(ERROR, _("could not set up HTTP connection"));
+        if (conn->netbuf) {
+            avs_stream_cleanup(&conn->netbuf);
+        } else {
+            avs_net_socket_cleanup(&socket);
+        }
+        AVS_LIST_DELETE(&conn);
+        return;
+    }
+#    ifdef AVS_COMMONS_WITH_AVS_CRYPTO
+    conn->handshake_pending = !!server->ssl;
+#    endif // AVS_COMMONS_WITH_AVS_CRYPTO
+    reset_request(conn);
+    AVS_LIST_APPEND(&server->connections, conn);
+    LOG(DEBUG, _("accepted HTTP connection"));
+}
+
+/**
+ * Receives the available part of the request head and, once it is complete,
+ * handles the request and flushes the response. Returns true if the connection
+ * shall be kept open.
+ *
+ * The idle timeout job is only rescheduled after handling a request, so it
+ * also limits the total time of receiving the request head.
+ */
+static bool serve_connection(http_server_conn_t *conn) {
+#    ifdef AVS_COMMONS_WITH_AVS_CRYPTO
+    if (conn->handshake_pending && avs_is_err(perform_handshake(conn))) {
+        return false;
+    }
+#    endif // AVS_COMMONS_WITH_AVS_CRYPTO
+    int status = receive_request_head(conn);
+    if (status == HEAD_INCOMPLETE) {
+        return true;
+    }
+    bool keep_alive = handle_request(conn, status);
+    /* responses are flushed only when there are no more pipelined requests
+     * buffered, so that they are sent together */
+    if ((!keep_alive || !avs_stream_nonblock_read_ready(conn->netbuf))
+            && avs_is_err(avs_stream_finish_message(conn->netbuf))) {
+        keep_alive = false;
+    }
+    if (!keep_alive || schedule_idle_timeout(conn)) {
+        return false;
+    }
+    reset_request(conn);
+    return true;
+}
+
+static int socket_fd(avs_net_socket_t *socket) {
+    const sockfd_t *fd = (const sockfd_t *) avs_net_socket_get_system(socket);
+    return fd ? *fd : -1;
+}
+
+static bool has_pending_handshake(const http_server_conn_t *conn) {
+#    ifdef AVS_COMMONS_WITH_AVS_CRYPTO
+    return conn->handshake_pending;
+#    else  // AVS_COMMONS_WITH_AVS_CRYPTO
+    (void) conn;
+    return false;
+#    endif // AVS_COMMONS_WITH_AVS_CRYPTO
+}
+
+static nfds_t prepare_pollfds(avs_http_server_t *server) {
+    nfds_t nfds = 0;
+    server->pollfds[nfds++] = (struct pollfd) {
+        .fd = AVS_LIST_SIZE(server->connections) < server->max_connections
+                      ? socket_fd(server->listen_socket)
+                      : -1,
+        .events = POLLIN
+    };
+    AVS_LIST(http_server_conn_t) conn;
+    AVS_LIST_FOREACH(conn, server->connections) {
+        server->pollfds[nfds++] = (struct pollfd) {
+            .fd = socket_fd(avs_stream_net_getsock(conn->netbuf)),
+            .events = POLLIN
+        };
+    }
+    return nfds;
+}
+
+/**
+ * Handles pending events without blocking. Returns true if any events have
+ * been handled.
+ */
+static bool process_events(avs_http_server_t *server) {
+    nfds_t nfds = prepare_pollfds(server);
+    if (poll(server->pollfds, nfds, 0) < 0) {
+        LOG(ERROR, _("poll() failed"));
+        return false;
+    }
+    bool active = false;
+    nfds_t index = 1;
+    AVS_LIST(http_server_conn_t) *conn_ptr;
+    AVS_LIST(http_server_conn_t) helper;
+    AVS_LIST_DELETABLE_FOREACH_PTR(conn_ptr, helper, &server->connections) {
+        assert(index < nfds);
+        /* data may also be buffered in the netbuf or in the TLS layer;
+         * connections awaiting the handshake are not probed, as that would
+         * consume the data meant for it */
+        if (!server->pollfds[index++].revents
+                && (has_pending_handshake(*conn_ptr)
+                    || !avs_stream_nonblock_read_ready((*conn_ptr)->netbuf))) {
+            continue;
+        }
+        active = true;
+        if (!serve_connection(*conn_ptr)) {
+            close_connection(conn_ptr);
+        }
+    }
+    if (server->pollfds[0].fd >= 0 && server->pollfds[0].revents) {
+        accept_connection(server);
+        active = true;
+    }
+    return active;
+}
+
+/**
+ * Processes the pending events. This is the only place where the sockets are
+ * served; avs_http_server_wait() only schedules this job to run immediately.
+ *
+ * The job reschedules itself immediately if any events have been handled, as
+ * more requests may be buffered. Otherwise, it runs again after poll_interval,
+ * so that the server also works if the application only runs the scheduler.
+ * If poll_interval is disabled, the job is only scheduled by
+ * avs_http_server_wait().
+ */
+static void poll_job(avs_sched_t *sched, const void *server_ptr) {
+    avs_http_server_t *server = *(avs_http_server_t *const *) server_ptr;
+    avs_time_duration_t delay = process_events(server)
+                                        ? AVS_TIME_DURATION_ZERO
+                                        : server->poll_interval;
+    if (avs_time_duration_valid(delay)
+            && AVS_SCHED_DELAYED(sched, &server->poll_job, delay, poll_job,
+                                 &server, sizeof(server))) {
+        LOG(ERROR, _("could not schedule HTTP server poll job"));
+    }
+}
+
+avs_error_t avs_http_server_wait(avs_http_server_t *server,
+                                 avs_time_duration_t timeout) {
+    assert(server);
+    avs_time_monotonic_t poll_time = avs_sched_time(&server->poll_job);
+    if (avs_time_monotonic_valid(poll_time)
+            && !avs_time_monotonic_before(avs_time_monotonic_now(),
+                                          poll_time)) {
+        /* pending events, e.g. pipelined requests, are already scheduled */
+        return AVS_OK;
+    }
+    int timeout_ms = -1;
+    if (avs_time_duration_valid(timeout)) {
+        int64_t timeout_ms64;
+        avs_time_duration_to_scalar(&timeout_ms64, AVS_TIME_MS, timeout);
+        timeout_ms = (int) AVS_MAX(AVS_MIN(timeout_ms64, INT_MAX), 0);
+    }
+    nfds_t nfds = prepare_pollfds(server);
+    int result = poll(server->pollfds, nfds, timeout_ms);
+    if (result < 0) {
+        LOG(ERROR, _("poll() failed"));
+        return avs_errno(AVS_EIO);
+    }
+    if (result > 0) {
+        if (AVS_SCHED_NOW(server->sched, &server->poll_job, poll_job, &server,
+                          sizeof(server))) {
+            return avs_errno(AVS_ENOMEM);
+        }
+    }
+    return AVS_OK;
+}
+
+static bool duration_set(avs_time_duration_t duration) {
+    return avs_time_duration_valid(duration)
+           && avs_time_duration_less(AVS_TIME_DURATION_ZERO, duration);
+}
+
+avs_http_server_t *avs_http_server_new(avs_sched_t *sched,
+                                       const avs_http_server_config_t *config) {
+    assert(sched);
+    assert(config);
+    size_t max_connections = config->max_connections
+                                     ? config->max_connections
+                                     : DEFAULT_MAX_CONNECTIONS;
+    avs_http_server_t *server = (avs_http_server_t *) avs_calloc(
+            1, sizeof(avs_http_server_t)
+                       + (max_connections + 1) * sizeof(struct pollfd));
+    if (!server) {
+        LOG(ERROR, _("Out of memory"));
+        return NULL;
+    }
+    server->sched = sched;
+    if (config->tcp) {
+        server->tcp_configuration = *config->tcp;
+    }
+#    ifdef AVS_COMMONS_WITH_AVS_CRYPTO
+    server->ssl = config->ssl;
+    if (config->ssl) {
+        server->tcp_configuration = config->ssl->backend_configuration;
+    }
+#    endif // AVS_COMMONS_WITH_AVS_CRYPTO
+    server->buffer_sizes = config->buffer_sizes
+                                   ? *config->buffer_sizes
+                                   : AVS_HTTP_DEFAULT_BUFFER_SIZES;
+    server->max_header_size = config->max_header_size
+                                      ? config->max_header_size
+                                      : DEFAULT_MAX_HEADER_SIZE;
+    server->max_connections = max_connections;
+    server->idle_timeout = duration_set(config->idle_timeout)
+                                   ? config->idle_timeout
+                                   : DEFAULT_IDLE_TIMEOUT;
+    server->recv_timeout = duration_set(config->recv_timeout)
+                                   ? config->recv_timeout
+                                   : DEFAULT_RECV_TIMEOUT;
+    if (!avs_time_duration_valid(config->poll_interval)) {
+        server->poll_interval = AVS_TIME_DURATION_INVALID;
+    } else if (duration_set(config->poll_interval)) {
+        server->poll_interval = config->poll_interval;
+    } else {
+        server->poll_interval = DEFAULT_POLL_INTERVAL;
+    }
+
+    avs_error_t err;
+    if (avs_is_err((err = avs_net_tcp_socket_create(
+                            &server->listen_socket,
+                            &server->tcp_configuration)))
+            || avs_is_err((err = avs_net_socket_bind(
+                                   server->listen_socket, config->address,
+                                   config->port ? config->port : "0")))) {
+        LOG(ERROR, _("could not create HTTP server socket"));
+        avs_http_server_cleanup(&server);
+        return NULL;
+    }
+    if (AVS_SCHED_NOW(sched, &server->poll_job, poll_job, &server,
+                      sizeof(server))) {
+        LOG(ERROR, _("could not schedule HTTP server poll job"));
+        avs_http_server_cleanup(&server);
+        return NULL;
+    }
+    return server;
+}
+
+void avs_http_server_cleanup(avs_http_server_t **server_ptr) {
+    if (!server_ptr || !*server_ptr) {
+        return;
+    }
+    avs_http_server_t *server = *server_ptr;
+    avs_sched_del(&server->poll_job);
+    while (server->connections) {
+        close_connection(&server->connections);
+    }
+    avs_net_socket_cleanup(&server->listen_socket);
+    AVS_LIST_CLEAR(&server->routes);
+    avs_free(server);
+    *server_ptr = NULL;
+}
+
+avs_error_t avs_http_server_get_local_port(avs_http_server_t *server,
+                                           char *out_buffer,
+                                           size_t out_buffer_size) {
+    assert(server);
+    return avs_net_socket_get_local_port(server->listen_socket, out_buffer,
+                                         out_buffer_size);
+}
+
+int avs_http_server_add_route(avs_http_server_t *server,
+                              const char *method,
+                              const char *path,
+                              avs_http_server_handler_t *handler,
+                              void *arg) {
+    assert(server);
+    assert(path);
+    assert(handler);
+    size_t path_size = strlen(path) + 1;
+    size_t method_size = method ? strlen(method) + 1 : 0;
+    AVS_LIST(http_server_route_t) route =
+            (AVS_LIST(http_server_route_t)) AVS_LIST_NEW_BUFFER(
+                    sizeof(http_server_route_t) + path_size + method_size);
+    if (!route) {
+        LOG(ERROR, _("Out of memory"));
+        return -1;
+    }
+    route->handler = handler;
+    route->arg = arg;
+    route->path_length = path_size - 1;
+    memcpy(route->path, path, path_size);
+    if (method) {
+        memcpy(route->path + path_size, method, method_size);
+        route->method = route->path + path_size;
+    }
+    AVS_LIST_APPEND(&server->routes, route);
+    return 0;
+}
+
+#    ifdef AVS_UNIT_TESTING
+#        include "tests/http/test_server.c"
+#    endif // AVS_UNIT_TESTING
+
+#endif // defined(AVS_COMMONS_WITH_AVS_HTTP) &&
+       // defined(AVS_COMMONS_HTTP_WITH_SERVER)
@@ -86,6 +86,18 @@ static const char *resolve_port(const avs_url_t *parsed_url) {
     }
 }
 
+static const char *resolve_connect_host(const avs_http_t *client,
+                                       const avs_url_t *parsed_url) {
+#    ifdef AVS_COMMONS_NET_WITH_UNIX_SOCKETS
+    if (client->unix_socket_path) {
+        return client->unix_socket_path;
+    }
+#    else  // AVS_COMMONS_NET_WITH_UNIX_SOCKETS
+    (void) client;
+#    endif // AVS_COMMONS_NET_WITH_UNIX_SOCKETS
+    return avs_url_host(parsed_url);
+}
+
 avs_error_t _avs_http_socket_new(avs_net_socket_t **out,
                                  avs_http_t *client,
                                  const avs_url_t *url) {
@@ -113,6 +125,18 @@ avs_error_t _avs_http_socket_new(avs_net_socket_t **out,
         memset(&tcp_config_full, 0, sizeof(tcp_config_full));
     }
 #    endif // AVS_COMMONS_WITH_AVS_CRYPTO
+#    ifdef AVS_COMMONS_NET_WITH_UNIX_SOCKETS
+    if (client->unix_socket_path) {
+#        ifdef AVS_COMMONS_WITH_AVS_CRYPTO
+        ssl_config_full.backend_configuration.address_family = AVS_NET_AF_UNIX;
+        if (!ssl_config_full.server_name_indication) {
+            ssl_config_full.server_name_indication = avs_url_host(url);
+        }
+#        else  // AVS_COMMONS_WITH_AVS_CRYPTO
+        tcp_config_full.address_family = AVS_NET_AF_UNIX;
+#        endif // AVS_COMMONS_WITH_AVS_CRYPTO
+    }
+#    endif // AVS_COMMONS_NET_WITH_UNIX_SOCKETS
     const char *host = avs_url_host(url);
     const char *port = resolve_port(url);
     avs_error_t err = avs_errno(AVS_EINVAL);
@@ -145,7 +169,8 @@ avs_error_t _avs_http_socket_new(avs_net_socket_t **out,
     if (avs_is_ok(err)) {
         assert(*out);
         LOG(TRACE, _("socket OK, connecting"));
-        err = avs_net_socket_connect(*out, host, port);
+        err = avs_net_socket_connect(*out, resolve_connect_host(client, url),
+                                     port);
     }
     if (avs_is_err(err)) {
         avs_net_socket_cleanup(out);
@@ -157,6 +182,7 @@ avs_error_t _avs_http_socket_new(avs_net_socket_t **out,
 }
 
 static avs_error_t reconnect_tcp_socket(avs_net_socket_t *socket,
+                                        const avs_http_t *client,
                                         const avs_url_t *url) {
     LOG(TRACE, _("reconnect_tcp_socket"));
     if (!socket) {
@@ -166,8 +192,9 @@ static avs_error_t reconnect_tcp_socket(avs_net_socket_t *socket,
     avs_error_t err;
     if (avs_is_err((err = avs_net_socket_close(socket)))
             || avs_is_err(
-                       (err = avs_net_socket_connect(socket, avs_url_host(url),
-                                                     resolve_port(url))))) {
+                       (err = avs_net_socket_connect(
+                                socket, resolve_connect_host(client, url),
+                                resolve_port(url))))) {
         LOG(ERROR, _("reconnect failed"));
         return err;
     }
@@ -250,7 +277,7 @@ avs_error_t _avs_http_prepare_for_sending(http_stream_t *stream) {
         if (avs_is_err((err = avs_stream_reset(stream->backend)))
                 || avs_is_err((err = reconnect_tcp_socket(
                                        avs_stream_net_getsock(stream->backend),
-                                       stream->url)))) {
+                                       stream->http, stream->url)))) {
             return err;
         } else {
             stream->flags.keep_connection = 1;
@@ -292,6 +319,66 @@ static avs_error_t http_send_simple_request(http_stream_t *stream,
     } while (avs_is_err(err) && stream->flags.should_retry);
     if (avs_is_ok(err)) {
         AVS_LIST_CLEAR(&stream->user_headers);
+        stream->flags.content_length_declared = 0;
+    }
+    return err;
+}
+
+static avs_error_t http_send_known_length(http_stream_t *stream,
+                                          bool message_finished,
+                                          const void *data,
+                                          size_t data_length) {
+    LOG(TRACE, _("http_send_known_length, data_length == ") "%lu",
+        (unsigned long) data_length);
+    if (data_length > stream->content_length_remaining
+            || (message_finished
+                && data_length != stream->content_length_remaining)) {
+        LOG(ERROR, _("request content does not match declared length: ") "%lu",
+            (unsigned long) stream->content_length);
+        return avs_errno(AVS_EINVAL);
+    }
+    avs_error_t err = AVS_OK;
+    if (data_length
+            && avs_is_ok((err = avs_stream_write(stream->backend, data,
+                                                 data_length)))) {
+        stream->content_length_remaining -= data_length;
+    }
+    if (avs_is_ok(err) && message_finished
+            && avs_is_ok((err = avs_stream_finish_message(stream->backend)))) {
+        stream->flags.length_sending = 0;
+        return _avs_http_receive_headers(stream);
+    }
+    _avs_http_maybe_schedule_retry_after_send(stream, err);
+    return err;
+}
+
+static avs_error_t http_send_known_length_first(http_stream_t *stream,
+                                                const void *data,
+                                                size_t data_length) {
+    avs_error_t err;
+    LOG(TRACE, _("http_send_known_length_first"));
+    if (data_length > stream->content_length) {
+        LOG(ERROR, _("request content longer than declared length: ") "%lu",
+            (unsigned long) stream->content_length);
+        return avs_errno(AVS_EINVAL);
+    }
+    stream->auth.state.flags.retried = 0;
+    do {
+        stream->flags.length_sending = 1;
+        stream->content_length_remaining = stream->content_length;
+        if (avs_is_err((err = _avs_http_prepare_for_sending(stream)))
+                || avs_is_err((err = _avs_http_send_headers(
+                                       stream, stream->content_length)))) {
+            _avs_http_maybe_schedule_retry_after_send(stream, err);
+        } else if (stream->flags.no_expect
+                   || avs_is_ok((err = _avs_http_receive_headers(stream)))
+                   || stream->status / 100 == 1) {
+            err = http_send_known_length(stream, false, data, data_length);
+        }
+    } while (avs_is_err(err) && stream->flags.should_retry);
+    if (avs_is_ok(err)) {
+        AVS_LIST_CLEAR(&stream->user_headers);
+        stream->flags.content_length_declared = 0;
     }
     return err;
 }
@@ -312,12 +399,23 @@ static avs_error_t http_send_block(http_stream_t *stream,
         if (avs_is_ok(err) && message_finished) {
             stream->flags.chunked_sending = 0;
         }
-    } else {
-        if (message_finished) {
-            err = http_send_simple_request(stream, data, data_length);
+    } else if (stream->flags.length_sending) {
+        err = http_send_known_length(stream, message_finished, data,
+                                     data_length);
+    } else if (message_finished) {
+        if (stream->flags.content_length_declared
+                && data_length != stream->content_length) {
+            LOG(ERROR,
+                _("request content does not match declared length: ") "%lu",
+                (unsigned long) stream->content_length);
+            err = avs_errno(AVS_EINVAL);
         } else {
-            err = _avs_http_chunked_send_first(stream, data, data_length);
+            err = http_send_simple_request(stream, data, data_length);
         }
+    } else if (stream->flags.content_length_declared) {
+        err = http_send_known_length_first(stream, data, data_length);
+    } else {
+        err = _avs_http_chunked_send_first(stream, data, data_length);
     }
     return err;
 }
@@ -337,6 +435,14 @@ avs_error_t _avs_http_send_via_buffer(http_stream_t *stream,
                                       const void *data,
                                       size_t data_length) {
     avs_error_t err = AVS_OK;
+    if (stream->flags.length_sending) {
+        /* headers already sent, no framing is necessary - bypass the buffer */
+        if (stream->out_buffer_pos
+                && avs_is_err((err = _avs_http_buffer_flush(stream, false)))) {
+            return err;
+        }
+        return http_send_block(stream, false, data, data_length);
+    }
     if (data_length > stream->http->buffer_sizes.body_send
                                   - stream->out_buffer_pos
             && avs_is_err((err = _avs_http_buffer_flush(stream, false)))) {
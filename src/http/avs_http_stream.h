@@ -31,6 +31,20 @@ typedef struct {
      */
     unsigned chunked_sending : 1;
 
+    /**
+     * Set to true if in the sending state, after the request headers with the
+     * Content-Length declared by avs_http_set_content_length() have been sent.
+     * The content is then written directly to the backend stream.
+     */
+    unsigned length_sending : 1;
+
+    /**
+     * Set to true if avs_http_set_content_length() has been called for the
+     * request currently being sent. The declared length is stored in
+     * @ref http_stream_t.content_length.
+     */
+    unsigned content_length_declared : 1;
+
     /**
      * Set to true if the TCP connection can safely be reused for another
      * request after finishing a response.
@@ -184,6 +198,19 @@ struct http_stream_struct {
      * @ref http_send and @ref http_receive in for details.
      */
     avs_stream_t *body_receiver;
+
+    /**
+     * Request content length declared by avs_http_set_content_length(). Valid
+     * only if <c>flags.content_length_declared</c> is set.
+     */
+    size_t content_length;
+
+    /**
+     * Number of bytes of the request content that still need to be written
+     * while <c>flags.length_sending</c> is set.
+     */
+    size_t content_length_remaining;
+
     size_t out_buffer_pos;
     char out_buffer[];
 };
@@ -232,7 +232,8 @@ static avs_error_t http_reset(avs_stream_t *stream_) {
     http_stream_t *stream = (http_stream_t *) stream_;
     LOG(TRACE, _("http_reset"));
     bool keep_connection =
-            (stream->flags.keep_connection && !stream->flags.chunked_sending);
+            (stream->flags.keep_connection && !stream->flags.chunked_sending
+             && !stream->flags.length_sending);
     bool close_handling_required = false;
     if (keep_connection && stream->body_receiver) {
         if (avs_is_err(avs_stream_ignore_to_end(stream->body_receiver))) {
@@ -330,6 +331,26 @@ int avs_http_add_header(avs_stream_t *stream_,
     return 0;
 }
 
+int avs_http_set_content_length(avs_stream_t *stream_,
+                                size_t content_length) {
+    http_stream_t *stream = (http_stream_t *) stream_;
+    assert(stream->vtable == &http_vtable);
+    LOG(TRACE, _("http_set_content_length, ") "%lu",
+        (unsigned long) content_length);
+    if (stream->encoder) {
+        LOG(ERROR, _("cannot declare content length when using compression"));
+        return -1;
+    }
+    if (stream->out_buffer_pos || stream->flags.chunked_sending
+            || stream->flags.length_sending || content_length == (size_t) -1) {
+        LOG(ERROR, _("cannot declare content length in current state"));
+        return -1;
+    }
+    stream->content_length = content_length;
+    stream->flags.content_length_declared = 1;
+    return 0;
+}
+
 void avs_http_set_header_storage(
         avs_stream_t *stream_,
         AVS_LIST(const avs_http_header_t) *header_storage_ptr) {
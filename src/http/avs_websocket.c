@@ -0,0 +1,1309 @@
+/*
+ * Copyright 2021 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <avs_commons_init.h>
+
+#if defined(AVS_COMMONS_WITH_AVS_HTTP) \
+        && defined(AVS_COMMONS_HTTP_WITH_WEBSOCKET)
+
+#    include <assert.h>
+#    include <ctype.h>
+#    include <string.h>
+
+#    include <avsystem/commons/avs_base64.h>
+#    include <avsystem/commons/avs_errno.h>
+#    include <avsystem/commons/avs_memory.h>
+#    ifdef AVS_COMMONS_WITH_AVS_CRYPTO
+#        include <avsystem/commons/avs_prng.h>
+#    endif // AVS_COMMONS_WITH_AVS_CRYPTO
+#    include <avsystem/commons/avs_stream_net.h>
+#    include <avsystem/commons/avs_stream_netbuf.h>
+#    include <avsystem/commons/avs_stream_v_table.h>
+#    include <avsystem/commons/avs_utils.h>
+#    include <avsystem/commons/avs_websocket.h>
+
+#    include "avs_client.h"
+#    include "avs_compression.h"
+#    include "avs_http_stream.h"
+
+#    include "avs_http_log.h"
+
+VISIBILITY_SOURCE_BEGIN
+
+#    ifdef AVS_UNIT_TESTING
+#        define avs_time_real_now avs_time_real_now_TEST_WRAPPER
+avs_time_real_t avs_time_real_now_TEST_WRAPPER(void);
+#        ifdef AVS_COMMONS_WITH_AVS_CRYPTO
+#            define avs_crypto_prng_bytes avs_crypto_prng_bytes_TEST_WRAPPER
+int avs_crypto_prng_bytes_TEST_WRAPPER(avs_crypto_prng_ctx_t *ctx,
+                                       unsigned char *out_buf,
+                                       size_t out_buf_size);
+#        endif // AVS_COMMONS_WITH_AVS_CRYPTO
+#    endif
+
+#    define DEFAULT_FRAGMENT_SIZE 4096
+
+static const avs_time_duration_t DEFAULT_PING_INTERVAL = { 30, 0 };
+
+static const char WEBSOCKET_GUID[] = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+#    define WS_FIN 0x80
+#    define WS_RSV1 0x40
+#    define WS_RSV_MASK 0x70
+#    define WS_OPCODE_MASK 0x0F
+#    define WS_MASKED 0x80
+#    define WS_LEN_MASK 0x7F
+
+#    define WS_OPCODE_CONTINUATION 0x0
+#    define WS_OPCODE_CLOSE 0x8
+#    define WS_OPCODE_PING 0x9
+#    define WS_OPCODE_PONG 0xA
+#    define WS_OPCODE_CONTROL_BIT 0x8
+
+#    define WS_CONTROL_PAYLOAD_MAX 125
+#    define WS_FRAME_HEADER_MAX 14
+
+#    define WS_CLOSE_NORMAL 1000
+#    define WS_CLOSE_PROTOCOL_ERROR 1002
+#    define WS_CLOSE_NO_STATUS 1005
+
+/* 16 random bytes, base64-encoded */
+#    define WS_KEY_SIZE sizeof("dGhlIHNhbXBsZSBub25jZQ==")
+/* SHA-1 hash, base64-encoded */
+#    define WS_ACCEPT_SIZE sizeof("s3pPLMBiTxaQ9kYGzzhZRbK+xOo=")
+
+/* Empty stored block that ends each permessage-deflate message (RFC 7692) */
+static const uint8_t DEFLATE_TAIL[] = { 0x00, 0x00, 0xFF, 0xFF };
+
+typedef struct {
+    const avs_stream_v_table_t *const vtable;
+    avs_stream_t *netbuf;
+#    ifdef AVS_COMMONS_WITH_AVS_CRYPTO
+    /* source of the handshake key and masking keys */
+    avs_crypto_prng_ctx_t *prng;
+    /* set if prng has been created for this stream, and is freed with it */
+    bool prng_owned;
+#    else  // AVS_COMMONS_WITH_AVS_CRYPTO
+    /* NOTE: avs_rand32_r() is not a cryptographically secure generator, so the
+     * keys may be predicted by anyone who can guess the connection time */
+    avs_rand_seed_t random_seed;
+#    endif // AVS_COMMONS_WITH_AVS_CRYPTO
+    char *subprotocol;
+
+    /* Payload of the data frame currently being assembled. If compression is
+     * used, the buffer is larger than fragment_size by the size of
+     * DEFLATE_TAIL, so that the tail can be stripped before sending the final
+     * fragment. */
+    uint8_t *send_buffer;
+    size_t send_buffer_size;
+    size_t send_buffer_pos;
+    size_t fragment_size;
+    avs_websocket_message_type_t send_type;
+    /* set if some fragments of the current message have already been sent */
+    bool send_continuation;
+    bool close_sent;
+
+    avs_websocket_message_type_t recv_type;
+    /* set between receiving the first frame of a message and reading its end */
+    bool recv_in_message;
+    /* set if the data frame currently being received is the final one */
+    bool recv_fin;
+    bool recv_compressed;
+    /* number of DEFLATE_TAIL bytes already passed to the decompressor */
+    uint8_t recv_tail_written;
+    uint64_t recv_frame_left;
+    bool close_received;
+    uint16_t close_code;
+
+    /* permessage-deflate; both NULL if not negotiated */
+    avs_stream_t *compressor;
+    avs_stream_t *decompressor;
+
+    avs_sched_t *sched;
+    avs_sched_handle_t ping_job;
+    avs_time_duration_t ping_interval;
+    bool pong_pending;
+} websocket_t;
+
+static uint32_t rol32(uint32_t value, unsigned bits) {
+    return (value << bits) | (value >> (32 - bits));
+}
+
+static void sha1_block(uint32_t state[5], const uint8_t *block) {
+    uint32_t w[80];
+    for (size_t i = 0; i < 16; ++i) {
+        w[i] = ((uint32_t) block[4 * i] << 24)
+               | ((uint32_t) block[4 * i + 1] << 16)
+               | ((uint32_t) block[4 * i + 2] << 8)
+               | (uint32_t) block[4 * i + 3];
+    }
+    for (size_t i = 16; i < 80; ++i) {
+        w[i] = rol32(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+    }
+    uint32_t a = state[0];
+    uint32_t b = state[1];
+    uint32_t c = state[2];
+    uint32_t d = state[3];
+    uint32_t e = state[4];
+    for (size_t i = 0; i < 80; ++i) {
+        uint32_t f;
+        uint32_t k;
+        if (i < 20) {
+            f = (b & c) | (~b & d);
+            k = 0x5A827999;
+        } else if (i < 40) {
+            f = b ^ c ^ d;
+            k = 0x6ED9EBA1;
+        } else if (i < 60) {
+            f = (b & c) | (b & d) | (c & d);
+            k = 0x8F1BBCDC;
+        } else {
+            f = b ^ c ^ d;
+            k = 0xCA62C1D6;
+        }
+        uint32_t temp = rol32(a, 5) + f + e + k + w[i];
+        e = d;
+        d = c;
+        c = rol32(b, 30);
+        b = a;
+        a = temp;
+    }
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+}
+
+/* SHA-1 is only used for the Sec-WebSocket-Accept check, as mandated by
+ * RFC 6455, so a compact implementation is good enough */
+static void sha1(const void *data, size_t size, uint8_t out[20]) {
+    uint32_t state[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476,
+                          0xC3D2E1F0 };
+    const uint8_t *ptr = (const uint8_t *) data;
+    size_t left = size;
+    for (; left >= 64; ptr += 64, left -= 64) {
+        sha1_block(state, ptr);
+    }
+    uint8_t tail[128] = { 0 };
+    memcpy(tail, ptr, left);
+    tail[left] = 0x80;
+    size_t tail_size = (left + 9 <= 64) ? 64 : 128;
+    uint64_t bits = (uint64_t) size * 8;
+    for (size_t i = 0; i < 8; ++i) {
+        tail[tail_size - 1 - i] = (uint8_t) (bits >> (8 * i));
+    }
+    sha1_block(state, tail);
+    if (tail_size > 64) {
+        sha1_block(state, tail + 64);
+    }
+    for (size_t i = 0; i < 5; ++i) {
+        out[4 * i] = (uint8_t) (state[i] >> 24);
+        out[4 * i + 1] = (uint8_t) (state[i] >> 16);
+        out[4 * i + 2] = (uint8_t) (state[i] >> 8);
+        out[4 * i + 3] = (uint8_t) state[i];
+    }
+}
+
+/*
+ * RFC 6455 requires the handshake key and masking keys to be unpredictable, so
+ * that a malicious script cannot make the frames look like requests to an
+ * intermediary that does not understand WebSocket.
+ */
+static int random_bytes(websocket_t *ws, uint8_t *out, size_t size) {
+#    ifdef AVS_COMMONS_WITH_AVS_CRYPTO
+    if (avs_crypto_prng_bytes(ws->prng, out, size)) {
+        LOG(ERROR, _("could not generate random data"));
+        return -1;
+    }
+#    else  // AVS_COMMONS_WITH_AVS_CRYPTO
+    for (size_t i = 0; i < size; i += sizeof(uint32_t)) {
+        uint32_t value = avs_rand32_r(&ws->random_seed);
+        memcpy(&out[i], &value, AVS_MIN(sizeof(value), size - i));
+    }
+#    endif // AVS_COMMONS_WITH_AVS_CRYPTO
+    return 0;
+}
+
+static int init_random(websocket_t *ws, const avs_websocket_config_t *config) {
+#    ifdef AVS_COMMONS_WITH_AVS_CRYPTO
+    if ((ws->prng = config->prng_ctx)) {
+        return 0;
+    }
+    if (!(ws->prng = avs_crypto_prng_new(NULL, NULL))) {
+        LOG(ERROR, _("could not create PRNG"));
+        return -1;
+    }
+    ws->prng_owned = true;
+#    else  // AVS_COMMONS_WITH_AVS_CRYPTO
+    (void) config;
+    avs_time_real_t now = avs_time_real_now();
+    ws->random_seed = (avs_rand_seed_t) (now.since_real_epoch.seconds
+                                         ^ now.since_real_epoch.nanoseconds);
+#    endif // AVS_COMMONS_WITH_AVS_CRYPTO
+    return 0;
+}
+
+static int generate_key(websocket_t *ws, char out[WS_KEY_SIZE]) {
+    uint8_t nonce[16];
+    if (random_bytes(ws, nonce, sizeof(nonce))) {
+        return -1;
+    }
+    return avs_base64_encode(out, WS_KEY_SIZE, nonce, sizeof(nonce));
+}
+
+static int compute_accept(const char *key, char out[WS_ACCEPT_SIZE]) {
+    char buf[WS_KEY_SIZE + sizeof(WEBSOCKET_GUID)];
+    size_t key_length = strlen(key);
+    if (key_length >= WS_KEY_SIZE) {
+        return -1;
+    }
+    memcpy(buf, key, key_length);
+    memcpy(buf + key_length, WEBSOCKET_GUID, sizeof(WEBSOCKET_GUID) - 1);
+    uint8_t hash[20];
+    sha1(buf, key_length + sizeof(WEBSOCKET_GUID) - 1, hash);
+    return avs_base64_encode(out, WS_ACCEPT_SIZE, hash, sizeof(hash));
+}
+
+/**
+ * XORs the payload with the masking key. The key is repeated into a 64-bit
+ * word, so that the bulk of the data is processed eight bytes at a time; the
+ * memcpy() calls compile to plain, possibly unaligned, loads and stores, and
+ * leave the compiler free to vectorize the loop.
+ */
+static void apply_mask(uint8_t *data, size_t size, const uint8_t mask[4]) {
+    uint32_t mask32;
+    memcpy(&mask32, mask, sizeof(mask32));
+    const uint64_t mask64 = ((uint64_t) mask32 << 32) | mask32;
+    for (; size >= sizeof(uint64_t);
+         data += sizeof(uint64_t), size -= sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, data, sizeof(word));
+        word ^= mask64;
+        memcpy(data, &word, sizeof(word));
+    }
+    /* the loop above processed a multiple of 4 bytes, so the mask is still
+     * aligned with the data */
+    for (size_t i = 0; i < size; ++i) {
+        data[i] ^= mask[i % 4];
+    }
+}
+
+/* Masks the payload in place and writes a single frame into the netbuf */
+static avs_error_t send_frame(websocket_t *ws,
+                              uint8_t first_byte,
+                              uint8_t *payload,
+                              size_t payload_size) {
+    uint8_t header[WS_FRAME_HEADER_MAX];
+    size_t header_size = 0;
+    header[header_size++] = first_byte;
+    if (payload_size <= WS_CONTROL_PAYLOAD_MAX) {
+        header[header_size++] = (uint8_t) (WS_MASKED | payload_size);
+    } else if (payload_size <= UINT16_MAX) {
+        header[header_size++] = WS_MASKED | 126;
+        header[header_size++] = (uint8_t) (payload_size >> 8);
+        header[header_size++] = (uint8_t) payload_size;
+    } else {
+        header[header_size++] = WS_MASKED | 127;
+        for (int i = 7; i >= 0; --i) {
+            header[header_size++] =
+                    (uint8_t) ((uint64_t) payload_size >> (8 * i));
+        }
+    }
+    if (random_bytes(ws, &header[header_size], 4)) {
+        return avs_errno(AVS_EIO);
+    }
+    apply_mask(payload, payload_size, &header[header_size]);
+    header_size += 4;
+
+    avs_error_t err = avs_stream_write(ws->netbuf, header, header_size);
+    if (avs_is_ok(err) && payload_size) {
+        err = avs_stream_write(ws->netbuf, payload, payload_size);
+    }
+    return err;
+}
+
+static avs_error_t send_control_frame(websocket_t *ws,
+                                      uint8_t opcode,
+                                      const void *payload,
+                                      size_t payload_size) {
+    assert(opcode & WS_OPCODE_CONTROL_BIT);
+    if (payload_size > WS_CONTROL_PAYLOAD_MAX) {
+        LOG(ERROR, _("control frame payload too long"));
+        return avs_errno(AVS_EINVAL);
+    }
+    if (ws->close_sent) {
+        LOG(ERROR, _("WebSocket close frame already sent"));
+        return avs_errno(AVS_EBADF);
+    }
+    uint8_t buf[WS_CONTROL_PAYLOAD_MAX];
+    if (payload_size) {
+        memcpy(buf, payload, payload_size);
+    }
+    avs_error_t err;
+    if (avs_is_err((err = send_frame(ws, (uint8_t) (WS_FIN | opcode), buf,
+                                     payload_size)))
+            || avs_is_err((err = avs_stream_finish_message(ws->netbuf)))) {
+        return err;
+    }
+    if (opcode == WS_OPCODE_CLOSE) {
+        ws->close_sent = true;
+    }
+    return AVS_OK;
+}
+
+static avs_error_t
+send_close(websocket_t *ws, uint16_t code, const char *reason) {
+    uint8_t payload[WS_CONTROL_PAYLOAD_MAX];
+    size_t payload_size = 0;
+    if (code != WS_CLOSE_NO_STATUS) {
+        size_t reason_length = reason ? strlen(reason) : 0;
+        if (reason_length > sizeof(payload) - 2) {
+            LOG(ERROR, _("WebSocket close reason too long"));
+            return avs_errno(AVS_EINVAL);
+        }
+        payload[0] = (uint8_t) (code >> 8);
+        payload[1] = (uint8_t) code;
+        if (reason_length) {
+            memcpy(&payload[2], reason, reason_length);
+        }
+        payload_size = 2 + reason_length;
+    }
+    return send_control_frame(ws, WS_OPCODE_CLOSE, payload, payload_size);
+}
+
+/* Fails the WebSocket connection as described in RFC 6455, section 7.1.7 */
+static avs_error_t fail_connection(websocket_t *ws) {
+    if (!ws->close_sent) {
+        send_close(ws, WS_CLOSE_PROTOCOL_ERROR, NULL);
+    }
+    ws->close_received = true;
+    return avs_errno(AVS_EPROTO);
+}
+
+static avs_error_t send_fragment(websocket_t *ws, size_t size, bool fin) {
+    assert(size <= ws->send_buffer_pos);
+    uint8_t first_byte;
+    if (ws->send_continuation) {
+        first_byte = WS_OPCODE_CONTINUATION;
+    } else {
+        first_byte = (uint8_t) ws->send_type;
+        if (ws->compressor) {
+            first_byte |= WS_RSV1;
+        }
+    }
+    if (fin) {
+        first_byte |= WS_FIN;
+    }
+    avs_error_t err = send_frame(ws, first_byte, ws->send_buffer, size);
+    if (avs_is_err(err)) {
+        return err;
+    }
+    memmove(ws->send_buffer, ws->send_buffer + size,
+            ws->send_buffer_pos - size);
+    ws->send_buffer_pos -= size;
+    ws->send_continuation = !fin;
+    return AVS_OK;
+}
+
+/* Sends a non-final fragment if the send buffer is full */
+static avs_error_t make_room_in_send_buffer(websocket_t *ws) {
+    if (ws->send_buffer_pos < ws->send_buffer_size) {
+        return AVS_OK;
+    }
+    return send_fragment(ws, ws->fragment_size, false);
+}
+
+static avs_error_t drain_compressor(websocket_t *ws) {
+    size_t bytes_read;
+    do {
+        bool message_finished;
+        avs_error_t err = make_room_in_send_buffer(ws);
+        if (avs_is_err(err)
+                || avs_is_err((err = avs_stream_read(
+                                       ws->compressor, &bytes_read,
+                                       &message_finished,
+                                       ws->send_buffer + ws->send_buffer_pos,
+                                       ws->send_buffer_size
+                                               - ws->send_buffer_pos)))) {
+            return err;
+        }
+        ws->send_buffer_pos += bytes_read;
+    } while (bytes_read);
+    return AVS_OK;
+}
+
+static avs_error_t
+write_compressed(websocket_t *ws, const uint8_t *data, size_t data_length) {
+    while (data_length) {
+        size_t chunk_length = data_length;
+        avs_error_t err =
+                avs_stream_write_some(ws->compressor, data, &chunk_length);
+        if (avs_is_err(err) || avs_is_err((err = drain_compressor(ws)))) {
+            return err;
+        }
+        data += chunk_length;
+        data_length -= chunk_length;
+    }
+    return AVS_OK;
+}
+
+static avs_error_t
+write_uncompressed(websocket_t *ws, const uint8_t *data, size_t data_length) {
+    while (data_length) {
+        avs_error_t err = make_room_in_send_buffer(ws);
+        if (avs_is_err(err)) {
+            return err;
+        }
+        size_t chunk_length =
+                AVS_MIN(data_length,
+                        ws->send_buffer_size - ws->send_buffer_pos);
+        memcpy(ws->send_buffer + ws->send_buffer_pos, data, chunk_length);
+        ws->send_buffer_pos += chunk_length;
+        data += chunk_length;
+        data_length -= chunk_length;
+    }
+    return AVS_OK;
+}
+
+static avs_error_t ws_write_some(avs_stream_t *stream,
+                                 const void *data,
+                                 size_t *inout_data_length) {
+    websocket_t *ws = (websocket_t *) stream;
+    if (ws->close_sent) {
+        LOG(ERROR, _("WebSocket close frame already sent"));
+        return avs_errno(AVS_EBADF);
+    }
+    if (ws->compressor) {
+        return write_compressed(ws, (const uint8_t *) data,
+                                *inout_data_length);
+    } else {
+        return write_uncompressed(ws, (const uint8_t *) data,
+                                  *inout_data_length);
+    }
+}
+
+static avs_error_t finish_compressed_message(websocket_t *ws) {
+    avs_error_t err = _avs_http_compressor_sync_flush(ws->compressor);
+    if (avs_is_err(err) || avs_is_err((err = drain_compressor(ws)))) {
+        return err;
+    }
+    /* DEFLATE_TAIL is never sent in a non-final fragment, as the send buffer
+     * has room for it beyond fragment_size */
+    if (ws->send_buffer_pos < sizeof(DEFLATE_TAIL)
+            || memcmp(ws->send_buffer + ws->send_buffer_pos
+                              - sizeof(DEFLATE_TAIL),
+                      DEFLATE_TAIL, sizeof(DEFLATE_TAIL))) {
+        LOG(ERROR, _("unexpected compressor output"));
+        return avs_errno(AVS_EIO);
+    }
+    ws->send_buffer_pos -= sizeof(DEFLATE_TAIL);
+    /* no context takeover */
+    return avs_stream_reset(ws->compressor);
+}
+
+static avs_error_t ws_finish_message(avs_stream_t *stream) {
+    websocket_t *ws = (websocket_t *) stream;
+    if (ws->close_sent) {
+        LOG(ERROR, _("WebSocket close frame already sent"));
+        return avs_errno(AVS_EBADF);
+    }
+    avs_error_t err = AVS_OK;
+    if (ws->compressor) {
+        err = finish_compressed_message(ws);
+    }
+    if (avs_is_ok(err)) {
+        err = send_fragment(ws, ws->send_buffer_pos, true);
+    }
+    if (avs_is_ok(err)) {
+        err = avs_stream_finish_message(ws->netbuf);
+    }
+    return err;
+}
+
+static avs_error_t read_exactly(websocket_t *ws, void *buffer, size_t size) {
+    avs_error_t err = avs_stream_read_reliably(ws->netbuf, buffer, size);
+    if (avs_is_eof(err)) {
+        LOG(ERROR, _("WebSocket connection closed unexpectedly"));
+        ws->close_received = true;
+        return avs_errno(AVS_ECONNRESET);
+    }
+    return err;
+}
+
+static avs_error_t handle_control_frame(websocket_t *ws,
+                                        uint8_t opcode,
+                                        const uint8_t *payload,
+                                        size_t payload_size) {
+    switch (opcode) {
+    case WS_OPCODE_PING:
+        if (ws->close_sent) {
+            return AVS_OK;
+        }
+        return send_control_frame(ws, WS_OPCODE_PONG, payload, payload_size);
+
+    case WS_OPCODE_PONG:
+        ws->pong_pending = false;
+        return AVS_OK;
+
+    case WS_OPCODE_CLOSE:
+        if (payload_size == 1) {
+            return fail_connection(ws);
+        }
+        ws->close_code = (payload_size >= 2)
+                                 ? (uint16_t) ((payload[0] << 8) | payload[1])
+                                 : WS_CLOSE_NO_STATUS;
+        ws->close_received = true;
+        LOG(DEBUG, _("WebSocket closed by peer, code ") "%u",
+            (unsigned) ws->close_code);
+        if (!ws->close_sent) {
+            send_close(ws, ws->close_code, NULL);
+        }
+        return AVS_EOF;
+
+    default:
+        LOG(ERROR, _("unknown WebSocket control opcode: ") "%u",
+            (unsigned) opcode);
+        return fail_connection(ws);
+    }
+}
+
+/**
+ * Receives a frame header, and the payload if it is a control frame.
+ *
+ * Control frames are handled immediately. For data frames, the receiving state
+ * is updated so that the payload can be read from the netbuf.
+ */
+static avs_error_t receive_frame(websocket_t *ws) {
+    uint8_t header[2];
+    avs_error_t err = read_exactly(ws, header, sizeof(header));
+    if (avs_is_err(err)) {
+        return err;
+    }
+    uint8_t opcode = header[0] & WS_OPCODE_MASK;
+    uint64_t payload_size = header[1] & WS_LEN_MASK;
+    if (header[1] & WS_MASKED) {
+        LOG(ERROR, _("received masked WebSocket frame"));
+        return fail_connection(ws);
+    }
+    if (payload_size >= 126) {
+        uint8_t ext[8];
+        size_t ext_size = (payload_size == 126) ? 2 : 8;
+        if (avs_is_err((err = read_exactly(ws, ext, ext_size)))) {
+            return err;
+        }
+        payload_size = 0;
+        for (size_t i = 0; i < ext_size; ++i) {
+            payload_size = (payload_size << 8) | ext[i];
+        }
+    }
+
+    if (opcode & WS_OPCODE_CONTROL_BIT) {
+        if (!(header[0] & WS_FIN) || (header[0] & WS_RSV_MASK)
+                || payload_size > WS_CONTROL_PAYLOAD_MAX) {
+            LOG(ERROR, _("malformed WebSocket control frame"));
+            return fail_connection(ws);
+        }
+        uint8_t payload[WS_CONTROL_PAYLOAD_MAX];
+        if (avs_is_err((err = read_exactly(ws, payload,
+                                           (size_t) payload_size)))) {
+            return err;
+        }
+        return handle_control_frame(ws, opcode, payload,
+                                    (size_t) payload_size);
+    }
+
+    if (opcode == WS_OPCODE_CONTINUATION) {
+        if (!ws->recv_in_message || (header[0] & WS_RSV_MASK)) {
+            LOG(ERROR, _("unexpected WebSocket continuation frame"));
+            return fail_connection(ws);
+        }
+    } else if (opcode == AVS_WEBSOCKET_TEXT || opcode == AVS_WEBSOCKET_BINARY) {
+        if (ws->recv_in_message) {
+            LOG(ERROR, _("WebSocket message interleaved with another one"));
+            return fail_connection(ws);
+        }
+        if ((header[0] & WS_RSV_MASK) & ~(ws->decompressor ? WS_RSV1 : 0)) {
+            LOG(ERROR, _("unexpected WebSocket RSV bits"));
+            return fail_connection(ws);
+        }
+        ws->recv_type = (avs_websocket_message_type_t) opcode;
+        ws->recv_compressed = !!(header[0] & WS_RSV1);
+        ws->recv_tail_written = 0;
+        ws->recv_in_message = true;
+    } else {
+        LOG(ERROR, _("unknown WebSocket opcode: ") "%u", (unsigned) opcode);
+        return fail_connection(ws);
+    }
+    ws->recv_fin = !!(header[0] & WS_FIN);
+    ws->recv_frame_left = payload_size;
+    return AVS_OK;
+}
+
+/**
+ * Receives frames until there is some payload available to read, or the end of
+ * the current message is reached.
+ */
+static avs_error_t ensure_payload(websocket_t *ws) {
+    avs_error_t err = AVS_OK;
+    while (avs_is_ok(err) && !ws->recv_frame_left
+           && !(ws->recv_in_message && ws->recv_fin)) {
+        err = receive_frame(ws);
+    }
+    return err;
+}
+
+static void finish_received_message(websocket_t *ws,
+                                    bool *out_message_finished) {
+    ws->recv_in_message = false;
+    ws->recv_fin = false;
+    *out_message_finished = true;
+}
+
+static avs_error_t read_uncompressed(websocket_t *ws,
+                                     size_t *out_bytes_read,
+                                     bool *out_message_finished,
+                                     void *buffer,
+                                     size_t buffer_length) {
+    avs_error_t err = ensure_payload(ws);
+    if (avs_is_err(err)) {
+        return err;
+    }
+    if (ws->recv_frame_left) {
+        bool eof;
+        if (avs_is_err((err = avs_stream_read(
+                                ws->netbuf, out_bytes_read, &eof, buffer,
+                                (size_t) AVS_MIN(ws->recv_frame_left,
+                                                 (uint64_t) buffer_length))))) {
+            return err;
+        }
+        if (!*out_bytes_read && eof) {
+            return read_exactly(ws, buffer, 1);
+        }
+        ws->recv_frame_left -= *out_bytes_read;
+    }
+    if (!ws->recv_frame_left && ws->recv_fin) {
+        finish_received_message(ws, out_message_finished);
+    }
+    return AVS_OK;
+}
+
+/* Passes more compressed data from the netbuf to the decompressor */
+static avs_error_t feed_decompressor(websocket_t *ws) {
+    size_t space = avs_stream_nonblock_write_ready(ws->decompressor);
+    if (!space) {
+        LOG(ERROR, _("decompressor stalled"));
+        return avs_errno(AVS_EIO);
+    }
+    if (!ws->recv_frame_left && ws->recv_fin) {
+        size_t tail_length = sizeof(DEFLATE_TAIL) - ws->recv_tail_written;
+        avs_error_t err = avs_stream_write_some(
+                ws->decompressor, &DEFLATE_TAIL[ws->recv_tail_written],
+                &tail_length);
+        ws->recv_tail_written += (uint8_t) tail_length;
+        return err;
+    }
+    avs_error_t err = ensure_payload(ws);
+    if (avs_is_err(err) || !ws->recv_frame_left) {
+        return err;
+    }
+    uint8_t buf[512];
+    size_t bytes_read;
+    bool eof;
+    if (avs_is_err((err = avs_stream_read(
+                            ws->netbuf, &bytes_read, &eof, buf,
+                            (size_t) AVS_MIN(AVS_MIN(ws->recv_frame_left,
+                                                     (uint64_t) sizeof(buf)),
+                                             (uint64_t) space))))) {
+        return err;
+    }
+    if (!bytes_read && eof) {
+        return read_exactly(ws, buf, 1);
+    }
+    ws->recv_frame_left -= bytes_read;
+    return avs_stream_write(ws->decompressor, buf, bytes_read);
+}
+
+static avs_error_t read_compressed(websocket_t *ws,
+                                   size_t *out_bytes_read,
+                                   bool *out_message_finished,
+                                   void *buffer,
+                                   size_t buffer_length) {
+    while (true) {
+        bool decompressor_finished;
+        avs_error_t err =
+                avs_stream_read(ws->decompressor, out_bytes_read,
+                                &decompressor_finished, buffer, buffer_length);
+        if (avs_is_err(err) || *out_bytes_read) {
+            return err;
+        }
+        if (ws->recv_tail_written == sizeof(DEFLATE_TAIL)) {
+            finish_received_message(ws, out_message_finished);
+            /* no context takeover */
+            return avs_stream_reset(ws->decompressor);
+        }
+        if (avs_is_err((err = feed_decompressor(ws)))) {
+            return err;
+        }
+    }
+}
+
+static avs_error_t ws_read(avs_stream_t *stream,
+                           size_t *out_bytes_read,
+                           bool *out_message_finished,
+                           void *buffer,
+                           size_t buffer_length) {
+    websocket_t *ws = (websocket_t *) stream;
+    *out_bytes_read = 0;
+    *out_message_finished = false;
+    if (ws->close_received) {
+        return AVS_EOF;
+    }
+    if (!buffer_length) {
+        return AVS_OK;
+    }
+    if (!ws->recv_in_message) {
+        avs_error_t err = ensure_payload(ws);
+        if (avs_is_err(err)) {
+            return err;
+        }
+    }
+    if (ws->recv_compressed) {
+        return read_compressed(ws, out_bytes_read, out_message_finished,
+                               buffer, buffer_length);
+    } else {
+        return read_uncompressed(ws, out_bytes_read, out_message_finished,
+                                 buffer, buffer_length);
+    }
+}
+
+static avs_error_t ws_close(avs_stream_t *stream) {
+    websocket_t *ws = (websocket_t *) stream;
+    if (ws->sched) {
+        avs_sched_del(&ws->ping_job);
+    }
+    if (ws->netbuf && !ws->close_sent && !ws->close_received) {
+        send_close(ws, WS_CLOSE_NORMAL, NULL);
+    }
+    avs_error_t err = avs_stream_cleanup(&ws->netbuf);
+    avs_stream_cleanup(&ws->compressor);
+    avs_stream_cleanup(&ws->decompressor);
+    avs_free(ws->send_buffer);
+    avs_free(ws->subprotocol);
+#    ifdef AVS_COMMONS_WITH_AVS_CRYPTO
+    if (ws->prng_owned) {
+        avs_crypto_prng_free(&ws->prng);
+    }
+#    endif // AVS_COMMONS_WITH_AVS_CRYPTO
+    return err;
+}
+
+static avs_net_socket_t *ws_getsock(avs_stream_t *stream) {
+    return avs_stream_net_getsock(((websocket_t *) stream)->netbuf);
+}
+
+static avs_error_t ws_setsock(avs_stream_t *stream, avs_net_socket_t *socket) {
+    return avs_stream_net_setsock(((websocket_t *) stream)->netbuf, socket);
+}
+
+static bool ws_nonblock_read_ready(avs_stream_t *stream) {
+    websocket_t *ws = (websocket_t *) stream;
+    return ws->close_received
+           || (ws->recv_compressed
+               && avs_stream_nonblock_read_ready(ws->decompressor))
+           || avs_stream_nonblock_read_ready(ws->netbuf);
+}
+
+static size_t ws_nonblock_write_ready(avs_stream_t *stream) {
+    websocket_t *ws = (websocket_t *) stream;
+    if (ws->close_sent) {
+        return 0;
+    }
+    /* only the data exceeding the current fragment triggers a send */
+    return ws->send_buffer_size - ws->send_buffer_pos;
+}
+
+static const avs_stream_v_table_t websocket_vtable = {
+    .write_some = ws_write_some,
+    .finish_message = ws_finish_message,
+    .read = ws_read,
+    .close = ws_close,
+    .extension_list =
+            (const avs_stream_v_table_extension_t[]) {
+                    { AVS_STREAM_V_TABLE_EXTENSION_NET,
+                      &(const avs_stream_v_table_extension_net_t) {
+                              ws_getsock, ws_setsock } },
+                    { AVS_STREAM_V_TABLE_EXTENSION_NONBLOCK,
+                      &(const avs_stream_v_table_extension_nonblock_t) {
+                              ws_nonblock_read_ready,
+                              ws_nonblock_write_ready } },
+                    AVS_STREAM_V_TABLE_EXTENSION_NULL }
+};
+
+static websocket_t *get_websocket(avs_stream_t *stream) {
+    if (!stream || *(const avs_stream_v_table_t *const *) stream
+                           != &websocket_vtable) {
+        LOG(ERROR, _("not a WebSocket stream"));
+        return NULL;
+    }
+    return (websocket_t *) stream;
+}
+
+static void ping_job(avs_sched_t *sched, const void *ws_ptr);
+
+static int schedule_ping(websocket_t *ws) {
+    return AVS_SCHED_DELAYED(ws->sched, &ws->ping_job, ws->ping_interval,
+                             ping_job, &ws, sizeof(ws));
+}
+
+static void ping_job(avs_sched_t *sched, const void *ws_ptr) {
+    (void) sched;
+    websocket_t *ws = *(websocket_t *const *) ws_ptr;
+    if (ws->close_sent || ws->close_received) {
+        return;
+    }
+    if (ws->pong_pending) {
+        LOG(WARNING, _("no WebSocket pong received, shutting down"));
+        avs_net_socket_shutdown(avs_stream_net_getsock(ws->netbuf));
+        /* the connection is dead, don't attempt a closing handshake */
+        ws->close_sent = true;
+        return;
+    }
+    if (avs_is_ok(send_control_frame(ws, WS_OPCODE_PING, NULL, 0))) {
+        ws->pong_pending = true;
+        if (schedule_ping(ws)) {
+            LOG(ERROR, _("could not schedule WebSocket ping"));
+        }
+    }
+}
+
+static size_t safe_strlen(const char *str) {
+    return str ? strlen(str) : 0;
+}
+
+static avs_url_t *make_http_url(const avs_url_t *url) {
+    const char *protocol = avs_url_protocol(url);
+    if (!protocol) {
+        LOG(ERROR, _("WebSocket URL without protocol"));
+        return NULL;
+    } else if (avs_strcasecmp(protocol, "ws") == 0) {
+        protocol = "http";
+    } else if (avs_strcasecmp(protocol, "wss") == 0) {
+        protocol = "https";
+    } else if (avs_strcasecmp(protocol, "http")
+               && avs_strcasecmp(protocol, "https")) {
+        LOG(ERROR, _("unsupported WebSocket protocol: ") "%s", protocol);
+        return NULL;
+    }
+    const avs_url_components_t components = {
+        .protocol = protocol,
+        .user = avs_url_user(url),
+        .password = avs_url_password(url),
+        .host = avs_url_host(url),
+        .port = avs_url_port(url),
+        .path = avs_url_path(url)
+    };
+    /* user and password may grow up to three times due to percent-encoding */
+    size_t buf_size = strlen(protocol) + 3 * safe_strlen(components.user)
+                      + 3 * safe_strlen(components.password)
+                      + safe_strlen(components.host)
+                      + safe_strlen(components.port) + strlen(components.path)
+                      + sizeof("://:@[]:");
+    char *buf = (char *) avs_malloc(buf_size);
+    avs_url_t *result = NULL;
+    if (!buf) {
+        LOG(ERROR, _("Out of memory"));
+    } else if (avs_url_build(buf, buf_size, &components)
+               || !(result = avs_url_parse(buf))) {
+        LOG(ERROR, _("could not convert WebSocket URL"));
+    }
+    avs_free(buf);
+    return result;
+}
+
+/* Extracts the next token delimited by @p delim, without surrounding
+ * whitespace. */
+static size_t
+next_token(const char **ptr, char delim, const char **out_token) {
+    const char *begin = *ptr + strspn(*ptr, " \t");
+    const char *end = strchr(begin, delim);
+    if (!end) {
+        end = begin + strlen(begin);
+    }
+    *ptr = *end ? end + 1 : end;
+    while (end > begin && (end[-1] == ' ' || end[-1] == '\t')) {
+        --end;
+    }
+    *out_token = begin;
+    return (size_t) (end - begin);
+}
+
+static bool
+token_equals(const char *token, size_t token_length, const char *str) {
+    return strlen(str) == token_length
+           && avs_strncasecmp(token, str, token_length) == 0;
+}
+
+static bool header_has_token(const char *value, const char *token) {
+    while (*value) {
+        const char *current;
+        size_t length = next_token(&value, ',', &current);
+        if (token_equals(current, length, token)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static const char *find_header(AVS_LIST(const avs_http_header_t) headers,
+                               const char *key) {
+    AVS_LIST_ITERATE(headers) {
+        if (avs_strcasecmp(headers->key, key) == 0) {
+            return headers->value;
+        }
+    }
+    return NULL;
+}
+
+/* Parses the value of a "name=N" window bits parameter */
+static int parse_window_bits(const char *param, size_t length) {
+    const char *value = (const char *) memchr(param, '=', length);
+    if (!value) {
+        return -1;
+    }
+    ++value;
+    size_t value_length = (size_t) (param + length - value);
+    if (value_length < 1 || value_length > 2) {
+        return -1;
+    }
+    int result = 0;
+    for (size_t i = 0; i < value_length; ++i) {
+        if (!isdigit((unsigned char) value[i])) {
+            return -1;
+        }
+        result = 10 * result + (value[i] - '0');
+    }
+    return (result >= HTTP_COMPRESSOR_WINDOW_BITS_MIN
+            && result <= HTTP_COMPRESSOR_WINDOW_BITS_MAX)
+                   ? result
+                   : -1;
+}
+
+/**
+ * Parses the permessage-deflate response parameters. We offer no context
+ * takeover in both directions, so the server needs to confirm
+ * server_no_context_takeover, and may limit the window of our compressor.
+ */
+static int parse_extensions(const char *value, int *out_client_window_bits) {
+    const char *token;
+    size_t length = next_token(&value, ';', &token);
+    if (!token_equals(token, length, "permessage-deflate")) {
+        LOG(ERROR, _("unsupported WebSocket extension"));
+        return -1;
+    }
+    bool server_no_context_takeover = false;
+    *out_client_window_bits = HTTP_COMPRESSOR_WINDOW_BITS_DEFAULT;
+    while (*value) {
+        length = next_token(&value, ';', &token);
+        if (token_equals(token, length, "server_no_context_takeover")) {
+            server_no_context_takeover = true;
+        } else if (token_equals(token, length, "client_no_context_takeover")) {
+            /* we don't use context takeover anyway */
+        } else if (length > sizeof("client_max_window_bits")
+                   && avs_strncasecmp(token, "client_max_window_bits=",
+                                      sizeof("client_max_window_bits"))
+                              == 0) {
+            /* zlib does not support 8-bit windows for raw deflate */
+            if ((*out_client_window_bits = parse_window_bits(token, length))
+                    < 9) {
+                LOG(ERROR, _("unsupported client_max_window_bits"));
+                return -1;
+            }
+        } else if (length > sizeof("server_max_window_bits")
+                   && avs_strncasecmp(token, "server_max_window_bits=",
+                                      sizeof("server_max_window_bits"))
+                              == 0) {
+            /* our decompressor always uses the maximum window */
+            if (parse_window_bits(token, length) < 0) {
+                return -1;
+            }
+        } else {
+            LOG(ERROR, _("unsupported permessage-deflate parameter"));
+            return -1;
+        }
+    }
+    if (!server_no_context_takeover) {
+        LOG(ERROR, _("server_no_context_takeover not confirmed"));
+        return -1;
+    }
+    return 0;
+}
+
+static int init_compression(websocket_t *ws,
+                            const avs_http_buffer_sizes_t *buffer_sizes,
+                            int client_window_bits) {
+    ws->compressor = _avs_http_create_compressor(
+            AVS_STREAM_COMPRESSION_RAW_DEFLATE, client_window_bits,
+            buffer_sizes->content_coding_input,
+            buffer_sizes->content_coding_input);
+    ws->decompressor = _avs_http_create_decompressor(
+            AVS_STREAM_COMPRESSION_RAW_DEFLATE,
+            HTTP_COMPRESSOR_WINDOW_BITS_MAX,
+            buffer_sizes->content_coding_input,
+            buffer_sizes->content_coding_input);
+    return (ws->compressor && ws->decompressor) ? 0 : -1;
+}
+
+static avs_error_t
+check_handshake_response(websocket_t *ws,
+                         const char *key,
+                         bool deflate_offered,
+                         AVS_LIST(const avs_http_header_t) headers,
+                         int *out_client_window_bits) {
+    char expected_accept[WS_ACCEPT_SIZE];
+    const char *upgrade = find_header(headers, "Upgrade");
+    const char *connection = find_header(headers, "Connection");
+    const char *accept = find_header(headers, "Sec-WebSocket-Accept");
+    const char *protocol = find_header(headers, "Sec-WebSocket-Protocol");
+    const char *extensions = find_header(headers, "Sec-WebSocket-Extensions");
+    *out_client_window_bits = -1;
+    if (!upgrade || avs_strcasecmp(upgrade, "websocket") || !connection
+            || !header_has_token(connection, "upgrade")) {
+        LOG(ERROR, _("invalid WebSocket upgrade response"));
+        return avs_errno(AVS_EPROTO);
+    }
+    if (compute_accept(key, expected_accept) || !accept
+            || strcmp(accept, expected_accept)) {
+        LOG(ERROR, _("invalid Sec-WebSocket-Accept"));
+        return avs_errno(AVS_EPROTO);
+    }
+    if (extensions
+            && (!deflate_offered
+                || parse_extensions(extensions, out_client_window_bits))) {
+        LOG(ERROR, _("invalid Sec-WebSocket-Extensions: ") "%s", extensions);
+        return avs_errno(AVS_EPROTO);
+    }
+    if (protocol && !(ws->subprotocol = avs_strdup(protocol))) {
+        LOG(ERROR, _("Out of memory"));
+        return avs_errno(AVS_ENOMEM);
+    }
+    return AVS_OK;
+}
+
+static avs_error_t perform_handshake(websocket_t *ws,
+                                     avs_stream_t *http_stream,
+                                     const avs_websocket_config_t *config,
+                                     int *out_client_window_bits) {
+    char key[WS_KEY_SIZE];
+    if (generate_key(ws, key)) {
+        return avs_errno(AVS_EINVAL);
+    }
+    bool deflate_offered = false;
+#    ifdef AVS_COMMONS_HTTP_WITH_ZLIB
+    deflate_offered = config->permessage_deflate;
+#    endif // AVS_COMMONS_HTTP_WITH_ZLIB
+    AVS_LIST(const avs_http_header_t) headers = NULL;
+    avs_http_set_header_storage(http_stream, &headers);
+    avs_error_t err = AVS_OK;
+    if (avs_http_add_header(http_stream, "Upgrade", "websocket")
+            || avs_http_add_header(http_stream, "Connection", "Upgrade")
+            || avs_http_add_header(http_stream, "Sec-WebSocket-Key", key)
+            || avs_http_add_header(http_stream, "Sec-WebSocket-Version", "13")
+            || (config->subprotocols
+                && avs_http_add_header(http_stream, "Sec-WebSocket-Protocol",
+                                       config->subprotocols))
+            || (deflate_offered
+                && avs_http_add_header(
+                           http_stream, "Sec-WebSocket-Extensions",
+                           "permessage-deflate; server_no_context_takeover; "
+                           "client_no_context_takeover; "
+                           "client_max_window_bits"))) {
+        err = avs_errno(AVS_ENOMEM);
+    } else if (avs_is_ok((err = avs_stream_finish_message(http_stream)))
+               && avs_http_status_code(http_stream) != 101) {
+        LOG(ERROR, _("WebSocket handshake failed, status ") "%d",
+            avs_http_status_code(http_stream));
+        err = (avs_error_t) {
+            .category = AVS_HTTP_ERROR_CATEGORY,
+            .code = (uint16_t) avs_http_status_code(http_stream)
+        };
+    }
+    if (avs_is_ok(err)) {
+        err = check_handshake_response(ws, key, deflate_offered, headers,
+                                       out_client_window_bits);
+    }
+    avs_http_set_header_storage(http_stream, NULL);
+    AVS_LIST_CLEAR(&headers);
+    return err;
+}
+
+/* Takes over the connection, along with any data already buffered */
+static avs_error_t take_over_connection(websocket_t *ws,
+                                        avs_http_t *http,
+                                        avs_stream_t *http_stream) {
+    avs_net_socket_t *socket = avs_stream_net_getsock(http_stream);
+    if (avs_stream_netbuf_create(&ws->netbuf, socket,
+                                 http->buffer_sizes.body_recv,
+                                 http->buffer_sizes.body_send)) {
+        return avs_errno(AVS_ENOMEM);
+    }
+    if (avs_stream_netbuf_transfer(ws->netbuf,
+                                   ((http_stream_t *) http_stream)->backend)) {
+        avs_stream_net_setsock(ws->netbuf, NULL);
+        avs_stream_cleanup(&ws->netbuf);
+        return avs_errno(AVS_ENOBUFS);
+    }
+    avs_stream_net_setsock(http_stream, NULL);
+    return AVS_OK;
+}
+
+avs_error_t avs_websocket_connect(avs_stream_t **out_stream,
+                                  avs_http_t *http,
+                                  const avs_url_t *url,
+                                  const char *auth_username,
+                                  const char *auth_password,
+                                  const avs_websocket_config_t *config) {
+    static const avs_websocket_config_t DEFAULT_CONFIG = { NULL };
+    if (!config) {
+        config = &DEFAULT_CONFIG;
+    }
+    *out_stream = NULL;
+    if (avs_time_duration_valid(config->ping_interval)
+            && avs_time_duration_less(config->ping_interval,
+                                      AVS_TIME_DURATION_ZERO)) {
+        LOG(ERROR, _("negative WebSocket ping interval"));
+        return avs_errno(AVS_EINVAL);
+    }
+    websocket_t *ws = (websocket_t *) avs_calloc(1, sizeof(websocket_t));
+    if (!ws) {
+        LOG(ERROR, _("Out of memory"));
+        return avs_errno(AVS_ENOMEM);
+    }
+    *(const avs_stream_v_table_t **) (intptr_t) &ws->vtable =
+            &websocket_vtable;
+    ws->send_type = AVS_WEBSOCKET_BINARY;
+    ws->recv_type = AVS_WEBSOCKET_BINARY;
+    ws->fragment_size = config->fragment_size ? config->fragment_size
+                                              : DEFAULT_FRAGMENT_SIZE;
+    /* an invalid interval disables pings */
+    if (avs_time_duration_valid(config->ping_interval)) {
+        ws->sched = config->sched;
+        ws->ping_interval = config->ping_interval;
+        if (avs_time_duration_equal(ws->ping_interval,
+                                    AVS_TIME_DURATION_ZERO)) {
+            ws->ping_interval = DEFAULT_PING_INTERVAL;
+        }
+    }
+
+    avs_stream_t *http_stream = NULL;
+    int client_window_bits = -1;
+    avs_error_t err = avs_errno(AVS_EINVAL);
+    avs_url_t *http_url = NULL;
+    if (init_random(ws, config)) {
+        err = avs_errno(AVS_ENOMEM);
+    } else if ((http_url = make_http_url(url))
+               && avs_is_ok((err = avs_http_open_stream(
+                                     &http_stream, http, AVS_HTTP_GET,
+                                     AVS_HTTP_CONTENT_IDENTITY, http_url,
+                                     auth_username, auth_password)))
+               && avs_is_ok((err = perform_handshake(ws, http_stream, config,
+                                                     &client_window_bits)))) {
+        err = take_over_connection(ws, http, http_stream);
+    }
+    avs_url_free(http_url);
+    avs_stream_cleanup(&http_stream);
+
+    if (avs_is_ok(err) && client_window_bits > 0
+            && init_compression(ws, &http->buffer_sizes, client_window_bits)) {
+        err = avs_errno(AVS_ENOMEM);
+    }
+    if (avs_is_ok(err)) {
+        ws->send_buffer_size =
+                ws->fragment_size
+                + (ws->compressor ? sizeof(DEFLATE_TAIL) : 0);
+        if (!(ws->send_buffer = (uint8_t *) avs_malloc(ws->send_buffer_size))) {
+            err = avs_errno(AVS_ENOMEM);
+        }
+    }
+    if (avs_is_ok(err) && ws->sched && schedule_ping(ws)) {
+        LOG(ERROR, _("could not schedule WebSocket ping"));
+        err = avs_errno(AVS_ENOMEM);
+    }
+    if (avs_is_err(err)) {
+        /* don't send a close frame on a connection that failed to open */
+        ws->close_sent = true;
+        avs_stream_t *stream = (avs_stream_t *) ws;
+        avs_stream_cleanup(&stream);
+        return err;
+    }
+    *out_stream = (avs_stream_t *) ws;
+    return AVS_OK;
+}
+
+int avs_websocket_set_message_type(avs_stream_t *stream,
+                                   avs_websocket_message_type_t type) {
+    websocket_t *ws = get_websocket(stream);
+    if (!ws || (type != AVS_WEBSOCKET_TEXT && type != AVS_WEBSOCKET_BINARY)) {
+        return -1;
+    }
+    if (ws->send_continuation && ws->send_type != type) {
+        LOG(ERROR, _("cannot change type of a partially sent message"));
+        return -1;
+    }
+    ws->send_type = type;
+    return 0;
+}
+
+avs_websocket_message_type_t avs_websocket_message_type(avs_stream_t *stream) {
+    websocket_t *ws = get_websocket(stream);
+    return ws ? ws->recv_type : AVS_WEBSOCKET_BINARY;
+}
+
+const char *avs_websocket_subprotocol(avs_stream_t *stream) {
+    websocket_t *ws = get_websocket(stream);
+    return ws ? ws->subprotocol : NULL;
+}
+
+avs_error_t avs_websocket_ping(avs_stream_t *stream,
+                               const void *payload,
+                               size_t payload_size) {
+    websocket_t *ws = get_websocket(stream);
+    if (!ws) {
+        return avs_errno(AVS_EINVAL);
+    }
+    return send_control_frame(ws, WS_OPCODE_PING, payload, payload_size);
+}
+
+avs_error_t
+avs_websocket_close(avs_stream_t *stream, uint16_t code, const char *reason) {
+    websocket_t *ws = get_websocket(stream);
+    if (!ws) {
+        return avs_errno(AVS_EINVAL);
+    }
+    return send_close(ws, code, reason);
+}
+
+uint16_t avs_websocket_close_code(avs_stream_t *stream) {
+    websocket_t *ws = get_websocket(stream);
+    return ws ? ws->close_code : 0;
+}
+
+#    ifdef AVS_UNIT_TESTING
+#        include "tests/http/test_websocket.c"
+#    endif
+
+#endif // defined(AVS_COMMONS_WITH_AVS_HTTP) &&
+       // defined(AVS_COMMONS_HTTP_WITH_WEBSOCKET)
@@ -84,6 +84,9 @@ content_length_peek(avs_stream_t *stream_, size_t offset, char *out_value) {
 
 static avs_error_t content_length_close(avs_stream_t *stream_) {
     content_length_receiver_t *stream = (content_length_receiver_t *) stream_;
+    if (!stream->backend) {
+        return AVS_OK;
+    }
     avs_stream_net_setsock(stream->backend, NULL); /* don't close the socket */
     return avs_stream_cleanup(&stream->backend);
 }
@@ -19,12 +19,18 @@
 
 #ifdef AVS_COMMONS_WITH_AVS_LOG
 
+#    include <inttypes.h>
+#    include <math.h>
 #    include <stdarg.h>
 #    include <stdio.h>
 #    include <string.h>
 
 #    include <avsystem/commons/avs_list.h>
 #    include <avsystem/commons/avs_log.h>
+#    include <avsystem/commons/avs_utils.h>
+#    ifdef AVS_COMMONS_LOG_WITH_RATE_LIMIT
+#        include <avsystem/commons/avs_time.h>
+#    endif // AVS_COMMONS_LOG_WITH_RATE_LIMIT
 
 #    ifdef AVS_COMMONS_WITH_AVS_COMPAT_THREADING
 #        include <avsystem/commons/avs_init_once.h>
@@ -45,16 +51,49 @@ static void default_log_handler(avs_log_level_t level,
 #    endif // AVS_COMMONS_LOG_WITH_DEFAULT_HANDLER
 }
 
+#    ifdef AVS_COMMONS_LOG_WITH_RATE_LIMIT
+typedef struct {
+    /* 0 if rate limiting is disabled */
+    unsigned burst;
+    /* negative if the default limit shall be used */
+    int64_t interval_us;
+} rate_limit_t;
+
+typedef struct {
+    /* NULL if the entry is unused */
+    const char *file;
+    unsigned line;
+    unsigned tokens;
+    avs_time_monotonic_t refill_time;
+    uint32_t suppressed;
+} call_site_t;
+#    endif // AVS_COMMONS_LOG_WITH_RATE_LIMIT
+
 typedef struct {
     avs_log_level_t level;
+#    ifdef AVS_COMMONS_LOG_WITH_RATE_LIMIT
+    /* true if the entry was created only to hold rate limits, in which case
+     * level is ignored and the default level is used instead */
+    bool inherits_level;
+    rate_limit_t rate_limits[AVS_LOG_QUIET];
+#    endif // AVS_COMMONS_LOG_WITH_RATE_LIMIT
     char module[1];
 } module_level_t;
 
 static struct {
     avs_log_handler_t *handler;
+#    ifdef AVS_COMMONS_LOG_WITH_STRUCTURED
+    avs_log_record_handler_t *record_handler;
+#    endif // AVS_COMMONS_LOG_WITH_STRUCTURED
     avs_log_level_t default_level;
     AVS_LIST(module_level_t) module_levels;
 
+#    ifdef AVS_COMMONS_LOG_WITH_RATE_LIMIT
+    rate_limit_t default_rate_limits[AVS_LOG_QUIET];
+    call_site_t call_sites[AVS_COMMONS_LOG_RATE_LIMIT_CALL_SITES];
+    uint64_t dropped_counts[AVS_LOG_QUIET];
+#    endif // AVS_COMMONS_LOG_WITH_RATE_LIMIT
+
 #    ifdef AVS_COMMONS_LOG_USE_GLOBAL_BUFFER
     char buffer[AVS_COMMONS_LOG_MAX_LINE_LENGTH];
 #    endif // AVS_COMMONS_LOG_USE_GLOBAL_BUFFER
@@ -64,6 +103,19 @@ static struct {
     .module_levels = NULL
 };
 
+#    ifdef AVS_COMMONS_LOG_WITH_STRUCTURED
+#        if defined(__GNUC__) || defined(__clang__)
+#            define LOG_THREAD_LOCAL __thread
+#        else // defined(__GNUC__) || defined(__clang__)
+// C99 has no thread-local storage - a single context is shared by all threads
+#            define LOG_THREAD_LOCAL
+#        endif // defined(__GNUC__) || defined(__clang__)
+
+static LOG_THREAD_LOCAL avs_log_field_t
+        t_context_fields[AVS_COMMONS_LOG_CONTEXT_MAX_FIELDS];
+static LOG_THREAD_LOCAL size_t t_context_field_count;
+#    endif // AVS_COMMONS_LOG_WITH_STRUCTURED
+
 #    ifdef AVS_COMMONS_WITH_AVS_COMPAT_THREADING
 static avs_mutex_t *g_log_mutex;
 static avs_init_once_handle_t g_log_init_handle;
@@ -143,6 +195,13 @@ static avs_log_level_t *level_for(const char *module, int create) {
                 return NULL;
             }
             new_entry->level = g_log.default_level;
+#    ifdef AVS_COMMONS_LOG_WITH_RATE_LIMIT
+            new_entry->inherits_level = true;
+            for (size_t i = 0; i < AVS_ARRAY_SIZE(new_entry->rate_limits);
+                 ++i) {
+                new_entry->rate_limits[i].interval_us = -1;
+            }
+#    endif // AVS_COMMONS_LOG_WITH_RATE_LIMIT
             memcpy(new_entry->module, module, module_size);
             new_entry->module[module_size] = '\0';
             AVS_LIST_INSERT(entry_ptr, new_entry);
@@ -152,6 +211,17 @@ static avs_log_level_t *level_for(const char *module, int create) {
     return &g_log.default_level;
 }
 
+static avs_log_level_t level_value(const avs_log_level_t *level_ptr) {
+#    ifdef AVS_COMMONS_LOG_WITH_RATE_LIMIT
+    if (level_ptr != &g_log.default_level
+            && AVS_CONTAINER_OF(level_ptr, module_level_t, level)
+                       ->inherits_level) {
+        return g_log.default_level;
+    }
+#    endif // AVS_COMMONS_LOG_WITH_RATE_LIMIT
+    return *level_ptr;
+}
+
 static int set_log_level_unlocked(const char *module, avs_log_level_t level) {
     avs_log_level_t *level_ptr = level_for(module, 1);
     if (!level_ptr) {
@@ -163,6 +233,12 @@ static int set_log_level_unlocked(const char *module, avs_log_level_t level) {
         return -1;
     }
     *level_ptr = level;
+#    ifdef AVS_COMMONS_LOG_WITH_RATE_LIMIT
+    if (level_ptr != &g_log.default_level) {
+        AVS_CONTAINER_OF(level_ptr, module_level_t, level)->inherits_level =
+                false;
+    }
+#    endif // AVS_COMMONS_LOG_WITH_RATE_LIMIT
     return 0;
 }
 
@@ -180,6 +256,15 @@ void avs_log_reset(void) {
         return;
     }
     AVS_LIST_CLEAR(&g_log.module_levels);
+#    ifdef AVS_COMMONS_LOG_WITH_RATE_LIMIT
+    memset(g_log.default_rate_limits, 0, sizeof(g_log.default_rate_limits));
+    memset(g_log.call_sites, 0, sizeof(g_log.call_sites));
+    memset(g_log.dropped_counts, 0, sizeof(g_log.dropped_counts));
+#    endif // AVS_COMMONS_LOG_WITH_RATE_LIMIT
+#    ifdef AVS_COMMONS_LOG_WITH_STRUCTURED
+    g_log.record_handler = NULL;
+    t_context_field_count = 0;
+#    endif // AVS_COMMONS_LOG_WITH_STRUCTURED
     set_log_handler_unlocked(default_log_handler);
     set_log_level_unlocked(NULL, AVS_LOG_INFO);
     LOG_UNLOCK();
@@ -193,11 +278,188 @@ int avs_log_should_log__(avs_log_level_t level, const char *module) {
     if (LOG_LOCK()) {
         return 1;
     }
-    int result = (level >= *level_for(module, 0));
+    int result = (level >= level_value(level_for(module, 0)));
     LOG_UNLOCK();
     return result;
 }
 
+#    ifdef AVS_COMMONS_LOG_WITH_RATE_LIMIT
+static const rate_limit_t *rate_limit_for(const avs_log_level_t *level_ptr,
+                                          avs_log_level_t level) {
+    if (level_ptr != &g_log.default_level) {
+        const module_level_t *entry =
+                AVS_CONTAINER_OF(level_ptr, module_level_t, level);
+        if (entry->rate_limits[level].interval_us >= 0) {
+            return &entry->rate_limits[level];
+        }
+    }
+    return &g_log.default_rate_limits[level];
+}
+
+static int set_rate_limit_unlocked(const char *module,
+                                   avs_log_level_t level,
+                                   unsigned burst,
+                                   int64_t interval_us) {
+    avs_log_level_t *level_ptr = level_for(module, 1);
+    if (!level_ptr) {
+        return -1;
+    }
+    rate_limit_t *limit;
+    if (level_ptr == &g_log.default_level) {
+        limit = &g_log.default_rate_limits[level];
+    } else {
+        limit = &AVS_CONTAINER_OF(level_ptr, module_level_t, level)
+                         ->rate_limits[level];
+    }
+    limit->burst = burst;
+    limit->interval_us = interval_us;
+    return 0;
+}
+
+int avs_log_set_rate_limit__(const char *module,
+                             avs_log_level_t level,
+                             unsigned burst,
+                             avs_time_duration_t interval) {
+    int64_t interval_us = 0;
+    if ((int) level < 0 || level >= AVS_LOG_QUIET
+            || (burst
+                && (avs_time_duration_to_scalar(&interval_us, AVS_TIME_US,
+                                                interval)
+                    || interval_us <= 0))) {
+        return -1;
+    }
+    if (LOG_LOCK()) {
+        return -1;
+    }
+    int result = set_rate_limit_unlocked(module, level, burst, interval_us);
+    LOG_UNLOCK();
+    return result;
+}
+
+uint64_t avs_log_dropped_count(avs_log_level_t level) {
+    if (LOG_LOCK()) {
+        return 0;
+    }
+    uint64_t result = 0;
+    for (size_t i = 0; i < AVS_ARRAY_SIZE(g_log.dropped_counts); ++i) {
+        if (level == AVS_LOG_QUIET || level == (avs_log_level_t) i) {
+            result += g_log.dropped_counts[i];
+        }
+    }
+    LOG_UNLOCK();
+    return result;
+}
+
+static call_site_t *find_call_site(const char *file, unsigned line) {
+    const size_t count = AVS_ARRAY_SIZE(g_log.call_sites);
+    size_t home = (size_t) (((uintptr_t) file >> 3) ^ (line * 2654435761u))
+                  % count;
+    for (size_t i = 0; i < count; ++i) {
+        call_site_t *site = &g_log.call_sites[(home + i) % count];
+        if (!site->file || (site->file == file && site->line == line)) {
+            return site;
+        }
+    }
+    /* table is full; the colliding call site is forgotten */
+    g_log.call_sites[home].file = NULL;
+    return &g_log.call_sites[home];
+}
+
+static void refill_tokens(call_site_t *site,
+                          const rate_limit_t *limit,
+                          avs_time_monotonic_t now) {
+    int64_t elapsed_us;
+    if (avs_time_duration_to_scalar(
+                &elapsed_us, AVS_TIME_US,
+                avs_time_monotonic_diff(now, site->refill_time))
+            || elapsed_us < 0) {
+        return;
+    }
+    int64_t new_tokens = elapsed_us / limit->interval_us;
+    if (site->tokens >= limit->burst
+            || new_tokens >= (int64_t) (limit->burst - site->tokens)) {
+        site->tokens = limit->burst;
+        site->refill_time = now;
+    } else {
+        site->tokens += (unsigned) new_tokens;
+        site->refill_time = avs_time_monotonic_add(
+                site->refill_time,
+                avs_time_duration_from_scalar(new_tokens * limit->interval_us,
+                                              AVS_TIME_US));
+    }
+}
+
+/**
+ * Checks whether the token bucket of the call site allows logging a message.
+ * If it does, the number of messages suppressed since the last allowed one is
+ * returned via @p out_suppressed.
+ */
+static int rate_limit_allows_unlocked(const rate_limit_t *limit,
+                                      avs_log_level_t level,
+                                      const char *file,
+                                      unsigned line,
+                                      avs_time_monotonic_t now,
+                                      uint32_t *out_suppressed) {
+    call_site_t *site = find_call_site(file, line);
+    if (!site->file) {
+        site->file = file;
+        site->line = line;
+        site->tokens = limit->burst;
+        site->refill_time = now;
+        site->suppressed = 0;
+    } else {
+        refill_tokens(site, limit, now);
+    }
+    if (!site->tokens) {
+        if (site->suppressed < UINT32_MAX) {
+            ++site->suppressed;
+        }
+        ++g_log.dropped_counts[level];
+        return 0;
+    }
+    --site->tokens;
+    *out_suppressed = site->suppressed;
+    site->suppressed = 0;
+    return 1;
+}
+#    endif // AVS_COMMONS_LOG_WITH_RATE_LIMIT
+
+int avs_log_should_log_at__(avs_log_level_t level,
+                            const char *module,
+                            const char *file,
+                            unsigned line) {
+    if (level >= AVS_LOG_QUIET) {
+        return 1;
+    }
+
+    if (LOG_LOCK()) {
+        return 1;
+    }
+    const avs_log_level_t *level_ptr = level_for(module, 0);
+    int result = (level >= level_value(level_ptr));
+#    ifdef AVS_COMMONS_LOG_WITH_RATE_LIMIT
+    uint32_t suppressed = 0;
+    const rate_limit_t *limit = rate_limit_for(level_ptr, level);
+    if (result && limit->burst) {
+        result = rate_limit_allows_unlocked(limit, level, file, line,
+                                            avs_time_monotonic_now(),
+                                            &suppressed);
+    }
+#    else  // AVS_COMMONS_LOG_WITH_RATE_LIMIT
+    (void) file;
+    (void) line;
+#    endif // AVS_COMMONS_LOG_WITH_RATE_LIMIT
+    LOG_UNLOCK();
+#    ifdef AVS_COMMONS_LOG_WITH_RATE_LIMIT
+    if (suppressed) {
+        avs_log_internal_forced_l__(level, module, file, line,
+                                    "last message repeated %" PRIu32 " times",
+                                    suppressed);
+    }
+#    endif // AVS_COMMONS_LOG_WITH_RATE_LIMIT
+    return result;
+}
+
 static const char *level_as_string(avs_log_level_t level) {
     switch (level) {
     case AVS_LOG_TRACE:
@@ -215,14 +477,36 @@ static const char *level_as_string(avs_log_level_t level) {
     }
 }
 
-static void log_with_buffer_unlocked_v(char *log_buf,
-                                       size_t log_buf_size,
-                                       avs_log_level_t level,
-                                       const char *module,
-                                       const char *file,
-                                       unsigned line,
-                                       const char *msg,
-                                       va_list ap) {
+static int format_message_v(char *log_buf_ptr,
+                            size_t log_buf_left,
+                            const char *msg,
+                            va_list ap) {
+    if (log_buf_left) {
+        int pfresult = vsnprintf(log_buf_ptr, log_buf_left, msg, ap);
+        if (pfresult < 0) {
+            // erroneous user-provided format string?
+            return -1;
+        }
+        if ((size_t) pfresult > log_buf_left) {
+            pfresult = (int) log_buf_left - 1;
+            log_buf_ptr = log_buf_ptr + pfresult - 3;
+            for (int i = 0; i < 3; i++) {
+                *log_buf_ptr = '.';
+                ++log_buf_ptr;
+            }
+        }
+    }
+    return 0;
+}
+
+static int format_with_buffer_v(char *log_buf,
+                                size_t log_buf_size,
+                                avs_log_level_t level,
+                                const char *module,
+                                const char *file,
+                                unsigned line,
+                                const char *msg,
+                                va_list ap) {
     char *log_buf_ptr = log_buf;
     size_t log_buf_left = log_buf_size;
     int pfresult = snprintf(log_buf_ptr, log_buf_left,
@@ -231,31 +515,362 @@ static void log_with_buffer_unlocked_v(char *log_buf,
     if (pfresult < 0) {
         // it's hard to imagine why snprintf() above might fail,
         // but well, let's be compliant and check it
-        return;
+        return -1;
     }
     if ((size_t) pfresult > log_buf_left) {
         pfresult = (int) log_buf_left;
     }
     log_buf_ptr += pfresult;
     log_buf_left -= (size_t) pfresult;
-    if (log_buf_left) {
-        pfresult = vsnprintf(log_buf_ptr, log_buf_left, msg, ap);
-        if (pfresult < 0) {
-            // erroneous user-provided format string?
-            return;
+    return format_message_v(log_buf_ptr, log_buf_left, msg, ap);
+}
+
+#    ifdef AVS_COMMONS_LOG_WITH_STRUCTURED
+typedef struct {
+    char *buf;
+    size_t size;
+    /* length of the whole output, even if it does not fit in buf */
+    size_t length;
+} log_writer_t;
+
+static void writer_putc(log_writer_t *writer, char c) {
+    if (writer->length + 1 < writer->size) {
+        writer->buf[writer->length] = c;
+    }
+    ++writer->length;
+}
+
+static void writer_puts(log_writer_t *writer, const char *str) {
+    for (; *str; ++str) {
+        writer_putc(writer, *str);
+    }
+}
+
+static void writer_put_escaped(log_writer_t *writer, char c) {
+    static const char HEX_DIGITS[] = "0123456789abcdef";
+    switch (c) {
+    case '"':
+    case '\\':
+        writer_putc(writer, '\\');
+        writer_putc(writer, c);
+        break;
+    case '\n':
+        writer_puts(writer, "\\n");
+        break;
+    case '\r':
+        writer_puts(writer, "\\r");
+        break;
+    case '\t':
+        writer_puts(writer, "\\t");
+        break;
+    default:
+        if ((unsigned char) c < 0x20) {
+            writer_puts(writer, "\\u00");
+            writer_putc(writer, HEX_DIGITS[(unsigned char) c >> 4]);
+            writer_putc(writer, HEX_DIGITS[(unsigned char) c & 0xF]);
+        } else {
+            writer_putc(writer, c);
         }
-        if ((size_t) pfresult > log_buf_left) {
-            pfresult = (int) log_buf_left - 1;
-            log_buf_ptr = log_buf_ptr + pfresult - 3;
-            for (int i = 0; i < 3; i++) {
-                *log_buf_ptr = '.';
-                ++log_buf_ptr;
-            }
+    }
+}
+
+static void writer_put_quoted(log_writer_t *writer, const char *str) {
+    writer_putc(writer, '"');
+    for (; *str; ++str) {
+        writer_put_escaped(writer, *str);
+    }
+    writer_putc(writer, '"');
+}
+
+static bool logfmt_needs_quoting(const char *str) {
+    if (!*str) {
+        return true;
+    }
+    for (; *str; ++str) {
+        if ((unsigned char) *str <= ' ' || *str == '=' || *str == '"'
+                || *str == '\\' || *str == '\x7F') {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void writer_put_logfmt_str(log_writer_t *writer, const char *str) {
+    if (logfmt_needs_quoting(str)) {
+        writer_put_quoted(writer, str);
+    } else {
+        writer_puts(writer, str);
+    }
+}
+
+static void
+writer_put_value(log_writer_t *writer, const avs_log_field_t *field, bool json) {
+    switch (field->type) {
+    case AVS_LOG_FIELD_TYPE_STR:
+        if (!field->value.str) {
+            writer_puts(writer, "null");
+        } else if (json) {
+            writer_put_quoted(writer, field->value.str);
+        } else {
+            writer_put_logfmt_str(writer, field->value.str);
+        }
+        break;
+    case AVS_LOG_FIELD_TYPE_I64:
+        writer_puts(writer, AVS_INT64_AS_STRING(field->value.i64));
+        break;
+    case AVS_LOG_FIELD_TYPE_U64:
+        writer_puts(writer, AVS_UINT64_AS_STRING(field->value.u64));
+        break;
+    case AVS_LOG_FIELD_TYPE_DOUBLE:
+        if (json && !isfinite(field->value.dbl)) {
+            writer_puts(writer, "null");
+        } else {
+            writer_puts(writer, AVS_DOUBLE_AS_STRING(field->value.dbl, 15));
+        }
+        break;
+    case AVS_LOG_FIELD_TYPE_BOOL:
+        writer_puts(writer, field->value.boolean ? "true" : "false");
+        break;
+    default:
+        writer_puts(writer, "null");
+    }
+}
+
+static void writer_put_logfmt_fields(log_writer_t *writer,
+                                     const avs_log_field_t *fields,
+                                     size_t field_count) {
+    for (size_t i = 0; i < field_count; ++i) {
+        writer_putc(writer, ' ');
+        writer_puts(writer, fields[i].key);
+        writer_putc(writer, '=');
+        writer_put_value(writer, &fields[i], false);
+    }
+}
+
+static void writer_put_json_fields(log_writer_t *writer,
+                                   const avs_log_field_t *fields,
+                                   size_t field_count) {
+    for (size_t i = 0; i < field_count; ++i) {
+        writer_puts(writer, ",\"");
+        writer_puts(writer, fields[i].key);
+        writer_puts(writer, "\":");
+        writer_put_value(writer, &fields[i], true);
+    }
+}
+
+static int writer_finish(log_writer_t *writer) {
+    if (!writer->size) {
+        return -1;
+    }
+    if (writer->length >= writer->size) {
+        writer->buf[writer->size - 1] = '\0';
+        return -1;
+    }
+    writer->buf[writer->length] = '\0';
+    return (int) writer->length;
+}
+
+int avs_log_record_to_logfmt(char *out_buf,
+                             size_t buf_size,
+                             const avs_log_record_t *record) {
+    log_writer_t writer = { out_buf, buf_size, 0 };
+    writer_puts(&writer, "level=");
+    writer_puts(&writer, level_as_string(record->level));
+    writer_puts(&writer, " module=");
+    writer_put_logfmt_str(&writer, record->module);
+    writer_puts(&writer, " file=");
+    writer_put_logfmt_str(&writer, record->file);
+    writer_puts(&writer, " line=");
+    writer_puts(&writer, AVS_UINT64_AS_STRING(record->line));
+    writer_puts(&writer, " msg=");
+    writer_put_logfmt_str(&writer, record->message);
+    writer_put_logfmt_fields(&writer, record->fields, record->field_count);
+    writer_put_logfmt_fields(&writer, record->context_fields,
+                             record->context_field_count);
+    return writer_finish(&writer);
+}
+
+int avs_log_record_to_json(char *out_buf,
+                           size_t buf_size,
+                           const avs_log_record_t *record) {
+    log_writer_t writer = { out_buf, buf_size, 0 };
+    writer_puts(&writer, "{\"level\":\"");
+    writer_puts(&writer, level_as_string(record->level));
+    writer_puts(&writer, "\",\"module\":");
+    writer_put_quoted(&writer, record->module);
+    writer_puts(&writer, ",\"file\":");
+    writer_put_quoted(&writer, record->file);
+    writer_puts(&writer, ",\"line\":");
+    writer_puts(&writer, AVS_UINT64_AS_STRING(record->line));
+    writer_puts(&writer, ",\"msg\":");
+    writer_put_quoted(&writer, record->message);
+    writer_put_json_fields(&writer, record->fields, record->field_count);
+    writer_put_json_fields(&writer, record->context_fields,
+                           record->context_field_count);
+    writer_putc(&writer, '}');
+    return writer_finish(&writer);
+}
+
+/**
+ * Appends fields in the logfmt format to a message that has already been
+ * formatted in @p log_buf, marking the message as truncated if necessary.
+ */
+static void append_fields(char *log_buf,
+                          size_t log_buf_size,
+                          const avs_log_field_t *fields,
+                          size_t field_count) {
+    log_writer_t writer = { log_buf, log_buf_size, strlen(log_buf) };
+    writer_put_logfmt_fields(&writer, fields, field_count);
+    writer_put_logfmt_fields(&writer, t_context_fields, t_context_field_count);
+    if (writer_finish(&writer) < 0 && log_buf_size > 3) {
+        memcpy(&log_buf[log_buf_size - 4], "...", 4);
+    }
+}
+
+static void handle_record(avs_log_record_handler_t *record_handler,
+                          avs_log_level_t level,
+                          const char *module,
+                          const char *file,
+                          unsigned line,
+                          const char *message,
+                          const avs_log_field_t *fields,
+                          size_t field_count) {
+    const avs_log_record_t record = {
+        .level = level,
+        .module = module,
+        .file = file,
+        .line = line,
+        .message = message,
+        .fields = fields,
+        .field_count = field_count,
+        .context_fields = t_context_fields,
+        .context_field_count = t_context_field_count
+    };
+    record_handler(&record);
+}
+
+void avs_log_set_record_handler(avs_log_record_handler_t *record_handler) {
+    if (LOG_LOCK()) {
+        return;
+    }
+    g_log.record_handler = record_handler;
+    LOG_UNLOCK();
+}
+
+int avs_log_context_push(avs_log_field_t field) {
+    if (!field.key
+            || t_context_field_count >= AVS_ARRAY_SIZE(t_context_fields)) {
+        return -1;
+    }
+    t_context_fields[t_context_field_count++] = field;
+    return 0;
+}
+
+void avs_log_context_pop(void) {
+    if (t_context_field_count) {
+        --t_context_field_count;
+    }
+}
+#    endif // AVS_COMMONS_LOG_WITH_STRUCTURED
+
+static void log_with_buffer_unlocked_v(char *log_buf,
+                                       size_t log_buf_size,
+                                       avs_log_level_t level,
+                                       const char *module,
+                                       const char *file,
+                                       unsigned line,
+                                       const char *msg,
+                                       va_list ap) {
+#    ifdef AVS_COMMONS_LOG_WITH_STRUCTURED
+    avs_log_record_handler_t *record_handler = g_log.record_handler;
+    if (record_handler) {
+        if (log_buf_size) {
+            log_buf[0] = '\0';
         }
+        if (!format_message_v(log_buf, log_buf_size, msg, ap)) {
+            handle_record(record_handler, level, module, file, line, log_buf,
+                          NULL, 0);
+        }
+        return;
+    }
+#    endif // AVS_COMMONS_LOG_WITH_STRUCTURED
+    if (format_with_buffer_v(log_buf, log_buf_size, level, module, file, line,
+                             msg, ap)) {
+        return;
+    }
+#    ifdef AVS_COMMONS_LOG_WITH_STRUCTURED
+    if (t_context_field_count) {
+        append_fields(log_buf, log_buf_size, NULL, 0);
+    }
+#    endif // AVS_COMMONS_LOG_WITH_STRUCTURED
+    g_log.handler(level, module, log_buf);
+}
+
+#    ifdef AVS_COMMONS_LOG_WITH_STRUCTURED
+static int format_with_buffer(char *log_buf,
+                              size_t log_buf_size,
+                              avs_log_level_t level,
+                              const char *module,
+                              const char *file,
+                              unsigned line,
+                              const char *msg,
+                              ...) {
+    va_list ap;
+    va_start(ap, msg);
+    int result = format_with_buffer_v(log_buf, log_buf_size, level, module,
+                                      file, line, msg, ap);
+    va_end(ap);
+    return result;
+}
+
+static void log_kv_with_buffer_unlocked(char *log_buf,
+                                        size_t log_buf_size,
+                                        avs_log_level_t level,
+                                        const char *module,
+                                        const char *file,
+                                        unsigned line,
+                                        const char *msg,
+                                        const avs_log_field_t *fields,
+                                        size_t field_count) {
+    if (format_with_buffer(log_buf, log_buf_size, level, module, file, line,
+                           "%s", msg)) {
+        return;
     }
+    append_fields(log_buf, log_buf_size, fields, field_count);
     g_log.handler(level, module, log_buf);
 }
 
+void avs_log_internal_kv__(avs_log_level_t level,
+                           const char *module,
+                           const char *file,
+                           unsigned line,
+                           const char *msg,
+                           const avs_log_field_t *fields) {
+    size_t field_count = 0;
+    while (fields[field_count].key) {
+        ++field_count;
+    }
+    avs_log_record_handler_t *record_handler = g_log.record_handler;
+    if (record_handler) {
+        handle_record(record_handler, level, module, file, line, msg, fields,
+                      field_count);
+        return;
+    }
+#        ifdef AVS_COMMONS_LOG_USE_GLOBAL_BUFFER
+    if (LOG_LOCK()) {
+        return;
+    }
+    log_kv_with_buffer_unlocked(g_log.buffer, sizeof(g_log.buffer), level,
+                                module, file, line, msg, fields, field_count);
+    LOG_UNLOCK();
+#        else  // AVS_COMMONS_LOG_USE_GLOBAL_BUFFER
+    char log_buf[AVS_COMMONS_LOG_MAX_LINE_LENGTH];
+    log_kv_with_buffer_unlocked(log_buf, sizeof(log_buf), level, module, file,
+                                line, msg, fields, field_count);
+#        endif // AVS_COMMONS_LOG_USE_GLOBAL_BUFFER
+}
+#    endif // AVS_COMMONS_LOG_WITH_STRUCTURED
+
 void avs_log_internal_forced_v__(avs_log_level_t level,
                                  const char *module,
                                  const char *file,
@@ -282,7 +897,7 @@ void avs_log_internal_v__(avs_log_level_t level,
                           unsigned line,
                           const char *msg,
                           va_list ap) {
-    if (avs_log_should_log__(level, module)) {
+    if (avs_log_should_log_at__(level, module, file, line)) {
         avs_log_internal_forced_v__(level, module, file, line, msg, ap);
     }
 }
@@ -305,7 +920,7 @@ void avs_log_internal_l__(avs_log_level_t level,
                           unsigned line,
                           const char *msg,
                           ...) {
-    if (avs_log_should_log__(level, module)) {
+    if (avs_log_should_log_at__(level, module, file, line)) {
         va_list ap;
         va_start(ap, msg);
         avs_log_internal_forced_v__(level, module, file, line, msg, ap);
@@ -28,6 +28,7 @@
 #    include <avsystem/commons/avs_net.h>
 #    include <avsystem/commons/avs_socket.h>
 #    include <avsystem/commons/avs_socket_v_table.h>
+#    include <avsystem/commons/avs_trace.h>
 
 #    include "avs_net_global.h"
 
@@ -120,7 +121,10 @@ avs_error_t avs_net_socket_connect(avs_net_socket_t *socket,
     if (!socket->operations->connect) {
         return avs_errno(AVS_ENOTSUP);
     }
-    return socket->operations->connect(socket, host, port);
+    AVS_TRACE_BEGIN("net", "connect");
+    avs_error_t err = socket->operations->connect(socket, host, port);
+    AVS_TRACE_END("net", "connect");
+    return err;
 }
 
 avs_error_t avs_net_socket_decorate(avs_net_socket_t *socket,
@@ -137,7 +141,10 @@ avs_error_t avs_net_socket_send(avs_net_socket_t *socket,
     if (!socket->operations->send) {
         return avs_errno(AVS_ENOTSUP);
     }
-    return socket->operations->send(socket, buffer, buffer_length);
+    AVS_TRACE_BEGIN("net", "send");
+    avs_error_t err = socket->operations->send(socket, buffer, buffer_length);
+    AVS_TRACE_END("net", "send");
+    return err;
 }
 
 avs_error_t avs_net_socket_send_to(avs_net_socket_t *socket,
@@ -148,8 +155,11 @@ avs_error_t avs_net_socket_send_to(avs_net_socket_t *socket,
     if (!socket->operations->send_to) {
         return avs_errno(AVS_ENOTSUP);
     }
-    return socket->operations->send_to(socket, buffer, buffer_length, host,
-                                       port);
+    AVS_TRACE_BEGIN("net", "send_to");
+    avs_error_t err = socket->operations->send_to(socket, buffer,
+                                                  buffer_length, host, port);
+    AVS_TRACE_END("net", "send_to");
+    return err;
 }
 
 avs_error_t avs_net_socket_receive(avs_net_socket_t *socket,
@@ -159,8 +169,11 @@ avs_error_t avs_net_socket_receive(avs_net_socket_t *socket,
     if (!socket->operations->receive) {
         return avs_errno(AVS_ENOTSUP);
     }
-    return socket->operations->receive(socket, out_bytes_received, buffer,
-                                       buffer_length);
+    AVS_TRACE_BEGIN("net", "receive");
+    avs_error_t err = socket->operations->receive(socket, out_bytes_received,
+                                                  buffer, buffer_length);
+    AVS_TRACE_END("net", "receive");
+    return err;
 }
 
 avs_error_t avs_net_socket_receive_from(avs_net_socket_t *socket,
@@ -174,9 +187,12 @@ avs_error_t avs_net_socket_receive_from(avs_net_socket_t *socket,
     if (!socket->operations->receive_from) {
         return avs_errno(AVS_ENOTSUP);
     }
-    return socket->operations->receive_from(socket, out_bytes_received, buffer,
-                                            buffer_length, host, host_size,
-                                            port, port_size);
+    AVS_TRACE_BEGIN("net", "receive_from");
+    avs_error_t err = socket->operations->receive_from(
+            socket, out_bytes_received, buffer, buffer_length, host, host_size,
+            port, port_size);
+    AVS_TRACE_END("net", "receive_from");
+    return err;
 }
 
 avs_error_t avs_net_socket_bind(avs_net_socket_t *socket,
@@ -193,7 +209,11 @@ avs_error_t avs_net_socket_accept(avs_net_socket_t *server_socket,
     if (!server_socket->operations->accept) {
         return avs_errno(AVS_ENOTSUP);
     }
-    return server_socket->operations->accept(server_socket, client_socket);
+    AVS_TRACE_BEGIN("net", "accept");
+    avs_error_t err =
+            server_socket->operations->accept(server_socket, client_socket);
+    AVS_TRACE_END("net", "accept");
+    return err;
 }
 
 avs_error_t avs_net_socket_close(avs_net_socket_t *socket) {
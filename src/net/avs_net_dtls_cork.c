@@ -0,0 +1,104 @@
+/*
+ * Copyright 2021 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <avs_commons_init.h>
+
+#ifdef AVS_COMMONS_WITH_AVS_NET
+
+#    include <string.h>
+
+#    include <avsystem/commons/avs_memory.h>
+
+#    include "avs_net_dtls_cork.h"
+#    include "avs_net_impl.h"
+
+VISIBILITY_SOURCE_BEGIN
+
+static size_t get_datagram_limit(avs_net_socket_t *backend) {
+    avs_net_socket_opt_value_t value;
+    if (avs_is_err(avs_net_socket_get_opt(backend, AVS_NET_SOCKET_OPT_INNER_MTU,
+                                          &value))
+            || value.mtu <= 0) {
+        return 0;
+    }
+    return (size_t) value.mtu;
+}
+
+static avs_error_t ensure_buffer_size(_avs_net_dtls_cork_t *cork,
+                                      size_t size) {
+    if (cork->buffer_size >= size) {
+        return AVS_OK;
+    }
+    char *buffer = (char *) avs_realloc(cork->buffer, size);
+    if (!buffer) {
+        LOG(ERROR, _("Out of memory"));
+        return avs_errno(AVS_ENOMEM);
+    }
+    cork->buffer = buffer;
+    cork->buffer_size = size;
+    return AVS_OK;
+}
+
+avs_error_t _avs_net_dtls_cork_flush(_avs_net_dtls_cork_t *cork,
+                                     avs_net_socket_t *backend) {
+    if (!cork->size) {
+        return AVS_OK;
+    }
+    size_t size = cork->size;
+    cork->size = 0;
+    if (!backend) {
+        return avs_errno(AVS_EBADF);
+    }
+    return avs_net_socket_send(backend, cork->buffer, size);
+}
+
+avs_error_t _avs_net_dtls_cork_write(_avs_net_dtls_cork_t *cork,
+                                     avs_net_socket_t *backend,
+                                     const void *data,
+                                     size_t size) {
+    avs_error_t err;
+    if (cork->size && (!cork->batching || cork->size + size > cork->limit)
+            && avs_is_err((err = _avs_net_dtls_cork_flush(cork, backend)))) {
+        return err;
+    }
+    if (cork->batching && !cork->size) {
+        cork->limit = get_datagram_limit(backend);
+    }
+    /* records that fill a whole datagram are not worth copying */
+    if (!cork->batching || size >= cork->limit) {
+        return avs_net_socket_send(backend, data, size);
+    }
+    if (avs_is_err((err = ensure_buffer_size(cork, cork->limit)))) {
+        return err;
+    }
+    memcpy(cork->buffer + cork->size, data, size);
+    cork->size += size;
+    return AVS_OK;
+}
+
+void _avs_net_dtls_cork_release(_avs_net_dtls_cork_t *cork) {
+    avs_free(cork->buffer);
+    cork->buffer = NULL;
+    cork->buffer_size = 0;
+    cork->limit = 0;
+    cork->size = 0;
+}
+
+#    ifdef AVS_UNIT_TESTING
+#        include "tests/net/dtls_cork.c"
+#    endif // AVS_UNIT_TESTING
+
+#endif // AVS_COMMONS_WITH_AVS_NET
@@ -0,0 +1,79 @@
+/*
+ * Copyright 2021 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NET_DTLS_CORK_H
+#define NET_DTLS_CORK_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <avsystem/commons/avs_socket.h>
+
+VISIBILITY_PRIVATE_HEADER_BEGIN
+
+/**
+ * Batching of DTLS records into datagrams, as controlled by
+ * @ref AVS_NET_SOCKET_OPT_CORK. Every datagram written by the (D)TLS library
+ * to the backend socket passes through @ref _avs_net_dtls_cork_write - records
+ * of application data are collected in a buffer, all other data is sent
+ * immediately, after any pending records.
+ *
+ * A zero-initialized structure is valid and has batching disabled.
+ */
+typedef struct {
+    /** Value of @ref AVS_NET_SOCKET_OPT_CORK. */
+    bool enabled;
+    /** Whether the data currently written is application data. */
+    bool batching;
+    /** Records waiting to be sent; allocated on first use. */
+    char *buffer;
+    /** Allocated size of @ref buffer. */
+    size_t buffer_size;
+    /** Maximum size of the datagram currently being collected. */
+    size_t limit;
+    /** Number of bytes of records in @ref buffer. */
+    size_t size;
+} _avs_net_dtls_cork_t;
+
+/**
+ * Writes @p data, which is one or more complete records, to @p backend. If
+ * batching, the data is appended to the pending datagram instead, which is
+ * sent first if the data would not fit in it. The datagram size is limited by
+ * @ref AVS_NET_SOCKET_OPT_INNER_MTU of @p backend, as queried at the start of
+ * each datagram.
+ *
+ * @returns Result of the actual send operation, if any was performed.
+ */
+avs_error_t _avs_net_dtls_cork_write(_avs_net_dtls_cork_t *cork,
+                                     avs_net_socket_t *backend,
+                                     const void *data,
+                                     size_t size);
+
+/**
+ * Sends the pending datagram, if any. It is discarded even if sending fails.
+ */
+avs_error_t _avs_net_dtls_cork_flush(_avs_net_dtls_cork_t *cork,
+                                     avs_net_socket_t *backend);
+
+/**
+ * Discards the pending datagram and frees the buffer. The value of
+ * @ref _avs_net_dtls_cork_t#enabled is retained.
+ */
+void _avs_net_dtls_cork_release(_avs_net_dtls_cork_t *cork);
+
+VISIBILITY_PRIVATE_HEADER_END
+
+#endif // NET_DTLS_CORK_H
@@ -0,0 +1,275 @@
+/*
+ * Copyright 2021 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <avs_commons_init.h>
+
+#if defined(AVS_COMMONS_WITH_AVS_NET) \
+        && defined(AVS_COMMONS_NET_WITH_HEALTH_MONITOR)
+
+#    include <assert.h>
+#    include <inttypes.h>
+
+#    include <avsystem/commons/avs_memory.h>
+#    include <avsystem/commons/avs_net_health_monitor.h>
+
+#    define MODULE_NAME avs_net
+#    include <avs_x_log_config.h>
+
+VISIBILITY_SOURCE_BEGIN
+
+#    define DEFAULT_IDLE_INTERVAL_S 30
+#    define DEFAULT_RESPONSE_TIMEOUT_S 5
+#    define DEFAULT_MAX_MISSED_HEARTBEATS 3
+
+struct avs_net_health_monitor_struct {
+    avs_sched_t *sched;
+    avs_net_socket_t *socket;
+    avs_net_health_monitor_config_t config;
+    avs_sched_handle_t job;
+    avs_time_monotonic_t last_activity;
+    /* invalid if there is no outstanding heartbeat */
+    avs_time_monotonic_t heartbeat_sent;
+    uint64_t bytes_received;
+    unsigned missed_heartbeats;
+    avs_net_health_monitor_stats_t stats;
+};
+
+static void health_job(avs_sched_t *sched, const void *monitor_ptr);
+
+static void schedule_check(avs_net_health_monitor_t *monitor,
+                           avs_time_monotonic_t instant) {
+    if (AVS_SCHED_AT(monitor->sched, &monitor->job, instant, health_job,
+                     &monitor, sizeof(monitor))) {
+        LOG(ERROR, _("could not schedule connection health check"));
+    }
+}
+
+static void report_event(avs_net_health_monitor_t *monitor,
+                         avs_net_health_event_t event) {
+    if (monitor->config.on_event) {
+        monitor->config.on_event(monitor, event, monitor->config.user_data);
+    }
+}
+
+static void handle_activity(avs_net_health_monitor_t *monitor,
+                            avs_time_monotonic_t now) {
+    monitor->last_activity = now;
+    monitor->missed_heartbeats = 0;
+    if (!monitor->stats.peer_dead) {
+        return;
+    }
+    LOG(INFO, _("peer is alive again"));
+    monitor->stats.peer_dead = false;
+    monitor->heartbeat_sent = AVS_TIME_MONOTONIC_INVALID;
+    schedule_check(monitor, avs_time_monotonic_add(
+                                    now, monitor->config.idle_interval));
+    /* the handler may free the monitor, so it needs to be called last */
+    report_event(monitor, AVS_NET_HEALTH_PEER_ALIVE);
+}
+
+/* data received on the socket counts as activity */
+static void poll_bytes_received(avs_net_health_monitor_t *monitor,
+                                avs_time_monotonic_t now) {
+    avs_net_socket_opt_value_t value;
+    if (avs_is_err(avs_net_socket_get_opt(monitor->socket,
+                                          AVS_NET_SOCKET_OPT_BYTES_RECEIVED,
+                                          &value))
+            || value.bytes_received == monitor->bytes_received) {
+        return;
+    }
+    monitor->bytes_received = value.bytes_received;
+    handle_activity(monitor, now);
+}
+
+static void send_heartbeat(avs_net_health_monitor_t *monitor,
+                           avs_time_monotonic_t now) {
+    avs_error_t err = monitor->config.send_heartbeat(monitor->socket,
+                                                     monitor->config.user_data);
+    if (avs_is_err(err)) {
+        LOG(WARNING,
+            _("could not send heartbeat (category == ") "%" PRIu16 _(
+                    ", code == ") "%" PRIu16 _(")"),
+            err.category, err.code);
+    }
+    monitor->heartbeat_sent = now;
+    ++monitor->stats.heartbeats_sent;
+    schedule_check(monitor, avs_time_monotonic_add(
+                                    now, monitor->config.response_timeout));
+}
+
+static void health_job(avs_sched_t *sched, const void *monitor_ptr) {
+    (void) sched;
+    avs_net_health_monitor_t *monitor =
+            *(avs_net_health_monitor_t *const *) monitor_ptr;
+    if (monitor->stats.peer_dead) {
+        return;
+    }
+    const avs_time_monotonic_t now = avs_time_monotonic_now();
+    poll_bytes_received(monitor, now);
+
+    if (avs_time_monotonic_valid(monitor->heartbeat_sent)) {
+        if (!avs_time_monotonic_before(monitor->last_activity,
+                                       monitor->heartbeat_sent)) {
+            /* answered, although not reported explicitly */
+            monitor->heartbeat_sent = AVS_TIME_MONOTONIC_INVALID;
+        } else {
+            const avs_time_monotonic_t deadline = avs_time_monotonic_add(
+                    monitor->heartbeat_sent, monitor->config.response_timeout);
+            if (avs_time_monotonic_before(now, deadline)) {
+                schedule_check(monitor, deadline);
+                return;
+            }
+            monitor->heartbeat_sent = AVS_TIME_MONOTONIC_INVALID;
+            ++monitor->stats.heartbeats_missed;
+            if (++monitor->missed_heartbeats
+                    >= monitor->config.max_missed_heartbeats) {
+                LOG(WARNING, "%u" _(" heartbeats not answered, peer is dead"),
+                    monitor->missed_heartbeats);
+                monitor->stats.peer_dead = true;
+                report_event(monitor, AVS_NET_HEALTH_PEER_DEAD);
+                return;
+            }
+            send_heartbeat(monitor, now);
+            return;
+        }
+    }
+
+    const avs_time_monotonic_t idle_deadline = avs_time_monotonic_add(
+            monitor->last_activity, monitor->config.idle_interval);
+    if (avs_time_monotonic_before(now, idle_deadline)) {
+        schedule_check(monitor, idle_deadline);
+    } else {
+        send_heartbeat(monitor, now);
+    }
+}
+
+avs_error_t
+avs_net_health_monitor_create(avs_net_health_monitor_t **out_monitor,
+                              avs_sched_t *sched,
+                              avs_net_socket_t *socket,
+                              const avs_net_health_monitor_config_t *config) {
+    assert(out_monitor && !*out_monitor);
+    if (!sched || !socket || !config || !config->send_heartbeat) {
+        LOG(ERROR, _("invalid health monitor configuration"));
+        return avs_errno(AVS_EINVAL);
+    }
+    avs_net_health_monitor_t *monitor =
+            (avs_net_health_monitor_t *) avs_calloc(1, sizeof(*monitor));
+    if (!monitor) {
+        LOG(ERROR, _("out of memory"));
+        return avs_errno(AVS_ENOMEM);
+    }
+    monitor->sched = sched;
+    monitor->socket = socket;
+    monitor->config = *config;
+    if (!avs_time_duration_less(AVS_TIME_DURATION_ZERO,
+                                monitor->config.idle_interval)) {
+        monitor->config.idle_interval =
+                avs_time_duration_from_scalar(DEFAULT_IDLE_INTERVAL_S,
+                                              AVS_TIME_S);
+    }
+    if (!avs_time_duration_less(AVS_TIME_DURATION_ZERO,
+                                monitor->config.response_timeout)) {
+        monitor->config.response_timeout =
+                avs_time_duration_from_scalar(DEFAULT_RESPONSE_TIMEOUT_S,
+                                              AVS_TIME_S);
+    }
+    if (!monitor->config.max_missed_heartbeats) {
+        monitor->config.max_missed_heartbeats = DEFAULT_MAX_MISSED_HEARTBEATS;
+    }
+    monitor->last_activity = avs_time_monotonic_now();
+    monitor->heartbeat_sent = AVS_TIME_MONOTONIC_INVALID;
+    monitor->stats.last_rtt = AVS_TIME_DURATION_INVALID;
+    monitor->stats.smoothed_rtt = AVS_TIME_DURATION_INVALID;
+    monitor->stats.rtt_variation = AVS_TIME_DURATION_INVALID;
+
+    avs_net_socket_opt_value_t value;
+    if (avs_is_ok(avs_net_socket_get_opt(
+                socket, AVS_NET_SOCKET_OPT_BYTES_RECEIVED, &value))) {
+        monitor->bytes_received = value.bytes_received;
+    }
+    if (AVS_SCHED_AT(sched, &monitor->job,
+                     avs_time_monotonic_add(monitor->last_activity,
+                                            monitor->config.idle_interval),
+                     health_job, &monitor, sizeof(monitor))) {
+        LOG(ERROR, _("could not schedule connection health check"));
+        avs_free(monitor);
+        return avs_errno(AVS_ENOMEM);
+    }
+    *out_monitor = monitor;
+    return AVS_OK;
+}
+
+void avs_net_health_monitor_cleanup(avs_net_health_monitor_t **monitor_ptr) {
+    if (monitor_ptr && *monitor_ptr) {
+        avs_sched_del(&(*monitor_ptr)->job);
+        avs_free(*monitor_ptr);
+        *monitor_ptr = NULL;
+    }
+}
+
+void avs_net_health_monitor_activity(avs_net_health_monitor_t *monitor) {
+    handle_activity(monitor, avs_time_monotonic_now());
+}
+
+static avs_time_duration_t duration_abs(avs_time_duration_t duration) {
+    if (avs_time_duration_less(duration, AVS_TIME_DURATION_ZERO)) {
+        return avs_time_duration_diff(AVS_TIME_DURATION_ZERO, duration);
+    }
+    return duration;
+}
+
+/* RFC 6298, section 2 */
+static void update_rtt(avs_net_health_monitor_stats_t *stats,
+                       avs_time_duration_t rtt) {
+    stats->last_rtt = rtt;
+    if (!avs_time_duration_valid(stats->smoothed_rtt)) {
+        stats->smoothed_rtt = rtt;
+        stats->rtt_variation = avs_time_duration_div(rtt, 2);
+        return;
+    }
+    /* RTTVAR <- (1 - beta) * RTTVAR + beta * |SRTT - R'|, beta = 1/4 */
+    stats->rtt_variation = avs_time_duration_div(
+            avs_time_duration_add(
+                    avs_time_duration_mul(stats->rtt_variation, 3),
+                    duration_abs(avs_time_duration_diff(stats->smoothed_rtt,
+                                                        rtt))),
+            4);
+    /* SRTT <- (1 - alpha) * SRTT + alpha * R', alpha = 1/8 */
+    stats->smoothed_rtt = avs_time_duration_div(
+            avs_time_duration_add(avs_time_duration_mul(stats->smoothed_rtt, 7),
+                                  rtt),
+            8);
+}
+
+void avs_net_health_monitor_heartbeat_acked(avs_net_health_monitor_t *monitor) {
+    const avs_time_monotonic_t now = avs_time_monotonic_now();
+    if (avs_time_monotonic_valid(monitor->heartbeat_sent)) {
+        update_rtt(&monitor->stats,
+                   avs_time_monotonic_diff(now, monitor->heartbeat_sent));
+        monitor->heartbeat_sent = AVS_TIME_MONOTONIC_INVALID;
+    }
+    handle_activity(monitor, now);
+}
+
+void avs_net_health_monitor_get_stats(
+        const avs_net_health_monitor_t *monitor,
+        avs_net_health_monitor_stats_t *out_stats) {
+    *out_stats = monitor->stats;
+}
+
+#endif // defined(AVS_COMMONS_WITH_AVS_NET) &&
+       // defined(AVS_COMMONS_NET_WITH_HEALTH_MONITOR)
@@ -0,0 +1,274 @@
+/*
+ * Copyright 2021 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <avs_commons_init.h>
+
+#if defined(AVS_COMMONS_WITH_AVS_NET) \
+        && defined(AVS_COMMONS_NET_WITH_PATH_MTU_DISCOVERY)
+
+#    include <assert.h>
+#    include <string.h>
+
+#    include <avsystem/commons/avs_memory.h>
+#    include <avsystem/commons/avs_mutex.h>
+#    include <avsystem/commons/avs_utils.h>
+
+#    include "avs_net_impl.h"
+#    include "avs_net_pmtud.h"
+
+VISIBILITY_SOURCE_BEGIN
+
+/* MAX_PROBES, as recommended by RFC 8899, section 5.1.2 */
+#    define PMTUD_MAX_PROBES 3
+
+/* the search finishes when the PLPMTU is known with at least this precision */
+#    define PMTUD_SEARCH_PRECISION 16
+
+/* PMTU_RAISE_TIMER, as recommended by RFC 8899, section 5.1.1 */
+static const avs_time_duration_t PMTUD_RAISE_TIMER = { 600, 0 };
+
+static void start_probe(_avs_net_pmtud_t *pmtud, int size) {
+    pmtud->probe_size = size;
+    pmtud->probe_count = 0;
+}
+
+static void complete_search(_avs_net_pmtud_t *pmtud,
+                            avs_time_monotonic_t validated_at) {
+    pmtud->state = _AVS_NET_PMTUD_SEARCH_COMPLETE;
+    start_probe(pmtud, 0);
+    pmtud->raise_deadline =
+            avs_time_monotonic_add(validated_at, PMTUD_RAISE_TIMER);
+}
+
+/**
+ * Selects the next size to probe in the Searching state. The maximum size is
+ * tried first, as it is the most likely one on typical networks - the range of
+ * unconfirmed sizes is bisected afterwards.
+ */
+static void continue_search(_avs_net_pmtud_t *pmtud, avs_time_monotonic_t now) {
+    if (pmtud->failed_size - pmtud->plpmtu <= PMTUD_SEARCH_PRECISION) {
+        complete_search(pmtud, now);
+    } else if (pmtud->failed_size > pmtud->max_plpmtu) {
+        start_probe(pmtud, pmtud->max_plpmtu);
+    } else {
+        start_probe(pmtud,
+                    pmtud->plpmtu + (pmtud->failed_size - pmtud->plpmtu) / 2);
+    }
+}
+
+void _avs_net_pmtud_init(_avs_net_pmtud_t *pmtud,
+                         int min_plpmtu,
+                         int base_plpmtu,
+                         int max_plpmtu) {
+    assert(min_plpmtu > 0);
+    memset(pmtud, 0, sizeof(*pmtud));
+    pmtud->state = _AVS_NET_PMTUD_BASE;
+    pmtud->min_plpmtu = min_plpmtu;
+    pmtud->base_plpmtu = AVS_MAX(min_plpmtu, AVS_MIN(base_plpmtu, max_plpmtu));
+    pmtud->max_plpmtu = AVS_MAX(pmtud->base_plpmtu, max_plpmtu);
+    pmtud->plpmtu = pmtud->base_plpmtu;
+    pmtud->failed_size = pmtud->max_plpmtu + 1;
+    pmtud->raise_deadline = AVS_TIME_MONOTONIC_INVALID;
+    start_probe(pmtud, pmtud->base_plpmtu);
+}
+
+void _avs_net_pmtud_restore(_avs_net_pmtud_t *pmtud,
+                            int plpmtu,
+                            avs_time_monotonic_t validated_at) {
+    if (plpmtu < pmtud->min_plpmtu || plpmtu > pmtud->max_plpmtu) {
+        return;
+    }
+    pmtud->plpmtu = plpmtu;
+    pmtud->failed_size = pmtud->max_plpmtu + 1;
+    complete_search(pmtud, validated_at);
+}
+
+int _avs_net_pmtud_probe_size(_avs_net_pmtud_t *pmtud,
+                              avs_time_monotonic_t now) {
+    if (pmtud->state == _AVS_NET_PMTUD_SEARCH_COMPLETE
+            && pmtud->plpmtu < pmtud->max_plpmtu
+            && !avs_time_monotonic_before(now, pmtud->raise_deadline)) {
+        /* the path might have changed, so all larger sizes are retried */
+        pmtud->state = _AVS_NET_PMTUD_SEARCHING;
+        pmtud->failed_size = pmtud->max_plpmtu + 1;
+        continue_search(pmtud, now);
+    }
+    return pmtud->probe_size;
+}
+
+void _avs_net_pmtud_probe_acked(_avs_net_pmtud_t *pmtud,
+                                avs_time_monotonic_t now) {
+    if (!pmtud->probe_size) {
+        return;
+    }
+    pmtud->plpmtu = AVS_MAX(pmtud->plpmtu, pmtud->probe_size);
+    pmtud->state = _AVS_NET_PMTUD_SEARCHING;
+    continue_search(pmtud, now);
+}
+
+void _avs_net_pmtud_probe_lost(_avs_net_pmtud_t *pmtud,
+                               avs_time_monotonic_t now) {
+    if (!pmtud->probe_size || ++pmtud->probe_count < PMTUD_MAX_PROBES) {
+        return;
+    }
+    switch (pmtud->state) {
+    case _AVS_NET_PMTUD_BASE:
+    case _AVS_NET_PMTUD_ERROR:
+        /* BASE_PLPMTU keeps being probed, but only MIN_PLPMTU is relied on
+         * until it is confirmed */
+        pmtud->state = _AVS_NET_PMTUD_ERROR;
+        pmtud->plpmtu = pmtud->min_plpmtu;
+        start_probe(pmtud, pmtud->base_plpmtu);
+        break;
+    case _AVS_NET_PMTUD_SEARCHING:
+        pmtud->failed_size = pmtud->probe_size;
+        continue_search(pmtud, now);
+        break;
+    case _AVS_NET_PMTUD_SEARCH_COMPLETE:
+        AVS_UNREACHABLE("no probes are sent in the Search Complete state");
+        break;
+    }
+}
+
+void _avs_net_pmtud_ptb_received(_avs_net_pmtud_t *pmtud,
+                                 int ptb_size,
+                                 avs_time_monotonic_t now) {
+    if (ptb_size < pmtud->min_plpmtu || ptb_size >= pmtud->failed_size) {
+        return;
+    }
+    pmtud->failed_size = ptb_size + 1;
+    if (ptb_size < pmtud->plpmtu
+            || (pmtud->state != _AVS_NET_PMTUD_SEARCHING
+                && pmtud->probe_size > ptb_size)) {
+        /* the size reported by the network is used without further probing,
+         * as in RFC 8899, section 4.6.2 */
+        pmtud->plpmtu = ptb_size;
+        complete_search(pmtud, now);
+    } else if (pmtud->probe_size > ptb_size) {
+        /* the reported size is the most likely candidate */
+        start_probe(pmtud, ptb_size);
+    }
+}
+
+typedef struct {
+    avs_net_resolved_endpoint_t destination;
+    int plpmtu;
+    avs_time_monotonic_t validated_at;
+    uint64_t last_used;
+} path_mtu_cache_entry_t;
+
+struct avs_net_path_mtu_cache_struct {
+    avs_mutex_t *mutex;
+    uint64_t use_counter;
+    size_t capacity;
+    size_t size;
+    path_mtu_cache_entry_t entries[];
+};
+
+static path_mtu_cache_entry_t *
+find_entry(avs_net_path_mtu_cache_t *cache,
+           const avs_net_resolved_endpoint_t *destination) {
+    for (size_t i = 0; i < cache->size; ++i) {
+        path_mtu_cache_entry_t *entry = &cache->entries[i];
+        if (entry->destination.size == destination->size
+                && !memcmp(entry->destination.data.buf, destination->data.buf,
+                           destination->size)) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+bool _avs_net_path_mtu_cache_lookup(
+        avs_net_path_mtu_cache_t *cache,
+        const avs_net_resolved_endpoint_t *destination,
+        int *out_plpmtu,
+        avs_time_monotonic_t *out_validated_at) {
+    avs_mutex_lock(cache->mutex);
+    path_mtu_cache_entry_t *entry = find_entry(cache, destination);
+    if (entry) {
+        entry->last_used = ++cache->use_counter;
+        *out_plpmtu = entry->plpmtu;
+        *out_validated_at = entry->validated_at;
+    }
+    avs_mutex_unlock(cache->mutex);
+    return entry != NULL;
+}
+
+void _avs_net_path_mtu_cache_store(
+        avs_net_path_mtu_cache_t *cache,
+        const avs_net_resolved_endpoint_t *destination,
+        int plpmtu,
+        avs_time_monotonic_t validated_at) {
+    avs_mutex_lock(cache->mutex);
+    path_mtu_cache_entry_t *entry = find_entry(cache, destination);
+    if (!entry && cache->size < cache->capacity) {
+        entry = &cache->entries[cache->size++];
+    } else if (!entry) {
+        entry = &cache->entries[0];
+        for (size_t i = 1; i < cache->size; ++i) {
+            if (cache->entries[i].last_used < entry->last_used) {
+                entry = &cache->entries[i];
+            }
+        }
+    }
+    entry->destination = *destination;
+    entry->plpmtu = plpmtu;
+    entry->validated_at = validated_at;
+    entry->last_used = ++cache->use_counter;
+    avs_mutex_unlock(cache->mutex);
+}
+
+avs_error_t avs_net_path_mtu_cache_create(avs_net_path_mtu_cache_t **out_cache,
+                                          size_t capacity) {
+    assert(out_cache && !*out_cache);
+    if (!capacity
+            || capacity > (SIZE_MAX - sizeof(avs_net_path_mtu_cache_t))
+                                  / sizeof(path_mtu_cache_entry_t)) {
+        return avs_errno(AVS_EINVAL);
+    }
+    avs_net_path_mtu_cache_t *cache = (avs_net_path_mtu_cache_t *) avs_calloc(
+            1, sizeof(avs_net_path_mtu_cache_t)
+                       + capacity * sizeof(path_mtu_cache_entry_t));
+    if (!cache) {
+        LOG(ERROR, _("out of memory"));
+        return avs_errno(AVS_ENOMEM);
+    }
+    if (avs_mutex_create(&cache->mutex)) {
+        LOG(ERROR, _("could not create mutex"));
+        avs_free(cache);
+        return avs_errno(AVS_ENOMEM);
+    }
+    cache->capacity = capacity;
+    *out_cache = cache;
+    return AVS_OK;
+}
+
+void avs_net_path_mtu_cache_cleanup(avs_net_path_mtu_cache_t **cache_ptr) {
+    if (!*cache_ptr) {
+        return;
+    }
+    avs_mutex_cleanup(&(*cache_ptr)->mutex);
+    avs_free(*cache_ptr);
+    *cache_ptr = NULL;
+}
+
+#    ifdef AVS_UNIT_TESTING
+#        include "tests/net/pmtud.c"
+#    endif // AVS_UNIT_TESTING
+
+#endif // defined(AVS_COMMONS_WITH_AVS_NET) &&
+       // defined(AVS_COMMONS_NET_WITH_PATH_MTU_DISCOVERY)
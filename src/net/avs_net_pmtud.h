@@ -0,0 +1,133 @@
+/*
+ * Copyright 2021 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NET_PMTUD_H
+#define NET_PMTUD_H
+
+#include <avsystem/commons/avs_socket.h>
+#include <avsystem/commons/avs_time.h>
+
+VISIBILITY_PRIVATE_HEADER_BEGIN
+
+/**
+ * States of the Datagram Packetization Layer Path MTU Discovery state machine,
+ * as described in RFC 8899, section 5.2. The Disabled state is represented by
+ * the engine not being used at all.
+ */
+typedef enum {
+    /** BASE_PLPMTU is being confirmed. */
+    _AVS_NET_PMTUD_BASE,
+    /** Larger sizes are being probed for. */
+    _AVS_NET_PMTUD_SEARCHING,
+    /** PLPMTU is known; it will be raised again after the raise timer. */
+    _AVS_NET_PMTUD_SEARCH_COMPLETE,
+    /** Even BASE_PLPMTU could not be confirmed; MIN_PLPMTU is used. */
+    _AVS_NET_PMTUD_ERROR
+} _avs_net_pmtud_state_t;
+
+/**
+ * Path MTU discovery engine, independent of the actual socket implementation.
+ * All sizes are of network-layer packets, i.e. including the IP and UDP
+ * headers.
+ */
+typedef struct {
+    _avs_net_pmtud_state_t state;
+    int min_plpmtu;
+    int base_plpmtu;
+    int max_plpmtu;
+    /** Current estimate of the path MTU. */
+    int plpmtu;
+    /** Smallest size known not to fit; max_plpmtu + 1 if there is none. */
+    int failed_size;
+    /** Size of the probe to send, or 0 if none is needed at the moment. */
+    int probe_size;
+    /** Number of consecutive losses of the current probe. */
+    unsigned probe_count;
+    /** Time after which a search for a larger PLPMTU will be started. */
+    avs_time_monotonic_t raise_deadline;
+} _avs_net_pmtud_t;
+
+/**
+ * Initializes the engine in the Base state. @p base_plpmtu and @p max_plpmtu
+ * are adjusted so that min_plpmtu <= base_plpmtu <= max_plpmtu holds.
+ */
+void _avs_net_pmtud_init(_avs_net_pmtud_t *pmtud,
+                         int min_plpmtu,
+                         int base_plpmtu,
+                         int max_plpmtu);
+
+/**
+ * Moves the engine to the Search Complete state with PLPMTU set to @p plpmtu,
+ * which has been confirmed at @p validated_at, e.g. by another socket. Ignored
+ * if @p plpmtu is out of the allowed range.
+ */
+void _avs_net_pmtud_restore(_avs_net_pmtud_t *pmtud,
+                            int plpmtu,
+                            avs_time_monotonic_t validated_at);
+
+/**
+ * Returns the size of the probe that shall be sent, or 0 if no probe is needed
+ * at the moment. Starts a new search if the raise timer has expired.
+ */
+int _avs_net_pmtud_probe_size(_avs_net_pmtud_t *pmtud,
+                              avs_time_monotonic_t now);
+
+/**
+ * Handles a confirmation of delivery of the current probe.
+ */
+void _avs_net_pmtud_probe_acked(_avs_net_pmtud_t *pmtud,
+                                avs_time_monotonic_t now);
+
+/**
+ * Handles a loss of the current probe.
+ */
+void _avs_net_pmtud_probe_lost(_avs_net_pmtud_t *pmtud,
+                               avs_time_monotonic_t now);
+
+/**
+ * Handles a Packet Too Big indication, i.e. information that packets larger
+ * than @p ptb_size cannot traverse the path. Indications smaller than
+ * MIN_PLPMTU are ignored.
+ */
+void _avs_net_pmtud_ptb_received(_avs_net_pmtud_t *pmtud,
+                                 int ptb_size,
+                                 avs_time_monotonic_t now);
+
+/**
+ * Looks up a PLPMTU previously stored in @p cache for @p destination. Port
+ * numbers in @p destination are expected to be zeroed by the caller.
+ *
+ * @returns true if an entry has been found, false otherwise.
+ */
+bool _avs_net_path_mtu_cache_lookup(
+        avs_net_path_mtu_cache_t *cache,
+        const avs_net_resolved_endpoint_t *destination,
+        int *out_plpmtu,
+        avs_time_monotonic_t *out_validated_at);
+
+/**
+ * Stores a PLPMTU confirmed at @p validated_at for @p destination, evicting the
+ * least recently used entry if necessary.
+ */
+void _avs_net_path_mtu_cache_store(
+        avs_net_path_mtu_cache_t *cache,
+        const avs_net_resolved_endpoint_t *destination,
+        int plpmtu,
+        avs_time_monotonic_t validated_at);
+
+VISIBILITY_PRIVATE_HEADER_END
+
+#endif // NET_PMTUD_H
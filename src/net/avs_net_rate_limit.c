@@ -0,0 +1,654 @@
+/*
+ * Copyright 2021 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <avs_commons_init.h>
+
+#if defined(AVS_COMMONS_WITH_AVS_NET) \
+        && defined(AVS_COMMONS_NET_WITH_RATE_LIMIT)
+
+#    include <assert.h>
+#    include <stdint.h>
+
+#    include <avsystem/commons/avs_condvar.h>
+#    include <avsystem/commons/avs_memory.h>
+#    include <avsystem/commons/avs_mutex.h>
+#    include <avsystem/commons/avs_socket_v_table.h>
+
+#    include "avs_net_impl.h"
+
+VISIBILITY_SOURCE_BEGIN
+
+#    define NS_PER_SECOND UINT64_C(1000000000)
+
+/*
+ * Token counts are limited to 32 bits, so that all the intermediate values of
+ * the calculations below fit in 64-bit integers. The bucket level is in
+ * range [-UINT32_MAX, capacity], where capacity <= UINT32_MAX.
+ */
+#    define MAX_TOKENS ((uint64_t) UINT32_MAX)
+
+typedef struct {
+    /* zero if the bucket is disabled */
+    uint32_t rate;
+    int64_t capacity;
+    /* negative if the bucket went into debt */
+    int64_t level;
+    int64_t last_refill_ns;
+} token_bucket_t;
+
+struct avs_net_rate_limit_group_struct {
+    avs_mutex_t *mutex;
+    unsigned refcount;
+    token_bucket_t send;
+    token_bucket_t receive;
+};
+
+typedef enum { DIRECTION_SEND, DIRECTION_RECEIVE } direction_t;
+
+typedef struct {
+    token_bucket_t bucket;
+    avs_net_rate_limit_stats_t stats;
+} rate_limit_direction_t;
+
+typedef struct {
+    const avs_net_socket_v_table_t *const operations;
+    avs_net_socket_t *backend_socket;
+    bool stream;
+    bool nonblocking;
+    avs_net_rate_limit_group_t *group;
+    /* used only for sleeping in blocking mode */
+    avs_mutex_t *wait_mutex;
+    avs_condvar_t *wait_condvar;
+    rate_limit_direction_t send;
+    rate_limit_direction_t receive;
+} rate_limit_socket_t;
+
+static int64_t monotonic_ns(avs_time_monotonic_t time) {
+    int64_t result = 0;
+    avs_time_monotonic_to_scalar(&result, AVS_TIME_NS, time);
+    return result;
+}
+
+/**
+ * Calculates the time needed to accumulate @p tokens (at most
+ * 2 * MAX_TOKENS) at @p rate tokens per second.
+ */
+static uint64_t tokens_to_ns(uint64_t tokens, uint32_t rate, bool round_up) {
+    return tokens / rate * NS_PER_SECOND
+           + (tokens % rate * NS_PER_SECOND + (round_up ? rate - 1 : 0))
+                     / rate;
+}
+
+static void bucket_init(token_bucket_t *bucket,
+                        const avs_net_token_bucket_config_t *config,
+                        bool pacing,
+                        int64_t now_ns) {
+    bucket->rate = config->rate;
+    if (pacing) {
+        bucket->capacity = 0;
+    } else {
+        bucket->capacity = config->burst ? config->burst : config->rate;
+    }
+    bucket->level = bucket->capacity;
+    bucket->last_refill_ns = now_ns;
+}
+
+static void bucket_refill(token_bucket_t *bucket, int64_t now_ns) {
+    if (!bucket->rate || now_ns <= bucket->last_refill_ns) {
+        return;
+    }
+    uint64_t elapsed_ns = (uint64_t) (now_ns - bucket->last_refill_ns);
+    uint64_t missing = (uint64_t) (bucket->capacity - bucket->level);
+    if (elapsed_ns >= tokens_to_ns(missing, bucket->rate, true)) {
+        bucket->level = bucket->capacity;
+        bucket->last_refill_ns = now_ns;
+        return;
+    }
+    /* less than missing, so no overflow is possible */
+    uint64_t added = elapsed_ns / NS_PER_SECOND * bucket->rate
+                     + elapsed_ns % NS_PER_SECOND * bucket->rate
+                               / NS_PER_SECOND;
+    bucket->level += (int64_t) added;
+    /* the time corresponding to the fractional token is not lost */
+    bucket->last_refill_ns +=
+            (int64_t) tokens_to_ns(added, bucket->rate, false);
+}
+
+static uint64_t bucket_available(const token_bucket_t *bucket) {
+    if (!bucket->rate) {
+        return UINT64_MAX;
+    }
+    return bucket->level > 0 ? (uint64_t) bucket->level : 0;
+}
+
+/**
+ * Returns the time, in nanoseconds, after which an operation of @p amount
+ * bytes may be performed, or 0 if it may be performed right away.
+ *
+ * The operation needs as many tokens as it transfers bytes, but no more than
+ * the bucket capacity, so that transfers larger than the capacity are
+ * possible. The bucket goes into debt in that case.
+ */
+static int64_t
+bucket_wait_ns(const token_bucket_t *bucket, uint64_t amount, int64_t now_ns) {
+    if (!bucket->rate) {
+        return 0;
+    }
+    int64_t needed = (int64_t) AVS_MIN(amount, MAX_TOKENS);
+    needed = AVS_MIN(needed, bucket->capacity);
+    if (bucket->level >= needed) {
+        return 0;
+    }
+    int64_t wait_ns =
+            (int64_t) tokens_to_ns((uint64_t) (needed - bucket->level),
+                                   bucket->rate, true)
+            - (now_ns - bucket->last_refill_ns);
+    return AVS_MAX(wait_ns, 1);
+}
+
+static void bucket_consume(token_bucket_t *bucket, uint64_t amount) {
+    if (bucket->rate) {
+        bucket->level -= (int64_t) AVS_MIN(amount, MAX_TOKENS);
+        bucket->level = AVS_MAX(bucket->level, -(int64_t) MAX_TOKENS);
+    }
+}
+
+static rate_limit_direction_t *get_direction(rate_limit_socket_t *socket,
+                                             direction_t direction) {
+    return direction == DIRECTION_SEND ? &socket->send : &socket->receive;
+}
+
+/**
+ * Locks the group the socket belongs to, if any, and returns its bucket for
+ * @p direction.
+ */
+static token_bucket_t *lock_group_bucket(rate_limit_socket_t *socket,
+                                         direction_t direction) {
+    if (!socket->group) {
+        return NULL;
+    }
+    avs_mutex_lock(socket->group->mutex);
+    return direction == DIRECTION_SEND ? &socket->group->send
+                                       : &socket->group->receive;
+}
+
+static void unlock_group(rate_limit_socket_t *socket) {
+    if (socket->group) {
+        avs_mutex_unlock(socket->group->mutex);
+    }
+}
+
+static void sleep_until(rate_limit_socket_t *socket,
+                        avs_time_monotonic_t wake_time) {
+    avs_mutex_lock(socket->wait_mutex);
+    while (avs_time_monotonic_before(avs_time_monotonic_now(), wake_time)) {
+        avs_condvar_wait(socket->wait_condvar, socket->wait_mutex, wake_time);
+    }
+    avs_mutex_unlock(socket->wait_mutex);
+}
+
+/**
+ * Waits until an operation of @p amount bytes is allowed by both the socket's
+ * and the group's buckets for @p direction.
+ *
+ * @param split       If true, the operation may be performed partially, and
+ *                    @p out_granted is set to the number of bytes that may be
+ *                    transferred right away. Otherwise, it is set to
+ *                    @p amount.
+ *
+ * @param consume     If true, the granted number of tokens is taken from the
+ *                    buckets.
+ *
+ * @param deadline    Time after which to give up waiting with
+ *                    <c>avs_errno(AVS_ETIMEDOUT)</c>, or
+ *                    @ref AVS_TIME_MONOTONIC_INVALID to wait indefinitely.
+ */
+static avs_error_t acquire_tokens(rate_limit_socket_t *socket,
+                                  direction_t direction,
+                                  size_t amount,
+                                  bool split,
+                                  bool consume,
+                                  avs_time_monotonic_t deadline,
+                                  size_t *out_granted) {
+    rate_limit_direction_t *dir = get_direction(socket, direction);
+    bool throttled = false;
+    dir->stats.retry_after = AVS_TIME_DURATION_ZERO;
+    while (true) {
+        avs_time_monotonic_t now = avs_time_monotonic_now();
+        int64_t now_ns = monotonic_ns(now);
+
+        token_bucket_t *group_bucket = lock_group_bucket(socket, direction);
+        bucket_refill(&dir->bucket, now_ns);
+        int64_t wait_ns = bucket_wait_ns(&dir->bucket, amount, now_ns);
+        if (group_bucket) {
+            bucket_refill(group_bucket, now_ns);
+            wait_ns = AVS_MAX(wait_ns,
+                              bucket_wait_ns(group_bucket, amount, now_ns));
+        }
+        if (!wait_ns) {
+            *out_granted = amount;
+            if (split) {
+                uint64_t available = bucket_available(&dir->bucket);
+                if (group_bucket) {
+                    available =
+                            AVS_MIN(available, bucket_available(group_bucket));
+                }
+                *out_granted = (size_t) AVS_MIN((uint64_t) amount, available);
+            }
+            if (consume) {
+                bucket_consume(&dir->bucket, *out_granted);
+                if (group_bucket) {
+                    bucket_consume(group_bucket, *out_granted);
+                }
+            }
+        }
+        unlock_group(socket);
+
+        if (!wait_ns) {
+            return AVS_OK;
+        }
+        if (!throttled) {
+            throttled = true;
+            ++dir->stats.throttled_count;
+        }
+        avs_time_duration_t wait =
+                avs_time_duration_from_scalar(wait_ns, AVS_TIME_NS);
+        if (socket->nonblocking) {
+            dir->stats.retry_after = wait;
+            return avs_errno(AVS_EAGAIN);
+        }
+
+        avs_time_monotonic_t wake_time = avs_time_monotonic_add(now, wait);
+        bool timed_out = false;
+        if (avs_time_monotonic_valid(deadline)
+                && avs_time_monotonic_before(deadline, wake_time)) {
+            wake_time = deadline;
+            timed_out = true;
+        }
+        sleep_until(socket, wake_time);
+        dir->stats.total_delay = avs_time_duration_add(
+                dir->stats.total_delay,
+                avs_time_monotonic_diff(avs_time_monotonic_now(), now));
+        if (timed_out) {
+            return avs_errno(AVS_ETIMEDOUT);
+        }
+    }
+}
+
+static void consume_tokens(rate_limit_socket_t *socket,
+                           direction_t direction,
+                           size_t amount) {
+    token_bucket_t *group_bucket = lock_group_bucket(socket, direction);
+    bucket_consume(&get_direction(socket, direction)->bucket, amount);
+    if (group_bucket) {
+        bucket_consume(group_bucket, amount);
+    }
+    unlock_group(socket);
+}
+
+static avs_time_monotonic_t get_receive_deadline(rate_limit_socket_t *socket) {
+    avs_net_socket_opt_value_t timeout;
+    if (avs_is_err(avs_net_socket_get_opt(socket->backend_socket,
+                                          AVS_NET_SOCKET_OPT_RECV_TIMEOUT,
+                                          &timeout))) {
+        return AVS_TIME_MONOTONIC_INVALID;
+    }
+    return avs_time_monotonic_add(avs_time_monotonic_now(),
+                                  timeout.recv_timeout);
+}
+
+static avs_error_t connect_rate_limit(avs_net_socket_t *socket,
+                                      const char *host,
+                                      const char *port) {
+    return avs_net_socket_connect(
+            ((rate_limit_socket_t *) socket)->backend_socket, host, port);
+}
+
+static avs_error_t decorate_rate_limit(avs_net_socket_t *socket,
+                                       avs_net_socket_t *backend_socket) {
+    return avs_net_socket_decorate(
+            ((rate_limit_socket_t *) socket)->backend_socket, backend_socket);
+}
+
+static avs_error_t send_rate_limit(avs_net_socket_t *socket_,
+                                   const void *buffer,
+                                   size_t buffer_length) {
+    rate_limit_socket_t *socket = (rate_limit_socket_t *) socket_;
+    /* in non-blocking mode, the data must be sent all at once */
+    bool split = socket->stream && !socket->nonblocking;
+    const char *data = (const char *) buffer;
+    do {
+        size_t chunk_size;
+        avs_error_t err =
+                acquire_tokens(socket, DIRECTION_SEND, buffer_length, split,
+                               true, AVS_TIME_MONOTONIC_INVALID, &chunk_size);
+        if (avs_is_ok(err)) {
+            err = avs_net_socket_send(socket->backend_socket, data,
+                                      chunk_size);
+        }
+        if (avs_is_err(err)) {
+            return err;
+        }
+        data += chunk_size;
+        buffer_length -= chunk_size;
+    } while (buffer_length);
+    return AVS_OK;
+}
+
+static avs_error_t send_to_rate_limit(avs_net_socket_t *socket_,
+                                      const void *buffer,
+                                      size_t buffer_length,
+                                      const char *host,
+                                      const char *port) {
+    rate_limit_socket_t *socket = (rate_limit_socket_t *) socket_;
+    size_t granted;
+    avs_error_t err =
+            acquire_tokens(socket, DIRECTION_SEND, buffer_length, false, true,
+                           AVS_TIME_MONOTONIC_INVALID, &granted);
+    if (avs_is_err(err)) {
+        return err;
+    }
+    return avs_net_socket_send_to(socket->backend_socket, buffer,
+                                  buffer_length, host, port);
+}
+
+/**
+ * Waits for receive tokens. Stream sockets are not allowed to read more data
+ * than there are tokens available, so @p *inout_buffer_length may be
+ * decreased. Datagrams are always read as a whole, and accounted for
+ * afterwards.
+ */
+static avs_error_t wait_for_receive(rate_limit_socket_t *socket,
+                                    size_t *inout_buffer_length) {
+    size_t granted;
+    avs_error_t err =
+            acquire_tokens(socket, DIRECTION_RECEIVE,
+                           socket->stream ? *inout_buffer_length : 1,
+                           socket->stream, false,
+                           get_receive_deadline(socket), &granted);
+    if (avs_is_ok(err) && socket->stream) {
+        *inout_buffer_length = granted;
+    }
+    return err;
+}
+
+static avs_error_t receive_rate_limit(avs_net_socket_t *socket_,
+                                      size_t *out_bytes_received,
+                                      void *buffer,
+                                      size_t buffer_length) {
+    rate_limit_socket_t *socket = (rate_limit_socket_t *) socket_;
+    *out_bytes_received = 0;
+    avs_error_t err = wait_for_receive(socket, &buffer_length);
+    if (avs_is_err(err)) {
+        return err;
+    }
+    err = avs_net_socket_receive(socket->backend_socket, out_bytes_received,
+                                 buffer, buffer_length);
+    consume_tokens(socket, DIRECTION_RECEIVE, *out_bytes_received);
+    return err;
+}
+
+static avs_error_t receive_from_rate_limit(avs_net_socket_t *socket_,
+                                           size_t *out_bytes_received,
+                                           void *buffer,
+                                           size_t buffer_length,
+                                           char *host,
+                                           size_t host_size,
+                                           char *port,
+                                           size_t port_size) {
+    rate_limit_socket_t *socket = (rate_limit_socket_t *) socket_;
+    *out_bytes_received = 0;
+    avs_error_t err = wait_for_receive(socket, &buffer_length);
+    if (avs_is_err(err)) {
+        return err;
+    }
+    err = avs_net_socket_receive_from(socket->backend_socket,
+                                      out_bytes_received, buffer,
+                                      buffer_length, host, host_size, port,
+                                      port_size);
+    consume_tokens(socket, DIRECTION_RECEIVE, *out_bytes_received);
+    return err;
+}
+
+static avs_error_t bind_rate_limit(avs_net_socket_t *socket,
+                                   const char *localaddr,
+                                   const char *port) {
+    return avs_net_socket_bind(((rate_limit_socket_t *) socket)->backend_socket,
+                               localaddr, port);
+}
+
+static avs_error_t accept_rate_limit(avs_net_socket_t *server_socket,
+                                     avs_net_socket_t *new_socket);
+
+static avs_error_t close_rate_limit(avs_net_socket_t *socket) {
+    return avs_net_socket_close(
+            ((rate_limit_socket_t *) socket)->backend_socket);
+}
+
+static avs_error_t shutdown_rate_limit(avs_net_socket_t *socket) {
+    return avs_net_socket_shutdown(
+            ((rate_limit_socket_t *) socket)->backend_socket);
+}
+
+static void group_release(avs_net_rate_limit_group_t **group_ptr) {
+    if (!*group_ptr) {
+        return;
+    }
+    avs_mutex_lock((*group_ptr)->mutex);
+    bool last_reference = !--(*group_ptr)->refcount;
+    avs_mutex_unlock((*group_ptr)->mutex);
+    if (last_reference) {
+        avs_mutex_cleanup(&(*group_ptr)->mutex);
+        avs_free(*group_ptr);
+    }
+    *group_ptr = NULL;
+}
+
+static avs_error_t cleanup_rate_limit(avs_net_socket_t **socket_ptr) {
+    rate_limit_socket_t *socket = (rate_limit_socket_t *) *socket_ptr;
+    avs_error_t err = avs_net_socket_cleanup(&socket->backend_socket);
+    group_release(&socket->group);
+    avs_condvar_cleanup(&socket->wait_condvar);
+    avs_mutex_cleanup(&socket->wait_mutex);
+    avs_free(socket);
+    *socket_ptr = NULL;
+    return err;
+}
+
+static const void *system_socket_rate_limit(avs_net_socket_t *socket) {
+    return avs_net_socket_get_system(
+            ((rate_limit_socket_t *) socket)->backend_socket);
+}
+
+static avs_error_t
+interface_name_rate_limit(avs_net_socket_t *socket,
+                          avs_net_socket_interface_name_t *if_name) {
+    return avs_net_socket_interface_name(
+            ((rate_limit_socket_t *) socket)->backend_socket, if_name);
+}
+
+static avs_error_t remote_host_rate_limit(avs_net_socket_t *socket,
+                                          char *out_buffer,
+                                          size_t out_buffer_size) {
+    return avs_net_socket_get_remote_host(
+            ((rate_limit_socket_t *) socket)->backend_socket, out_buffer,
+            out_buffer_size);
+}
+
+static avs_error_t remote_hostname_rate_limit(avs_net_socket_t *socket,
+                                              char *out_buffer,
+                                              size_t out_buffer_size) {
+    return avs_net_socket_get_remote_hostname(
+            ((rate_limit_socket_t *) socket)->backend_socket, out_buffer,
+            out_buffer_size);
+}
+
+static avs_error_t remote_port_rate_limit(avs_net_socket_t *socket,
+                                          char *out_buffer,
+                                          size_t out_buffer_size) {
+    return avs_net_socket_get_remote_port(
+            ((rate_limit_socket_t *) socket)->backend_socket, out_buffer,
+            out_buffer_size);
+}
+
+static avs_error_t local_host_rate_limit(avs_net_socket_t *socket,
+                                         char *out_buffer,
+                                         size_t out_buffer_size) {
+    return avs_net_socket_get_local_host(
+            ((rate_limit_socket_t *) socket)->backend_socket, out_buffer,
+            out_buffer_size);
+}
+
+static avs_error_t local_port_rate_limit(avs_net_socket_t *socket,
+                                         char *out_buffer,
+                                         size_t out_buffer_size) {
+    return avs_net_socket_get_local_port(
+            ((rate_limit_socket_t *) socket)->backend_socket, out_buffer,
+            out_buffer_size);
+}
+
+static avs_error_t
+get_opt_rate_limit(avs_net_socket_t *socket_,
+                   avs_net_socket_opt_key_t option_key,
+                   avs_net_socket_opt_value_t *out_option_value) {
+    rate_limit_socket_t *socket = (rate_limit_socket_t *) socket_;
+    switch (option_key) {
+    case AVS_NET_SOCKET_OPT_RATE_LIMIT_SEND_STATS:
+        out_option_value->rate_limit_stats = socket->send.stats;
+        return AVS_OK;
+    case AVS_NET_SOCKET_OPT_RATE_LIMIT_RECEIVE_STATS:
+        out_option_value->rate_limit_stats = socket->receive.stats;
+        return AVS_OK;
+    default:
+        return avs_net_socket_get_opt(socket->backend_socket, option_key,
+                                      out_option_value);
+    }
+}
+
+static avs_error_t set_opt_rate_limit(avs_net_socket_t *socket,
+                                      avs_net_socket_opt_key_t option_key,
+                                      avs_net_socket_opt_value_t option_value) {
+    return avs_net_socket_set_opt(
+            ((rate_limit_socket_t *) socket)->backend_socket, option_key,
+            option_value);
+}
+
+static const avs_net_socket_v_table_t rate_limit_vtable = {
+    .connect = connect_rate_limit,
+    .decorate = decorate_rate_limit,
+    .send = send_rate_limit,
+    .send_to = send_to_rate_limit,
+    .receive = receive_rate_limit,
+    .receive_from = receive_from_rate_limit,
+    .bind = bind_rate_limit,
+    .accept = accept_rate_limit,
+    .close = close_rate_limit,
+    .shutdown = shutdown_rate_limit,
+    .cleanup = cleanup_rate_limit,
+    .get_system_socket = system_socket_rate_limit,
+    .get_interface_name = interface_name_rate_limit,
+    .get_remote_host = remote_host_rate_limit,
+    .get_remote_hostname = remote_hostname_rate_limit,
+    .get_remote_port = remote_port_rate_limit,
+    .get_local_host = local_host_rate_limit,
+    .get_local_port = local_port_rate_limit,
+    .get_opt = get_opt_rate_limit,
+    .set_opt = set_opt_rate_limit
+};
+
+static avs_error_t accept_rate_limit(avs_net_socket_t *server_socket,
+                                     avs_net_socket_t *new_socket) {
+    if (((rate_limit_socket_t *) new_socket)->operations
+            != &rate_limit_vtable) {
+        LOG(ERROR, _("accept() called with socket of invalid type"));
+        return avs_errno(AVS_EINVAL);
+    }
+    return avs_net_socket_accept(
+            ((rate_limit_socket_t *) server_socket)->backend_socket,
+            ((rate_limit_socket_t *) new_socket)->backend_socket);
+}
+
+avs_error_t avs_net_rate_limit_group_create(
+        avs_net_rate_limit_group_t **out_group,
+        const avs_net_rate_limit_group_config_t *config) {
+    assert(out_group && !*out_group);
+    assert(config);
+    avs_net_rate_limit_group_t *group = (avs_net_rate_limit_group_t *)
+            avs_calloc(1, sizeof(avs_net_rate_limit_group_t));
+    if (!group) {
+        LOG(ERROR, _("out of memory"));
+        return avs_errno(AVS_ENOMEM);
+    }
+    if (avs_mutex_create(&group->mutex)) {
+        LOG(ERROR, _("could not create mutex"));
+        avs_free(group);
+        return avs_errno(AVS_ENOMEM);
+    }
+    int64_t now_ns = monotonic_ns(avs_time_monotonic_now());
+    bucket_init(&group->send, &config->send, false, now_ns);
+    bucket_init(&group->receive, &config->receive, false, now_ns);
+    group->refcount = 1;
+    *out_group = group;
+    return AVS_OK;
+}
+
+void avs_net_rate_limit_group_cleanup(avs_net_rate_limit_group_t **group_ptr) {
+    group_release(group_ptr);
+}
+
+avs_error_t avs_net_rate_limit_socket_decorate_in_place(
+        avs_net_socket_t **socket, const avs_net_rate_limit_config_t *config) {
+    assert(socket && *socket);
+    assert(config);
+    rate_limit_socket_t *rate_limit_socket = (rate_limit_socket_t *)
+            avs_calloc(1, sizeof(rate_limit_socket_t));
+    if (!rate_limit_socket) {
+        LOG(ERROR, _("out of memory"));
+        return avs_errno(AVS_ENOMEM);
+    }
+    if (!config->nonblocking
+            && (avs_mutex_create(&rate_limit_socket->wait_mutex)
+                || avs_condvar_create(&rate_limit_socket->wait_condvar))) {
+        LOG(ERROR, _("could not create synchronization primitives"));
+        avs_mutex_cleanup(&rate_limit_socket->wait_mutex);
+        avs_free(rate_limit_socket);
+        return avs_errno(AVS_ENOMEM);
+    }
+    *(const avs_net_socket_v_table_t **) (intptr_t) &rate_limit_socket
+             ->operations = &rate_limit_vtable;
+    rate_limit_socket->stream = (config->backend_type == AVS_NET_TCP_SOCKET
+                                 || config->backend_type == AVS_NET_SSL_SOCKET);
+    rate_limit_socket->nonblocking = config->nonblocking;
+
+    int64_t now_ns = monotonic_ns(avs_time_monotonic_now());
+    bucket_init(&rate_limit_socket->send.bucket, &config->send,
+                config->pacing && !rate_limit_socket->stream, now_ns);
+    bucket_init(&rate_limit_socket->receive.bucket, &config->receive, false,
+                now_ns);
+    if (config->group) {
+        avs_mutex_lock(config->group->mutex);
+        ++config->group->refcount;
+        avs_mutex_unlock(config->group->mutex);
+        rate_limit_socket->group = config->group;
+    }
+
+    rate_limit_socket->backend_socket = *socket;
+    *socket = (avs_net_socket_t *) rate_limit_socket;
+    return AVS_OK;
+}
+
+#endif // defined(AVS_COMMONS_WITH_AVS_NET) &&
+       // defined(AVS_COMMONS_NET_WITH_RATE_LIMIT)
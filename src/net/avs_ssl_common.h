@@ -22,6 +22,7 @@
 #endif
 
 #include <avsystem/commons/avs_memory.h>
+#include <avsystem/commons/avs_trace.h>
 
 VISIBILITY_PRIVATE_HEADER_BEGIN
 
@@ -132,6 +133,13 @@ bind_ssl(avs_net_socket_t *socket_, const char *localaddr, const char *port) {
     return avs_net_socket_bind(socket->backend_socket, localaddr, port);
 }
 
+static avs_error_t start_ssl_traced(ssl_socket_t *socket, const char *host) {
+    AVS_TRACE_BEGIN("tls", "handshake");
+    avs_error_t err = start_ssl(socket, host);
+    AVS_TRACE_END("tls", "handshake");
+    return err;
+}
+
 static avs_error_t
 connect_ssl(avs_net_socket_t *socket_, const char *host, const char *port) {
     ssl_socket_t *socket = (ssl_socket_t *) socket_;
@@ -154,7 +162,7 @@ connect_ssl(avs_net_socket_t *socket_, const char *host, const char *port) {
         return err;
     }
 
-    if (avs_is_err((err = start_ssl(socket, host)))) {
+    if (avs_is_err((err = start_ssl_traced(socket, host)))) {
         close_ssl_raw(socket);
     }
     return err;
@@ -194,7 +202,7 @@ static avs_error_t decorate_ssl(avs_net_socket_t *socket_,
         char host[NET_MAX_HOSTNAME_SIZE];
         if (avs_is_ok((err = avs_net_socket_get_remote_hostname(
                                backend_socket, host, sizeof(host))))) {
-            err = start_ssl(socket, host);
+            err = start_ssl_traced(socket, host);
         }
     }
     if (avs_is_err(err)) {
@@ -222,7 +230,34 @@ static avs_error_t shutdown_ssl(avs_net_socket_t *socket_) {
 static avs_error_t close_ssl(avs_net_socket_t *socket_) {
     ssl_socket_t *socket = (ssl_socket_t *) socket_;
     LOG(TRACE, _("close_ssl(socket=") "%p" _(")"), (void *) socket);
+    _avs_net_dtls_cork_flush(&socket->cork, socket->backend_socket);
     close_ssl_raw(socket);
+    _avs_net_dtls_cork_release(&socket->cork);
+    return AVS_OK;
+}
+
+/**
+ * Wrapper for the backend-specific send_ssl(), so that only the records of
+ * application data are batched when @ref AVS_NET_SOCKET_OPT_CORK is enabled.
+ */
+static avs_error_t send_ssl_corkable(avs_net_socket_t *socket_,
+                                     const void *buffer,
+                                     size_t buffer_length) {
+    ssl_socket_t *socket = (ssl_socket_t *) socket_;
+    socket->cork.batching = socket->cork.enabled;
+    avs_error_t err = send_ssl(socket_, buffer, buffer_length);
+    socket->cork.batching = false;
+    return err;
+}
+
+static avs_error_t set_cork(ssl_socket_t *socket, bool enabled) {
+    if (socket->backend_type != AVS_NET_UDP_SOCKET) {
+        return avs_errno(AVS_ENOTSUP);
+    }
+    socket->cork.enabled = enabled;
+    if (!enabled && socket->backend_socket) {
+        return _avs_net_dtls_cork_flush(&socket->cork, socket->backend_socket);
+    }
     return AVS_OK;
 }
 
@@ -348,6 +383,8 @@ static avs_error_t set_opt_ssl(avs_net_socket_t *ssl_socket_,
     case AVS_NET_SOCKET_OPT_DANE_TLSA_ARRAY:
         return set_dane_tlsa_array(ssl_socket, &option_value.dane_tlsa_array);
 #endif // WITH_DANE_SUPPORT
+    case AVS_NET_SOCKET_OPT_CORK:
+        return set_cork(ssl_socket, option_value.flag);
     default:
         if (!ssl_socket->backend_socket) {
             return avs_errno(AVS_EBADF);
@@ -358,6 +395,29 @@ static avs_error_t set_opt_ssl(avs_net_socket_t *ssl_socket_,
     }
 }
 
+/**
+ * Converts the maximum size of a datagram that can be sent through the backend
+ * socket into the maximum amount of data that can be passed to a single
+ * send_ssl() call, so that it is transmitted in a single datagram.
+ */
+static avs_error_t subtract_dtls_overhead(ssl_socket_t *ssl_socket,
+                                          int *inout_mtu) {
+    int header, padding;
+    avs_error_t err = get_dtls_overhead(ssl_socket, &header, &padding);
+    if (avs_is_err(err)) {
+        return err;
+    }
+    *inout_mtu -= header;
+    if (padding > 0) {
+        /* SSL padding is always present - when data is an exact multiply of
+         * block size, a full block of padding is added; the maximum user data
+         * we can pass is thus the maximum number of full blocks minus one
+         * byte */
+        *inout_mtu = (*inout_mtu / padding) * padding - 1;
+    }
+    return AVS_OK;
+}
+
 static avs_error_t get_opt_ssl(avs_net_socket_t *ssl_socket_,
                                avs_net_socket_opt_key_t option_key,
                                avs_net_socket_opt_value_t *out_option_value) {
@@ -367,19 +427,10 @@ static avs_error_t get_opt_ssl(avs_net_socket_t *ssl_socket_,
         /* getting inner MTU will fail for non-datagram sockets */
         int mtu = get_socket_inner_mtu_or_zero(ssl_socket->backend_socket);
         if (mtu > 0) {
-            int header, padding;
-            avs_error_t err = get_dtls_overhead(ssl_socket, &header, &padding);
+            avs_error_t err = subtract_dtls_overhead(ssl_socket, &mtu);
             if (avs_is_err(err)) {
                 return err;
             }
-            mtu -= header;
-            if (padding > 0) {
-                /* SSL padding is always present - when data is an exact
-                 * multiply of block size, a full block of padding is added;
-                 * the maximum user data we can pass is thus the maximum number
-                 * of full blocks minus one byte */
-                mtu = (mtu / padding) * padding - 1;
-            }
         }
         if (mtu < 0) {
             return avs_errno(AVS_UNKNOWN_ERROR);
@@ -387,9 +438,28 @@ static avs_error_t get_opt_ssl(avs_net_socket_t *ssl_socket_,
         out_option_value->mtu = mtu;
         return AVS_OK;
     }
+    case AVS_NET_SOCKET_OPT_PMTU_PROBE_SIZE: {
+        if (!ssl_socket->backend_socket) {
+            return avs_errno(AVS_EBADF);
+        }
+        avs_error_t err =
+                avs_net_socket_get_opt(ssl_socket->backend_socket, option_key,
+                                       out_option_value);
+        if (avs_is_ok(err) && out_option_value->mtu > 0) {
+            err = subtract_dtls_overhead(ssl_socket, &out_option_value->mtu);
+            out_option_value->mtu = AVS_MAX(out_option_value->mtu, 0);
+        }
+        return err;
+    }
     case AVS_NET_SOCKET_OPT_SESSION_RESUMED:
         out_option_value->flag = is_session_resumed(ssl_socket);
         return AVS_OK;
+    case AVS_NET_SOCKET_OPT_CORK:
+        if (ssl_socket->backend_type != AVS_NET_UDP_SOCKET) {
+            return avs_errno(AVS_ENOTSUP);
+        }
+        out_option_value->flag = ssl_socket->cork.enabled;
+        return AVS_OK;
     case AVS_NET_SOCKET_OPT_STATE:
         if (!ssl_socket->backend_socket) {
             out_option_value->state = AVS_NET_SOCKET_STATE_CLOSED;
@@ -457,7 +527,7 @@ static inline avs_error_t _avs_net_psk_copy(avs_net_owned_psk_t *dst,
 static const avs_net_socket_v_table_t ssl_vtable = {
     .connect = connect_ssl,
     .decorate = decorate_ssl,
-    .send = send_ssl,
+    .send = send_ssl_corkable,
     .receive = receive_ssl,
     .bind = bind_ssl,
     .close = close_ssl,
@@ -21,6 +21,10 @@
 
 #include "../../avs_net_impl.h"
 
+#ifdef AVS_COMMONS_NET_WITH_UNIX_SOCKETS
+#    include <sys/un.h>
+#endif // AVS_COMMONS_NET_WITH_UNIX_SOCKETS
+
 VISIBILITY_PRIVATE_HEADER_BEGIN
 
 /* Following values are not defined e.g. in LwIP 1.4.1 */
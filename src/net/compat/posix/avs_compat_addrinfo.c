@@ -39,6 +39,11 @@ struct avs_net_addrinfo_struct {
 #    ifdef WITH_AVS_V4MAPPED
     bool v4mapped;
 #    endif
+#    ifdef AVS_COMMONS_NET_WITH_UNIX_SOCKETS
+    /* used instead of results for AVS_NET_AF_UNIX; size == 0 if unused */
+    avs_net_resolved_endpoint_t unix_endpoint;
+    bool unix_endpoint_returned;
+#    endif // AVS_COMMONS_NET_WITH_UNIX_SOCKETS
 };
 
 static int port_from_string(uint16_t *out, const char *port_str) {
@@ -173,6 +178,52 @@ static int get_native_af(avs_net_af_t addr_family) {
     }
 }
 
+#    ifdef AVS_COMMONS_NET_WITH_UNIX_SOCKETS
+AVS_STATIC_ASSERT(sizeof(struct sockaddr_un)
+                          <= AVS_NET_SOCKET_RAW_RESOLVED_ENDPOINT_MAX_SIZE,
+                  sockaddr_un_fits_in_resolved_endpoint);
+
+/**
+ * "Resolves" a Unix domain socket path. No lookup is necessary, so the result
+ * is always a single endpoint containing the <c>sockaddr_un</c> structure.
+ */
+static avs_net_addrinfo_t *resolve_unix(const char *path) {
+    struct sockaddr_un addr;
+    size_t path_length = path ? strlen(path) : 0;
+    size_t addrlen = offsetof(struct sockaddr_un, sun_path);
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path_length >= sizeof(addr.sun_path)) {
+        LOG(ERROR, _("Unix socket path too long: ") "%s", path);
+        return NULL;
+    }
+    if (path_length && path[0] == '@') {
+#        ifdef __linux__
+        /* abstract namespace - leading null byte, no terminator */
+        memcpy(addr.sun_path + 1, path + 1, path_length - 1);
+        addrlen += path_length;
+#        else  // __linux__
+        LOG(ERROR, _("Abstract Unix socket addresses are not supported"));
+        return NULL;
+#        endif // __linux__
+    } else if (path_length) {
+        memcpy(addr.sun_path, path, path_length);
+        addrlen += path_length + 1;
+    }
+    /* empty path means autobind on Linux when passed to bind() */
+
+    avs_net_addrinfo_t *ctx =
+            (avs_net_addrinfo_t *) avs_calloc(1, sizeof(avs_net_addrinfo_t));
+    if (!ctx) {
+        LOG(ERROR, _("Out of memory"));
+        return NULL;
+    }
+    ctx->unix_endpoint.size = (uint8_t) addrlen;
+    memcpy(ctx->unix_endpoint.data.buf, &addr, addrlen);
+    return ctx;
+}
+#    endif // AVS_COMMONS_NET_WITH_UNIX_SOCKETS
+
 avs_net_addrinfo_t *avs_net_addrinfo_resolve_ex(
         avs_net_socket_type_t socket_type,
         avs_net_af_t family,
@@ -185,6 +236,12 @@ avs_net_addrinfo_t *avs_net_addrinfo_resolve_ex(
         return NULL;
     }
 
+#    ifdef AVS_COMMONS_NET_WITH_UNIX_SOCKETS
+    if (family == AVS_NET_AF_UNIX) {
+        return resolve_unix(host);
+    }
+#    endif // AVS_COMMONS_NET_WITH_UNIX_SOCKETS
+
     struct addrinfo hint;
     memset((void *) &hint, 0, sizeof(hint));
     hint.ai_family = get_native_af(family);
@@ -198,6 +255,9 @@ avs_net_addrinfo_t *avs_net_addrinfo_resolve_ex(
     if (flags & AVS_NET_ADDRINFO_RESOLVE_F_PASSIVE) {
         hint.ai_flags |= AI_PASSIVE;
     }
+    if (flags & AVS_NET_ADDRINFO_RESOLVE_F_NUMERICHOST) {
+        hint.ai_flags |= AI_NUMERICHOST;
+    }
 
     // some getaddrinfo() implementations interpret port 0 as invalid,
     // so we use our own port parsing
@@ -304,6 +364,16 @@ static int return_resolved_endpoint(avs_net_resolved_endpoint_t *out,
 
 int avs_net_addrinfo_next(avs_net_addrinfo_t *ctx,
                           avs_net_resolved_endpoint_t *out) {
+#    ifdef AVS_COMMONS_NET_WITH_UNIX_SOCKETS
+    if (ctx->unix_endpoint.size) {
+        if (ctx->unix_endpoint_returned) {
+            return AVS_NET_ADDRINFO_END;
+        }
+        *out = ctx->unix_endpoint;
+        ctx->unix_endpoint_returned = true;
+        return 0;
+    }
+#    endif // AVS_COMMONS_NET_WITH_UNIX_SOCKETS
 #    ifdef WITH_AVS_V4MAPPED
     if (ctx->v4mapped) {
         while (ctx->to_send && ctx->to_send->ai_family != AF_INET
@@ -336,6 +406,9 @@ int avs_net_addrinfo_next(avs_net_addrinfo_t *ctx,
 
 void avs_net_addrinfo_rewind(avs_net_addrinfo_t *ctx) {
     ctx->to_send = ctx->results;
+#    ifdef AVS_COMMONS_NET_WITH_UNIX_SOCKETS
+    ctx->unix_endpoint_returned = false;
+#    endif // AVS_COMMONS_NET_WITH_UNIX_SOCKETS
 }
 
 #endif // defined(AVS_COMMONS_WITH_AVS_NET) &&
@@ -0,0 +1,821 @@
+/*
+ * Copyright 2021 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define _AVS_NEED_POSIX_SOCKET
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#    define _GNU_SOURCE // for MAP_POPULATE
+#endif
+
+#include <avsystem/commons/avs_commons_config.h>
+
+#if defined(AVS_COMMONS_WITH_AVS_NET)                 \
+        && defined(AVS_COMMONS_NET_WITH_POSIX_AVS_SOCKET) \
+        && defined(AVS_COMMONS_NET_WITH_IO_RING)
+
+#    include <avs_commons_posix_init.h>
+
+#    include <assert.h>
+#    include <errno.h>
+#    include <limits.h>
+#    include <string.h>
+
+#    ifdef AVS_COMMONS_NET_POSIX_AVS_SOCKET_HAVE_IO_URING
+#        include <linux/io_uring.h>
+#        include <sys/mman.h>
+#        include <sys/syscall.h>
+#        include <sys/uio.h>
+#        if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter) \
+                && defined(__NR_io_uring_register)
+#            define HAVE_NATIVE_IO_RING
+#        endif
+#    endif // AVS_COMMONS_NET_POSIX_AVS_SOCKET_HAVE_IO_URING
+
+#    include <avsystem/commons/avs_errno_map.h>
+#    include <avsystem/commons/avs_io_ring.h>
+#    include <avsystem/commons/avs_memory.h>
+
+#    include "avs_compat.h"
+
+VISIBILITY_SOURCE_BEGIN
+
+#    ifndef MSG_DONTWAIT
+#        define MSG_DONTWAIT 0
+#    endif
+
+#    define DEFAULT_QUEUE_SIZE 64
+/* maximum number of io_uring submission queue entries */
+#    define MAX_QUEUE_SIZE 4096
+
+#    define NO_FREE_OPS SIZE_MAX
+
+typedef enum {
+    OP_RECV,
+    OP_SEND,
+    OP_ACCEPT,
+    OP_CONNECT,
+    OP_READ,
+    OP_WRITE
+} io_op_type_t;
+
+typedef struct {
+    bool in_use;
+    io_op_type_t type;
+    int fd;
+    void *buf;
+    size_t size;
+    uint64_t offset;
+    avs_net_resolved_endpoint_t endpoint;
+    avs_io_ring_callback_t *callback;
+    void *arg;
+    /* fallback mode only: connect() has already been called */
+    bool connect_started;
+    /* index of the next free operation, if this one is free */
+    size_t next_free;
+} io_op_t;
+
+struct avs_io_ring_struct {
+    io_op_t *ops;
+    size_t queue_size;
+    size_t first_free;
+    size_t pending;
+
+    /* fallback mode only: snapshot of operations to process */
+    struct pollfd *pollfds;
+    size_t *poll_ops;
+
+#    ifdef HAVE_NATIVE_IO_RING
+    /* -1 in fallback mode */
+    int ring_fd;
+    unsigned features;
+    void *rings;
+    size_t rings_size;
+    struct io_uring_sqe *sqes;
+    size_t sqes_size;
+
+    unsigned *sq_tail;
+    unsigned sq_mask;
+    unsigned *sq_array;
+    unsigned sq_local_tail;
+    unsigned to_submit;
+
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned cq_mask;
+    struct io_uring_cqe *cqes;
+
+    avs_io_ring_buffer_t *buffers;
+    size_t buffer_count;
+#    endif // HAVE_NATIVE_IO_RING
+};
+
+static avs_error_t error_from_errno(int errno_value) {
+    avs_errno_t err = avs_map_errno(errno_value);
+    return avs_errno(err == AVS_NO_ERROR ? AVS_EIO : err);
+}
+
+static int timeout_ms_until(avs_time_monotonic_t deadline) {
+    int64_t timeout_us;
+    if (!avs_time_monotonic_valid(deadline)
+            || avs_time_duration_to_scalar(
+                       &timeout_us, AVS_TIME_US,
+                       avs_time_monotonic_diff(deadline,
+                                               avs_time_monotonic_now()))) {
+        return -1;
+    }
+    if (timeout_us <= 0) {
+        return 0;
+    }
+    /* rounded up, so that the deadline is not missed */
+    int64_t timeout_ms = (timeout_us + 999) / 1000;
+    return timeout_ms > INT_MAX ? INT_MAX : (int) timeout_ms;
+}
+
+static void complete_op(avs_io_ring_t *ring,
+                        size_t index,
+                        avs_error_t err,
+                        size_t result) {
+    io_op_t *op = &ring->ops[index];
+    assert(op->in_use);
+    avs_io_ring_callback_t *callback = op->callback;
+    void *arg = op->arg;
+    /* the operation is freed first, so that the callback may reuse it */
+    op->in_use = false;
+    op->next_free = ring->first_free;
+    ring->first_free = index;
+    --ring->pending;
+    callback(arg, err, result);
+}
+
+#    ifdef HAVE_NATIVE_IO_RING
+static bool native_ops_supported(int ring_fd) {
+    static const uint8_t REQUIRED_OPS[] = {
+        IORING_OP_RECV,       IORING_OP_SEND,       IORING_OP_ACCEPT,
+        IORING_OP_CONNECT,    IORING_OP_READ,       IORING_OP_WRITE,
+        IORING_OP_READ_FIXED, IORING_OP_WRITE_FIXED
+    };
+    const unsigned max_ops = 256;
+    struct io_uring_probe *probe = (struct io_uring_probe *) avs_calloc(
+            1, sizeof(*probe) + max_ops * sizeof(struct io_uring_probe_op));
+    if (!probe) {
+        return false;
+    }
+    bool result = !syscall(__NR_io_uring_register, ring_fd,
+                           IORING_REGISTER_PROBE, probe, max_ops);
+    for (size_t i = 0; result && i < AVS_ARRAY_SIZE(REQUIRED_OPS); ++i) {
+        result = (REQUIRED_OPS[i] < probe->ops_len
+                  && (probe->ops[REQUIRED_OPS[i]].flags
+                      & IO_URING_OP_SUPPORTED));
+    }
+    avs_free(probe);
+    return result;
+}
+
+static void native_cleanup(avs_io_ring_t *ring) {
+    if (ring->sqes) {
+        munmap(ring->sqes, ring->sqes_size);
+        ring->sqes = NULL;
+    }
+    if (ring->rings) {
+        munmap(ring->rings, ring->rings_size);
+        ring->rings = NULL;
+    }
+    if (ring->ring_fd >= 0) {
+        close(ring->ring_fd);
+        ring->ring_fd = -1;
+    }
+    avs_free(ring->buffers);
+    ring->buffers = NULL;
+    ring->buffer_count = 0;
+}
+
+static int native_init(avs_io_ring_t *ring) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    ring->ring_fd = (int) syscall(__NR_io_uring_setup,
+                                  (unsigned) ring->queue_size, &params);
+    if (ring->ring_fd < 0) {
+        LOG(DEBUG, _("io_uring not available: ") "%s", strerror(errno));
+        return -1;
+    }
+    ring->features = params.features;
+    if (!(params.features & IORING_FEAT_SINGLE_MMAP)
+            || !native_ops_supported(ring->ring_fd)) {
+        LOG(DEBUG, _("io_uring does not support all required operations"));
+        native_cleanup(ring);
+        return -1;
+    }
+
+    size_t sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    size_t cq_size = params.cq_off.cqes
+                     + params.cq_entries * sizeof(struct io_uring_cqe);
+    ring->rings_size = AVS_MAX(sq_size, cq_size);
+    void *rings = mmap(NULL, ring->rings_size, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_POPULATE, ring->ring_fd,
+                       IORING_OFF_SQ_RING);
+    if (rings == MAP_FAILED) {
+        LOG(DEBUG, _("could not map io_uring rings: ") "%s", strerror(errno));
+        native_cleanup(ring);
+        return -1;
+    }
+    ring->rings = rings;
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    void *sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ring->ring_fd,
+                      IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        LOG(DEBUG, _("could not map io_uring SQEs: ") "%s", strerror(errno));
+        native_cleanup(ring);
+        return -1;
+    }
+    ring->sqes = (struct io_uring_sqe *) sqes;
+
+    char *base = (char *) rings;
+    ring->sq_tail = (unsigned *) (base + params.sq_off.tail);
+    ring->sq_mask = *(unsigned *) (base + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned *) (base + params.sq_off.array);
+    ring->sq_local_tail = *ring->sq_tail;
+    ring->cq_head = (unsigned *) (base + params.cq_off.head);
+    ring->cq_tail = (unsigned *) (base + params.cq_off.tail);
+    ring->cq_mask = *(unsigned *) (base + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *) (base + params.cq_off.cqes);
+    return 0;
+}
+
+static int find_registered_buffer(avs_io_ring_t *ring,
+                                  const void *buf,
+                                  size_t size) {
+    for (size_t i = 0; i < ring->buffer_count; ++i) {
+        const char *start = (const char *) ring->buffers[i].buf;
+        if ((const char *) buf >= start
+                && (const char *) buf + size
+                               <= start + ring->buffers[i].size) {
+            return (int) i;
+        }
+    }
+    return -1;
+}
+
+static void native_queue(avs_io_ring_t *ring, size_t index) {
+    const io_op_t *op = &ring->ops[index];
+    unsigned sqe_index = ring->sq_local_tail & ring->sq_mask;
+    struct io_uring_sqe *sqe = &ring->sqes[sqe_index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->fd = op->fd;
+    sqe->user_data = index;
+    sqe->addr = (uint64_t) (uintptr_t) op->buf;
+    sqe->len = (uint32_t) op->size;
+    switch (op->type) {
+    case OP_RECV:
+        sqe->opcode = IORING_OP_RECV;
+        break;
+    case OP_SEND:
+        sqe->opcode = IORING_OP_SEND;
+        sqe->msg_flags = MSG_NOSIGNAL;
+        break;
+    case OP_ACCEPT:
+        sqe->opcode = IORING_OP_ACCEPT;
+        break;
+    case OP_CONNECT:
+        sqe->opcode = IORING_OP_CONNECT;
+        sqe->addr = (uint64_t) (uintptr_t) op->endpoint.data.buf;
+        /* the address length is passed in the offset field */
+        sqe->off = op->endpoint.size;
+        break;
+    case OP_READ:
+    case OP_WRITE: {
+        int buf_index = find_registered_buffer(ring, op->buf, op->size);
+        if (buf_index >= 0) {
+            sqe->opcode =
+                    (uint8_t) (op->type == OP_READ ? IORING_OP_READ_FIXED
+                                                   : IORING_OP_WRITE_FIXED);
+            sqe->buf_index = (uint16_t) buf_index;
+        } else {
+            sqe->opcode = (uint8_t) (op->type == OP_READ ? IORING_OP_READ
+                                                         : IORING_OP_WRITE);
+        }
+        sqe->off = op->offset;
+        break;
+    }
+    }
+    ring->sq_array[sqe_index] = sqe_index;
+    ++ring->sq_local_tail;
+    __atomic_store_n(ring->sq_tail, ring->sq_local_tail, __ATOMIC_RELEASE);
+    ++ring->to_submit;
+}
+
+static avs_error_t native_enter(avs_io_ring_t *ring,
+                                unsigned min_complete,
+                                unsigned flags,
+                                const void *arg,
+                                size_t arg_size) {
+    do {
+        int result = (int) syscall(__NR_io_uring_enter, ring->ring_fd,
+                                   ring->to_submit, min_complete, flags, arg,
+                                   arg_size);
+        if (result < 0) {
+            if (errno == EINTR && !min_complete) {
+                continue;
+            }
+            if (errno == ETIME || errno == EINTR) {
+                /* waiting has been interrupted or timed out - the caller
+                 * checks the completion queue anyway */
+                return AVS_OK;
+            }
+            return error_from_errno(errno);
+        }
+        if (result == 0 && !min_complete) {
+            return avs_errno(AVS_EAGAIN);
+        }
+        ring->to_submit -= (unsigned) result;
+    } while (ring->to_submit && !min_complete);
+    return AVS_OK;
+}
+
+static avs_error_t native_submit(avs_io_ring_t *ring) {
+    if (!ring->to_submit) {
+        return AVS_OK;
+    }
+    return native_enter(ring, 0, 0, NULL, 0);
+}
+
+static size_t native_reap(avs_io_ring_t *ring) {
+    size_t count = 0;
+    unsigned head = *ring->cq_head;
+    while (head != __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE)) {
+        const struct io_uring_cqe *cqe = &ring->cqes[head & ring->cq_mask];
+        size_t index = (size_t) cqe->user_data;
+        int32_t res = cqe->res;
+        ++head;
+        __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+        if (res < 0) {
+            complete_op(ring, index, error_from_errno(-res), 0);
+        } else {
+            complete_op(ring, index, AVS_OK, (size_t) res);
+        }
+        ++count;
+    }
+    return count;
+}
+
+static avs_error_t native_wait_with_poll(avs_io_ring_t *ring,
+                                         avs_time_monotonic_t deadline) {
+    avs_error_t err = native_submit(ring);
+    if (avs_is_err(err)) {
+        return err;
+    }
+    /* the io_uring file descriptor becomes readable when completions are
+     * available */
+    struct pollfd pfd;
+    pfd.fd = ring->ring_fd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    if (poll(&pfd, 1, timeout_ms_until(deadline)) < 0 && errno != EINTR) {
+        return error_from_errno(errno);
+    }
+    return AVS_OK;
+}
+
+static avs_error_t native_wait(avs_io_ring_t *ring,
+                               avs_time_monotonic_t deadline) {
+    if (native_reap(ring)) {
+        return AVS_OK;
+    }
+    /* submitting and waiting is done in a single system call if possible */
+    avs_error_t err;
+    if (!avs_time_monotonic_valid(deadline)) {
+        err = native_enter(ring, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+    }
+#        ifdef IORING_FEAT_EXT_ARG
+    else if (ring->features & IORING_FEAT_EXT_ARG) {
+        avs_time_duration_t timeout =
+                avs_time_monotonic_diff(deadline, avs_time_monotonic_now());
+        struct __kernel_timespec ts;
+        memset(&ts, 0, sizeof(ts));
+        if (!avs_time_duration_less(timeout, AVS_TIME_DURATION_ZERO)) {
+            ts.tv_sec = timeout.seconds;
+            ts.tv_nsec = timeout.nanoseconds;
+        }
+        struct io_uring_getevents_arg arg;
+        memset(&arg, 0, sizeof(arg));
+        arg.ts = (uint64_t) (uintptr_t) &ts;
+        err = native_enter(ring, 1,
+                           IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg,
+                           sizeof(arg));
+    }
+#        endif // IORING_FEAT_EXT_ARG
+    else {
+        err = native_wait_with_poll(ring, deadline);
+    }
+    if (avs_is_err(err)) {
+        return err;
+    }
+    if (!native_reap(ring) && avs_time_monotonic_valid(deadline)
+            && !avs_time_monotonic_before(avs_time_monotonic_now(),
+                                          deadline)) {
+        return avs_errno(AVS_ETIMEDOUT);
+    }
+    return AVS_OK;
+}
+#    endif // HAVE_NATIVE_IO_RING
+
+bool avs_io_ring_is_native(const avs_io_ring_t *ring) {
+#    ifdef HAVE_NATIVE_IO_RING
+    return ring->ring_fd >= 0;
+#    else  // HAVE_NATIVE_IO_RING
+    (void) ring;
+    return false;
+#    endif // HAVE_NATIVE_IO_RING
+}
+
+/**
+ * Performs a non-blocking system call for the operation.
+ *
+ * @returns 0 if the operation has completed (successfully or not), or -1 if it
+ *          would block.
+ */
+static int fallback_try_op(io_op_t *op, avs_error_t *out_err,
+                           size_t *out_result) {
+    ssize_t result = -1;
+    switch (op->type) {
+    case OP_RECV:
+        result = recv(op->fd, op->buf, op->size, MSG_DONTWAIT);
+        break;
+    case OP_SEND:
+        result = send(op->fd, op->buf, op->size, MSG_DONTWAIT | MSG_NOSIGNAL);
+        break;
+    case OP_ACCEPT:
+        result = accept(op->fd, NULL, NULL);
+        break;
+    case OP_CONNECT:
+        if (!op->connect_started) {
+            op->connect_started = true;
+            result = connect(op->fd,
+                             (const struct sockaddr *) op->endpoint.data.buf,
+                             op->endpoint.size);
+            if (result < 0 && errno == EINPROGRESS) {
+                return -1;
+            }
+        } else {
+            int error = 0;
+            socklen_t error_size = sizeof(error);
+            if (getsockopt(op->fd, SOL_SOCKET, SO_ERROR, &error,
+                           &error_size)) {
+                error = errno;
+            }
+            errno = error;
+            result = error ? -1 : 0;
+        }
+        break;
+    case OP_READ:
+        result = pread(op->fd, op->buf, op->size, (off_t) op->offset);
+        break;
+    case OP_WRITE:
+        result = pwrite(op->fd, op->buf, op->size, (off_t) op->offset);
+        break;
+    }
+    if (result < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+            return -1;
+        }
+        *out_err = error_from_errno(errno);
+        *out_result = 0;
+    } else {
+        *out_err = AVS_OK;
+        *out_result = (size_t) result;
+    }
+    return 0;
+}
+
+static short fallback_poll_events(const io_op_t *op) {
+    switch (op->type) {
+    case OP_SEND:
+    case OP_CONNECT:
+        return POLLOUT;
+    case OP_RECV:
+    case OP_ACCEPT:
+        return POLLIN;
+    case OP_READ:
+    case OP_WRITE:
+        break;
+    }
+    return 0;
+}
+
+static size_t fallback_process(avs_io_ring_t *ring, size_t count) {
+    size_t completed = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (ring->pollfds[i].fd >= 0 && !ring->pollfds[i].revents) {
+            continue;
+        }
+        avs_error_t err;
+        size_t result;
+        if (!fallback_try_op(&ring->ops[ring->poll_ops[i]], &err, &result)) {
+            complete_op(ring, ring->poll_ops[i], err, result);
+            ++completed;
+        }
+    }
+    return completed;
+}
+
+static avs_error_t fallback_wait(avs_io_ring_t *ring,
+                                 avs_time_monotonic_t deadline) {
+    /* file operations and connect() calls that have not been attempted yet
+     * are performed right away */
+    size_t count = 0;
+    for (size_t i = 0; i < ring->queue_size; ++i) {
+        const io_op_t *op = &ring->ops[i];
+        if (op->in_use
+                && (!fallback_poll_events(op)
+                    || (op->type == OP_CONNECT && !op->connect_started))) {
+            ring->pollfds[count].fd = -1;
+            ring->poll_ops[count++] = i;
+        }
+    }
+    if (fallback_process(ring, count)) {
+        return AVS_OK;
+    }
+
+    count = 0;
+    for (size_t i = 0; i < ring->queue_size; ++i) {
+        const io_op_t *op = &ring->ops[i];
+        if (op->in_use && fallback_poll_events(op)) {
+            ring->pollfds[count].fd = op->fd;
+            ring->pollfds[count].events = fallback_poll_events(op);
+            ring->pollfds[count].revents = 0;
+            ring->poll_ops[count++] = i;
+        }
+    }
+    if (!count) {
+        return AVS_OK;
+    }
+    int result =
+            poll(ring->pollfds, (nfds_t) count, timeout_ms_until(deadline));
+    if (result < 0) {
+        return errno == EINTR ? AVS_OK : error_from_errno(errno);
+    }
+    if (!fallback_process(ring, count) && result == 0) {
+        return avs_errno(AVS_ETIMEDOUT);
+    }
+    return AVS_OK;
+}
+
+avs_error_t avs_io_ring_create(avs_io_ring_t **out_ring,
+                               const avs_io_ring_config_t *config) {
+    assert(out_ring && !*out_ring);
+    size_t queue_size = DEFAULT_QUEUE_SIZE;
+    if (config && config->queue_size) {
+        queue_size = config->queue_size;
+    }
+    if (queue_size > MAX_QUEUE_SIZE) {
+        return avs_errno(AVS_EINVAL);
+    }
+    avs_io_ring_t *ring = (avs_io_ring_t *) avs_calloc(1, sizeof(*ring));
+    if (!ring) {
+        LOG(ERROR, _("out of memory"));
+        return avs_errno(AVS_ENOMEM);
+    }
+    ring->queue_size = queue_size;
+    ring->ops = (io_op_t *) avs_calloc(queue_size, sizeof(*ring->ops));
+    if (!ring->ops) {
+        LOG(ERROR, _("out of memory"));
+        avs_free(ring);
+        return avs_errno(AVS_ENOMEM);
+    }
+    for (size_t i = 0; i < queue_size; ++i) {
+        ring->ops[i].next_free = (i + 1 < queue_size ? i + 1 : NO_FREE_OPS);
+    }
+
+#    ifdef HAVE_NATIVE_IO_RING
+    ring->ring_fd = -1;
+    if ((!config || !config->disable_io_uring) && !native_init(ring)) {
+        *out_ring = ring;
+        return AVS_OK;
+    }
+#    endif // HAVE_NATIVE_IO_RING
+
+    ring->pollfds =
+            (struct pollfd *) avs_calloc(queue_size, sizeof(*ring->pollfds));
+    ring->poll_ops = (size_t *) avs_calloc(queue_size, sizeof(*ring->poll_ops));
+    if (!ring->pollfds || !ring->poll_ops) {
+        LOG(ERROR, _("out of memory"));
+        avs_io_ring_cleanup(&ring);
+        return avs_errno(AVS_ENOMEM);
+    }
+    *out_ring = ring;
+    return AVS_OK;
+}
+
+void avs_io_ring_cleanup(avs_io_ring_t **ring_ptr) {
+    if (!*ring_ptr) {
+        return;
+    }
+#    ifdef HAVE_NATIVE_IO_RING
+    native_cleanup(*ring_ptr);
+#    endif // HAVE_NATIVE_IO_RING
+    avs_free((*ring_ptr)->pollfds);
+    avs_free((*ring_ptr)->poll_ops);
+    avs_free((*ring_ptr)->ops);
+    avs_free(*ring_ptr);
+    *ring_ptr = NULL;
+}
+
+size_t avs_io_ring_pending(const avs_io_ring_t *ring) {
+    return ring->pending;
+}
+
+avs_error_t avs_io_ring_register_buffers(avs_io_ring_t *ring,
+                                         const avs_io_ring_buffer_t *buffers,
+                                         size_t buffer_count) {
+    if (ring->pending) {
+        return avs_errno(AVS_EBUSY);
+    }
+#    ifdef HAVE_NATIVE_IO_RING
+    if (!avs_io_ring_is_native(ring)) {
+        return AVS_OK;
+    }
+    if (ring->buffer_count) {
+        syscall(__NR_io_uring_register, ring->ring_fd,
+                IORING_UNREGISTER_BUFFERS, NULL, 0);
+        avs_free(ring->buffers);
+        ring->buffers = NULL;
+        ring->buffer_count = 0;
+    }
+    if (!buffer_count) {
+        return AVS_OK;
+    }
+    if (buffer_count > UINT16_MAX) {
+        return avs_errno(AVS_EINVAL);
+    }
+    struct iovec *iov =
+            (struct iovec *) avs_calloc(buffer_count, sizeof(*iov));
+    ring->buffers = (avs_io_ring_buffer_t *) avs_calloc(
+            buffer_count, sizeof(*ring->buffers));
+    if (!iov || !ring->buffers) {
+        avs_free(iov);
+        avs_free(ring->buffers);
+        ring->buffers = NULL;
+        return avs_errno(AVS_ENOMEM);
+    }
+    for (size_t i = 0; i < buffer_count; ++i) {
+        iov[i].iov_base = buffers[i].buf;
+        iov[i].iov_len = buffers[i].size;
+        ring->buffers[i] = buffers[i];
+    }
+    avs_error_t err = AVS_OK;
+    if (syscall(__NR_io_uring_register, ring->ring_fd, IORING_REGISTER_BUFFERS,
+                iov, (unsigned) buffer_count)) {
+        err = error_from_errno(errno);
+        LOG(DEBUG, _("could not register buffers: ") "%s", strerror(errno));
+        avs_free(ring->buffers);
+        ring->buffers = NULL;
+    } else {
+        ring->buffer_count = buffer_count;
+    }
+    avs_free(iov);
+    return err;
+#    else  // HAVE_NATIVE_IO_RING
+    (void) buffers;
+    (void) buffer_count;
+    return AVS_OK;
+#    endif // HAVE_NATIVE_IO_RING
+}
+
+static avs_error_t queue_op(avs_io_ring_t *ring,
+                            io_op_type_t type,
+                            int fd,
+                            void *buf,
+                            size_t size,
+                            uint64_t offset,
+                            const avs_net_resolved_endpoint_t *endpoint,
+                            avs_io_ring_callback_t *callback,
+                            void *arg) {
+    assert(callback);
+    if (ring->first_free == NO_FREE_OPS) {
+        return avs_errno(AVS_ENOBUFS);
+    }
+    if (size > UINT32_MAX) {
+        /* a single io_uring operation transfers at most 4 GB */
+        size = UINT32_MAX;
+    }
+    size_t index = ring->first_free;
+    io_op_t *op = &ring->ops[index];
+    ring->first_free = op->next_free;
+    ++ring->pending;
+
+    op->in_use = true;
+    op->type = type;
+    op->fd = fd;
+    op->buf = buf;
+    op->size = size;
+    op->offset = offset;
+    if (endpoint) {
+        op->endpoint = *endpoint;
+    }
+    op->callback = callback;
+    op->arg = arg;
+    op->connect_started = false;
+#    ifdef HAVE_NATIVE_IO_RING
+    if (avs_io_ring_is_native(ring)) {
+        native_queue(ring, index);
+    }
+#    endif // HAVE_NATIVE_IO_RING
+    return AVS_OK;
+}
+
+avs_error_t avs_io_ring_recv(avs_io_ring_t *ring,
+                             int fd,
+                             void *buf,
+                             size_t size,
+                             avs_io_ring_callback_t *callback,
+                             void *arg) {
+    return queue_op(ring, OP_RECV, fd, buf, size, 0, NULL, callback, arg);
+}
+
+avs_error_t avs_io_ring_send(avs_io_ring_t *ring,
+                             int fd,
+                             const void *buf,
+                             size_t size,
+                             avs_io_ring_callback_t *callback,
+                             void *arg) {
+    return queue_op(ring, OP_SEND, fd, (void *) (intptr_t) buf, size, 0, NULL,
+                    callback, arg);
+}
+
+avs_error_t avs_io_ring_accept(avs_io_ring_t *ring,
+                               int fd,
+                               avs_io_ring_callback_t *callback,
+                               void *arg) {
+    return queue_op(ring, OP_ACCEPT, fd, NULL, 0, 0, NULL, callback, arg);
+}
+
+avs_error_t avs_io_ring_connect(avs_io_ring_t *ring,
+                                int fd,
+                                const avs_net_resolved_endpoint_t *endpoint,
+                                avs_io_ring_callback_t *callback,
+                                void *arg) {
+    if (!endpoint || !endpoint->size) {
+        return avs_errno(AVS_EINVAL);
+    }
+    return queue_op(ring, OP_CONNECT, fd, NULL, 0, 0, endpoint, callback, arg);
+}
+
+avs_error_t avs_io_ring_read(avs_io_ring_t *ring,
+                             int fd,
+                             void *buf,
+                             size_t size,
+                             uint64_t offset,
+                             avs_io_ring_callback_t *callback,
+                             void *arg) {
+    return queue_op(ring, OP_READ, fd, buf, size, offset, NULL, callback, arg);
+}
+
+avs_error_t avs_io_ring_write(avs_io_ring_t *ring,
+                              int fd,
+                              const void *buf,
+                              size_t size,
+                              uint64_t offset,
+                              avs_io_ring_callback_t *callback,
+                              void *arg) {
+    return queue_op(ring, OP_WRITE, fd, (void *) (intptr_t) buf, size, offset,
+                    NULL, callback, arg);
+}
+
+avs_error_t avs_io_ring_submit(avs_io_ring_t *ring) {
+#    ifdef HAVE_NATIVE_IO_RING
+    if (avs_io_ring_is_native(ring)) {
+        return native_submit(ring);
+    }
+#    endif // HAVE_NATIVE_IO_RING
+    (void) ring;
+    return AVS_OK;
+}
+
+avs_error_t avs_io_ring_wait(avs_io_ring_t *ring,
+                             avs_time_monotonic_t deadline) {
+    if (!ring->pending) {
+        return AVS_OK;
+    }
+#    ifdef HAVE_NATIVE_IO_RING
+    if (avs_io_ring_is_native(ring)) {
+        return native_wait(ring, deadline);
+    }
+#    endif // HAVE_NATIVE_IO_RING
+    return fallback_wait(ring, deadline);
+}
+
+#endif // defined(AVS_COMMONS_WITH_AVS_NET) &&
+       // defined(AVS_COMMONS_NET_WITH_POSIX_AVS_SOCKET) &&
+       // defined(AVS_COMMONS_NET_WITH_IO_RING)
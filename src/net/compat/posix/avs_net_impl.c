@@ -15,6 +15,9 @@
  */
 
 #define _AVS_NEED_POSIX_SOCKET
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#    define _GNU_SOURCE // for struct ucred
+#endif
 
 #include <avsystem/commons/avs_commons_config.h>
 
@@ -43,6 +46,10 @@
 
 #    include "avs_compat.h"
 
+#    ifdef AVS_COMMONS_NET_WITH_PATH_MTU_DISCOVERY
+#        include "../../avs_net_pmtud.h"
+#    endif // AVS_COMMONS_NET_WITH_PATH_MTU_DISCOVERY
+
 VISIBILITY_SOURCE_BEGIN
 
 #    ifndef INET_ADDRSTRLEN
@@ -61,6 +68,26 @@ VISIBILITY_SOURCE_BEGIN
 #        define IPV6_AVAILABLE 0
 #    endif
 
+#    if defined(MCAST_JOIN_GROUP) \
+            && (defined(AVS_COMMONS_NET_WITH_IPV4) \
+                || defined(AVS_COMMONS_NET_WITH_IPV6))
+#        define HAVE_MULTICAST
+#    endif
+
+#    if defined(AVS_COMMONS_NET_WITH_IPV4) && defined(IP_PKTINFO)
+#        define HAVE_IPV4_PACKET_INFO
+#    endif
+
+#    if defined(AVS_COMMONS_NET_WITH_IPV6) && defined(IPV6_RECVPKTINFO)
+#        define HAVE_IPV6_PACKET_INFO
+#    endif
+
+#    if defined(AVS_COMMONS_NET_POSIX_AVS_SOCKET_HAVE_RECVMSG) \
+            && (defined(HAVE_IPV4_PACKET_INFO) \
+                || defined(HAVE_IPV6_PACKET_INFO))
+#        define HAVE_PACKET_INFO
+#    endif
+
 static const avs_time_duration_t NET_SEND_TIMEOUT = { 30, 0 };
 static const avs_time_duration_t NET_CONNECT_TIMEOUT = { 10, 0 };
 static const avs_time_duration_t NET_ACCEPT_TIMEOUT = { 5, 0 };
@@ -84,6 +111,10 @@ typedef union {
 #    ifdef AVS_COMMONS_NET_WITH_IPV6
     struct sockaddr_in6 addr_in6;
 #    endif /* AVS_COMMONS_NET_WITH_IPV6 */
+
+#    ifdef AVS_COMMONS_NET_WITH_UNIX_SOCKETS
+    struct sockaddr_un addr_un;
+#    endif /* AVS_COMMONS_NET_WITH_UNIX_SOCKETS */
 } sockaddr_union_t;
 
 /**
@@ -220,6 +251,18 @@ static const avs_net_socket_v_table_t net_vtable = {
     .set_opt = set_opt_net
 };
 
+#    ifdef HAVE_PACKET_INFO
+/**
+ * Local addressing information of a datagram, in the system format. Either
+ * part may be unset - <c>local_addr.addr.sa_family</c> is <c>AF_UNSPEC</c> or
+ * <c>interface_index</c> is 0, respectively.
+ */
+typedef struct {
+    sockaddr_union_t local_addr;
+    unsigned interface_index;
+} packet_info_t;
+#    endif // HAVE_PACKET_INFO
+
 typedef struct {
     const avs_net_socket_v_table_t *const operations;
     sockfd_t socket;
@@ -233,6 +276,19 @@ typedef struct {
     uint64_t bytes_sent;
 
     avs_time_duration_t recv_timeout;
+
+#    ifdef HAVE_PACKET_INFO
+    bool recv_packet_info;
+    packet_info_t last_packet_info;
+    packet_info_t send_packet_info;
+#    endif // HAVE_PACKET_INFO
+
+#    ifdef AVS_COMMONS_NET_WITH_PATH_MTU_DISCOVERY
+    bool pmtud_active;
+    _avs_net_pmtud_t pmtud;
+    /* remote address with the port zeroed, used as the path MTU cache key */
+    avs_net_resolved_endpoint_t pmtud_destination;
+#    endif // AVS_COMMONS_NET_WITH_PATH_MTU_DISCOVERY
 } net_socket_impl_t;
 
 #    if defined(AVS_COMMONS_NET_WITH_IPV4) && defined(AVS_COMMONS_NET_WITH_IPV6)
@@ -279,6 +335,11 @@ static const char *get_af_name(avs_net_af_t af) {
         return "AF_INET6";
 #    endif /* AVS_COMMONS_NET_WITH_IPV6 */
 
+#    ifdef AVS_COMMONS_NET_WITH_UNIX_SOCKETS
+    case AVS_NET_AF_UNIX:
+        return "AF_UNIX";
+#    endif /* AVS_COMMONS_NET_WITH_UNIX_SOCKETS */
+
     case AVS_NET_AF_UNSPEC:
     default:
         return "AF_UNSPEC";
@@ -293,11 +354,51 @@ static avs_error_t failure_from_errno(void) {
     return avs_errno(err);
 }
 
-static avs_error_t
-get_string_ip(const sockaddr_union_t *addr, char *buffer, size_t buffer_size) {
+#    ifdef AVS_COMMONS_NET_WITH_UNIX_SOCKETS
+/**
+ * Converts a Unix domain socket address to the textual form accepted by
+ * avs_net_addrinfo_resolve_ex(): filesystem paths are returned as-is, abstract
+ * addresses are prefixed with '@' and unnamed sockets yield an empty string.
+ */
+static avs_error_t get_string_unix_path(const struct sockaddr_un *addr,
+                                        socklen_t addrlen,
+                                        char *buffer,
+                                        size_t buffer_size) {
+    size_t path_length = 0;
+    if ((size_t) addrlen > offsetof(struct sockaddr_un, sun_path)) {
+        path_length = AVS_MIN((size_t) addrlen
+                                      - offsetof(struct sockaddr_un, sun_path),
+                              sizeof(addr->sun_path));
+    }
+    const char *prefix = "";
+    const char *path = addr->sun_path;
+    if (path_length && !path[0]) {
+        prefix = "@";
+        ++path;
+        --path_length;
+    } else {
+        const char *terminator = (const char *) memchr(path, '\0', path_length);
+        if (terminator) {
+            path_length = (size_t) (terminator - path);
+        }
+    }
+    if (avs_simple_snprintf(buffer, buffer_size, "%s%.*s", prefix,
+                            (int) path_length, path)
+            < 0) {
+        return avs_errno(AVS_ERANGE);
+    }
+    return AVS_OK;
+}
+#    endif /* AVS_COMMONS_NET_WITH_UNIX_SOCKETS */
+
+static avs_error_t get_string_ip(const sockaddr_union_t *addr,
+                                 socklen_t sockaddr_length,
+                                 char *buffer,
+                                 size_t buffer_size) {
     const void *addr_data;
     socklen_t addrlen;
 
+    (void) sockaddr_length;
     switch (addr->addr.sa_family) {
 #    ifdef AVS_COMMONS_NET_WITH_IPV4
     case AF_INET:
@@ -313,6 +414,12 @@ get_string_ip(const sockaddr_union_t *addr, char *buffer, size_t buffer_size) {
         break;
 #    endif /* AVS_COMMONS_NET_WITH_IPV6 */
 
+#    ifdef AVS_COMMONS_NET_WITH_UNIX_SOCKETS
+    case AF_UNIX:
+        return get_string_unix_path(&addr->addr_un, sockaddr_length, buffer,
+                                    buffer_size);
+#    endif /* AVS_COMMONS_NET_WITH_UNIX_SOCKETS */
+
     default:
         return avs_errno(AVS_ERANGE);
     }
@@ -344,6 +451,12 @@ static int get_string_port(const sockaddr_union_t *addr,
         break;
 #    endif /* AVS_COMMONS_NET_WITH_IPV6 */
 
+#    ifdef AVS_COMMONS_NET_WITH_UNIX_SOCKETS
+    case AF_UNIX:
+        /* Unix domain sockets have no concept of ports */
+        return avs_simple_snprintf(buffer, buffer_size, "%s", "") < 0 ? -1 : 0;
+#    endif /* AVS_COMMONS_NET_WITH_UNIX_SOCKETS */
+
     default:
         return -1;
     }
@@ -362,7 +475,7 @@ static avs_error_t remote_host_net(avs_net_socket_t *socket,
     errno = 0;
     if (!getpeername(net_socket->socket, &addr.addr, &addrlen)) {
         (void) unmap_v4mapped(&addr);
-        return get_string_ip(&addr, out_buffer, out_buffer_size);
+        return get_string_ip(&addr, addrlen, out_buffer, out_buffer_size);
     } else {
         return failure_from_errno();
     }
@@ -419,6 +532,16 @@ static void close_net_raw(net_socket_impl_t *net_socket) {
     }
     net_socket->remote_hostname[0] = '\0';
     net_socket->remote_port[0] = '\0';
+#    ifdef HAVE_PACKET_INFO
+    net_socket->recv_packet_info = false;
+    memset(&net_socket->last_packet_info, 0,
+           sizeof(net_socket->last_packet_info));
+    memset(&net_socket->send_packet_info, 0,
+           sizeof(net_socket->send_packet_info));
+#    endif // HAVE_PACKET_INFO
+#    ifdef AVS_COMMONS_NET_WITH_PATH_MTU_DISCOVERY
+    net_socket->pmtud_active = false;
+#    endif // AVS_COMMONS_NET_WITH_PATH_MTU_DISCOVERY
 }
 
 static avs_error_t close_net(avs_net_socket_t *net_socket_) {
@@ -485,6 +608,193 @@ static sa_family_t get_connection_family(sockfd_t fd) {
 #        define IPV6_TRANSPARENT 75
 #    endif
 
+#    ifdef AVS_COMMONS_NET_WITH_PATH_MTU_DISCOVERY
+#        ifdef AVS_COMMONS_NET_WITH_IPV4
+static int set_ipv4_dont_fragment(sockfd_t fd) {
+#            if defined(IP_MTU_DISCOVER) && defined(IP_PMTUDISC_PROBE)
+    int value = IP_PMTUDISC_PROBE;
+    return setsockopt(fd, IPPROTO_IP, IP_MTU_DISCOVER, &value, sizeof(value));
+#            elif defined(IP_MTU_DISCOVER)
+    int value = IP_PMTUDISC_DO;
+    return setsockopt(fd, IPPROTO_IP, IP_MTU_DISCOVER, &value, sizeof(value));
+#            elif defined(IP_DONTFRAG)
+    int value = 1;
+    return setsockopt(fd, IPPROTO_IP, IP_DONTFRAG, &value, sizeof(value));
+#            else
+    (void) fd;
+    errno = ENOTSUP;
+    return -1;
+#            endif
+}
+#        endif // AVS_COMMONS_NET_WITH_IPV4
+
+#        ifdef AVS_COMMONS_NET_WITH_IPV6
+static int set_ipv6_dont_fragment(sockfd_t fd) {
+#            if defined(IPV6_MTU_DISCOVER) && defined(IPV6_PMTUDISC_PROBE)
+    int value = IPV6_PMTUDISC_PROBE;
+    return setsockopt(fd, IPPROTO_IPV6, IPV6_MTU_DISCOVER, &value,
+                      sizeof(value));
+#            elif defined(IPV6_MTU_DISCOVER)
+    int value = IPV6_PMTUDISC_DO;
+    return setsockopt(fd, IPPROTO_IPV6, IPV6_MTU_DISCOVER, &value,
+                      sizeof(value));
+#            elif defined(IPV6_DONTFRAG)
+    int value = 1;
+    return setsockopt(fd, IPPROTO_IPV6, IPV6_DONTFRAG, &value, sizeof(value));
+#            else
+    (void) fd;
+    errno = ENOTSUP;
+    return -1;
+#            endif
+}
+#        endif // AVS_COMMONS_NET_WITH_IPV6
+
+/**
+ * Sets the Don't Fragment bit on all packets sent through the socket. Where
+ * possible (i.e. on Linux), the system's own path MTU estimate is not enforced
+ * on sent packets, so that probes larger than it can be sent, as recommended by
+ * RFC 8899, section 6.1.1. Packets larger than the interface MTU are still
+ * rejected with EMSGSIZE.
+ */
+static avs_error_t set_dont_fragment(sockfd_t fd) {
+    int retval = 0;
+    switch (get_socket_family(fd)) {
+#        ifdef AVS_COMMONS_NET_WITH_IPV4
+    case AF_INET:
+        retval = set_ipv4_dont_fragment(fd);
+        break;
+#        endif // AVS_COMMONS_NET_WITH_IPV4
+
+#        ifdef AVS_COMMONS_NET_WITH_IPV6
+    case AF_INET6:
+        retval = set_ipv6_dont_fragment(fd);
+#            ifdef AVS_COMMONS_NET_WITH_IPV4
+        if (!retval) {
+            /* for IPv4-mapped addresses; not supported on all systems */
+            (void) set_ipv4_dont_fragment(fd);
+        }
+#            endif // AVS_COMMONS_NET_WITH_IPV4
+        break;
+#        endif // AVS_COMMONS_NET_WITH_IPV6
+
+    default:
+        /* not applicable to e.g. Unix domain sockets */
+        break;
+    }
+    return retval ? failure_from_errno() : AVS_OK;
+}
+#    endif // AVS_COMMONS_NET_WITH_PATH_MTU_DISCOVERY
+
+/* converts the duration to an int number of units, rounding up */
+static int duration_to_int_ceil(avs_time_duration_t duration,
+                                avs_time_unit_t unit) {
+    int64_t value;
+    if (avs_time_duration_to_scalar(&value, unit, duration)) {
+        return INT_MAX;
+    }
+    if (avs_time_duration_less(avs_time_duration_from_scalar(value, unit),
+                               duration)) {
+        ++value;
+    }
+    return value > INT_MAX ? INT_MAX : (int) value;
+}
+
+static avs_error_t set_int_sockopt(sockfd_t fd, int level, int name,
+                                   int value, const char *name_str) {
+    if (setsockopt(fd, level, name, &value, sizeof(value))) {
+        avs_error_t err = failure_from_errno();
+        LOG(ERROR, _("could not set ") "%s" _(": ") "%s", name_str,
+            avs_strerror((avs_errno_t) err.code));
+        return err;
+    }
+    return AVS_OK;
+}
+
+static inline avs_error_t set_tcp_duration_sockopt(sockfd_t fd,
+                                                   int name,
+                                                   avs_time_duration_t value,
+                                                   avs_time_unit_t unit,
+                                                   const char *name_str) {
+    return set_int_sockopt(fd, IPPROTO_TCP, name,
+                           duration_to_int_ceil(value, unit), name_str);
+}
+
+static inline avs_error_t option_not_supported(const char *name_str) {
+    LOG(ERROR, "%s" _(" is not supported on this system"), name_str);
+    return avs_errno(AVS_ENOTSUP);
+}
+
+#    if defined(TCP_KEEPIDLE)
+#        define AVS_TCP_KEEPIDLE TCP_KEEPIDLE
+#    elif defined(TCP_KEEPALIVE)
+// macOS name for the same option
+#        define AVS_TCP_KEEPIDLE TCP_KEEPALIVE
+#    endif
+
+static avs_error_t configure_tcp_keepalive(net_socket_impl_t *net_socket) {
+#    ifdef AVS_COMMONS_NET_WITH_UNIX_SOCKETS
+    if (get_socket_family(net_socket->socket) == AF_UNIX) {
+        /* not applicable to Unix domain sockets */
+        return AVS_OK;
+    }
+#    endif // AVS_COMMONS_NET_WITH_UNIX_SOCKETS
+    const avs_net_tcp_keepalive_t *keepalive =
+            &net_socket->configuration.tcp_keepalive;
+    avs_error_t err = AVS_OK;
+    if (keepalive->enabled) {
+        err = set_int_sockopt(net_socket->socket, SOL_SOCKET, SO_KEEPALIVE, 1,
+                              "SO_KEEPALIVE");
+        if (avs_is_ok(err)
+                && avs_time_duration_less(AVS_TIME_DURATION_ZERO,
+                                          keepalive->idle)) {
+#    ifdef AVS_TCP_KEEPIDLE
+            err = set_tcp_duration_sockopt(net_socket->socket,
+                                           AVS_TCP_KEEPIDLE, keepalive->idle,
+                                           AVS_TIME_S, "TCP_KEEPIDLE");
+#    else  // AVS_TCP_KEEPIDLE
+            err = option_not_supported("TCP_KEEPIDLE");
+#    endif // AVS_TCP_KEEPIDLE
+        }
+        if (avs_is_ok(err)
+                && avs_time_duration_less(AVS_TIME_DURATION_ZERO,
+                                          keepalive->interval)) {
+#    ifdef TCP_KEEPINTVL
+            err = set_tcp_duration_sockopt(net_socket->socket, TCP_KEEPINTVL,
+                                           keepalive->interval, AVS_TIME_S,
+                                           "TCP_KEEPINTVL");
+#    else  // TCP_KEEPINTVL
+            err = option_not_supported("TCP_KEEPINTVL");
+#    endif // TCP_KEEPINTVL
+        }
+        if (avs_is_ok(err) && keepalive->probe_count) {
+#    ifdef TCP_KEEPCNT
+            err = set_int_sockopt(
+                    net_socket->socket, IPPROTO_TCP, TCP_KEEPCNT,
+                    keepalive->probe_count > INT_MAX
+                            ? INT_MAX
+                            : (int) keepalive->probe_count,
+                    "TCP_KEEPCNT");
+#    else  // TCP_KEEPCNT
+            err = option_not_supported("TCP_KEEPCNT");
+#    endif // TCP_KEEPCNT
+        }
+    }
+    if (avs_is_ok(err)
+            && avs_time_duration_less(
+                       AVS_TIME_DURATION_ZERO,
+                       net_socket->configuration.tcp_user_timeout)) {
+#    ifdef TCP_USER_TIMEOUT
+        err = set_tcp_duration_sockopt(
+                net_socket->socket, TCP_USER_TIMEOUT,
+                net_socket->configuration.tcp_user_timeout, AVS_TIME_MS,
+                "TCP_USER_TIMEOUT");
+#    else  // TCP_USER_TIMEOUT
+        err = option_not_supported("TCP_USER_TIMEOUT");
+#    endif // TCP_USER_TIMEOUT
+    }
+    return err;
+}
+
 static avs_error_t configure_socket(net_socket_impl_t *net_socket) {
     errno = 0;
     LOG(TRACE, _("configuration '") "%s" _("' 0x") "%02x" _(" 0x") "%02x",
@@ -573,6 +883,23 @@ static avs_error_t configure_socket(net_socket_impl_t *net_socket) {
             return failure_from_errno();
         }
     }
+    if (net_socket->type == AVS_NET_TCP_SOCKET) {
+        avs_error_t err = configure_tcp_keepalive(net_socket);
+        if (avs_is_err(err)) {
+            return err;
+        }
+    }
+#    ifdef AVS_COMMONS_NET_WITH_PATH_MTU_DISCOVERY
+    if (net_socket->configuration.path_mtu_discovery
+            && net_socket->type == AVS_NET_UDP_SOCKET) {
+        avs_error_t err = set_dont_fragment(net_socket->socket);
+        if (avs_is_err(err)) {
+            LOG(ERROR, _("could not set the Don't Fragment bit: ") "%s",
+                avs_strerror((avs_errno_t) err.code));
+            return err;
+        }
+    }
+#    endif // AVS_COMMONS_NET_WITH_PATH_MTU_DISCOVERY
 
     return AVS_OK;
 }
@@ -888,6 +1215,16 @@ static avs_error_t host_port_to_string(const struct sockaddr *sa,
                                        socklen_t hostlen,
                                        char *serv,
                                        socklen_t servlen) {
+#    ifdef AVS_COMMONS_NET_WITH_UNIX_SOCKETS
+    if (sa->sa_family == AF_UNIX) {
+        if (serv && servlen) {
+            serv[0] = '\0';
+        }
+        return host ? get_string_unix_path((const struct sockaddr_un *) sa,
+                                           salen, host, (size_t) hostlen)
+                    : AVS_OK;
+    }
+#    endif /* AVS_COMMONS_NET_WITH_UNIX_SOCKETS */
     avs_error_t err =
             host_port_to_string_impl(sa, salen, host, hostlen, serv, servlen);
     if (avs_is_ok(err) && host) {
@@ -909,7 +1246,14 @@ int _avs_net_get_socket_type(avs_net_socket_type_t socket_type) {
     }
 }
 
-static int get_socket_proto(avs_net_socket_type_t socket_type) {
+static int get_socket_proto(int family, avs_net_socket_type_t socket_type) {
+#    ifdef AVS_COMMONS_NET_WITH_UNIX_SOCKETS
+    if (family == AF_UNIX) {
+        return 0;
+    }
+#    else  /* AVS_COMMONS_NET_WITH_UNIX_SOCKETS */
+    (void) family;
+#    endif /* AVS_COMMONS_NET_WITH_UNIX_SOCKETS */
     switch (socket_type) {
     case AVS_NET_TCP_SOCKET:
     case AVS_NET_SSL_SOCKET:
@@ -934,6 +1278,11 @@ static avs_net_af_t get_avs_af(int af) {
         return AVS_NET_AF_INET6;
 #    endif /* AVS_COMMONS_NET_WITH_IPV6 */
 
+#    ifdef AVS_COMMONS_NET_WITH_UNIX_SOCKETS
+    case AF_UNIX:
+        return AVS_NET_AF_UNIX;
+#    endif /* AVS_COMMONS_NET_WITH_UNIX_SOCKETS */
+
     default:
         return AVS_NET_AF_UNSPEC;
     }
@@ -1058,12 +1407,12 @@ try_connect_open_socket(net_socket_impl_t *net_socket,
 static avs_error_t try_connect(net_socket_impl_t *net_socket,
                                const sockaddr_endpoint_union_t *address) {
     char socket_was_already_open = (net_socket->socket != INVALID_SOCKET);
+    int family = address->sockaddr_ep.addr.sa_family;
     avs_error_t err = AVS_OK;
     if (!socket_was_already_open) {
         if ((net_socket->socket =
-                     socket(address->sockaddr_ep.addr.sa_family,
-                            _avs_net_get_socket_type(net_socket->type),
-                            get_socket_proto(net_socket->type)))
+                     socket(family, _avs_net_get_socket_type(net_socket->type),
+                            get_socket_proto(family, net_socket->type)))
                 == INVALID_SOCKET) {
             err = failure_from_errno();
             LOG(ERROR, _("cannot create socket: ") "%s",
@@ -1128,6 +1477,206 @@ static avs_error_t connect_impl(net_socket_impl_t *net_socket,
     return err;
 }
 
+static avs_error_t get_system_mtu(net_socket_impl_t *net_socket,
+                                  int *out_mtu) {
+    int mtu = -1;
+    avs_error_t err = AVS_OK;
+    socklen_t dummy = sizeof(mtu);
+    switch (get_socket_family(net_socket->socket)) {
+#    if defined(AVS_COMMONS_NET_WITH_IPV4) && defined(IP_MTU)
+    case AF_INET:
+        errno = 0;
+        if (getsockopt(net_socket->socket, IPPROTO_IP, IP_MTU, &mtu, &dummy)
+                < 0) {
+            err = failure_from_errno();
+        }
+        break;
+#    endif /* defined(AVS_COMMONS_NET_WITH_IPV4) && defined(IP_MTU) */
+
+#    if defined(AVS_COMMONS_NET_WITH_IPV6) && defined(IPV6_MTU)
+    case AF_INET6:
+        errno = 0;
+        if (getsockopt(net_socket->socket, IPPROTO_IPV6, IPV6_MTU, &mtu, &dummy)
+                < 0) {
+            err = failure_from_errno();
+        }
+        break;
+#    endif /* defined(AVS_COMMONS_NET_WITH_IPV6) && defined(IPV6_MTU) */
+
+    default:
+        (void) dummy;
+        err = avs_errno(AVS_EINVAL);
+    }
+    if (avs_is_ok(err)) {
+        if (mtu >= 0) {
+            *out_mtu = mtu;
+        } else {
+            err = avs_errno(AVS_UNKNOWN_ERROR);
+        }
+    }
+    return err;
+}
+
+static avs_error_t get_udp_overhead(net_socket_impl_t *net_socket, int *out) {
+    switch (get_socket_family(net_socket->socket)) {
+#    ifdef AVS_COMMONS_NET_WITH_IPV4
+    case AF_INET:
+        *out = 28; /* 20 for IP + 8 for UDP */
+        return AVS_OK;
+#    endif /* AVS_COMMONS_NET_WITH_IPV4 */
+
+#    ifdef AVS_COMMONS_NET_WITH_IPV6
+    case AF_INET6:
+        *out = 48; /* 40 for IPv6 + 8 for UDP */
+        return AVS_OK;
+#    endif /* AVS_COMMONS_NET_WITH_IPV6 */
+
+    default:
+        return avs_errno(AVS_EINVAL);
+    }
+}
+
+#    ifdef AVS_COMMONS_NET_WITH_PATH_MTU_DISCOVERY
+/**
+ * Stores the remote address of a connected IP socket, with the port zeroed, in
+ * @p out. Returns false for sockets of other families.
+ */
+static bool get_pmtud_destination(sockfd_t fd,
+                                  avs_net_resolved_endpoint_t *out) {
+    sockaddr_union_t addr;
+    socklen_t addrlen = sizeof(addr);
+    if (getpeername(fd, &addr.addr, &addrlen)) {
+        return false;
+    }
+    (void) unmap_v4mapped(&addr);
+    switch (addr.addr.sa_family) {
+#        ifdef AVS_COMMONS_NET_WITH_IPV4
+    case AF_INET:
+        addr.addr_in.sin_port = 0;
+        addrlen = sizeof(addr.addr_in);
+        break;
+#        endif // AVS_COMMONS_NET_WITH_IPV4
+
+#        ifdef AVS_COMMONS_NET_WITH_IPV6
+    case AF_INET6:
+        addr.addr_in6.sin6_port = 0;
+        addr.addr_in6.sin6_flowinfo = 0;
+        addrlen = sizeof(addr.addr_in6);
+        break;
+#        endif // AVS_COMMONS_NET_WITH_IPV6
+
+    default:
+        return false;
+    }
+    AVS_STATIC_ASSERT(sizeof(addr.addr_storage) <= sizeof(out->data.buf),
+                      sockaddr_storage_fits_in_endpoint);
+    memset(out, 0, sizeof(*out));
+    out->size = (uint8_t) addrlen;
+    memcpy(out->data.buf, &addr, addrlen);
+    return true;
+}
+
+static void pmtud_start(net_socket_impl_t *net_socket) {
+    if (!get_pmtud_destination(net_socket->socket,
+                               &net_socket->pmtud_destination)) {
+        return;
+    }
+    /* RFC 791 guarantees 576 bytes; BASE_PLPMTU as recommended by RFC 8899 */
+    int min_plpmtu = 576;
+    int base_plpmtu = 1200;
+#        ifdef AVS_COMMONS_NET_WITH_IPV6
+    if (get_connection_family(net_socket->socket) == AF_INET6) {
+        /* minimum MTU required by RFC 8200 */
+        min_plpmtu = 1280;
+        base_plpmtu = 1280;
+    }
+#        endif // AVS_COMMONS_NET_WITH_IPV6
+    int max_plpmtu;
+    if (avs_is_err(get_system_mtu(net_socket, &max_plpmtu))) {
+        max_plpmtu = base_plpmtu;
+    }
+    /* limited by the 16-bit length fields in IPv4 and UDP headers */
+    _avs_net_pmtud_init(&net_socket->pmtud, min_plpmtu, base_plpmtu,
+                        AVS_MIN(max_plpmtu, UINT16_MAX));
+
+    int cached_plpmtu;
+    avs_time_monotonic_t validated_at;
+    if (net_socket->configuration.path_mtu_cache
+            && _avs_net_path_mtu_cache_lookup(
+                       net_socket->configuration.path_mtu_cache,
+                       &net_socket->pmtud_destination, &cached_plpmtu,
+                       &validated_at)) {
+        _avs_net_pmtud_restore(&net_socket->pmtud, cached_plpmtu,
+                               validated_at);
+    }
+    net_socket->pmtud_active = true;
+    LOG(DEBUG, _("path MTU discovery started, PLPMTU = ") "%d",
+        net_socket->pmtud.plpmtu);
+}
+
+/**
+ * Shall be called after passing an event to the discovery engine, with the
+ * state from before handling it. Stores newly confirmed PLPMTU values in the
+ * cache.
+ */
+static void pmtud_event_handled(net_socket_impl_t *net_socket,
+                                _avs_net_pmtud_state_t prev_state,
+                                int prev_plpmtu,
+                                avs_time_monotonic_t now) {
+    if (net_socket->pmtud.state == prev_state
+            && net_socket->pmtud.plpmtu == prev_plpmtu) {
+        return;
+    }
+    LOG(DEBUG, _("PLPMTU = ") "%d" _(", state = ") "%d",
+        net_socket->pmtud.plpmtu, (int) net_socket->pmtud.state);
+    if (net_socket->configuration.path_mtu_cache
+            && net_socket->pmtud.state == _AVS_NET_PMTUD_SEARCH_COMPLETE) {
+        _avs_net_path_mtu_cache_store(net_socket->configuration.path_mtu_cache,
+                                      &net_socket->pmtud_destination,
+                                      net_socket->pmtud.plpmtu, now);
+    }
+}
+
+/**
+ * Passes the path MTU estimate of the system, which is lowered in response to
+ * ICMP "Packet Too Big" messages, to the discovery engine.
+ */
+static void pmtud_update_from_system(net_socket_impl_t *net_socket) {
+    int system_mtu;
+    if (avs_is_ok(get_system_mtu(net_socket, &system_mtu))
+            && system_mtu < net_socket->pmtud.failed_size) {
+        _avs_net_pmtud_state_t prev_state = net_socket->pmtud.state;
+        int prev_plpmtu = net_socket->pmtud.plpmtu;
+        avs_time_monotonic_t now = avs_time_monotonic_now();
+        _avs_net_pmtud_ptb_received(&net_socket->pmtud, system_mtu, now);
+        pmtud_event_handled(net_socket, prev_state, prev_plpmtu, now);
+    }
+}
+
+/**
+ * Handles EMSGSIZE errors, which are reported both for datagrams larger than
+ * the interface MTU, and asynchronously, for any subsequent operation on
+ * a connected socket, after an ICMP "Packet Too Big" message is received.
+ *
+ * Returns true if the operation that failed shall be retried, i.e. if @p err is
+ * such an error, and a datagram of @p datagram_size bytes fits in the updated
+ * path MTU estimate.
+ */
+static bool pmtud_should_retry(net_socket_impl_t *net_socket,
+                               avs_error_t err,
+                               size_t datagram_size) {
+    int udp_overhead;
+    if (!net_socket->pmtud_active || err.category != AVS_ERRNO_CATEGORY
+            || err.code != AVS_EMSGSIZE
+            || avs_is_err(get_udp_overhead(net_socket, &udp_overhead))) {
+        return false;
+    }
+    pmtud_update_from_system(net_socket);
+    return datagram_size + (size_t) udp_overhead
+           <= (size_t) net_socket->pmtud.plpmtu;
+}
+#    endif // AVS_COMMONS_NET_WITH_PATH_MTU_DISCOVERY
+
 static void cache_remote_hostname(net_socket_impl_t *net_socket,
                                   const char *remote_hostname) {
     if (avs_simple_snprintf(net_socket->remote_hostname,
@@ -1154,10 +1703,20 @@ static void cache_remote_port(net_socket_impl_t *net_socket,
 static avs_error_t
 connect_net(avs_net_socket_t *net_socket_, const char *host, const char *port) {
     net_socket_impl_t *net_socket = (net_socket_impl_t *) net_socket_;
+    if (!port) {
+        /* allowed e.g. for Unix domain sockets, which have no ports */
+        port = "";
+    }
     avs_error_t err = connect_impl(net_socket, host, port);
     if (avs_is_ok(err)) {
         cache_remote_hostname(net_socket, host);
         cache_remote_port(net_socket, port);
+#    ifdef AVS_COMMONS_NET_WITH_PATH_MTU_DISCOVERY
+        if (net_socket->type == AVS_NET_UDP_SOCKET
+                && net_socket->configuration.path_mtu_discovery) {
+            pmtud_start(net_socket);
+        }
+#    endif // AVS_COMMONS_NET_WITH_PATH_MTU_DISCOVERY
     }
     return err;
 }
@@ -1194,6 +1753,14 @@ static avs_error_t send_net(avs_net_socket_t *net_socket_,
         avs_error_t err =
                 call_when_ready(&net_socket->socket, NET_SEND_TIMEOUT,
                                 AVS_POLLOUT | AVS_POLLERR, send_internal, &arg);
+#    ifdef AVS_COMMONS_NET_WITH_PATH_MTU_DISCOVERY
+        if (pmtud_should_retry(net_socket, err, buffer_length)) {
+            /* the error might have been caused by an earlier datagram */
+            err = call_when_ready(&net_socket->socket, NET_SEND_TIMEOUT,
+                                  AVS_POLLOUT | AVS_POLLERR, send_internal,
+                                  &arg);
+        }
+#    endif // AVS_COMMONS_NET_WITH_PATH_MTU_DISCOVERY
         if (avs_is_err(err)) {
             LOG(ERROR, _("send failed"));
             return err;
@@ -1219,18 +1786,193 @@ static avs_error_t send_net(avs_net_socket_t *net_socket_,
     }
 }
 
+#    if defined(HAVE_MULTICAST) || defined(HAVE_PACKET_INFO)
+static avs_error_t resolve_numeric_host(const char *host,
+                                        sockaddr_union_t *out) {
+    avs_net_addrinfo_t *info = avs_net_addrinfo_resolve_ex(
+            AVS_NET_UDP_SOCKET, AVS_NET_AF_UNSPEC, host, "",
+            AVS_NET_ADDRINFO_RESOLVE_F_NOADDRCONFIG
+                    | AVS_NET_ADDRINFO_RESOLVE_F_NUMERICHOST,
+            NULL);
+    sockaddr_endpoint_union_t endpoint;
+    avs_error_t err = avs_errno(AVS_EADDRNOTAVAIL);
+    if (info && !avs_net_addrinfo_next(info, &endpoint.api_ep)) {
+        memset(out, 0, sizeof(*out));
+        memcpy(out, &endpoint.sockaddr_ep.addr,
+               AVS_MIN(endpoint.sockaddr_ep.header.size, sizeof(*out)));
+        err = AVS_OK;
+    } else {
+        LOG(ERROR, _("cannot resolve address: ") "%s", host);
+    }
+    avs_net_addrinfo_delete(&info);
+    return err;
+}
+#    endif // defined(HAVE_MULTICAST) || defined(HAVE_PACKET_INFO)
+
+#    ifdef HAVE_PACKET_INFO
+#        ifdef HAVE_IPV4_PACKET_INFO
+#            define IPV4_PACKET_INFO_SPACE CMSG_SPACE(sizeof(struct in_pktinfo))
+#        else
+#            define IPV4_PACKET_INFO_SPACE 0
+#        endif
+#        ifdef HAVE_IPV6_PACKET_INFO
+#            define IPV6_PACKET_INFO_SPACE \
+                CMSG_SPACE(sizeof(struct in6_pktinfo))
+#        else
+#            define IPV6_PACKET_INFO_SPACE 0
+#        endif
+
+typedef union {
+    struct cmsghdr header;
+    char buf[IPV4_PACKET_INFO_SPACE + IPV6_PACKET_INFO_SPACE];
+} packet_info_control_t;
+
+static void read_packet_info(struct msghdr *msg, packet_info_t *out) {
+    out->local_addr.addr.sa_family = AF_UNSPEC;
+    out->interface_index = 0;
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(msg); cmsg;
+         cmsg = CMSG_NXTHDR(msg, cmsg)) {
+#        ifdef HAVE_IPV4_PACKET_INFO
+        if (cmsg->cmsg_level == IPPROTO_IP && cmsg->cmsg_type == IP_PKTINFO) {
+            struct in_pktinfo info;
+            memcpy(&info, CMSG_DATA(cmsg), sizeof(info));
+            memset(&out->local_addr.addr_in, 0,
+                   sizeof(out->local_addr.addr_in));
+            out->local_addr.addr_in.sin_family = AF_INET;
+            out->local_addr.addr_in.sin_addr = info.ipi_addr;
+            out->interface_index = (unsigned) info.ipi_ifindex;
+            return;
+        }
+#        endif // HAVE_IPV4_PACKET_INFO
+#        ifdef HAVE_IPV6_PACKET_INFO
+        if (cmsg->cmsg_level == IPPROTO_IPV6
+                && cmsg->cmsg_type == IPV6_PKTINFO) {
+            struct in6_pktinfo info;
+            memcpy(&info, CMSG_DATA(cmsg), sizeof(info));
+            memset(&out->local_addr.addr_in6, 0,
+                   sizeof(out->local_addr.addr_in6));
+            out->local_addr.addr_in6.sin6_family = AF_INET6;
+            out->local_addr.addr_in6.sin6_addr = info.ipi6_addr;
+            out->interface_index = info.ipi6_ifindex;
+            // IPv4 datagrams received on dual-stack sockets are reported with
+            // IPv4-mapped addresses
+            unmap_v4mapped(&out->local_addr);
+        }
+#        endif // HAVE_IPV6_PACKET_INFO
+    }
+}
+
+static ssize_t sendto_with_packet_info(sockfd_t sockfd,
+                                       const void *data,
+                                       size_t data_length,
+                                       const sockaddr_endpoint_union_t *dest,
+                                       const packet_info_t *info) {
+    struct iovec iov = {
+        .iov_base = (void *) (intptr_t) data,
+        .iov_len = data_length
+    };
+    packet_info_control_t control;
+    memset(&control, 0, sizeof(control));
+    struct msghdr msg = {
+        .msg_name = (void *) (intptr_t) &dest->sockaddr_ep.addr,
+        .msg_namelen = dest->sockaddr_ep.header.size,
+        .msg_iov = &iov,
+        .msg_iovlen = 1,
+        .msg_control = control.buf,
+        .msg_controllen = sizeof(control.buf)
+    };
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+
+    int family = info->local_addr.addr.sa_family;
+    if (family == AF_UNSPEC) {
+        sockaddr_union_t dest_addr;
+        memcpy(&dest_addr, &dest->sockaddr_ep.addr,
+               AVS_MIN(dest->sockaddr_ep.header.size, sizeof(dest_addr)));
+        family = unmap_v4mapped(&dest_addr) ? dest_addr.addr.sa_family
+                                            : AF_INET;
+    }
+    switch (family) {
+#        ifdef HAVE_IPV4_PACKET_INFO
+    case AF_INET: {
+        struct in_pktinfo pktinfo;
+        memset(&pktinfo, 0, sizeof(pktinfo));
+        pktinfo.ipi_ifindex = (int) info->interface_index;
+        if (info->local_addr.addr.sa_family == AF_INET) {
+            pktinfo.ipi_spec_dst = info->local_addr.addr_in.sin_addr;
+        } else {
+            // unlike IPv6, an unspecified address in IP_PKTINFO overrides the
+            // one the socket is bound to, so it needs to be passed explicitly
+            sockaddr_union_t bound_addr;
+            socklen_t bound_addr_length = sizeof(bound_addr);
+            if (!getsockname(sockfd, &bound_addr.addr, &bound_addr_length)
+                    && (bound_addr.addr.sa_family == AF_INET
+                        || !unmap_v4mapped(&bound_addr))) {
+                pktinfo.ipi_spec_dst = bound_addr.addr_in.sin_addr;
+            }
+        }
+        cmsg->cmsg_level = IPPROTO_IP;
+        cmsg->cmsg_type = IP_PKTINFO;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(pktinfo));
+        memcpy(CMSG_DATA(cmsg), &pktinfo, sizeof(pktinfo));
+        msg.msg_controllen = CMSG_SPACE(sizeof(pktinfo));
+        break;
+    }
+#        endif // HAVE_IPV4_PACKET_INFO
+
+#        ifdef HAVE_IPV6_PACKET_INFO
+    case AF_INET6: {
+        struct in6_pktinfo pktinfo;
+        memset(&pktinfo, 0, sizeof(pktinfo));
+        pktinfo.ipi6_ifindex = info->interface_index;
+        if (info->local_addr.addr.sa_family == AF_INET6) {
+            pktinfo.ipi6_addr = info->local_addr.addr_in6.sin6_addr;
+        }
+        cmsg->cmsg_level = IPPROTO_IPV6;
+        cmsg->cmsg_type = IPV6_PKTINFO;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(pktinfo));
+        memcpy(CMSG_DATA(cmsg), &pktinfo, sizeof(pktinfo));
+        msg.msg_controllen = CMSG_SPACE(sizeof(pktinfo));
+        break;
+    }
+#        endif // HAVE_IPV6_PACKET_INFO
+
+    default:
+        errno = EAFNOSUPPORT;
+        return -1;
+    }
+    return sendmsg(sockfd, &msg, MSG_NOSIGNAL);
+}
+
+static bool packet_info_set(const packet_info_t *info) {
+    return info->local_addr.addr.sa_family != AF_UNSPEC
+           || info->interface_index;
+}
+#    endif // HAVE_PACKET_INFO
+
 typedef struct {
     const void *data;
     size_t data_length;
     const sockaddr_endpoint_union_t *dest_addr;
+#    ifdef HAVE_PACKET_INFO
+    const packet_info_t *packet_info;
+#    endif // HAVE_PACKET_INFO
     size_t bytes_sent;
 } send_to_internal_arg_t;
 
 static avs_error_t send_to_internal(sockfd_t sockfd, void *arg_) {
     send_to_internal_arg_t *arg = (send_to_internal_arg_t *) arg_;
-    ssize_t result = sendto(sockfd, arg->data, arg->data_length, MSG_NOSIGNAL,
-                            &arg->dest_addr->sockaddr_ep.addr,
-                            arg->dest_addr->sockaddr_ep.header.size);
+    ssize_t result;
+#    ifdef HAVE_PACKET_INFO
+    if (arg->packet_info) {
+        result = sendto_with_packet_info(sockfd, arg->data, arg->data_length,
+                                         arg->dest_addr, arg->packet_info);
+    } else
+#    endif // HAVE_PACKET_INFO
+    {
+        result = sendto(sockfd, arg->data, arg->data_length, MSG_NOSIGNAL,
+                        &arg->dest_addr->sockaddr_ep.addr,
+                        arg->dest_addr->sockaddr_ep.header.size);
+    }
     if (result < 0) {
         return failure_from_errno();
     }
@@ -1255,6 +1997,11 @@ static avs_error_t send_to_resolved(net_socket_impl_t *net_socket,
         .data_length = buffer_length,
         .dest_addr = address
     };
+#    ifdef HAVE_PACKET_INFO
+    if (packet_info_set(&net_socket->send_packet_info)) {
+        arg.packet_info = &net_socket->send_packet_info;
+    }
+#    endif // HAVE_PACKET_INFO
 
     avs_error_t err =
             call_when_ready(&net_socket->socket, NET_SEND_TIMEOUT,
@@ -1270,6 +2017,9 @@ static avs_error_t send_to_net(avs_net_socket_t *net_socket_,
                                const char *port) {
     net_socket_impl_t *net_socket = (net_socket_impl_t *) net_socket_;
     avs_net_addrinfo_t *info = NULL;
+    if (!port) {
+        port = "";
+    }
 
     avs_error_t err = avs_errno(AVS_EADDRNOTAVAIL);
     if ((info = resolve_addrinfo_for_socket(net_socket, host, port, false,
@@ -1311,6 +2061,9 @@ typedef struct {
     size_t buffer_length;
     sockaddr_union_t *src_addr;
     socklen_t *src_addr_length;
+#    ifdef HAVE_PACKET_INFO
+    packet_info_t *packet_info;
+#    endif // HAVE_PACKET_INFO
 } recvfrom_internal_arg_t;
 
 #    ifndef AVS_COMMONS_NET_POSIX_AVS_SOCKET_HAVE_RECVMSG
@@ -1365,10 +2118,23 @@ static avs_error_t recvfrom_internal(sockfd_t sockfd, void *arg_) {
         msg.msg_name = &arg->src_addr->addr;
         msg.msg_namelen = (socklen_t) sizeof(*arg->src_addr);
     }
+#        ifdef HAVE_PACKET_INFO
+    packet_info_control_t control;
+    if (arg->packet_info) {
+        msg.msg_control = control.buf;
+        msg.msg_controllen = sizeof(control.buf);
+    }
+#        endif // HAVE_PACKET_INFO
 
     errno = 0;
     recv_out = recvmsg(sockfd, &msg, 0);
 
+#        ifdef HAVE_PACKET_INFO
+    if (arg->packet_info && recv_out >= 0) {
+        read_packet_info(&msg, arg->packet_info);
+    }
+#        endif // HAVE_PACKET_INFO
+
     if (arg->src_addr_length) {
         *arg->src_addr_length = msg.msg_namelen;
     }
@@ -1397,9 +2163,22 @@ static avs_error_t receive_net(avs_net_socket_t *net_socket_,
         .buffer = buffer,
         .buffer_length = buffer_length
     };
+#    ifdef HAVE_PACKET_INFO
+    if (net_socket->recv_packet_info) {
+        arg.packet_info = &net_socket->last_packet_info;
+    }
+#    endif // HAVE_PACKET_INFO
     avs_error_t err =
             call_when_ready(&net_socket->socket, net_socket->recv_timeout,
                             AVS_POLLIN | AVS_POLLERR, recvfrom_internal, &arg);
+#    ifdef AVS_COMMONS_NET_WITH_PATH_MTU_DISCOVERY
+    if (buffer_length && !arg.bytes_received
+            && pmtud_should_retry(net_socket, err, 0)) {
+        err = call_when_ready(&net_socket->socket, net_socket->recv_timeout,
+                              AVS_POLLIN | AVS_POLLERR, recvfrom_internal,
+                              &arg);
+    }
+#    endif // AVS_COMMONS_NET_WITH_PATH_MTU_DISCOVERY
     *out = arg.bytes_received;
     net_socket->bytes_received += arg.bytes_received;
     return err;
@@ -1429,9 +2208,22 @@ static avs_error_t receive_from_net(avs_net_socket_t *net_socket_,
         .src_addr = &src_addr,
         .src_addr_length = &src_addr_length
     };
+#    ifdef HAVE_PACKET_INFO
+    if (net_socket->recv_packet_info) {
+        arg.packet_info = &net_socket->last_packet_info;
+    }
+#    endif // HAVE_PACKET_INFO
     avs_error_t err =
             call_when_ready(&net_socket->socket, net_socket->recv_timeout,
                             AVS_POLLIN | AVS_POLLERR, recvfrom_internal, &arg);
+#    ifdef AVS_COMMONS_NET_WITH_PATH_MTU_DISCOVERY
+    if (buffer_size && !arg.bytes_received
+            && pmtud_should_retry(net_socket, err, 0)) {
+        err = call_when_ready(&net_socket->socket, net_socket->recv_timeout,
+                              AVS_POLLIN | AVS_POLLERR, recvfrom_internal,
+                              &arg);
+    }
+#    endif // AVS_COMMONS_NET_WITH_PATH_MTU_DISCOVERY
     net_socket->bytes_received += arg.bytes_received;
     *out = arg.bytes_received;
     if (avs_is_ok(err)
@@ -1457,9 +2249,9 @@ static avs_error_t create_listening_socket(net_socket_impl_t *net_socket,
         return avs_errno(AVS_EINVAL);
     }
     errno = 0;
-    net_socket->socket = socket(addr->sa_family,
-                                _avs_net_get_socket_type(net_socket->type),
-                                get_socket_proto(net_socket->type));
+    net_socket->socket =
+            socket(addr->sa_family, _avs_net_get_socket_type(net_socket->type),
+                   get_socket_proto(addr->sa_family, net_socket->type));
     if (net_socket->socket == INVALID_SOCKET) {
         err = failure_from_errno();
         LOG(ERROR, _("cannot create system socket: ") "%s",
@@ -1711,6 +2503,13 @@ static avs_error_t accept_net(avs_net_socket_t *server_net_socket_,
     avs_error_t err;
     switch (server_net_socket->type) {
     case AVS_NET_UDP_SOCKET:
+#    ifdef AVS_COMMONS_NET_WITH_UNIX_SOCKETS
+        if (get_socket_family(server_net_socket->socket) == AF_UNIX) {
+            LOG(ERROR,
+                _("accept() is not supported for Unix datagram sockets"));
+            return avs_errno(AVS_ENOTSUP);
+        }
+#    endif /* AVS_COMMONS_NET_WITH_UNIX_SOCKETS */
         err = accept_udp(server_net_socket, new_net_socket);
         break;
     case AVS_NET_TCP_SOCKET:
@@ -1813,7 +2612,7 @@ static avs_error_t local_host_net(avs_net_socket_t *socket,
     errno = 0;
     if (!getsockname(net_socket->socket, &addr.addr, &addrlen)) {
         (void) unmap_v4mapped(&addr);
-        return get_string_ip(&addr, out_buffer, out_buffer_size);
+        return get_string_ip(&addr, addrlen, out_buffer, out_buffer_size);
     } else {
         return failure_from_errno();
     }
@@ -1840,43 +2639,14 @@ static avs_error_t get_mtu(net_socket_impl_t *net_socket, int *out_mtu) {
         *out_mtu = net_socket->configuration.forced_mtu;
         return AVS_OK;
     }
-
-    int mtu = -1;
-    avs_error_t err = AVS_OK;
-    socklen_t dummy = sizeof(mtu);
-    switch (get_socket_family(net_socket->socket)) {
-#    if defined(AVS_COMMONS_NET_WITH_IPV4) && defined(IP_MTU)
-    case AF_INET:
-        errno = 0;
-        if (getsockopt(net_socket->socket, IPPROTO_IP, IP_MTU, &mtu, &dummy)
-                < 0) {
-            err = failure_from_errno();
-        }
-        break;
-#    endif /* defined(AVS_COMMONS_NET_WITH_IPV4) && defined(IP_MTU) */
-
-#    if defined(AVS_COMMONS_NET_WITH_IPV6) && defined(IPV6_MTU)
-    case AF_INET6:
-        errno = 0;
-        if (getsockopt(net_socket->socket, IPPROTO_IPV6, IPV6_MTU, &mtu, &dummy)
-                < 0) {
-            err = failure_from_errno();
-        }
-        break;
-#    endif /* defined(AVS_COMMONS_NET_WITH_IPV6) && defined(IPV6_MTU) */
-
-    default:
-        (void) dummy;
-        err = avs_errno(AVS_EINVAL);
-    }
-    if (avs_is_ok(err)) {
-        if (mtu >= 0) {
-            *out_mtu = mtu;
-        } else {
-            err = avs_errno(AVS_UNKNOWN_ERROR);
-        }
+#    ifdef AVS_COMMONS_NET_WITH_PATH_MTU_DISCOVERY
+    if (net_socket->pmtud_active) {
+        pmtud_update_from_system(net_socket);
+        *out_mtu = net_socket->pmtud.plpmtu;
+        return AVS_OK;
     }
-    return err;
+#    endif // AVS_COMMONS_NET_WITH_PATH_MTU_DISCOVERY
+    return get_system_mtu(net_socket, out_mtu);
 }
 
 static int get_fallback_inner_mtu(net_socket_impl_t *socket) {
@@ -1892,25 +2662,6 @@ static int get_fallback_inner_mtu(net_socket_impl_t *socket) {
     }
 }
 
-static avs_error_t get_udp_overhead(net_socket_impl_t *net_socket, int *out) {
-    switch (get_socket_family(net_socket->socket)) {
-#    ifdef AVS_COMMONS_NET_WITH_IPV4
-    case AF_INET:
-        *out = 28; /* 20 for IP + 8 for UDP */
-        return AVS_OK;
-#    endif /* AVS_COMMONS_NET_WITH_IPV4 */
-
-#    ifdef AVS_COMMONS_NET_WITH_IPV6
-    case AF_INET6:
-        *out = 48; /* 40 for IPv6 + 8 for UDP */
-        return AVS_OK;
-#    endif /* AVS_COMMONS_NET_WITH_IPV6 */
-
-    default:
-        return avs_errno(AVS_EINVAL);
-    }
-}
-
 static avs_error_t get_inner_mtu(net_socket_impl_t *net_socket, int *out_mtu) {
     if (net_socket->type != AVS_NET_UDP_SOCKET) {
         LOG(ERROR,
@@ -1937,6 +2688,366 @@ static avs_error_t get_inner_mtu(net_socket_impl_t *net_socket, int *out_mtu) {
     return AVS_OK;
 }
 
+#    ifdef AVS_COMMONS_NET_WITH_PATH_MTU_DISCOVERY
+static avs_error_t check_pmtud_active(net_socket_impl_t *net_socket) {
+    if (net_socket->pmtud_active) {
+        return AVS_OK;
+    } else if (net_socket->type != AVS_NET_UDP_SOCKET
+               || !net_socket->configuration.path_mtu_discovery) {
+        LOG(ERROR, _("path MTU discovery is not enabled"));
+        return avs_errno(AVS_ENOTSUP);
+    } else {
+        LOG(ERROR, _("path MTU discovery requires a connected IP socket"));
+        return avs_errno(AVS_ENOTCONN);
+    }
+}
+
+static avs_error_t get_pmtu_probe_size(net_socket_impl_t *net_socket,
+                                       int *out_size) {
+    avs_error_t err;
+    int udp_overhead;
+    if (avs_is_err((err = check_pmtud_active(net_socket)))
+            || avs_is_err(
+                       (err = get_udp_overhead(net_socket, &udp_overhead)))) {
+        return err;
+    }
+    pmtud_update_from_system(net_socket);
+    int probe_size = _avs_net_pmtud_probe_size(&net_socket->pmtud,
+                                               avs_time_monotonic_now());
+    *out_size = probe_size ? AVS_MAX(probe_size - udp_overhead, 0) : 0;
+    return AVS_OK;
+}
+
+static avs_error_t set_pmtu_probe_result(net_socket_impl_t *net_socket,
+                                         bool acked) {
+    avs_error_t err = check_pmtud_active(net_socket);
+    if (avs_is_err(err)) {
+        return err;
+    }
+    _avs_net_pmtud_state_t prev_state = net_socket->pmtud.state;
+    int prev_plpmtu = net_socket->pmtud.plpmtu;
+    avs_time_monotonic_t now = avs_time_monotonic_now();
+    if (acked) {
+        _avs_net_pmtud_probe_acked(&net_socket->pmtud, now);
+    } else {
+        _avs_net_pmtud_probe_lost(&net_socket->pmtud, now);
+    }
+    pmtud_event_handled(net_socket, prev_state, prev_plpmtu, now);
+    return AVS_OK;
+}
+#    endif // AVS_COMMONS_NET_WITH_PATH_MTU_DISCOVERY
+
+#    ifdef AVS_COMMONS_NET_WITH_UNIX_SOCKETS
+static avs_error_t get_peer_credentials(net_socket_impl_t *net_socket,
+                                        avs_net_peer_credentials_t *out) {
+    if (net_socket->socket == INVALID_SOCKET) {
+        return avs_errno(AVS_EBADF);
+    }
+    if (get_socket_family(net_socket->socket) != AF_UNIX) {
+        LOG(DEBUG, _("peer credentials are only available for Unix sockets"));
+        return avs_errno(AVS_EINVAL);
+    }
+#        if defined(__linux__) && defined(SO_PEERCRED)
+    struct ucred cred;
+    socklen_t length = sizeof(cred);
+    errno = 0;
+    if (getsockopt(net_socket->socket, SOL_SOCKET, SO_PEERCRED, &cred,
+                   &length)) {
+        return failure_from_errno();
+    }
+    out->pid = cred.pid;
+    out->uid = (uint32_t) cred.uid;
+    out->gid = (uint32_t) cred.gid;
+    return AVS_OK;
+#        elif defined(AVS_COMMONS_NET_POSIX_AVS_SOCKET_HAVE_GETPEEREID)
+    uid_t uid;
+    gid_t gid;
+    errno = 0;
+    if (getpeereid(net_socket->socket, &uid, &gid)) {
+        return failure_from_errno();
+    }
+    out->pid = -1;
+    out->uid = (uint32_t) uid;
+    out->gid = (uint32_t) gid;
+    return AVS_OK;
+#        else
+    (void) out;
+    return avs_errno(AVS_ENOTSUP);
+#        endif
+}
+#    endif /* AVS_COMMONS_NET_WITH_UNIX_SOCKETS */
+
+#    ifdef HAVE_MULTICAST
+static avs_error_t
+set_multicast_membership(net_socket_impl_t *net_socket,
+                         bool join,
+                         const avs_net_multicast_membership_t *membership) {
+    if (net_socket->socket == INVALID_SOCKET) {
+        LOG(ERROR, _("cannot change multicast membership of a closed socket"));
+        return avs_errno(AVS_EBADF);
+    }
+    if (net_socket->type != AVS_NET_UDP_SOCKET || !membership->group) {
+        return avs_errno(AVS_EINVAL);
+    }
+    unsigned interface_index = 0;
+    if (membership->interface_name && membership->interface_name[0]
+            && !(interface_index =
+                         if_nametoindex(membership->interface_name))) {
+        LOG(ERROR, _("unknown interface: ") "%s", membership->interface_name);
+        return avs_errno(AVS_ENODEV);
+    }
+
+    sockaddr_union_t group;
+    avs_error_t err = resolve_numeric_host(membership->group, &group);
+    if (avs_is_err(err)) {
+        return err;
+    }
+    // IPv4 groups are joined at the IPv4 level even on IPv6 sockets, which is
+    // what makes them work for dual-stack sockets
+    int level;
+    switch (group.addr.sa_family) {
+#        ifdef AVS_COMMONS_NET_WITH_IPV4
+    case AF_INET:
+        level = IPPROTO_IP;
+        break;
+#        endif /* AVS_COMMONS_NET_WITH_IPV4 */
+
+#        ifdef AVS_COMMONS_NET_WITH_IPV6
+    case AF_INET6:
+        level = IPPROTO_IPV6;
+        break;
+#        endif /* AVS_COMMONS_NET_WITH_IPV6 */
+
+    default:
+        return avs_errno(AVS_EAFNOSUPPORT);
+    }
+
+    int retval;
+    errno = 0;
+    if (!membership->source) {
+        struct group_req req;
+        memset(&req, 0, sizeof(req));
+        req.gr_interface = interface_index;
+        memcpy(&req.gr_group, &group.addr_storage, sizeof(req.gr_group));
+        retval = setsockopt(net_socket->socket, level,
+                            join ? MCAST_JOIN_GROUP : MCAST_LEAVE_GROUP, &req,
+                            sizeof(req));
+    } else {
+#        ifdef MCAST_JOIN_SOURCE_GROUP
+        sockaddr_union_t source;
+        if (avs_is_err((err = resolve_numeric_host(membership->source,
+                                                   &source)))) {
+            return err;
+        }
+        struct group_source_req req;
+        memset(&req, 0, sizeof(req));
+        req.gsr_interface = interface_index;
+        memcpy(&req.gsr_group, &group.addr_storage, sizeof(req.gsr_group));
+        memcpy(&req.gsr_source, &source.addr_storage, sizeof(req.gsr_source));
+        retval = setsockopt(net_socket->socket, level,
+                            join ? MCAST_JOIN_SOURCE_GROUP
+                                 : MCAST_LEAVE_SOURCE_GROUP,
+                            &req, sizeof(req));
+#        else  // MCAST_JOIN_SOURCE_GROUP
+        LOG(ERROR, _("source-specific multicast is not supported"));
+        return avs_errno(AVS_ENOTSUP);
+#        endif // MCAST_JOIN_SOURCE_GROUP
+    }
+    if (retval) {
+        err = failure_from_errno();
+        LOG(ERROR, _("cannot ") "%s" _(" multicast group ") "%s" _(": ") "%s",
+            join ? "join" : "leave", membership->group,
+            avs_strerror((avs_errno_t) err.code));
+    }
+    return err;
+}
+
+/**
+ * Multicast TTL and loopback options are set as <c>unsigned char</c> at the
+ * IPv4 level (as required by BSD systems) and as <c>int</c> at the IPv6 level.
+ * On IPv6 sockets, the IPv4 variant is additionally set on a best-effort basis,
+ * so that it also applies to traffic to IPv4-mapped addresses.
+ */
+static avs_error_t set_multicast_option(net_socket_impl_t *net_socket,
+                                        int ipv4_option,
+                                        int ipv6_option,
+                                        int value) {
+    if (net_socket->socket == INVALID_SOCKET) {
+        return avs_errno(AVS_EBADF);
+    }
+    unsigned char byte_value = (unsigned char) value;
+    int retval = -1;
+    errno = EINVAL;
+    switch (get_socket_family(net_socket->socket)) {
+#        ifdef AVS_COMMONS_NET_WITH_IPV4
+    case AF_INET:
+        retval = setsockopt(net_socket->socket, IPPROTO_IP, ipv4_option,
+                            &byte_value, sizeof(byte_value));
+        break;
+#        endif /* AVS_COMMONS_NET_WITH_IPV4 */
+
+#        ifdef AVS_COMMONS_NET_WITH_IPV6
+    case AF_INET6:
+        retval = setsockopt(net_socket->socket, IPPROTO_IPV6, ipv6_option,
+                            &value, sizeof(value));
+#            ifdef AVS_COMMONS_NET_WITH_IPV4
+        if (!retval) {
+            (void) setsockopt(net_socket->socket, IPPROTO_IP, ipv4_option,
+                              &byte_value, sizeof(byte_value));
+        }
+#            endif /* AVS_COMMONS_NET_WITH_IPV4 */
+        break;
+#        endif /* AVS_COMMONS_NET_WITH_IPV6 */
+
+    default:
+        (void) ipv4_option;
+        (void) ipv6_option;
+        (void) byte_value;
+        break;
+    }
+    return retval ? failure_from_errno() : AVS_OK;
+}
+
+static avs_error_t get_multicast_option(net_socket_impl_t *net_socket,
+                                        int ipv4_option,
+                                        int ipv6_option,
+                                        int *out_value) {
+    if (net_socket->socket == INVALID_SOCKET) {
+        return avs_errno(AVS_EBADF);
+    }
+    int retval = -1;
+    errno = EINVAL;
+    switch (get_socket_family(net_socket->socket)) {
+#        ifdef AVS_COMMONS_NET_WITH_IPV4
+    case AF_INET: {
+        unsigned char value = 0;
+        socklen_t length = sizeof(value);
+        if (!(retval = getsockopt(net_socket->socket, IPPROTO_IP, ipv4_option,
+                                  &value, &length))) {
+            *out_value = value;
+        }
+        break;
+    }
+#        endif /* AVS_COMMONS_NET_WITH_IPV4 */
+
+#        ifdef AVS_COMMONS_NET_WITH_IPV6
+    case AF_INET6: {
+        socklen_t length = sizeof(*out_value);
+        retval = getsockopt(net_socket->socket, IPPROTO_IPV6, ipv6_option,
+                            out_value, &length);
+        break;
+    }
+#        endif /* AVS_COMMONS_NET_WITH_IPV6 */
+
+    default:
+        (void) ipv4_option;
+        (void) ipv6_option;
+        break;
+    }
+    return retval ? failure_from_errno() : AVS_OK;
+}
+#    endif // HAVE_MULTICAST
+
+#    ifdef HAVE_PACKET_INFO
+static avs_error_t set_recv_packet_info(net_socket_impl_t *net_socket,
+                                        bool enabled) {
+    if (net_socket->socket == INVALID_SOCKET) {
+        return avs_errno(AVS_EBADF);
+    }
+    int value = enabled;
+    int retval = -1;
+    errno = EINVAL;
+    switch (get_socket_family(net_socket->socket)) {
+#        ifdef HAVE_IPV4_PACKET_INFO
+    case AF_INET:
+        retval = setsockopt(net_socket->socket, IPPROTO_IP, IP_PKTINFO, &value,
+                            sizeof(value));
+        break;
+#        endif // HAVE_IPV4_PACKET_INFO
+
+#        ifdef HAVE_IPV6_PACKET_INFO
+    case AF_INET6:
+        // this also covers IPv4 datagrams received on dual-stack sockets
+        retval = setsockopt(net_socket->socket, IPPROTO_IPV6, IPV6_RECVPKTINFO,
+                            &value, sizeof(value));
+        break;
+#        endif // HAVE_IPV6_PACKET_INFO
+
+    default:
+        (void) value;
+        break;
+    }
+    if (retval) {
+        return failure_from_errno();
+    }
+    net_socket->recv_packet_info = enabled;
+    memset(&net_socket->last_packet_info, 0,
+           sizeof(net_socket->last_packet_info));
+    return AVS_OK;
+}
+
+static avs_error_t get_packet_info(const packet_info_t *info,
+                                   avs_net_packet_info_t *out) {
+    memset(out, 0, sizeof(*out));
+    if (info->local_addr.addr.sa_family != AF_UNSPEC) {
+        avs_error_t err = host_port_to_string(
+                &info->local_addr.addr, (socklen_t) sizeof(info->local_addr),
+                out->local_host, (socklen_t) sizeof(out->local_host), NULL, 0);
+        if (avs_is_err(err)) {
+            return err;
+        }
+    }
+    if (info->interface_index
+            && !if_indextoname(info->interface_index, out->interface_name)) {
+        return failure_from_errno();
+    }
+    return AVS_OK;
+}
+
+static bool is_multicast(const sockaddr_union_t *addr) {
+    switch (addr->addr.sa_family) {
+#        ifdef AVS_COMMONS_NET_WITH_IPV4
+    case AF_INET:
+        return IN_MULTICAST(ntohl(addr->addr_in.sin_addr.s_addr));
+#        endif /* AVS_COMMONS_NET_WITH_IPV4 */
+
+#        ifdef AVS_COMMONS_NET_WITH_IPV6
+    case AF_INET6:
+        return IN6_IS_ADDR_MULTICAST(&addr->addr_in6.sin6_addr);
+#        endif /* AVS_COMMONS_NET_WITH_IPV6 */
+
+    default:
+        return false;
+    }
+}
+
+static avs_error_t set_send_packet_info(net_socket_impl_t *net_socket,
+                                        const avs_net_packet_info_t *info) {
+    packet_info_t result;
+    memset(&result, 0, sizeof(result));
+    if (info->local_host[0]) {
+        avs_error_t err = resolve_numeric_host(info->local_host,
+                                               &result.local_addr);
+        if (avs_is_err(err)) {
+            return err;
+        }
+        // a reply cannot be sent from a multicast address, so in that case,
+        // only the interface is used
+        if (is_multicast(&result.local_addr)) {
+            result.local_addr.addr.sa_family = AF_UNSPEC;
+        }
+    }
+    if (info->interface_name[0]
+            && !(result.interface_index =
+                         if_nametoindex(info->interface_name))) {
+        LOG(ERROR, _("unknown interface: ") "%s", info->interface_name);
+        return avs_errno(AVS_ENODEV);
+    }
+    net_socket->send_packet_info = result;
+    return AVS_OK;
+}
+#    endif // HAVE_PACKET_INFO
+
 static avs_error_t get_opt_net(avs_net_socket_t *net_socket_,
                                avs_net_socket_opt_key_t option_key,
                                avs_net_socket_opt_value_t *out_option_value) {
@@ -1962,6 +3073,41 @@ static avs_error_t get_opt_net(avs_net_socket_t *net_socket_,
     case AVS_NET_SOCKET_OPT_BYTES_SENT:
         out_option_value->bytes_sent = net_socket->bytes_sent;
         return AVS_OK;
+#    ifdef AVS_COMMONS_NET_WITH_UNIX_SOCKETS
+    case AVS_NET_SOCKET_OPT_PEER_CREDENTIALS:
+        return get_peer_credentials(net_socket,
+                                    &out_option_value->peer_credentials);
+#    endif /* AVS_COMMONS_NET_WITH_UNIX_SOCKETS */
+#    ifdef HAVE_MULTICAST
+    case AVS_NET_SOCKET_OPT_MULTICAST_TTL:
+        return get_multicast_option(net_socket, IP_MULTICAST_TTL,
+                                    IPV6_MULTICAST_HOPS,
+                                    &out_option_value->multicast_ttl);
+    case AVS_NET_SOCKET_OPT_MULTICAST_LOOP: {
+        int value;
+        avs_error_t err = get_multicast_option(net_socket, IP_MULTICAST_LOOP,
+                                               IPV6_MULTICAST_LOOP, &value);
+        if (avs_is_ok(err)) {
+            out_option_value->flag = !!value;
+        }
+        return err;
+    }
+#    endif // HAVE_MULTICAST
+#    ifdef HAVE_PACKET_INFO
+    case AVS_NET_SOCKET_OPT_RECV_PACKET_INFO:
+        out_option_value->flag = net_socket->recv_packet_info;
+        return AVS_OK;
+    case AVS_NET_SOCKET_OPT_LAST_PACKET_INFO:
+        return get_packet_info(&net_socket->last_packet_info,
+                               &out_option_value->packet_info);
+    case AVS_NET_SOCKET_OPT_SEND_PACKET_INFO:
+        return get_packet_info(&net_socket->send_packet_info,
+                               &out_option_value->packet_info);
+#    endif // HAVE_PACKET_INFO
+#    ifdef AVS_COMMONS_NET_WITH_PATH_MTU_DISCOVERY
+    case AVS_NET_SOCKET_OPT_PMTU_PROBE_SIZE:
+        return get_pmtu_probe_size(net_socket, &out_option_value->mtu);
+#    endif // AVS_COMMONS_NET_WITH_PATH_MTU_DISCOVERY
     default:
         LOG(DEBUG,
             _("get_opt_net: unknown or unsupported option key: ")
@@ -1979,6 +3125,34 @@ static avs_error_t set_opt_net(avs_net_socket_t *net_socket_,
     case AVS_NET_SOCKET_OPT_RECV_TIMEOUT:
         net_socket->recv_timeout = option_value.recv_timeout;
         return AVS_OK;
+#    ifdef HAVE_MULTICAST
+    case AVS_NET_SOCKET_OPT_MULTICAST_JOIN:
+    case AVS_NET_SOCKET_OPT_MULTICAST_LEAVE:
+        return set_multicast_membership(
+                net_socket, option_key == AVS_NET_SOCKET_OPT_MULTICAST_JOIN,
+                &option_value.multicast_membership);
+    case AVS_NET_SOCKET_OPT_MULTICAST_TTL:
+        if (option_value.multicast_ttl < 0
+                || option_value.multicast_ttl > UINT8_MAX) {
+            return avs_errno(AVS_EINVAL);
+        }
+        return set_multicast_option(net_socket, IP_MULTICAST_TTL,
+                                    IPV6_MULTICAST_HOPS,
+                                    option_value.multicast_ttl);
+    case AVS_NET_SOCKET_OPT_MULTICAST_LOOP:
+        return set_multicast_option(net_socket, IP_MULTICAST_LOOP,
+                                    IPV6_MULTICAST_LOOP, option_value.flag);
+#    endif // HAVE_MULTICAST
+#    ifdef HAVE_PACKET_INFO
+    case AVS_NET_SOCKET_OPT_RECV_PACKET_INFO:
+        return set_recv_packet_info(net_socket, option_value.flag);
+    case AVS_NET_SOCKET_OPT_SEND_PACKET_INFO:
+        return set_send_packet_info(net_socket, &option_value.packet_info);
+#    endif // HAVE_PACKET_INFO
+#    ifdef AVS_COMMONS_NET_WITH_PATH_MTU_DISCOVERY
+    case AVS_NET_SOCKET_OPT_PMTU_PROBE_RESULT:
+        return set_pmtu_probe_result(net_socket, option_value.flag);
+#    endif // AVS_COMMONS_NET_WITH_PATH_MTU_DISCOVERY
     default:
         LOG(DEBUG,
             _("set_opt_net: unknown or unsupported option key: ")
@@ -58,6 +58,7 @@
 #    include <avsystem/commons/avs_prng.h>
 #    include <avsystem/commons/avs_utils.h>
 
+#    include "../avs_net_dtls_cork.h"
 #    include "../avs_net_global.h"
 #    ifdef AVS_COMMONS_WITH_AVS_CRYPTO_PKI
 #        include "crypto/mbedtls/avs_mbedtls_data_loader.h"
@@ -107,6 +108,12 @@ typedef struct {
 typedef struct {
     mbedtls_x509_crt *ca_cert;
     mbedtls_x509_crl *ca_crl;
+#        ifdef AVS_COMMONS_WITH_MBEDTLS_LAZY_CA_PATH
+    // if non-NULL, trusted certificates from paths are loaded on demand
+    // through this object, and ca_cert only contains certificates from other
+    // sources; no CRLs are configured in that case
+    avs_crypto_mbedtls_lazy_ca_t *lazy_ca;
+#        endif // AVS_COMMONS_WITH_MBEDTLS_LAZY_CA_PATH
     mbedtls_x509_crt *client_cert;
     mbedtls_pk_context *client_key;
 #        ifdef WITH_DANE_SUPPORT
@@ -144,6 +151,7 @@ typedef struct {
     avs_net_socket_type_t backend_type;
     avs_net_socket_t *backend_socket;
     avs_error_t bio_error;
+    _avs_net_dtls_cork_t cork;
     avs_net_socket_configuration_t backend_configuration;
     /// Subset of @ref avs_net_ssl_configuration_t#tls_ciphersuites appropriate
     /// for security mode, 0-terminated array
@@ -213,6 +221,10 @@ avs_bio_recv(void *ctx, unsigned char *buf, size_t len, uint32_t timeout_ms) {
     avs_net_socket_opt_value_t new_timeout;
     size_t read_bytes;
     int result;
+    if (avs_is_err((socket->bio_error = _avs_net_dtls_cork_flush(
+                            &socket->cork, socket->backend_socket)))) {
+        return MBEDTLS_ERR_NET_SEND_FAILED;
+    }
     if (avs_is_err((socket->bio_error = avs_net_socket_get_opt(
                             socket->backend_socket,
                             AVS_NET_SOCKET_OPT_RECV_TIMEOUT,
@@ -244,8 +256,9 @@ avs_bio_recv(void *ctx, unsigned char *buf, size_t len, uint32_t timeout_ms) {
 
 static int avs_bio_send(void *ctx, const unsigned char *buf, size_t len) {
     ssl_socket_t *socket = (ssl_socket_t *) ctx;
-    if (avs_is_err((socket->bio_error = avs_net_socket_send(
-                            socket->backend_socket, buf, len)))) {
+    if (avs_is_err((socket->bio_error = _avs_net_dtls_cork_write(
+                            &socket->cork, socket->backend_socket, buf,
+                            len)))) {
         return MBEDTLS_ERR_NET_SEND_FAILED;
     } else {
         return (int) len;
@@ -588,6 +601,20 @@ static int wrap_handshake_result(ssl_socket_t *socket, int result) {
 }
 #        endif // WITH_DANE_SUPPORT
 
+static void configure_trust_store(ssl_socket_t *socket) {
+#        ifdef AVS_COMMONS_WITH_MBEDTLS_LAZY_CA_PATH
+    if (socket->security.cert.lazy_ca) {
+        mbedtls_ssl_conf_ca_cb(&socket->config,
+                               _avs_crypto_mbedtls_lazy_ca_find_issuers,
+                               socket->security.cert.lazy_ca);
+        return;
+    }
+#        endif // AVS_COMMONS_WITH_MBEDTLS_LAZY_CA_PATH
+    mbedtls_ssl_conf_ca_chain(&socket->config,
+                              socket->security.cert.ca_cert,
+                              socket->security.cert.ca_crl);
+}
+
 static avs_error_t initialize_cert_security(
         ssl_socket_t *socket,
         const avs_net_socket_tls_ciphersuites_t *tls_ciphersuites) {
@@ -612,9 +639,7 @@ static avs_error_t initialize_cert_security(
             mbedtls_ssl_conf_authmode(&socket->config,
                                       MBEDTLS_SSL_VERIFY_REQUIRED);
         }
-        mbedtls_ssl_conf_ca_chain(&socket->config,
-                                  socket->security.cert.ca_cert,
-                                  socket->security.cert.ca_crl);
+        configure_trust_store(socket);
     } else {
         mbedtls_ssl_conf_authmode(&socket->config, MBEDTLS_SSL_VERIFY_NONE);
     }
@@ -663,9 +688,7 @@ static avs_error_t update_cert_configuration(ssl_socket_t *socket) {
     }
 #        endif // WITH_DANE_SUPPORT
 
-    mbedtls_ssl_conf_ca_chain(&socket->config,
-                              socket->security.cert.ca_cert,
-                              socket->security.cert.ca_crl);
+    configure_trust_store(socket);
     return AVS_OK;
 }
 #    else // AVS_COMMONS_WITH_AVS_CRYPTO_PKI
@@ -971,6 +994,23 @@ static avs_error_t start_ssl(ssl_socket_t *socket, const char *host) {
         goto finish;
     }
 #    endif // MBEDTLS_SSL_DTLS_CONNECTION_ID
+#    if defined(MBEDTLS_SSL_PROTO_DTLS) \
+            && defined(AVS_COMMONS_NET_WITH_PATH_MTU_DISCOVERY) \
+            && MBEDTLS_VERSION_NUMBER >= 0x020D0000 // mbedtls_ssl_set_mtu()
+    if (socket->backend_configuration.path_mtu_discovery
+            && transport_for_socket_type(socket->backend_type)
+                           == MBEDTLS_SSL_TRANSPORT_DATAGRAM) {
+        // Fragment the handshake messages (e.g. long certificate chains)
+        // according to the path MTU estimate. This limit is lifted after the
+        // handshake, as application data records are sized by the user using
+        // AVS_NET_SOCKET_OPT_INNER_MTU and AVS_NET_SOCKET_OPT_PMTU_PROBE_SIZE.
+        int mtu = get_socket_inner_mtu_or_zero(socket->backend_socket);
+        mbedtls_ssl_set_mtu(get_context(socket),
+                            (uint16_t) AVS_MIN(mtu, UINT16_MAX));
+    }
+#    endif // defined(MBEDTLS_SSL_PROTO_DTLS) &&
+           // defined(AVS_COMMONS_NET_WITH_PATH_MTU_DISCOVERY) &&
+           // MBEDTLS_VERSION_NUMBER >= 0x020D0000
 
 #    ifdef AVS_COMMONS_WITH_AVS_CRYPTO_PKI
     if ((result = mbedtls_ssl_set_hostname(
@@ -1015,6 +1055,15 @@ static avs_error_t start_ssl(ssl_socket_t *socket, const char *host) {
     result = wrap_handshake_result(socket, result);
 
     if (result == 0) {
+#    if defined(MBEDTLS_SSL_PROTO_DTLS) \
+            && defined(AVS_COMMONS_NET_WITH_PATH_MTU_DISCOVERY) \
+            && MBEDTLS_VERSION_NUMBER >= 0x020D0000 // mbedtls_ssl_set_mtu()
+        if (socket->backend_configuration.path_mtu_discovery) {
+            mbedtls_ssl_set_mtu(get_context(socket), 0);
+        }
+#    endif // defined(MBEDTLS_SSL_PROTO_DTLS) &&
+           // defined(AVS_COMMONS_NET_WITH_PATH_MTU_DISCOVERY) &&
+           // MBEDTLS_VERSION_NUMBER >= 0x020D0000
 #    if defined(MBEDTLS_SSL_DTLS_CONNECTION_ID)
         if (socket->use_connection_id) {
             unsigned char peer_cid[MBEDTLS_SSL_CID_OUT_LEN_MAX];
@@ -1024,8 +1073,8 @@ static avs_error_t start_ssl(ssl_socket_t *socket, const char *host) {
                                             peer_cid, &peer_cid_len);
             if (enabled) {
                 char peer_cid_hex[2 * sizeof(peer_cid) + 1] = "";
-                (void) avs_hexlify(peer_cid_hex, sizeof(peer_cid_hex), peer_cid,
-                                   peer_cid_len);
+                (void) avs_hexlify(peer_cid_hex, sizeof(peer_cid_hex), NULL,
+                                   peer_cid, peer_cid_len);
                 LOG(DEBUG, _("negotiated CID = ") "%s", peer_cid_hex);
             }
         }
@@ -1194,6 +1243,9 @@ static avs_error_t receive_ssl(avs_net_socket_t *socket_,
 
 #    ifdef AVS_COMMONS_WITH_AVS_CRYPTO_PKI
 static void cleanup_security_cert(ssl_socket_certs_t *certs) {
+#        ifdef AVS_COMMONS_WITH_MBEDTLS_LAZY_CA_PATH
+    _avs_crypto_mbedtls_lazy_ca_cleanup(&certs->lazy_ca);
+#        endif // AVS_COMMONS_WITH_MBEDTLS_LAZY_CA_PATH
     _avs_crypto_mbedtls_x509_crt_cleanup(&certs->ca_cert);
     _avs_crypto_mbedtls_x509_crl_cleanup(&certs->ca_crl);
     _avs_crypto_mbedtls_x509_crt_cleanup(&certs->client_cert);
@@ -1310,8 +1362,29 @@ static bool cert_makes_cycle_in_chain(const mbedtls_x509_crt *first_cert,
     return false;
 }
 
-static avs_error_t rebuild_client_cert_chain(mbedtls_x509_crt *trust_store,
-                                             mbedtls_x509_crt *first_cert) {
+static int verify_for_chain_rebuild(mbedtls_x509_crt *last_cert,
+                                    mbedtls_x509_crt *trust_store,
+                                    avs_crypto_mbedtls_lazy_ca_t *lazy_ca) {
+#        ifdef AVS_COMMONS_WITH_MBEDTLS_LAZY_CA_PATH
+    if (lazy_ca) {
+        return mbedtls_x509_crt_verify_with_ca_cb(
+                last_cert, _avs_crypto_mbedtls_lazy_ca_find_issuers, lazy_ca,
+                &mbedtls_x509_crt_profile_default, NULL, &(uint32_t) { 0 },
+                rebuild_client_cert_chain_verify_cb, last_cert);
+    }
+#        else  // AVS_COMMONS_WITH_MBEDTLS_LAZY_CA_PATH
+    (void) lazy_ca;
+#        endif // AVS_COMMONS_WITH_MBEDTLS_LAZY_CA_PATH
+    return mbedtls_x509_crt_verify(last_cert, trust_store, NULL, NULL,
+                                   &(uint32_t) { 0 },
+                                   rebuild_client_cert_chain_verify_cb,
+                                   last_cert);
+}
+
+static avs_error_t
+rebuild_client_cert_chain(mbedtls_x509_crt *trust_store,
+                          avs_crypto_mbedtls_lazy_ca_t *lazy_ca,
+                          mbedtls_x509_crt *first_cert) {
     assert(trust_store);
     assert(first_cert);
     assert(first_cert->version != 0);
@@ -1322,9 +1395,8 @@ static avs_error_t rebuild_client_cert_chain(mbedtls_x509_crt *trust_store,
     // Mbed TLS' cert verification stops at the first cert found in trust store,
     // so we repeat the procedure until no new certs are added
     while (true) {
-        int result = mbedtls_x509_crt_verify(
-                last_cert, trust_store, NULL, NULL, &(uint32_t) { 0 },
-                rebuild_client_cert_chain_verify_cb, last_cert);
+        int result =
+                verify_for_chain_rebuild(last_cert, trust_store, lazy_ca);
         if (result == MBEDTLS_ERR_X509_ALLOC_FAILED) {
             return avs_errno(AVS_ENOMEM);
         } else if (last_cert->version == 0 || !last_cert->next) {
@@ -1348,6 +1420,25 @@ static avs_error_t rebuild_client_cert_chain(mbedtls_x509_crt *trust_store,
     }
 }
 
+static avs_error_t
+load_trust_store(mbedtls_x509_crt **out_ca_certs,
+                 avs_crypto_mbedtls_lazy_ca_t **out_lazy_ca,
+                 const avs_net_certificate_info_t *cert_info) {
+#        ifdef AVS_COMMONS_WITH_MBEDTLS_LAZY_CA_PATH
+    // mbedtls_ssl_conf_ca_cb() does not support CRLs, so lazy loading is only
+    // used if none are configured
+    if (cert_info->cert_revocation_lists.desc.source
+            == AVS_CRYPTO_DATA_SOURCE_EMPTY) {
+        return _avs_crypto_mbedtls_load_trust_store(
+                out_ca_certs, out_lazy_ca, &cert_info->trusted_certs);
+    }
+#        else  // AVS_COMMONS_WITH_MBEDTLS_LAZY_CA_PATH
+    (void) out_lazy_ca;
+#        endif // AVS_COMMONS_WITH_MBEDTLS_LAZY_CA_PATH
+    return _avs_crypto_mbedtls_load_certs(out_ca_certs,
+                                          &cert_info->trusted_certs);
+}
+
 static avs_error_t
 configure_ssl_certs(ssl_socket_certs_t *certs,
                     const avs_net_certificate_info_t *cert_info) {
@@ -1356,10 +1447,11 @@ configure_ssl_certs(ssl_socket_certs_t *certs,
     avs_error_t err = AVS_OK;
 
     mbedtls_x509_crt *ca_certs = NULL;
+    avs_crypto_mbedtls_lazy_ca_t *lazy_ca = NULL;
     if ((cert_info->server_cert_validation
          || cert_info->rebuild_client_cert_chain)
-            && avs_is_err((err = _avs_crypto_mbedtls_load_certs(
-                                   &ca_certs, &cert_info->trusted_certs)))) {
+            && avs_is_err((err = load_trust_store(&ca_certs, &lazy_ca,
+                                                  cert_info)))) {
         LOG(ERROR, _("could not load CA chain"));
     }
 
@@ -1373,7 +1465,8 @@ configure_ssl_certs(ssl_socket_certs_t *certs,
             } else if (cert_info->rebuild_client_cert_chain && ca_certs
                        && certs->client_cert && certs->client_cert->version != 0
                        && avs_is_err((err = rebuild_client_cert_chain(
-                                              ca_certs, certs->client_cert)))) {
+                                              ca_certs, lazy_ca,
+                                              certs->client_cert)))) {
                 LOG(ERROR, _("could not rebuild client certificate chain"));
             }
             if (avs_is_ok(err)
@@ -1392,6 +1485,10 @@ configure_ssl_certs(ssl_socket_certs_t *certs,
             assert(!certs->ca_cert);
             certs->ca_cert = ca_certs;
             ca_certs = NULL;
+#        ifdef AVS_COMMONS_WITH_MBEDTLS_LAZY_CA_PATH
+            certs->lazy_ca = lazy_ca;
+            lazy_ca = NULL;
+#        endif // AVS_COMMONS_WITH_MBEDTLS_LAZY_CA_PATH
             if (avs_is_err((err = _avs_crypto_mbedtls_load_crls(
                                     &certs->ca_crl,
                                     &cert_info->cert_revocation_lists)))) {
@@ -1402,6 +1499,7 @@ configure_ssl_certs(ssl_socket_certs_t *certs,
         }
     }
 
+    _avs_crypto_mbedtls_lazy_ca_cleanup(&lazy_ca);
     _avs_crypto_mbedtls_x509_crt_cleanup(&ca_certs);
 
     if (cert_info->dane) {
@@ -48,6 +48,7 @@
 #        include <avsystem/commons/avs_list.h>
 #    endif // AVS_COMMONS_WITH_AVS_LIST
 
+#    include "../avs_net_dtls_cork.h"
 #    include "../avs_net_global.h"
 
 #    ifdef AVS_COMMONS_WITH_AVS_CRYPTO_PKI
@@ -93,6 +94,7 @@ typedef struct {
     SSL *ssl;
     ssl_verify_mode_t verify_mode;
     avs_error_t bio_error;
+    _avs_net_dtls_cork_t cork;
     avs_time_real_t next_deadline;
     avs_net_socket_type_t backend_type;
     avs_net_socket_t *backend_socket;
@@ -317,8 +319,9 @@ static int avs_bio_write(BIO *bio, const char *data, int size) {
         return 0;
     }
     BIO_clear_retry_flags(bio);
-    if (avs_is_err((sock->bio_error = avs_net_socket_send(
-                            sock->backend_socket, data, (size_t) size)))) {
+    if (avs_is_err((sock->bio_error = _avs_net_dtls_cork_write(
+                            &sock->cork, sock->backend_socket, data,
+                            (size_t) size)))) {
         return -1;
     } else {
         return size;
@@ -372,6 +375,10 @@ static int avs_bio_read(BIO *bio, char *buffer, int size) {
         return 0;
     }
     BIO_clear_retry_flags(bio);
+    if (avs_is_err((sock->bio_error = _avs_net_dtls_cork_flush(
+                            &sock->cork, sock->backend_socket)))) {
+        return -1;
+    }
     if (socket_is_datagram(sock)) {
         prev_timeout = adjust_receive_timeout(sock);
     }
@@ -411,6 +418,11 @@ static long avs_bio_ctrl(BIO *bio, int command, long intarg, void *ptrarg) {
     case BIO_CTRL_DGRAM_QUERY_MTU:
     case BIO_CTRL_DGRAM_GET_FALLBACK_MTU:
         return get_socket_inner_mtu_or_zero(sock->backend_socket);
+    case BIO_CTRL_DGRAM_MTU_EXCEEDED:
+        // if nonzero after a failed write, OpenSSL queries the MTU again and
+        // fragments the handshake messages accordingly
+        return sock->bio_error.category == AVS_ERRNO_CATEGORY
+               && sock->bio_error.code == AVS_EMSGSIZE;
     case BIO_CTRL_DGRAM_SET_NEXT_TIMEOUT: {
         struct timeval next_deadline = *(const struct timeval *) ptrarg;
         if (next_deadline.tv_sec == 0 && next_deadline.tv_usec == 0) {
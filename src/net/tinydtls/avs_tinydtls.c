@@ -30,6 +30,7 @@
 
 #    include <tinydtls/dtls.h>
 
+#    include "../avs_net_dtls_cork.h"
 #    include "../avs_net_global.h"
 
 #    include "../avs_net_impl.h"
@@ -49,6 +50,7 @@ typedef struct {
     avs_net_socket_type_t backend_type;
     avs_net_socket_t *backend_socket;
     avs_error_t bio_error;
+    _avs_net_dtls_cork_t cork;
     avs_net_socket_configuration_t backend_configuration;
 
     ssl_read_context_t *read_ctx;
@@ -144,10 +146,11 @@ static avs_error_t receive_ssl(avs_net_socket_t *socket_,
      * completely filled with decoded data. */
     size_t message_length;
     avs_error_t err =
-            avs_net_socket_receive(socket->backend_socket, &message_length,
-                                   out_buffer, buffer_size);
-
-    if (avs_is_err(err)) {
+            _avs_net_dtls_cork_flush(&socket->cork, socket->backend_socket);
+    if (avs_is_err(err)
+            || avs_is_err((err = avs_net_socket_receive(
+                                   socket->backend_socket, &message_length,
+                                   out_buffer, buffer_size)))) {
         return err;
     }
 
@@ -323,9 +326,9 @@ static int dtls_write_handler(dtls_context_t *ctx,
                               size_t length) {
     (void) session;
     ssl_socket_t *socket = (ssl_socket_t *) dtls_get_app_data(ctx);
-    if (avs_is_err((socket->bio_error = avs_net_socket_send(
-                            socket->backend_socket, (const void *) buffer,
-                            length)))) {
+    if (avs_is_err((socket->bio_error = _avs_net_dtls_cork_write(
+                            &socket->cork, socket->backend_socket,
+                            (const void *) buffer, length)))) {
         return -1;
     }
     assert(length <= INT_MAX);
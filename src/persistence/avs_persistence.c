@@ -23,6 +23,8 @@
 
 #    include <avsystem/commons/avs_memory.h>
 #    include <avsystem/commons/avs_persistence.h>
+#    include <avsystem/commons/avs_stream_inbuf.h>
+#    include <avsystem/commons/avs_stream_membuf.h>
 #    include <avsystem/commons/avs_utils.h>
 
 #    define MODULE_NAME avs_persistence
@@ -631,6 +633,505 @@ avs_error_t avs_persistence_version(avs_persistence_context_t *ctx,
     return avs_errno(AVS_EBADMSG);
 }
 
+//// FRAMED RECORDS ////////////////////////////////////////////////////////////
+
+#    if defined(__SSE4_2__) && (defined(__GNUC__) || defined(__clang__))
+// SSE 4.2 includes a dedicated CRC-32C instruction
+static uint32_t crc32c(const void *data, size_t size) {
+    const uint8_t *bytes = (const uint8_t *) data;
+    uint32_t crc = UINT32_MAX;
+    for (; size >= sizeof(uint32_t); size -= sizeof(uint32_t)) {
+        uint32_t word;
+        memcpy(&word, bytes, sizeof(word));
+        crc = __builtin_ia32_crc32si(crc, word);
+        bytes += sizeof(word);
+    }
+    for (; size > 0; --size) {
+        crc = __builtin_ia32_crc32qi(crc, *bytes++);
+    }
+    return crc ^ UINT32_MAX;
+}
+#    else  // defined(__SSE4_2__) && (defined(__GNUC__) || defined(__clang__))
+/**
+ * Lookup table for the CRC-32C (Castagnoli) polynomial, reflected:
+ * 0x82F63B78.
+ */
+static const uint32_t CRC32C_TABLE[256] = {
+    0x00000000, 0xF26B8303, 0xE13B70F7, 0x1350F3F4, 0xC79A971F, 0x35F1141C,
+    0x26A1E7E8, 0xD4CA64EB, 0x8AD958CF, 0x78B2DBCC, 0x6BE22838, 0x9989AB3B,
+    0x4D43CFD0, 0xBF284CD3, 0xAC78BF27, 0x5E133C24, 0x105EC76F, 0xE235446C,
+    0xF165B798, 0x030E349B, 0xD7C45070, 0x25AFD373, 0x36FF2087, 0xC494A384,
+    0x9A879FA0, 0x68EC1CA3, 0x7BBCEF57, 0x89D76C54, 0x5D1D08BF, 0xAF768BBC,
+    0xBC267848, 0x4E4DFB4B, 0x20BD8EDE, 0xD2D60DDD, 0xC186FE29, 0x33ED7D2A,
+    0xE72719C1, 0x154C9AC2, 0x061C6936, 0xF477EA35, 0xAA64D611, 0x580F5512,
+    0x4B5FA6E6, 0xB93425E5, 0x6DFE410E, 0x9F95C20D, 0x8CC531F9, 0x7EAEB2FA,
+    0x30E349B1, 0xC288CAB2, 0xD1D83946, 0x23B3BA45, 0xF779DEAE, 0x05125DAD,
+    0x1642AE59, 0xE4292D5A, 0xBA3A117E, 0x4851927D, 0x5B016189, 0xA96AE28A,
+    0x7DA08661, 0x8FCB0562, 0x9C9BF696, 0x6EF07595, 0x417B1DBC, 0xB3109EBF,
+    0xA0406D4B, 0x522BEE48, 0x86E18AA3, 0x748A09A0, 0x67DAFA54, 0x95B17957,
+    0xCBA24573, 0x39C9C670, 0x2A993584, 0xD8F2B687, 0x0C38D26C, 0xFE53516F,
+    0xED03A29B, 0x1F682198, 0x5125DAD3, 0xA34E59D0, 0xB01EAA24, 0x42752927,
+    0x96BF4DCC, 0x64D4CECF, 0x77843D3B, 0x85EFBE38, 0xDBFC821C, 0x2997011F,
+    0x3AC7F2EB, 0xC8AC71E8, 0x1C661503, 0xEE0D9600, 0xFD5D65F4, 0x0F36E6F7,
+    0x61C69362, 0x93AD1061, 0x80FDE395, 0x72966096, 0xA65C047D, 0x5437877E,
+    0x4767748A, 0xB50CF789, 0xEB1FCBAD, 0x197448AE, 0x0A24BB5A, 0xF84F3859,
+    0x2C855CB2, 0xDEEEDFB1, 0xCDBE2C45, 0x3FD5AF46, 0x7198540D, 0x83F3D70E,
+    0x90A324FA, 0x62C8A7F9, 0xB602C312, 0x44694011, 0x5739B3E5, 0xA55230E6,
+    0xFB410CC2, 0x092A8FC1, 0x1A7A7C35, 0xE811FF36, 0x3CDB9BDD, 0xCEB018DE,
+    0xDDE0EB2A, 0x2F8B6829, 0x82F63B78, 0x709DB87B, 0x63CD4B8F, 0x91A6C88C,
+    0x456CAC67, 0xB7072F64, 0xA457DC90, 0x563C5F93, 0x082F63B7, 0xFA44E0B4,
+    0xE9141340, 0x1B7F9043, 0xCFB5F4A8, 0x3DDE77AB, 0x2E8E845F, 0xDCE5075C,
+    0x92A8FC17, 0x60C37F14, 0x73938CE0, 0x81F80FE3, 0x55326B08, 0xA759E80B,
+    0xB4091BFF, 0x466298FC, 0x1871A4D8, 0xEA1A27DB, 0xF94AD42F, 0x0B21572C,
+    0xDFEB33C7, 0x2D80B0C4, 0x3ED04330, 0xCCBBC033, 0xA24BB5A6, 0x502036A5,
+    0x4370C551, 0xB11B4652, 0x65D122B9, 0x97BAA1BA, 0x84EA524E, 0x7681D14D,
+    0x2892ED69, 0xDAF96E6A, 0xC9A99D9E, 0x3BC21E9D, 0xEF087A76, 0x1D63F975,
+    0x0E330A81, 0xFC588982, 0xB21572C9, 0x407EF1CA, 0x532E023E, 0xA145813D,
+    0x758FE5D6, 0x87E466D5, 0x94B49521, 0x66DF1622, 0x38CC2A06, 0xCAA7A905,
+    0xD9F75AF1, 0x2B9CD9F2, 0xFF56BD19, 0x0D3D3E1A, 0x1E6DCDEE, 0xEC064EED,
+    0xC38D26C4, 0x31E6A5C7, 0x22B65633, 0xD0DDD530, 0x0417B1DB, 0xF67C32D8,
+    0xE52CC12C, 0x1747422F, 0x49547E0B, 0xBB3FFD08, 0xA86F0EFC, 0x5A048DFF,
+    0x8ECEE914, 0x7CA56A17, 0x6FF599E3, 0x9D9E1AE0, 0xD3D3E1AB, 0x21B862A8,
+    0x32E8915C, 0xC083125F, 0x144976B4, 0xE622F5B7, 0xF5720643, 0x07198540,
+    0x590AB964, 0xAB613A67, 0xB831C993, 0x4A5A4A90, 0x9E902E7B, 0x6CFBAD78,
+    0x7FAB5E8C, 0x8DC0DD8F, 0xE330A81A, 0x115B2B19, 0x020BD8ED, 0xF0605BEE,
+    0x24AA3F05, 0xD6C1BC06, 0xC5914FF2, 0x37FACCF1, 0x69E9F0D5, 0x9B8273D6,
+    0x88D28022, 0x7AB90321, 0xAE7367CA, 0x5C18E4C9, 0x4F48173D, 0xBD23943E,
+    0xF36E6F75, 0x0105EC76, 0x12551F82, 0xE03E9C81, 0x34F4F86A, 0xC69F7B69,
+    0xD5CF889D, 0x27A40B9E, 0x79B737BA, 0x8BDCB4B9, 0x988C474D, 0x6AE7C44E,
+    0xBE2DA0A5, 0x4C4623A6, 0x5F16D052, 0xAD7D5351
+};
+
+static uint32_t crc32c(const void *data, size_t size) {
+    const uint8_t *bytes = (const uint8_t *) data;
+    uint32_t crc = UINT32_MAX;
+    for (size_t i = 0; i < size; ++i) {
+        crc = CRC32C_TABLE[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ UINT32_MAX;
+}
+#    endif // defined(__SSE4_2__) && (defined(__GNUC__) || defined(__clang__))
+
+/* length, CRC32C of the contents, CRC32C of the preceding two fields */
+#    define FRAMED_RECORD_HEADER_FIELDS 3
+
+static avs_error_t store_framed_record(avs_persistence_context_t *ctx,
+                                       avs_persistence_handler_record_t *handler,
+                                       void *user_data) {
+    avs_stream_t *record_stream = avs_stream_membuf_create();
+    if (!record_stream) {
+        LOG(ERROR, _("Out of memory"));
+        return avs_errno(AVS_ENOMEM);
+    }
+    avs_persistence_context_t record_ctx =
+            avs_persistence_store_context_create(record_stream);
+    void *data = NULL;
+    size_t size = 0;
+    avs_error_t err = handler(&record_ctx, user_data);
+    if (avs_is_ok(err)) {
+        err = avs_stream_membuf_take_ownership(record_stream, &data, &size);
+    }
+    avs_stream_cleanup(&record_stream);
+    if (avs_is_ok(err) && (uint32_t) size != size) {
+        LOG(ERROR,
+            _("Record too big to persist (") "%lu" _(
+                    " is larger than ") "%" PRIu32 _(")"),
+            (unsigned long) size, UINT32_MAX);
+        err = avs_errno(AVS_EOVERFLOW);
+    }
+    if (avs_is_ok(err)) {
+        uint32_t header[FRAMED_RECORD_HEADER_FIELDS];
+        header[0] = avs_convert_be32((uint32_t) size);
+        header[1] = avs_convert_be32(crc32c(data, size));
+        header[2] = avs_convert_be32(crc32c(header, 2 * sizeof(uint32_t)));
+        err = avs_stream_write(ctx->stream, header, sizeof(header));
+        if (avs_is_ok(err) && size > 0) {
+            err = avs_stream_write(ctx->stream, data, size);
+        }
+    }
+    avs_free(data);
+    return err;
+}
+
+static void log_corrupted_record(avs_off_t offset, const char *reason) {
+    if (offset >= 0) {
+        LOG(ERROR, _("Corrupted record at offset ") "%lu" _(": ") "%s",
+            (unsigned long) offset, reason);
+    } else {
+        LOG(ERROR, _("Corrupted record: ") "%s", reason);
+    }
+}
+
+static avs_error_t read_framed_record(avs_persistence_context_t *ctx,
+                                      void **out_data,
+                                      size_t *out_size) {
+    avs_off_t offset;
+    if (avs_is_err(avs_stream_offset(ctx->stream, &offset))) {
+        offset = -1;
+    }
+
+    uint32_t header[FRAMED_RECORD_HEADER_FIELDS];
+    // EOF before the first byte of the header is a clean end of data
+    avs_error_t err = avs_stream_read_reliably(ctx->stream, header, 1);
+    if (avs_is_ok(err)) {
+        err = avs_stream_read_reliably(ctx->stream, (char *) header + 1,
+                                       sizeof(header) - 1);
+        if (avs_is_eof(err)) {
+            log_corrupted_record(offset, "truncated header");
+            return avs_errno(AVS_EBADMSG);
+        }
+    }
+    if (avs_is_err(err)) {
+        return err;
+    }
+    if (crc32c(header, 2 * sizeof(uint32_t)) != avs_convert_be32(header[2])) {
+        log_corrupted_record(offset, "header checksum mismatch");
+        return avs_errno(AVS_EBADMSG);
+    }
+
+    const uint32_t size = avs_convert_be32(header[0]);
+    void *data = avs_malloc(size > 0 ? size : 1);
+    if (!data) {
+        LOG(ERROR, _("Cannot allocate ") "%" PRIu32 _(" bytes"), size);
+        return avs_errno(AVS_ENOMEM);
+    }
+    err = avs_stream_read_reliably(ctx->stream, data, size);
+    if (avs_is_eof(err)) {
+        log_corrupted_record(offset, "truncated data");
+        err = avs_errno(AVS_EBADMSG);
+    } else if (avs_is_ok(err)
+               && crc32c(data, size) != avs_convert_be32(header[1])) {
+        log_corrupted_record(offset, "data checksum mismatch");
+        err = avs_errno(AVS_EBADMSG);
+    }
+    if (avs_is_err(err)) {
+        avs_free(data);
+        return err;
+    }
+    *out_data = data;
+    *out_size = size;
+    return AVS_OK;
+}
+
+static avs_error_t
+restore_framed_record(avs_persistence_context_t *ctx,
+                      avs_persistence_handler_record_t *handler,
+                      void *user_data) {
+    void *data = NULL;
+    size_t size = 0;
+    avs_error_t err = read_framed_record(ctx, &data, &size);
+    if (avs_is_err(err)) {
+        return err;
+    }
+    avs_stream_inbuf_t record_stream = AVS_STREAM_INBUF_STATIC_INITIALIZER;
+    avs_stream_inbuf_set_buffer(&record_stream, data, size);
+    avs_persistence_context_t record_ctx =
+            avs_persistence_restore_context_create(
+                    (avs_stream_t *) &record_stream);
+    if (avs_is_ok((err = handler(&record_ctx, user_data)))
+            && record_stream.buffer_offset != size) {
+        LOG(ERROR, _("Record not fully restored, ") "%lu" _(" bytes left"),
+            (unsigned long) (size - record_stream.buffer_offset));
+        err = avs_errno(AVS_EBADMSG);
+    }
+    avs_free(data);
+    return err;
+}
+
+avs_error_t
+avs_persistence_framed_record(avs_persistence_context_t *ctx,
+                              avs_persistence_handler_record_t *handler,
+                              void *user_data) {
+    if (!ctx) {
+        return avs_errno(AVS_EBADF);
+    }
+    if (ctx->vtable == &STORE_VTABLE) {
+        return store_framed_record(ctx, handler, user_data);
+    } else {
+        return restore_framed_record(ctx, handler, user_data);
+    }
+}
+
+//// FIELD DESCRIPTORS /////////////////////////////////////////////////////////
+
+/* consecutive fixed-width fields are coalesced in a buffer of this size */
+#    define FIELDS_BUFFER_SIZE 256
+
+/* sizes of fields in the persisted format; 0 for fields that are not
+ * fixed-width, or whose size depends on the descriptor */
+static const uint8_t FIELD_WIDTHS[] = {
+    [AVS_PERSISTENCE_FIELD_BOOL] = 1,   [AVS_PERSISTENCE_FIELD_U8] = 1,
+    [AVS_PERSISTENCE_FIELD_U16] = 2,    [AVS_PERSISTENCE_FIELD_U32] = 4,
+    [AVS_PERSISTENCE_FIELD_U64] = 8,    [AVS_PERSISTENCE_FIELD_I8] = 1,
+    [AVS_PERSISTENCE_FIELD_I16] = 2,    [AVS_PERSISTENCE_FIELD_I32] = 4,
+    [AVS_PERSISTENCE_FIELD_I64] = 8,    [AVS_PERSISTENCE_FIELD_FLOAT] = 4,
+    [AVS_PERSISTENCE_FIELD_DOUBLE] = 8, [AVS_PERSISTENCE_FIELD_BYTES] = 0,
+    [AVS_PERSISTENCE_FIELD_STRING] = 0
+};
+
+/* returns the size of the field in the persisted format, or 0 for fields that
+ * are not fixed-width */
+static inline size_t field_width(const avs_persistence_field_t *field) {
+    return field->type == AVS_PERSISTENCE_FIELD_BYTES
+                   ? field->size
+                   : FIELD_WIDTHS[field->type];
+}
+
+static avs_error_t validate_fields(const avs_persistence_field_t *fields,
+                                   size_t field_count) {
+    for (size_t i = 0; i < field_count; ++i) {
+        size_t expected_size = 0;
+        if ((size_t) fields[i].type < AVS_ARRAY_SIZE(FIELD_WIDTHS)) {
+            if (fields[i].type == AVS_PERSISTENCE_FIELD_STRING) {
+                expected_size = sizeof(char *);
+            } else {
+                expected_size = field_width(&fields[i]);
+            }
+        }
+        if (!expected_size || fields[i].size != expected_size) {
+            LOG(ERROR, _("Invalid descriptor of field ") "%lu",
+                (unsigned long) i);
+            return avs_errno(AVS_EINVAL);
+        }
+    }
+    return AVS_OK;
+}
+
+static void encode_field(const avs_persistence_field_t *field,
+                         const char *object,
+                         char *out) {
+    const char *value = object + field->offset;
+    switch (field->type) {
+    case AVS_PERSISTENCE_FIELD_BOOL:
+    case AVS_PERSISTENCE_FIELD_U8:
+    case AVS_PERSISTENCE_FIELD_I8:
+        *out = *value;
+        break;
+    case AVS_PERSISTENCE_FIELD_U16:
+    case AVS_PERSISTENCE_FIELD_I16: {
+        uint16_t tmp;
+        memcpy(&tmp, value, sizeof(tmp));
+        tmp = avs_convert_be16(tmp);
+        memcpy(out, &tmp, sizeof(tmp));
+        break;
+    }
+    case AVS_PERSISTENCE_FIELD_U32:
+    case AVS_PERSISTENCE_FIELD_I32: {
+        uint32_t tmp;
+        memcpy(&tmp, value, sizeof(tmp));
+        tmp = avs_convert_be32(tmp);
+        memcpy(out, &tmp, sizeof(tmp));
+        break;
+    }
+    case AVS_PERSISTENCE_FIELD_U64:
+    case AVS_PERSISTENCE_FIELD_I64: {
+        uint64_t tmp;
+        memcpy(&tmp, value, sizeof(tmp));
+        tmp = avs_convert_be64(tmp);
+        memcpy(out, &tmp, sizeof(tmp));
+        break;
+    }
+    case AVS_PERSISTENCE_FIELD_FLOAT: {
+        float tmp;
+        memcpy(&tmp, value, sizeof(tmp));
+        const uint32_t value_be = avs_htonf(tmp);
+        memcpy(out, &value_be, sizeof(value_be));
+        break;
+    }
+    case AVS_PERSISTENCE_FIELD_DOUBLE: {
+        double tmp;
+        memcpy(&tmp, value, sizeof(tmp));
+        const uint64_t value_be = avs_htond(tmp);
+        memcpy(out, &value_be, sizeof(value_be));
+        break;
+    }
+    default:
+        memcpy(out, value, field->size);
+    }
+}
+
+static void decode_field(const avs_persistence_field_t *field,
+                         const char *in,
+                         char *object) {
+    char *value = object + field->offset;
+    switch (field->type) {
+    case AVS_PERSISTENCE_FIELD_BOOL:
+    case AVS_PERSISTENCE_FIELD_U8:
+    case AVS_PERSISTENCE_FIELD_I8:
+        *value = *in;
+        break;
+    case AVS_PERSISTENCE_FIELD_U16:
+    case AVS_PERSISTENCE_FIELD_I16: {
+        uint16_t tmp;
+        memcpy(&tmp, in, sizeof(tmp));
+        tmp = avs_convert_be16(tmp);
+        memcpy(value, &tmp, sizeof(tmp));
+        break;
+    }
+    case AVS_PERSISTENCE_FIELD_U32:
+    case AVS_PERSISTENCE_FIELD_I32: {
+        uint32_t tmp;
+        memcpy(&tmp, in, sizeof(tmp));
+        tmp = avs_convert_be32(tmp);
+        memcpy(value, &tmp, sizeof(tmp));
+        break;
+    }
+    case AVS_PERSISTENCE_FIELD_U64:
+    case AVS_PERSISTENCE_FIELD_I64: {
+        uint64_t tmp;
+        memcpy(&tmp, in, sizeof(tmp));
+        tmp = avs_convert_be64(tmp);
+        memcpy(value, &tmp, sizeof(tmp));
+        break;
+    }
+    case AVS_PERSISTENCE_FIELD_FLOAT: {
+        uint32_t value_be;
+        memcpy(&value_be, in, sizeof(value_be));
+        const float tmp = avs_ntohf(value_be);
+        memcpy(value, &tmp, sizeof(tmp));
+        break;
+    }
+    case AVS_PERSISTENCE_FIELD_DOUBLE: {
+        uint64_t value_be;
+        memcpy(&value_be, in, sizeof(value_be));
+        const double tmp = avs_ntohd(value_be);
+        memcpy(value, &tmp, sizeof(tmp));
+        break;
+    }
+    default:
+        memcpy(value, in, field->size);
+    }
+}
+
+static avs_error_t store_fields(avs_persistence_context_t *ctx,
+                                char *object,
+                                const avs_persistence_field_t *fields,
+                                size_t field_count,
+                                uint8_t version) {
+    char buffer[FIELDS_BUFFER_SIZE];
+    size_t buffered = 0;
+    avs_error_t err = AVS_OK;
+    for (size_t i = 0; avs_is_ok(err) && i < field_count; ++i) {
+        if (fields[i].since_version > version) {
+            continue;
+        }
+        const size_t width = field_width(&fields[i]);
+        if (buffered && (!width || buffered + width > sizeof(buffer))) {
+            err = avs_stream_write(ctx->stream, buffer, buffered);
+            buffered = 0;
+            if (avs_is_err(err)) {
+                break;
+            }
+        }
+        if (!width) {
+            err = persist_string(ctx, (char **) (object + fields[i].offset));
+        } else if (width > sizeof(buffer)) {
+            err = avs_stream_write(ctx->stream, object + fields[i].offset,
+                                   width);
+        } else {
+            encode_field(&fields[i], object, buffer + buffered);
+            buffered += width;
+        }
+    }
+    if (avs_is_ok(err) && buffered) {
+        err = avs_stream_write(ctx->stream, buffer, buffered);
+    }
+    return err;
+}
+
+static avs_error_t restore_fields(avs_persistence_context_t *ctx,
+                                  char *object,
+                                  const avs_persistence_field_t *fields,
+                                  size_t field_count,
+                                  uint8_t version) {
+    char buffer[FIELDS_BUFFER_SIZE];
+    size_t i = 0;
+    while (i < field_count) {
+        if (fields[i].since_version > version) {
+            ++i;
+            continue;
+        }
+        const size_t width = field_width(&fields[i]);
+        avs_error_t err;
+        if (!width || width > sizeof(buffer)) {
+            void *value = object + fields[i].offset;
+            if (!width) {
+                err = restore_string(ctx, (char **) value);
+            } else {
+                err = restore_bytes(ctx, value, width);
+            }
+            if (avs_is_err(err)) {
+                return err;
+            }
+            ++i;
+            continue;
+        }
+
+        size_t end = i;
+        size_t run_size = 0;
+        for (; end < field_count; ++end) {
+            if (fields[end].since_version > version) {
+                continue;
+            }
+            const size_t end_width = field_width(&fields[end]);
+            if (!end_width || run_size + end_width > sizeof(buffer)) {
+                break;
+            }
+            run_size += end_width;
+        }
+        if (avs_is_err((err = avs_stream_read_reliably(ctx->stream, buffer,
+                                                       run_size)))) {
+            return err;
+        }
+        for (size_t offset = 0; i < end; ++i) {
+            if (fields[i].since_version <= version) {
+                decode_field(&fields[i], buffer + offset, object);
+                offset += field_width(&fields[i]);
+            }
+        }
+    }
+    return AVS_OK;
+}
+
+avs_error_t avs_persistence_fields(avs_persistence_context_t *ctx,
+                                   void *object,
+                                   const avs_persistence_field_t *fields,
+                                   size_t field_count,
+                                   uint8_t version) {
+    if (!ctx) {
+        return avs_errno(AVS_EBADF);
+    }
+    avs_error_t err = validate_fields(fields, field_count);
+    if (avs_is_err(err)) {
+        return err;
+    }
+    if (ctx->vtable == &STORE_VTABLE) {
+        return store_fields(ctx, (char *) object, fields, field_count,
+                            version);
+    } else {
+        return restore_fields(ctx, (char *) object, fields, field_count,
+                              version);
+    }
+}
+
+avs_error_t
+avs_persistence_versioned_fields(avs_persistence_context_t *ctx,
+                                 void *object,
+                                 const avs_persistence_field_t *fields,
+                                 size_t field_count,
+                                 uint8_t current_version) {
+    uint8_t version = current_version;
+    avs_error_t err = avs_persistence_u8(ctx, &version);
+    if (avs_is_err(err)) {
+        return err;
+    }
+    if (version > current_version) {
+        LOG(ERROR, _("Unsupported version number: ") "%u", (unsigned) version);
+        return avs_errno(AVS_EBADMSG);
+    }
+    return avs_persistence_fields(ctx, object, fields, field_count, version);
+}
+
 #    ifdef AVS_UNIT_TESTING
 #        include "tests/persistence/persistence.c"
 #    endif
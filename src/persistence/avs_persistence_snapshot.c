@@ -0,0 +1,270 @@
+/*
+ * Copyright 2021 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#define AVS_PERSISTENCE_PERSISTENCE_SNAPSHOT_C
+#include <avs_commons_init.h>
+
+#if defined(AVS_COMMONS_WITH_AVS_PERSISTENCE) \
+        && defined(AVS_COMMONS_PERSISTENCE_WITH_SNAPSHOTS)
+
+#    include <avs_commons_posix_init.h>
+
+#    include <errno.h>
+#    include <stdio.h>
+#    include <string.h>
+
+#    include <avsystem/commons/avs_errno_map.h>
+#    include <avsystem/commons/avs_memory.h>
+#    include <avsystem/commons/avs_persistence.h>
+#    include <avsystem/commons/avs_stream_file.h>
+
+#    define MODULE_NAME avs_persistence
+#    include <avs_x_log_config.h>
+
+VISIBILITY_SOURCE_BEGIN
+
+#    define SNAPSHOT_MAGIC "AVSS"
+#    define SNAPSHOT_VERSION 1
+
+static avs_error_t errno_to_error(void) {
+    avs_errno_t err = avs_map_errno(errno);
+    return avs_errno(err ? err : AVS_EIO);
+}
+
+static avs_error_t header_handler(avs_persistence_context_t *ctx,
+                                  void *generation) {
+    static const uint8_t SUPPORTED_VERSIONS[] = { SNAPSHOT_VERSION };
+    uint8_t version = SNAPSHOT_VERSION;
+    avs_error_t err = avs_persistence_magic_string(ctx, SNAPSHOT_MAGIC);
+    if (avs_is_ok(err)) {
+        err = avs_persistence_version(ctx, &version, SUPPORTED_VERSIONS,
+                                      AVS_ARRAY_SIZE(SUPPORTED_VERSIONS));
+    }
+    if (avs_is_ok(err)) {
+        err = avs_persistence_u64(ctx, (uint64_t *) generation);
+    }
+    return err;
+}
+
+static avs_error_t restore_header(avs_persistence_context_t *ctx,
+                                  uint64_t *out_generation) {
+    avs_error_t err =
+            avs_persistence_framed_record(ctx, header_handler, out_generation);
+    if (avs_is_eof(err)) {
+        LOG(ERROR, _("Snapshot file is empty"));
+        err = avs_errno(AVS_EBADMSG);
+    }
+    return err;
+}
+
+/**
+ * Reads the generation counter of the snapshot at @p path.
+ *
+ * @param path           Path of the snapshot file.
+ * @param out_generation Set to the generation counter on success, or to 0 if
+ *                       the file does not exist.
+ *
+ * @returns @ref AVS_OK if the file does not exist or its header is valid, or an
+ *          error condition otherwise.
+ */
+static avs_error_t read_generation(const char *path,
+                                   uint64_t *out_generation) {
+    *out_generation = 0;
+    errno = 0;
+    avs_stream_t *stream = avs_stream_file_create(path, AVS_STREAM_FILE_READ);
+    if (!stream) {
+        return errno == ENOENT ? AVS_OK : errno_to_error();
+    }
+    avs_persistence_context_t ctx =
+            avs_persistence_restore_context_create(stream);
+    avs_error_t err = restore_header(&ctx, out_generation);
+    if (avs_is_err(err)) {
+        *out_generation = 0;
+    }
+    avs_stream_cleanup(&stream);
+    return err;
+}
+
+/**
+ * Determines the generation counter of the previous snapshot.
+ *
+ * A snapshot left in @p tmp_path by an interrupted store may have a higher
+ * generation than the one at @p path, so the greater of the two is used. If the
+ * snapshot at @p path exists but cannot be read, and there is no valid
+ * snapshot in @p tmp_path, the counter is unknown and an error is returned, so
+ * that it never goes backwards.
+ */
+static avs_error_t previous_generation(const char *path,
+                                       const char *tmp_path,
+                                       uint64_t *out_generation) {
+    uint64_t tmp_generation;
+    avs_error_t err = read_generation(path, out_generation);
+    if (avs_is_ok(read_generation(tmp_path, &tmp_generation))
+            && tmp_generation > *out_generation) {
+        *out_generation = tmp_generation;
+        err = AVS_OK;
+    }
+    if (avs_is_err(err)) {
+        LOG(ERROR,
+            _("Cannot read generation counter of the previous snapshot ") "%s",
+            path);
+    }
+    return err;
+}
+
+static char *
+concat(const char *prefix, size_t prefix_length, const char *suffix) {
+    size_t suffix_length = strlen(suffix);
+    char *result = (char *) avs_malloc(prefix_length + suffix_length + 1);
+    if (result) {
+        memcpy(result, prefix, prefix_length);
+        memcpy(result + prefix_length, suffix, suffix_length + 1);
+    }
+    return result;
+}
+
+static char *dir_name(const char *path) {
+    const char *slash = strrchr(path, '/');
+    if (!slash) {
+        return concat(".", 1, "");
+    }
+    return concat(path, slash == path ? 1 : (size_t) (slash - path), "");
+}
+
+static avs_error_t sync_path(const char *path, int flags) {
+    int fd = open(path, flags);
+    if (fd < 0) {
+        return errno_to_error();
+    }
+    avs_error_t err = AVS_OK;
+    if (fsync(fd)) {
+        err = errno_to_error();
+    }
+    close(fd);
+    return err;
+}
+
+static avs_error_t sync_dir(const char *path) {
+    char *dir = dir_name(path);
+    if (!dir) {
+        LOG(ERROR, _("Out of memory"));
+        return avs_errno(AVS_ENOMEM);
+    }
+    avs_error_t err = sync_path(dir, O_RDONLY);
+    // some file systems do not support synchronizing directories
+    if (err.category == AVS_ERRNO_CATEGORY && err.code == AVS_EINVAL) {
+        err = AVS_OK;
+    }
+    avs_free(dir);
+    return err;
+}
+
+static avs_error_t write_file(const char *path,
+                              uint64_t generation,
+                              avs_persistence_handler_record_t *handler,
+                              void *user_data) {
+    avs_stream_t *stream = avs_stream_file_create(path, AVS_STREAM_FILE_WRITE);
+    if (!stream) {
+        avs_error_t err = errno_to_error();
+        LOG(ERROR, _("Cannot open ") "%s" _(" for writing"), path);
+        return err;
+    }
+    avs_persistence_context_t ctx =
+            avs_persistence_store_context_create(stream);
+    avs_error_t err =
+            avs_persistence_framed_record(&ctx, header_handler, &generation);
+    if (avs_is_ok(err)) {
+        err = handler(&ctx, user_data);
+    }
+    avs_error_t cleanup_err = avs_stream_cleanup(&stream);
+    if (avs_is_ok(err)) {
+        err = cleanup_err;
+    }
+    if (avs_is_ok(err)) {
+        err = sync_path(path, O_WRONLY);
+    }
+    return err;
+}
+
+avs_error_t
+avs_persistence_snapshot_store(const char *path,
+                               avs_persistence_handler_record_t *handler,
+                               void *user_data,
+                               uint64_t *out_generation) {
+    char *tmp_path = concat(path, strlen(path), ".tmp");
+    if (!tmp_path) {
+        LOG(ERROR, _("Out of memory"));
+        return avs_errno(AVS_ENOMEM);
+    }
+
+    uint64_t generation;
+    avs_error_t err = previous_generation(path, tmp_path, &generation);
+    if (avs_is_err(err)) {
+        avs_free(tmp_path);
+        return err;
+    }
+    ++generation;
+
+    err = write_file(tmp_path, generation, handler, user_data);
+    if (avs_is_ok(err) && rename(tmp_path, path)) {
+        err = errno_to_error();
+        LOG(ERROR, _("Cannot rename ") "%s" _(" to ") "%s", tmp_path, path);
+    }
+    if (avs_is_err(err)) {
+        unlink(tmp_path);
+    } else {
+        err = sync_dir(path);
+    }
+    avs_free(tmp_path);
+
+    if (avs_is_ok(err) && out_generation) {
+        *out_generation = generation;
+    }
+    return err;
+}
+
+avs_error_t
+avs_persistence_snapshot_restore(const char *path,
+                                 avs_persistence_handler_record_t *handler,
+                                 void *user_data,
+                                 uint64_t *out_generation) {
+    avs_stream_t *stream = avs_stream_file_create(path, AVS_STREAM_FILE_READ);
+    if (!stream) {
+        avs_error_t err = errno_to_error();
+        LOG(ERROR, _("Cannot open ") "%s" _(" for reading"), path);
+        return err;
+    }
+    avs_persistence_context_t ctx =
+            avs_persistence_restore_context_create(stream);
+    uint64_t generation;
+    avs_error_t err = restore_header(&ctx, &generation);
+    if (avs_is_ok(err)) {
+        if (out_generation) {
+            *out_generation = generation;
+        }
+        err = handler(&ctx, user_data);
+    }
+    avs_stream_cleanup(&stream);
+    return err;
+}
+
+#    ifdef AVS_UNIT_TESTING
+#        include "tests/persistence/snapshot.c"
+#    endif
+
+#endif // defined(AVS_COMMONS_WITH_AVS_PERSISTENCE) &&
+       // defined(AVS_COMMONS_PERSISTENCE_WITH_SNAPSHOTS)
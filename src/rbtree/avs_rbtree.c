@@ -47,6 +47,19 @@ struct rb_tree {
 
 #    define _AVS_NODE_SPACE__ offsetof(struct rb_node_space, value)
 
+AVS_STATIC_ASSERT(offsetof(struct rb_node, parent)
+                          == offsetof(avs_rbtree_node_links__, parent),
+                  rb_node_parent_offset_matches_public_layout);
+AVS_STATIC_ASSERT(offsetof(struct rb_node, left)
+                          == offsetof(avs_rbtree_node_links__, children[0]),
+                  rb_node_left_offset_matches_public_layout);
+AVS_STATIC_ASSERT(offsetof(struct rb_node, right)
+                          == offsetof(avs_rbtree_node_links__, children[1]),
+                  rb_node_right_offset_matches_public_layout);
+AVS_STATIC_ASSERT(_AVS_NODE_SPACE__
+                          == offsetof(avs_rbtree_node_space__, value),
+                  rb_node_space_matches_public_layout);
+
 #    define _AVS_RB_NODE(elem) \
         ((struct rb_node *) ((char *) (elem) -_AVS_NODE_SPACE__))
 #    define _AVS_RB_NODE_CONST(elem) \
@@ -164,12 +177,15 @@ void avs_rbtree_delete__(AVS_RBTREE(void) *tree_ptr) {
     *tree_ptr = NULL;
 }
 
-static void rb_subtree_delete(AVS_RBTREE_ELEM(void) elem) {
+static size_t rb_subtree_delete(AVS_RBTREE_ELEM(void) elem) {
+    size_t deleted = 0;
     if (elem) {
-        rb_subtree_delete(_AVS_RB_LEFT(elem));
-        rb_subtree_delete(_AVS_RB_RIGHT(elem));
+        deleted += rb_subtree_delete(_AVS_RB_LEFT(elem));
+        deleted += rb_subtree_delete(_AVS_RB_RIGHT(elem));
         _AVS_RB_DEALLOC(_AVS_RB_NODE(elem));
+        ++deleted;
     }
+    return deleted;
 }
 
 static AVS_RBTREE_ELEM(void) rb_subtree_clone(AVS_RBTREE_ELEM(void) node,
@@ -439,7 +455,13 @@ static void rb_rotate_right(struct rb_tree *tree, AVS_RBTREE_ELEM(void) root) {
     }
 }
 
-static void rb_insert_fix(struct rb_tree *tree, AVS_RBTREE_ELEM(void) elem) {
+/**
+ * Restores the RB-tree properties after attaching @p elem.
+ *
+ * @returns 1 if the black height of the tree has grown, which happens when the
+ *          fixup reaches the root, or 0 otherwise.
+ */
+static int rb_insert_fix(struct rb_tree *tree, AVS_RBTREE_ELEM(void) elem) {
     AVS_RBTREE_ELEM(void) parent = NULL;
     AVS_RBTREE_ELEM(void) grandparent = NULL;
     AVS_RBTREE_ELEM(void) uncle = NULL;
@@ -447,7 +469,7 @@ static void rb_insert_fix(struct rb_tree *tree, AVS_RBTREE_ELEM(void) elem) {
     /* case 1 */
     if (elem == tree->root) {
         _AVS_RB_NODE(elem)->color = BLACK;
-        return;
+        return 1;
     }
 
     _AVS_RB_NODE(elem)->color = RED;
@@ -456,7 +478,7 @@ static void rb_insert_fix(struct rb_tree *tree, AVS_RBTREE_ELEM(void) elem) {
     parent = _AVS_RB_PARENT(elem);
     assert(parent);
     if (_avs_rb_node_color(parent) == BLACK) {
-        return;
+        return 0;
     }
 
     /* case 3 */
@@ -467,8 +489,7 @@ static void rb_insert_fix(struct rb_tree *tree, AVS_RBTREE_ELEM(void) elem) {
         _AVS_RB_NODE(parent)->color = BLACK;
         _AVS_RB_NODE(uncle)->color = BLACK;
         _AVS_RB_NODE(grandparent)->color = RED;
-        rb_insert_fix(tree, grandparent);
-        return;
+        return rb_insert_fix(tree, grandparent);
     }
 
     /* case 4 */
@@ -492,6 +513,7 @@ static void rb_insert_fix(struct rb_tree *tree, AVS_RBTREE_ELEM(void) elem) {
     } else {
         rb_rotate_left(tree, grandparent);
     }
+    return 0;
 }
 
 AVS_RBTREE_ELEM(void) avs_rbtree_attach__(AVS_RBTREE(void) tree_,
@@ -512,16 +534,34 @@ AVS_RBTREE_ELEM(void) avs_rbtree_attach__(AVS_RBTREE(void) tree_,
     if (*dst) {
         /* already present */
         return *dst;
-    } else {
-        *dst = elem;
-        _AVS_RB_PARENT(elem) = parent;
-        ++tree->size;
     }
 
-    rb_insert_fix(tree, elem);
+    avs_rbtree_attach_at__(tree_, parent, dst, elem);
     return elem;
 }
 
+void avs_rbtree_attach_at__(AVS_RBTREE(void) tree_,
+                            AVS_RBTREE_ELEM(void) parent,
+                            AVS_RBTREE_ELEM(void) *dst,
+                            AVS_RBTREE_ELEM(void) elem) {
+    struct rb_tree *tree = _AVS_RB_TREE(tree_);
+
+    assert(tree_);
+    assert(dst);
+    assert(!*dst);
+    assert(elem);
+    assert(rb_is_node_detached(elem));
+    assert(parent ? (dst == _AVS_RB_LEFT_PTR(parent)
+                     || dst == _AVS_RB_RIGHT_PTR(parent))
+                  : dst == &tree->root);
+
+    *dst = elem;
+    _AVS_RB_PARENT(elem) = parent;
+    ++tree->size;
+
+    (void) rb_insert_fix(tree, elem);
+}
+
 static AVS_RBTREE_ELEM(void) rb_min(AVS_RBTREE_ELEM(void) root) {
     AVS_RBTREE_ELEM(void) min = root;
     AVS_RBTREE_ELEM(void) left = root;
@@ -754,28 +794,18 @@ static void rb_detach_fix(struct rb_tree *tree,
     }
 }
 
-AVS_RBTREE_ELEM(void) avs_rbtree_detach__(AVS_RBTREE(void) tree_,
-                                          AVS_RBTREE_ELEM(void) elem) {
-    struct rb_tree *tree = _AVS_RB_TREE(tree_);
+/**
+ * Unlinks @p elem from @p tree and restores RB-tree properties. Does not
+ * update the size of @p tree, so that it may also be used on detached
+ * subtrees wrapped in a temporary struct rb_tree.
+ */
+static void rb_detach(struct rb_tree *tree, AVS_RBTREE_ELEM(void) elem) {
     AVS_RBTREE_ELEM(void) left = NULL;
     AVS_RBTREE_ELEM(void) right = NULL;
     AVS_RBTREE_ELEM(void) child = NULL;
     AVS_RBTREE_ELEM(void) parent = NULL;
     enum rb_color elem_color;
 
-    if (!elem) {
-        return NULL;
-    }
-
-    AVS_ASSERT(!rb_is_node_detached(elem),
-               "cannot detach an node that's already detached");
-    AVS_ASSERT(!rb_is_cleanup_in_progress(rb_tree_const(tree_)),
-               "avs_rbtree_detach__ called while tree deletion in progress");
-    assert(tree_);
-    assert(elem);
-    AVS_ASSERT(rb_is_node_owner(tree_, elem),
-               "cannot detach node not owned by the tree");
-
     left = _AVS_RB_LEFT(elem);
     right = _AVS_RB_RIGHT(elem);
 
@@ -802,8 +832,6 @@ AVS_RBTREE_ELEM(void) avs_rbtree_detach__(AVS_RBTREE(void) tree_,
     _AVS_RB_PARENT(elem) = NULL;
     _AVS_RB_LEFT(elem) = NULL;
     _AVS_RB_RIGHT(elem) = NULL;
-    assert(tree->size > 0u);
-    --tree->size;
 
     assert(elem_color == BLACK || _avs_rb_node_color(child) == BLACK);
     if (elem_color == RED || _avs_rb_node_color(child) == RED) {
@@ -813,16 +841,453 @@ AVS_RBTREE_ELEM(void) avs_rbtree_detach__(AVS_RBTREE(void) tree_,
             _AVS_RB_NODE(child)->color = BLACK;
         }
 
-        return elem;
+        return;
     }
 
     /* both node and child are black */
     rb_detach_fix(tree, child, parent);
 
     assert(_avs_rb_node_color(tree->root) == BLACK);
+}
+
+AVS_RBTREE_ELEM(void) avs_rbtree_detach__(AVS_RBTREE(void) tree_,
+                                          AVS_RBTREE_ELEM(void) elem) {
+    struct rb_tree *tree = _AVS_RB_TREE(tree_);
+
+    if (!elem) {
+        return NULL;
+    }
+
+    AVS_ASSERT(!rb_is_node_detached(elem),
+               "cannot detach an node that's already detached");
+    AVS_ASSERT(!rb_is_cleanup_in_progress(rb_tree_const(tree_)),
+               "avs_rbtree_detach__ called while tree deletion in progress");
+    assert(tree_);
+    assert(elem);
+    AVS_ASSERT(rb_is_node_owner(tree_, elem),
+               "cannot detach node not owned by the tree");
+
+    rb_detach(tree, elem);
+    assert(tree->size > 0u);
+    --tree->size;
     return elem;
 }
 
+/**
+ * Returns the number of black nodes on any path from @p root to a leaf,
+ * including @p root itself.
+ *
+ * Complexity: O(log n).
+ */
+static size_t rb_black_height(AVS_RBTREE_ELEM(void) root) {
+    size_t height = 0;
+    while (root) {
+        if (_avs_rb_node_color(root) == BLACK) {
+            ++height;
+        }
+        root = _AVS_RB_LEFT(root);
+    }
+    return height;
+}
+
+/**
+ * Standalone subtree along with its black height, as computed by
+ * rb_black_height(). The height is carried through split and join operations,
+ * so that they do not need to walk the spines to recompute it.
+ */
+struct rb_subtree {
+    void *root;
+    size_t black_height;
+};
+
+/**
+ * Turns @p root into a root of a standalone subtree. Repainting the root
+ * black never violates any of the RB-tree properties.
+ */
+static AVS_RBTREE_ELEM(void) rb_subtree_unlink(AVS_RBTREE_ELEM(void) root) {
+    if (root) {
+        _AVS_RB_PARENT(root) = NULL;
+        _AVS_RB_NODE(root)->color = BLACK;
+    }
+    return root;
+}
+
+/**
+ * Turns @p root of a whole tree into a standalone subtree.
+ *
+ * Complexity: O(log n).
+ */
+static struct rb_subtree rb_subtree_from_root(AVS_RBTREE_ELEM(void) root) {
+    struct rb_subtree result;
+    result.root = rb_subtree_unlink(root);
+    result.black_height = rb_black_height(root);
+    return result;
+}
+
+/**
+ * Turns @p child of a black node with black height @p parent_height into a
+ * standalone subtree. If @p child is red, repainting it black increases its
+ * black height by one.
+ */
+static struct rb_subtree rb_child_unlink(AVS_RBTREE_ELEM(void) child,
+                                         size_t parent_height) {
+    struct rb_subtree result;
+    assert(parent_height > 0);
+    result.black_height = parent_height - 1;
+    if (child && _avs_rb_node_color(child) == RED) {
+        ++result.black_height;
+    }
+    result.root = rb_subtree_unlink(child);
+    return result;
+}
+
+/**
+ * Cuts @p node, the root of standalone subtree @p subtree, out of it, leaving
+ * it in a detached state and returning both of its children as standalone
+ * subtrees.
+ */
+static void rb_node_unlink(struct rb_subtree subtree,
+                           struct rb_subtree *out_left,
+                           struct rb_subtree *out_right) {
+    AVS_RBTREE_ELEM(void) node = subtree.root;
+    assert(_avs_rb_node_color(node) == BLACK);
+    *out_left = rb_child_unlink(_AVS_RB_LEFT(node), subtree.black_height);
+    *out_right = rb_child_unlink(_AVS_RB_RIGHT(node), subtree.black_height);
+    _AVS_RB_NODE(node)->color = DETACHED;
+    _AVS_RB_PARENT(node) = NULL;
+    _AVS_RB_LEFT(node) = NULL;
+    _AVS_RB_RIGHT(node) = NULL;
+}
+
+/**
+ * Joins two standalone subtrees using a detached @p mid node as a separator.
+ * All elements in @p left MUST be less than @p mid, and all elements in
+ * @p right MUST be greater than @p mid.
+ *
+ * @p mid is inserted at the spine of the taller subtree at the point where
+ * black heights match, and then the standard insertion fixup is performed.
+ *
+ * Complexity: O(|bh(left) - bh(right)| + 1).
+ *
+ * @returns Joined subtree.
+ */
+static struct rb_subtree rb_join3(struct rb_subtree left,
+                                  AVS_RBTREE_ELEM(void) mid,
+                                  struct rb_subtree right) {
+    struct rb_tree tmp = { 0, NULL, NULL };
+    AVS_RBTREE_ELEM(void) *dst = &tmp.root;
+    AVS_RBTREE_ELEM(void) parent = NULL;
+    struct rb_subtree result;
+
+    assert(rb_is_node_detached(mid));
+    assert(left.black_height == rb_black_height(left.root));
+    assert(right.black_height == rb_black_height(right.root));
+
+    if (left.black_height >= right.black_height) {
+        size_t height = left.black_height;
+        tmp.root = left.root;
+        while (*dst
+               && (_avs_rb_node_color(*dst) == RED
+                   || height > right.black_height)) {
+            if (_avs_rb_node_color(*dst) == BLACK) {
+                --height;
+            }
+            parent = *dst;
+            dst = _AVS_RB_RIGHT_PTR(parent);
+        }
+        _AVS_RB_LEFT(mid) = *dst;
+        _AVS_RB_RIGHT(mid) = right.root;
+        result.black_height = left.black_height;
+    } else {
+        size_t height = right.black_height;
+        tmp.root = right.root;
+        while (*dst
+               && (_avs_rb_node_color(*dst) == RED
+                   || height > left.black_height)) {
+            if (_avs_rb_node_color(*dst) == BLACK) {
+                --height;
+            }
+            parent = *dst;
+            dst = _AVS_RB_LEFT_PTR(parent);
+        }
+        _AVS_RB_LEFT(mid) = left.root;
+        _AVS_RB_RIGHT(mid) = *dst;
+        result.black_height = right.black_height;
+    }
+
+    if (_AVS_RB_LEFT(mid)) {
+        AVS_RBTREE_ELEM(void) child = _AVS_RB_LEFT(mid);
+        _AVS_RB_PARENT(child) = mid;
+    }
+    if (_AVS_RB_RIGHT(mid)) {
+        AVS_RBTREE_ELEM(void) child = _AVS_RB_RIGHT(mid);
+        _AVS_RB_PARENT(child) = mid;
+    }
+    _AVS_RB_PARENT(mid) = parent;
+    *dst = mid;
+
+    result.black_height += (size_t) rb_insert_fix(&tmp, mid);
+    result.root = tmp.root;
+    return result;
+}
+
+/**
+ * Joins two standalone subtrees, where all elements in @p left are less than
+ * all elements in @p right.
+ *
+ * Complexity: O(log n).
+ *
+ * @returns Joined subtree.
+ */
+static struct rb_subtree rb_join2(struct rb_subtree left,
+                                  struct rb_subtree right) {
+    struct rb_tree tmp = { 0, NULL, NULL };
+    AVS_RBTREE_ELEM(void) mid;
+
+    if (!left.root) {
+        return right;
+    } else if (!right.root) {
+        return left;
+    }
+
+    tmp.root = right.root;
+    mid = rb_min(right.root);
+    rb_detach(&tmp, mid);
+    return rb_join3(left, mid, rb_subtree_from_root(tmp.root));
+}
+
+/**
+ * Splits a standalone subtree into two standalone subtrees: @p out_left
+ * containing elements less than @p value and @p out_right containing the rest.
+ *
+ * If @p out_equal is not NULL, the element equivalent to @p value (if any) is
+ * detached and returned through it instead of being put into @p out_right.
+ *
+ * The costs of the joins performed on the way back from the recursion
+ * telescope to O(log n), as black heights of the subtrees are carried along
+ * instead of being recomputed.
+ *
+ * Complexity: O((log n) * c), where:
+ * - n - number of nodes in @p root,
+ * - c - complexity of tree element comparator.
+ */
+static void rb_split(avs_rbtree_element_comparator_t *cmp,
+                     struct rb_subtree root,
+                     const void *value,
+                     struct rb_subtree *out_left,
+                     AVS_RBTREE_ELEM(void) *out_equal,
+                     struct rb_subtree *out_right) {
+    struct rb_subtree left;
+    struct rb_subtree right;
+    struct rb_subtree sub;
+    int result;
+
+    if (!root.root) {
+        out_left->root = NULL;
+        out_left->black_height = 0;
+        *out_right = *out_left;
+        if (out_equal) {
+            *out_equal = NULL;
+        }
+        return;
+    }
+
+    result = cmp(value, root.root);
+    rb_node_unlink(root, &left, &right);
+
+    if (result == 0 && out_equal) {
+        *out_left = left;
+        *out_equal = root.root;
+        *out_right = right;
+    } else if (result <= 0) {
+        rb_split(cmp, left, value, out_left, out_equal, &sub);
+        *out_right = rb_join3(sub, root.root, right);
+    } else {
+        rb_split(cmp, right, value, &sub, out_equal, out_right);
+        *out_left = rb_join3(left, root.root, sub);
+    }
+}
+
+/**
+ * Computes the union of two standalone subtrees. Elements of @p b that have
+ * an equivalent in @p a are appended to @p duplicates instead, and counted in
+ * @p duplicates_count.
+ *
+ * Complexity: O((m log(n/m + 1)) * c), where:
+ * - m, n - sizes of the smaller and the larger of input subtrees,
+ * - c - complexity of tree element comparator.
+ *
+ * @returns Merged subtree.
+ */
+static struct rb_subtree rb_union(avs_rbtree_element_comparator_t *cmp,
+                                  struct rb_subtree a,
+                                  struct rb_subtree b,
+                                  struct rb_subtree *duplicates,
+                                  size_t *duplicates_count) {
+    struct rb_subtree a_left;
+    struct rb_subtree a_right;
+    struct rb_subtree b_left;
+    AVS_RBTREE_ELEM(void) b_equal;
+    struct rb_subtree b_right;
+    static const struct rb_subtree EMPTY = { NULL, 0 };
+
+    if (!b.root) {
+        return a;
+    } else if (!a.root) {
+        return b;
+    }
+
+    rb_node_unlink(a, &a_left, &a_right);
+    rb_split(cmp, b, a.root, &b_left, &b_equal, &b_right);
+
+    a_left = rb_union(cmp, a_left, b_left, duplicates, duplicates_count);
+    if (b_equal) {
+        /* duplicates are discovered in order, so always append them */
+        *duplicates = rb_join3(*duplicates, b_equal, EMPTY);
+        ++*duplicates_count;
+    }
+    a_right = rb_union(cmp, a_right, b_right, duplicates, duplicates_count);
+
+    return rb_join3(a_left, a.root, a_right);
+}
+
+/**
+ * Recalculates sizes of two trees that were created by splitting a tree with
+ * @p total_size elements. Iterates over both trees simultaneously, so that only
+ * the smaller one needs to be traversed completely.
+ *
+ * Complexity: O(log n + min(|a|, |b|)).
+ */
+static void rb_update_split_sizes(struct rb_tree *a,
+                                  struct rb_tree *b,
+                                  size_t total_size) {
+    AVS_RBTREE_ELEM(void) a_it = rb_min(a->root);
+    AVS_RBTREE_ELEM(void) b_it = rb_min(b->root);
+    size_t count = 0;
+
+    while (a_it && b_it) {
+        a_it = avs_rbtree_elem_next__(a_it);
+        b_it = avs_rbtree_elem_next__(b_it);
+        ++count;
+    }
+
+    if (!a_it) {
+        a->size = count;
+        b->size = total_size - count;
+    } else {
+        a->size = total_size - count;
+        b->size = count;
+    }
+}
+
+void avs_rbtree_split__(AVS_RBTREE(void) tree_,
+                        const void *value,
+                        AVS_RBTREE(void) dst_) {
+    struct rb_tree *tree = _AVS_RB_TREE(tree_);
+    struct rb_tree *dst = _AVS_RB_TREE(dst_);
+    struct rb_subtree left;
+    struct rb_subtree right;
+
+    AVS_ASSERT(!rb_is_cleanup_in_progress(rb_tree_const(tree_)),
+               "avs_rbtree_split__ called while tree deletion in progress");
+    assert(tree_);
+    assert(dst_);
+    assert(value);
+    AVS_ASSERT(!dst->root, "split destination tree must be empty");
+
+    rb_split(tree->cmp, rb_subtree_from_root(tree->root), value, &left, NULL,
+             &right);
+    tree->root = left.root;
+    dst->root = right.root;
+    rb_update_split_sizes(tree, dst, tree->size);
+}
+
+int avs_rbtree_join__(AVS_RBTREE(void) dst_, AVS_RBTREE(void) src_) {
+    struct rb_tree *dst = _AVS_RB_TREE(dst_);
+    struct rb_tree *src = _AVS_RB_TREE(src_);
+    AVS_RBTREE_ELEM(void) mid;
+
+    AVS_ASSERT(!rb_is_cleanup_in_progress(rb_tree_const(dst_))
+                       && !rb_is_cleanup_in_progress(rb_tree_const(src_)),
+               "avs_rbtree_join__ called while tree deletion in progress");
+    assert(dst_);
+    assert(src_);
+
+    if (!src->root) {
+        return 0;
+    }
+
+    mid = rb_min(src->root);
+    if (dst->root && dst->cmp(rb_max(dst->root), mid) >= 0) {
+        return -1;
+    }
+
+    rb_detach(src, mid);
+    dst->root = rb_join3(rb_subtree_from_root(dst->root), mid,
+                         rb_subtree_from_root(src->root))
+                        .root;
+    dst->size += src->size;
+    src->root = NULL;
+    src->size = 0;
+    return 0;
+}
+
+size_t avs_rbtree_erase_range__(AVS_RBTREE(void) tree_,
+                                const void *begin,
+                                const void *end) {
+    struct rb_tree *tree = _AVS_RB_TREE(tree_);
+    struct rb_subtree left;
+    struct rb_subtree range;
+    struct rb_subtree right;
+    size_t erased;
+
+    AVS_ASSERT(
+            !rb_is_cleanup_in_progress(rb_tree_const(tree_)),
+            "avs_rbtree_erase_range__ called while tree deletion in progress");
+    assert(tree_);
+    assert(begin);
+    assert(end);
+
+    if (tree->cmp(begin, end) >= 0) {
+        return 0;
+    }
+
+    rb_split(tree->cmp, rb_subtree_from_root(tree->root), begin, &left, NULL,
+             &right);
+    rb_split(tree->cmp, right, end, &range, NULL, &right);
+    tree->root = rb_join2(left, right).root;
+
+    erased = rb_subtree_delete(range.root);
+    assert(tree->size >= erased);
+    tree->size -= erased;
+    return erased;
+}
+
+size_t avs_rbtree_merge__(AVS_RBTREE(void) dst_, AVS_RBTREE(void) src_) {
+    struct rb_tree *dst = _AVS_RB_TREE(dst_);
+    struct rb_tree *src = _AVS_RB_TREE(src_);
+    struct rb_subtree duplicates = { NULL, 0 };
+    size_t duplicates_count = 0;
+    size_t moved;
+
+    AVS_ASSERT(!rb_is_cleanup_in_progress(rb_tree_const(dst_))
+                       && !rb_is_cleanup_in_progress(rb_tree_const(src_)),
+               "avs_rbtree_merge__ called while tree deletion in progress");
+    assert(dst_);
+    assert(src_);
+
+    dst->root = rb_union(dst->cmp, rb_subtree_from_root(dst->root),
+                         rb_subtree_from_root(src->root), &duplicates,
+                         &duplicates_count)
+                        .root;
+    assert(src->size >= duplicates_count);
+    moved = src->size - duplicates_count;
+    dst->size += moved;
+    src->root = duplicates.root;
+    src->size = duplicates_count;
+    return moved;
+}
+
 static AVS_RBTREE_ELEM(void) rb_postorder_first(AVS_RBTREE_ELEM(void) node) {
     while (node) {
         if (_AVS_RB_LEFT(node)) {
@@ -25,6 +25,7 @@
 
 #    include <avsystem/commons/avs_list.h>
 #    include <avsystem/commons/avs_sched.h>
+#    include <avsystem/commons/avs_trace.h>
 #    include <avsystem/commons/avs_utils.h>
 
 #    ifdef AVS_COMMONS_SCHED_THREAD_SAFE
@@ -40,6 +41,10 @@
 #        define avs_mutex_unlock(...) ((void) 0)
 #    endif // AVS_COMMONS_SCHED_THREAD_SAFE
 
+#    ifdef AVS_COMMONS_SCHED_WITH_POLLABLE_FD
+#        include "avs_sched_pollable.h"
+#    endif // AVS_COMMONS_SCHED_WITH_POLLABLE_FD
+
 #    define MODULE_NAME avs_sched
 #    include <avs_x_log_config.h>
 
@@ -55,7 +60,8 @@ struct avs_sched_job_struct {
     /** Instant in time at which the job is scheduled. */
     avs_time_monotonic_t instant;
 
-#    ifdef AVS_COMMONS_WITH_INTERNAL_LOGS
+#    if defined(AVS_COMMONS_WITH_INTERNAL_LOGS) \
+            || defined(AVS_COMMONS_SCHED_WITH_METRICS)
     struct {
         /** File from which AVS_SCHED*() was called. */
         const char *file;
@@ -64,7 +70,8 @@ struct avs_sched_job_struct {
         /** Stringified value of what was passed as the callback function. */
         const char *name;
     } log_info;
-#    endif // AVS_COMMONS_WITH_INTERNAL_LOGS
+#    endif // defined(AVS_COMMONS_WITH_INTERNAL_LOGS) ||
+           // defined(AVS_COMMONS_SCHED_WITH_METRICS)
 
     /** Callback function to execute. */
     avs_sched_clb_t *clb;
@@ -74,6 +81,43 @@ struct avs_sched_job_struct {
     avs_max_align_t clb_data[];
 };
 
+#    ifdef AVS_COMMONS_SCHED_WITH_METRICS
+typedef struct {
+    /** Metrics returned by @ref avs_sched_metrics_get . */
+    avs_sched_metrics_t data;
+
+    /** Threshold set using @ref avs_sched_set_slow_job_handler . */
+    avs_time_duration_t slow_job_threshold;
+
+    /** Handler set using @ref avs_sched_set_slow_job_handler . */
+    avs_sched_slow_job_handler_t *slow_job_handler;
+
+    /** Argument for @ref sched_metrics_t.slow_job_handler . */
+    void *slow_job_handler_arg;
+} sched_metrics_t;
+
+/**
+ * Measurements of the job most recently executed by @ref avs_sched_run . They
+ * are added to the metrics when the next job is fetched, so that no critical
+ * section other than the one in @ref fetch_job is entered for each job.
+ */
+typedef struct {
+    /** Set if a job has been executed, but not added to the metrics yet. */
+    bool pending;
+    avs_time_duration_t lateness;
+    avs_time_duration_t execution_time;
+
+    /** Copies of the slow job handler settings, made while fetching. */
+    avs_time_duration_t slow_job_threshold;
+    avs_sched_slow_job_handler_t *slow_job_handler;
+    void *slow_job_handler_arg;
+} job_measurement_t;
+#    else  // AVS_COMMONS_SCHED_WITH_METRICS
+typedef struct {
+    bool pending;
+} job_measurement_t;
+#    endif // AVS_COMMONS_SCHED_WITH_METRICS
+
 struct avs_sched_struct {
 #    ifdef AVS_COMMONS_WITH_INTERNAL_LOGS
     /** Name of the scheduler. */
@@ -104,6 +148,21 @@ struct avs_sched_struct {
      * down.
      */
     bool shutting_down;
+
+#    ifdef AVS_COMMONS_SCHED_WITH_METRICS
+    /**
+     * Scheduler metrics. Guarded by the same mutex as the jobs list.
+     */
+    sched_metrics_t metrics;
+#    endif // AVS_COMMONS_SCHED_WITH_METRICS
+
+#    ifdef AVS_COMMONS_SCHED_WITH_POLLABLE_FD
+    /**
+     * Descriptor returned by @ref avs_sched_get_pollable_fd . Guarded by the
+     * same mutex as the jobs list.
+     */
+    _avs_sched_pollable_t pollable;
+#    endif // AVS_COMMONS_SCHED_WITH_POLLABLE_FD
 };
 
 #    ifdef AVS_COMMONS_SCHED_THREAD_SAFE
@@ -188,6 +247,128 @@ static const char *job_log_id_impl(char buf[static JOB_LOG_ID_MAX_LENGTH],
 
 #    endif // AVS_COMMONS_WITH_INTERNAL_LOGS
 
+#    ifdef AVS_COMMONS_SCHED_WITH_METRICS
+static size_t histogram_bucket(avs_time_duration_t value) {
+    int64_t us;
+    if (avs_time_duration_to_scalar(&us, AVS_TIME_US, value) || us <= 0) {
+        return 0;
+    }
+    if (us < AVS_SCHED_HISTOGRAM_SUB_BUCKETS) {
+        return (size_t) us;
+    }
+    // index of the most significant bit; at least 2 here
+    unsigned msb = 0;
+    while ((uint64_t) us >> (msb + 1)) {
+        ++msb;
+    }
+    size_t bucket = (size_t) (msb - 1) * AVS_SCHED_HISTOGRAM_SUB_BUCKETS
+                    + (size_t) (((uint64_t) us >> (msb - 2))
+                                & (AVS_SCHED_HISTOGRAM_SUB_BUCKETS - 1));
+    return AVS_MIN(bucket, (size_t) AVS_SCHED_HISTOGRAM_BUCKETS - 1);
+}
+
+avs_time_duration_t avs_sched_histogram_bucket_lower_bound(size_t index) {
+    assert(index < AVS_SCHED_HISTOGRAM_BUCKETS);
+    if (index < AVS_SCHED_HISTOGRAM_SUB_BUCKETS) {
+        return avs_time_duration_from_scalar((int64_t) index, AVS_TIME_US);
+    }
+    unsigned msb = (unsigned) (index / AVS_SCHED_HISTOGRAM_SUB_BUCKETS) + 1;
+    uint64_t mantissa = AVS_SCHED_HISTOGRAM_SUB_BUCKETS
+                        + index % AVS_SCHED_HISTOGRAM_SUB_BUCKETS;
+    return avs_time_duration_from_scalar((int64_t) (mantissa << (msb - 2)),
+                                         AVS_TIME_US);
+}
+
+static void histogram_add(avs_sched_histogram_t *histogram,
+                          avs_time_duration_t value) {
+    ++histogram->buckets[histogram_bucket(value)];
+    ++histogram->count;
+    histogram->total = avs_time_duration_add(histogram->total, value);
+    if (avs_time_duration_less(histogram->max, value)) {
+        histogram->max = value;
+    }
+}
+
+static void metrics_job_added_locked(avs_sched_t *sched) {
+    avs_sched_metrics_t *data = &sched->metrics.data;
+    if (++data->queue_depth > data->max_queue_depth) {
+        data->max_queue_depth = data->queue_depth;
+    }
+}
+
+static void metrics_job_removed_locked(avs_sched_t *sched) {
+    assert(sched->metrics.data.queue_depth > 0);
+    --sched->metrics.data.queue_depth;
+}
+
+static void metrics_job_fetched_locked(avs_sched_t *sched,
+                                       job_measurement_t *measurement) {
+    if (measurement->pending) {
+        histogram_add(&sched->metrics.data.lateness, measurement->lateness);
+        histogram_add(&sched->metrics.data.execution_time,
+                      measurement->execution_time);
+        ++sched->metrics.data.jobs_executed;
+        measurement->pending = false;
+    }
+    measurement->slow_job_threshold = sched->metrics.slow_job_threshold;
+    measurement->slow_job_handler = sched->metrics.slow_job_handler;
+    measurement->slow_job_handler_arg = sched->metrics.slow_job_handler_arg;
+}
+
+static void metrics_job_executed(avs_sched_t *sched,
+                                 const avs_sched_job_t *job,
+                                 avs_time_monotonic_t started,
+                                 job_measurement_t *measurement) {
+    measurement->lateness = avs_time_monotonic_diff(started, job->instant);
+    measurement->execution_time =
+            avs_time_monotonic_diff(avs_time_monotonic_now(), started);
+    measurement->pending = true;
+
+    if (measurement->slow_job_handler
+            && !avs_time_duration_less(measurement->execution_time,
+                                       measurement->slow_job_threshold)) {
+        measurement->slow_job_handler(sched, job->log_info.name, job->clb,
+                                      measurement->lateness,
+                                      measurement->execution_time,
+                                      measurement->slow_job_handler_arg);
+    }
+}
+
+void avs_sched_metrics_get(avs_sched_t *sched,
+                           avs_sched_metrics_t *out_metrics) {
+    assert(sched);
+    assert(out_metrics);
+    nonfailing_mutex_lock(sched->mutex);
+    *out_metrics = sched->metrics.data;
+    avs_mutex_unlock(sched->mutex);
+}
+
+void avs_sched_metrics_reset(avs_sched_t *sched) {
+    assert(sched);
+    nonfailing_mutex_lock(sched->mutex);
+    size_t queue_depth = sched->metrics.data.queue_depth;
+    memset(&sched->metrics.data, 0, sizeof(sched->metrics.data));
+    sched->metrics.data.queue_depth = queue_depth;
+    sched->metrics.data.max_queue_depth = queue_depth;
+    avs_mutex_unlock(sched->mutex);
+}
+
+void avs_sched_set_slow_job_handler(avs_sched_t *sched,
+                                    avs_time_duration_t threshold,
+                                    avs_sched_slow_job_handler_t *handler,
+                                    void *arg) {
+    assert(sched);
+    nonfailing_mutex_lock(sched->mutex);
+    sched->metrics.slow_job_threshold = threshold;
+    sched->metrics.slow_job_handler = handler;
+    sched->metrics.slow_job_handler_arg = arg;
+    avs_mutex_unlock(sched->mutex);
+}
+#    else // AVS_COMMONS_SCHED_WITH_METRICS
+#        define metrics_job_added_locked(...) ((void) 0)
+#        define metrics_job_removed_locked(...) ((void) 0)
+#    endif // AVS_COMMONS_SCHED_WITH_METRICS
+
 avs_sched_t *avs_sched_new(const char *name, void *data) {
 #    ifdef AVS_COMMONS_SCHED_THREAD_SAFE
     if (avs_init_once(&g_init_handle, init_globals, NULL)) {
@@ -214,6 +395,9 @@ avs_sched_t *avs_sched_new(const char *name, void *data) {
         return NULL;
     }
     sched->data = data;
+#    ifdef AVS_COMMONS_SCHED_WITH_POLLABLE_FD
+    _avs_sched_pollable_init(&sched->pollable);
+#    endif // AVS_COMMONS_SCHED_WITH_POLLABLE_FD
     LOG(DEBUG, _("Scheduler \"") "%s" _("\" created, data == ") "%p",
         (sched->name = (name ? name : "(unknown)")), data);
     return sched;
@@ -235,9 +419,13 @@ void avs_sched_cleanup(avs_sched_t **sched_ptr) {
         if ((*sched_ptr)->jobs->handle_ptr) {
             *(*sched_ptr)->jobs->handle_ptr = NULL;
         }
+        metrics_job_removed_locked(*sched_ptr);
     }
     avs_mutex_unlock(g_handle_access_mutex);
 
+#    ifdef AVS_COMMONS_SCHED_WITH_POLLABLE_FD
+    _avs_sched_pollable_close(&(*sched_ptr)->pollable);
+#    endif // AVS_COMMONS_SCHED_WITH_POLLABLE_FD
     avs_condvar_cleanup(&(*sched_ptr)->task_condvar);
     avs_mutex_cleanup(&(*sched_ptr)->mutex);
 
@@ -267,6 +455,33 @@ avs_time_monotonic_t avs_sched_time_of_next(avs_sched_t *sched) {
     return result;
 }
 
+/**
+ * Wakes up anyone waiting for the scheduler, after the time of the earliest
+ * job might have changed.
+ */
+static void notify_locked(avs_sched_t *sched) {
+    avs_condvar_notify_all(sched->task_condvar);
+#    ifdef AVS_COMMONS_SCHED_WITH_POLLABLE_FD
+    _avs_sched_pollable_update(&sched->pollable,
+                               sched_time_of_next_locked(sched), true);
+#    endif // AVS_COMMONS_SCHED_WITH_POLLABLE_FD
+}
+
+#    ifdef AVS_COMMONS_SCHED_WITH_POLLABLE_FD
+int avs_sched_get_pollable_fd(avs_sched_t *sched) {
+    assert(sched);
+    nonfailing_mutex_lock(sched->mutex);
+    int result = -1;
+    if (!_avs_sched_pollable_open(&sched->pollable)) {
+        _avs_sched_pollable_update(&sched->pollable,
+                                   sched_time_of_next_locked(sched), true);
+        result = sched->pollable.fd;
+    }
+    avs_mutex_unlock(sched->mutex);
+    return result;
+}
+#    endif // AVS_COMMONS_SCHED_WITH_POLLABLE_FD
+
 int avs_sched_wait_until_next(avs_sched_t *sched,
                               avs_time_monotonic_t deadline) {
 #    ifdef AVS_COMMONS_SCHED_THREAD_SAFE
@@ -306,10 +521,21 @@ int avs_sched_wait_until_next(avs_sched_t *sched,
 #    endif // AVS_COMMONS_SCHED_THREAD_SAFE
 }
 
+/**
+ * Detaches the first job if it is due before @p deadline. Measurements of the
+ * previously executed job, if any, are added to the metrics in the same
+ * critical section.
+ */
 static AVS_LIST(avs_sched_job_t) fetch_job(avs_sched_t *sched,
-                                           avs_time_monotonic_t deadline) {
+                                           avs_time_monotonic_t deadline,
+                                           job_measurement_t *measurement) {
     AVS_LIST(avs_sched_job_t) result = NULL;
     nonfailing_mutex_lock(sched->mutex);
+#    ifdef AVS_COMMONS_SCHED_WITH_METRICS
+    metrics_job_fetched_locked(sched, measurement);
+#    else  // AVS_COMMONS_SCHED_WITH_METRICS
+    (void) measurement;
+#    endif // AVS_COMMONS_SCHED_WITH_METRICS
     if (sched->jobs
             && avs_time_monotonic_before(sched->jobs->instant, deadline)) {
         if (sched->jobs->handle_ptr) {
@@ -320,35 +546,62 @@ static AVS_LIST(avs_sched_job_t) fetch_job(avs_sched_t *sched,
             sched->jobs->handle_ptr = NULL;
         }
         result = AVS_LIST_DETACH(&sched->jobs);
+        metrics_job_removed_locked(sched);
     }
     avs_mutex_unlock(sched->mutex);
     return result;
 }
 
-static void execute_job(avs_sched_t *sched, AVS_LIST(avs_sched_job_t) job) {
+static void execute_job(avs_sched_t *sched,
+                        AVS_LIST(avs_sched_job_t) job,
+                        job_measurement_t *measurement) {
     // make sure that the task is detached
     assert(!AVS_LIST_NEXT(job));
 
     SCHED_LOG(sched, TRACE, _("executing job") "%s", JOB_LOG_ID(job));
 
+    AVS_TRACE_BEGIN("sched", "job");
+#    ifdef AVS_COMMONS_SCHED_WITH_METRICS
+    avs_time_monotonic_t started = avs_time_monotonic_now();
     job->clb(sched, job->clb_data);
+    metrics_job_executed(sched, job, started, measurement);
+#    else  // AVS_COMMONS_SCHED_WITH_METRICS
+    (void) measurement;
+    job->clb(sched, job->clb_data);
+#    endif // AVS_COMMONS_SCHED_WITH_METRICS
+    AVS_TRACE_END("sched", "job");
     AVS_LIST_DELETE(&job);
 }
 
 void avs_sched_run(avs_sched_t *sched) {
     assert(sched);
+#    ifdef AVS_COMMONS_SCHED_WITH_POLLABLE_FD
+    nonfailing_mutex_lock(sched->mutex);
+    _avs_sched_pollable_drain(&sched->pollable);
+    avs_mutex_unlock(sched->mutex);
+#    endif // AVS_COMMONS_SCHED_WITH_POLLABLE_FD
     avs_time_monotonic_t now = avs_time_monotonic_now();
 
     uint32_t tasks_executed = 0;
     AVS_LIST(avs_sched_job_t) job = NULL;
-    while ((job = fetch_job(sched, now))) {
+    job_measurement_t measurement = { .pending = false };
+    // the last call also records the measurements of the last job
+    while ((job = fetch_job(sched, now, &measurement))) {
         assert(job->sched == sched);
-        execute_job(sched, job);
+        execute_job(sched, job, &measurement);
         ++tasks_executed;
     }
+    assert(!measurement.pending);
 
     SCHED_LOG(sched, TRACE, "%" PRIu32 _(" jobs executed"), tasks_executed);
 
+#    ifdef AVS_COMMONS_SCHED_WITH_POLLABLE_FD
+    nonfailing_mutex_lock(sched->mutex);
+    _avs_sched_pollable_update(&sched->pollable,
+                               sched_time_of_next_locked(sched), false);
+    avs_mutex_unlock(sched->mutex);
+#    endif // AVS_COMMONS_SCHED_WITH_POLLABLE_FD
+
 #    ifdef AVS_COMMONS_WITH_INTERNAL_TRACE
     avs_time_monotonic_t next = avs_sched_time_of_next(sched);
     avs_time_duration_t remaining = avs_time_monotonic_diff(next, now);
@@ -371,6 +624,7 @@ static void schedule_job(avs_sched_t *sched, avs_sched_job_t *job) {
         AVS_LIST_ADVANCE_PTR(&insert_ptr);
     }
     AVS_LIST_INSERT(insert_ptr, job);
+    metrics_job_added_locked(sched);
 }
 
 static int sched_at_locked(avs_sched_t *sched,
@@ -405,11 +659,13 @@ static int sched_at_locked(avs_sched_t *sched,
 
     job->sched = sched;
     job->instant = instant;
-#    ifdef AVS_COMMONS_WITH_INTERNAL_LOGS
+#    if defined(AVS_COMMONS_WITH_INTERNAL_LOGS) \
+            || defined(AVS_COMMONS_SCHED_WITH_METRICS)
     job->log_info.file = log_file;
     job->log_info.line = log_line;
     job->log_info.name = log_name;
-#    endif // AVS_COMMONS_WITH_INTERNAL_LOGS
+#    endif // defined(AVS_COMMONS_WITH_INTERNAL_LOGS) ||
+           // defined(AVS_COMMONS_SCHED_WITH_METRICS)
     job->clb = clb;
     if (clb_data_size) {
         memcpy(job->clb_data, clb_data, clb_data_size);
@@ -432,6 +688,7 @@ static int sched_at_locked(avs_sched_t *sched,
                       JOB_LOG_ID(*job_ptr),
                       JOB_LOG_ID_EXPLICIT(log_file, log_line, log_name));
             AVS_LIST_DELETE(job_ptr);
+            metrics_job_removed_locked(sched);
         }
         *out_handle = job;
         avs_mutex_unlock(g_handle_access_mutex);
@@ -479,7 +736,7 @@ int avs_sched_at_impl__(avs_sched_t *sched,
     if (!(result = sched_at_locked(sched, out_handle, instant, log_file,
                                    log_line, log_name, clb, clb_data,
                                    clb_data_size))) {
-        avs_condvar_notify_all(sched->task_condvar);
+        notify_locked(sched);
     }
     avs_mutex_unlock(sched->mutex);
     return result;
@@ -530,6 +787,7 @@ void avs_sched_del(avs_sched_handle_t *handle_ptr) {
         avs_mutex_unlock(g_handle_access_mutex);
 
         AVS_LIST_DELETE(job_ptr);
+        metrics_job_removed_locked(sched);
     }
     avs_mutex_unlock(sched->mutex);
 }
@@ -588,7 +846,7 @@ int avs_sched_leap_time(avs_sched_t *sched, avs_time_duration_t diff) {
     AVS_LIST_FOREACH(job, sched->jobs) {
         job->instant = avs_time_monotonic_add(job->instant, diff);
     }
-    avs_condvar_notify_all(sched->task_condvar);
+    notify_locked(sched);
 
     avs_mutex_unlock(sched->mutex);
     return 0;
@@ -628,10 +886,11 @@ int avs_resched_at_impl__(avs_sched_handle_t *handle_ptr,
                   JOB_LOG_ID(*job_ptr));
 
         avs_sched_job_t *detached_job = AVS_LIST_DETACH(job_ptr);
+        metrics_job_removed_locked(sched);
         detached_job->instant = instant;
 
         schedule_job(sched, detached_job);
-        avs_condvar_notify_all(sched->task_condvar);
+        notify_locked(sched);
     } else {
 #    ifndef AVS_COMMONS_SCHED_THREAD_SAFE
         AVS_ASSERT(job_ptr, "dangling handle detected");
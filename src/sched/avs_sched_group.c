@@ -0,0 +1,302 @@
+/*
+ * Copyright 2021 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define _GNU_SOURCE // for cpu_set_t and pthread_attr_setaffinity_np()
+#include <avs_commons_init.h>
+
+#if defined(AVS_COMMONS_WITH_AVS_SCHED) \
+        && defined(AVS_COMMONS_SCHED_WITH_GROUPS)
+
+#    include <avs_commons_posix_init.h>
+
+#    include <assert.h>
+#    include <string.h>
+
+#    include <pthread.h>
+#    ifdef __linux__
+#        include <sched.h>
+#    endif // __linux__
+
+#    include <avsystem/commons/avs_memory.h>
+#    include <avsystem/commons/avs_sched.h>
+#    include <avsystem/commons/avs_utils.h>
+
+#    define MODULE_NAME avs_sched
+#    include <avs_x_log_config.h>
+
+VISIBILITY_SOURCE_BEGIN
+
+#    ifndef AVS_COMMONS_SCHED_THREAD_SAFE
+#        error "AVS_COMMONS_SCHED_WITH_GROUPS requires AVS_COMMONS_SCHED_THREAD_SAFE"
+#    endif // AVS_COMMONS_SCHED_THREAD_SAFE
+
+#    define SHARD_NAME_MAX_LENGTH 64
+
+typedef struct {
+    avs_sched_t *sched;
+    pthread_t thread;
+    bool thread_started;
+    /** Only accessed from the shard's own thread. */
+    bool running;
+    char name[SHARD_NAME_MAX_LENGTH];
+} sched_shard_t;
+
+struct avs_sched_group_struct {
+    size_t num_shards;
+    sched_shard_t shards[];
+};
+
+static void *shard_thread(void *shard_) {
+    sched_shard_t *shard = (sched_shard_t *) shard_;
+    while (shard->running) {
+        int result =
+                avs_sched_wait_until_next(shard->sched,
+                                          AVS_TIME_MONOTONIC_INVALID);
+        if (result < 0) {
+            LOG(ERROR, _("Scheduler \"") "%s" _("\": worker thread failed"),
+                shard->name);
+            break;
+        }
+        avs_sched_run(shard->sched);
+    }
+    return NULL;
+}
+
+static void stop_shard_job(avs_sched_t *sched, const void *shard_ptr) {
+    (void) sched;
+    (*(sched_shard_t *const *) shard_ptr)->running = false;
+}
+
+static long available_cpus(void) {
+#    ifdef __linux__
+    cpu_set_t allowed;
+    if (!sched_getaffinity(0, sizeof(allowed), &allowed)) {
+        return CPU_COUNT(&allowed) > 0 ? CPU_COUNT(&allowed) : 1;
+    }
+#    endif // __linux__
+    long result = sysconf(_SC_NPROCESSORS_ONLN);
+    return result > 0 ? result : 1;
+}
+
+#    ifdef __linux__
+/**
+ * Selects the CPU for the @p index-th shard. If no CPUs are configured, the
+ * CPUs that the calling thread is allowed to run on are used in turn; they are
+ * not necessarily numbered from 0, e.g. in a restricted cpuset.
+ */
+static int select_cpu(const avs_sched_group_config_t *config,
+                      size_t index,
+                      unsigned *out_cpu) {
+    if (config->cpus) {
+        if (config->cpus[index] >= CPU_SETSIZE) {
+            LOG(ERROR, _("Invalid CPU number: ") "%u", config->cpus[index]);
+            return -1;
+        }
+        *out_cpu = config->cpus[index];
+        return 0;
+    }
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed)
+            || CPU_COUNT(&allowed) <= 0) {
+        LOG(ERROR, _("Could not get the set of allowed CPUs"));
+        return -1;
+    }
+    size_t remaining = index % (size_t) CPU_COUNT(&allowed);
+    for (unsigned cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (CPU_ISSET(cpu, &allowed) && !remaining--) {
+            *out_cpu = cpu;
+            return 0;
+        }
+    }
+    AVS_UNREACHABLE("CPU_COUNT does not match the CPU set");
+    return -1;
+}
+#    endif // __linux__
+
+static int init_thread_attr(pthread_attr_t *attr,
+                            const avs_sched_group_config_t *config,
+                            size_t index) {
+    if (pthread_attr_init(attr)) {
+        return -1;
+    }
+    if (!config || !config->pin_threads) {
+        return 0;
+    }
+#    ifdef __linux__
+    unsigned cpu;
+    if (!select_cpu(config, index, &cpu)) {
+        cpu_set_t cpu_set;
+        CPU_ZERO(&cpu_set);
+        CPU_SET(cpu, &cpu_set);
+        if (!pthread_attr_setaffinity_np(attr, sizeof(cpu_set), &cpu_set)) {
+            return 0;
+        }
+    }
+#    else  // __linux__
+    (void) index;
+    LOG(ERROR, _("Thread pinning is not supported on this platform"));
+#    endif // __linux__
+    pthread_attr_destroy(attr);
+    return -1;
+}
+
+static int start_shard(sched_shard_t *shard,
+                       const avs_sched_group_config_t *config,
+                       size_t index) {
+    pthread_attr_t attr;
+    if (init_thread_attr(&attr, config, index)) {
+        return -1;
+    }
+    shard->running = true;
+    int result = pthread_create(&shard->thread, &attr, shard_thread, shard);
+    pthread_attr_destroy(&attr);
+    if (result) {
+        LOG(ERROR,
+            _("Scheduler \"") "%s" _("\": could not start worker thread: ") "%d",
+            shard->name, result);
+        return -1;
+    }
+    shard->thread_started = true;
+    return 0;
+}
+
+avs_sched_group_t *avs_sched_group_new(const char *name,
+                                       void *data,
+                                       const avs_sched_group_config_t *config) {
+    size_t num_shards = config ? config->num_shards : 0;
+    if (!num_shards) {
+        if (config && config->pin_threads && config->cpus) {
+            LOG(ERROR, _("num_shards is required if CPUs are specified"));
+            return NULL;
+        }
+        num_shards = (size_t) available_cpus();
+    }
+    if (num_shards > (SIZE_MAX - sizeof(avs_sched_group_t))
+                             / sizeof(sched_shard_t)) {
+        LOG(ERROR, _("Too many shards"));
+        return NULL;
+    }
+    if (!name) {
+        name = "(unknown)";
+    }
+    avs_sched_group_t *group = (avs_sched_group_t *) avs_calloc(
+            1, sizeof(avs_sched_group_t) + num_shards * sizeof(sched_shard_t));
+    if (!group) {
+        LOG(ERROR, _("Out of memory"));
+        return NULL;
+    }
+    group->num_shards = num_shards;
+    for (size_t i = 0; i < num_shards; ++i) {
+        sched_shard_t *shard = &group->shards[i];
+        // the name is only used for logging, so truncating it is fine
+        (void) avs_simple_snprintf(shard->name, sizeof(shard->name), "%s/%lu",
+                                   name, (unsigned long) i);
+        if (!(shard->sched = avs_sched_new(shard->name, data))
+                || start_shard(shard, config, i)) {
+            avs_sched_group_cleanup(&group);
+            return NULL;
+        }
+    }
+    LOG(DEBUG, _("Scheduler group \"") "%s" _("\" created with ") "%lu" _(
+                       " shards"),
+        name, (unsigned long) num_shards);
+    return group;
+}
+
+void avs_sched_group_cleanup(avs_sched_group_t **group_ptr) {
+    if (!group_ptr || !*group_ptr) {
+        return;
+    }
+    avs_sched_group_t *group = *group_ptr;
+    for (size_t i = 0; i < group->num_shards; ++i) {
+        sched_shard_t *shard = &group->shards[i];
+        if (shard->thread_started) {
+            // the flag is reset from within the worker thread, so that it is
+            // not necessary to synchronize access to it
+            if (AVS_SCHED_NOW(shard->sched, NULL, stop_shard_job, &shard,
+                              sizeof(shard))) {
+                AVS_UNREACHABLE("could not stop scheduler group worker");
+            }
+        }
+    }
+    for (size_t i = 0; i < group->num_shards; ++i) {
+        sched_shard_t *shard = &group->shards[i];
+        if (shard->thread_started) {
+            pthread_join(shard->thread, NULL);
+        }
+        avs_sched_cleanup(&shard->sched);
+    }
+    avs_free(group);
+    *group_ptr = NULL;
+}
+
+size_t avs_sched_group_size(avs_sched_group_t *group) {
+    assert(group);
+    return group->num_shards;
+}
+
+avs_sched_t *avs_sched_group_shard(avs_sched_group_t *group, size_t index) {
+    assert(group);
+    assert(index < group->num_shards);
+    return group->shards[index].sched;
+}
+
+avs_sched_t *avs_sched_group_shard_for_key(avs_sched_group_t *group,
+                                           uint64_t key) {
+    assert(group);
+    // SplitMix64 finalizer; spreads sequential keys and aligned pointers
+    key ^= key >> 30;
+    key *= UINT64_C(0xBF58476D1CE4E5B9);
+    key ^= key >> 27;
+    key *= UINT64_C(0x94D049BB133111EB);
+    key ^= key >> 31;
+    return group->shards[key % group->num_shards].sched;
+}
+
+#    ifdef AVS_COMMONS_SCHED_WITH_METRICS
+static void histogram_merge(avs_sched_histogram_t *out,
+                            const avs_sched_histogram_t *in) {
+    for (size_t i = 0; i < AVS_SCHED_HISTOGRAM_BUCKETS; ++i) {
+        out->buckets[i] += in->buckets[i];
+    }
+    out->count += in->count;
+    out->total = avs_time_duration_add(out->total, in->total);
+    if (avs_time_duration_less(out->max, in->max)) {
+        out->max = in->max;
+    }
+}
+
+void avs_sched_group_metrics_get(avs_sched_group_t *group,
+                                 avs_sched_metrics_t *out_metrics) {
+    assert(group);
+    assert(out_metrics);
+    memset(out_metrics, 0, sizeof(*out_metrics));
+    for (size_t i = 0; i < group->num_shards; ++i) {
+        avs_sched_metrics_t shard_metrics;
+        avs_sched_metrics_get(group->shards[i].sched, &shard_metrics);
+        histogram_merge(&out_metrics->lateness, &shard_metrics.lateness);
+        histogram_merge(&out_metrics->execution_time,
+                        &shard_metrics.execution_time);
+        out_metrics->jobs_executed += shard_metrics.jobs_executed;
+        out_metrics->queue_depth += shard_metrics.queue_depth;
+        out_metrics->max_queue_depth = AVS_MAX(out_metrics->max_queue_depth,
+                                               shard_metrics.max_queue_depth);
+    }
+}
+#    endif // AVS_COMMONS_SCHED_WITH_METRICS
+
+#endif // defined(AVS_COMMONS_WITH_AVS_SCHED) &&
+       // defined(AVS_COMMONS_SCHED_WITH_GROUPS)
@@ -0,0 +1,165 @@
+/*
+ * Copyright 2021 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <avsystem/commons/avs_commons_config.h>
+
+#if defined(AVS_COMMONS_WITH_AVS_SCHED) \
+        && defined(AVS_COMMONS_SCHED_WITH_POLLABLE_FD)
+
+#    include <avs_commons_posix_init.h>
+
+#    include <errno.h>
+#    include <stdint.h>
+#    include <string.h>
+
+#    ifdef AVS_COMMONS_SCHED_HAVE_TIMERFD
+#        include <sys/timerfd.h>
+#    endif // AVS_COMMONS_SCHED_HAVE_TIMERFD
+
+#    include "avs_sched_pollable.h"
+
+#    define MODULE_NAME avs_sched
+#    include <avs_x_log_config.h>
+
+VISIBILITY_SOURCE_BEGIN
+
+void _avs_sched_pollable_init(_avs_sched_pollable_t *pollable) {
+    pollable->fd = -1;
+    pollable->write_fd = -1;
+    pollable->armed_at = AVS_TIME_MONOTONIC_INVALID;
+    pollable->signalled = false;
+}
+
+static int set_nonblocking_cloexec(int fd) {
+    int flags = fcntl(fd, F_GETFL);
+    if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK)) {
+        return -1;
+    }
+    flags = fcntl(fd, F_GETFD);
+    if (flags < 0 || fcntl(fd, F_SETFD, flags | FD_CLOEXEC)) {
+        return -1;
+    }
+    return 0;
+}
+
+int _avs_sched_pollable_open(_avs_sched_pollable_t *pollable) {
+    if (pollable->fd >= 0) {
+        return 0;
+    }
+    pollable->armed_at = AVS_TIME_MONOTONIC_INVALID;
+    pollable->signalled = false;
+#    ifdef AVS_COMMONS_SCHED_HAVE_TIMERFD
+    pollable->fd =
+            timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (pollable->fd >= 0) {
+        return 0;
+    }
+    LOG(DEBUG, _("timerfd_create() failed, falling back to pipe: ") "%s",
+        strerror(errno));
+#    endif // AVS_COMMONS_SCHED_HAVE_TIMERFD
+    int fds[2];
+    if (pipe(fds)) {
+        LOG(ERROR, _("could not create pipe: ") "%s", strerror(errno));
+        return -1;
+    }
+    if (set_nonblocking_cloexec(fds[0]) || set_nonblocking_cloexec(fds[1])) {
+        LOG(ERROR, _("could not configure pipe: ") "%s", strerror(errno));
+        close(fds[0]);
+        close(fds[1]);
+        return -1;
+    }
+    pollable->fd = fds[0];
+    pollable->write_fd = fds[1];
+    return 0;
+}
+
+void _avs_sched_pollable_close(_avs_sched_pollable_t *pollable) {
+    if (pollable->fd >= 0) {
+        close(pollable->fd);
+    }
+    if (pollable->write_fd >= 0) {
+        close(pollable->write_fd);
+    }
+    _avs_sched_pollable_init(pollable);
+}
+
+#    ifdef AVS_COMMONS_SCHED_HAVE_TIMERFD
+static void arm_timer(_avs_sched_pollable_t *pollable,
+                      avs_time_monotonic_t time_of_next) {
+    struct itimerspec value;
+    memset(&value, 0, sizeof(value));
+    if (avs_time_monotonic_valid(time_of_next)) {
+        /* a relative time is used, as the avs_time clock might not be exactly
+         * CLOCK_MONOTONIC */
+        avs_time_duration_t remaining =
+                avs_time_monotonic_diff(time_of_next, avs_time_monotonic_now());
+        if (avs_time_duration_less(AVS_TIME_DURATION_ZERO, remaining)) {
+            value.it_value.tv_sec = (time_t) remaining.seconds;
+            value.it_value.tv_nsec = remaining.nanoseconds;
+        } else {
+            /* zero would disarm the timer */
+            value.it_value.tv_nsec = 1;
+        }
+    }
+    if (timerfd_settime(pollable->fd, 0, &value, NULL)) {
+        LOG(ERROR, _("timerfd_settime() failed: ") "%s", strerror(errno));
+    }
+}
+#    endif // AVS_COMMONS_SCHED_HAVE_TIMERFD
+
+void _avs_sched_pollable_update(_avs_sched_pollable_t *pollable,
+                                avs_time_monotonic_t time_of_next,
+                                bool wake) {
+    if (pollable->fd < 0
+            || avs_time_monotonic_equal(time_of_next, pollable->armed_at)
+            || (!avs_time_monotonic_valid(time_of_next)
+                && !avs_time_monotonic_valid(pollable->armed_at))) {
+        return;
+    }
+    pollable->armed_at = time_of_next;
+    if (pollable->write_fd < 0) {
+#    ifdef AVS_COMMONS_SCHED_HAVE_TIMERFD
+        arm_timer(pollable, time_of_next);
+#    endif // AVS_COMMONS_SCHED_HAVE_TIMERFD
+    } else if (wake && !pollable->signalled) {
+        /* a failure can only mean that the pipe is full, which is fine */
+        if (write(pollable->write_fd, "", 1) == 1) {
+            pollable->signalled = true;
+        }
+    }
+}
+
+void _avs_sched_pollable_drain(_avs_sched_pollable_t *pollable) {
+    if (pollable->fd < 0) {
+        return;
+    }
+    if (pollable->write_fd < 0) {
+        uint64_t expirations;
+        if (read(pollable->fd, &expirations, sizeof(expirations))
+                == (ssize_t) sizeof(expirations)) {
+            /* the timer has expired and is no longer armed */
+            pollable->armed_at = AVS_TIME_MONOTONIC_INVALID;
+        }
+    } else if (pollable->signalled) {
+        char buf[16];
+        while (read(pollable->fd, buf, sizeof(buf)) > 0) {
+        }
+        pollable->signalled = false;
+    }
+}
+
+#endif // defined(AVS_COMMONS_WITH_AVS_SCHED) &&
+       // defined(AVS_COMMONS_SCHED_WITH_POLLABLE_FD)
@@ -0,0 +1,71 @@
+/*
+ * Copyright 2021 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SCHED_POLLABLE_H
+#define SCHED_POLLABLE_H
+
+#include <stdbool.h>
+
+#include <avsystem/commons/avs_time.h>
+
+VISIBILITY_PRIVATE_HEADER_BEGIN
+
+/**
+ * File descriptor that becomes readable when a scheduler needs attention. It
+ * is either a timerfd that expires when the earliest job is due, or, if timerfd
+ * is not available, the read end of a pipe that is written to whenever the
+ * time of the earliest job changes.
+ *
+ * None of the functions are thread-safe - they are called with the scheduler
+ * mutex locked.
+ */
+typedef struct {
+    /** Descriptor returned to the user; -1 if not opened yet. */
+    int fd;
+    /** Write end of the pipe; -1 if timerfd is used. */
+    int write_fd;
+    /** Time of the earliest job, as last passed to the descriptor. */
+    avs_time_monotonic_t armed_at;
+    /** Whether the pipe contains unread data. */
+    bool signalled;
+} _avs_sched_pollable_t;
+
+void _avs_sched_pollable_init(_avs_sched_pollable_t *pollable);
+
+int _avs_sched_pollable_open(_avs_sched_pollable_t *pollable);
+
+void _avs_sched_pollable_close(_avs_sched_pollable_t *pollable);
+
+/**
+ * Updates the descriptor after the time of the earliest job might have
+ * changed. No system calls are made if it has not actually changed.
+ *
+ * @param wake If false, the pipe is not written to. Used at the end of
+ *             @ref avs_sched_run, after which the caller recalculates its
+ *             timeout anyway.
+ */
+void _avs_sched_pollable_update(_avs_sched_pollable_t *pollable,
+                                avs_time_monotonic_t time_of_next,
+                                bool wake);
+
+/**
+ * Makes the descriptor non-readable, unless the timer has not expired yet.
+ */
+void _avs_sched_pollable_drain(_avs_sched_pollable_t *pollable);
+
+VISIBILITY_PRIVATE_HEADER_END
+
+#endif // SCHED_POLLABLE_H
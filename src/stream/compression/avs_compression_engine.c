@@ -0,0 +1,53 @@
+/*
+ * Copyright 2021 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <avs_commons_init.h>
+
+#if defined(AVS_COMMONS_WITH_AVS_STREAM)           \
+        && (defined(AVS_COMMONS_STREAM_WITH_ZLIB) \
+            || defined(AVS_COMMONS_STREAM_WITH_ZSTD))
+
+#    include "avs_compression_engine.h"
+
+#    define MODULE_NAME stream_compression
+#    include <avs_x_log_config.h>
+
+VISIBILITY_SOURCE_BEGIN
+
+avs_compression_engine_t *
+_avs_compression_engine_create(bool compress,
+                               const avs_stream_compression_config_t *config) {
+    switch (config->format) {
+#    ifdef AVS_COMMONS_STREAM_WITH_ZLIB
+    case AVS_STREAM_COMPRESSION_ZLIB:
+    case AVS_STREAM_COMPRESSION_GZIP:
+    case AVS_STREAM_COMPRESSION_RAW_DEFLATE:
+        return _avs_compression_zlib_engine_create(compress, config);
+#    endif // AVS_COMMONS_STREAM_WITH_ZLIB
+#    ifdef AVS_COMMONS_STREAM_WITH_ZSTD
+    case AVS_STREAM_COMPRESSION_ZSTD:
+        return _avs_compression_zstd_engine_create(compress, config);
+#    endif // AVS_COMMONS_STREAM_WITH_ZSTD
+    default:
+        LOG(ERROR, _("unsupported compression format: ") "%d",
+            (int) config->format);
+        return NULL;
+    }
+}
+
+#endif // defined(AVS_COMMONS_WITH_AVS_STREAM) &&
+       // (defined(AVS_COMMONS_STREAM_WITH_ZLIB) ||
+       // defined(AVS_COMMONS_STREAM_WITH_ZSTD))
@@ -0,0 +1,140 @@
+/*
+ * Copyright 2021 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AVS_COMMONS_STREAM_COMPRESSION_ENGINE_H
+#define AVS_COMMONS_STREAM_COMPRESSION_ENGINE_H
+
+#include <stdint.h>
+
+#include <avsystem/commons/avs_stream_compression.h>
+
+VISIBILITY_PRIVATE_HEADER_BEGIN
+
+#define AVS_COMPRESSION_DEFAULT_BUFFER_SIZE 4096
+
+typedef enum {
+    AVS_COMPRESSION_FLUSH_NONE,
+    /**
+     * Compress all input and align the output to a byte boundary, without
+     * finishing the compressed stream.
+     */
+    AVS_COMPRESSION_FLUSH_SYNC,
+    AVS_COMPRESSION_FLUSH_FINISH
+} avs_compression_flush_t;
+
+typedef struct avs_compression_engine_struct avs_compression_engine_t;
+
+typedef struct {
+    avs_error_t (*process)(avs_compression_engine_t *engine,
+                           const uint8_t **inout_input,
+                           size_t *inout_input_size,
+                           uint8_t **inout_output,
+                           size_t *inout_output_size,
+                           avs_compression_flush_t flush,
+                           bool *out_done);
+    avs_error_t (*reset)(avs_compression_engine_t *engine);
+    void (*cleanup)(avs_compression_engine_t *engine);
+} avs_compression_engine_vtable_t;
+
+/**
+ * Thin, buffer-less wrapper over a compression library context. It is the
+ * common base of the stream decorators declared in avs_stream_compression.h
+ * and of the filter streams used by avs_http.
+ */
+struct avs_compression_engine_struct {
+    const avs_compression_engine_vtable_t *vtable;
+};
+
+/**
+ * Creates a compressor (if @p compress is true) or a decompressor for the
+ * format specified in @p config.
+ *
+ * @returns Newly created engine, or NULL if the format is not supported or an
+ *          error occurred.
+ */
+avs_compression_engine_t *
+_avs_compression_engine_create(bool compress,
+                               const avs_stream_compression_config_t *config);
+
+/**
+ * Compresses or decompresses as much data as possible.
+ *
+ * @param engine            Engine to use.
+ *
+ * @param inout_input       Pointer to the input data; advanced past the
+ *                          consumed part.
+ *
+ * @param inout_input_size  Size of the input data; decreased by the number of
+ *                          bytes consumed.
+ *
+ * @param inout_output      Pointer to the output buffer; advanced past the
+ *                          produced data.
+ *
+ * @param inout_output_size Space available in the output buffer; decreased by
+ *                          the number of bytes produced.
+ *
+ * @param flush             Flush mode. Ignored by decompressors.
+ *
+ * @param out_done          Set to true if the requested flush has been
+ *                          completed (compressors), or if the end of the
+ *                          compressed stream has been reached (decompressors).
+ *                          In that case, no more output is pending. Always
+ *                          false for compressors with
+ *                          @ref AVS_COMPRESSION_FLUSH_NONE.
+ */
+static inline avs_error_t
+_avs_compression_engine_process(avs_compression_engine_t *engine,
+                                const uint8_t **inout_input,
+                                size_t *inout_input_size,
+                                uint8_t **inout_output,
+                                size_t *inout_output_size,
+                                avs_compression_flush_t flush,
+                                bool *out_done) {
+    return engine->vtable->process(engine, inout_input, inout_input_size,
+                                   inout_output, inout_output_size, flush,
+                                   out_done);
+}
+
+/**
+ * Prepares the engine for processing a new, independent stream, reusing the
+ * allocated context and the configured dictionary.
+ */
+static inline avs_error_t
+_avs_compression_engine_reset(avs_compression_engine_t *engine) {
+    return engine->vtable->reset(engine);
+}
+
+static inline void
+_avs_compression_engine_cleanup(avs_compression_engine_t **engine_ptr) {
+    if (*engine_ptr) {
+        (*engine_ptr)->vtable->cleanup(*engine_ptr);
+        *engine_ptr = NULL;
+    }
+}
+
+#ifdef AVS_COMMONS_STREAM_WITH_ZLIB
+avs_compression_engine_t *_avs_compression_zlib_engine_create(
+        bool compress, const avs_stream_compression_config_t *config);
+#endif // AVS_COMMONS_STREAM_WITH_ZLIB
+
+#ifdef AVS_COMMONS_STREAM_WITH_ZSTD
+avs_compression_engine_t *_avs_compression_zstd_engine_create(
+        bool compress, const avs_stream_compression_config_t *config);
+#endif // AVS_COMMONS_STREAM_WITH_ZSTD
+
+VISIBILITY_PRIVATE_HEADER_END
+
+#endif /* AVS_COMMONS_STREAM_COMPRESSION_ENGINE_H */
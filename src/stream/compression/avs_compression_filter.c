@@ -0,0 +1,279 @@
+/*
+ * Copyright 2021 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <avs_commons_init.h>
+
+#if defined(AVS_COMMONS_WITH_AVS_STREAM)           \
+        && (defined(AVS_COMMONS_STREAM_WITH_ZLIB) \
+            || defined(AVS_COMMONS_STREAM_WITH_ZSTD))
+
+#    include <assert.h>
+#    include <stdint.h>
+#    include <string.h>
+
+#    include <avsystem/commons/avs_memory.h>
+#    include <avsystem/commons/avs_stream_v_table.h>
+
+#    include "avs_compression_engine.h"
+#    include "avs_compression_filter.h"
+
+#    define MODULE_NAME stream_compression
+#    include <avs_x_log_config.h>
+
+VISIBILITY_SOURCE_BEGIN
+
+#    define GET_INPUT_BUFFER(filter) ((filter)->data)
+#    define GET_OUTPUT_BUFFER(filter) \
+        ((filter)->data + (filter)->input_buffer_size)
+
+typedef struct {
+    const avs_stream_v_table_t *const vtable;
+    avs_compression_engine_t *engine;
+    bool compress;
+    avs_compression_flush_t flush;
+    /* the engine has reached the end of the compressed stream */
+    bool finished;
+    /* sticky processing error; cleared by reset */
+    avs_error_t error;
+    size_t input_buffer_size;
+    size_t input_size;
+    size_t output_buffer_size;
+    size_t output_size;
+    uint8_t data[];
+} compression_filter_t;
+
+/**
+ * Processes the buffered input, writing at most @p *inout_output_size bytes to
+ * @p output. On return, @p *inout_output_size is set to the number of bytes
+ * actually written.
+ */
+static avs_error_t process(compression_filter_t *filter,
+                           uint8_t *output,
+                           size_t *inout_output_size) {
+    size_t output_left = *inout_output_size;
+    *inout_output_size = 0;
+    if (avs_is_err(filter->error) || filter->finished) {
+        return filter->error;
+    }
+
+    const uint8_t *input = GET_INPUT_BUFFER(filter);
+    size_t input_left = filter->input_size;
+    uint8_t *output_ptr = output;
+    bool done;
+    filter->error = _avs_compression_engine_process(filter->engine, &input,
+                                                    &input_left, &output_ptr,
+                                                    &output_left, filter->flush,
+                                                    &done);
+    if (done
+            && (!filter->compress
+                || filter->flush == AVS_COMPRESSION_FLUSH_FINISH)) {
+        filter->finished = true;
+    }
+    memmove(GET_INPUT_BUFFER(filter), input, input_left);
+    filter->input_size = input_left;
+    *inout_output_size = (size_t) (output_ptr - output);
+    return filter->error;
+}
+
+static avs_error_t process_to_output_buffer(compression_filter_t *filter) {
+    size_t bytes_processed = filter->output_buffer_size - filter->output_size;
+    avs_error_t err =
+            process(filter, GET_OUTPUT_BUFFER(filter) + filter->output_size,
+                    &bytes_processed);
+    filter->output_size += bytes_processed;
+    return err;
+}
+
+static avs_error_t filter_write_some(avs_stream_t *stream,
+                                     const void *data,
+                                     size_t *inout_data_length) {
+    compression_filter_t *filter = (compression_filter_t *) stream;
+    if (filter->flush == AVS_COMPRESSION_FLUSH_SYNC) {
+        /* new data after a sync flush starts a new block */
+        filter->flush = AVS_COMPRESSION_FLUSH_NONE;
+    }
+    if (filter->finished || filter->flush != AVS_COMPRESSION_FLUSH_NONE) {
+        LOG(ERROR, _("Stream finished"));
+        return avs_errno(AVS_EBADF);
+    }
+    if (*inout_data_length > filter->input_buffer_size - filter->input_size) {
+        avs_error_t err = process_to_output_buffer(filter);
+        if (avs_is_err(err)) {
+            return err;
+        }
+    }
+    if (*inout_data_length > filter->input_buffer_size - filter->input_size) {
+        *inout_data_length = filter->input_buffer_size - filter->input_size;
+    }
+    memcpy(GET_INPUT_BUFFER(filter) + filter->input_size, data,
+           *inout_data_length);
+    filter->input_size += *inout_data_length;
+    return process_to_output_buffer(filter);
+}
+
+static size_t filter_nonblock_write_ready(avs_stream_t *stream) {
+    compression_filter_t *filter = (compression_filter_t *) stream;
+    if (filter->input_size > 0
+            && avs_is_err(process_to_output_buffer(filter))) {
+        return 0;
+    }
+    return filter->input_buffer_size - filter->input_size;
+}
+
+static avs_error_t filter_finish_message(avs_stream_t *stream) {
+    compression_filter_t *filter = (compression_filter_t *) stream;
+    filter->flush = AVS_COMPRESSION_FLUSH_FINISH;
+    return process_to_output_buffer(filter);
+}
+
+static avs_error_t filter_read(avs_stream_t *stream,
+                               size_t *out_bytes_read,
+                               bool *out_message_finished,
+                               void *buffer,
+                               size_t buffer_length) {
+    compression_filter_t *filter = (compression_filter_t *) stream;
+    size_t ready_bytes = AVS_MIN(buffer_length, filter->output_size);
+    *out_bytes_read = 0;
+    *out_message_finished = false;
+    if (ready_bytes) {
+        memcpy(buffer, GET_OUTPUT_BUFFER(filter), ready_bytes);
+        memmove(GET_OUTPUT_BUFFER(filter),
+                GET_OUTPUT_BUFFER(filter) + ready_bytes,
+                filter->output_size - ready_bytes);
+        filter->output_size -= ready_bytes;
+        *out_bytes_read = ready_bytes;
+    }
+    if (*out_bytes_read < buffer_length) {
+        size_t bytes_processed = buffer_length - *out_bytes_read;
+        process(filter, (uint8_t *) buffer + *out_bytes_read,
+                &bytes_processed);
+        *out_bytes_read += bytes_processed;
+    }
+    if (avs_is_err(filter->error)) {
+        return filter->error;
+    }
+    *out_message_finished = (filter->finished && !filter->output_size);
+    return AVS_OK;
+}
+
+static bool filter_nonblock_read_ready(avs_stream_t *stream) {
+    compression_filter_t *filter = (compression_filter_t *) stream;
+    if (filter->output_size > 0) {
+        return true;
+    }
+    if (avs_is_err(process_to_output_buffer(filter))) {
+        return false;
+    }
+    return filter->output_size > 0;
+}
+
+static avs_error_t
+filter_peek(avs_stream_t *stream, size_t offset, char *out_value) {
+    compression_filter_t *filter = (compression_filter_t *) stream;
+    if (offset > filter->output_buffer_size) {
+        LOG(ERROR, _("cannot peek - buffer is too small"));
+        return avs_errno(AVS_ENOBUFS);
+    }
+    if (offset >= filter->output_size) {
+        avs_error_t err = process_to_output_buffer(filter);
+        if (avs_is_err(err)) {
+            return err;
+        }
+    }
+    if (offset < filter->output_size) {
+        *out_value = (char) GET_OUTPUT_BUFFER(filter)[offset];
+        return AVS_OK;
+    } else {
+        return AVS_EOF;
+    }
+}
+
+static avs_error_t filter_reset(avs_stream_t *stream) {
+    compression_filter_t *filter = (compression_filter_t *) stream;
+    filter->flush = AVS_COMPRESSION_FLUSH_NONE;
+    filter->finished = false;
+    filter->input_size = 0;
+    filter->output_size = 0;
+    filter->error = _avs_compression_engine_reset(filter->engine);
+    return filter->error;
+}
+
+static avs_error_t filter_close(avs_stream_t *stream) {
+    _avs_compression_engine_cleanup(&((compression_filter_t *) stream)->engine);
+    return AVS_OK;
+}
+
+static const avs_stream_v_table_extension_t filter_vtable_extensions[] = {
+    { AVS_STREAM_V_TABLE_EXTENSION_NONBLOCK,
+      &(avs_stream_v_table_extension_nonblock_t[]){
+              { filter_nonblock_read_ready,
+                filter_nonblock_write_ready } }[0] },
+    AVS_STREAM_V_TABLE_EXTENSION_NULL
+};
+
+static const avs_stream_v_table_t filter_vtable = {
+    .write_some = filter_write_some,
+    .finish_message = filter_finish_message,
+    .read = filter_read,
+    .peek = filter_peek,
+    .reset = filter_reset,
+    .close = filter_close,
+    .extension_list = filter_vtable_extensions
+};
+
+avs_stream_t *_avs_stream_compression_filter_create(
+        bool compress,
+        const avs_stream_compression_config_t *config,
+        size_t input_buffer_size,
+        size_t output_buffer_size) {
+    if (!input_buffer_size || !output_buffer_size) {
+        LOG(ERROR, _("buffers cannot be zero-length"));
+        return NULL;
+    }
+    compression_filter_t *filter = (compression_filter_t *) avs_calloc(
+            1, sizeof(compression_filter_t) + input_buffer_size
+                       + output_buffer_size);
+    if (!filter) {
+        LOG(ERROR, _("cannot allocate memory"));
+        return NULL;
+    }
+    if (!(filter->engine = _avs_compression_engine_create(compress, config))) {
+        avs_free(filter);
+        return NULL;
+    }
+    *(const avs_stream_v_table_t **) (intptr_t) &filter->vtable =
+            &filter_vtable;
+    filter->compress = compress;
+    filter->input_buffer_size = input_buffer_size;
+    filter->output_buffer_size = output_buffer_size;
+    return (avs_stream_t *) filter;
+}
+
+avs_error_t _avs_stream_compression_filter_sync_flush(avs_stream_t *stream) {
+    compression_filter_t *filter = (compression_filter_t *) stream;
+    assert(filter->vtable == &filter_vtable);
+    assert(filter->compress);
+    if (filter->finished || filter->flush == AVS_COMPRESSION_FLUSH_FINISH) {
+        LOG(ERROR, _("Stream finished"));
+        return avs_errno(AVS_EBADF);
+    }
+    filter->flush = AVS_COMPRESSION_FLUSH_SYNC;
+    return process_to_output_buffer(filter);
+}
+
+#endif // defined(AVS_COMMONS_WITH_AVS_STREAM) &&
+       // (defined(AVS_COMMONS_STREAM_WITH_ZLIB) ||
+       // defined(AVS_COMMONS_STREAM_WITH_ZSTD))
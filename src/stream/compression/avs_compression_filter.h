@@ -0,0 +1,89 @@
+/*
+ * Copyright 2021 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AVS_COMMONS_STREAM_COMPRESSION_FILTER_H
+#define AVS_COMMONS_STREAM_COMPRESSION_FILTER_H
+
+#include <avsystem/commons/avs_stream_compression.h>
+
+VISIBILITY_PRIVATE_HEADER_BEGIN
+
+/**
+ * Creates a compressor (if @p compress is true) or decompressor filter stream.
+ *
+ * This is <strong>NOT</strong> a decorator. The basic semantics of this stream
+ * are that the user will write uncompressed data to it, which will then make
+ * equivalent compressed data available to read (or the other way around for
+ * decompressors).
+ *
+ * <c>avs_stream_t</c> methods are implemented as follows:
+ *
+ * - <c>avs_stream_write</c> - passes some input data to the compression
+ *   engine. It may or may not make some equivalent output data available to
+ *   retrieve, depending on the compression algorithm's properties. If there is
+ *   no output data available to retrieve, it means that the compression
+ *   algorithm is waiting for more input.
+ *
+ *   Note that when there is not enough space available in the input buffer for
+ *   the data to be written, the call will fail. Amount of space available is
+ *   dependent on the compression algorithm and not easily determinable. For
+ *   this reason, it is recommended to write data in small chunks, or use
+ *   <c>avs_stream_write_some</c> or <c>avs_stream_nonblock_write_ready</c>.
+ *
+ *   In particular, attempting to write more data than <c>input_buffer_size</c>
+ *   will always result in an error.
+ *
+ * - <c>avs_stream_finish_message</c> - signifies the end of input data. After
+ *   calling it, the final part of the output data can be read from the
+ *   stream.
+ *
+ * - <c>avs_stream_read</c> - reads the output data equivalent to part or
+ *   entirety of the input data earlier pushed via <c>avs_stream_write()</c>.
+ *
+ * - <c>avs_stream_peek</c> - reads a single byte from the output data without
+ *   consuming it. The possible peek range is limited by
+ *   <c>output_buffer_size</c>, but may be less if not enough input data was
+ *   previously written for the compression algorithm to produce the desired
+ *   amount of output data.
+ *
+ * - <c>avs_stream_reset</c> - clears the buffers and the state of the
+ *   compression algorithm, allowing to process a new stream.
+ *
+ * The <c>buffer_size</c> field of @p config is ignored.
+ */
+avs_stream_t *_avs_stream_compression_filter_create(
+        bool compress,
+        const avs_stream_compression_config_t *config,
+        size_t input_buffer_size,
+        size_t output_buffer_size);
+
+/**
+ * Performs a sync flush on a compressor stream created using
+ * @ref _avs_stream_compression_filter_create.
+ *
+ * All data written so far is compressed and made available for reading, up to
+ * a byte boundary. For the DEFLATE-based formats, the compressed data ends
+ * with an empty stored block, i.e. the <c>00 00 FF FF</c> byte sequence. The
+ * sync flush is continued by the subsequent <c>avs_stream_read</c> calls if
+ * the output buffer is too small to hold all the data at once, until the next
+ * <c>avs_stream_write</c>, after which the compressor continues to operate
+ * normally.
+ */
+avs_error_t _avs_stream_compression_filter_sync_flush(avs_stream_t *filter);
+
+VISIBILITY_PRIVATE_HEADER_END
+
+#endif /* AVS_COMMONS_STREAM_COMPRESSION_FILTER_H */
@@ -0,0 +1,313 @@
+/*
+ * Copyright 2021 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <avs_commons_init.h>
+
+#if defined(AVS_COMMONS_WITH_AVS_STREAM)           \
+        && (defined(AVS_COMMONS_STREAM_WITH_ZLIB) \
+            || defined(AVS_COMMONS_STREAM_WITH_ZSTD))
+
+#    include <avsystem/commons/avs_stream_compression.h>
+
+#    include <stdint.h>
+#    include <string.h>
+
+#    include <avsystem/commons/avs_memory.h>
+#    include <avsystem/commons/avs_stream_v_table.h>
+
+#    include "avs_compression_engine.h"
+
+#    define MODULE_NAME stream_compression
+#    include <avs_x_log_config.h>
+
+VISIBILITY_SOURCE_BEGIN
+
+typedef struct {
+    const avs_stream_v_table_t *const vtable;
+    avs_stream_t *backend;
+    avs_compression_engine_t *engine;
+    /* set if any data has been written since the last finish_message */
+    bool message_started;
+    size_t buffer_size;
+    uint8_t buffer[];
+} deflate_stream_t;
+
+typedef struct {
+    const avs_stream_v_table_t *const vtable;
+    avs_stream_t *backend;
+    avs_compression_engine_t *engine;
+    bool backend_finished;
+    /* the end of the current compressed stream has been reached */
+    bool stream_finished;
+    size_t input_offset;
+    size_t input_size;
+    size_t buffer_size;
+    uint8_t buffer[];
+} inflate_stream_t;
+
+/**
+ * Passes @p data through the compressor and writes all the output it produces
+ * to the backend stream. With any flush mode other than
+ * @ref AVS_COMPRESSION_FLUSH_NONE, loops until the flush is complete.
+ */
+static avs_error_t deflate_data(deflate_stream_t *stream,
+                                const uint8_t *data,
+                                size_t data_size,
+                                avs_compression_flush_t flush) {
+    bool done = false;
+    do {
+        const uint8_t *input = data;
+        uint8_t *output = stream->buffer;
+        size_t output_left = stream->buffer_size;
+        avs_error_t err =
+                _avs_compression_engine_process(stream->engine, &input,
+                                                &data_size, &output,
+                                                &output_left, flush, &done);
+        if (avs_is_err(err)) {
+            return err;
+        }
+        size_t produced = stream->buffer_size - output_left;
+        if (!produced && input == data && !done) {
+            LOG(ERROR, _("compressor stalled"));
+            return avs_errno(AVS_EIO);
+        }
+        if (produced
+                && avs_is_err((err = avs_stream_write(stream->backend,
+                                                      stream->buffer,
+                                                      produced)))) {
+            return err;
+        }
+        data = input;
+    } while (data_size > 0 || (flush != AVS_COMPRESSION_FLUSH_NONE && !done));
+    return AVS_OK;
+}
+
+static avs_error_t deflate_write_some(avs_stream_t *stream_,
+                                      const void *data,
+                                      size_t *inout_data_length) {
+    deflate_stream_t *stream = (deflate_stream_t *) stream_;
+    if (!*inout_data_length) {
+        return AVS_OK;
+    }
+    stream->message_started = true;
+    return deflate_data(stream, (const uint8_t *) data, *inout_data_length,
+                        AVS_COMPRESSION_FLUSH_NONE);
+}
+
+static avs_error_t deflate_finish(deflate_stream_t *stream) {
+    avs_error_t err =
+            deflate_data(stream, NULL, 0, AVS_COMPRESSION_FLUSH_FINISH);
+    stream->message_started = false;
+    avs_error_t reset_err = _avs_compression_engine_reset(stream->engine);
+    return avs_is_ok(err) ? reset_err : err;
+}
+
+static avs_error_t deflate_finish_message(avs_stream_t *stream_) {
+    deflate_stream_t *stream = (deflate_stream_t *) stream_;
+    avs_error_t err = deflate_finish(stream);
+    if (avs_is_err(err)) {
+        return err;
+    }
+    return avs_stream_finish_message(stream->backend);
+}
+
+static avs_error_t deflate_reset(avs_stream_t *stream_) {
+    deflate_stream_t *stream = (deflate_stream_t *) stream_;
+    stream->message_started = false;
+    avs_error_t err = _avs_compression_engine_reset(stream->engine);
+    avs_error_t backend_err = avs_stream_reset(stream->backend);
+    return avs_is_ok(err) ? backend_err : err;
+}
+
+static avs_error_t deflate_close(avs_stream_t *stream_) {
+    deflate_stream_t *stream = (deflate_stream_t *) stream_;
+    avs_error_t err = AVS_OK;
+    if (stream->message_started) {
+        err = deflate_finish(stream);
+    }
+    _avs_compression_engine_cleanup(&stream->engine);
+    avs_error_t backend_err = avs_stream_cleanup(&stream->backend);
+    return avs_is_ok(err) ? backend_err : err;
+}
+
+static const avs_stream_v_table_t deflate_stream_vtable = {
+    .write_some = deflate_write_some,
+    .finish_message = deflate_finish_message,
+    .reset = deflate_reset,
+    .close = deflate_close
+};
+
+static avs_error_t inflate_fetch(inflate_stream_t *stream) {
+    size_t bytes_read;
+    avs_error_t err = avs_stream_read(stream->backend, &bytes_read,
+                                      &stream->backend_finished,
+                                      stream->buffer, stream->buffer_size);
+    if (avs_is_ok(err)) {
+        stream->input_offset = 0;
+        stream->input_size = bytes_read;
+    }
+    return err;
+}
+
+static avs_error_t inflate_read(avs_stream_t *stream_,
+                                size_t *out_bytes_read,
+                                bool *out_message_finished,
+                                void *buffer,
+                                size_t buffer_length) {
+    inflate_stream_t *stream = (inflate_stream_t *) stream_;
+    size_t bytes_read = 0;
+    avs_error_t err = AVS_OK;
+
+    if (stream->stream_finished) {
+        if (!stream->input_size && stream->backend_finished) {
+            goto finish;
+        }
+        /* more data follows - start decompressing the next stream */
+        if (avs_is_err((err = _avs_compression_engine_reset(stream->engine)))) {
+            return err;
+        }
+        stream->stream_finished = false;
+    }
+
+    while (bytes_read < buffer_length) {
+        if (!stream->input_size && !stream->backend_finished) {
+            if (bytes_read) {
+                /* don't block if we already have something to return */
+                break;
+            }
+            if (avs_is_err((err = inflate_fetch(stream)))) {
+                return err;
+            }
+        }
+
+        const uint8_t *input = stream->buffer + stream->input_offset;
+        size_t input_left = stream->input_size;
+        uint8_t *output = (uint8_t *) buffer + bytes_read;
+        size_t output_left = buffer_length - bytes_read;
+        err = _avs_compression_engine_process(stream->engine, &input,
+                                              &input_left, &output,
+                                              &output_left,
+                                              AVS_COMPRESSION_FLUSH_NONE,
+                                              &stream->stream_finished);
+        if (avs_is_err(err)) {
+            return err;
+        }
+        bool progress = (input_left < stream->input_size
+                         || output_left < buffer_length - bytes_read);
+        stream->input_offset += stream->input_size - input_left;
+        stream->input_size = input_left;
+        bytes_read = buffer_length - output_left;
+
+        if (stream->stream_finished) {
+            break;
+        }
+        if (!progress && (stream->input_size || stream->backend_finished)) {
+            LOG(ERROR, _("compressed stream truncated or corrupted"));
+            return avs_errno(AVS_EIO);
+        }
+    }
+
+finish:
+    *out_bytes_read = bytes_read;
+    *out_message_finished = stream->stream_finished;
+    return AVS_OK;
+}
+
+static avs_error_t inflate_reset(avs_stream_t *stream_) {
+    inflate_stream_t *stream = (inflate_stream_t *) stream_;
+    stream->backend_finished = false;
+    stream->stream_finished = false;
+    stream->input_offset = 0;
+    stream->input_size = 0;
+    avs_error_t err = _avs_compression_engine_reset(stream->engine);
+    avs_error_t backend_err = avs_stream_reset(stream->backend);
+    return avs_is_ok(err) ? backend_err : err;
+}
+
+static avs_error_t inflate_close(avs_stream_t *stream_) {
+    inflate_stream_t *stream = (inflate_stream_t *) stream_;
+    _avs_compression_engine_cleanup(&stream->engine);
+    return avs_stream_cleanup(&stream->backend);
+}
+
+static const avs_stream_v_table_t inflate_stream_vtable = {
+    .read = inflate_read,
+    .reset = inflate_reset,
+    .close = inflate_close
+};
+
+static size_t get_buffer_size(const avs_stream_compression_config_t *config) {
+    return config->buffer_size ? config->buffer_size
+                               : AVS_COMPRESSION_DEFAULT_BUFFER_SIZE;
+}
+
+int avs_stream_deflate_create(avs_stream_t **inout_stream,
+                              const avs_stream_compression_config_t *config) {
+    if (!inout_stream || !*inout_stream || !config) {
+        LOG(ERROR, _("invalid arguments"));
+        return -1;
+    }
+    size_t buffer_size = get_buffer_size(config);
+    deflate_stream_t *stream = (deflate_stream_t *) avs_calloc(
+            1, sizeof(deflate_stream_t) + buffer_size);
+    if (!stream) {
+        LOG(ERROR, _("cannot allocate memory"));
+        return -1;
+    }
+    if (!(stream->engine = _avs_compression_engine_create(true, config))) {
+        avs_free(stream);
+        return -1;
+    }
+    *(const avs_stream_v_table_t **) (intptr_t) &stream->vtable =
+            &deflate_stream_vtable;
+    stream->buffer_size = buffer_size;
+    stream->backend = *inout_stream;
+    *inout_stream = (avs_stream_t *) stream;
+    return 0;
+}
+
+int avs_stream_inflate_create(avs_stream_t **inout_stream,
+                              const avs_stream_compression_config_t *config) {
+    if (!inout_stream || !*inout_stream || !config) {
+        LOG(ERROR, _("invalid arguments"));
+        return -1;
+    }
+    size_t buffer_size = get_buffer_size(config);
+    inflate_stream_t *stream = (inflate_stream_t *) avs_calloc(
+            1, sizeof(inflate_stream_t) + buffer_size);
+    if (!stream) {
+        LOG(ERROR, _("cannot allocate memory"));
+        return -1;
+    }
+    if (!(stream->engine = _avs_compression_engine_create(false, config))) {
+        avs_free(stream);
+        return -1;
+    }
+    *(const avs_stream_v_table_t **) (intptr_t) &stream->vtable =
+            &inflate_stream_vtable;
+    stream->buffer_size = buffer_size;
+    stream->backend = *inout_stream;
+    *inout_stream = (avs_stream_t *) stream;
+    return 0;
+}
+
+#    ifdef AVS_UNIT_TESTING
+#        include "tests/stream/test_stream_compression.c"
+#    endif
+
+#endif // defined(AVS_COMMONS_WITH_AVS_STREAM) &&
+       // (defined(AVS_COMMONS_STREAM_WITH_ZLIB) ||
+       // defined(AVS_COMMONS_STREAM_WITH_ZSTD))
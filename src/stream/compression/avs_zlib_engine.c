@@ -0,0 +1,274 @@
+/*
+ * Copyright 2021 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// NOTE: zlib headers sometimes (depending on a version) contain some of the
+// symbols poisoned via inclusion of avs_commons_init.h. Therefore they must
+// be included before poison.
+#define AVS_SUPPRESS_POISONING
+#include <avs_commons_init.h>
+
+#if defined(AVS_COMMONS_WITH_AVS_STREAM) \
+        && defined(AVS_COMMONS_STREAM_WITH_ZLIB)
+
+#    include <zlib.h>
+
+#    include <avs_commons_poison.h>
+
+#    include <errno.h>
+#    include <limits.h>
+#    include <stdint.h>
+
+#    include <avsystem/commons/avs_errno_map.h>
+#    include <avsystem/commons/avs_memory.h>
+
+#    include "avs_compression_engine.h"
+
+#    define MODULE_NAME stream_compression
+#    include <avs_x_log_config.h>
+
+VISIBILITY_SOURCE_BEGIN
+
+#    define ZLIB_WINDOW_BITS_MIN 9
+#    define ZLIB_WINDOW_BITS_MAX 15
+#    define ZLIB_MEM_LEVEL 8
+
+typedef struct {
+    avs_compression_engine_t base;
+    z_stream zlib;
+    bool compress;
+    avs_stream_compression_format_t format;
+    const void *dictionary;
+    size_t dictionary_size;
+} zlib_engine_t;
+
+static const char *get_zlib_msg(const zlib_engine_t *engine) {
+    return engine->zlib.msg ? engine->zlib.msg : "(no message)";
+}
+
+static avs_error_t map_zlib_error(int zlib_error) {
+    if (zlib_error == Z_ERRNO) {
+        return avs_errno(avs_map_errno(errno));
+    } else {
+        return avs_errno(AVS_EIO);
+    }
+}
+
+static int zlib_window_bits(avs_stream_compression_format_t format,
+                            int window_bits) {
+    switch (format) {
+    case AVS_STREAM_COMPRESSION_GZIP:
+        return window_bits + 16;
+    case AVS_STREAM_COMPRESSION_RAW_DEFLATE:
+        return -window_bits;
+    default:
+        return window_bits;
+    }
+}
+
+static int zlib_flush(avs_compression_flush_t flush) {
+    switch (flush) {
+    case AVS_COMPRESSION_FLUSH_SYNC:
+        return Z_SYNC_FLUSH;
+    case AVS_COMPRESSION_FLUSH_FINISH:
+        return Z_FINISH;
+    default:
+        return Z_NO_FLUSH;
+    }
+}
+
+/**
+ * Dictionaries need to be set up again after each reset. For the zlib format,
+ * the decompressor receives the dictionary when it is requested by the stream
+ * header (Z_NEED_DICT), so that its identifier can be verified.
+ */
+static int set_dictionary(zlib_engine_t *engine) {
+    if (!engine->dictionary) {
+        return Z_OK;
+    }
+    if (engine->compress) {
+        return deflateSetDictionary(&engine->zlib,
+                                    (const Bytef *) engine->dictionary,
+                                    (uInt) engine->dictionary_size);
+    } else if (engine->format == AVS_STREAM_COMPRESSION_RAW_DEFLATE) {
+        return inflateSetDictionary(&engine->zlib,
+                                    (const Bytef *) engine->dictionary,
+                                    (uInt) engine->dictionary_size);
+    }
+    return Z_OK;
+}
+
+static int zlib_inflate(zlib_engine_t *engine) {
+    int result = inflate(&engine->zlib, Z_NO_FLUSH);
+    if (result == Z_NEED_DICT && engine->dictionary) {
+        result = inflateSetDictionary(&engine->zlib,
+                                      (const Bytef *) engine->dictionary,
+                                      (uInt) engine->dictionary_size);
+        if (result == Z_OK) {
+            result = inflate(&engine->zlib, Z_NO_FLUSH);
+        }
+    }
+    return result;
+}
+
+static avs_error_t zlib_process(avs_compression_engine_t *engine_,
+                                const uint8_t **inout_input,
+                                size_t *inout_input_size,
+                                uint8_t **inout_output,
+                                size_t *inout_output_size,
+                                avs_compression_flush_t flush,
+                                bool *out_done) {
+    zlib_engine_t *engine = (zlib_engine_t *) engine_;
+    uInt input_size = (uInt) AVS_MIN(*inout_input_size, UINT_MAX);
+    uInt output_size = (uInt) AVS_MIN(*inout_output_size, UINT_MAX);
+    engine->zlib.next_in = (Bytef *) (intptr_t) *inout_input;
+    engine->zlib.avail_in = input_size;
+    engine->zlib.next_out = (Bytef *) *inout_output;
+    engine->zlib.avail_out = output_size;
+
+    int result;
+    if (engine->compress) {
+        result = deflate(&engine->zlib, zlib_flush(flush));
+    } else {
+        result = zlib_inflate(engine);
+    }
+
+    *inout_input += input_size - engine->zlib.avail_in;
+    *inout_input_size -= input_size - engine->zlib.avail_in;
+    *inout_output += output_size - engine->zlib.avail_out;
+    *inout_output_size -= output_size - engine->zlib.avail_out;
+    *out_done = (result == Z_STREAM_END);
+
+    if (result == Z_BUF_ERROR) {
+        /* nothing happened, ignore */
+        result = Z_OK;
+    }
+    if (result != Z_OK && result != Z_STREAM_END) {
+        avs_error_t err = map_zlib_error(result);
+        LOG(ERROR, _("zlib operation error (") "%d" _("): ") "%s", result,
+            get_zlib_msg(engine));
+        return err;
+    }
+    if (engine->compress && flush == AVS_COMPRESSION_FLUSH_SYNC
+            && engine->zlib.avail_out > 0) {
+        *out_done = true;
+    }
+    return AVS_OK;
+}
+
+static avs_error_t zlib_reset(avs_compression_engine_t *engine_) {
+    zlib_engine_t *engine = (zlib_engine_t *) engine_;
+    int result;
+    if (engine->compress) {
+        result = deflateReset(&engine->zlib);
+    } else {
+        result = inflateReset(&engine->zlib);
+    }
+    if (result == Z_OK) {
+        result = set_dictionary(engine);
+    }
+    if (result != Z_OK) {
+        return map_zlib_error(result);
+    }
+    return AVS_OK;
+}
+
+static void zlib_cleanup(avs_compression_engine_t *engine_) {
+    zlib_engine_t *engine = (zlib_engine_t *) engine_;
+    if (engine->compress) {
+        deflateEnd(&engine->zlib);
+    } else {
+        inflateEnd(&engine->zlib);
+    }
+    avs_free(engine);
+}
+
+static void *zlib_engine_alloc(void *opaque, unsigned n, unsigned size) {
+    (void) opaque;
+    return avs_calloc(n, size);
+}
+
+static void zlib_engine_free(void *opaque, void *ptr) {
+    (void) opaque;
+    avs_free(ptr);
+}
+
+static const avs_compression_engine_vtable_t zlib_engine_vtable = {
+    .process = zlib_process,
+    .reset = zlib_reset,
+    .cleanup = zlib_cleanup
+};
+
+avs_compression_engine_t *_avs_compression_zlib_engine_create(
+        bool compress, const avs_stream_compression_config_t *config) {
+    int level = config->level ? config->level : Z_DEFAULT_COMPRESSION;
+    int window_bits = config->window_bits ? config->window_bits
+                                          : ZLIB_WINDOW_BITS_MAX;
+    if (compress && (level < Z_BEST_SPEED || level > Z_BEST_COMPRESSION)
+            && level != Z_DEFAULT_COMPRESSION) {
+        LOG(ERROR, _("invalid compression level: ") "%d", level);
+        return NULL;
+    }
+    if (window_bits < ZLIB_WINDOW_BITS_MIN
+            || window_bits > ZLIB_WINDOW_BITS_MAX) {
+        LOG(ERROR, _("invalid window size: ") "%d", window_bits);
+        return NULL;
+    }
+    if (config->dictionary
+            && (config->format == AVS_STREAM_COMPRESSION_GZIP
+                || config->dictionary_size > UINT_MAX)) {
+        LOG(ERROR, _("dictionary not supported"));
+        return NULL;
+    }
+
+    zlib_engine_t *engine =
+            (zlib_engine_t *) avs_calloc(1, sizeof(zlib_engine_t));
+    if (!engine) {
+        LOG(ERROR, _("cannot allocate memory"));
+        return NULL;
+    }
+    engine->base.vtable = &zlib_engine_vtable;
+    engine->compress = compress;
+    engine->format = config->format;
+    engine->dictionary = config->dictionary;
+    engine->dictionary_size = config->dictionary_size;
+    engine->zlib.zalloc = zlib_engine_alloc;
+    engine->zlib.zfree = zlib_engine_free;
+
+    int result;
+    if (compress) {
+        result = deflateInit2(&engine->zlib, level, Z_DEFLATED,
+                              zlib_window_bits(config->format, window_bits),
+                              ZLIB_MEM_LEVEL, Z_DEFAULT_STRATEGY);
+    } else {
+        result = inflateInit2(&engine->zlib,
+                              zlib_window_bits(config->format, window_bits));
+    }
+    if (result != Z_OK) {
+        LOG(ERROR, _("could not initialize zlib (") "%d" _("): ") "%s", result,
+            get_zlib_msg(engine));
+        avs_free(engine);
+        return NULL;
+    }
+    if ((result = set_dictionary(engine)) != Z_OK) {
+        LOG(ERROR, _("could not set dictionary (") "%d" _(")"), result);
+        zlib_cleanup(&engine->base);
+        return NULL;
+    }
+    return &engine->base;
+}
+
+#endif // defined(AVS_COMMONS_WITH_AVS_STREAM) &&
+       // defined(AVS_COMMONS_STREAM_WITH_ZLIB)
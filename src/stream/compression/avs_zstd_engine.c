@@ -0,0 +1,193 @@
+/*
+ * Copyright 2021 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// NOTE: see the comment in avs_zlib_engine.c
+#define AVS_SUPPRESS_POISONING
+#include <avs_commons_init.h>
+
+#if defined(AVS_COMMONS_WITH_AVS_STREAM) \
+        && defined(AVS_COMMONS_STREAM_WITH_ZSTD)
+
+#    include <zstd.h>
+
+#    include <avs_commons_poison.h>
+
+#    include <stdint.h>
+
+#    include <avsystem/commons/avs_memory.h>
+
+#    include "avs_compression_engine.h"
+
+#    define MODULE_NAME stream_compression
+#    include <avs_x_log_config.h>
+
+VISIBILITY_SOURCE_BEGIN
+
+/*
+ * NOTE: zstd contexts are allocated using the library's default allocator, as
+ * custom allocators are only available in its experimental API.
+ */
+typedef struct {
+    avs_compression_engine_t base;
+    ZSTD_CCtx *cctx;
+    ZSTD_DCtx *dctx;
+} zstd_engine_t;
+
+static ZSTD_EndDirective zstd_end_directive(avs_compression_flush_t flush) {
+    switch (flush) {
+    case AVS_COMPRESSION_FLUSH_SYNC:
+        return ZSTD_e_flush;
+    case AVS_COMPRESSION_FLUSH_FINISH:
+        return ZSTD_e_end;
+    default:
+        return ZSTD_e_continue;
+    }
+}
+
+static avs_error_t zstd_process(avs_compression_engine_t *engine_,
+                                const uint8_t **inout_input,
+                                size_t *inout_input_size,
+                                uint8_t **inout_output,
+                                size_t *inout_output_size,
+                                avs_compression_flush_t flush,
+                                bool *out_done) {
+    zstd_engine_t *engine = (zstd_engine_t *) engine_;
+    ZSTD_inBuffer input = { *inout_input, *inout_input_size, 0 };
+    ZSTD_outBuffer output = { *inout_output, *inout_output_size, 0 };
+    size_t result;
+    if (engine->cctx) {
+        result = ZSTD_compressStream2(engine->cctx, &output, &input,
+                                      zstd_end_directive(flush));
+        *out_done = (flush != AVS_COMPRESSION_FLUSH_NONE && result == 0);
+    } else {
+        result = ZSTD_decompressStream(engine->dctx, &output, &input);
+        *out_done = (result == 0);
+    }
+
+    *inout_input += input.pos;
+    *inout_input_size -= input.pos;
+    *inout_output += output.pos;
+    *inout_output_size -= output.pos;
+
+    if (ZSTD_isError(result)) {
+        LOG(ERROR, _("zstd operation error: ") "%s", ZSTD_getErrorName(result));
+        *out_done = false;
+        return avs_errno(AVS_EIO);
+    }
+    return AVS_OK;
+}
+
+static avs_error_t zstd_reset(avs_compression_engine_t *engine_) {
+    zstd_engine_t *engine = (zstd_engine_t *) engine_;
+    /* parameters and the dictionary are preserved by session-only resets */
+    size_t result;
+    if (engine->cctx) {
+        result = ZSTD_CCtx_reset(engine->cctx, ZSTD_reset_session_only);
+    } else {
+        result = ZSTD_DCtx_reset(engine->dctx, ZSTD_reset_session_only);
+    }
+    if (ZSTD_isError(result)) {
+        LOG(ERROR, _("could not reset zstd context: ") "%s",
+            ZSTD_getErrorName(result));
+        return avs_errno(AVS_EIO);
+    }
+    return AVS_OK;
+}
+
+static void zstd_cleanup(avs_compression_engine_t *engine_) {
+    zstd_engine_t *engine = (zstd_engine_t *) engine_;
+    ZSTD_freeCCtx(engine->cctx);
+    ZSTD_freeDCtx(engine->dctx);
+    avs_free(engine);
+}
+
+static const avs_compression_engine_vtable_t zstd_engine_vtable = {
+    .process = zstd_process,
+    .reset = zstd_reset,
+    .cleanup = zstd_cleanup
+};
+
+static size_t
+configure_compressor(ZSTD_CCtx *cctx,
+                     const avs_stream_compression_config_t *config) {
+    size_t result = 0;
+    if (config->level) {
+        result = ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel,
+                                        config->level);
+    }
+    if (!ZSTD_isError(result) && config->window_bits) {
+        result = ZSTD_CCtx_setParameter(cctx, ZSTD_c_windowLog,
+                                        config->window_bits);
+    }
+    if (!ZSTD_isError(result) && config->dictionary) {
+        result = ZSTD_CCtx_loadDictionary(cctx, config->dictionary,
+                                          config->dictionary_size);
+    }
+    return result;
+}
+
+static size_t
+configure_decompressor(ZSTD_DCtx *dctx,
+                       const avs_stream_compression_config_t *config) {
+    size_t result = 0;
+    if (config->window_bits) {
+        result = ZSTD_DCtx_setParameter(dctx, ZSTD_d_windowLogMax,
+                                        config->window_bits);
+    }
+    if (!ZSTD_isError(result) && config->dictionary) {
+        result = ZSTD_DCtx_loadDictionary(dctx, config->dictionary,
+                                          config->dictionary_size);
+    }
+    return result;
+}
+
+avs_compression_engine_t *_avs_compression_zstd_engine_create(
+        bool compress, const avs_stream_compression_config_t *config) {
+    zstd_engine_t *engine =
+            (zstd_engine_t *) avs_calloc(1, sizeof(zstd_engine_t));
+    if (!engine) {
+        LOG(ERROR, _("cannot allocate memory"));
+        return NULL;
+    }
+    engine->base.vtable = &zstd_engine_vtable;
+
+    size_t result;
+    if (compress) {
+        if (!(engine->cctx = ZSTD_createCCtx())) {
+            goto fail;
+        }
+        result = configure_compressor(engine->cctx, config);
+    } else {
+        if (!(engine->dctx = ZSTD_createDCtx())) {
+            goto fail;
+        }
+        result = configure_decompressor(engine->dctx, config);
+    }
+    if (ZSTD_isError(result)) {
+        LOG(ERROR, _("could not configure zstd: ") "%s",
+            ZSTD_getErrorName(result));
+        goto fail;
+    }
+    return &engine->base;
+
+fail:
+    LOG(ERROR, _("could not initialize zstd"));
+    zstd_cleanup(&engine->base);
+    return NULL;
+}
+
+#endif // defined(AVS_COMMONS_WITH_AVS_STREAM) &&
+       // defined(AVS_COMMONS_STREAM_WITH_ZSTD)
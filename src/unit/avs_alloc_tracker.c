@@ -0,0 +1,182 @@
+/*
+ * Copyright 2021 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#define AVS_UNIT_SOURCE
+#include <avsystem/commons/avs_commons_config.h>
+
+#if defined(AVS_COMMONS_WITH_AVS_UNIT) \
+        && defined(AVS_COMMONS_UTILS_WITH_STANDARD_ALLOCATOR_HOOKS)
+
+#    include <avs_commons_posix_init.h>
+
+#    include <stdbool.h>
+#    include <stdio.h>
+
+#    include <avsystem/commons/avs_defs.h>
+#    include <avsystem/commons/avs_list.h>
+#    include <avsystem/commons/avs_memory.h>
+
+#    include "avs_alloc_tracker.h"
+#    include "avs_stack_trace.h"
+
+VISIBILITY_SOURCE_BEGIN
+
+#    define MAX_ALLOC_TRACE_LEVELS 32
+#    define MAX_REPORTED_LEAKS 10
+
+typedef struct {
+    void *ptr;
+    size_t size;
+    size_t allocation_number;
+    size_t num_addrs;
+    void *addrs[MAX_ALLOC_TRACE_LEVELS];
+} alloc_record_t;
+
+static struct {
+    unsigned paused;
+    size_t allocations_count;
+    size_t fail_at;
+    avs_unit_alloc_injected_cb_t *on_injected;
+    AVS_LIST(alloc_record_t) records;
+} g_tracker;
+
+static AVS_LIST(alloc_record_t) *find_record(void *ptr) {
+    AVS_LIST(alloc_record_t) *record_ptr;
+    AVS_LIST_FOREACH_PTR(record_ptr, &g_tracker.records) {
+        if ((*record_ptr)->ptr == ptr) {
+            return record_ptr;
+        }
+    }
+    return NULL;
+}
+
+static bool allow_allocation(size_t size) {
+    (void) size;
+    if (g_tracker.paused) {
+        return true;
+    }
+    if (++g_tracker.allocations_count != g_tracker.fail_at) {
+        return true;
+    }
+    if (g_tracker.on_injected) {
+        _avs_unit_alloc_tracker_pause();
+        g_tracker.on_injected(g_tracker.allocations_count);
+        _avs_unit_alloc_tracker_resume();
+    }
+    return false;
+}
+
+static void allocated(void *old_ptr, void *new_ptr, size_t size) {
+    if (g_tracker.paused) {
+        return;
+    }
+    if (old_ptr) {
+        AVS_LIST(alloc_record_t) *record_ptr = find_record(old_ptr);
+        // blocks allocated before the tracker was started are not tracked
+        if (record_ptr) {
+            (*record_ptr)->ptr = new_ptr;
+            (*record_ptr)->size = size;
+        }
+        return;
+    }
+
+    _avs_unit_alloc_tracker_pause();
+    alloc_record_t *record = AVS_LIST_NEW_ELEMENT(alloc_record_t);
+    _avs_unit_alloc_tracker_resume();
+    if (!record) {
+        fprintf(stderr, "cannot record allocation\n");
+        return;
+    }
+    record->ptr = new_ptr;
+    record->size = size;
+    record->allocation_number = g_tracker.allocations_count;
+    /* skip stack frames of this function and the allocator itself */
+    record->num_addrs = _avs_unit_stack_trace_capture(
+            record->addrs, AVS_ARRAY_SIZE(record->addrs), 2);
+    AVS_LIST_INSERT(&g_tracker.records, record);
+}
+
+static void freed(void *ptr) {
+    if (g_tracker.paused) {
+        return;
+    }
+    AVS_LIST(alloc_record_t) *record_ptr = find_record(ptr);
+    if (record_ptr) {
+        _avs_unit_alloc_tracker_pause();
+        AVS_LIST_DELETE(record_ptr);
+        _avs_unit_alloc_tracker_resume();
+    }
+}
+
+void _avs_unit_alloc_tracker_start(size_t fail_at,
+                                   avs_unit_alloc_injected_cb_t *on_injected) {
+    static const avs_memory_hooks_t HOOKS = {
+        .allow_allocation = allow_allocation,
+        .allocated = allocated,
+        .freed = freed
+    };
+    g_tracker.allocations_count = 0;
+    g_tracker.fail_at = fail_at;
+    g_tracker.on_injected = on_injected;
+    avs_memory_set_hooks(&HOOKS);
+}
+
+void _avs_unit_alloc_tracker_stop(void) {
+    avs_memory_set_hooks(NULL);
+}
+
+void _avs_unit_alloc_tracker_pause(void) {
+    ++g_tracker.paused;
+}
+
+void _avs_unit_alloc_tracker_resume(void) {
+    --g_tracker.paused;
+}
+
+size_t _avs_unit_alloc_tracker_outstanding(void) {
+    return AVS_LIST_SIZE(g_tracker.records);
+}
+
+size_t _avs_unit_alloc_tracker_report_leaks(FILE *file) {
+    size_t leaks = 0;
+    size_t leaked_bytes = 0;
+    _avs_unit_alloc_tracker_pause();
+    AVS_LIST_CLEAR(&g_tracker.records) {
+        if (file && leaks < MAX_REPORTED_LEAKS) {
+            fprintf(file, "leaked %zu bytes allocated in allocation #%zu\n",
+                    g_tracker.records->size,
+                    g_tracker.records->allocation_number);
+            _avs_unit_stack_trace_print_captured(file,
+                                                 g_tracker.records->addrs,
+                                                 g_tracker.records->num_addrs);
+        }
+        ++leaks;
+        leaked_bytes += g_tracker.records->size;
+    }
+    if (file && leaks > MAX_REPORTED_LEAKS) {
+        fprintf(file, "... and %zu more leaked blocks\n",
+                leaks - MAX_REPORTED_LEAKS);
+    }
+    if (file && leaks) {
+        fprintf(file, "%zu bytes leaked in %zu blocks\n", leaked_bytes, leaks);
+    }
+    _avs_unit_alloc_tracker_resume();
+    return leaks;
+}
+
+#endif // defined(AVS_COMMONS_WITH_AVS_UNIT) &&
+       // defined(AVS_COMMONS_UTILS_WITH_STANDARD_ALLOCATOR_HOOKS)
@@ -0,0 +1,83 @@
+/*
+ * Copyright 2021 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef AVS_UNIT_ALLOC_TRACKER_H
+#define AVS_UNIT_ALLOC_TRACKER_H
+
+#include <stdio.h>
+
+VISIBILITY_PRIVATE_HEADER_BEGIN
+
+#ifdef AVS_COMMONS_UTILS_WITH_STANDARD_ALLOCATOR_HOOKS
+
+typedef void avs_unit_alloc_injected_cb_t(size_t allocation_number);
+
+/**
+ * Installs allocator hooks that record every block allocated through
+ * avs_malloc(), avs_calloc() and avs_realloc() along with a stack trace, until
+ * it is freed.
+ *
+ * @param fail_at     1-based number of the allocation that shall fail, or 0 to
+ *                    not inject any failures.
+ *
+ * @param on_injected Function called just before the failure is injected. May
+ *                    be NULL.
+ */
+void _avs_unit_alloc_tracker_start(size_t fail_at,
+                                   avs_unit_alloc_injected_cb_t *on_injected);
+
+/**
+ * Uninstalls the allocator hooks. Records of outstanding allocations are kept
+ * until @ref _avs_unit_alloc_tracker_report_leaks is called.
+ */
+void _avs_unit_alloc_tracker_stop(void);
+
+/**
+ * Temporarily excludes allocations from tracking and failure injection. Used
+ * for allocations made by avs_unit itself that outlive a test. Calls may be
+ * nested, and shall be balanced with @ref _avs_unit_alloc_tracker_resume.
+ */
+void _avs_unit_alloc_tracker_pause(void);
+
+void _avs_unit_alloc_tracker_resume(void);
+
+/**
+ * Returns the number of recorded allocations that have not been freed yet.
+ */
+size_t _avs_unit_alloc_tracker_outstanding(void);
+
+/**
+ * Prints information about allocations that were recorded, but not freed, and
+ * forgets about them.
+ *
+ * @param file File to print the report to, or NULL to only discard the
+ *             records.
+ *
+ * @returns Number of leaked blocks.
+ */
+size_t _avs_unit_alloc_tracker_report_leaks(FILE *file);
+
+#else // AVS_COMMONS_UTILS_WITH_STANDARD_ALLOCATOR_HOOKS
+
+#    define _avs_unit_alloc_tracker_pause() ((void) 0)
+#    define _avs_unit_alloc_tracker_resume() ((void) 0)
+
+#endif // AVS_COMMONS_UTILS_WITH_STANDARD_ALLOCATOR_HOOKS
+
+VISIBILITY_PRIVATE_HEADER_END
+
+#endif /* AVS_UNIT_ALLOC_TRACKER_H */
@@ -26,6 +26,8 @@
 
 #    include <avsystem/commons/avs_unit_mock_helpers.h>
 
+#    include "avs_alloc_tracker.h"
+
 VISIBILITY_SOURCE_BEGIN
 
 typedef struct {
@@ -36,7 +38,11 @@ typedef struct {
 static AVS_LIST(avs_unit_mock_t) ALL_MOCKS;
 
 void avs_unit_mock_add__(avs_unit_mock_func_ptr *new_mock_ptr) {
-    avs_unit_mock_t *new_mock = AVS_LIST_NEW_ELEMENT(avs_unit_mock_t);
+    avs_unit_mock_t *new_mock;
+    /* mock entries live until the end of the whole test program */
+    _avs_unit_alloc_tracker_pause();
+    new_mock = AVS_LIST_NEW_ELEMENT(avs_unit_mock_t);
+    _avs_unit_alloc_tracker_resume();
     if (!new_mock) {
         fprintf(stderr, "cannot add new mock function entry\n");
         exit(EXIT_FAILURE);
@@ -58,6 +58,23 @@ void _avs_unit_stack_trace_print(FILE *file) {
     fprintf(file, "(stack trace not available)\n");
 }
 
+size_t _avs_unit_stack_trace_capture(void **out_addrs,
+                                     size_t max_addrs,
+                                     size_t skip_frames) {
+    (void) out_addrs;
+    (void) max_addrs;
+    (void) skip_frames;
+    return 0;
+}
+
+void _avs_unit_stack_trace_print_captured(FILE *file,
+                                          void *const *addrs,
+                                          size_t num_addrs) {
+    (void) addrs;
+    (void) num_addrs;
+    fprintf(file, "(stack trace not available)\n");
+}
+
 #    else /* AVS_COMMONS_UNIT_POSIX_HAVE_BACKTRACE */
 
 typedef struct stack_frame {
@@ -353,7 +370,7 @@ static void stack_trace_release(stack_trace_t **trace) {
 }
 
 static int fill_stack_trace(stack_trace_t *trace,
-                            void **addrs,
+                            void *const *addrs,
                             size_t num_addrs,
                             char **symbols) {
     size_t i;
@@ -372,27 +389,28 @@ static int fill_stack_trace(stack_trace_t *trace,
     return 0;
 }
 
-static stack_trace_t *stack_trace_create(size_t skip_entries_count) {
-    void *addrs[MAX_TRACE_LEVELS];
-    int num_addrs = backtrace(addrs, AVS_ARRAY_SIZE(addrs));
+static stack_trace_t *stack_trace_create_from_addrs(void *const *addrs,
+                                                    size_t num_addrs) {
     char **symbols = NULL;
     int result;
     stack_trace_t *trace = NULL;
 
-    if ((int) skip_entries_count > num_addrs) {
+    if (!num_addrs) {
         return NULL;
     }
 
     trace = (stack_trace_t *) avs_calloc(
-            1,
-            sizeof(stack_trace_t) + (size_t) num_addrs * sizeof(stack_frame_t));
+            1, sizeof(stack_trace_t) + num_addrs * sizeof(stack_frame_t));
     if (!trace) {
         return NULL;
     }
 
-    symbols = backtrace_symbols(addrs, num_addrs);
-    result = fill_stack_trace(trace, addrs + skip_entries_count,
-                              (size_t) num_addrs - skip_entries_count, symbols);
+    symbols = backtrace_symbols(addrs, (int) num_addrs);
+    if (!symbols) {
+        avs_free(trace);
+        return NULL;
+    }
+    result = fill_stack_trace(trace, addrs, num_addrs, symbols);
     avs_free(symbols);
 
     if (result) {
@@ -403,10 +421,24 @@ static stack_trace_t *stack_trace_create(size_t skip_entries_count) {
     return trace;
 }
 
-void _avs_unit_stack_trace_print(FILE *file) {
-    /* skip stack frame for this function and `stack_trace_create` call */
-    const size_t SKIP_FRAMES = 2;
-    stack_trace_t *trace = stack_trace_create(SKIP_FRAMES);
+size_t _avs_unit_stack_trace_capture(void **out_addrs,
+                                     size_t max_addrs,
+                                     size_t skip_frames) {
+    void *addrs[MAX_TRACE_LEVELS];
+    int num_addrs = backtrace(addrs, AVS_ARRAY_SIZE(addrs));
+    size_t result;
+
+    /* skip stack frame for this function */
+    ++skip_frames;
+    if (num_addrs < 0 || (size_t) num_addrs <= skip_frames) {
+        return 0;
+    }
+    result = AVS_MIN((size_t) num_addrs - skip_frames, max_addrs);
+    memcpy(out_addrs, addrs + skip_frames, result * sizeof(void *));
+    return result;
+}
+
+static void print_stack_trace(FILE *file, const stack_trace_t *trace) {
     size_t i;
 
     if (!trace) {
@@ -423,10 +455,25 @@ void _avs_unit_stack_trace_print(FILE *file) {
         }
     }
     fprintf(file, "-------------------\n");
+}
 
+void _avs_unit_stack_trace_print_captured(FILE *file,
+                                          void *const *addrs,
+                                          size_t num_addrs) {
+    stack_trace_t *trace = stack_trace_create_from_addrs(addrs, num_addrs);
+    print_stack_trace(file, trace);
     stack_trace_release(&trace);
 }
 
+void _avs_unit_stack_trace_print(FILE *file) {
+    void *addrs[MAX_TRACE_LEVELS];
+    /* skip stack frame for this function */
+    size_t num_addrs =
+            _avs_unit_stack_trace_capture(addrs, AVS_ARRAY_SIZE(addrs), 1);
+
+    _avs_unit_stack_trace_print_captured(file, addrs, num_addrs);
+}
+
 #    endif /* AVS_COMMONS_UNIT_POSIX_HAVE_BACKTRACE */
 
 #endif // AVS_COMMONS_WITH_AVS_UNIT
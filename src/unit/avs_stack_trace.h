@@ -25,6 +25,29 @@ void _avs_unit_stack_trace_init(int argc, char **argv);
 
 void _avs_unit_stack_trace_print(FILE *file);
 
+/**
+ * Stores up to @p max_addrs return addresses from the current call stack in
+ * @p out_addrs, skipping @p skip_frames innermost frames (not including the
+ * frame of this function itself). Does not allocate memory through
+ * avs_malloc() and friends, and does not resolve any symbols, so it is cheap
+ * enough to be called on every allocation.
+ *
+ * @returns Number of addresses stored, which may be 0 if stack traces are not
+ *          available.
+ */
+size_t _avs_unit_stack_trace_capture(void **out_addrs,
+                                     size_t max_addrs,
+                                     size_t skip_frames);
+
+/**
+ * Prints a stack trace previously captured using
+ * @ref _avs_unit_stack_trace_capture, in the same format as
+ * @ref _avs_unit_stack_trace_print.
+ */
+void _avs_unit_stack_trace_print_captured(FILE *file,
+                                          void *const *addrs,
+                                          size_t num_addrs);
+
 VISIBILITY_PRIVATE_HEADER_END
 
 #endif /* AVS_UNIT_STACKTRACE_H */
@@ -22,6 +22,7 @@
 #    include <avs_commons_posix_init.h>
 
 #    include <ctype.h>
+#    include <errno.h>
 #    include <inttypes.h>
 #    include <math.h>
 #    include <stdarg.h>
@@ -42,6 +43,7 @@
 #        include <avsystem/commons/avs_log.h>
 #    endif
 
+#    include "avs_alloc_tracker.h"
 #    include "avs_stack_trace.h"
 #    include "avs_unit_test_private.h"
 
@@ -65,6 +67,15 @@ static AVS_LIST(avs_unit_init_function_t) global_init = NULL;
 static AVS_LIST(avs_unit_test_suite_t) test_suites = NULL;
 static int verbose = 0;
 
+#    ifdef AVS_COMMONS_UTILS_WITH_STANDARD_ALLOCATOR_HOOKS
+static bool alloc_failures_enabled = false;
+/* maximum number of runs per test in alloc failures mode; 0 if unlimited */
+static size_t alloc_failures_max_runs = 0;
+static size_t alloc_fail_at = 0;
+static bool alloc_failure_injected = false;
+static int alloc_failure_injected_fd = -1;
+#    endif // AVS_COMMONS_UTILS_WITH_STANDARD_ALLOCATOR_HOOKS
+
 static int add_init_func(AVS_LIST(avs_unit_init_function_t) *list,
                          avs_unit_init_function_t init_func) {
     avs_unit_init_function_t *new_init =
@@ -497,12 +508,207 @@ static void list_tests_for_suite(avs_unit_test_suite_t *suite) {
     }
 }
 
+#    ifdef AVS_COMMONS_UTILS_WITH_STANDARD_ALLOCATOR_HOOKS
+static int parse_size(const char *str, size_t *out_value) {
+    char *endptr = NULL;
+    unsigned long long value;
+
+    errno = 0;
+    value = strtoull(str, &endptr, 10);
+    if (errno || !*str || *endptr || !isdigit((unsigned char) *str)
+            || value > SIZE_MAX) {
+        return -1;
+    }
+    *out_value = (size_t) value;
+    return 0;
+}
+
+static void print_injected_allocation(size_t allocation_number) {
+    alloc_failure_injected = true;
+    printf("failing allocation #%zu\n", allocation_number);
+    _avs_unit_stack_trace_print(stdout);
+    /* make sure the output is not lost if the test crashes */
+    fflush(stdout);
+}
+
+static int finish_test_with_alloc_fail_at(int result) {
+    _avs_unit_alloc_tracker_stop();
+    if (result) {
+        /* the test had no chance to clean up after the failed assertion */
+        _avs_unit_alloc_tracker_report_leaks(NULL);
+        return result;
+    }
+    if (!alloc_failure_injected) {
+        printf("allocation #%zu was not reached\n", alloc_fail_at);
+    }
+    return _avs_unit_alloc_tracker_report_leaks(stdout) ? 1 : 0;
+}
+
+#        define ALLOC_RUN_FAILED 1
+#        define ALLOC_RUN_LEAKED 2
+
+static void notify_injected_allocation(size_t allocation_number) {
+    (void) allocation_number;
+    if (write(alloc_failure_injected_fd, "", 1) != 1) {
+        perror("write() failed");
+    }
+}
+
+/**
+ * Redirects standard output and standard error to /dev/null.
+ *
+ * @returns Stream that writes to the original standard output, or NULL if
+ *          output could not be redirected.
+ */
+static FILE *silence_output(void) {
+    int report_fd = dup(STDOUT_FILENO);
+    int null_fd = open("/dev/null", O_WRONLY);
+    FILE *report = NULL;
+
+    if (report_fd >= 0 && null_fd >= 0
+            && (report = fdopen(report_fd, "w")) != NULL) {
+        report_fd = -1;
+        if (dup2(null_fd, STDOUT_FILENO) < 0
+                || dup2(null_fd, STDERR_FILENO) < 0) {
+            fclose(report);
+            report = NULL;
+        }
+    }
+    if (report_fd >= 0) {
+        close(report_fd);
+    }
+    if (null_fd >= 0) {
+        close(null_fd);
+    }
+    return report;
+}
+
+/**
+ * Runs @p test in a forked child process, with @p fail_at -th allocation
+ * failing.
+ *
+ * @returns Exit code for the child process, made of ALLOC_RUN_* flags.
+ */
+static int run_test_in_child(avs_unit_test_t *test, size_t fail_at) {
+    volatile int status = 0;
+    FILE *report = NULL;
+
+    if (verbose < 2) {
+        report = silence_output();
+    }
+    if (!report) {
+        report = stdout;
+    }
+
+    _avs_unit_alloc_tracker_start(fail_at, notify_injected_allocation);
+    if (setjmp(_avs_unit_jmp_buf) == 0) {
+        test->test();
+    } else {
+        status |= ALLOC_RUN_FAILED;
+    }
+    _avs_unit_alloc_tracker_stop();
+
+    if (status & ALLOC_RUN_FAILED) {
+        /* the test had no chance to clean up after the failed assertion */
+        _avs_unit_alloc_tracker_report_leaks(NULL);
+    } else if (_avs_unit_alloc_tracker_outstanding()) {
+        fprintf(report, "    %s: memory leaked when allocation #%zu failed\n",
+                test->name, fail_at);
+        _avs_unit_alloc_tracker_report_leaks(report);
+        status |= ALLOC_RUN_LEAKED;
+    }
+    fflush(NULL);
+    return status;
+}
+
+/**
+ * Re-runs @p test in child processes, making consecutive allocations fail,
+ * until a run finishes without reaching the allocation meant to fail.
+ *
+ * @returns 0 if all runs either passed or failed an assertion, or 1 if any of
+ *          them crashed or leaked memory.
+ */
+static int run_test_with_alloc_failures(const char *program_name,
+                                        const char *suite_name,
+                                        avs_unit_test_t *test) {
+    size_t runs = 0;
+    size_t runs_failed = 0;
+    size_t runs_leaked = 0;
+    size_t runs_crashed = 0;
+    size_t fail_at;
+
+    for (fail_at = 1; !alloc_failures_max_runs
+                      || fail_at <= alloc_failures_max_runs;
+         ++fail_at) {
+        int pipe_fds[2];
+        int wait_status;
+        char byte;
+        bool injected;
+        pid_t pid;
+
+        if (pipe(pipe_fds)) {
+            perror("pipe() failed");
+            return 1;
+        }
+        fflush(NULL);
+        if ((pid = fork()) == 0) {
+            close(pipe_fds[0]);
+            alloc_failure_injected_fd = pipe_fds[1];
+            _exit(run_test_in_child(test, fail_at));
+        }
+        close(pipe_fds[1]);
+        if (pid < 0) {
+            perror("fork() failed");
+            close(pipe_fds[0]);
+            return 1;
+        }
+        while (waitpid(pid, &wait_status, 0) < 0) {
+            if (errno != EINTR) {
+                perror("waitpid() failed");
+                close(pipe_fds[0]);
+                return 1;
+            }
+        }
+        injected = (read(pipe_fds[0], &byte, 1) == 1);
+        close(pipe_fds[0]);
+
+        if (WIFSIGNALED(wait_status)) {
+            ++runs_crashed;
+            test_printf(NORMAL,
+                        "    %s: crashed with signal %d when allocation #%zu "
+                        "failed; run '%s --alloc-fail-at=%zu %s %s' to "
+                        "reproduce\n",
+                        test->name, WTERMSIG(wait_status), fail_at,
+                        program_name, fail_at, suite_name, test->name);
+        } else if (WEXITSTATUS(wait_status) & ALLOC_RUN_LEAKED) {
+            ++runs_leaked;
+        } else if (WEXITSTATUS(wait_status) & ALLOC_RUN_FAILED) {
+            ++runs_failed;
+        }
+        if (!injected) {
+            break;
+        }
+        ++runs;
+    }
+
+    test_printf(VERBOSE,
+                "        %zu allocation failures injected: %zu failed the "
+                "test, %zu leaked memory, %zu crashed\n",
+                runs, runs_failed, runs_leaked, runs_crashed);
+    return (runs_leaked || runs_crashed) ? 1 : 0;
+}
+#    endif // AVS_COMMONS_UTILS_WITH_STANDARD_ALLOCATOR_HOOKS
+
 static int parse_command_line_args(int argc,
                                    char *argv[],
                                    const char *volatile *out_selected_suite,
                                    const char *volatile *out_selected_test) {
     while (1) {
         static const struct option long_options[] = {
+#    ifdef AVS_COMMONS_UTILS_WITH_STANDARD_ALLOCATOR_HOOKS
+            { "alloc-failures", optional_argument, 0, 'a' },
+            { "alloc-fail-at", required_argument, 0, 'A' },
+#    endif // AVS_COMMONS_UTILS_WITH_STANDARD_ALLOCATOR_HOOKS
             { "help", no_argument, 0, 'h' },
             { "list", optional_argument, 0, 'l' },
             { "verbose", no_argument, 0, 'v' },
@@ -512,7 +718,7 @@ static int parse_command_line_args(int argc,
         int option_index = 0;
         int c;
 
-        c = getopt_long(argc, argv, "hl::v", long_options, &option_index);
+        c = getopt_long(argc, argv, "a::hl::v", long_options, &option_index);
         if (c == -1)
             break;
 
@@ -536,6 +742,23 @@ static int parse_command_line_args(int argc,
                         "test case instead of a summary per test suite.\n"
                         "\n",
                         argv[0]);
+#    ifdef AVS_COMMONS_UTILS_WITH_STANDARD_ALLOCATOR_HOOKS
+            test_printf(NORMAL,
+                        "    -a, --alloc-failures[=MAX_RUNS] - after each "
+                        "test case passes, re-run it in a child process once "
+                        "for each allocation made through avs_malloc(), "
+                        "avs_calloc() or avs_realloc(), making the k-th "
+                        "allocation fail in the k-th run, up to MAX_RUNS runs "
+                        "if specified. Assertion failures in these runs are "
+                        "ignored, but the test case fails if a run crashes, "
+                        "or leaks memory despite passing. Specify -v twice to "
+                        "see output of the runs.\n"
+                        "    --alloc-fail-at=K - make only the K-th allocation "
+                        "fail in each test case, and report memory leaks. "
+                        "Tests are run in the main process, which is useful "
+                        "for debugging crashes found with --alloc-failures.\n"
+                        "\n");
+#    endif // AVS_COMMONS_UTILS_WITH_STANDARD_ALLOCATOR_HOOKS
             test_printf(NORMAL,
                         "ENVIRONMENT VARIABLES\n"
                         "    AVS_LOG - a list of semicolon-separated log level "
@@ -596,6 +819,22 @@ static int parse_command_line_args(int argc,
         case 'v':
             verbose += 1;
             break;
+#    ifdef AVS_COMMONS_UTILS_WITH_STANDARD_ALLOCATOR_HOOKS
+        case 'a':
+            alloc_failures_enabled = true;
+            if (optarg && parse_size(optarg, &alloc_failures_max_runs)) {
+                test_printf(NORMAL, "invalid number of runs: %s\n", optarg);
+                return -1;
+            }
+            break;
+        case 'A':
+            if (parse_size(optarg, &alloc_fail_at) || !alloc_fail_at) {
+                test_printf(NORMAL, "invalid allocation number: %s\n",
+                            optarg);
+                return -1;
+            }
+            break;
+#    endif // AVS_COMMONS_UTILS_WITH_STANDARD_ALLOCATOR_HOOKS
         default:
             break;
         }
@@ -749,11 +988,28 @@ int main(int argc, char *argv[]) {
             if (selected_test && strcmp(selected_test, current_test->name)) {
                 continue;
             }
+#    ifdef AVS_COMMONS_UTILS_WITH_STANDARD_ALLOCATOR_HOOKS
+            if (alloc_fail_at) {
+                alloc_failure_injected = false;
+                _avs_unit_alloc_tracker_start(alloc_fail_at,
+                                              print_injected_allocation);
+            }
+#    endif // AVS_COMMONS_UTILS_WITH_STANDARD_ALLOCATOR_HOOKS
             if (setjmp(_avs_unit_jmp_buf) == 0) {
                 current_test->test();
                 result = 0;
             } else {
                 result = 1;
+            }
+#    ifdef AVS_COMMONS_UTILS_WITH_STANDARD_ALLOCATOR_HOOKS
+            if (alloc_fail_at) {
+                result = finish_test_with_alloc_fail_at(result);
+            } else if (!result && alloc_failures_enabled) {
+                result = run_test_with_alloc_failures(
+                        argv[0], current_suite->name, current_test);
+            }
+#    endif // AVS_COMMONS_UTILS_WITH_STANDARD_ALLOCATOR_HOOKS
+            if (result) {
                 tests_result = 1;
             }
 
@@ -517,6 +517,433 @@ void avs_url_free(avs_url_t *url) {
     avs_free(url);
 }
 
+/* Characters allowed unescaped in the userinfo portion, according to both
+ * RFC 3986 and is_valid_credential_char(). */
+#    define CREDENTIAL_UNRESERVED "-_.!$&'()*+,;="
+
+typedef struct {
+    char *buf;
+    size_t size;
+    /* may be larger than size, in which case the output has been truncated */
+    size_t length;
+} url_writer_t;
+
+static void writer_append(url_writer_t *writer,
+                          const char *data,
+                          size_t length) {
+    if (writer->length < writer->size) {
+        memcpy(writer->buf + writer->length, data,
+               AVS_MIN(length, writer->size - writer->length));
+    }
+    writer->length += length;
+}
+
+static void writer_append_str(url_writer_t *writer, const char *str) {
+    writer_append(writer, str, strlen(str));
+}
+
+static void writer_append_encoded(url_writer_t *writer,
+                                  const char *str,
+                                  const char *unreserved_chars) {
+    static const char HEX_DIGITS[] = "0123456789ABCDEF";
+    for (; *str; ++str) {
+        unsigned char c = (unsigned char) *str;
+        if (c < 0x80 && (isalnum(c) || strchr(unreserved_chars, c))) {
+            writer_append(writer, str, 1);
+        } else {
+            const char escaped[] = { '%', HEX_DIGITS[c >> 4],
+                                     HEX_DIGITS[c & 0xF] };
+            writer_append(writer, escaped, sizeof(escaped));
+        }
+    }
+}
+
+static int writer_finish(url_writer_t *writer) {
+    if (writer->length >= writer->size) {
+        if (writer->size) {
+            writer->buf[writer->size - 1] = '\0';
+        }
+        return -1;
+    }
+    writer->buf[writer->length] = '\0';
+    return 0;
+}
+
+static void write_authority(url_writer_t *writer,
+                            const char *user,
+                            const char *password,
+                            const char *host,
+                            const char *port) {
+    if (user || password) {
+        writer_append_encoded(writer, user ? user : "", CREDENTIAL_UNRESERVED);
+        if (password) {
+            writer_append_str(writer, ":");
+            writer_append_encoded(writer, password, CREDENTIAL_UNRESERVED);
+        }
+        writer_append_str(writer, "@");
+    }
+    if (strchr(host, ':')) {
+        writer_append_str(writer, "[");
+        writer_append_str(writer, host);
+        writer_append_str(writer, "]");
+    } else {
+        writer_append_str(writer, host);
+    }
+    if (port) {
+        writer_append_str(writer, ":");
+        writer_append_str(writer, port);
+    }
+}
+
+int avs_url_build(char *buf,
+                  size_t buf_size,
+                  const avs_url_components_t *components) {
+    assert(buf || !buf_size);
+    assert(components);
+    if (!components->host
+            && (components->user || components->password
+                || components->port)) {
+        LOG(ERROR, _("user, password and port require host to be present"));
+        return -1;
+    }
+    if (components->host && components->path && *components->path
+            && !strchr("/?#", *components->path)) {
+        LOG(ERROR, _("path must be absolute if host is present"));
+        return -1;
+    }
+    url_writer_t writer = {
+        .buf = buf,
+        .size = buf_size
+    };
+    if (components->protocol) {
+        writer_append_str(&writer, components->protocol);
+        writer_append_str(&writer, ":");
+    }
+    if (components->host) {
+        writer_append_str(&writer, "//");
+        write_authority(&writer, components->user, components->password,
+                        components->host, components->port);
+    }
+    if (components->path) {
+        writer_append_str(&writer, components->path);
+    }
+    if (components->query) {
+        writer_append_str(&writer, "?");
+        writer_append_str(&writer, components->query);
+    }
+    return writer_finish(&writer);
+}
+
+int avs_url_format(const avs_url_t *url, char *buf, size_t buf_size) {
+    return avs_url_build(buf, buf_size,
+                         &(const avs_url_components_t) {
+                             .protocol = avs_url_protocol(url),
+                             .user = avs_url_user(url),
+                             .password = avs_url_password(url),
+                             .host = avs_url_host(url),
+                             .port = avs_url_port(url),
+                             .path = avs_url_path(url)
+                         });
+}
+
+static void remove_last_segment(const char *path, char **out_ptr) {
+    while (*out_ptr > path) {
+        if (*--*out_ptr == '/') {
+            break;
+        }
+    }
+}
+
+/**
+ * Implements the remove_dot_segments algorithm from RFC 3986 section 5.2.4 in
+ * place. The output is never longer than the input, so the output buffer can
+ * share memory with the input buffer. Returns the new length of the path.
+ */
+static size_t remove_dot_segments(char *path, size_t length) {
+    char *in = path;
+    char *const end = path + length;
+    char *out = path;
+    while (in < end) {
+        size_t left = (size_t) (end - in);
+        if (left >= 3 && !memcmp(in, "../", 3)) {
+            in += 3;
+        } else if (left >= 2 && !memcmp(in, "./", 2)) {
+            in += 2;
+        } else if (left >= 3 && !memcmp(in, "/./", 3)) {
+            in += 2;
+        } else if (left == 2 && !memcmp(in, "/.", 2)) {
+            // replace "/." with "/"; out < in, so it is safe to overwrite
+            *++in = '/';
+        } else if (left >= 4 && !memcmp(in, "/../", 4)) {
+            in += 3;
+            remove_last_segment(path, &out);
+        } else if (left == 3 && !memcmp(in, "/..", 3)) {
+            in += 2;
+            *in = '/';
+            remove_last_segment(path, &out);
+        } else if ((left == 1 && *in == '.')
+                   || (left == 2 && !memcmp(in, "..", 2))) {
+            in = end;
+        } else {
+            do {
+                *out++ = *in++;
+            } while (in < end && *in != '/');
+        }
+    }
+    return (size_t) (out - path);
+}
+
+typedef struct {
+    const char *ptr;
+    size_t length;
+    bool defined;
+} url_span_t;
+
+typedef struct {
+    url_span_t scheme;
+    url_span_t authority;
+    url_span_t path;
+    url_span_t query;
+    url_span_t fragment;
+} url_ref_t;
+
+static url_span_t make_span(const char *ptr, size_t length) {
+    return (url_span_t) {
+        .ptr = ptr,
+        .length = length,
+        .defined = true
+    };
+}
+
+static void split_path_query_fragment(const char *str, url_ref_t *out) {
+    size_t path_length = strcspn(str, "?#");
+    out->path = make_span(str, path_length);
+    str += path_length;
+    if (*str == '?') {
+        size_t query_length = strcspn(++str, "#");
+        out->query = make_span(str, query_length);
+        str += query_length;
+    }
+    if (*str == '#') {
+        ++str;
+        out->fragment = make_span(str, strlen(str));
+    }
+}
+
+/* Splits a URI reference into components, as in RFC 3986 appendix B. */
+static void split_ref(const char *ref, url_ref_t *out) {
+    memset(out, 0, sizeof(*out));
+    size_t scheme_length = strcspn(ref, ":/?#");
+    if (ref[scheme_length] == ':' && isalpha((unsigned char) ref[0])) {
+        size_t i = 1;
+        while (i < scheme_length && is_valid_schema_char(ref[i])) {
+            ++i;
+        }
+        if (i == scheme_length) {
+            out->scheme = make_span(ref, scheme_length);
+            ref += scheme_length + 1;
+        }
+    }
+    if (ref[0] == '/' && ref[1] == '/') {
+        ref += 2;
+        size_t authority_length = strcspn(ref, "/?#");
+        out->authority = make_span(ref, authority_length);
+        ref += authority_length;
+    }
+    split_path_query_fragment(ref, out);
+}
+
+static void writer_append_span(url_writer_t *writer, const url_span_t *span) {
+    writer_append(writer, span->ptr, span->length);
+}
+
+static void write_path_without_dot_segments(url_writer_t *writer,
+                                            const url_span_t *base_prefix,
+                                            const url_span_t *path) {
+    size_t start = writer->length;
+    if (base_prefix) {
+        writer_append_span(writer, base_prefix);
+    }
+    writer_append_span(writer, path);
+    assert(writer->length < writer->size);
+    writer->length = start
+                     + remove_dot_segments(writer->buf + start,
+                                           writer->length - start);
+}
+
+avs_url_t *avs_url_resolve(const avs_url_t *base, const char *ref) {
+    assert(base);
+    assert(ref);
+    if (!base->has_protocol) {
+        LOG(ERROR, _("base URL must contain the protocol"));
+        return NULL;
+    }
+    url_ref_t r;
+    split_ref(ref, &r);
+    url_ref_t b;
+    memset(&b, 0, sizeof(b));
+    b.scheme = make_span(base->data, strlen(base->data));
+    split_path_query_fragment(avs_url_path(base), &b);
+
+    // first pass only calculates the length of the base authority
+    url_writer_t base_authority = { NULL, 0, 0 };
+    if (avs_url_host(base)) {
+        write_authority(&base_authority, avs_url_user(base),
+                        avs_url_password(base), avs_url_host(base),
+                        avs_url_port(base));
+    }
+    // target components are taken either from the base URL or from the
+    // reference, so the sum of their lengths is a safe upper bound
+    url_writer_t writer = {
+        .size = b.scheme.length + base_authority.length
+                + strlen(avs_url_path(base)) + strlen(ref) + sizeof("://?#/")
+    };
+    if (!(writer.buf = (char *) avs_malloc(writer.size))) {
+        LOG(ERROR, _("Out of memory"));
+        return NULL;
+    }
+
+    const url_span_t *query = &r.query;
+    writer_append_span(&writer, r.scheme.defined ? &r.scheme : &b.scheme);
+    writer_append_str(&writer, ":");
+    if (r.scheme.defined || r.authority.defined) {
+        if (r.authority.defined) {
+            writer_append_str(&writer, "//");
+            writer_append_span(&writer, &r.authority);
+        }
+        write_path_without_dot_segments(&writer, NULL, &r.path);
+    } else {
+        if (avs_url_host(base)) {
+            writer_append_str(&writer, "//");
+            write_authority(&writer, avs_url_user(base), avs_url_password(base),
+                            avs_url_host(base), avs_url_port(base));
+        }
+        if (!r.path.length) {
+            writer_append_span(&writer, &b.path);
+            if (!r.query.defined) {
+                query = &b.query;
+            }
+        } else if (*r.path.ptr == '/') {
+            write_path_without_dot_segments(&writer, NULL, &r.path);
+        } else {
+            // merge paths as described in RFC 3986 section 5.2.3
+            url_span_t prefix;
+            if (avs_url_host(base) && !b.path.length) {
+                prefix = make_span("/", 1);
+            } else {
+                size_t prefix_length = b.path.length;
+                while (prefix_length > 0
+                       && b.path.ptr[prefix_length - 1] != '/') {
+                    --prefix_length;
+                }
+                prefix = make_span(b.path.ptr, prefix_length);
+            }
+            write_path_without_dot_segments(&writer, &prefix, &r.path);
+        }
+    }
+    if (query->defined) {
+        writer_append_str(&writer, "?");
+        writer_append_span(&writer, query);
+    }
+    if (r.fragment.defined) {
+        writer_append_str(&writer, "#");
+        writer_append_span(&writer, &r.fragment);
+    }
+    avs_url_t *result = NULL;
+    if (writer_finish(&writer)) {
+        AVS_UNREACHABLE("URL resolution buffer too small");
+    } else {
+        result = avs_url_parse_lenient(writer.buf);
+    }
+    avs_free(writer.buf);
+    return result;
+}
+
+static int hex_digit_value(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    return tolower((unsigned char) c) - 'a' + 10;
+}
+
+/* Implements RFC 3986 section 6.2.2.2 in place; returns the new length. */
+static size_t normalize_percent_encoding(char *str) {
+    const char *in = str;
+    char *out = str;
+    while (*in) {
+        if (is_valid_escape_sequence(in)) {
+            int value = hex_digit_value(in[1]) * 16 + hex_digit_value(in[2]);
+            if (value > 0 && value < 0x80
+                    && (isalnum(value) || strchr(AVS_URL_PERCENT_UNRESERVED,
+                                                 value))) {
+                *out++ = (char) value;
+            } else {
+                *out++ = '%';
+                *out++ = (char) toupper((unsigned char) in[1]);
+                *out++ = (char) toupper((unsigned char) in[2]);
+            }
+            in += sizeof("%xx") - 1;
+        } else {
+            *out++ = *in++;
+        }
+    }
+    *out = '\0';
+    return (size_t) (out - str);
+}
+
+static void str_to_lower(char *str) {
+    for (; *str; ++str) {
+        *str = (char) tolower((unsigned char) *str);
+    }
+}
+
+static bool is_default_port(const char *protocol, const char *port) {
+    static const struct {
+        const char *protocol;
+        const char *port;
+    } DEFAULT_PORTS[] = {
+        { "http", "80" },        { "https", "443" },
+        { "ws", "80" },          { "wss", "443" },
+        { "coap", "5683" },      { "coaps", "5684" },
+        { "coap+tcp", "5683" },  { "coaps+tcp", "5684" }
+    };
+    while (*port == '0') {
+        ++port;
+    }
+    for (size_t i = 0; protocol && i < AVS_ARRAY_SIZE(DEFAULT_PORTS); ++i) {
+        if (!strcmp(protocol, DEFAULT_PORTS[i].protocol)) {
+            return !strcmp(port, DEFAULT_PORTS[i].port);
+        }
+    }
+    return false;
+}
+
+void avs_url_normalize(avs_url_t *url) {
+    assert(url);
+    if (url->has_protocol) {
+        str_to_lower(url->data);
+    }
+    if (url->host_ptr != URL_PTR_INVALID) {
+        str_to_lower(&url->data[url->host_ptr]);
+    }
+    if (url->port_ptr != URL_PTR_INVALID
+            && (!url->data[url->port_ptr]
+                || is_default_port(avs_url_protocol(url),
+                                   &url->data[url->port_ptr]))) {
+        // the port string is left in data, but is no longer referenced
+        url->port_ptr = URL_PTR_INVALID;
+    }
+    // path is the last component in data, so it can be shortened in place
+    char *path = &url->data[url->path_ptr];
+    normalize_percent_encoding(path);
+    if (url->has_protocol) {
+        size_t path_length = strcspn(path, "?#");
+        size_t new_path_length = remove_dot_segments(path, path_length);
+        memmove(path + new_path_length, path + path_length,
+                strlen(path + path_length) + 1);
+    }
+}
+
 #    ifdef AVS_UNIT_TESTING
 #        include "tests/url/url.c"
 #    endif // AVS_UNIT_TESTING
@@ -0,0 +1,250 @@
+/*
+ * Copyright 2021 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <avs_commons_init.h>
+
+#if defined(AVS_COMMONS_WITH_AVS_UTILS) && defined(AVS_COMMONS_UTILS_WITH_TRACE)
+
+#    include <string.h>
+
+#    include <avsystem/commons/avs_memory.h>
+#    include <avsystem/commons/avs_time.h>
+#    include <avsystem/commons/avs_trace.h>
+#    include <avsystem/commons/avs_utils.h>
+
+VISIBILITY_SOURCE_BEGIN
+
+typedef struct {
+    const char *category;
+    const char *name;
+    int64_t timestamp_ns;
+    char phase;
+} trace_event_t;
+
+typedef struct trace_ring_struct {
+    struct trace_ring_struct *next;
+
+    /** Thread identifier used in the exported trace. */
+    unsigned tid;
+
+    /**
+     * Total number of events ever recorded in this ring. The next event will
+     * be written at index <c>head & (g_capacity - 1)</c>.
+     */
+    size_t head;
+
+    trace_event_t events[];
+} trace_ring_t;
+
+/** Capacity of each ring buffer, always a power of two; 0 if disabled. */
+static size_t g_capacity;
+
+/**
+ * Incremented on each init and cleanup, so that threads can detect that their
+ * cached ring buffer pointer is no longer valid.
+ */
+static unsigned g_generation;
+
+/** List of all ring buffers allocated since the last init. */
+static trace_ring_t *g_rings;
+
+static unsigned g_last_tid;
+
+#    if defined(__GNUC__) || defined(__clang__)
+#        define TRACE_THREAD_LOCAL __thread
+
+static void rings_push(trace_ring_t *ring) {
+    ring->next = __atomic_load_n(&g_rings, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&g_rings, &ring->next, ring, true,
+                                        __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+    }
+}
+
+static unsigned next_tid(void) {
+    return __atomic_add_fetch(&g_last_tid, 1, __ATOMIC_RELAXED);
+}
+#    else // defined(__GNUC__) || defined(__clang__)
+// C99 has no thread-local storage - a single ring buffer is shared by all
+// threads, and recording events from multiple threads is NOT thread-safe.
+#        define TRACE_THREAD_LOCAL
+
+static void rings_push(trace_ring_t *ring) {
+    ring->next = g_rings;
+    g_rings = ring;
+}
+
+static unsigned next_tid(void) {
+    return ++g_last_tid;
+}
+#    endif // defined(__GNUC__) || defined(__clang__)
+
+static TRACE_THREAD_LOCAL trace_ring_t *t_ring;
+static TRACE_THREAD_LOCAL unsigned t_generation;
+
+static trace_ring_t *get_thread_ring(size_t capacity) {
+    if (t_generation != g_generation || !t_ring) {
+        t_generation = g_generation;
+        t_ring = (trace_ring_t *) avs_calloc(
+                1, sizeof(trace_ring_t) + capacity * sizeof(trace_event_t));
+        if (t_ring) {
+            t_ring->tid = next_tid();
+            rings_push(t_ring);
+        }
+    }
+    return t_ring;
+}
+
+void avs_trace_event__(char phase, const char *category, const char *name) {
+    size_t capacity = g_capacity;
+    trace_ring_t *ring;
+    if (!capacity || !(ring = get_thread_ring(capacity))) {
+        return;
+    }
+    trace_event_t *event = &ring->events[ring->head & (capacity - 1)];
+    int64_t timestamp_ns;
+    if (avs_time_monotonic_to_scalar(&timestamp_ns, AVS_TIME_NS,
+                                     avs_time_monotonic_now())) {
+        timestamp_ns = 0;
+    }
+    event->category = category;
+    event->name = name;
+    event->timestamp_ns = timestamp_ns;
+    event->phase = phase;
+    ++ring->head;
+}
+
+int avs_trace_init(size_t events_per_thread) {
+    if (g_capacity || !events_per_thread) {
+        return -1;
+    }
+    size_t capacity = 1;
+    while (capacity < events_per_thread) {
+        if (capacity > SIZE_MAX / 2) {
+            return -1;
+        }
+        capacity *= 2;
+    }
+    ++g_generation;
+    g_capacity = capacity;
+    return 0;
+}
+
+void avs_trace_cleanup(void) {
+    g_capacity = 0;
+    ++g_generation;
+    while (g_rings) {
+        trace_ring_t *ring = g_rings;
+        g_rings = ring->next;
+        avs_free(ring);
+    }
+    g_last_tid = 0;
+}
+
+static int write_str(avs_trace_writer_t *writer, void *arg, const char *str) {
+    return writer(arg, str, strlen(str));
+}
+
+static int write_json_string(avs_trace_writer_t *writer,
+                             void *arg,
+                             const char *str) {
+    if (writer(arg, "\"", 1)) {
+        return -1;
+    }
+    const char *chunk = str;
+    for (; *str; ++str) {
+        if (*str == '"' || *str == '\\' || (unsigned char) *str < 0x20) {
+            char escaped[sizeof("\\u0000")];
+            int result = (*str == '"' || *str == '\\')
+                                 ? avs_simple_snprintf(escaped, sizeof(escaped),
+                                                       "\\%c", *str)
+                                 : avs_simple_snprintf(escaped, sizeof(escaped),
+                                                       "\\u%04x",
+                                                       (unsigned) *str);
+            if (result < 0) {
+                AVS_UNREACHABLE();
+            }
+            if ((str > chunk && writer(arg, chunk, (size_t) (str - chunk)))
+                    || write_str(writer, arg, escaped)) {
+                return -1;
+            }
+            chunk = str + 1;
+        }
+    }
+    if ((str > chunk && writer(arg, chunk, (size_t) (str - chunk)))
+            || writer(arg, "\"", 1)) {
+        return -1;
+    }
+    return 0;
+}
+
+static int write_event(avs_trace_writer_t *writer,
+                       void *arg,
+                       unsigned tid,
+                       const trace_event_t *event,
+                       bool first) {
+    // Chrome trace timestamps are in microseconds
+    char buf[sizeof(",\"ph\":\"X\",\"ts\":.000,\"pid\":1,\"tid\":}")
+             + AVS_INT_STR_BUF_SIZE(int64_t) + AVS_UINT_STR_BUF_SIZE(unsigned)];
+    if (avs_simple_snprintf(buf, sizeof(buf),
+                            ",\"ph\":\"%c\",\"ts\":%s.%03u,\"pid\":1,"
+                            "\"tid\":%u}",
+                            event->phase,
+                            AVS_INT64_AS_STRING(event->timestamp_ns / 1000),
+                            (unsigned) (event->timestamp_ns % 1000), tid)
+            < 0) {
+        AVS_UNREACHABLE();
+    }
+    if (write_str(writer, arg, first ? "{\"name\":" : ",{\"name\":")
+            || write_json_string(writer, arg,
+                                 event->name ? event->name : "(null)")
+            || write_str(writer, arg, ",\"cat\":")
+            || write_json_string(writer, arg,
+                                 event->category ? event->category : "(null)")
+            || write_str(writer, arg, buf)) {
+        return -1;
+    }
+    return 0;
+}
+
+int avs_trace_export_chrome_json(avs_trace_writer_t *writer, void *arg) {
+    size_t capacity = g_capacity;
+    if (!capacity) {
+        return -1;
+    }
+    if (write_str(writer, arg, "{\"traceEvents\":[")) {
+        return -1;
+    }
+    bool first = true;
+    for (const trace_ring_t *ring = g_rings; ring; ring = ring->next) {
+        size_t head = ring->head;
+        size_t index = (head > capacity ? head - capacity : 0);
+        for (; index < head; ++index) {
+            if (write_event(writer, arg, ring->tid,
+                            &ring->events[index & (capacity - 1)], first)) {
+                return -1;
+            }
+            first = false;
+        }
+    }
+    return write_str(writer, arg, "],\"displayTimeUnit\":\"ns\"}\n") ? -1 : 0;
+}
+
+#    ifdef AVS_UNIT_TESTING
+#        include "tests/utils/trace.c"
+#    endif // AVS_UNIT_TESTING
+
+#endif // defined(AVS_COMMONS_WITH_AVS_UTILS) &&
+       // defined(AVS_COMMONS_UTILS_WITH_TRACE)
@@ -22,24 +22,81 @@
 
 #    include <avsystem/commons/avs_memory.h>
 
+#    include <stdint.h>
 #    include <stdlib.h>
+#    include <string.h>
 
 VISIBILITY_SOURCE_BEGIN
 
+#    ifdef AVS_COMMONS_UTILS_WITH_STANDARD_ALLOCATOR_HOOKS
+static avs_memory_hooks_t g_hooks;
+
+void avs_memory_set_hooks(const avs_memory_hooks_t *hooks) {
+    if (hooks) {
+        g_hooks = *hooks;
+    } else {
+        memset(&g_hooks, 0, sizeof(g_hooks));
+    }
+}
+
+static bool allow_allocation(size_t size) {
+    return !g_hooks.allow_allocation || g_hooks.allow_allocation(size);
+}
+
+static void *allocated(void *old_ptr, void *new_ptr, size_t size) {
+    if (new_ptr && g_hooks.allocated) {
+        g_hooks.allocated(old_ptr, new_ptr, size);
+    }
+    return new_ptr;
+}
+
+static void freed(void *ptr) {
+    if (ptr && g_hooks.freed) {
+        g_hooks.freed(ptr);
+    }
+}
+#    else // AVS_COMMONS_UTILS_WITH_STANDARD_ALLOCATOR_HOOKS
+#        define allow_allocation(Size) ((void) (Size), true)
+#        define allocated(OldPtr, NewPtr, Size) \
+            ((void) (OldPtr), (void) (Size), (NewPtr))
+#        define freed(Ptr) ((void) 0)
+#    endif // AVS_COMMONS_UTILS_WITH_STANDARD_ALLOCATOR_HOOKS
+
 void *avs_malloc(size_t size) {
-    return malloc(size);
+    if (!allow_allocation(size)) {
+        return NULL;
+    }
+    return allocated(NULL, malloc(size), size);
 }
 
 void avs_free(void *ptr) {
+    freed(ptr);
     free(ptr);
 }
 
 void *avs_calloc(size_t nmemb, size_t size) {
-    return calloc(nmemb, size);
+    // calloc() would fail anyway, but the hooks shall not see a wrapped size
+    if (size && nmemb > SIZE_MAX / size) {
+        return NULL;
+    }
+    if (!allow_allocation(nmemb * size)) {
+        return NULL;
+    }
+    return allocated(NULL, calloc(nmemb, size), nmemb * size);
 }
 
 void *avs_realloc(void *ptr, size_t size) {
-    return realloc(ptr, size);
+    if (ptr && !size) {
+        freed(ptr);
+        return allocated(NULL, realloc(ptr, size), size);
+    }
+    if (!allow_allocation(size)) {
+        return NULL;
+    }
+    // the old address is only passed to the hooks as a lookup key
+    uintptr_t old_addr = (uintptr_t) ptr;
+    void *new_ptr = realloc(ptr, size);
+    return allocated((void *) old_addr, new_ptr, size);
 }
 
 #endif // defined(AVS_COMMONS_WITH_AVS_UTILS) &&
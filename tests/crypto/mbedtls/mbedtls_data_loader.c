@@ -24,6 +24,11 @@
 
 #include <sys/stat.h>
 
+#if defined(AVS_COMMONS_WITH_MBEDTLS_LAZY_CA_PATH) \
+        && defined(AVS_COMMONS_COMPAT_THREADING_WITH_PTHREAD)
+#    include <pthread.h>
+#endif
+
 #include "../pki.h"
 
 #include "src/crypto/mbedtls/avs_mbedtls_data_loader.h"
@@ -235,3 +240,139 @@ AVS_UNIT_TEST(backend_mbedtls, key_loading_from_null) {
     AVS_UNIT_ASSERT_FAILED(_avs_crypto_mbedtls_load_private_key(&pk, NULL));
     _avs_crypto_mbedtls_pk_context_cleanup(&pk);
 }
+
+#ifdef AVS_COMMONS_WITH_MBEDTLS_LAZY_CA_PATH
+AVS_UNIT_TEST(backend_mbedtls, lazy_trust_store_from_path) {
+    mbedtls_x509_crt *certs = NULL;
+    avs_crypto_mbedtls_lazy_ca_t *lazy_ca = NULL;
+    const avs_crypto_certificate_chain_info_t path =
+            avs_crypto_certificate_chain_info_from_path("../certs");
+    AVS_UNIT_ASSERT_SUCCESS(
+            _avs_crypto_mbedtls_load_trust_store(&certs, &lazy_ca, &path));
+    AVS_UNIT_ASSERT_NOT_NULL(lazy_ca);
+    // nothing has been parsed upfront
+    AVS_UNIT_ASSERT_EQUAL(certs->version, 0);
+
+    mbedtls_x509_crt *client = NULL;
+    const avs_crypto_certificate_chain_info_t client_info =
+            avs_crypto_certificate_chain_info_from_file("../certs/client.crt");
+    AVS_UNIT_ASSERT_SUCCESS(_avs_crypto_mbedtls_load_certs(&client,
+                                                           &client_info));
+
+    mbedtls_x509_crt *candidates = NULL;
+    AVS_UNIT_ASSERT_SUCCESS(_avs_crypto_mbedtls_lazy_ca_find_issuers(
+            lazy_ca, client, &candidates));
+    AVS_UNIT_ASSERT_NOT_NULL(candidates);
+    // the root certificate is present in multiple files, but is returned once
+    AVS_UNIT_ASSERT_NULL(candidates->next);
+    AVS_UNIT_ASSERT_EQUAL(candidates->subject_raw.len,
+                          client->issuer_raw.len);
+    AVS_UNIT_ASSERT_EQUAL_BYTES_SIZED(candidates->subject_raw.p,
+                                      client->issuer_raw.p,
+                                      client->issuer_raw.len);
+    _avs_crypto_mbedtls_x509_crt_cleanup(&candidates);
+
+    uint32_t flags = 0;
+    AVS_UNIT_ASSERT_SUCCESS(mbedtls_x509_crt_verify_with_ca_cb(
+            client, _avs_crypto_mbedtls_lazy_ca_find_issuers, lazy_ca,
+            &mbedtls_x509_crt_profile_default, NULL, &flags, NULL, NULL));
+    AVS_UNIT_ASSERT_EQUAL(flags, 0);
+
+    _avs_crypto_mbedtls_x509_crt_cleanup(&client);
+    _avs_crypto_mbedtls_lazy_ca_cleanup(&lazy_ca);
+    _avs_crypto_mbedtls_x509_crt_cleanup(&certs);
+}
+
+AVS_UNIT_TEST(backend_mbedtls, lazy_trust_store_mixed_sources) {
+    const avs_crypto_certificate_chain_info_t sources[] = {
+        avs_crypto_certificate_chain_info_from_file("../certs/root.crt"),
+        avs_crypto_certificate_chain_info_from_path("../certs")
+    };
+    const avs_crypto_certificate_chain_info_t info =
+            avs_crypto_certificate_chain_info_from_array(
+                    sources, AVS_ARRAY_SIZE(sources));
+    mbedtls_x509_crt *certs = NULL;
+    avs_crypto_mbedtls_lazy_ca_t *lazy_ca = NULL;
+    AVS_UNIT_ASSERT_SUCCESS(
+            _avs_crypto_mbedtls_load_trust_store(&certs, &lazy_ca, &info));
+    AVS_UNIT_ASSERT_NOT_NULL(lazy_ca);
+    AVS_UNIT_ASSERT_NOT_EQUAL(certs->version, 0);
+
+    // certificates from both sources are deduplicated
+    mbedtls_x509_crt *candidates = NULL;
+    AVS_UNIT_ASSERT_SUCCESS(_avs_crypto_mbedtls_lazy_ca_find_issuers(
+            lazy_ca, certs, &candidates));
+    AVS_UNIT_ASSERT_NOT_NULL(candidates);
+    AVS_UNIT_ASSERT_NULL(candidates->next);
+    _avs_crypto_mbedtls_x509_crt_cleanup(&candidates);
+
+    _avs_crypto_mbedtls_lazy_ca_cleanup(&lazy_ca);
+    _avs_crypto_mbedtls_x509_crt_cleanup(&certs);
+
+    // nonexistent directory
+    const avs_crypto_certificate_chain_info_t nonexistent =
+            avs_crypto_certificate_chain_info_from_path("../certs/nonexistent");
+    AVS_UNIT_ASSERT_FAILED(_avs_crypto_mbedtls_load_trust_store(
+            &certs, &lazy_ca, &nonexistent));
+    AVS_UNIT_ASSERT_NULL(certs);
+    AVS_UNIT_ASSERT_NULL(lazy_ca);
+}
+
+#    ifdef AVS_COMMONS_COMPAT_THREADING_WITH_PTHREAD
+typedef struct {
+    const mbedtls_x509_crt *client;
+    size_t iterations;
+    size_t issuers_found;
+} lazy_ca_thread_args_t;
+
+static void *lazy_ca_thread_func(void *args_) {
+    lazy_ca_thread_args_t *args = (lazy_ca_thread_args_t *) args_;
+    for (size_t i = 0; i < args->iterations; ++i) {
+        // every iteration creates a new trust store, so that the directory
+        // index is concurrently scanned, shared and released
+        mbedtls_x509_crt *certs = NULL;
+        avs_crypto_mbedtls_lazy_ca_t *lazy_ca = NULL;
+        const avs_crypto_certificate_chain_info_t path =
+                avs_crypto_certificate_chain_info_from_path("../certs");
+        if (avs_is_err(_avs_crypto_mbedtls_load_trust_store(&certs, &lazy_ca,
+                                                            &path))) {
+            break;
+        }
+        mbedtls_x509_crt *candidates = NULL;
+        if (!_avs_crypto_mbedtls_lazy_ca_find_issuers(lazy_ca, args->client,
+                                                      &candidates)
+                && candidates && !candidates->next) {
+            ++args->issuers_found;
+        }
+        _avs_crypto_mbedtls_x509_crt_cleanup(&candidates);
+        _avs_crypto_mbedtls_lazy_ca_cleanup(&lazy_ca);
+        _avs_crypto_mbedtls_x509_crt_cleanup(&certs);
+    }
+    return NULL;
+}
+
+AVS_UNIT_TEST(backend_mbedtls, lazy_trust_store_concurrent_access) {
+    mbedtls_x509_crt *client = NULL;
+    const avs_crypto_certificate_chain_info_t client_info =
+            avs_crypto_certificate_chain_info_from_file("../certs/client.crt");
+    AVS_UNIT_ASSERT_SUCCESS(_avs_crypto_mbedtls_load_certs(&client,
+                                                           &client_info));
+
+    pthread_t threads[4];
+    lazy_ca_thread_args_t args[AVS_ARRAY_SIZE(threads)];
+    for (size_t i = 0; i < AVS_ARRAY_SIZE(threads); ++i) {
+        args[i] = (lazy_ca_thread_args_t) {
+            .client = client,
+            .iterations = 50
+        };
+        AVS_UNIT_ASSERT_SUCCESS(pthread_create(&threads[i], NULL,
+                                               lazy_ca_thread_func, &args[i]));
+    }
+    for (size_t i = 0; i < AVS_ARRAY_SIZE(threads); ++i) {
+        AVS_UNIT_ASSERT_SUCCESS(pthread_join(threads[i], NULL));
+        AVS_UNIT_ASSERT_EQUAL(args[i].issuers_found, args[i].iterations);
+    }
+    _avs_crypto_mbedtls_x509_crt_cleanup(&client);
+}
+#    endif // AVS_COMMONS_COMPAT_THREADING_WITH_PTHREAD
+#endif     // AVS_COMMONS_WITH_MBEDTLS_LAZY_CA_PATH
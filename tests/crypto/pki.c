@@ -17,6 +17,7 @@
 #include <avs_commons_init.h>
 
 #include <inttypes.h>
+#include <string.h>
 
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -24,6 +25,8 @@
 
 #include <avsystem/commons/avs_base64.h>
 #include <avsystem/commons/avs_crypto_pki.h>
+#include <avsystem/commons/avs_memory.h>
+#include <avsystem/commons/avs_stream_inbuf.h>
 #include <avsystem/commons/avs_stream_membuf.h>
 #include <avsystem/commons/avs_unit_test.h>
 #include <avsystem/commons/avs_utils.h>
@@ -236,3 +239,128 @@ AVS_UNIT_TEST(avs_crypto_pki_pkcs7, pkcs7_parse_failure) {
             &certs, &crls, EXAMPLE_INCORRECT_PKCS7_DATA,
             sizeof(EXAMPLE_INCORRECT_PKCS7_DATA) - 2));
 }
+
+typedef struct {
+    AVS_LIST(avs_crypto_security_info_union_t) expected;
+    size_t calls;
+    size_t fail_at_call;
+} pkcs7_stream_test_ctx_t;
+
+static avs_error_t pkcs7_stream_test_handler(avs_crypto_security_info_tag_t type,
+                                             const void *der,
+                                             size_t der_size,
+                                             void *ctx_) {
+    pkcs7_stream_test_ctx_t *ctx = (pkcs7_stream_test_ctx_t *) ctx_;
+    if (++ctx->calls == ctx->fail_at_call) {
+        return avs_errno(AVS_EINTR);
+    }
+    AVS_UNIT_ASSERT_NOT_NULL(ctx->expected);
+    AVS_UNIT_ASSERT_EQUAL(type, ctx->expected->type);
+    AVS_UNIT_ASSERT_EQUAL_BYTES_SIZED(der, ctx->expected->info.buffer.buffer,
+                                      ctx->expected->info.buffer.buffer_size);
+    AVS_UNIT_ASSERT_EQUAL(der_size, ctx->expected->info.buffer.buffer_size);
+    AVS_LIST_DELETE(&ctx->expected);
+    return AVS_OK;
+}
+
+static avs_error_t parse_pkcs7_stream(const void *data,
+                                      size_t data_size,
+                                      size_t buffer_size,
+                                      pkcs7_stream_test_ctx_t *ctx) {
+    avs_stream_inbuf_t stream = AVS_STREAM_INBUF_STATIC_INITIALIZER;
+    avs_stream_inbuf_set_buffer(&stream, data, data_size);
+    void *buffer = avs_malloc(buffer_size);
+    AVS_UNIT_ASSERT_NOT_NULL(buffer);
+    avs_error_t err = avs_crypto_parse_pkcs7_certs_only_stream(
+            (avs_stream_t *) &stream, buffer, buffer_size,
+            pkcs7_stream_test_handler, ctx);
+    avs_free(buffer);
+    return err;
+}
+
+static pkcs7_stream_test_ctx_t pkcs7_stream_test_ctx_init(void) {
+    AVS_LIST(avs_crypto_certificate_chain_info_t) certs = NULL;
+    AVS_LIST(avs_crypto_cert_revocation_list_info_t) crls = NULL;
+    AVS_UNIT_ASSERT_SUCCESS(avs_crypto_parse_pkcs7_certs_only(
+            &certs, &crls, EXAMPLE_CORRECT_PKCS7_DATA,
+            sizeof(EXAMPLE_CORRECT_PKCS7_DATA) - 1));
+    pkcs7_stream_test_ctx_t ctx = {
+        .expected = (AVS_LIST(avs_crypto_security_info_union_t)) certs
+    };
+    AVS_LIST_APPEND(&ctx.expected,
+                    (AVS_LIST(avs_crypto_security_info_union_t)) crls);
+    return ctx;
+}
+
+AVS_UNIT_TEST(avs_crypto_pki_pkcs7, pkcs7_stream_parse_success) {
+    pkcs7_stream_test_ctx_t ctx = pkcs7_stream_test_ctx_init();
+    // largest element in the example data is a 1997-byte certificate
+    AVS_UNIT_ASSERT_SUCCESS(
+            parse_pkcs7_stream(EXAMPLE_CORRECT_PKCS7_DATA,
+                               sizeof(EXAMPLE_CORRECT_PKCS7_DATA) - 1, 1997,
+                               &ctx));
+    AVS_UNIT_ASSERT_EQUAL(ctx.calls, 4);
+    AVS_UNIT_ASSERT_NULL(ctx.expected);
+}
+
+AVS_UNIT_TEST(avs_crypto_pki_pkcs7, pkcs7_stream_parse_buffer_too_small) {
+    pkcs7_stream_test_ctx_t ctx = pkcs7_stream_test_ctx_init();
+    avs_error_t err = parse_pkcs7_stream(EXAMPLE_CORRECT_PKCS7_DATA,
+                                         sizeof(EXAMPLE_CORRECT_PKCS7_DATA) - 1,
+                                         1996, &ctx);
+    AVS_UNIT_ASSERT_TRUE(err.category == AVS_ERRNO_CATEGORY
+                         && err.code == AVS_EMSGSIZE);
+    // first certificate fits in the buffer, the second one does not
+    AVS_UNIT_ASSERT_EQUAL(ctx.calls, 1);
+    AVS_LIST_CLEAR(&ctx.expected);
+}
+
+AVS_UNIT_TEST(avs_crypto_pki_pkcs7, pkcs7_stream_parse_buffer_below_minimum) {
+    pkcs7_stream_test_ctx_t ctx = pkcs7_stream_test_ctx_init();
+    // too small to hold the 9-byte content type OID, even though it holds an
+    // ASN.1 header on 32-bit platforms
+    avs_error_t err = parse_pkcs7_stream(EXAMPLE_CORRECT_PKCS7_DATA,
+                                         sizeof(EXAMPLE_CORRECT_PKCS7_DATA) - 1,
+                                         6, &ctx);
+    AVS_UNIT_ASSERT_TRUE(err.category == AVS_ERRNO_CATEGORY
+                         && err.code == AVS_EINVAL);
+    err = parse_pkcs7_stream(EXAMPLE_CORRECT_PKCS7_DATA,
+                             sizeof(EXAMPLE_CORRECT_PKCS7_DATA) - 1, 8, &ctx);
+    AVS_UNIT_ASSERT_TRUE(err.category == AVS_ERRNO_CATEGORY
+                         && err.code == AVS_EINVAL);
+    AVS_UNIT_ASSERT_EQUAL(ctx.calls, 0);
+    AVS_LIST_CLEAR(&ctx.expected);
+}
+
+AVS_UNIT_TEST(avs_crypto_pki_pkcs7, pkcs7_stream_parse_handler_error) {
+    pkcs7_stream_test_ctx_t ctx = pkcs7_stream_test_ctx_init();
+    ctx.fail_at_call = 3;
+    avs_error_t err = parse_pkcs7_stream(EXAMPLE_CORRECT_PKCS7_DATA,
+                                         sizeof(EXAMPLE_CORRECT_PKCS7_DATA) - 1,
+                                         4096, &ctx);
+    AVS_UNIT_ASSERT_TRUE(err.category == AVS_ERRNO_CATEGORY
+                         && err.code == AVS_EINTR);
+    AVS_UNIT_ASSERT_EQUAL(ctx.calls, 3);
+    AVS_LIST_CLEAR(&ctx.expected);
+}
+
+AVS_UNIT_TEST(avs_crypto_pki_pkcs7, pkcs7_stream_parse_failure) {
+    pkcs7_stream_test_ctx_t ctx = pkcs7_stream_test_ctx_init();
+    // truncated data
+    AVS_UNIT_ASSERT_FAILED(
+            parse_pkcs7_stream(EXAMPLE_CORRECT_PKCS7_DATA,
+                               sizeof(EXAMPLE_CORRECT_PKCS7_DATA) - 2, 4096,
+                               &ctx));
+    AVS_LIST_CLEAR(&ctx.expected);
+
+    memset(&ctx, 0, sizeof(ctx));
+    // superfluous byte at the end
+    AVS_UNIT_ASSERT_FAILED(parse_pkcs7_stream(
+            EXAMPLE_INCORRECT_PKCS7_DATA,
+            sizeof(EXAMPLE_INCORRECT_PKCS7_DATA) - 1, 4096, &ctx));
+    // encapsulated data and signerInfos
+    AVS_UNIT_ASSERT_FAILED(parse_pkcs7_stream(
+            EXAMPLE_INCORRECT_PKCS7_DATA,
+            sizeof(EXAMPLE_INCORRECT_PKCS7_DATA) - 2, 4096, &ctx));
+    AVS_UNIT_ASSERT_EQUAL(ctx.calls, 0);
+}
@@ -17,6 +17,7 @@
 #include <avs_commons_init.h>
 
 #include <ctype.h>
+#include <stdio.h>
 #include <string.h>
 
 #include <avsystem/commons/avs_errno.h>
@@ -169,6 +170,51 @@ AVS_UNIT_TEST(http, reconnect_fail) {
     avs_http_free(client);
 }
 
+#ifdef AVS_COMMONS_NET_WITH_UNIX_SOCKETS
+AVS_UNIT_TEST(http, unix_socket_path) {
+    const char *tmp_data = NULL;
+    avs_http_t *client = avs_http_new(&AVS_HTTP_DEFAULT_BUFFER_SIZES);
+    avs_net_socket_t *socket = NULL;
+    avs_stream_t *stream = NULL;
+    avs_url_t *url = avs_url_parse("http://www.avsystem.com/");
+    AVS_UNIT_ASSERT_NOT_NULL(url);
+    AVS_UNIT_ASSERT_NOT_NULL(client);
+    AVS_UNIT_ASSERT_SUCCESS(
+            avs_http_set_unix_socket_path(client, "/run/avs.sock"));
+    avs_unit_mocksock_create(&socket);
+    avs_http_test_expect_create_socket(socket, AVS_NET_TCP_SOCKET);
+    avs_unit_mocksock_expect_connect(socket, "/run/avs.sock", "80");
+    AVS_UNIT_ASSERT_SUCCESS(avs_http_open_stream(&stream, client, AVS_HTTP_GET,
+                                                 AVS_HTTP_CONTENT_IDENTITY, url,
+                                                 NULL, NULL));
+    avs_url_free(url);
+    AVS_UNIT_ASSERT_NOT_NULL(stream);
+    tmp_data = "GET / HTTP/1.1\r\n"
+               "Host: www.avsystem.com\r\n"
+#    ifdef AVS_COMMONS_HTTP_WITH_ZLIB
+               "Accept-Encoding: gzip, deflate\r\n"
+#    endif
+               "\r\n";
+    avs_unit_mocksock_expect_output(socket, tmp_data, strlen(tmp_data));
+    tmp_data = "HTTP/1.1 200 OK\r\n"
+               "Transfer-Encoding: identity\r\n"
+               "\r\n";
+    avs_unit_mocksock_input(socket, tmp_data, strlen(tmp_data));
+    AVS_UNIT_ASSERT_SUCCESS(avs_stream_finish_message(stream));
+    avs_unit_mocksock_assert_io_clean(socket);
+
+    /* reconnection also uses the Unix socket path */
+    avs_unit_mocksock_expect_mid_close(socket);
+    avs_unit_mocksock_expect_connect(socket, "/run/avs.sock", "80");
+    avs_unit_mocksock_fail_command(socket, avs_errno(AVS_ECONNREFUSED));
+    AVS_UNIT_ASSERT_FAILED(avs_stream_finish_message(stream));
+    avs_unit_mocksock_assert_io_clean(socket);
+    avs_unit_mocksock_expect_shutdown(socket);
+    AVS_UNIT_ASSERT_SUCCESS(avs_stream_cleanup(&stream));
+    avs_http_free(client);
+}
+#endif // AVS_COMMONS_NET_WITH_UNIX_SOCKETS
+
 AVS_UNIT_TEST(http, advanced_request) {
     const char *tmp_data;
     avs_http_t *client = avs_http_new(&AVS_HTTP_DEFAULT_BUFFER_SIZES);
@@ -711,6 +757,124 @@ AVS_UNIT_TEST(http, error_417) {
     avs_http_free(client);
 }
 
+AVS_UNIT_TEST(http, content_length_request) {
+    const char *tmp_data = NULL;
+    char headers[256];
+    avs_http_t *client = avs_http_new(&AVS_HTTP_DEFAULT_BUFFER_SIZES);
+    avs_net_socket_t *socket = NULL;
+    avs_stream_t *stream = NULL;
+    avs_url_t *url = avs_url_parse("http://monty.python/");
+    AVS_UNIT_ASSERT_NOT_NULL(url);
+    AVS_UNIT_ASSERT_NOT_NULL(client);
+    avs_unit_mocksock_create(&socket);
+    avs_http_test_expect_create_socket(socket, AVS_NET_TCP_SOCKET);
+    avs_unit_mocksock_expect_connect(socket, "monty.python", "80");
+    AVS_UNIT_ASSERT_SUCCESS(avs_http_open_stream(&stream, client, AVS_HTTP_POST,
+                                                 AVS_HTTP_CONTENT_IDENTITY, url,
+                                                 NULL, NULL));
+    avs_url_free(url);
+    AVS_UNIT_ASSERT_NOT_NULL(stream);
+    AVS_UNIT_ASSERT_SUCCESS(
+            avs_http_set_content_length(stream, strlen(MONTY_PYTHON_RAW)));
+    tmp_data = "POST / HTTP/1.1\r\n"
+               "Host: monty.python\r\n"
+#ifdef AVS_COMMONS_HTTP_WITH_ZLIB
+               "Accept-Encoding: gzip, deflate\r\n"
+#endif
+               "Expect: 100-continue\r\n";
+    AVS_UNIT_ASSERT_TRUE(snprintf(headers, sizeof(headers),
+                                  "%sContent-Length: %lu\r\n\r\n", tmp_data,
+                                  (unsigned long) strlen(MONTY_PYTHON_RAW))
+                         < (int) sizeof(headers));
+    avs_unit_mocksock_expect_output(socket, headers, strlen(headers));
+    tmp_data = "HTTP/1.1 100 Continue\r\n"
+               "\r\n";
+    avs_unit_mocksock_input(socket, tmp_data, strlen(tmp_data));
+    /* the content is sent as-is, without any chunked framing */
+    avs_unit_mocksock_expect_output(socket, MONTY_PYTHON_RAW,
+                                    strlen(MONTY_PYTHON_RAW));
+    tmp_data = "HTTP/1.1 200 OK\r\n"
+               "Transfer-Encoding: identity\r\n"
+               "\r\n";
+    avs_unit_mocksock_input(socket, tmp_data, strlen(tmp_data));
+    tmp_data = MONTY_PYTHON_RAW;
+    while (*tmp_data) {
+        send_line(stream, &tmp_data);
+    }
+    AVS_UNIT_ASSERT_SUCCESS(avs_stream_finish_message(stream));
+    avs_unit_mocksock_assert_io_clean(socket);
+    avs_unit_mocksock_expect_shutdown(socket);
+    AVS_UNIT_ASSERT_SUCCESS(avs_stream_cleanup(&stream));
+    avs_http_free(client);
+}
+
+AVS_UNIT_TEST(http, content_length_small_request) {
+    const char *tmp_data = NULL;
+    avs_http_t *client = avs_http_new(&AVS_HTTP_DEFAULT_BUFFER_SIZES);
+    avs_net_socket_t *socket = NULL;
+    avs_stream_t *stream = NULL;
+    avs_url_t *url = avs_url_parse("http://monty.python/");
+    AVS_UNIT_ASSERT_NOT_NULL(url);
+    AVS_UNIT_ASSERT_NOT_NULL(client);
+    avs_unit_mocksock_create(&socket);
+    avs_http_test_expect_create_socket(socket, AVS_NET_TCP_SOCKET);
+    avs_unit_mocksock_expect_connect(socket, "monty.python", "80");
+    AVS_UNIT_ASSERT_SUCCESS(avs_http_open_stream(&stream, client, AVS_HTTP_POST,
+                                                 AVS_HTTP_CONTENT_IDENTITY, url,
+                                                 NULL, NULL));
+    avs_url_free(url);
+    AVS_UNIT_ASSERT_NOT_NULL(stream);
+    AVS_UNIT_ASSERT_SUCCESS(avs_http_set_content_length(stream, 5));
+    /* content fits in the buffer, so no Expect: 100-continue is sent */
+    tmp_data = "POST / HTTP/1.1\r\n"
+               "Host: monty.python\r\n"
+#ifdef AVS_COMMONS_HTTP_WITH_ZLIB
+               "Accept-Encoding: gzip, deflate\r\n"
+#endif
+               "Content-Length: 5\r\n"
+               "\r\n"
+               "spam!";
+    avs_unit_mocksock_expect_output(socket, tmp_data, strlen(tmp_data));
+    tmp_data = "HTTP/1.1 200 OK\r\n"
+               "Content-Length: 0\r\n"
+               "\r\n";
+    avs_unit_mocksock_input(socket, tmp_data, strlen(tmp_data));
+    AVS_UNIT_ASSERT_SUCCESS(avs_stream_write(stream, "spam!", 5));
+    AVS_UNIT_ASSERT_SUCCESS(avs_stream_finish_message(stream));
+    avs_unit_mocksock_assert_io_clean(socket);
+    avs_unit_mocksock_expect_shutdown(socket);
+    AVS_UNIT_ASSERT_SUCCESS(avs_stream_cleanup(&stream));
+    avs_http_free(client);
+}
+
+AVS_UNIT_TEST(http, content_length_mismatch) {
+    avs_http_t *client = avs_http_new(&AVS_HTTP_DEFAULT_BUFFER_SIZES);
+    avs_net_socket_t *socket = NULL;
+    avs_stream_t *stream = NULL;
+    avs_url_t *url = avs_url_parse("http://monty.python/");
+    AVS_UNIT_ASSERT_NOT_NULL(url);
+    AVS_UNIT_ASSERT_NOT_NULL(client);
+    avs_unit_mocksock_create(&socket);
+    avs_http_test_expect_create_socket(socket, AVS_NET_TCP_SOCKET);
+    avs_unit_mocksock_expect_connect(socket, "monty.python", "80");
+    AVS_UNIT_ASSERT_SUCCESS(avs_http_open_stream(&stream, client, AVS_HTTP_POST,
+                                                 AVS_HTTP_CONTENT_IDENTITY, url,
+                                                 NULL, NULL));
+    avs_url_free(url);
+    AVS_UNIT_ASSERT_NOT_NULL(stream);
+    AVS_UNIT_ASSERT_SUCCESS(avs_http_set_content_length(stream, 10));
+    AVS_UNIT_ASSERT_SUCCESS(avs_stream_write(stream, "spam!", 5));
+    AVS_UNIT_ASSERT_FAILED(avs_stream_finish_message(stream));
+    /* nothing shall be sent */
+    avs_unit_mocksock_assert_io_clean(socket);
+    AVS_UNIT_ASSERT_FAILED(avs_http_set_content_length(stream, 5));
+    AVS_UNIT_ASSERT_SUCCESS(avs_stream_reset(stream));
+    AVS_UNIT_ASSERT_SUCCESS(avs_http_set_content_length(stream, 5));
+    avs_unit_mocksock_expect_shutdown(socket);
+    AVS_UNIT_ASSERT_SUCCESS(avs_stream_cleanup(&stream));
+    avs_http_free(client);
+}
+
 const char *const MONTY_PYTHON_BIG_REQUEST =
         "1E\r\n"
         "A customer enters a pet shop.\n"
@@ -1004,6 +1168,58 @@ AVS_UNIT_TEST(http, redirect) {
     avs_http_free(client);
 }
 
+AVS_UNIT_TEST(http, redirect_relative) {
+    const char *tmp_data = NULL;
+    avs_http_t *client = avs_http_new(&AVS_HTTP_DEFAULT_BUFFER_SIZES);
+    avs_net_socket_t *sockets[2];
+    avs_stream_t *stream = NULL;
+    avs_url_t *url = avs_url_parse("http://www.nyan.cat/a/b");
+    AVS_UNIT_ASSERT_NOT_NULL(client);
+    AVS_UNIT_ASSERT_NOT_NULL(url);
+    avs_unit_mocksock_create(&sockets[0]);
+    avs_unit_mocksock_create(&sockets[1]);
+    avs_http_test_expect_create_socket(sockets[0], AVS_NET_TCP_SOCKET);
+    avs_unit_mocksock_expect_connect(sockets[0], "www.nyan.cat", "80");
+    AVS_UNIT_ASSERT_SUCCESS(avs_http_open_stream(&stream, client, AVS_HTTP_GET,
+                                                 AVS_HTTP_CONTENT_IDENTITY, url,
+                                                 NULL, NULL));
+    avs_url_free(url);
+    AVS_UNIT_ASSERT_NOT_NULL(stream);
+    tmp_data = "GET /a/b HTTP/1.1\r\n"
+               "Host: www.nyan.cat\r\n"
+#ifdef AVS_COMMONS_HTTP_WITH_ZLIB
+               "Accept-Encoding: gzip, deflate\r\n"
+#endif
+               "\r\n";
+    avs_unit_mocksock_expect_output(sockets[0], tmp_data, strlen(tmp_data));
+    tmp_data = "HTTP/1.1 302 Found\r\n"
+               "Location: ../c/./d?e\r\n"
+               "Content-Length: 0\r\n"
+               "\r\n";
+    avs_unit_mocksock_input(sockets[0], tmp_data, strlen(tmp_data));
+
+    avs_http_test_expect_create_socket(sockets[1], AVS_NET_TCP_SOCKET);
+    avs_unit_mocksock_expect_connect(sockets[1], "www.nyan.cat", "80");
+    tmp_data = "GET /c/d?e HTTP/1.1\r\n"
+               "Host: www.nyan.cat\r\n"
+#ifdef AVS_COMMONS_HTTP_WITH_ZLIB
+               "Accept-Encoding: gzip, deflate\r\n"
+#endif
+               "\r\n";
+    avs_unit_mocksock_expect_output(sockets[1], tmp_data, strlen(tmp_data));
+    tmp_data = "HTTP/1.1 200 OK\r\n"
+               "Content-Length: 0\r\n"
+               "\r\n";
+    avs_unit_mocksock_input(sockets[1], tmp_data, strlen(tmp_data));
+
+    AVS_UNIT_ASSERT_SUCCESS(avs_stream_finish_message(stream));
+    AVS_UNIT_ASSERT_EQUAL(avs_http_status_code(stream), 200);
+    avs_unit_mocksock_assert_io_clean(sockets[1]);
+    avs_unit_mocksock_expect_shutdown(sockets[1]);
+    AVS_UNIT_ASSERT_SUCCESS(avs_stream_cleanup(&stream));
+    avs_http_free(client);
+}
+
 AVS_UNIT_TEST(http, interleaving) {
     const char *tmp_data = NULL;
     char buffer[64];
@@ -0,0 +1,597 @@
+/*
+ * Copyright 2021 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <avsystem/commons/avs_unit_test.h>
+
+typedef struct {
+    avs_sched_t *sched;
+    avs_http_server_t *server;
+    avs_net_socket_t *client;
+} server_env_t;
+
+static avs_error_t hello_handler(avs_http_server_request_t *request,
+                                 void *arg) {
+    (void) arg;
+    return avs_http_server_respond(request, 200, "text/plain", "Hello", 5);
+}
+
+static avs_error_t echo_handler(avs_http_server_request_t *request,
+                                void *arg) {
+    (void) arg;
+    avs_error_t err =
+            avs_http_server_respond_begin(request, 200, "text/plain");
+    bool message_finished = false;
+    while (avs_is_ok(err) && !message_finished) {
+        char buf[16];
+        size_t bytes_read;
+        if (avs_is_ok((err = avs_stream_read(
+                               avs_http_server_request_body(request),
+                               &bytes_read, &message_finished, buf,
+                               sizeof(buf))))) {
+            err = avs_http_server_respond_write(request, buf, bytes_read);
+        }
+    }
+    return err;
+}
+
+static avs_error_t info_handler(avs_http_server_request_t *request,
+                                void *arg) {
+    char buf[256];
+    const char *query = avs_http_server_request_query(request);
+    const char *user_agent =
+            avs_http_server_request_header(request, "user-agent");
+    int result = avs_simple_snprintf(buf, sizeof(buf), "%s %s %s %s %s",
+                                     (const char *) arg,
+                                     avs_http_server_request_method(request),
+                                     avs_http_server_request_path(request),
+                                     query ? query : "-",
+                                     user_agent ? user_agent : "-");
+    AVS_UNIT_ASSERT_TRUE(result >= 0);
+    AVS_UNIT_ASSERT_SUCCESS(
+            avs_http_server_add_header(request, "X-Test", "yes"));
+    return avs_http_server_respond(request, 200, NULL, buf, (size_t) result);
+}
+
+static avs_error_t silent_handler(avs_http_server_request_t *request,
+                                  void *arg) {
+    (void) request;
+    (void) arg;
+    return AVS_OK;
+}
+
+static avs_error_t body_netbuf_handler(avs_http_server_request_t *request,
+                                       void *arg) {
+    (void) arg;
+    const char *body = request->body_netbuf ? "yes" : "no";
+    return avs_http_server_respond(request, 200, NULL, body, strlen(body));
+}
+
+static avs_net_socket_t *connect_client(avs_http_server_t *server) {
+    char port[sizeof("65535")];
+    AVS_UNIT_ASSERT_SUCCESS(
+            avs_http_server_get_local_port(server, port, sizeof(port)));
+    avs_net_socket_t *client = NULL;
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_tcp_socket_create(&client, NULL));
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_connect(client, "127.0.0.1", port));
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_set_opt(
+            client, AVS_NET_SOCKET_OPT_RECV_TIMEOUT,
+            (avs_net_socket_opt_value_t) {
+                .recv_timeout = avs_time_duration_from_scalar(10, AVS_TIME_MS)
+            }));
+    return client;
+}
+
+static server_env_t setup_server(const avs_http_server_config_t *config) {
+    server_env_t env = {
+        .sched = avs_sched_new("http_server_test", NULL)
+    };
+    AVS_UNIT_ASSERT_NOT_NULL(env.sched);
+    avs_http_server_config_t default_config = {
+        .address = "127.0.0.1"
+    };
+    AVS_UNIT_ASSERT_NOT_NULL((env.server = avs_http_server_new(
+                                      env.sched,
+                                      config ? config : &default_config)));
+    AVS_UNIT_ASSERT_SUCCESS(avs_http_server_add_route(
+            env.server, "GET", "/hello", hello_handler, NULL));
+    AVS_UNIT_ASSERT_SUCCESS(avs_http_server_add_route(
+            env.server, "POST", "/echo", echo_handler, NULL));
+    AVS_UNIT_ASSERT_SUCCESS(avs_http_server_add_route(
+            env.server, NULL, "/info/", info_handler, (void *) "prefix"));
+    AVS_UNIT_ASSERT_SUCCESS(avs_http_server_add_route(
+            env.server, "GET", "/info/exact", info_handler, (void *) "exact"));
+    AVS_UNIT_ASSERT_SUCCESS(avs_http_server_add_route(
+            env.server, "GET", "/silent", silent_handler, NULL));
+    AVS_UNIT_ASSERT_SUCCESS(avs_http_server_add_route(
+            env.server, NULL, "/netbuf", body_netbuf_handler, NULL));
+
+    env.client = connect_client(env.server);
+    return env;
+}
+
+static void teardown_server(server_env_t *env) {
+    avs_net_socket_cleanup(&env->client);
+    avs_http_server_cleanup(&env->server);
+    AVS_UNIT_ASSERT_NULL(env->server);
+    avs_sched_cleanup(&env->sched);
+}
+
+static void pump(server_env_t *env) {
+    AVS_UNIT_ASSERT_SUCCESS(avs_http_server_wait(
+            env->server, avs_time_duration_from_scalar(10, AVS_TIME_MS)));
+    avs_sched_run(env->sched);
+}
+
+static void send_request(server_env_t *env, const char *request) {
+    AVS_UNIT_ASSERT_SUCCESS(
+            avs_net_socket_send(env->client, request, strlen(request)));
+}
+
+/**
+ * Drives the server until @p expected_size bytes of response are received, or
+ * the connection is closed.
+ */
+static size_t receive_response(server_env_t *env,
+                               char *buf,
+                               size_t expected_size,
+                               bool *out_closed) {
+    size_t received = 0;
+    *out_closed = false;
+    for (int i = 0; i < 100 && received < expected_size && !*out_closed; ++i) {
+        pump(env);
+        size_t bytes_received;
+        avs_error_t err = avs_net_socket_receive(env->client, &bytes_received,
+                                                 buf + received,
+                                                 expected_size - received);
+        if (avs_is_ok(err)) {
+            if (!bytes_received) {
+                *out_closed = true;
+            }
+            received += bytes_received;
+        } else {
+            AVS_UNIT_ASSERT_TRUE(err.category == AVS_ERRNO_CATEGORY
+                                 && err.code == AVS_ETIMEDOUT);
+        }
+    }
+    buf[received] = '\0';
+    return received;
+}
+
+static void expect_response(server_env_t *env, const char *expected) {
+    char buf[1024];
+    size_t expected_size = strlen(expected);
+    AVS_UNIT_ASSERT_TRUE(expected_size < sizeof(buf));
+    bool closed;
+    receive_response(env, buf, expected_size, &closed);
+    AVS_UNIT_ASSERT_EQUAL_STRING(buf, expected);
+}
+
+static void expect_closed(server_env_t *env) {
+    char buf[16];
+    bool closed;
+    AVS_UNIT_ASSERT_EQUAL(receive_response(env, buf, sizeof(buf) - 1, &closed),
+                          0);
+    AVS_UNIT_ASSERT_TRUE(closed);
+}
+
+AVS_UNIT_TEST(http_server, get_keep_alive) {
+    server_env_t env = setup_server(NULL);
+    for (int i = 0; i < 3; ++i) {
+        send_request(&env, "GET /hello HTTP/1.1\r\n"
+                           "Host: localhost\r\n"
+                           "\r\n");
+        expect_response(&env, "HTTP/1.1 200 OK\r\n"
+                              "Content-Type: text/plain\r\n"
+                              "Content-Length: 5\r\n"
+                              "\r\n"
+                              "Hello");
+    }
+    send_request(&env, "HEAD /hello HTTP/1.1\r\n"
+                       "Connection: close\r\n"
+                       "\r\n");
+    expect_response(&env, "HTTP/1.1 200 OK\r\n"
+                          "Content-Type: text/plain\r\n"
+                          "Content-Length: 5\r\n"
+                          "Connection: close\r\n"
+                          "\r\n");
+    expect_closed(&env);
+    teardown_server(&env);
+}
+
+AVS_UNIT_TEST(http_server, http_1_0) {
+    server_env_t env = setup_server(NULL);
+    send_request(&env, "GET /hello HTTP/1.0\r\n"
+                       "Connection: keep-alive\r\n"
+                       "\r\n");
+    expect_response(&env, "HTTP/1.1 200 OK\r\n"
+                          "Content-Type: text/plain\r\n"
+                          "Content-Length: 5\r\n"
+                          "Connection: keep-alive\r\n"
+                          "\r\n"
+                          "Hello");
+    send_request(&env, "POST /echo HTTP/1.0\r\n"
+                       "Content-Length: 4\r\n"
+                       "\r\n"
+                       "test");
+    expect_response(&env, "HTTP/1.1 200 OK\r\n"
+                          "Content-Type: text/plain\r\n"
+                          "Connection: close\r\n"
+                          "\r\n"
+                          "test");
+    expect_closed(&env);
+    teardown_server(&env);
+}
+
+AVS_UNIT_TEST(http_server, not_found_and_method_not_allowed) {
+    server_env_t env = setup_server(NULL);
+    send_request(&env, "GET /nothing HTTP/1.1\r\n\r\n");
+    expect_response(&env, "HTTP/1.1 404 Not Found\r\n"
+                          "Content-Length: 0\r\n"
+                          "\r\n");
+    send_request(&env, "DELETE /hello HTTP/1.1\r\n\r\n");
+    expect_response(&env, "HTTP/1.1 405 Method Not Allowed\r\n"
+                          "Content-Length: 0\r\n"
+                          "Allow: GET\r\n"
+                          "\r\n");
+    send_request(&env, "GET /silent HTTP/1.1\r\n\r\n");
+    expect_response(&env, "HTTP/1.1 500 Internal Server Error\r\n"
+                          "Content-Length: 0\r\n"
+                          "\r\n");
+    teardown_server(&env);
+}
+
+AVS_UNIT_TEST(http_server, routing_and_headers) {
+    server_env_t env = setup_server(NULL);
+    send_request(&env, "PUT /info/some/thing?a=b HTTP/1.1\r\n"
+                       "USER-AGENT:   test agent  \r\n"
+                       "\r\n");
+    expect_response(&env, "HTTP/1.1 200 OK\r\n"
+                          "Content-Length: 42\r\n"
+                          "X-Test: yes\r\n"
+                          "\r\n"
+                          "prefix PUT /info/some/thing a=b test agent");
+    send_request(&env, "GET /info/exact HTTP/1.1\r\n\r\n");
+    expect_response(&env, "HTTP/1.1 200 OK\r\n"
+                          "Content-Length: 25\r\n"
+                          "X-Test: yes\r\n"
+                          "\r\n"
+                          "exact GET /info/exact - -");
+    teardown_server(&env);
+}
+
+AVS_UNIT_TEST(http_server, chunked_echo) {
+    server_env_t env = setup_server(NULL);
+    send_request(&env, "POST /echo HTTP/1.1\r\n"
+                       "Transfer-Encoding: chunked\r\n"
+                       "\r\n"
+                       "5\r\nHello\r\n"
+                       "7\r\n, world\r\n"
+                       "0\r\n\r\n");
+    expect_response(&env, "HTTP/1.1 200 OK\r\n"
+                          "Content-Type: text/plain\r\n"
+                          "Transfer-Encoding: chunked\r\n"
+                          "\r\n"
+                          "5\r\nHello\r\n"
+                          "7\r\n, world\r\n"
+                          "0\r\n\r\n");
+    teardown_server(&env);
+}
+
+AVS_UNIT_TEST(http_server, expect_continue) {
+    server_env_t env = setup_server(NULL);
+    send_request(&env, "POST /echo HTTP/1.1\r\n"
+                       "Content-Length: 2\r\n"
+                       "Expect: 100-continue\r\n"
+                       "\r\n"
+                       "ok");
+    expect_response(&env, "HTTP/1.1 100 Continue\r\n"
+                          "\r\n"
+                          "HTTP/1.1 200 OK\r\n"
+                          "Content-Type: text/plain\r\n"
+                          "Transfer-Encoding: chunked\r\n"
+                          "\r\n"
+                          "2\r\nok\r\n"
+                          "0\r\n\r\n");
+    teardown_server(&env);
+}
+
+AVS_UNIT_TEST(http_server, pipelining_with_unread_body) {
+    server_env_t env = setup_server(NULL);
+    send_request(&env, "POST /hello HTTP/1.1\r\n"
+                       "Content-Length: 3\r\n"
+                       "\r\n"
+                       "abc"
+                       "GET /hello HTTP/1.1\r\n"
+                       "Content-Length: 3\r\n"
+                       "\r\n"
+                       "def"
+                       "GET /hello HTTP/1.1\r\n"
+                       "\r\n");
+    expect_response(&env, "HTTP/1.1 405 Method Not Allowed\r\n"
+                          "Content-Length: 0\r\n"
+                          "Allow: GET\r\n"
+                          "\r\n"
+                          "HTTP/1.1 200 OK\r\n"
+                          "Content-Type: text/plain\r\n"
+                          "Content-Length: 5\r\n"
+                          "\r\n"
+                          "Hello"
+                          "HTTP/1.1 200 OK\r\n"
+                          "Content-Type: text/plain\r\n"
+                          "Content-Length: 5\r\n"
+                          "\r\n"
+                          "Hello");
+    teardown_server(&env);
+}
+
+AVS_UNIT_TEST(http_server, malformed_requests) {
+    server_env_t env = setup_server(NULL);
+    send_request(&env, "GET /hello\r\n\r\n");
+    expect_response(&env, "HTTP/1.1 400 Bad Request\r\n"
+                          "Content-Length: 0\r\n"
+                          "Connection: close\r\n"
+                          "\r\n");
+    expect_closed(&env);
+    teardown_server(&env);
+
+    env = setup_server(NULL);
+    send_request(&env, "POST /echo HTTP/1.1\r\n"
+                       "Transfer-Encoding: gzip\r\n"
+                       "\r\n");
+    expect_response(&env, "HTTP/1.1 501 Not Implemented\r\n"
+                          "Content-Length: 0\r\n"
+                          "Connection: close\r\n"
+                          "\r\n");
+    expect_closed(&env);
+    teardown_server(&env);
+}
+
+AVS_UNIT_TEST(http_server, repeated_content_length) {
+    server_env_t env = setup_server(NULL);
+    send_request(&env, "POST /netbuf HTTP/1.1\r\n"
+                       "Content-Length: 3\r\n"
+                       "Content-Length: 3\r\n"
+                       "\r\n"
+                       "abc");
+    expect_response(&env, "HTTP/1.1 200 OK\r\n"
+                          "Content-Length: 3\r\n"
+                          "\r\n"
+                          "yes");
+    send_request(&env, "POST /netbuf HTTP/1.1\r\n"
+                       "Content-Length: 3\r\n"
+                       "Content-Length: 4\r\n"
+                       "\r\n"
+                       "abcd");
+    expect_response(&env, "HTTP/1.1 400 Bad Request\r\n"
+                          "Content-Length: 0\r\n"
+                          "Connection: close\r\n"
+                          "\r\n");
+    expect_closed(&env);
+    teardown_server(&env);
+}
+
+AVS_UNIT_TEST(http_server, no_body_netbuf_without_body) {
+    server_env_t env = setup_server(NULL);
+    send_request(&env, "GET /netbuf HTTP/1.1\r\n"
+                       "\r\n"
+                       "POST /netbuf HTTP/1.1\r\n"
+                       "Content-Length: 0\r\n"
+                       "\r\n"
+                       "POST /netbuf HTTP/1.1\r\n"
+                       "Content-Length: 1\r\n"
+                       "\r\n"
+                       "x"
+                       "GET /hello HTTP/1.1\r\n"
+                       "\r\n");
+    expect_response(&env, "HTTP/1.1 200 OK\r\n"
+                          "Content-Length: 2\r\n"
+                          "\r\n"
+                          "no"
+                          "HTTP/1.1 200 OK\r\n"
+                          "Content-Length: 2\r\n"
+                          "\r\n"
+                          "no"
+                          "HTTP/1.1 200 OK\r\n"
+                          "Content-Length: 3\r\n"
+                          "\r\n"
+                          "yes"
+                          "HTTP/1.1 200 OK\r\n"
+                          "Content-Type: text/plain\r\n"
+                          "Content-Length: 5\r\n"
+                          "\r\n"
+                          "Hello");
+    teardown_server(&env);
+}
+
+AVS_UNIT_TEST(http_server, header_too_large) {
+    server_env_t env = setup_server(&(const avs_http_server_config_t) {
+        .address = "127.0.0.1",
+        .max_header_size = 64
+    });
+    send_request(&env, "GET /hello HTTP/1.1\r\n"
+                       "X-Padding: 0123456789012345678901234567890123456789\r\n"
+                       "\r\n");
+    expect_response(&env, "HTTP/1.1 431 Request Header Fields Too Large\r\n"
+                          "Content-Length: 0\r\n"
+                          "Connection: close\r\n"
+                          "\r\n");
+    expect_closed(&env);
+    teardown_server(&env);
+}
+
+AVS_UNIT_TEST(http_server, idle_timeout) {
+    server_env_t env = setup_server(&(const avs_http_server_config_t) {
+        .address = "127.0.0.1",
+        .idle_timeout = avs_time_duration_from_scalar(50, AVS_TIME_MS)
+    });
+    send_request(&env, "GET /hello HTTP/1.1\r\n\r\n");
+    expect_response(&env, "HTTP/1.1 200 OK\r\n"
+                          "Content-Type: text/plain\r\n"
+                          "Content-Length: 5\r\n"
+                          "\r\n"
+                          "Hello");
+    expect_closed(&env);
+    teardown_server(&env);
+}
+
+AVS_UNIT_TEST(http_server, max_connections) {
+    server_env_t env = setup_server(&(const avs_http_server_config_t) {
+        .address = "127.0.0.1",
+        .max_connections = 1
+    });
+    send_request(&env, "GET /hello HTTP/1.1\r\n\r\n");
+    pump(&env);
+
+    server_env_t second = env;
+    second.client = connect_client(env.server);
+    send_request(&second, "GET /hello HTTP/1.1\r\n\r\n");
+
+    const char *response = "HTTP/1.1 200 OK\r\n"
+                           "Content-Type: text/plain\r\n"
+                           "Content-Length: 5\r\n"
+                           "\r\n"
+                           "Hello";
+    expect_response(&env, response);
+    /* the second connection is not served until the first one is closed */
+    char buf[16];
+    bool closed;
+    AVS_UNIT_ASSERT_EQUAL(
+            receive_response(&second, buf, sizeof(buf) - 1, &closed), 0);
+    AVS_UNIT_ASSERT_FALSE(closed);
+    avs_net_socket_cleanup(&env.client);
+    expect_response(&second, response);
+
+    avs_net_socket_cleanup(&second.client);
+    teardown_server(&env);
+}
+
+AVS_UNIT_TEST(http_server, stalled_client) {
+    server_env_t env = setup_server(NULL);
+    server_env_t stalled = env;
+    stalled.client = connect_client(env.server);
+    avs_time_monotonic_t start = avs_time_monotonic_now();
+    send_request(&stalled, "GET /hello HTTP/1.1\r\n"
+                           "Host: loc");
+    /* accept both connections and receive the partial request */
+    for (int i = 0; i < 3; ++i) {
+        pump(&env);
+    }
+
+    /* the active client is served without waiting for recv_timeout */
+    const char *response = "HTTP/1.1 200 OK\r\n"
+                           "Content-Type: text/plain\r\n"
+                           "Content-Length: 5\r\n"
+                           "\r\n"
+                           "Hello";
+    send_request(&env, "GET /hello HTTP/1.1\r\n\r\n");
+    expect_response(&env, response);
+    AVS_UNIT_ASSERT_TRUE(avs_time_duration_less(
+            avs_time_monotonic_diff(avs_time_monotonic_now(), start),
+            avs_time_duration_from_scalar(1, AVS_TIME_S)));
+
+    /* the stalled request is parsed correctly once completed */
+    send_request(&stalled, "alhost\r\n"
+                           "\r\n");
+    expect_response(&stalled, response);
+
+    avs_net_socket_cleanup(&stalled.client);
+    teardown_server(&env);
+}
+
+AVS_UNIT_TEST(http_server, slow_request_head) {
+    server_env_t env = setup_server(&(const avs_http_server_config_t) {
+        .address = "127.0.0.1",
+        .idle_timeout = avs_time_duration_from_scalar(200, AVS_TIME_MS)
+    });
+    send_request(&env, "GET /hello HTTP/1.1\r\n"
+                       "X-Slow: ");
+    /* the connection is closed even though the client keeps sending data,
+     * and without waiting for recv_timeout */
+    avs_time_monotonic_t start = avs_time_monotonic_now();
+    bool closed = false;
+    for (int i = 0; i < 100 && !closed; ++i) {
+        (void) avs_net_socket_send(env.client, "x", 1);
+        pump(&env);
+        char buf[16];
+        size_t bytes_received;
+        avs_error_t err = avs_net_socket_receive(env.client, &bytes_received,
+                                                 buf, sizeof(buf));
+        closed = (avs_is_ok(err) && !bytes_received)
+                 || (avs_is_err(err) && err.code != AVS_ETIMEDOUT);
+    }
+    AVS_UNIT_ASSERT_TRUE(closed);
+    AVS_UNIT_ASSERT_TRUE(avs_time_duration_less(
+            avs_time_monotonic_diff(avs_time_monotonic_now(), start),
+            avs_time_duration_from_scalar(1, AVS_TIME_S)));
+    teardown_server(&env);
+}
+
+AVS_UNIT_TEST(http_server, poll_interval_disabled) {
+    server_env_t env = setup_server(&(const avs_http_server_config_t) {
+        .address = "127.0.0.1",
+        .poll_interval = AVS_TIME_DURATION_INVALID
+    });
+    send_request(&env, "GET /hello HTTP/1.1\r\n\r\n");
+    expect_response(&env, "HTTP/1.1 200 OK\r\n"
+                          "Content-Type: text/plain\r\n"
+                          "Content-Length: 5\r\n"
+                          "\r\n"
+                          "Hello");
+    /* no periodic polling is scheduled while there is no activity */
+    pump(&env);
+    AVS_UNIT_ASSERT_FALSE(avs_time_monotonic_valid(
+            avs_sched_time(&env.server->poll_job)));
+    teardown_server(&env);
+}
+
+#if defined(AVS_COMMONS_NET_WITH_UNIX_SOCKETS) && defined(__linux__)
+AVS_UNIT_TEST(http_server, unix_socket) {
+    static const avs_net_socket_configuration_t unix_config = {
+        .address_family = AVS_NET_AF_UNIX
+    };
+    const avs_http_server_config_t config = {
+        .address = "@avs_http_server_test",
+        .tcp = &unix_config
+    };
+    server_env_t env = {
+        .sched = avs_sched_new("http_server_test", NULL)
+    };
+    AVS_UNIT_ASSERT_NOT_NULL(env.sched);
+    AVS_UNIT_ASSERT_NOT_NULL(
+            (env.server = avs_http_server_new(env.sched, &config)));
+    AVS_UNIT_ASSERT_SUCCESS(avs_http_server_add_route(
+            env.server, "GET", "/hello", hello_handler, NULL));
+    AVS_UNIT_ASSERT_SUCCESS(
+            avs_net_tcp_socket_create(&env.client, &unix_config));
+    AVS_UNIT_ASSERT_SUCCESS(
+            avs_net_socket_connect(env.client, config.address, NULL));
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_set_opt(
+            env.client, AVS_NET_SOCKET_OPT_RECV_TIMEOUT,
+            (avs_net_socket_opt_value_t) {
+                .recv_timeout = avs_time_duration_from_scalar(10, AVS_TIME_MS)
+            }));
+
+    send_request(&env, "GET /hello HTTP/1.1\r\n"
+                       "Host: localhost\r\n"
+                       "\r\n");
+    expect_response(&env, "HTTP/1.1 200 OK\r\n"
+                          "Content-Type: text/plain\r\n"
+                          "Content-Length: 5\r\n"
+                          "\r\n"
+                          "Hello");
+    teardown_server(&env);
+}
+#endif // defined(AVS_COMMONS_NET_WITH_UNIX_SOCKETS) && defined(__linux__)
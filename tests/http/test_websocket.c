@@ -0,0 +1,660 @@
+/*
+ * Copyright 2021 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+
+#include <avsystem/commons/avs_unit_mocksock.h>
+#include <avsystem/commons/avs_unit_test.h>
+
+#include "test_http.h"
+
+#ifdef AVS_COMMONS_HTTP_WITH_ZLIB
+#    define ACCEPT_ENCODING "Accept-Encoding: gzip, deflate\r\n"
+#else
+#    define ACCEPT_ENCODING ""
+#endif
+
+#define DEFLATE_OFFER                                                   \
+    "Sec-WebSocket-Extensions: permessage-deflate; "                    \
+    "server_no_context_takeover; client_no_context_takeover; "          \
+    "client_max_window_bits\r\n"
+
+avs_time_real_t avs_time_real_now_TEST_WRAPPER(void) {
+    return (avs_time_real_t) {
+        .since_real_epoch = { 1234567890, 123456789 }
+    };
+}
+
+/* seed derived from the mocked time, as without avs_crypto */
+#define INITIAL_SEED ((avs_rand_seed_t) (1234567890 ^ 123456789))
+
+/* Same sequence as generated by random_bytes() without avs_crypto */
+static void predict_random(avs_rand_seed_t *seed, uint8_t *out, size_t size) {
+    for (size_t i = 0; i < size; i += sizeof(uint32_t)) {
+        uint32_t value = avs_rand32_r(seed);
+        memcpy(&out[i], &value, AVS_MIN(sizeof(value), size - i));
+    }
+}
+
+#ifdef AVS_COMMONS_WITH_AVS_CRYPTO
+static avs_rand_seed_t g_prng_seed;
+
+int avs_crypto_prng_bytes_TEST_WRAPPER(avs_crypto_prng_ctx_t *ctx,
+                                       unsigned char *out_buf,
+                                       size_t out_buf_size) {
+    AVS_UNIT_ASSERT_NOT_NULL(ctx);
+    predict_random(&g_prng_seed, out_buf, out_buf_size);
+    return 0;
+}
+#endif // AVS_COMMONS_WITH_AVS_CRYPTO
+
+typedef struct {
+    avs_http_t *client;
+    avs_net_socket_t *socket;
+    avs_stream_t *stream;
+    /* copy of the stream's random seed, used to predict masking keys */
+    avs_rand_seed_t seed;
+} ws_env_t;
+
+static void expect_frame(ws_env_t *env,
+                         uint8_t first_byte,
+                         const void *payload,
+                         size_t payload_size) {
+    uint8_t frame[WS_FRAME_HEADER_MAX + 256];
+    AVS_UNIT_ASSERT_TRUE(payload_size <= 256);
+    size_t pos = 0;
+    frame[pos++] = first_byte;
+    if (payload_size < 126) {
+        frame[pos++] = (uint8_t) (0x80 | payload_size);
+    } else {
+        frame[pos++] = 0x80 | 126;
+        frame[pos++] = (uint8_t) (payload_size >> 8);
+        frame[pos++] = (uint8_t) payload_size;
+    }
+    predict_random(&env->seed, &frame[pos], 4);
+    for (size_t i = 0; i < payload_size; ++i) {
+        frame[pos + 4 + i] =
+                (uint8_t) (((const uint8_t *) payload)[i] ^ frame[pos + i % 4]);
+    }
+    avs_unit_mocksock_expect_output(env->socket, frame,
+                                    pos + 4 + payload_size);
+}
+
+static void input_data(ws_env_t *env, const void *data, size_t size) {
+    avs_unit_mocksock_input(env->socket, data, size);
+}
+
+#define INPUT(Env, Data) input_data((Env), (Data), sizeof(Data) - 1)
+
+#define SWITCHING_PROTOCOLS(Headers)      \
+    "HTTP/1.1 101 Switching Protocols\r\n" \
+    "Upgrade: websocket\r\n"               \
+    "Connection: Upgrade\r\n"              \
+    "Sec-WebSocket-Accept: %s\r\n" Headers "\r\n"
+
+/**
+ * Sets up the expected handshake. @p response_format may contain a single %s
+ * placeholder that is replaced with the expected Sec-WebSocket-Accept value.
+ */
+static void expect_handshake(ws_env_t *env,
+                             const char *request_headers,
+                             const char *response_format) {
+    env->client = avs_http_new(&AVS_HTTP_DEFAULT_BUFFER_SIZES);
+    AVS_UNIT_ASSERT_NOT_NULL(env->client);
+    avs_unit_mocksock_create(&env->socket);
+    avs_http_test_expect_create_socket(env->socket, AVS_NET_TCP_SOCKET);
+    avs_unit_mocksock_expect_connect(env->socket, "example.com", "80");
+
+#ifdef AVS_COMMONS_WITH_AVS_CRYPTO
+    g_prng_seed = INITIAL_SEED;
+#endif // AVS_COMMONS_WITH_AVS_CRYPTO
+    env->seed = INITIAL_SEED;
+    uint8_t nonce[16];
+    predict_random(&env->seed, nonce, sizeof(nonce));
+    char key[WS_KEY_SIZE];
+    char accept[WS_ACCEPT_SIZE];
+    AVS_UNIT_ASSERT_SUCCESS(
+            avs_base64_encode(key, sizeof(key), nonce, sizeof(nonce)));
+    AVS_UNIT_ASSERT_SUCCESS(compute_accept(key, accept));
+
+    char buf[1024];
+    int result = snprintf(buf, sizeof(buf),
+                          "GET /chat HTTP/1.1\r\n"
+                          "Host: example.com\r\n" ACCEPT_ENCODING
+                          "Upgrade: websocket\r\n"
+                          "Connection: Upgrade\r\n"
+                          "Sec-WebSocket-Key: %s\r\n"
+                          "Sec-WebSocket-Version: 13\r\n"
+                          "%s"
+                          "\r\n",
+                          key, request_headers);
+    AVS_UNIT_ASSERT_TRUE(result > 0 && (size_t) result < sizeof(buf));
+    avs_unit_mocksock_expect_output(env->socket, buf, (size_t) result);
+    result = snprintf(buf, sizeof(buf), response_format, accept);
+    AVS_UNIT_ASSERT_TRUE(result > 0 && (size_t) result < sizeof(buf));
+    avs_unit_mocksock_input(env->socket, buf, (size_t) result);
+}
+
+static avs_error_t do_connect(ws_env_t *env,
+                              const avs_websocket_config_t *config) {
+    avs_url_t *url = avs_url_parse("ws://example.com/chat");
+    AVS_UNIT_ASSERT_NOT_NULL(url);
+    avs_error_t err = avs_websocket_connect(&env->stream, env->client, url,
+                                            NULL, NULL, config);
+    avs_url_free(url);
+    if (avs_is_err(err)) {
+        AVS_UNIT_ASSERT_NULL(env->stream);
+    }
+    return err;
+}
+
+static void connect_env(ws_env_t *env,
+                        const avs_websocket_config_t *config,
+                        const char *request_headers,
+                        const char *response_format) {
+    expect_handshake(env, request_headers, response_format);
+    AVS_UNIT_ASSERT_SUCCESS(do_connect(env, config));
+    AVS_UNIT_ASSERT_NOT_NULL(env->stream);
+    avs_unit_mocksock_assert_io_clean(env->socket);
+}
+
+static void cleanup_env(ws_env_t *env) {
+    avs_unit_mocksock_expect_shutdown(env->socket);
+    avs_stream_cleanup(&env->stream);
+    avs_http_free(env->client);
+}
+
+static void expect_close_and_cleanup(ws_env_t *env) {
+    expect_frame(env, 0x88, "\x03\xE8", 2);
+    cleanup_env(env);
+}
+
+static size_t read_message(avs_stream_t *stream, char *buf, size_t buf_size) {
+    size_t total = 0;
+    bool message_finished = false;
+    while (!message_finished) {
+        size_t bytes_read;
+        AVS_UNIT_ASSERT_SUCCESS(avs_stream_read(stream, &bytes_read,
+                                                &message_finished, buf + total,
+                                                buf_size - total));
+        total += bytes_read;
+        AVS_UNIT_ASSERT_TRUE(total < buf_size || message_finished);
+    }
+    return total;
+}
+
+AVS_UNIT_TEST(websocket, accept_key) {
+    char accept[WS_ACCEPT_SIZE];
+    /* example from RFC 6455, section 1.3 */
+    AVS_UNIT_ASSERT_SUCCESS(compute_accept("dGhlIHNhbXBsZSBub25jZQ==", accept));
+    AVS_UNIT_ASSERT_EQUAL_STRING(accept, "s3pPLMBiTxaQ9kYGzzhZRbK+xOo=");
+}
+
+AVS_UNIT_TEST(websocket, mask) {
+    static const uint8_t mask[] = { 0x37, 0xFA, 0x21, 0x3D };
+    uint8_t data[37];
+    uint8_t expected[sizeof(data)];
+    for (size_t i = 0; i < sizeof(data); ++i) {
+        data[i] = (uint8_t) (i * 7);
+        expected[i] = (uint8_t) (data[i] ^ mask[i % 4]);
+    }
+    /* unaligned start */
+    apply_mask(data + 1, sizeof(data) - 1, mask);
+    for (size_t i = 1; i < sizeof(data); ++i) {
+        AVS_UNIT_ASSERT_EQUAL(data[i], (uint8_t) ((i * 7) ^ mask[(i - 1) % 4]));
+    }
+    apply_mask(data + 1, sizeof(data) - 1, mask);
+    apply_mask(data, sizeof(data), mask);
+    AVS_UNIT_ASSERT_EQUAL_BYTES_SIZED(data, expected, sizeof(data));
+}
+
+AVS_UNIT_TEST(websocket, text_echo) {
+    ws_env_t env = { 0 };
+    connect_env(&env,
+                &(const avs_websocket_config_t) {
+                    .subprotocols = "chat, superchat"
+                },
+                "Sec-WebSocket-Protocol: chat, superchat\r\n",
+                SWITCHING_PROTOCOLS("Sec-WebSocket-Protocol: chat\r\n"));
+    AVS_UNIT_ASSERT_EQUAL_STRING(avs_websocket_subprotocol(env.stream),
+                                 "chat");
+
+    AVS_UNIT_ASSERT_SUCCESS(
+            avs_websocket_set_message_type(env.stream, AVS_WEBSOCKET_TEXT));
+    expect_frame(&env, 0x81, "Hello", 5);
+    AVS_UNIT_ASSERT_SUCCESS(avs_stream_write(env.stream, "Hello", 5));
+    AVS_UNIT_ASSERT_SUCCESS(avs_stream_finish_message(env.stream));
+    avs_unit_mocksock_assert_io_clean(env.socket);
+
+    INPUT(&env, "\x81\x05Hello");
+    char buf[64];
+    AVS_UNIT_ASSERT_EQUAL(read_message(env.stream, buf, sizeof(buf)), 5);
+    AVS_UNIT_ASSERT_EQUAL_BYTES_SIZED(buf, "Hello", 5);
+    AVS_UNIT_ASSERT_EQUAL(avs_websocket_message_type(env.stream),
+                          AVS_WEBSOCKET_TEXT);
+    expect_close_and_cleanup(&env);
+}
+
+AVS_UNIT_TEST(websocket, frames_buffered_after_handshake) {
+    ws_env_t env = { 0 };
+    /* the frame arrives together with the handshake response */
+    connect_env(&env, NULL, "",
+                SWITCHING_PROTOCOLS("") "\x82\x03"
+                                        "abc");
+    char buf[64];
+    AVS_UNIT_ASSERT_EQUAL(read_message(env.stream, buf, sizeof(buf)), 3);
+    AVS_UNIT_ASSERT_EQUAL_BYTES_SIZED(buf, "abc", 3);
+    AVS_UNIT_ASSERT_EQUAL(avs_websocket_message_type(env.stream),
+                          AVS_WEBSOCKET_BINARY);
+    expect_close_and_cleanup(&env);
+}
+
+AVS_UNIT_TEST(websocket, fragmented_send) {
+    ws_env_t env = { 0 };
+    connect_env(&env,
+                &(const avs_websocket_config_t) {
+                    .fragment_size = 4
+                },
+                "", SWITCHING_PROTOCOLS(""));
+    expect_frame(&env, 0x02, "Hell", 4);
+    expect_frame(&env, 0x00, "o, w", 4);
+    expect_frame(&env, 0x80, "orld", 4);
+    AVS_UNIT_ASSERT_SUCCESS(avs_stream_write(env.stream, "Hello, w", 8));
+    AVS_UNIT_ASSERT_SUCCESS(avs_stream_write(env.stream, "orld", 4));
+    /* changing the type in the middle of a message is not allowed */
+    AVS_UNIT_ASSERT_FAILED(
+            avs_websocket_set_message_type(env.stream, AVS_WEBSOCKET_TEXT));
+    AVS_UNIT_ASSERT_SUCCESS(avs_stream_finish_message(env.stream));
+    avs_unit_mocksock_assert_io_clean(env.socket);
+
+    /* empty message */
+    expect_frame(&env, 0x82, "", 0);
+    AVS_UNIT_ASSERT_SUCCESS(avs_stream_finish_message(env.stream));
+    avs_unit_mocksock_assert_io_clean(env.socket);
+    expect_close_and_cleanup(&env);
+}
+
+AVS_UNIT_TEST(websocket, long_frame) {
+    ws_env_t env = { 0 };
+    connect_env(&env, NULL, "", SWITCHING_PROTOCOLS(""));
+    char payload[200];
+    for (size_t i = 0; i < sizeof(payload); ++i) {
+        payload[i] = (char) ('a' + i % 26);
+    }
+    expect_frame(&env, 0x82, payload, sizeof(payload));
+    AVS_UNIT_ASSERT_SUCCESS(
+            avs_stream_write(env.stream, payload, sizeof(payload)));
+    AVS_UNIT_ASSERT_SUCCESS(avs_stream_finish_message(env.stream));
+
+    INPUT(&env, "\x82\x7E\x00\xC8");
+    input_data(&env, payload, sizeof(payload));
+    char buf[256];
+    AVS_UNIT_ASSERT_EQUAL(read_message(env.stream, buf, sizeof(buf)),
+                          sizeof(payload));
+    AVS_UNIT_ASSERT_EQUAL_BYTES_SIZED(buf, payload, sizeof(payload));
+    expect_close_and_cleanup(&env);
+}
+
+AVS_UNIT_TEST(websocket, fragmented_receive_with_ping) {
+    ws_env_t env = { 0 };
+    connect_env(&env, NULL, "", SWITCHING_PROTOCOLS(""));
+    INPUT(&env, "\x01\x03Hel"
+                "\x89\x02hi");
+    expect_frame(&env, 0x8A, "hi", 2);
+    INPUT(&env, "\x80\x02lo");
+    char buf[64];
+    AVS_UNIT_ASSERT_EQUAL(read_message(env.stream, buf, sizeof(buf)), 5);
+    AVS_UNIT_ASSERT_EQUAL_BYTES_SIZED(buf, "Hello", 5);
+    AVS_UNIT_ASSERT_EQUAL(avs_websocket_message_type(env.stream),
+                          AVS_WEBSOCKET_TEXT);
+    avs_unit_mocksock_assert_io_clean(env.socket);
+    expect_close_and_cleanup(&env);
+}
+
+AVS_UNIT_TEST(websocket, close_by_server) {
+    ws_env_t env = { 0 };
+    connect_env(&env, NULL, "", SWITCHING_PROTOCOLS(""));
+    INPUT(&env, "\x88\x04\x03\xE9"
+                "by");
+    expect_frame(&env, 0x88, "\x03\xE9", 2);
+    char buf[16];
+    size_t bytes_read;
+    bool message_finished;
+    AVS_UNIT_ASSERT_TRUE(avs_is_eof(avs_stream_read(
+            env.stream, &bytes_read, &message_finished, buf, sizeof(buf))));
+    AVS_UNIT_ASSERT_EQUAL(avs_websocket_close_code(env.stream), 1001);
+    AVS_UNIT_ASSERT_TRUE(avs_is_eof(avs_stream_read(
+            env.stream, &bytes_read, &message_finished, buf, sizeof(buf))));
+    AVS_UNIT_ASSERT_FAILED(avs_stream_write(env.stream, "x", 1));
+    cleanup_env(&env);
+}
+
+AVS_UNIT_TEST(websocket, close_by_client) {
+    ws_env_t env = { 0 };
+    connect_env(&env, NULL, "", SWITCHING_PROTOCOLS(""));
+    expect_frame(&env, 0x88, "\x0F\xA0going", 7);
+    AVS_UNIT_ASSERT_SUCCESS(avs_websocket_close(env.stream, 4000, "going"));
+    /* data sent by the server before the close frame can still be read */
+    INPUT(&env, "\x82\x01x"
+                "\x88\x00");
+    char buf[16];
+    AVS_UNIT_ASSERT_EQUAL(read_message(env.stream, buf, sizeof(buf)), 1);
+    size_t bytes_read;
+    bool message_finished;
+    AVS_UNIT_ASSERT_TRUE(avs_is_eof(avs_stream_read(
+            env.stream, &bytes_read, &message_finished, buf, sizeof(buf))));
+    AVS_UNIT_ASSERT_EQUAL(avs_websocket_close_code(env.stream), 1005);
+    cleanup_env(&env);
+}
+
+AVS_UNIT_TEST(websocket, masked_frame_from_server) {
+    ws_env_t env = { 0 };
+    connect_env(&env, NULL, "", SWITCHING_PROTOCOLS(""));
+    INPUT(&env, "\x82\x81\x00\x00\x00\x00x");
+    expect_frame(&env, 0x88, "\x03\xEA", 2);
+    char buf[16];
+    size_t bytes_read;
+    bool message_finished;
+    avs_error_t err = avs_stream_read(env.stream, &bytes_read,
+                                      &message_finished, buf, sizeof(buf));
+    AVS_UNIT_ASSERT_EQUAL(err.category, AVS_ERRNO_CATEGORY);
+    AVS_UNIT_ASSERT_EQUAL(err.code, AVS_EPROTO);
+    cleanup_env(&env);
+}
+
+AVS_UNIT_TEST(websocket, invalid_accept) {
+    ws_env_t env = { 0 };
+    expect_handshake(&env, "",
+                     "HTTP/1.1 101 Switching Protocols\r\n"
+                     "Upgrade: websocket\r\n"
+                     "Connection: Upgrade\r\n"
+                     "Sec-WebSocket-Accept: s3pPLMBiTxaQ9kYGzzhZRbK+xOo=\r\n"
+                     "\r\n");
+    avs_unit_mocksock_expect_shutdown(env.socket);
+    avs_error_t err = do_connect(&env, NULL);
+    AVS_UNIT_ASSERT_EQUAL(err.category, AVS_ERRNO_CATEGORY);
+    AVS_UNIT_ASSERT_EQUAL(err.code, AVS_EPROTO);
+    avs_http_free(env.client);
+}
+
+AVS_UNIT_TEST(websocket, upgrade_refused) {
+    ws_env_t env = { 0 };
+    expect_handshake(&env, "",
+                     "HTTP/1.1 200 OK\r\n"
+                     "Content-Length: 0\r\n"
+                     "\r\n");
+    avs_unit_mocksock_expect_shutdown(env.socket);
+    avs_error_t err = do_connect(&env, NULL);
+    AVS_UNIT_ASSERT_EQUAL(err.category, AVS_HTTP_ERROR_CATEGORY);
+    AVS_UNIT_ASSERT_EQUAL(err.code, 200);
+    avs_http_free(env.client);
+}
+
+AVS_UNIT_TEST(websocket, keepalive) {
+    avs_sched_t *sched = avs_sched_new("websocket", NULL);
+    AVS_UNIT_ASSERT_NOT_NULL(sched);
+    ws_env_t env = { 0 };
+    connect_env(&env,
+                &(const avs_websocket_config_t) {
+                    .sched = sched,
+                    .ping_interval = { 0, 50000000 }
+                },
+                "", SWITCHING_PROTOCOLS(""));
+    /* first ping */
+    expect_frame(&env, 0x89, "", 0);
+    while (!((websocket_t *) env.stream)->pong_pending) {
+        avs_sched_run(sched);
+    }
+    avs_unit_mocksock_assert_io_clean(env.socket);
+
+    /* pong arrives */
+    INPUT(&env, "\x8A\x00"
+                "\x82\x01x");
+    char buf[16];
+    AVS_UNIT_ASSERT_EQUAL(read_message(env.stream, buf, sizeof(buf)), 1);
+    AVS_UNIT_ASSERT_FALSE(((websocket_t *) env.stream)->pong_pending);
+
+    /* second ping is not answered */
+    expect_frame(&env, 0x89, "", 0);
+    while (!((websocket_t *) env.stream)->pong_pending) {
+        avs_sched_run(sched);
+    }
+    avs_unit_mocksock_expect_shutdown(env.socket);
+    while (!((websocket_t *) env.stream)->close_sent) {
+        avs_sched_run(sched);
+    }
+    avs_unit_mocksock_assert_io_clean(env.socket);
+    /* no close frame is sent on a dead connection */
+    cleanup_env(&env);
+    avs_sched_cleanup(&sched);
+}
+
+AVS_UNIT_TEST(websocket, default_ping_interval) {
+    avs_sched_t *sched = avs_sched_new("websocket", NULL);
+    AVS_UNIT_ASSERT_NOT_NULL(sched);
+    ws_env_t env = { 0 };
+    connect_env(&env,
+                &(const avs_websocket_config_t) {
+                    .sched = sched
+                },
+                "", SWITCHING_PROTOCOLS(""));
+    websocket_t *ws = (websocket_t *) env.stream;
+    AVS_UNIT_ASSERT_TRUE(avs_time_duration_equal(ws->ping_interval,
+                                                 DEFAULT_PING_INTERVAL));
+    AVS_UNIT_ASSERT_NOT_NULL(ws->ping_job);
+    expect_close_and_cleanup(&env);
+    avs_sched_cleanup(&sched);
+}
+
+AVS_UNIT_TEST(websocket, ping_disabled) {
+    avs_sched_t *sched = avs_sched_new("websocket", NULL);
+    AVS_UNIT_ASSERT_NOT_NULL(sched);
+    ws_env_t env = { 0 };
+    connect_env(&env,
+                &(const avs_websocket_config_t) {
+                    .sched = sched,
+                    .ping_interval = AVS_TIME_DURATION_INVALID
+                },
+                "", SWITCHING_PROTOCOLS(""));
+    AVS_UNIT_ASSERT_NULL(((websocket_t *) env.stream)->ping_job);
+    AVS_UNIT_ASSERT_FALSE(
+            avs_time_monotonic_valid(avs_sched_time_of_next(sched)));
+    expect_close_and_cleanup(&env);
+    avs_sched_cleanup(&sched);
+}
+
+AVS_UNIT_TEST(websocket, negative_ping_interval) {
+    ws_env_t env = { 0 };
+    avs_url_t *url = avs_url_parse("ws://example.com/chat");
+    AVS_UNIT_ASSERT_NOT_NULL(url);
+    AVS_UNIT_ASSERT_FAILED(avs_websocket_connect(
+            &env.stream, NULL, url, NULL, NULL,
+            &(const avs_websocket_config_t) {
+                .ping_interval = { -1, 0 }
+            }));
+    AVS_UNIT_ASSERT_NULL(env.stream);
+    avs_url_free(url);
+}
+
+#ifdef AVS_COMMONS_WITH_AVS_CRYPTO
+AVS_UNIT_TEST(websocket, prng_from_config) {
+    avs_crypto_prng_ctx_t *prng = avs_crypto_prng_new(NULL, NULL);
+    AVS_UNIT_ASSERT_NOT_NULL(prng);
+    ws_env_t env = { 0 };
+    connect_env(&env,
+                &(const avs_websocket_config_t) {
+                    .prng_ctx = prng
+                },
+                "", SWITCHING_PROTOCOLS(""));
+    AVS_UNIT_ASSERT_TRUE(((websocket_t *) env.stream)->prng == prng);
+    AVS_UNIT_ASSERT_FALSE(((websocket_t *) env.stream)->prng_owned);
+    expect_close_and_cleanup(&env);
+    avs_crypto_prng_free(&prng);
+}
+#endif // AVS_COMMONS_WITH_AVS_CRYPTO
+
+#ifdef AVS_COMMONS_HTTP_WITH_ZLIB
+static void connect_deflate_env(ws_env_t *env, const char *response_format) {
+    connect_env(env,
+                &(const avs_websocket_config_t) {
+                    .permessage_deflate = true
+                },
+                DEFLATE_OFFER, response_format);
+    AVS_UNIT_ASSERT_NOT_NULL(((websocket_t *) env->stream)->compressor);
+}
+
+/* Compressed "Hello", as in RFC 7692, section 7.2.3.1 */
+static const char COMPRESSED_HELLO[] = "\xF2\x48\xCD\xC9\xC9\x07\x00";
+
+AVS_UNIT_TEST(websocket, deflate_send) {
+    ws_env_t env = { 0 };
+    connect_deflate_env(&env, SWITCHING_PROTOCOLS(
+                                      "Sec-WebSocket-Extensions: "
+                                      "permessage-deflate; "
+                                      "server_no_context_takeover\r\n"));
+    AVS_UNIT_ASSERT_SUCCESS(
+            avs_websocket_set_message_type(env.stream, AVS_WEBSOCKET_TEXT));
+    /* without context takeover, both messages are compressed the same way */
+    for (int i = 0; i < 2; ++i) {
+        expect_frame(&env, 0xC1, COMPRESSED_HELLO,
+                     sizeof(COMPRESSED_HELLO) - 1);
+        AVS_UNIT_ASSERT_SUCCESS(avs_stream_write(env.stream, "Hel", 3));
+        AVS_UNIT_ASSERT_SUCCESS(avs_stream_write(env.stream, "lo", 2));
+        AVS_UNIT_ASSERT_SUCCESS(avs_stream_finish_message(env.stream));
+        avs_unit_mocksock_assert_io_clean(env.socket);
+    }
+    /* empty message */
+    expect_frame(&env, 0xC1, "\x00", 1);
+    AVS_UNIT_ASSERT_SUCCESS(avs_stream_finish_message(env.stream));
+    expect_close_and_cleanup(&env);
+}
+
+AVS_UNIT_TEST(websocket, deflate_send_fragmented) {
+    ws_env_t env = { 0 };
+    connect_env(&env,
+                &(const avs_websocket_config_t) {
+                    .permessage_deflate = true,
+                    .fragment_size = 3
+                },
+                DEFLATE_OFFER,
+                SWITCHING_PROTOCOLS(
+                        "Sec-WebSocket-Extensions: permessage-deflate; "
+                        "server_no_context_takeover; "
+                        "client_no_context_takeover; "
+                        "client_max_window_bits=10\r\n"));
+    expect_frame(&env, 0x42, COMPRESSED_HELLO, 3);
+    expect_frame(&env, 0x00, COMPRESSED_HELLO + 3, 3);
+    expect_frame(&env, 0x80, COMPRESSED_HELLO + 6, 1);
+    AVS_UNIT_ASSERT_SUCCESS(avs_stream_write(env.stream, "Hello", 5));
+    AVS_UNIT_ASSERT_SUCCESS(avs_stream_finish_message(env.stream));
+    expect_close_and_cleanup(&env);
+}
+
+AVS_UNIT_TEST(websocket, deflate_receive) {
+    ws_env_t env = { 0 };
+    connect_deflate_env(&env, SWITCHING_PROTOCOLS(
+                                      "Sec-WebSocket-Extensions: "
+                                      "permessage-deflate; "
+                                      "server_no_context_takeover\r\n"));
+    char buf[64];
+    /* single frame */
+    INPUT(&env, "\xC1\x07\xF2\x48\xCD\xC9\xC9\x07\x00");
+    AVS_UNIT_ASSERT_EQUAL(read_message(env.stream, buf, sizeof(buf)), 5);
+    AVS_UNIT_ASSERT_EQUAL_BYTES_SIZED(buf, "Hello", 5);
+    /* fragmented, RFC 7692 section 7.2.3.2 */
+    INPUT(&env, "\x41\x03\xF2\x48\xCD"
+                "\x80\x04\xC9\xC9\x07\x00");
+    AVS_UNIT_ASSERT_EQUAL(read_message(env.stream, buf, sizeof(buf)), 5);
+    AVS_UNIT_ASSERT_EQUAL_BYTES_SIZED(buf, "Hello", 5);
+    /* uncompressed message */
+    INPUT(&env, "\x81\x02hi");
+    AVS_UNIT_ASSERT_EQUAL(read_message(env.stream, buf, sizeof(buf)), 2);
+    AVS_UNIT_ASSERT_EQUAL_BYTES_SIZED(buf, "hi", 2);
+    expect_close_and_cleanup(&env);
+}
+
+AVS_UNIT_TEST(websocket, deflate_receive_large) {
+    ws_env_t env = { 0 };
+    connect_deflate_env(&env, SWITCHING_PROTOCOLS(
+                                      "Sec-WebSocket-Extensions: "
+                                      "permessage-deflate; "
+                                      "server_no_context_takeover\r\n"));
+    /* compress a message that does not fit in the decompressor buffers */
+    static char message[20000];
+    avs_rand_seed_t seed = 42;
+    for (size_t i = 0; i < sizeof(message); ++i) {
+        message[i] = (char) ('a' + (avs_rand32_r(&seed) >> 28));
+    }
+    avs_stream_t *compressor = _avs_http_create_compressor(
+            AVS_STREAM_COMPRESSION_RAW_DEFLATE,
+            HTTP_COMPRESSOR_WINDOW_BITS_DEFAULT, 256, 256);
+    AVS_UNIT_ASSERT_NOT_NULL(compressor);
+    static uint8_t compressed[sizeof(message) + 64];
+    size_t compressed_size = 0;
+    size_t written = 0;
+    bool flushed = false;
+    while (true) {
+        if (written < sizeof(message)) {
+            size_t chunk = AVS_MIN(sizeof(message) - written, 64);
+            AVS_UNIT_ASSERT_SUCCESS(avs_stream_write_some(
+                    compressor, message + written, &chunk));
+            written += chunk;
+        } else if (!flushed) {
+            AVS_UNIT_ASSERT_SUCCESS(
+                    _avs_http_compressor_sync_flush(compressor));
+            flushed = true;
+        }
+        size_t bytes_read;
+        bool finished;
+        AVS_UNIT_ASSERT_SUCCESS(avs_stream_read(
+                compressor, &bytes_read, &finished,
+                compressed + compressed_size,
+                sizeof(compressed) - compressed_size));
+        compressed_size += bytes_read;
+        if (flushed && !bytes_read) {
+            break;
+        }
+    }
+    avs_stream_cleanup(&compressor);
+    AVS_UNIT_ASSERT_TRUE(compressed_size > 4);
+    compressed_size -= 4;
+    AVS_UNIT_ASSERT_TRUE(compressed_size > 125
+                         && compressed_size <= UINT16_MAX);
+
+    const uint8_t header[] = { 0xC2, 126, (uint8_t) (compressed_size >> 8),
+                               (uint8_t) compressed_size };
+    input_data(&env, header, sizeof(header));
+    input_data(&env, compressed, compressed_size);
+    static char buf[sizeof(message) + 1];
+    AVS_UNIT_ASSERT_EQUAL(read_message(env.stream, buf, sizeof(buf)),
+                          sizeof(message));
+    AVS_UNIT_ASSERT_EQUAL_BYTES_SIZED(buf, message, sizeof(message));
+    expect_close_and_cleanup(&env);
+}
+
+AVS_UNIT_TEST(websocket, deflate_missing_server_no_context_takeover) {
+    ws_env_t env = { 0 };
+    expect_handshake(&env, DEFLATE_OFFER,
+                     SWITCHING_PROTOCOLS("Sec-WebSocket-Extensions: "
+                                         "permessage-deflate\r\n"));
+    avs_unit_mocksock_expect_shutdown(env.socket);
+    AVS_UNIT_ASSERT_FAILED(do_connect(&env,
+                                      &(const avs_websocket_config_t) {
+                                          .permessage_deflate = true
+                                      }));
+    avs_http_free(env.client);
+}
+#endif // AVS_COMMONS_HTTP_WITH_ZLIB
@@ -17,6 +17,7 @@
 #include <avsystem/commons/avs_log.h>
 #include <avsystem/commons/avs_unit_test.h>
 
+#include <math.h>
 #include <stdlib.h>
 
 static avs_log_level_t EXPECTED_LEVEL;
@@ -324,3 +325,354 @@ AVS_UNIT_TEST(log, truncated) {
 
 #undef LOG_MSG
 }
+
+#ifdef AVS_COMMONS_LOG_WITH_RATE_LIMIT
+static char RECORDED_MESSAGES[4][512];
+static size_t RECORDED_COUNT;
+
+static void recording_handler(avs_log_level_t level,
+                              const char *module,
+                              const char *message) {
+    (void) level;
+    (void) module;
+    AVS_UNIT_ASSERT_TRUE(RECORDED_COUNT < AVS_ARRAY_SIZE(RECORDED_MESSAGES));
+    snprintf(RECORDED_MESSAGES[RECORDED_COUNT++],
+             sizeof(RECORDED_MESSAGES[0]), "%s", message);
+}
+
+static int FLOOD_LINE;
+
+static void log_flood(int i) {
+    FLOOD_LINE = __LINE__ + 1;
+    avs_log(flood_module, ERROR, "Flood %d", i);
+}
+
+static void assert_recorded(size_t index, const char *message) {
+    char expected[512];
+    snprintf(expected, sizeof(expected),
+             "ERROR [flood_module] [" __FILE__ ":%d]: %s", FLOOD_LINE, message);
+    AVS_UNIT_ASSERT_EQUAL_STRING(RECORDED_MESSAGES[index], expected);
+}
+
+AVS_UNIT_TEST(log, rate_limit) {
+    avs_log_set_handler(recording_handler);
+    RECORDED_COUNT = 0;
+    AVS_UNIT_ASSERT_SUCCESS(avs_log_set_rate_limit(
+            flood_module, AVS_LOG_ERROR, 2,
+            avs_time_duration_from_scalar(1, AVS_TIME_HOUR)));
+
+    for (int i = 0; i < 5; ++i) {
+        log_flood(i);
+    }
+    AVS_UNIT_ASSERT_EQUAL(RECORDED_COUNT, 2);
+    assert_recorded(0, "Flood 0");
+    assert_recorded(1, "Flood 1");
+    AVS_UNIT_ASSERT_EQUAL(avs_log_dropped_count(AVS_LOG_ERROR), 3);
+    AVS_UNIT_ASSERT_EQUAL(avs_log_dropped_count(AVS_LOG_WARNING), 0);
+    AVS_UNIT_ASSERT_EQUAL(avs_log_dropped_count(AVS_LOG_QUIET), 3);
+
+    /* arguments of suppressed lazy logs are not evaluated */
+    for (int i = 0; i < 3; ++i) {
+        avs_log_lazy(flood_module, ERROR, "Lazy %d",
+                     i < 2 ? success() : fail());
+    }
+    AVS_UNIT_ASSERT_EQUAL(RECORDED_COUNT, 4);
+    AVS_UNIT_ASSERT_EQUAL(avs_log_dropped_count(AVS_LOG_QUIET), 4);
+
+    /* other levels are not limited */
+    RECORDED_COUNT = 0;
+    for (int i = 0; i < 3; ++i) {
+        avs_log(flood_module, WARNING, "Warning %d", i);
+    }
+    AVS_UNIT_ASSERT_EQUAL(RECORDED_COUNT, 3);
+
+    /* pretend that the interval has passed for the flooding call site */
+    RECORDED_COUNT = 0;
+    for (size_t i = 0; i < AVS_ARRAY_SIZE(g_log.call_sites); ++i) {
+        if (g_log.call_sites[i].file
+                && g_log.call_sites[i].line == (unsigned) FLOOD_LINE) {
+            g_log.call_sites[i].refill_time = avs_time_monotonic_add(
+                    g_log.call_sites[i].refill_time,
+                    avs_time_duration_from_scalar(-1, AVS_TIME_HOUR));
+        }
+    }
+    log_flood(5);
+    log_flood(6);
+    AVS_UNIT_ASSERT_EQUAL(RECORDED_COUNT, 2);
+    assert_recorded(0, "last message repeated 3 times");
+    assert_recorded(1, "Flood 5");
+    AVS_UNIT_ASSERT_EQUAL(avs_log_dropped_count(AVS_LOG_ERROR), 5);
+
+    avs_log_reset();
+    AVS_UNIT_ASSERT_EQUAL(avs_log_dropped_count(AVS_LOG_QUIET), 0);
+    reset_everything();
+}
+
+AVS_UNIT_TEST(log, rate_limit_token_bucket) {
+    const rate_limit_t limit = {
+        .burst = 2,
+        .interval_us = 1000000
+    };
+    const char *file = "file.c";
+    avs_time_monotonic_t now = avs_time_monotonic_from_scalar(100, AVS_TIME_S);
+    uint32_t suppressed = 0;
+
+    AVS_UNIT_ASSERT_TRUE(rate_limit_allows_unlocked(&limit, AVS_LOG_INFO, file,
+                                                    1, now, &suppressed));
+    AVS_UNIT_ASSERT_TRUE(rate_limit_allows_unlocked(&limit, AVS_LOG_INFO, file,
+                                                    1, now, &suppressed));
+    AVS_UNIT_ASSERT_FALSE(rate_limit_allows_unlocked(&limit, AVS_LOG_INFO, file,
+                                                     1, now, &suppressed));
+    /* other call sites have separate buckets */
+    AVS_UNIT_ASSERT_TRUE(rate_limit_allows_unlocked(&limit, AVS_LOG_INFO, file,
+                                                    2, now, &suppressed));
+
+    now = avs_time_monotonic_add(
+            now, avs_time_duration_from_scalar(1500, AVS_TIME_MS));
+    AVS_UNIT_ASSERT_TRUE(rate_limit_allows_unlocked(&limit, AVS_LOG_INFO, file,
+                                                    1, now, &suppressed));
+    AVS_UNIT_ASSERT_EQUAL(suppressed, 1);
+    AVS_UNIT_ASSERT_FALSE(rate_limit_allows_unlocked(&limit, AVS_LOG_INFO, file,
+                                                     1, now, &suppressed));
+
+    /* the partial interval that elapsed before is not lost */
+    now = avs_time_monotonic_add(
+            now, avs_time_duration_from_scalar(500, AVS_TIME_MS));
+    AVS_UNIT_ASSERT_TRUE(rate_limit_allows_unlocked(&limit, AVS_LOG_INFO, file,
+                                                    1, now, &suppressed));
+    AVS_UNIT_ASSERT_EQUAL(suppressed, 1);
+
+    /* the bucket never holds more than burst tokens */
+    now = avs_time_monotonic_add(
+            now, avs_time_duration_from_scalar(1, AVS_TIME_DAY));
+    AVS_UNIT_ASSERT_TRUE(rate_limit_allows_unlocked(&limit, AVS_LOG_INFO, file,
+                                                    1, now, &suppressed));
+    AVS_UNIT_ASSERT_TRUE(rate_limit_allows_unlocked(&limit, AVS_LOG_INFO, file,
+                                                    1, now, &suppressed));
+    AVS_UNIT_ASSERT_FALSE(rate_limit_allows_unlocked(&limit, AVS_LOG_INFO, file,
+                                                     1, now, &suppressed));
+
+    AVS_UNIT_ASSERT_EQUAL(avs_log_dropped_count(AVS_LOG_INFO), 3);
+    reset_everything();
+}
+
+AVS_UNIT_TEST(log, rate_limit_settings) {
+    const avs_time_duration_t second =
+            avs_time_duration_from_scalar(1, AVS_TIME_S);
+    AVS_UNIT_ASSERT_FAILED(
+            avs_log_set_default_rate_limit(AVS_LOG_QUIET, 1, second));
+    AVS_UNIT_ASSERT_FAILED(avs_log_set_default_rate_limit(
+            AVS_LOG_INFO, 1, AVS_TIME_DURATION_ZERO));
+    AVS_UNIT_ASSERT_FAILED(avs_log_set_default_rate_limit(
+            AVS_LOG_INFO, 1, AVS_TIME_DURATION_INVALID));
+    AVS_UNIT_ASSERT_SUCCESS(avs_log_set_default_rate_limit(
+            AVS_LOG_INFO, 0, AVS_TIME_DURATION_INVALID));
+
+    AVS_UNIT_ASSERT_SUCCESS(avs_log_set_default_rate_limit(AVS_LOG_INFO, 5,
+                                                           second));
+    AVS_UNIT_ASSERT_SUCCESS(avs_log_set_level(other_module, AVS_LOG_DEBUG));
+    AVS_UNIT_ASSERT_FAILED(avs_log_set_rate_limit(
+            limited_module, AVS_LOG_INFO, 1, AVS_TIME_DURATION_INVALID));
+    AVS_UNIT_ASSERT_SUCCESS(avs_log_set_rate_limit(unlimited_module,
+                                                   AVS_LOG_INFO, 0, second));
+
+    /* modules without their own settings use the default limit */
+    const rate_limit_t *limit =
+            rate_limit_for(level_for("other_module", 0), AVS_LOG_INFO);
+    AVS_UNIT_ASSERT_EQUAL(limit->burst, 5);
+    limit = rate_limit_for(level_for("other_module", 0), AVS_LOG_ERROR);
+    AVS_UNIT_ASSERT_EQUAL(limit->burst, 0);
+    limit = rate_limit_for(level_for("unknown_module", 0), AVS_LOG_INFO);
+    AVS_UNIT_ASSERT_EQUAL(limit->burst, 5);
+    limit = rate_limit_for(level_for("unlimited_module", 0), AVS_LOG_INFO);
+    AVS_UNIT_ASSERT_EQUAL(limit->burst, 0);
+
+    reset_everything();
+}
+
+AVS_UNIT_TEST(log, rate_limit_follows_default_level) {
+    avs_log_set_handler(recording_handler);
+    RECORDED_COUNT = 0;
+    AVS_UNIT_ASSERT_SUCCESS(avs_log_set_rate_limit(
+            limited_module, AVS_LOG_ERROR, 1,
+            avs_time_duration_from_scalar(1, AVS_TIME_HOUR)));
+
+    avs_log_set_default_level(AVS_LOG_WARNING);
+    avs_log(limited_module, INFO, "Info");
+    avs_log(limited_module, WARNING, "Warning");
+    AVS_UNIT_ASSERT_EQUAL(RECORDED_COUNT, 1);
+    AVS_UNIT_ASSERT_NOT_NULL(strstr(RECORDED_MESSAGES[0], "]: Warning"));
+
+    avs_log_set_default_level(AVS_LOG_DEBUG);
+    avs_log(limited_module, DEBUG, "Debug");
+    AVS_UNIT_ASSERT_EQUAL(RECORDED_COUNT, 2);
+    AVS_UNIT_ASSERT_NOT_NULL(strstr(RECORDED_MESSAGES[1], "]: Debug"));
+
+    /* an explicitly set level is not overridden by the default */
+    AVS_UNIT_ASSERT_SUCCESS(avs_log_set_level(limited_module, AVS_LOG_ERROR));
+    avs_log_set_default_level(AVS_LOG_TRACE);
+    avs_log(limited_module, WARNING, "Warning");
+    AVS_UNIT_ASSERT_EQUAL(RECORDED_COUNT, 2);
+
+    reset_everything();
+}
+#endif // AVS_COMMONS_LOG_WITH_RATE_LIMIT
+
+#ifdef AVS_COMMONS_LOG_WITH_STRUCTURED
+AVS_UNIT_TEST(log, kv) {
+    ASSERT_LOG(test,
+               INFO,
+               "INFO [test] [" __FILE__ ":%d]: Connected peer=10.0.0.1 "
+               "bytes=42 delta=-7 ratio=0.5 secure=true note=\"two words\"",
+               __LINE__ + 1);
+    avs_log_kv(test, INFO, "Connected", AVS_LOG_FIELD_STR("peer", "10.0.0.1"),
+               AVS_LOG_FIELD_U64("bytes", 42), AVS_LOG_FIELD_I64("delta", -7),
+               AVS_LOG_FIELD_DOUBLE("ratio", 0.5),
+               AVS_LOG_FIELD_BOOL("secure", true),
+               AVS_LOG_FIELD_STR("note", "two words"));
+
+    ASSERT_LOG(test,
+               INFO,
+               "INFO [test] [" __FILE__ ":%d]: No fields",
+               __LINE__ + 1);
+    avs_log_kv(test, INFO, "No fields");
+
+    /* fields are not evaluated if the message is not logged */
+    avs_log_kv(test, DEBUG, "Not printed", AVS_LOG_FIELD_I64("value", fail()));
+
+    ASSERT_LOG_CLEAN;
+    reset_everything();
+}
+
+AVS_UNIT_TEST(log, kv_context) {
+    AVS_UNIT_ASSERT_SUCCESS(
+            avs_log_context_push(AVS_LOG_FIELD_STR("request_id", "abc")));
+    ASSERT_LOG(test,
+               INFO,
+               "INFO [test] [" __FILE__ ":%d]: Plain 1 request_id=abc",
+               __LINE__ + 1);
+    avs_log(test, INFO, "Plain %d", 1);
+    ASSERT_LOG(test,
+               INFO,
+               "INFO [test] [" __FILE__ ":%d]: Structured n=2 request_id=abc",
+               __LINE__ + 1);
+    avs_log_kv(test, INFO, "Structured", AVS_LOG_FIELD_I64("n", 2));
+
+    avs_log_context_pop();
+    ASSERT_LOG(test,
+               INFO,
+               "INFO [test] [" __FILE__ ":%d]: Plain 3",
+               __LINE__ + 1);
+    avs_log(test, INFO, "Plain %d", 3);
+
+    for (size_t i = 0; i < AVS_COMMONS_LOG_CONTEXT_MAX_FIELDS; ++i) {
+        AVS_UNIT_ASSERT_SUCCESS(
+                avs_log_context_push(AVS_LOG_FIELD_U64("depth", i)));
+    }
+    AVS_UNIT_ASSERT_FAILED(avs_log_context_push(AVS_LOG_FIELD_U64("depth", 0)));
+    for (size_t i = 0; i < AVS_COMMONS_LOG_CONTEXT_MAX_FIELDS + 1; ++i) {
+        avs_log_context_pop();
+    }
+    AVS_UNIT_ASSERT_FAILED(
+            avs_log_context_push(AVS_LOG_FIELD_STR(NULL, "no key")));
+
+    ASSERT_LOG_CLEAN;
+    reset_everything();
+}
+
+static avs_log_level_t RECORD_LEVEL;
+static char RECORD_MESSAGE[64];
+static char RECORD_LOGFMT[256];
+static size_t RECORD_FIELD_COUNT;
+static size_t RECORD_CONTEXT_FIELD_COUNT;
+
+static void record_handler(const avs_log_record_t *record) {
+    RECORD_LEVEL = record->level;
+    snprintf(RECORD_MESSAGE, sizeof(RECORD_MESSAGE), "%s", record->message);
+    RECORD_FIELD_COUNT = record->field_count;
+    RECORD_CONTEXT_FIELD_COUNT = record->context_field_count;
+    AVS_UNIT_ASSERT_TRUE(avs_log_record_to_logfmt(RECORD_LOGFMT,
+                                                  sizeof(RECORD_LOGFMT), record)
+                         > 0);
+}
+
+AVS_UNIT_TEST(log, record_handler) {
+    avs_log_set_record_handler(record_handler);
+    AVS_UNIT_ASSERT_SUCCESS(
+            avs_log_context_push(AVS_LOG_FIELD_STR("request_id", "abc")));
+
+    int line = __LINE__ + 1;
+    avs_log_kv(test, WARNING, "Slow", AVS_LOG_FIELD_U64("ms", 1500));
+    AVS_UNIT_ASSERT_EQUAL(RECORD_LEVEL, AVS_LOG_WARNING);
+    AVS_UNIT_ASSERT_EQUAL_STRING(RECORD_MESSAGE, "Slow");
+    AVS_UNIT_ASSERT_EQUAL(RECORD_FIELD_COUNT, 1);
+    AVS_UNIT_ASSERT_EQUAL(RECORD_CONTEXT_FIELD_COUNT, 1);
+    char expected[256];
+    snprintf(expected, sizeof(expected),
+             "level=WARNING module=test file=" __FILE__
+             " line=%d msg=Slow ms=1500 request_id=abc",
+             line);
+    AVS_UNIT_ASSERT_EQUAL_STRING(RECORD_LOGFMT, expected);
+
+    /* plain messages are passed as records without the prefix */
+    avs_log(test, ERROR, "Hello, %s!", "world");
+    AVS_UNIT_ASSERT_EQUAL(RECORD_LEVEL, AVS_LOG_ERROR);
+    AVS_UNIT_ASSERT_EQUAL_STRING(RECORD_MESSAGE, "Hello, world!");
+    AVS_UNIT_ASSERT_EQUAL(RECORD_FIELD_COUNT, 0);
+    AVS_UNIT_ASSERT_EQUAL(RECORD_CONTEXT_FIELD_COUNT, 1);
+
+    avs_log_set_record_handler(NULL);
+    ASSERT_LOG(test,
+               INFO,
+               "INFO [test] [" __FILE__ ":%d]: Text again request_id=abc",
+               __LINE__ + 1);
+    avs_log(test, INFO, "Text again");
+
+    ASSERT_LOG_CLEAN;
+    reset_everything();
+}
+
+AVS_UNIT_TEST(log, record_encoders) {
+    const avs_log_field_t fields[] = {
+        AVS_LOG_FIELD_STR("quoted", "a \"b\"\n"),
+        AVS_LOG_FIELD_STR("empty", ""),
+        AVS_LOG_FIELD_STR("null", NULL),
+        AVS_LOG_FIELD_I64("min", INT64_MIN),
+        AVS_LOG_FIELD_U64("max", UINT64_MAX),
+        AVS_LOG_FIELD_DOUBLE("nan", NAN),
+        AVS_LOG_FIELD_BOOL("flag", false)
+    };
+    const avs_log_record_t record = {
+        .level = AVS_LOG_DEBUG,
+        .module = "test",
+        .file = "file.c",
+        .line = 7,
+        .message = "tab\there",
+        .fields = fields,
+        .field_count = AVS_ARRAY_SIZE(fields)
+    };
+    char buf[512];
+
+    static const char EXPECTED_LOGFMT[] =
+            "level=DEBUG module=test file=file.c line=7 msg=\"tab\\there\" "
+            "quoted=\"a \\\"b\\\"\\n\" empty=\"\" null=null "
+            "min=-9223372036854775808 max=18446744073709551615 nan=nan "
+            "flag=false";
+    AVS_UNIT_ASSERT_EQUAL(avs_log_record_to_logfmt(buf, sizeof(buf), &record),
+                          sizeof(EXPECTED_LOGFMT) - 1);
+    AVS_UNIT_ASSERT_EQUAL_STRING(buf, EXPECTED_LOGFMT);
+
+    static const char EXPECTED_JSON[] =
+            "{\"level\":\"DEBUG\",\"module\":\"test\",\"file\":\"file.c\","
+            "\"line\":7,\"msg\":\"tab\\there\",\"quoted\":\"a \\\"b\\\"\\n\","
+            "\"empty\":\"\",\"null\":null,\"min\":-9223372036854775808,"
+            "\"max\":18446744073709551615,\"nan\":null,\"flag\":false}";
+    AVS_UNIT_ASSERT_EQUAL(avs_log_record_to_json(buf, sizeof(buf), &record),
+                          sizeof(EXPECTED_JSON) - 1);
+    AVS_UNIT_ASSERT_EQUAL_STRING(buf, EXPECTED_JSON);
+
+    /* truncated output is still null-terminated */
+    AVS_UNIT_ASSERT_TRUE(avs_log_record_to_json(buf, 10, &record) < 0);
+    AVS_UNIT_ASSERT_EQUAL_STRING(buf, "{\"level\":");
+}
+#endif // AVS_COMMONS_LOG_WITH_STRUCTURED
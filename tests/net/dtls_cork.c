@@ -0,0 +1,175 @@
+/*
+ * Copyright 2021 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdarg.h>
+
+#include <avsystem/commons/avs_unit_test.h>
+
+/* datagrams sent by the backend socket may carry up to 100 bytes of payload */
+#define TEST_MTU (100 + 28)
+
+typedef struct {
+    avs_net_socket_t *backend;
+    avs_net_socket_t *peer;
+    _avs_net_dtls_cork_t cork;
+} cork_env_t;
+
+static void setup_env(cork_env_t *env) {
+    memset(env, 0, sizeof(*env));
+    avs_net_socket_configuration_t config = {
+        .address_family = AVS_NET_AF_INET4
+    };
+    char port[NET_PORT_SIZE];
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_udp_socket_create(&env->peer, &config));
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_bind(env->peer, "127.0.0.1", "0"));
+    AVS_UNIT_ASSERT_SUCCESS(
+            avs_net_socket_get_local_port(env->peer, port, sizeof(port)));
+    avs_net_socket_opt_value_t timeout = {
+        .recv_timeout = avs_time_duration_from_scalar(100, AVS_TIME_MS)
+    };
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_set_opt(
+            env->peer, AVS_NET_SOCKET_OPT_RECV_TIMEOUT, timeout));
+
+    config.forced_mtu = TEST_MTU;
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_udp_socket_create(&env->backend, &config));
+    AVS_UNIT_ASSERT_SUCCESS(
+            avs_net_socket_connect(env->backend, "127.0.0.1", port));
+}
+
+static void teardown_env(cork_env_t *env) {
+    _avs_net_dtls_cork_release(&env->cork);
+    avs_net_socket_cleanup(&env->backend);
+    avs_net_socket_cleanup(&env->peer);
+}
+
+static void write_record(cork_env_t *env, char fill, size_t size) {
+    char record[256];
+    AVS_UNIT_ASSERT_TRUE(size <= sizeof(record));
+    memset(record, fill, size);
+    AVS_UNIT_ASSERT_SUCCESS(
+            _avs_net_dtls_cork_write(&env->cork, env->backend, record, size));
+}
+
+/* asserts that the next datagram consists of the given records, i.e. pairs of
+ * fill byte and size terminated with a zero fill byte */
+static void expect_datagram(cork_env_t *env, ...) {
+    char datagram[256];
+    size_t received;
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_receive(env->peer, &received,
+                                                   datagram, sizeof(datagram)));
+    va_list records;
+    va_start(records, env);
+    size_t offset = 0;
+    int fill;
+    while ((fill = va_arg(records, int))) {
+        size_t size = va_arg(records, size_t);
+        AVS_UNIT_ASSERT_TRUE(offset + size <= received);
+        for (size_t i = 0; i < size; ++i) {
+            AVS_UNIT_ASSERT_EQUAL(datagram[offset + i], (char) fill);
+        }
+        offset += size;
+    }
+    va_end(records);
+    AVS_UNIT_ASSERT_EQUAL(offset, received);
+}
+
+static void expect_no_datagram(cork_env_t *env) {
+    char datagram[256];
+    size_t received;
+    avs_error_t err = avs_net_socket_receive(env->peer, &received, datagram,
+                                             sizeof(datagram));
+    AVS_UNIT_ASSERT_TRUE(err.category == AVS_ERRNO_CATEGORY
+                         && err.code == AVS_ETIMEDOUT);
+}
+
+AVS_UNIT_TEST(dtls_cork, not_batching) {
+    cork_env_t env;
+    setup_env(&env);
+    env.cork.enabled = true;
+    write_record(&env, 'a', 10);
+    write_record(&env, 'b', 20);
+    expect_datagram(&env, 'a', (size_t) 10, 0);
+    expect_datagram(&env, 'b', (size_t) 20, 0);
+    AVS_UNIT_ASSERT_NULL(env.cork.buffer);
+    teardown_env(&env);
+}
+
+AVS_UNIT_TEST(dtls_cork, records_packed_up_to_mtu) {
+    cork_env_t env;
+    setup_env(&env);
+    env.cork.enabled = true;
+    env.cork.batching = true;
+    write_record(&env, 'a', 30);
+    write_record(&env, 'b', 30);
+    write_record(&env, 'c', 40);
+    expect_no_datagram(&env);
+
+    /* does not fit in the 100-byte datagram */
+    write_record(&env, 'd', 1);
+    expect_datagram(&env, 'a', (size_t) 30, 'b', (size_t) 30, 'c', (size_t) 40,
+                    0);
+    write_record(&env, 'e', 50);
+    expect_no_datagram(&env);
+
+    AVS_UNIT_ASSERT_SUCCESS(_avs_net_dtls_cork_flush(&env.cork, env.backend));
+    expect_datagram(&env, 'd', (size_t) 1, 'e', (size_t) 50, 0);
+    AVS_UNIT_ASSERT_EQUAL(env.cork.size, 0);
+
+    /* nothing to flush */
+    AVS_UNIT_ASSERT_SUCCESS(_avs_net_dtls_cork_flush(&env.cork, env.backend));
+    expect_no_datagram(&env);
+    teardown_env(&env);
+}
+
+AVS_UNIT_TEST(dtls_cork, other_data_sent_after_pending_records) {
+    cork_env_t env;
+    setup_env(&env);
+    env.cork.enabled = true;
+    env.cork.batching = true;
+    write_record(&env, 'a', 10);
+    write_record(&env, 'b', 10);
+    env.cork.batching = false;
+    write_record(&env, 'c', 10);
+    expect_datagram(&env, 'a', (size_t) 10, 'b', (size_t) 10, 0);
+    expect_datagram(&env, 'c', (size_t) 10, 0);
+    teardown_env(&env);
+}
+
+AVS_UNIT_TEST(dtls_cork, large_record_not_buffered) {
+    cork_env_t env;
+    setup_env(&env);
+    env.cork.enabled = true;
+    env.cork.batching = true;
+    write_record(&env, 'a', 10);
+    write_record(&env, 'b', 100);
+    expect_datagram(&env, 'a', (size_t) 10, 0);
+    expect_datagram(&env, 'b', (size_t) 100, 0);
+    AVS_UNIT_ASSERT_EQUAL(env.cork.size, 0);
+    teardown_env(&env);
+}
+
+AVS_UNIT_TEST(dtls_cork, release_discards_pending_records) {
+    cork_env_t env;
+    setup_env(&env);
+    env.cork.enabled = true;
+    env.cork.batching = true;
+    write_record(&env, 'a', 10);
+    _avs_net_dtls_cork_release(&env.cork);
+    AVS_UNIT_ASSERT_TRUE(env.cork.enabled);
+    AVS_UNIT_ASSERT_SUCCESS(_avs_net_dtls_cork_flush(&env.cork, env.backend));
+    expect_no_datagram(&env);
+    teardown_env(&env);
+}
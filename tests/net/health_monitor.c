@@ -0,0 +1,273 @@
+/*
+ * Copyright 2021 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define _GNU_SOURCE // for RTLD_NEXT
+#include <avs_commons_posix_init.h>
+
+#include <string.h>
+#include <time.h>
+
+#include <dlfcn.h>
+
+#include <avsystem/commons/avs_log.h>
+#include <avsystem/commons/avs_net_health_monitor.h>
+#include <avsystem/commons/avs_sched.h>
+#include <avsystem/commons/avs_socket.h>
+#include <avsystem/commons/avs_unit_test.h>
+
+#if defined(AVS_COMMONS_NET_WITH_HEALTH_MONITOR) \
+        && defined(AVS_COMMONS_NET_WITH_IPV4)
+
+static avs_time_monotonic_t MOCK_CLOCK = { { 0, -1 } };
+
+static void mock_clock_start(const avs_time_monotonic_t t) {
+    MOCK_CLOCK = AVS_TIME_MONOTONIC_INVALID;
+    AVS_UNIT_ASSERT_TRUE(avs_time_monotonic_valid(t));
+    MOCK_CLOCK = t;
+}
+
+static void mock_clock_advance(const avs_time_duration_t t) {
+    AVS_UNIT_ASSERT_TRUE(avs_time_monotonic_valid(MOCK_CLOCK));
+    AVS_UNIT_ASSERT_TRUE(avs_time_duration_valid(t));
+    MOCK_CLOCK = avs_time_monotonic_add(MOCK_CLOCK, t);
+}
+
+static void mock_clock_finish(void) {
+    AVS_UNIT_ASSERT_TRUE(avs_time_monotonic_valid(MOCK_CLOCK));
+}
+
+static int (*orig_clock_gettime)(clockid_t, struct timespec *);
+
+int clock_gettime(clockid_t clock, struct timespec *t) {
+    if (avs_time_monotonic_valid(MOCK_CLOCK)) {
+        // all clocks are equivalent for our purposes, so ignore clock
+        t->tv_sec = (time_t) MOCK_CLOCK.since_monotonic_epoch.seconds;
+        t->tv_nsec = MOCK_CLOCK.since_monotonic_epoch.nanoseconds;
+        MOCK_CLOCK = avs_time_monotonic_add(
+                MOCK_CLOCK, avs_time_duration_from_scalar(1, AVS_TIME_NS));
+        return 0;
+    } else {
+        return orig_clock_gettime(clock, t);
+    }
+}
+
+AVS_UNIT_GLOBAL_INIT(verbose) {
+    if (!verbose) {
+        avs_log_set_default_level(AVS_LOG_QUIET);
+    }
+    typedef int (*clock_gettime_t)(clockid_t, struct timespec *);
+    orig_clock_gettime =
+            (clock_gettime_t) (intptr_t) dlsym(RTLD_NEXT, "clock_gettime");
+}
+
+typedef struct {
+    avs_sched_t *sched;
+    avs_net_socket_t *socket;
+    avs_net_socket_t *peer;
+    avs_net_health_monitor_t *monitor;
+    unsigned heartbeats;
+    avs_error_t heartbeat_result;
+    unsigned dead_events;
+    unsigned alive_events;
+} health_env_t;
+
+static avs_error_t send_heartbeat(avs_net_socket_t *socket, void *env_) {
+    health_env_t *env = (health_env_t *) env_;
+    AVS_UNIT_ASSERT_TRUE(socket == env->socket);
+    ++env->heartbeats;
+    return env->heartbeat_result;
+}
+
+static void on_event(avs_net_health_monitor_t *monitor,
+                     avs_net_health_event_t event,
+                     void *env_) {
+    health_env_t *env = (health_env_t *) env_;
+    AVS_UNIT_ASSERT_TRUE(monitor == env->monitor);
+    if (event == AVS_NET_HEALTH_PEER_DEAD) {
+        ++env->dead_events;
+    } else {
+        ++env->alive_events;
+    }
+}
+
+static void setup_env(health_env_t *env,
+                      int64_t idle_interval_ms,
+                      int64_t response_timeout_ms,
+                      unsigned max_missed_heartbeats) {
+    memset(env, 0, sizeof(*env));
+    mock_clock_start(avs_time_monotonic_from_scalar(1000, AVS_TIME_S));
+    env->sched = avs_sched_new("health", NULL);
+    AVS_UNIT_ASSERT_NOT_NULL(env->sched);
+
+    avs_net_socket_configuration_t socket_config = {
+        .address_family = AVS_NET_AF_INET4
+    };
+    char port[16];
+    AVS_UNIT_ASSERT_SUCCESS(
+            avs_net_udp_socket_create(&env->peer, &socket_config));
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_bind(env->peer, "127.0.0.1", "0"));
+    AVS_UNIT_ASSERT_SUCCESS(
+            avs_net_socket_get_local_port(env->peer, port, sizeof(port)));
+    AVS_UNIT_ASSERT_SUCCESS(
+            avs_net_udp_socket_create(&env->socket, &socket_config));
+    AVS_UNIT_ASSERT_SUCCESS(
+            avs_net_socket_connect(env->socket, "127.0.0.1", port));
+    AVS_UNIT_ASSERT_SUCCESS(
+            avs_net_socket_get_local_port(env->socket, port, sizeof(port)));
+    AVS_UNIT_ASSERT_SUCCESS(
+            avs_net_socket_connect(env->peer, "127.0.0.1", port));
+
+    avs_net_health_monitor_config_t config = {
+        .idle_interval =
+                avs_time_duration_from_scalar(idle_interval_ms, AVS_TIME_MS),
+        .response_timeout = avs_time_duration_from_scalar(response_timeout_ms,
+                                                          AVS_TIME_MS),
+        .max_missed_heartbeats = max_missed_heartbeats,
+        .send_heartbeat = send_heartbeat,
+        .on_event = on_event,
+        .user_data = env
+    };
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_health_monitor_create(
+            &env->monitor, env->sched, env->socket, &config));
+}
+
+static void teardown_env(health_env_t *env) {
+    avs_net_health_monitor_cleanup(&env->monitor);
+    AVS_UNIT_ASSERT_NULL(env->monitor);
+    avs_sched_cleanup(&env->sched);
+    avs_net_socket_cleanup(&env->socket);
+    avs_net_socket_cleanup(&env->peer);
+    mock_clock_finish();
+    MOCK_CLOCK = AVS_TIME_MONOTONIC_INVALID;
+}
+
+/**
+ * Runs the scheduler until @p ms milliseconds pass on the mock clock, moving
+ * the clock directly to the instants at which the jobs are due.
+ */
+static void run_sched_for(health_env_t *env, int64_t ms) {
+    const avs_time_monotonic_t deadline = avs_time_monotonic_add(
+            MOCK_CLOCK, avs_time_duration_from_scalar(ms, AVS_TIME_MS));
+    avs_sched_run(env->sched);
+    avs_time_monotonic_t next;
+    while (avs_time_monotonic_valid(
+                   (next = avs_sched_time_of_next(env->sched)))
+           && avs_time_monotonic_before(next, deadline)) {
+        if (avs_time_monotonic_before(MOCK_CLOCK, next)) {
+            mock_clock_advance(avs_time_monotonic_diff(next, MOCK_CLOCK));
+        }
+        avs_sched_run(env->sched);
+    }
+    if (avs_time_monotonic_before(MOCK_CLOCK, deadline)) {
+        mock_clock_advance(avs_time_monotonic_diff(deadline, MOCK_CLOCK));
+    }
+    avs_sched_run(env->sched);
+}
+
+AVS_UNIT_TEST(health_monitor, invalid_config) {
+    avs_sched_t *sched = avs_sched_new("health", NULL);
+    AVS_UNIT_ASSERT_NOT_NULL(sched);
+    avs_net_socket_t *socket = NULL;
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_udp_socket_create(&socket, NULL));
+
+    avs_net_health_monitor_t *monitor = NULL;
+    avs_net_health_monitor_config_t config = { 0 };
+    avs_error_t err =
+            avs_net_health_monitor_create(&monitor, sched, socket, &config);
+    AVS_UNIT_ASSERT_EQUAL(err.category, AVS_ERRNO_CATEGORY);
+    AVS_UNIT_ASSERT_EQUAL(err.code, AVS_EINVAL);
+    AVS_UNIT_ASSERT_NULL(monitor);
+
+    avs_net_socket_cleanup(&socket);
+    avs_sched_cleanup(&sched);
+}
+
+AVS_UNIT_TEST(health_monitor, heartbeat_after_idle_interval) {
+    health_env_t env;
+    setup_env(&env, 50, 1000, 3);
+
+    run_sched_for(&env, 20);
+    AVS_UNIT_ASSERT_EQUAL(env.heartbeats, 0);
+    run_sched_for(&env, 60);
+    AVS_UNIT_ASSERT_EQUAL(env.heartbeats, 1);
+
+    avs_net_health_monitor_heartbeat_acked(env.monitor);
+    avs_net_health_monitor_stats_t stats;
+    avs_net_health_monitor_get_stats(env.monitor, &stats);
+    AVS_UNIT_ASSERT_EQUAL(stats.heartbeats_sent, 1);
+    AVS_UNIT_ASSERT_EQUAL(stats.heartbeats_missed, 0);
+    AVS_UNIT_ASSERT_FALSE(stats.peer_dead);
+    AVS_UNIT_ASSERT_TRUE(avs_time_duration_valid(stats.last_rtt));
+    AVS_UNIT_ASSERT_TRUE(
+            avs_time_duration_equal(stats.smoothed_rtt, stats.last_rtt));
+    AVS_UNIT_ASSERT_TRUE(avs_time_duration_equal(
+            stats.rtt_variation, avs_time_duration_div(stats.last_rtt, 2)));
+
+    // acknowledged heartbeat resets the idle interval
+    run_sched_for(&env, 20);
+    AVS_UNIT_ASSERT_EQUAL(env.heartbeats, 1);
+    AVS_UNIT_ASSERT_EQUAL(env.dead_events, 0);
+    teardown_env(&env);
+}
+
+AVS_UNIT_TEST(health_monitor, received_data_counts_as_activity) {
+    health_env_t env;
+    setup_env(&env, 100, 1000, 3);
+
+    for (int i = 0; i < 15; ++i) {
+        char buffer[8];
+        size_t received;
+        AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_send(env.peer, "ping", 4));
+        AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_receive(
+                env.socket, &received, buffer, sizeof(buffer)));
+        run_sched_for(&env, 20);
+    }
+    AVS_UNIT_ASSERT_EQUAL(env.heartbeats, 0);
+    teardown_env(&env);
+}
+
+AVS_UNIT_TEST(health_monitor, peer_dead_after_missed_heartbeats) {
+    health_env_t env;
+    setup_env(&env, 20, 50, 2);
+    env.heartbeat_result = avs_errno(AVS_ECONNREFUSED);
+
+    run_sched_for(&env, 200);
+    AVS_UNIT_ASSERT_EQUAL(env.heartbeats, 2);
+    AVS_UNIT_ASSERT_EQUAL(env.dead_events, 1);
+    avs_net_health_monitor_stats_t stats;
+    avs_net_health_monitor_get_stats(env.monitor, &stats);
+    AVS_UNIT_ASSERT_TRUE(stats.peer_dead);
+    AVS_UNIT_ASSERT_EQUAL(stats.heartbeats_sent, 2);
+    AVS_UNIT_ASSERT_EQUAL(stats.heartbeats_missed, 2);
+    AVS_UNIT_ASSERT_FALSE(avs_time_duration_valid(stats.smoothed_rtt));
+
+    // no heartbeats are sent to a dead peer
+    run_sched_for(&env, 60);
+    AVS_UNIT_ASSERT_EQUAL(env.heartbeats, 2);
+
+    avs_net_health_monitor_activity(env.monitor);
+    AVS_UNIT_ASSERT_EQUAL(env.alive_events, 1);
+    avs_net_health_monitor_get_stats(env.monitor, &stats);
+    AVS_UNIT_ASSERT_FALSE(stats.peer_dead);
+
+    // monitoring resumed
+    run_sched_for(&env, 45);
+    AVS_UNIT_ASSERT_EQUAL(env.heartbeats, 3);
+    teardown_env(&env);
+}
+
+#endif // defined(AVS_COMMONS_NET_WITH_HEALTH_MONITOR) &&
+       // defined(AVS_COMMONS_NET_WITH_IPV4)
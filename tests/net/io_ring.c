@@ -0,0 +1,278 @@
+/*
+ * Copyright 2021 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define _AVS_NEED_POSIX_SOCKET
+
+#include <avs_commons_posix_init.h>
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <avsystem/commons/avs_io_ring.h>
+#include <avsystem/commons/avs_socket.h>
+#include <avsystem/commons/avs_unit_test.h>
+#include <avsystem/commons/avs_utils.h>
+
+#if defined(AVS_COMMONS_NET_WITH_IO_RING) && defined(AVS_COMMONS_NET_WITH_IPV4)
+
+typedef struct {
+    int calls;
+    avs_error_t err;
+    size_t result;
+} completion_t;
+
+static void on_complete(void *completion_, avs_error_t err, size_t result) {
+    completion_t *completion = (completion_t *) completion_;
+    ++completion->calls;
+    completion->err = err;
+    completion->result = result;
+}
+
+static void wait_for(avs_io_ring_t *ring, const completion_t *completion) {
+    avs_time_monotonic_t deadline = avs_time_monotonic_add(
+            avs_time_monotonic_now(),
+            avs_time_duration_from_scalar(5, AVS_TIME_S));
+    while (!completion->calls) {
+        AVS_UNIT_ASSERT_SUCCESS(avs_io_ring_wait(ring, deadline));
+    }
+    AVS_UNIT_ASSERT_EQUAL(completion->calls, 1);
+}
+
+static bool is_errno(avs_error_t err, avs_errno_t code) {
+    return err.category == AVS_ERRNO_CATEGORY && err.code == code;
+}
+
+static avs_io_ring_t *create_ring(bool disable_io_uring, size_t queue_size) {
+    avs_io_ring_t *ring = NULL;
+    avs_io_ring_config_t config = {
+        .queue_size = queue_size,
+        .disable_io_uring = disable_io_uring
+    };
+    AVS_UNIT_ASSERT_SUCCESS(avs_io_ring_create(&ring, &config));
+    AVS_UNIT_ASSERT_NOT_NULL(ring);
+    if (disable_io_uring) {
+        AVS_UNIT_ASSERT_FALSE(avs_io_ring_is_native(ring));
+    }
+    return ring;
+}
+
+static void test_file_read_write(bool disable_io_uring) {
+    static const char DATA[] = "Hello, ring";
+    char path[] = "/tmp/avs_io_ring_XXXXXX";
+    int fd = mkstemp(path);
+    AVS_UNIT_ASSERT_TRUE(fd >= 0);
+    unlink(path);
+
+    avs_io_ring_t *ring = create_ring(disable_io_uring, 0);
+    char buf[64];
+    const avs_io_ring_buffer_t buffer = {
+        .buf = buf,
+        .size = sizeof(buf)
+    };
+    /* registration may fail due to RLIMIT_MEMLOCK, which is not an error */
+    avs_io_ring_register_buffers(ring, &buffer, 1);
+
+    completion_t write_completion = { 0 };
+    memcpy(buf, DATA, sizeof(DATA));
+    AVS_UNIT_ASSERT_SUCCESS(avs_io_ring_write(ring, fd, buf, sizeof(DATA), 16,
+                                              on_complete, &write_completion));
+    AVS_UNIT_ASSERT_EQUAL(avs_io_ring_pending(ring), 1);
+    wait_for(ring, &write_completion);
+    AVS_UNIT_ASSERT_SUCCESS(write_completion.err);
+    AVS_UNIT_ASSERT_EQUAL(write_completion.result, sizeof(DATA));
+    AVS_UNIT_ASSERT_EQUAL(avs_io_ring_pending(ring), 0);
+
+    completion_t read_completion = { 0 };
+    memset(buf, 0, sizeof(buf));
+    AVS_UNIT_ASSERT_SUCCESS(avs_io_ring_read(ring, fd, buf, sizeof(buf), 16,
+                                             on_complete, &read_completion));
+    wait_for(ring, &read_completion);
+    AVS_UNIT_ASSERT_SUCCESS(read_completion.err);
+    AVS_UNIT_ASSERT_EQUAL(read_completion.result, sizeof(DATA));
+    AVS_UNIT_ASSERT_EQUAL_STRING(buf, DATA);
+
+    avs_io_ring_cleanup(&ring);
+    AVS_UNIT_ASSERT_NULL(ring);
+    close(fd);
+}
+
+AVS_UNIT_TEST(io_ring, file_read_write) {
+    test_file_read_write(false);
+    test_file_read_write(true);
+}
+
+static void test_tcp_loopback(bool disable_io_uring) {
+    static const char DATA[] = "Hello, loopback";
+    const avs_net_socket_configuration_t config = {
+        .address_family = AVS_NET_AF_INET4
+    };
+    avs_net_socket_t *listening = NULL;
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_tcp_socket_create(&listening, &config));
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_bind(listening, "127.0.0.1", "0"));
+    char port[16];
+    AVS_UNIT_ASSERT_SUCCESS(
+            avs_net_socket_get_local_port(listening, port, sizeof(port)));
+    const int *listening_fd =
+            (const int *) avs_net_socket_get_system(listening);
+    AVS_UNIT_ASSERT_NOT_NULL(listening_fd);
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t) atoi(port));
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    avs_net_resolved_endpoint_t endpoint;
+    endpoint.size = sizeof(addr);
+    memcpy(endpoint.data.buf, &addr, sizeof(addr));
+
+    int client_fd = socket(AF_INET, SOCK_STREAM, 0);
+    AVS_UNIT_ASSERT_TRUE(client_fd >= 0);
+    AVS_UNIT_ASSERT_SUCCESS(fcntl(client_fd, F_SETFL,
+                                  fcntl(client_fd, F_GETFL) | O_NONBLOCK));
+
+    avs_io_ring_t *ring = create_ring(disable_io_uring, 0);
+    completion_t accept_completion = { 0 };
+    completion_t connect_completion = { 0 };
+    AVS_UNIT_ASSERT_SUCCESS(avs_io_ring_accept(ring, *listening_fd,
+                                               on_complete,
+                                               &accept_completion));
+    AVS_UNIT_ASSERT_SUCCESS(avs_io_ring_connect(ring, client_fd, &endpoint,
+                                                on_complete,
+                                                &connect_completion));
+    AVS_UNIT_ASSERT_SUCCESS(avs_io_ring_submit(ring));
+    wait_for(ring, &connect_completion);
+    wait_for(ring, &accept_completion);
+    AVS_UNIT_ASSERT_SUCCESS(connect_completion.err);
+    AVS_UNIT_ASSERT_SUCCESS(accept_completion.err);
+    int server_fd = (int) accept_completion.result;
+
+    char buf[64];
+    completion_t send_completion = { 0 };
+    completion_t recv_completion = { 0 };
+    AVS_UNIT_ASSERT_SUCCESS(avs_io_ring_recv(ring, server_fd, buf, sizeof(buf),
+                                             on_complete, &recv_completion));
+    AVS_UNIT_ASSERT_SUCCESS(avs_io_ring_send(ring, client_fd, DATA,
+                                             sizeof(DATA), on_complete,
+                                             &send_completion));
+    wait_for(ring, &send_completion);
+    wait_for(ring, &recv_completion);
+    AVS_UNIT_ASSERT_SUCCESS(send_completion.err);
+    AVS_UNIT_ASSERT_EQUAL(send_completion.result, sizeof(DATA));
+    AVS_UNIT_ASSERT_SUCCESS(recv_completion.err);
+    AVS_UNIT_ASSERT_EQUAL(recv_completion.result, sizeof(DATA));
+    AVS_UNIT_ASSERT_EQUAL_STRING(buf, DATA);
+
+    /* end of stream is reported as a successful zero-length receive */
+    memset(&recv_completion, 0, sizeof(recv_completion));
+    AVS_UNIT_ASSERT_SUCCESS(avs_io_ring_recv(ring, server_fd, buf, sizeof(buf),
+                                             on_complete, &recv_completion));
+    close(client_fd);
+    wait_for(ring, &recv_completion);
+    AVS_UNIT_ASSERT_SUCCESS(recv_completion.err);
+    AVS_UNIT_ASSERT_EQUAL(recv_completion.result, 0);
+
+    avs_io_ring_cleanup(&ring);
+    close(server_fd);
+    avs_net_socket_cleanup(&listening);
+}
+
+AVS_UNIT_TEST(io_ring, tcp_loopback) {
+    test_tcp_loopback(false);
+    test_tcp_loopback(true);
+}
+
+static void test_timeout(bool disable_io_uring) {
+    int fds[2];
+    AVS_UNIT_ASSERT_SUCCESS(socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+    avs_io_ring_t *ring = create_ring(disable_io_uring, 0);
+
+    /* nothing in progress - returns immediately */
+    AVS_UNIT_ASSERT_SUCCESS(
+            avs_io_ring_wait(ring, AVS_TIME_MONOTONIC_INVALID));
+
+    char buf[16];
+    completion_t completion = { 0 };
+    AVS_UNIT_ASSERT_SUCCESS(avs_io_ring_recv(ring, fds[0], buf, sizeof(buf),
+                                             on_complete, &completion));
+    avs_time_monotonic_t deadline = avs_time_monotonic_add(
+            avs_time_monotonic_now(),
+            avs_time_duration_from_scalar(50, AVS_TIME_MS));
+    AVS_UNIT_ASSERT_TRUE(
+            is_errno(avs_io_ring_wait(ring, deadline), AVS_ETIMEDOUT));
+    AVS_UNIT_ASSERT_FALSE(avs_time_monotonic_before(avs_time_monotonic_now(),
+                                                    deadline));
+    AVS_UNIT_ASSERT_EQUAL(completion.calls, 0);
+
+    AVS_UNIT_ASSERT_EQUAL(write(fds[1], "x", 1), 1);
+    wait_for(ring, &completion);
+    AVS_UNIT_ASSERT_SUCCESS(completion.err);
+    AVS_UNIT_ASSERT_EQUAL(completion.result, 1);
+
+    avs_io_ring_cleanup(&ring);
+    close(fds[0]);
+    close(fds[1]);
+}
+
+AVS_UNIT_TEST(io_ring, timeout) {
+    test_timeout(false);
+    test_timeout(true);
+}
+
+AVS_UNIT_TEST(io_ring, queue_full) {
+    int fds[2];
+    AVS_UNIT_ASSERT_SUCCESS(socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+    avs_io_ring_t *ring = create_ring(true, 2);
+
+    char buf[3];
+    completion_t completions[3] = { { 0 } };
+    for (size_t i = 0; i < 2; ++i) {
+        AVS_UNIT_ASSERT_SUCCESS(avs_io_ring_recv(ring, fds[0], &buf[i], 1,
+                                                 on_complete, &completions[i]));
+    }
+    AVS_UNIT_ASSERT_TRUE(is_errno(avs_io_ring_recv(ring, fds[0], &buf[2], 1,
+                                                   on_complete,
+                                                   &completions[2]),
+                                  AVS_ENOBUFS));
+    AVS_UNIT_ASSERT_EQUAL(avs_io_ring_pending(ring), 2);
+
+    const avs_io_ring_buffer_t buffer = {
+        .buf = buf,
+        .size = sizeof(buf)
+    };
+    AVS_UNIT_ASSERT_TRUE(
+            is_errno(avs_io_ring_register_buffers(ring, &buffer, 1),
+                     AVS_EBUSY));
+
+    AVS_UNIT_ASSERT_EQUAL(write(fds[1], "ab", 2), 2);
+    while (avs_io_ring_pending(ring)) {
+        AVS_UNIT_ASSERT_SUCCESS(
+                avs_io_ring_wait(ring, AVS_TIME_MONOTONIC_INVALID));
+    }
+    AVS_UNIT_ASSERT_EQUAL(completions[0].calls, 1);
+    AVS_UNIT_ASSERT_EQUAL(completions[1].calls, 1);
+    AVS_UNIT_ASSERT_SUCCESS(completions[0].err);
+    AVS_UNIT_ASSERT_SUCCESS(completions[1].err);
+    AVS_UNIT_ASSERT_EQUAL(completions[2].calls, 0);
+
+    avs_io_ring_cleanup(&ring);
+    close(fds[0]);
+    close(fds[1]);
+}
+
+#endif // defined(AVS_COMMONS_NET_WITH_IO_RING) &&
+       // defined(AVS_COMMONS_NET_WITH_IPV4)
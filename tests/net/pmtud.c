@@ -0,0 +1,316 @@
+/*
+ * Copyright 2021 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <avsystem/commons/avs_unit_test.h>
+
+static const avs_time_monotonic_t T0 = { { 1000, 0 } };
+
+static avs_time_monotonic_t after_seconds(int64_t seconds) {
+    return avs_time_monotonic_add(T0, avs_time_duration_from_scalar(
+                                              seconds, AVS_TIME_S));
+}
+
+static void lose_probe(_avs_net_pmtud_t *pmtud) {
+    for (int i = 0; i < PMTUD_MAX_PROBES; ++i) {
+        _avs_net_pmtud_probe_lost(pmtud, T0);
+    }
+}
+
+/* drives the engine until completion over a path with the given MTU */
+static void run_search(_avs_net_pmtud_t *pmtud, int path_mtu) {
+    int probe_size;
+    int probes = 0;
+    while ((probe_size = _avs_net_pmtud_probe_size(pmtud, T0))) {
+        AVS_UNIT_ASSERT_TRUE(++probes < 100);
+        if (probe_size <= path_mtu) {
+            _avs_net_pmtud_probe_acked(pmtud, T0);
+        } else {
+            lose_probe(pmtud);
+        }
+    }
+}
+
+AVS_UNIT_TEST(pmtud, base_then_max) {
+    _avs_net_pmtud_t pmtud;
+    _avs_net_pmtud_init(&pmtud, 576, 1200, 1500);
+    AVS_UNIT_ASSERT_EQUAL(pmtud.state, _AVS_NET_PMTUD_BASE);
+    AVS_UNIT_ASSERT_EQUAL(pmtud.plpmtu, 1200);
+    AVS_UNIT_ASSERT_EQUAL(_avs_net_pmtud_probe_size(&pmtud, T0), 1200);
+
+    _avs_net_pmtud_probe_acked(&pmtud, T0);
+    AVS_UNIT_ASSERT_EQUAL(pmtud.state, _AVS_NET_PMTUD_SEARCHING);
+    AVS_UNIT_ASSERT_EQUAL(_avs_net_pmtud_probe_size(&pmtud, T0), 1500);
+
+    _avs_net_pmtud_probe_acked(&pmtud, T0);
+    AVS_UNIT_ASSERT_EQUAL(pmtud.state, _AVS_NET_PMTUD_SEARCH_COMPLETE);
+    AVS_UNIT_ASSERT_EQUAL(pmtud.plpmtu, 1500);
+    AVS_UNIT_ASSERT_EQUAL(_avs_net_pmtud_probe_size(&pmtud, T0), 0);
+
+    /* results reported without a probe in progress are ignored */
+    _avs_net_pmtud_probe_acked(&pmtud, T0);
+    _avs_net_pmtud_probe_lost(&pmtud, T0);
+    AVS_UNIT_ASSERT_EQUAL(pmtud.state, _AVS_NET_PMTUD_SEARCH_COMPLETE);
+    AVS_UNIT_ASSERT_EQUAL(pmtud.plpmtu, 1500);
+}
+
+AVS_UNIT_TEST(pmtud, bisection) {
+    static const int PATH_MTUS[] = { 1200, 1280, 1400, 1492, 4000, 8999 };
+    for (size_t i = 0; i < AVS_ARRAY_SIZE(PATH_MTUS); ++i) {
+        _avs_net_pmtud_t pmtud;
+        _avs_net_pmtud_init(&pmtud, 576, 1200, 9000);
+        run_search(&pmtud, PATH_MTUS[i]);
+        AVS_UNIT_ASSERT_EQUAL(pmtud.state, _AVS_NET_PMTUD_SEARCH_COMPLETE);
+        AVS_UNIT_ASSERT_TRUE(pmtud.plpmtu <= PATH_MTUS[i]);
+        AVS_UNIT_ASSERT_TRUE(pmtud.plpmtu
+                             >= PATH_MTUS[i] - PMTUD_SEARCH_PRECISION);
+    }
+}
+
+AVS_UNIT_TEST(pmtud, probe_retransmissions) {
+    _avs_net_pmtud_t pmtud;
+    _avs_net_pmtud_init(&pmtud, 576, 1200, 1500);
+    _avs_net_pmtud_probe_acked(&pmtud, T0);
+    for (int i = 1; i < PMTUD_MAX_PROBES; ++i) {
+        _avs_net_pmtud_probe_lost(&pmtud, T0);
+        AVS_UNIT_ASSERT_EQUAL(_avs_net_pmtud_probe_size(&pmtud, T0), 1500);
+    }
+    _avs_net_pmtud_probe_lost(&pmtud, T0);
+    AVS_UNIT_ASSERT_EQUAL(pmtud.failed_size, 1500);
+    AVS_UNIT_ASSERT_EQUAL(_avs_net_pmtud_probe_size(&pmtud, T0), 1350);
+}
+
+AVS_UNIT_TEST(pmtud, base_not_confirmed) {
+    _avs_net_pmtud_t pmtud;
+    _avs_net_pmtud_init(&pmtud, 576, 1200, 1500);
+    lose_probe(&pmtud);
+    AVS_UNIT_ASSERT_EQUAL(pmtud.state, _AVS_NET_PMTUD_ERROR);
+    AVS_UNIT_ASSERT_EQUAL(pmtud.plpmtu, 576);
+    /* BASE_PLPMTU keeps being probed */
+    lose_probe(&pmtud);
+    AVS_UNIT_ASSERT_EQUAL(pmtud.state, _AVS_NET_PMTUD_ERROR);
+    AVS_UNIT_ASSERT_EQUAL(_avs_net_pmtud_probe_size(&pmtud, T0), 1200);
+
+    _avs_net_pmtud_probe_acked(&pmtud, T0);
+    AVS_UNIT_ASSERT_EQUAL(pmtud.state, _AVS_NET_PMTUD_SEARCHING);
+    AVS_UNIT_ASSERT_EQUAL(pmtud.plpmtu, 1200);
+}
+
+AVS_UNIT_TEST(pmtud, packet_too_big) {
+    _avs_net_pmtud_t pmtud;
+    _avs_net_pmtud_init(&pmtud, 576, 1200, 9000);
+    _avs_net_pmtud_probe_acked(&pmtud, T0);
+    AVS_UNIT_ASSERT_EQUAL(_avs_net_pmtud_probe_size(&pmtud, T0), 9000);
+
+    /* bounds the search, so that no larger probes are sent */
+    _avs_net_pmtud_ptb_received(&pmtud, 1500, T0);
+    AVS_UNIT_ASSERT_EQUAL(pmtud.state, _AVS_NET_PMTUD_SEARCHING);
+    AVS_UNIT_ASSERT_EQUAL(_avs_net_pmtud_probe_size(&pmtud, T0), 1500);
+    run_search(&pmtud, 9000);
+    AVS_UNIT_ASSERT_EQUAL(pmtud.plpmtu, 1500);
+
+    /* smaller than MIN_PLPMTU, or not smaller than known sizes - ignored */
+    _avs_net_pmtud_ptb_received(&pmtud, 500, T0);
+    _avs_net_pmtud_ptb_received(&pmtud, 1500, T0);
+    AVS_UNIT_ASSERT_EQUAL(pmtud.plpmtu, 1500);
+
+    /* lowers the PLPMTU without further probing */
+    _avs_net_pmtud_ptb_received(&pmtud, 1000, T0);
+    AVS_UNIT_ASSERT_EQUAL(pmtud.state, _AVS_NET_PMTUD_SEARCH_COMPLETE);
+    AVS_UNIT_ASSERT_EQUAL(pmtud.plpmtu, 1000);
+    AVS_UNIT_ASSERT_EQUAL(_avs_net_pmtud_probe_size(&pmtud, T0), 0);
+
+    /* ...also if BASE_PLPMTU is not supported */
+    _avs_net_pmtud_init(&pmtud, 576, 1200, 9000);
+    _avs_net_pmtud_ptb_received(&pmtud, 1000, T0);
+    AVS_UNIT_ASSERT_EQUAL(pmtud.state, _AVS_NET_PMTUD_SEARCH_COMPLETE);
+    AVS_UNIT_ASSERT_EQUAL(pmtud.plpmtu, 1000);
+}
+
+AVS_UNIT_TEST(pmtud, raise_timer) {
+    _avs_net_pmtud_t pmtud;
+    _avs_net_pmtud_init(&pmtud, 576, 1200, 9000);
+    run_search(&pmtud, 1500);
+    int plpmtu = pmtud.plpmtu;
+    AVS_UNIT_ASSERT_EQUAL(_avs_net_pmtud_probe_size(&pmtud, after_seconds(599)),
+                          0);
+
+    int probe_size = _avs_net_pmtud_probe_size(&pmtud, after_seconds(600));
+    AVS_UNIT_ASSERT_EQUAL(pmtud.state, _AVS_NET_PMTUD_SEARCHING);
+    AVS_UNIT_ASSERT_EQUAL(probe_size, 9000);
+    AVS_UNIT_ASSERT_EQUAL(pmtud.plpmtu, plpmtu);
+    run_search(&pmtud, 9000);
+    AVS_UNIT_ASSERT_EQUAL(pmtud.plpmtu, 9000);
+    /* no point in searching if the maximum has already been reached */
+    AVS_UNIT_ASSERT_EQUAL(
+            _avs_net_pmtud_probe_size(&pmtud, after_seconds(3600)), 0);
+}
+
+AVS_UNIT_TEST(pmtud, init_and_restore) {
+    _avs_net_pmtud_t pmtud;
+    _avs_net_pmtud_init(&pmtud, 576, 1200, 1000);
+    AVS_UNIT_ASSERT_EQUAL(pmtud.base_plpmtu, 1000);
+    AVS_UNIT_ASSERT_EQUAL(pmtud.max_plpmtu, 1000);
+    _avs_net_pmtud_init(&pmtud, 1280, 1280, 1000);
+    AVS_UNIT_ASSERT_EQUAL(pmtud.base_plpmtu, 1280);
+    AVS_UNIT_ASSERT_EQUAL(pmtud.max_plpmtu, 1280);
+
+    _avs_net_pmtud_init(&pmtud, 576, 1200, 1500);
+    _avs_net_pmtud_restore(&pmtud, 9000, T0);
+    _avs_net_pmtud_restore(&pmtud, 500, T0);
+    AVS_UNIT_ASSERT_EQUAL(pmtud.state, _AVS_NET_PMTUD_BASE);
+    _avs_net_pmtud_restore(&pmtud, 1400, T0);
+    AVS_UNIT_ASSERT_EQUAL(pmtud.state, _AVS_NET_PMTUD_SEARCH_COMPLETE);
+    AVS_UNIT_ASSERT_EQUAL(pmtud.plpmtu, 1400);
+    AVS_UNIT_ASSERT_EQUAL(_avs_net_pmtud_probe_size(&pmtud, T0), 0);
+    AVS_UNIT_ASSERT_EQUAL(_avs_net_pmtud_probe_size(&pmtud, after_seconds(600)),
+                          1500);
+}
+
+static avs_net_resolved_endpoint_t make_endpoint(uint8_t id) {
+    avs_net_resolved_endpoint_t endpoint;
+    memset(&endpoint, 0, sizeof(endpoint));
+    endpoint.size = 4;
+    endpoint.data.buf[3] = (char) id;
+    return endpoint;
+}
+
+AVS_UNIT_TEST(pmtud, cache) {
+    avs_net_path_mtu_cache_t *cache = NULL;
+    AVS_UNIT_ASSERT_FAILED(avs_net_path_mtu_cache_create(&cache, 0));
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_path_mtu_cache_create(&cache, 2));
+
+    avs_net_resolved_endpoint_t a = make_endpoint(1);
+    avs_net_resolved_endpoint_t b = make_endpoint(2);
+    avs_net_resolved_endpoint_t c = make_endpoint(3);
+    int plpmtu;
+    avs_time_monotonic_t validated_at;
+    AVS_UNIT_ASSERT_FALSE(
+            _avs_net_path_mtu_cache_lookup(cache, &a, &plpmtu, &validated_at));
+
+    _avs_net_path_mtu_cache_store(cache, &a, 1500, T0);
+    _avs_net_path_mtu_cache_store(cache, &b, 1400, T0);
+    _avs_net_path_mtu_cache_store(cache, &a, 1450, after_seconds(1));
+    AVS_UNIT_ASSERT_TRUE(
+            _avs_net_path_mtu_cache_lookup(cache, &a, &plpmtu, &validated_at));
+    AVS_UNIT_ASSERT_EQUAL(plpmtu, 1450);
+    AVS_UNIT_ASSERT_TRUE(
+            avs_time_monotonic_equal(validated_at, after_seconds(1)));
+
+    /* b is the least recently used one */
+    _avs_net_path_mtu_cache_store(cache, &c, 1300, T0);
+    AVS_UNIT_ASSERT_FALSE(
+            _avs_net_path_mtu_cache_lookup(cache, &b, &plpmtu, &validated_at));
+    AVS_UNIT_ASSERT_TRUE(
+            _avs_net_path_mtu_cache_lookup(cache, &a, &plpmtu, &validated_at));
+    AVS_UNIT_ASSERT_TRUE(
+            _avs_net_path_mtu_cache_lookup(cache, &c, &plpmtu, &validated_at));
+    AVS_UNIT_ASSERT_EQUAL(plpmtu, 1300);
+
+    avs_net_path_mtu_cache_cleanup(&cache);
+    AVS_UNIT_ASSERT_NULL(cache);
+}
+
+#if defined(AVS_COMMONS_NET_WITH_POSIX_AVS_SOCKET) \
+        && defined(AVS_COMMONS_NET_WITH_IPV4)
+static int get_mtu_opt(avs_net_socket_t *socket, avs_net_socket_opt_key_t key) {
+    avs_net_socket_opt_value_t value;
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_get_opt(socket, key, &value));
+    return value.mtu;
+}
+
+static void connect_client(avs_net_socket_t **out_client,
+                           const avs_net_socket_configuration_t *config,
+                           avs_net_socket_t *server) {
+    char port[16];
+    AVS_UNIT_ASSERT_SUCCESS(
+            avs_net_socket_get_local_port(server, port, sizeof(port)));
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_udp_socket_create(out_client, config));
+    AVS_UNIT_ASSERT_SUCCESS(
+            avs_net_socket_connect(*out_client, "127.0.0.1", port));
+}
+
+AVS_UNIT_TEST(pmtud, loopback_socket) {
+    static char buf[UINT16_MAX];
+    avs_net_socket_configuration_t config;
+    memset(&config, 0, sizeof(config));
+    config.address_family = AVS_NET_AF_INET4;
+
+    avs_net_socket_t *server = NULL;
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_udp_socket_create(&server, &config));
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_bind(server, "127.0.0.1", "0"));
+
+    avs_net_socket_t *client = NULL;
+    avs_net_socket_opt_value_t value;
+    connect_client(&client, &config, server);
+    AVS_UNIT_ASSERT_FAILED(avs_net_socket_get_opt(
+            client, AVS_NET_SOCKET_OPT_PMTU_PROBE_SIZE, &value));
+    avs_net_socket_cleanup(&client);
+
+    config.path_mtu_discovery = true;
+    AVS_UNIT_ASSERT_SUCCESS(
+            avs_net_path_mtu_cache_create(&config.path_mtu_cache, 4));
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_udp_socket_create(&client, &config));
+    AVS_UNIT_ASSERT_FAILED(avs_net_socket_get_opt(
+            client, AVS_NET_SOCKET_OPT_PMTU_PROBE_SIZE, &value));
+    avs_net_socket_cleanup(&client);
+
+    connect_client(&client, &config, server);
+    /* BASE_PLPMTU minus IPv4 and UDP headers */
+    AVS_UNIT_ASSERT_EQUAL(get_mtu_opt(client, AVS_NET_SOCKET_OPT_MTU), 1200);
+    AVS_UNIT_ASSERT_EQUAL(get_mtu_opt(client, AVS_NET_SOCKET_OPT_INNER_MTU),
+                          1172);
+
+    int probe_size;
+    int last_probe_size = 0;
+    while ((probe_size = get_mtu_opt(client,
+                                     AVS_NET_SOCKET_OPT_PMTU_PROBE_SIZE))) {
+        AVS_UNIT_ASSERT_TRUE(probe_size > last_probe_size);
+        AVS_UNIT_ASSERT_TRUE(probe_size <= (int) sizeof(buf));
+        AVS_UNIT_ASSERT_SUCCESS(
+                avs_net_socket_send(client, buf, (size_t) probe_size));
+        size_t received;
+        AVS_UNIT_ASSERT_SUCCESS(
+                avs_net_socket_receive(server, &received, buf, sizeof(buf)));
+        AVS_UNIT_ASSERT_EQUAL(received, (size_t) probe_size);
+        value.flag = true;
+        AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_set_opt(
+                client, AVS_NET_SOCKET_OPT_PMTU_PROBE_RESULT, value));
+        last_probe_size = probe_size;
+    }
+    AVS_UNIT_ASSERT_EQUAL(get_mtu_opt(client, AVS_NET_SOCKET_OPT_INNER_MTU),
+                          last_probe_size);
+    avs_net_socket_cleanup(&client);
+
+    /* the discovered value is reused for the same host */
+    connect_client(&client, &config, server);
+    AVS_UNIT_ASSERT_EQUAL(get_mtu_opt(client, AVS_NET_SOCKET_OPT_INNER_MTU),
+                          last_probe_size);
+    AVS_UNIT_ASSERT_EQUAL(
+            get_mtu_opt(client, AVS_NET_SOCKET_OPT_PMTU_PROBE_SIZE), 0);
+    avs_net_socket_cleanup(&client);
+
+    /* forced MTU takes precedence */
+    config.forced_mtu = 1000;
+    connect_client(&client, &config, server);
+    AVS_UNIT_ASSERT_EQUAL(get_mtu_opt(client, AVS_NET_SOCKET_OPT_INNER_MTU),
+                          972);
+    avs_net_socket_cleanup(&client);
+
+    avs_net_socket_cleanup(&server);
+    avs_net_path_mtu_cache_cleanup(&config.path_mtu_cache);
+}
+#endif // defined(AVS_COMMONS_NET_WITH_POSIX_AVS_SOCKET) &&
+       // defined(AVS_COMMONS_NET_WITH_IPV4)
@@ -103,6 +103,19 @@ run_socket_set_opt_test_cases(avs_net_socket_t *socket,
             opt_val.bytes_received = 321;
             break;
         case AVS_NET_SOCKET_OPT_DANE_TLSA_ARRAY:
+        case AVS_NET_SOCKET_OPT_RATE_LIMIT_SEND_STATS:
+        case AVS_NET_SOCKET_OPT_RATE_LIMIT_RECEIVE_STATS:
+        case AVS_NET_SOCKET_OPT_PEER_CREDENTIALS:
+        case AVS_NET_SOCKET_OPT_MULTICAST_JOIN:
+        case AVS_NET_SOCKET_OPT_MULTICAST_LEAVE:
+        case AVS_NET_SOCKET_OPT_MULTICAST_TTL:
+        case AVS_NET_SOCKET_OPT_MULTICAST_LOOP:
+        case AVS_NET_SOCKET_OPT_RECV_PACKET_INFO:
+        case AVS_NET_SOCKET_OPT_LAST_PACKET_INFO:
+        case AVS_NET_SOCKET_OPT_SEND_PACKET_INFO:
+        case AVS_NET_SOCKET_OPT_PMTU_PROBE_SIZE:
+        case AVS_NET_SOCKET_OPT_PMTU_PROBE_RESULT:
+        case AVS_NET_SOCKET_OPT_CORK:
             AVS_UNREACHABLE("unsupported case");
         }
 
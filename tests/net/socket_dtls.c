@@ -127,3 +127,34 @@ AVS_UNIT_TEST(socket, dtls_set_opt_after_close) {
     AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_cleanup(&socket));
     cleanup_default_ssl_config(&config);
 }
+
+//// AVS_NET_SOCKET_OPT_CORK ///////////////////////////////////////////////////
+
+AVS_UNIT_TEST(socket, dtls_cork) {
+    avs_net_socket_t *socket = NULL;
+
+    avs_net_ssl_configuration_t config = create_default_ssl_config();
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_dtls_socket_create(&socket, &config));
+
+    avs_net_socket_opt_value_t value;
+    AVS_UNIT_ASSERT_SUCCESS(
+            avs_net_socket_get_opt(socket, AVS_NET_SOCKET_OPT_CORK, &value));
+    AVS_UNIT_ASSERT_FALSE(value.flag);
+
+    value.flag = true;
+    AVS_UNIT_ASSERT_SUCCESS(
+            avs_net_socket_set_opt(socket, AVS_NET_SOCKET_OPT_CORK, value));
+    AVS_UNIT_ASSERT_SUCCESS(
+            avs_net_socket_get_opt(socket, AVS_NET_SOCKET_OPT_CORK, &value));
+    AVS_UNIT_ASSERT_TRUE(value.flag);
+
+    value.flag = false;
+    AVS_UNIT_ASSERT_SUCCESS(
+            avs_net_socket_set_opt(socket, AVS_NET_SOCKET_OPT_CORK, value));
+    AVS_UNIT_ASSERT_SUCCESS(
+            avs_net_socket_get_opt(socket, AVS_NET_SOCKET_OPT_CORK, &value));
+    AVS_UNIT_ASSERT_FALSE(value.flag);
+
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_cleanup(&socket));
+    cleanup_default_ssl_config(&config);
+}
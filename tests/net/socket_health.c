@@ -0,0 +1,93 @@
+/*
+ * Copyright 2021 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define _AVS_NEED_POSIX_SOCKET
+
+#include <avs_commons_posix_init.h>
+
+#include <string.h>
+
+#include <avsystem/commons/avs_socket.h>
+#include <avsystem/commons/avs_unit_test.h>
+
+#if defined(AVS_COMMONS_NET_WITH_POSIX_AVS_SOCKET) \
+        && defined(AVS_COMMONS_NET_WITH_IPV4) && defined(__linux__)
+
+static int get_int_sockopt(avs_net_socket_t *socket, int level, int name) {
+    const int *fd = (const int *) avs_net_socket_get_system(socket);
+    AVS_UNIT_ASSERT_NOT_NULL(fd);
+    int value = -1;
+    socklen_t length = sizeof(value);
+    AVS_UNIT_ASSERT_EQUAL(getsockopt(*fd, level, name, &value, &length), 0);
+    return value;
+}
+
+AVS_UNIT_TEST(socket_health, tcp_keepalive_and_user_timeout) {
+    avs_net_socket_configuration_t config = {
+        .address_family = AVS_NET_AF_INET4,
+        .tcp_keepalive = {
+            .enabled = true,
+            .idle = avs_time_duration_from_scalar(1500, AVS_TIME_MS),
+            .interval = avs_time_duration_from_scalar(1, AVS_TIME_S),
+            .probe_count = 4
+        },
+        .tcp_user_timeout = avs_time_duration_from_scalar(2500, AVS_TIME_US)
+    };
+    avs_net_socket_t *socket = NULL;
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_tcp_socket_create(&socket, &config));
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_bind(socket, "127.0.0.1", "0"));
+
+    AVS_UNIT_ASSERT_TRUE(get_int_sockopt(socket, SOL_SOCKET, SO_KEEPALIVE));
+    // values are rounded up
+    AVS_UNIT_ASSERT_EQUAL(get_int_sockopt(socket, IPPROTO_TCP, TCP_KEEPIDLE),
+                          2);
+    AVS_UNIT_ASSERT_EQUAL(get_int_sockopt(socket, IPPROTO_TCP, TCP_KEEPINTVL),
+                          1);
+    AVS_UNIT_ASSERT_EQUAL(get_int_sockopt(socket, IPPROTO_TCP, TCP_KEEPCNT),
+                          4);
+    AVS_UNIT_ASSERT_EQUAL(
+            get_int_sockopt(socket, IPPROTO_TCP, TCP_USER_TIMEOUT), 3);
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_cleanup(&socket));
+}
+
+AVS_UNIT_TEST(socket_health, tcp_keepalive_disabled_by_default) {
+    avs_net_socket_t *socket = NULL;
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_tcp_socket_create(&socket, NULL));
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_bind(socket, "127.0.0.1", "0"));
+    AVS_UNIT_ASSERT_FALSE(get_int_sockopt(socket, SOL_SOCKET, SO_KEEPALIVE));
+    AVS_UNIT_ASSERT_EQUAL(
+            get_int_sockopt(socket, IPPROTO_TCP, TCP_USER_TIMEOUT), 0);
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_cleanup(&socket));
+}
+
+AVS_UNIT_TEST(socket_health, tcp_keepalive_ignored_for_udp) {
+    avs_net_socket_configuration_t config = {
+        .address_family = AVS_NET_AF_INET4,
+        .tcp_keepalive = {
+            .enabled = true,
+            .idle = avs_time_duration_from_scalar(1, AVS_TIME_S)
+        },
+        .tcp_user_timeout = avs_time_duration_from_scalar(1, AVS_TIME_S)
+    };
+    avs_net_socket_t *socket = NULL;
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_udp_socket_create(&socket, &config));
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_bind(socket, "127.0.0.1", "0"));
+    AVS_UNIT_ASSERT_FALSE(get_int_sockopt(socket, SOL_SOCKET, SO_KEEPALIVE));
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_cleanup(&socket));
+}
+
+#endif // defined(AVS_COMMONS_NET_WITH_POSIX_AVS_SOCKET) &&
+       // defined(AVS_COMMONS_NET_WITH_IPV4) && defined(__linux__)
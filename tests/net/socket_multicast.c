@@ -0,0 +1,290 @@
+/*
+ * Copyright 2021 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <avs_commons_posix_init.h>
+
+#include <string.h>
+
+#include <avsystem/commons/avs_socket.h>
+#include <avsystem/commons/avs_unit_test.h>
+
+// These tests rely on the Linux loopback interface accepting the whole
+// 127.0.0.0/8 range and delivering multicast traffic.
+#if defined(__linux__) && defined(AVS_COMMONS_NET_WITH_IPV4) \
+        && defined(AVS_COMMONS_NET_POSIX_AVS_SOCKET_HAVE_RECVMSG)
+
+static const char GROUP[] = "239.255.42.99";
+
+static avs_net_socket_t *create_bound(avs_net_af_t family,
+                                      const char *address) {
+    avs_net_socket_configuration_t config;
+    memset(&config, 0, sizeof(config));
+    config.address_family = family;
+    avs_net_socket_t *socket = NULL;
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_udp_socket_create(&socket, &config));
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_bind(socket, address, "0"));
+    return socket;
+}
+
+static void receive_exactly(avs_net_socket_t *socket,
+                            const char *expected,
+                            char *out_host,
+                            size_t host_size) {
+    char buf[64];
+    char port[16];
+    size_t bytes_received;
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_receive_from(
+            socket, &bytes_received, buf, sizeof(buf), out_host, host_size,
+            port, sizeof(port)));
+    AVS_UNIT_ASSERT_EQUAL_BYTES_SIZED(buf, expected, bytes_received);
+}
+
+static avs_net_packet_info_t get_packet_info(avs_net_socket_t *socket,
+                                             avs_net_socket_opt_key_t key) {
+    avs_net_socket_opt_value_t value;
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_get_opt(socket, key, &value));
+    return value.packet_info;
+}
+
+static void test_reply_from_receiving_address(avs_net_af_t server_family,
+                                              const char *server_address) {
+    avs_net_socket_t *server = create_bound(server_family, server_address);
+    avs_net_socket_t *client = create_bound(AVS_NET_AF_INET4, "127.0.0.1");
+    char server_port[16];
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_get_local_port(
+            server, server_port, sizeof(server_port)));
+
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_set_opt(
+            server, AVS_NET_SOCKET_OPT_RECV_PACKET_INFO,
+            (avs_net_socket_opt_value_t) {
+                .flag = true
+            }));
+    avs_net_packet_info_t info =
+            get_packet_info(server, AVS_NET_SOCKET_OPT_LAST_PACKET_INFO);
+    AVS_UNIT_ASSERT_EQUAL_STRING(info.local_host, "");
+    AVS_UNIT_ASSERT_EQUAL_STRING(info.interface_name, "");
+
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_send_to(client, "ping", 4,
+                                                   "127.0.0.2", server_port));
+    char client_host[64];
+    receive_exactly(server, "ping", client_host, sizeof(client_host));
+    AVS_UNIT_ASSERT_EQUAL_STRING(client_host, "127.0.0.1");
+    info = get_packet_info(server, AVS_NET_SOCKET_OPT_LAST_PACKET_INFO);
+    AVS_UNIT_ASSERT_EQUAL_STRING(info.local_host, "127.0.0.2");
+    AVS_UNIT_ASSERT_EQUAL_STRING(info.interface_name, "lo");
+
+    char client_port[16];
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_get_local_port(
+            client, client_port, sizeof(client_port)));
+    // without packet info, the reply would be sent from 127.0.0.1
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_set_opt(
+            server, AVS_NET_SOCKET_OPT_SEND_PACKET_INFO,
+            (avs_net_socket_opt_value_t) {
+                .packet_info = info
+            }));
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_send_to(server, "pong", 4,
+                                                   client_host, client_port));
+    char server_host[64];
+    receive_exactly(client, "pong", server_host, sizeof(server_host));
+    AVS_UNIT_ASSERT_EQUAL_STRING(server_host, "127.0.0.2");
+
+    avs_net_socket_cleanup(&client);
+    avs_net_socket_cleanup(&server);
+}
+
+AVS_UNIT_TEST(socket_multicast, packet_info_ipv4) {
+    test_reply_from_receiving_address(AVS_NET_AF_INET4, "0.0.0.0");
+}
+
+#    ifdef AVS_COMMONS_NET_WITH_IPV6
+AVS_UNIT_TEST(socket_multicast, packet_info_dual_stack) {
+    test_reply_from_receiving_address(AVS_NET_AF_UNSPEC, "::");
+}
+#    endif // AVS_COMMONS_NET_WITH_IPV6
+
+static void
+test_multicast_loopback(const avs_net_multicast_membership_t *membership) {
+    avs_net_socket_t *server = create_bound(AVS_NET_AF_INET4, "0.0.0.0");
+    avs_net_socket_t *client = create_bound(AVS_NET_AF_INET4, "127.0.0.1");
+    char server_port[16];
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_get_local_port(
+            server, server_port, sizeof(server_port)));
+
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_set_opt(
+            server, AVS_NET_SOCKET_OPT_MULTICAST_JOIN,
+            (avs_net_socket_opt_value_t) {
+                .multicast_membership = *membership
+            }));
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_set_opt(
+            server, AVS_NET_SOCKET_OPT_RECV_PACKET_INFO,
+            (avs_net_socket_opt_value_t) {
+                .flag = true
+            }));
+
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_set_opt(
+            client, AVS_NET_SOCKET_OPT_MULTICAST_TTL,
+            (avs_net_socket_opt_value_t) {
+                .multicast_ttl = 1
+            }));
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_set_opt(
+            client, AVS_NET_SOCKET_OPT_MULTICAST_LOOP,
+            (avs_net_socket_opt_value_t) {
+                .flag = true
+            }));
+    avs_net_socket_opt_value_t value;
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_get_opt(
+            client, AVS_NET_SOCKET_OPT_MULTICAST_TTL, &value));
+    AVS_UNIT_ASSERT_EQUAL(value.multicast_ttl, 1);
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_get_opt(
+            client, AVS_NET_SOCKET_OPT_MULTICAST_LOOP, &value));
+    AVS_UNIT_ASSERT_TRUE(value.flag);
+
+    // route the multicast datagram through the loopback interface
+    avs_net_packet_info_t send_info = {
+        .interface_name = "lo"
+    };
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_set_opt(
+            client, AVS_NET_SOCKET_OPT_SEND_PACKET_INFO,
+            (avs_net_socket_opt_value_t) {
+                .packet_info = send_info
+            }));
+    AVS_UNIT_ASSERT_SUCCESS(
+            avs_net_socket_send_to(client, "hello", 5, GROUP, server_port));
+
+    char client_host[64];
+    receive_exactly(server, "hello", client_host, sizeof(client_host));
+    AVS_UNIT_ASSERT_EQUAL_STRING(client_host, "127.0.0.1");
+    avs_net_packet_info_t info =
+            get_packet_info(server, AVS_NET_SOCKET_OPT_LAST_PACKET_INFO);
+    AVS_UNIT_ASSERT_EQUAL_STRING(info.local_host, GROUP);
+    AVS_UNIT_ASSERT_EQUAL_STRING(info.interface_name, "lo");
+
+    // replying "from" the group address falls back to the interface only
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_set_opt(
+            server, AVS_NET_SOCKET_OPT_SEND_PACKET_INFO,
+            (avs_net_socket_opt_value_t) {
+                .packet_info = info
+            }));
+    info = get_packet_info(server, AVS_NET_SOCKET_OPT_SEND_PACKET_INFO);
+    AVS_UNIT_ASSERT_EQUAL_STRING(info.local_host, "");
+    AVS_UNIT_ASSERT_EQUAL_STRING(info.interface_name, "lo");
+
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_set_opt(
+            server, AVS_NET_SOCKET_OPT_MULTICAST_LEAVE,
+            (avs_net_socket_opt_value_t) {
+                .multicast_membership = *membership
+            }));
+    AVS_UNIT_ASSERT_FAILED(avs_net_socket_set_opt(
+            server, AVS_NET_SOCKET_OPT_MULTICAST_LEAVE,
+            (avs_net_socket_opt_value_t) {
+                .multicast_membership = *membership
+            }));
+
+    avs_net_socket_cleanup(&client);
+    avs_net_socket_cleanup(&server);
+}
+
+AVS_UNIT_TEST(socket_multicast, any_source) {
+    const avs_net_multicast_membership_t membership = {
+        .group = GROUP,
+        .interface_name = "lo"
+    };
+    test_multicast_loopback(&membership);
+}
+
+AVS_UNIT_TEST(socket_multicast, source_specific) {
+    const avs_net_multicast_membership_t membership = {
+        .group = GROUP,
+        .source = "127.0.0.1",
+        .interface_name = "lo"
+    };
+    test_multicast_loopback(&membership);
+}
+
+AVS_UNIT_TEST(socket_multicast, errors) {
+    avs_net_socket_t *socket = NULL;
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_udp_socket_create(&socket, NULL));
+    avs_net_multicast_membership_t membership = {
+        .group = GROUP
+    };
+    // not bound yet
+    AVS_UNIT_ASSERT_FAILED(avs_net_socket_set_opt(
+            socket, AVS_NET_SOCKET_OPT_MULTICAST_JOIN,
+            (avs_net_socket_opt_value_t) {
+                .multicast_membership = membership
+            }));
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_bind(socket, "0.0.0.0", "0"));
+
+    membership.interface_name = "nonexistent0";
+    AVS_UNIT_ASSERT_FAILED(avs_net_socket_set_opt(
+            socket, AVS_NET_SOCKET_OPT_MULTICAST_JOIN,
+            (avs_net_socket_opt_value_t) {
+                .multicast_membership = membership
+            }));
+    membership.interface_name = NULL;
+    membership.group = "127.0.0.1";
+    AVS_UNIT_ASSERT_FAILED(avs_net_socket_set_opt(
+            socket, AVS_NET_SOCKET_OPT_MULTICAST_JOIN,
+            (avs_net_socket_opt_value_t) {
+                .multicast_membership = membership
+            }));
+    AVS_UNIT_ASSERT_FAILED(avs_net_socket_set_opt(
+            socket, AVS_NET_SOCKET_OPT_MULTICAST_TTL,
+            (avs_net_socket_opt_value_t) {
+                .multicast_ttl = 256
+            }));
+    // host names are not resolved
+    membership.group = "localhost";
+    AVS_UNIT_ASSERT_FAILED(avs_net_socket_set_opt(
+            socket, AVS_NET_SOCKET_OPT_MULTICAST_JOIN,
+            (avs_net_socket_opt_value_t) {
+                .multicast_membership = membership
+            }));
+    avs_net_packet_info_t info = {
+        .local_host = "not an address"
+    };
+    AVS_UNIT_ASSERT_FAILED(avs_net_socket_set_opt(
+            socket, AVS_NET_SOCKET_OPT_SEND_PACKET_INFO,
+            (avs_net_socket_opt_value_t) {
+                .packet_info = info
+            }));
+    strcpy(info.local_host, "localhost");
+    AVS_UNIT_ASSERT_FAILED(avs_net_socket_set_opt(
+            socket, AVS_NET_SOCKET_OPT_SEND_PACKET_INFO,
+            (avs_net_socket_opt_value_t) {
+                .packet_info = info
+            }));
+    strcpy(info.local_host, "127.0.0.1");
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_set_opt(
+            socket, AVS_NET_SOCKET_OPT_SEND_PACKET_INFO,
+            (avs_net_socket_opt_value_t) {
+                .packet_info = info
+            }));
+    avs_net_socket_cleanup(&socket);
+
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_tcp_socket_create(&socket, NULL));
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_bind(socket, "0.0.0.0", "0"));
+    membership.group = GROUP;
+    AVS_UNIT_ASSERT_FAILED(avs_net_socket_set_opt(
+            socket, AVS_NET_SOCKET_OPT_MULTICAST_JOIN,
+            (avs_net_socket_opt_value_t) {
+                .multicast_membership = membership
+            }));
+    avs_net_socket_cleanup(&socket);
+}
+
+#endif // defined(__linux__) && defined(AVS_COMMONS_NET_WITH_IPV4) &&
+       // defined(AVS_COMMONS_NET_POSIX_AVS_SOCKET_HAVE_RECVMSG)
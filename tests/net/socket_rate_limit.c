@@ -0,0 +1,301 @@
+/*
+ * Copyright 2021 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+
+#include <avsystem/commons/avs_memory.h>
+#include <avsystem/commons/avs_socket.h>
+#include <avsystem/commons/avs_socket_v_table.h>
+#include <avsystem/commons/avs_unit_test.h>
+
+#ifdef AVS_COMMONS_NET_WITH_RATE_LIMIT
+
+typedef struct {
+    const avs_net_socket_v_table_t *const operations;
+    size_t bytes_sent;
+    size_t largest_chunk;
+    size_t datagram_size;
+    avs_time_duration_t recv_timeout;
+} mock_socket_t;
+
+static avs_error_t mock_send(avs_net_socket_t *socket_,
+                             const void *buffer,
+                             size_t buffer_length) {
+    (void) buffer;
+    mock_socket_t *socket = (mock_socket_t *) socket_;
+    socket->bytes_sent += buffer_length;
+    socket->largest_chunk = AVS_MAX(socket->largest_chunk, buffer_length);
+    return AVS_OK;
+}
+
+static avs_error_t mock_receive(avs_net_socket_t *socket_,
+                                size_t *out_bytes_received,
+                                void *buffer,
+                                size_t buffer_length) {
+    mock_socket_t *socket = (mock_socket_t *) socket_;
+    *out_bytes_received = AVS_MIN(buffer_length, socket->datagram_size);
+    memset(buffer, 0, *out_bytes_received);
+    return AVS_OK;
+}
+
+static avs_error_t mock_cleanup(avs_net_socket_t **socket) {
+    avs_free(*socket);
+    *socket = NULL;
+    return AVS_OK;
+}
+
+static avs_error_t mock_get_opt(avs_net_socket_t *socket,
+                                avs_net_socket_opt_key_t option_key,
+                                avs_net_socket_opt_value_t *out_option_value) {
+    switch (option_key) {
+    case AVS_NET_SOCKET_OPT_RECV_TIMEOUT:
+        out_option_value->recv_timeout =
+                ((mock_socket_t *) socket)->recv_timeout;
+        return AVS_OK;
+    case AVS_NET_SOCKET_OPT_BYTES_SENT:
+        out_option_value->bytes_sent = ((mock_socket_t *) socket)->bytes_sent;
+        return AVS_OK;
+    default:
+        return avs_errno(AVS_ENOTSUP);
+    }
+}
+
+static const avs_net_socket_v_table_t mock_vtable = {
+    .send = mock_send,
+    .receive = mock_receive,
+    .cleanup = mock_cleanup,
+    .get_opt = mock_get_opt
+};
+
+static avs_net_socket_t *
+create_rate_limited_socket(const avs_net_rate_limit_config_t *config,
+                           mock_socket_t **out_mock) {
+    mock_socket_t *mock = (mock_socket_t *) avs_calloc(1, sizeof(*mock));
+    AVS_UNIT_ASSERT_NOT_NULL(mock);
+    *(const avs_net_socket_v_table_t **) (intptr_t) &mock->operations =
+            &mock_vtable;
+    mock->datagram_size = 100;
+    mock->recv_timeout = AVS_NET_SOCKET_DEFAULT_RECV_TIMEOUT;
+    avs_net_socket_t *socket = (avs_net_socket_t *) mock;
+    AVS_UNIT_ASSERT_SUCCESS(
+            avs_net_rate_limit_socket_decorate_in_place(&socket, config));
+    AVS_UNIT_ASSERT_TRUE(socket != (avs_net_socket_t *) mock);
+    if (out_mock) {
+        *out_mock = mock;
+    }
+    return socket;
+}
+
+static avs_net_rate_limit_stats_t get_stats(avs_net_socket_t *socket,
+                                            avs_net_socket_opt_key_t key) {
+    avs_net_socket_opt_value_t value;
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_get_opt(socket, key, &value));
+    return value.rate_limit_stats;
+}
+
+static int64_t elapsed_ms(avs_time_monotonic_t since) {
+    int64_t result;
+    AVS_UNIT_ASSERT_SUCCESS(avs_time_duration_to_scalar(
+            &result, AVS_TIME_MS,
+            avs_time_monotonic_diff(avs_time_monotonic_now(), since)));
+    return result;
+}
+
+static char DATA[4096];
+
+AVS_UNIT_TEST(rate_limit, nonblocking_burst) {
+    avs_net_rate_limit_config_t config = {
+        .backend_type = AVS_NET_UDP_SOCKET,
+        .send = { .rate = 10000, .burst = 1000 },
+        .nonblocking = true
+    };
+    avs_net_socket_t *socket = create_rate_limited_socket(&config, NULL);
+
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_send(socket, DATA, 600));
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_send(socket, DATA, 400));
+    avs_error_t err = avs_net_socket_send(socket, DATA, 500);
+    AVS_UNIT_ASSERT_TRUE(err.category == AVS_ERRNO_CATEGORY
+                         && err.code == AVS_EAGAIN);
+
+    avs_net_rate_limit_stats_t stats =
+            get_stats(socket, AVS_NET_SOCKET_OPT_RATE_LIMIT_SEND_STATS);
+    AVS_UNIT_ASSERT_EQUAL(stats.throttled_count, 1);
+    int64_t retry_after_ms;
+    AVS_UNIT_ASSERT_SUCCESS(avs_time_duration_to_scalar(
+            &retry_after_ms, AVS_TIME_MS, stats.retry_after));
+    /* 500 bytes at 10000 B/s */
+    AVS_UNIT_ASSERT_TRUE(retry_after_ms > 40 && retry_after_ms <= 50);
+
+    /* a datagram larger than the bucket is sent when the bucket is full */
+    avs_time_monotonic_t start = avs_time_monotonic_now();
+    while (avs_is_err(avs_net_socket_send(socket, DATA, 2000))) {
+        AVS_UNIT_ASSERT_TRUE(elapsed_ms(start) < 1000);
+    }
+    AVS_UNIT_ASSERT_TRUE(avs_time_duration_equal(
+            get_stats(socket, AVS_NET_SOCKET_OPT_RATE_LIMIT_SEND_STATS)
+                    .retry_after,
+            AVS_TIME_DURATION_ZERO));
+
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_cleanup(&socket));
+}
+
+AVS_UNIT_TEST(rate_limit, stream_send_split) {
+    avs_net_rate_limit_config_t config = {
+        .backend_type = AVS_NET_TCP_SOCKET,
+        .send = { .rate = 10000, .burst = 1000 }
+    };
+    mock_socket_t *mock;
+    avs_net_socket_t *socket = create_rate_limited_socket(&config, &mock);
+
+    avs_time_monotonic_t start = avs_time_monotonic_now();
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_send(socket, DATA, 3000));
+    /* 2000 bytes over the burst at 10000 B/s */
+    AVS_UNIT_ASSERT_TRUE(elapsed_ms(start) >= 190);
+    AVS_UNIT_ASSERT_EQUAL(mock->bytes_sent, 3000);
+    AVS_UNIT_ASSERT_TRUE(mock->largest_chunk <= 1000);
+
+    avs_net_rate_limit_stats_t stats =
+            get_stats(socket, AVS_NET_SOCKET_OPT_RATE_LIMIT_SEND_STATS);
+    AVS_UNIT_ASSERT_TRUE(stats.throttled_count > 0);
+    AVS_UNIT_ASSERT_TRUE(
+            avs_time_duration_less(AVS_TIME_DURATION_ZERO, stats.total_delay));
+
+    /* other options are forwarded to the backend */
+    avs_net_socket_opt_value_t value;
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_get_opt(
+            socket, AVS_NET_SOCKET_OPT_BYTES_SENT, &value));
+    AVS_UNIT_ASSERT_EQUAL(value.bytes_sent, 3000);
+
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_cleanup(&socket));
+}
+
+AVS_UNIT_TEST(rate_limit, datagram_pacing) {
+    avs_net_rate_limit_config_t config = {
+        .backend_type = AVS_NET_UDP_SOCKET,
+        .send = { .rate = 10000, .burst = 5000 },
+        .pacing = true
+    };
+    avs_net_socket_t *socket = create_rate_limited_socket(&config, NULL);
+
+    avs_time_monotonic_t start = avs_time_monotonic_now();
+    for (int i = 0; i < 5; ++i) {
+        AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_send(socket, DATA, 200));
+    }
+    /* the burst setting is ignored: each datagram after the first one waits
+     * 20 ms for its predecessor */
+    AVS_UNIT_ASSERT_TRUE(elapsed_ms(start) >= 75);
+    AVS_UNIT_ASSERT_EQUAL(
+            get_stats(socket, AVS_NET_SOCKET_OPT_RATE_LIMIT_SEND_STATS)
+                    .throttled_count,
+            4);
+
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_cleanup(&socket));
+}
+
+AVS_UNIT_TEST(rate_limit, receive_timeout) {
+    avs_net_rate_limit_config_t config = {
+        .backend_type = AVS_NET_UDP_SOCKET,
+        .receive = { .rate = 1000, .burst = 100 }
+    };
+    mock_socket_t *mock;
+    avs_net_socket_t *socket = create_rate_limited_socket(&config, &mock);
+    mock->datagram_size = 600;
+    mock->recv_timeout = avs_time_duration_from_scalar(10, AVS_TIME_MS);
+
+    size_t received;
+    AVS_UNIT_ASSERT_SUCCESS(
+            avs_net_socket_receive(socket, &received, DATA, sizeof(DATA)));
+    AVS_UNIT_ASSERT_EQUAL(received, 600);
+
+    /* the bucket is 500 bytes in debt now */
+    avs_time_monotonic_t start = avs_time_monotonic_now();
+    avs_error_t err =
+            avs_net_socket_receive(socket, &received, DATA, sizeof(DATA));
+    AVS_UNIT_ASSERT_TRUE(err.category == AVS_ERRNO_CATEGORY
+                         && err.code == AVS_ETIMEDOUT);
+    AVS_UNIT_ASSERT_EQUAL(received, 0);
+    int64_t elapsed = elapsed_ms(start);
+    AVS_UNIT_ASSERT_TRUE(elapsed >= 9 && elapsed < 400);
+
+    avs_net_rate_limit_stats_t stats =
+            get_stats(socket, AVS_NET_SOCKET_OPT_RATE_LIMIT_RECEIVE_STATS);
+    AVS_UNIT_ASSERT_EQUAL(stats.throttled_count, 1);
+    AVS_UNIT_ASSERT_EQUAL(
+            get_stats(socket, AVS_NET_SOCKET_OPT_RATE_LIMIT_SEND_STATS)
+                    .throttled_count,
+            0);
+
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_cleanup(&socket));
+}
+
+AVS_UNIT_TEST(rate_limit, stream_receive_limited_to_tokens) {
+    avs_net_rate_limit_config_t config = {
+        .backend_type = AVS_NET_TCP_SOCKET,
+        .receive = { .rate = 1000, .burst = 50 },
+        .nonblocking = true
+    };
+    mock_socket_t *mock;
+    avs_net_socket_t *socket = create_rate_limited_socket(&config, &mock);
+    mock->datagram_size = sizeof(DATA);
+
+    size_t received;
+    AVS_UNIT_ASSERT_SUCCESS(
+            avs_net_socket_receive(socket, &received, DATA, sizeof(DATA)));
+    AVS_UNIT_ASSERT_EQUAL(received, 50);
+    avs_error_t err =
+            avs_net_socket_receive(socket, &received, DATA, sizeof(DATA));
+    AVS_UNIT_ASSERT_TRUE(err.category == AVS_ERRNO_CATEGORY
+                         && err.code == AVS_EAGAIN);
+
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_cleanup(&socket));
+}
+
+AVS_UNIT_TEST(rate_limit, shared_group) {
+    avs_net_rate_limit_group_t *group = NULL;
+    avs_net_rate_limit_group_config_t group_config = {
+        .send = { .rate = 10000, .burst = 1000 }
+    };
+    AVS_UNIT_ASSERT_SUCCESS(
+            avs_net_rate_limit_group_create(&group, &group_config));
+
+    avs_net_rate_limit_config_t config = {
+        .backend_type = AVS_NET_UDP_SOCKET,
+        .group = group,
+        .nonblocking = true
+    };
+    avs_net_socket_t *socket1 = create_rate_limited_socket(&config, NULL);
+    avs_net_socket_t *socket2 = create_rate_limited_socket(&config, NULL);
+    /* the sockets keep the group alive */
+    avs_net_rate_limit_group_cleanup(&group);
+    AVS_UNIT_ASSERT_NULL(group);
+
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_send(socket1, DATA, 800));
+    AVS_UNIT_ASSERT_FAILED(avs_net_socket_send(socket2, DATA, 800));
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_send(socket2, DATA, 100));
+    AVS_UNIT_ASSERT_EQUAL(
+            get_stats(socket2, AVS_NET_SOCKET_OPT_RATE_LIMIT_SEND_STATS)
+                    .throttled_count,
+            1);
+    AVS_UNIT_ASSERT_EQUAL(
+            get_stats(socket1, AVS_NET_SOCKET_OPT_RATE_LIMIT_SEND_STATS)
+                    .throttled_count,
+            0);
+
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_cleanup(&socket1));
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_cleanup(&socket2));
+}
+
+#endif // AVS_COMMONS_NET_WITH_RATE_LIMIT
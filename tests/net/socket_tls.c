@@ -112,6 +112,26 @@ AVS_UNIT_TEST(socket, ssl_set_opt) {
     cleanup_default_ssl_config(&config);
 }
 
+//// AVS_NET_SOCKET_OPT_CORK ///////////////////////////////////////////////////
+
+AVS_UNIT_TEST(socket, ssl_cork_not_supported) {
+    avs_net_socket_t *socket = NULL;
+
+    avs_net_ssl_configuration_t config = create_default_ssl_config();
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_ssl_socket_create(&socket, &config));
+
+    avs_net_socket_opt_value_t value = {
+        .flag = true
+    };
+    avs_error_t err =
+            avs_net_socket_set_opt(socket, AVS_NET_SOCKET_OPT_CORK, value);
+    AVS_UNIT_ASSERT_TRUE(err.category == AVS_ERRNO_CATEGORY
+                         && err.code == AVS_ENOTSUP);
+
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_cleanup(&socket));
+    cleanup_default_ssl_config(&config);
+}
+
 #define SMTP_SERVER_HOSTNAME "smtp.gmail.com"
 #define SMTP_SERVER_PORT "587"
 
@@ -0,0 +1,206 @@
+/*
+ * Copyright 2021 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <avs_commons_posix_init.h>
+
+#include <string.h>
+#include <unistd.h>
+
+#include <avsystem/commons/avs_socket.h>
+#include <avsystem/commons/avs_unit_test.h>
+#include <avsystem/commons/avs_utils.h>
+
+#ifdef AVS_COMMONS_NET_WITH_UNIX_SOCKETS
+
+static const avs_net_socket_configuration_t UNIX_CONFIG = {
+    .address_family = AVS_NET_AF_UNIX
+};
+
+static void make_address(char *buf, size_t buf_size, const char *prefix) {
+    AVS_UNIT_ASSERT_TRUE(avs_simple_snprintf(buf, buf_size, "%savs_unix_%d",
+                                             prefix, (int) getpid())
+                         >= 0);
+}
+
+static void connect_pair(const char *address,
+                         avs_net_socket_t **out_listening,
+                         avs_net_socket_t **out_client,
+                         avs_net_socket_t **out_server) {
+    AVS_UNIT_ASSERT_SUCCESS(
+            avs_net_tcp_socket_create(out_listening, &UNIX_CONFIG));
+    AVS_UNIT_ASSERT_SUCCESS(
+            avs_net_socket_bind(*out_listening, address, NULL));
+    AVS_UNIT_ASSERT_SUCCESS(
+            avs_net_tcp_socket_create(out_client, &UNIX_CONFIG));
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_connect(*out_client, address, NULL));
+    AVS_UNIT_ASSERT_SUCCESS(
+            avs_net_tcp_socket_create(out_server, &UNIX_CONFIG));
+    AVS_UNIT_ASSERT_SUCCESS(
+            avs_net_socket_accept(*out_listening, *out_server));
+}
+
+static void assert_echo(avs_net_socket_t *from, avs_net_socket_t *to) {
+    static const char DATA[] = "Hello, Unix";
+    char buf[sizeof(DATA)];
+    size_t received = 0;
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_send(from, DATA, sizeof(DATA)));
+    while (received < sizeof(DATA)) {
+        size_t bytes_received;
+        AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_receive(to, &bytes_received,
+                                                       buf + received,
+                                                       sizeof(buf) - received));
+        AVS_UNIT_ASSERT_NOT_EQUAL(bytes_received, 0);
+        received += bytes_received;
+    }
+    AVS_UNIT_ASSERT_EQUAL_STRING(buf, DATA);
+}
+
+AVS_UNIT_TEST(socket_unix, stream_filesystem_path) {
+    char path[64];
+    make_address(path, sizeof(path), "/tmp/");
+    unlink(path);
+
+    avs_net_socket_t *listening = NULL;
+    avs_net_socket_t *client = NULL;
+    avs_net_socket_t *server = NULL;
+    connect_pair(path, &listening, &client, &server);
+    assert_echo(client, server);
+    assert_echo(server, client);
+
+    char host[128];
+    char port[16];
+    AVS_UNIT_ASSERT_SUCCESS(
+            avs_net_socket_get_local_host(listening, host, sizeof(host)));
+    AVS_UNIT_ASSERT_EQUAL_STRING(host, path);
+    AVS_UNIT_ASSERT_SUCCESS(
+            avs_net_socket_get_remote_host(client, host, sizeof(host)));
+    AVS_UNIT_ASSERT_EQUAL_STRING(host, path);
+    AVS_UNIT_ASSERT_SUCCESS(
+            avs_net_socket_get_local_port(client, port, sizeof(port)));
+    AVS_UNIT_ASSERT_EQUAL_STRING(port, "");
+
+    avs_net_socket_opt_value_t value;
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_get_opt(
+            client, AVS_NET_SOCKET_OPT_ADDR_FAMILY, &value));
+    AVS_UNIT_ASSERT_EQUAL(value.addr_family, AVS_NET_AF_UNIX);
+
+    avs_net_socket_cleanup(&server);
+    avs_net_socket_cleanup(&client);
+    avs_net_socket_cleanup(&listening);
+    AVS_UNIT_ASSERT_EQUAL(unlink(path), 0);
+}
+
+#    ifdef __linux__
+AVS_UNIT_TEST(socket_unix, stream_abstract_peer_credentials) {
+    char address[64];
+    make_address(address, sizeof(address), "@");
+
+    avs_net_socket_t *listening = NULL;
+    avs_net_socket_t *client = NULL;
+    avs_net_socket_t *server = NULL;
+    connect_pair(address, &listening, &client, &server);
+    assert_echo(client, server);
+
+    char host[128];
+    AVS_UNIT_ASSERT_SUCCESS(
+            avs_net_socket_get_local_host(server, host, sizeof(host)));
+    AVS_UNIT_ASSERT_EQUAL_STRING(host, address);
+
+    avs_net_socket_opt_value_t value;
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_get_opt(
+            server, AVS_NET_SOCKET_OPT_PEER_CREDENTIALS, &value));
+    AVS_UNIT_ASSERT_EQUAL(value.peer_credentials.pid, (int64_t) getpid());
+    AVS_UNIT_ASSERT_EQUAL(value.peer_credentials.uid, (uint32_t) getuid());
+    AVS_UNIT_ASSERT_EQUAL(value.peer_credentials.gid, (uint32_t) getgid());
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_get_opt(
+            client, AVS_NET_SOCKET_OPT_PEER_CREDENTIALS, &value));
+    AVS_UNIT_ASSERT_EQUAL(value.peer_credentials.pid, (int64_t) getpid());
+
+    avs_net_socket_cleanup(&server);
+    avs_net_socket_cleanup(&client);
+    avs_net_socket_cleanup(&listening);
+}
+
+AVS_UNIT_TEST(socket_unix, datagram_send_to_receive_from) {
+    char server_address[64];
+    make_address(server_address, sizeof(server_address), "@dgram_");
+
+    avs_net_socket_t *server = NULL;
+    avs_net_socket_t *client = NULL;
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_udp_socket_create(&server, &UNIX_CONFIG));
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_bind(server, server_address, NULL));
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_udp_socket_create(&client, &UNIX_CONFIG));
+    /* autobind, so that the server has an address to reply to */
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_bind(client, NULL, NULL));
+
+    char client_address[128];
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_get_local_host(
+            client, client_address, sizeof(client_address)));
+    AVS_UNIT_ASSERT_EQUAL(client_address[0], '@');
+
+    AVS_UNIT_ASSERT_SUCCESS(
+            avs_net_socket_send_to(client, "ping", 4, server_address, NULL));
+    char buf[16];
+    char host[128];
+    char port[16];
+    size_t bytes_received;
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_receive_from(
+            server, &bytes_received, buf, sizeof(buf), host, sizeof(host),
+            port, sizeof(port)));
+    AVS_UNIT_ASSERT_EQUAL_BYTES_SIZED(buf, "ping", bytes_received);
+    AVS_UNIT_ASSERT_EQUAL_STRING(host, client_address);
+    AVS_UNIT_ASSERT_EQUAL_STRING(port, "");
+
+    AVS_UNIT_ASSERT_SUCCESS(
+            avs_net_socket_send_to(server, "pong", 4, host, port));
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_receive(client, &bytes_received, buf,
+                                                   sizeof(buf)));
+    AVS_UNIT_ASSERT_EQUAL_BYTES_SIZED(buf, "pong", bytes_received);
+
+    avs_net_socket_t *accepted = NULL;
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_udp_socket_create(&accepted, &UNIX_CONFIG));
+    AVS_UNIT_ASSERT_FAILED(avs_net_socket_accept(server, accepted));
+
+    avs_net_socket_cleanup(&accepted);
+    avs_net_socket_cleanup(&client);
+    avs_net_socket_cleanup(&server);
+}
+#    endif // __linux__
+
+AVS_UNIT_TEST(socket_unix, errors) {
+    char long_path[256];
+    memset(long_path, 'a', sizeof(long_path) - 1);
+    long_path[0] = '/';
+    long_path[sizeof(long_path) - 1] = '\0';
+
+    avs_net_socket_t *socket = NULL;
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_tcp_socket_create(&socket, &UNIX_CONFIG));
+    AVS_UNIT_ASSERT_FAILED(avs_net_socket_connect(socket, long_path, NULL));
+    AVS_UNIT_ASSERT_FAILED(avs_net_socket_connect(
+            socket, "/nonexistent/avs_commons_test.sock", NULL));
+    avs_net_socket_cleanup(&socket);
+
+    /* peer credentials are not available for IP sockets */
+    avs_net_socket_t *listening = NULL;
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_tcp_socket_create(&listening, NULL));
+    AVS_UNIT_ASSERT_SUCCESS(avs_net_socket_bind(listening, "localhost", "0"));
+    avs_net_socket_opt_value_t value;
+    AVS_UNIT_ASSERT_FAILED(avs_net_socket_get_opt(
+            listening, AVS_NET_SOCKET_OPT_PEER_CREDENTIALS, &value));
+    avs_net_socket_cleanup(&listening);
+}
+
+#endif // AVS_COMMONS_NET_WITH_UNIX_SOCKETS
@@ -18,6 +18,7 @@
 #include <avsystem/commons/avs_memory.h>
 #include <avsystem/commons/avs_persistence.h>
 #include <avsystem/commons/avs_stream.h>
+#include <avsystem/commons/avs_stream_inbuf.h>
 #include <avsystem/commons/avs_stream_membuf.h>
 #include <avsystem/commons/avs_unit_test.h>
 
@@ -252,3 +253,443 @@ AVS_UNIT_TEST(persistence, restore_from_nonempty_list) {
 
     AVS_LIST_CLEAR(&integer_list);
 }
+
+AVS_UNIT_TEST(persistence, crc32c) {
+    AVS_UNIT_ASSERT_EQUAL(crc32c("", 0), 0);
+    AVS_UNIT_ASSERT_EQUAL(crc32c("123456789", 9), 0xE3069283);
+    AVS_UNIT_ASSERT_EQUAL(crc32c("The quick brown fox jumps over the lazy dog",
+                                 43),
+                          0x22620404);
+}
+
+typedef struct {
+    uint32_t number;
+    char *string;
+} framed_test_record_t;
+
+static avs_error_t framed_test_record_handler(avs_persistence_context_t *ctx,
+                                              void *record_) {
+    framed_test_record_t *record = (framed_test_record_t *) record_;
+    avs_error_t err = avs_persistence_u32(ctx, &record->number);
+    if (avs_is_ok(err)) {
+        err = avs_persistence_string(ctx, &record->string);
+    }
+    return err;
+}
+
+static avs_error_t framed_test_partial_handler(avs_persistence_context_t *ctx,
+                                               void *record_) {
+    framed_test_record_t *record = (framed_test_record_t *) record_;
+    return avs_persistence_u32(ctx, &record->number);
+}
+
+static void store_framed_test_records(void **out_data, size_t *out_size) {
+    framed_test_record_t records[] = {
+        { 42, (char *) "first" },
+        { 514, (char *) "second" }
+    };
+    avs_stream_t *stream = avs_stream_membuf_create();
+    AVS_UNIT_ASSERT_NOT_NULL(stream);
+    avs_persistence_context_t ctx =
+            avs_persistence_store_context_create(stream);
+    for (size_t i = 0; i < AVS_ARRAY_SIZE(records); ++i) {
+        AVS_UNIT_ASSERT_SUCCESS(avs_persistence_framed_record(
+                &ctx, framed_test_record_handler, &records[i]));
+    }
+    AVS_UNIT_ASSERT_SUCCESS(
+            avs_stream_membuf_take_ownership(stream, out_data, out_size));
+    AVS_UNIT_ASSERT_SUCCESS(avs_stream_cleanup(&stream));
+}
+
+AVS_UNIT_TEST(persistence, framed_record_store_restore) {
+    void *data;
+    size_t size;
+    store_framed_test_records(&data, &size);
+    // 12-byte header, 4-byte number, 4-byte string length, string
+    AVS_UNIT_ASSERT_EQUAL(size, (12 + 4 + 4 + sizeof("first"))
+                                        + (12 + 4 + 4 + sizeof("second")));
+
+    avs_stream_inbuf_t stream = AVS_STREAM_INBUF_STATIC_INITIALIZER;
+    avs_stream_inbuf_set_buffer(&stream, data, size);
+    avs_persistence_context_t ctx =
+            avs_persistence_restore_context_create((avs_stream_t *) &stream);
+
+    framed_test_record_t record = { 0 };
+    AVS_UNIT_ASSERT_SUCCESS(avs_persistence_framed_record(
+            &ctx, framed_test_record_handler, &record));
+    AVS_UNIT_ASSERT_EQUAL(record.number, 42);
+    AVS_UNIT_ASSERT_EQUAL_STRING(record.string, "first");
+    avs_free(record.string);
+
+    record.string = NULL;
+    AVS_UNIT_ASSERT_SUCCESS(avs_persistence_framed_record(
+            &ctx, framed_test_record_handler, &record));
+    AVS_UNIT_ASSERT_EQUAL(record.number, 514);
+    AVS_UNIT_ASSERT_EQUAL_STRING(record.string, "second");
+    avs_free(record.string);
+
+    record.string = NULL;
+    AVS_UNIT_ASSERT_TRUE(avs_is_eof(avs_persistence_framed_record(
+            &ctx, framed_test_record_handler, &record)));
+    avs_free(data);
+}
+
+static void assert_second_framed_record_corrupted(const void *data,
+                                                  size_t size) {
+    avs_stream_inbuf_t stream = AVS_STREAM_INBUF_STATIC_INITIALIZER;
+    avs_stream_inbuf_set_buffer(&stream, data, size);
+    avs_persistence_context_t ctx =
+            avs_persistence_restore_context_create((avs_stream_t *) &stream);
+
+    framed_test_record_t record = { 0 };
+    AVS_UNIT_ASSERT_SUCCESS(avs_persistence_framed_record(
+            &ctx, framed_test_record_handler, &record));
+    AVS_UNIT_ASSERT_EQUAL(record.number, 42);
+    avs_free(record.string);
+
+    record.string = NULL;
+    avs_error_t err = avs_persistence_framed_record(
+            &ctx, framed_test_record_handler, &record);
+    AVS_UNIT_ASSERT_EQUAL(err.category, AVS_ERRNO_CATEGORY);
+    AVS_UNIT_ASSERT_EQUAL(err.code, AVS_EBADMSG);
+    AVS_UNIT_ASSERT_NULL(record.string);
+}
+
+AVS_UNIT_TEST(persistence, framed_record_corrupted) {
+    static const size_t SECOND_RECORD_OFFSET = 12 + 4 + 4 + sizeof("first");
+    void *data;
+    size_t size;
+    store_framed_test_records(&data, &size);
+
+    // corrupted data
+    ((char *) data)[size - 2] ^= 0x20;
+    assert_second_framed_record_corrupted(data, size);
+    ((char *) data)[size - 2] ^= 0x20;
+
+    // corrupted length
+    ((char *) data)[SECOND_RECORD_OFFSET + 3] ^= 0x01;
+    assert_second_framed_record_corrupted(data, size);
+    ((char *) data)[SECOND_RECORD_OFFSET + 3] ^= 0x01;
+
+    // truncated data
+    assert_second_framed_record_corrupted(data, size - 1);
+
+    // truncated header
+    assert_second_framed_record_corrupted(data, SECOND_RECORD_OFFSET + 5);
+
+    avs_free(data);
+}
+
+AVS_UNIT_TEST(persistence, framed_record_not_fully_restored) {
+    void *data;
+    size_t size;
+    store_framed_test_records(&data, &size);
+
+    avs_stream_inbuf_t stream = AVS_STREAM_INBUF_STATIC_INITIALIZER;
+    avs_stream_inbuf_set_buffer(&stream, data, size);
+    avs_persistence_context_t ctx =
+            avs_persistence_restore_context_create((avs_stream_t *) &stream);
+
+    framed_test_record_t record = { 0 };
+    AVS_UNIT_ASSERT_FAILED(avs_persistence_framed_record(
+            &ctx, framed_test_partial_handler, &record));
+    avs_free(data);
+}
+
+typedef struct {
+    bool flag;
+    uint8_t u8;
+    int8_t i8;
+    uint16_t u16;
+    int16_t i16;
+    char *name;
+    uint32_t u32;
+    int32_t i32;
+    uint64_t u64;
+    int64_t i64;
+    float f;
+    double d;
+    char tag[3];
+    char blob[300];
+    char *description;
+    uint16_t added_in_v2;
+} fields_test_t;
+
+static const avs_persistence_field_t FIELDS_TEST_DESCRIPTORS[] = {
+    AVS_PERSISTENCE_FIELD(BOOL, fields_test_t, flag, 1),
+    AVS_PERSISTENCE_FIELD(U8, fields_test_t, u8, 1),
+    AVS_PERSISTENCE_FIELD(I8, fields_test_t, i8, 1),
+    AVS_PERSISTENCE_FIELD(U16, fields_test_t, u16, 1),
+    AVS_PERSISTENCE_FIELD(I16, fields_test_t, i16, 1),
+    AVS_PERSISTENCE_FIELD(STRING, fields_test_t, name, 1),
+    AVS_PERSISTENCE_FIELD(U32, fields_test_t, u32, 1),
+    AVS_PERSISTENCE_FIELD(I32, fields_test_t, i32, 1),
+    AVS_PERSISTENCE_FIELD(U64, fields_test_t, u64, 1),
+    AVS_PERSISTENCE_FIELD(I64, fields_test_t, i64, 1),
+    AVS_PERSISTENCE_FIELD(FLOAT, fields_test_t, f, 1),
+    AVS_PERSISTENCE_FIELD(DOUBLE, fields_test_t, d, 1),
+    AVS_PERSISTENCE_FIELD(BYTES, fields_test_t, tag, 1),
+    AVS_PERSISTENCE_FIELD(BYTES, fields_test_t, blob, 1),
+    AVS_PERSISTENCE_FIELD(STRING, fields_test_t, description, 1),
+    AVS_PERSISTENCE_FIELD(U16, fields_test_t, added_in_v2, 2)
+};
+
+/* equivalent of FIELDS_TEST_DESCRIPTORS, written by hand */
+static avs_error_t fields_test_handler(avs_persistence_context_t *ctx,
+                                       fields_test_t *object,
+                                       uint8_t version) {
+    avs_error_t err;
+    (void) (avs_is_err((err = avs_persistence_bool(ctx, &object->flag)))
+            || avs_is_err((err = avs_persistence_u8(ctx, &object->u8)))
+            || avs_is_err((err = avs_persistence_i8(ctx, &object->i8)))
+            || avs_is_err((err = avs_persistence_u16(ctx, &object->u16)))
+            || avs_is_err((err = avs_persistence_i16(ctx, &object->i16)))
+            || avs_is_err((err = avs_persistence_string(ctx, &object->name)))
+            || avs_is_err((err = avs_persistence_u32(ctx, &object->u32)))
+            || avs_is_err((err = avs_persistence_i32(ctx, &object->i32)))
+            || avs_is_err((err = avs_persistence_u64(ctx, &object->u64)))
+            || avs_is_err((err = avs_persistence_i64(ctx, &object->i64)))
+            || avs_is_err((err = avs_persistence_float(ctx, &object->f)))
+            || avs_is_err((err = avs_persistence_double(ctx, &object->d)))
+            || avs_is_err((err = avs_persistence_bytes(ctx, object->tag,
+                                                       sizeof(object->tag))))
+            || avs_is_err((err = avs_persistence_bytes(ctx, object->blob,
+                                                       sizeof(object->blob))))
+            || avs_is_err((err = avs_persistence_string(
+                                   ctx, &object->description)))
+            || (version >= 2
+                && avs_is_err((err = avs_persistence_u16(
+                                       ctx, &object->added_in_v2)))));
+    return err;
+}
+
+static void fields_test_init(fields_test_t *object) {
+    memset(object, 0, sizeof(*object));
+    object->flag = true;
+    object->u8 = 0xA5;
+    object->i8 = -2;
+    object->u16 = 0x1234;
+    object->i16 = -1234;
+    object->name = (char *) "name";
+    object->u32 = 0xDEADBEEF;
+    object->i32 = -123456;
+    object->u64 = UINT64_C(0x0102030405060708);
+    object->i64 = -INT64_C(1234567890123);
+    object->f = 3.5f;
+    object->d = -2.25;
+    memcpy(object->tag, "tag", sizeof(object->tag));
+    for (size_t i = 0; i < sizeof(object->blob); ++i) {
+        object->blob[i] = (char) i;
+    }
+    object->description = (char *) "description";
+    object->added_in_v2 = 514;
+}
+
+static void fields_test_assert_equal(const fields_test_t *actual,
+                                     const fields_test_t *expected,
+                                     uint8_t version) {
+    AVS_UNIT_ASSERT_EQUAL(actual->flag, expected->flag);
+    AVS_UNIT_ASSERT_EQUAL(actual->u8, expected->u8);
+    AVS_UNIT_ASSERT_EQUAL(actual->i8, expected->i8);
+    AVS_UNIT_ASSERT_EQUAL(actual->u16, expected->u16);
+    AVS_UNIT_ASSERT_EQUAL(actual->i16, expected->i16);
+    AVS_UNIT_ASSERT_EQUAL_STRING(actual->name, expected->name);
+    AVS_UNIT_ASSERT_EQUAL(actual->u32, expected->u32);
+    AVS_UNIT_ASSERT_EQUAL(actual->i32, expected->i32);
+    AVS_UNIT_ASSERT_EQUAL(actual->u64, expected->u64);
+    AVS_UNIT_ASSERT_EQUAL(actual->i64, expected->i64);
+    AVS_UNIT_ASSERT_EQUAL(actual->f, expected->f);
+    AVS_UNIT_ASSERT_EQUAL(actual->d, expected->d);
+    AVS_UNIT_ASSERT_EQUAL_BYTES_SIZED(actual->tag, expected->tag,
+                                      sizeof(actual->tag));
+    AVS_UNIT_ASSERT_EQUAL_BYTES_SIZED(actual->blob, expected->blob,
+                                      sizeof(actual->blob));
+    AVS_UNIT_ASSERT_EQUAL_STRING(actual->description, expected->description);
+    if (version >= 2) {
+        AVS_UNIT_ASSERT_EQUAL(actual->added_in_v2, expected->added_in_v2);
+    }
+}
+
+static void fields_test_store(fields_test_t *object,
+                              uint8_t version,
+                              bool use_descriptors,
+                              void **out_data,
+                              size_t *out_size) {
+    avs_stream_t *stream = avs_stream_membuf_create();
+    AVS_UNIT_ASSERT_NOT_NULL(stream);
+    avs_persistence_context_t ctx =
+            avs_persistence_store_context_create(stream);
+    if (use_descriptors) {
+        AVS_UNIT_ASSERT_SUCCESS(avs_persistence_fields(
+                &ctx, object, FIELDS_TEST_DESCRIPTORS,
+                AVS_ARRAY_SIZE(FIELDS_TEST_DESCRIPTORS), version));
+    } else {
+        AVS_UNIT_ASSERT_SUCCESS(fields_test_handler(&ctx, object, version));
+    }
+    AVS_UNIT_ASSERT_SUCCESS(
+            avs_stream_membuf_take_ownership(stream, out_data, out_size));
+    AVS_UNIT_ASSERT_SUCCESS(avs_stream_cleanup(&stream));
+}
+
+static void fields_test_restore(fields_test_t *object,
+                                uint8_t version,
+                                bool use_descriptors,
+                                const void *data,
+                                size_t size) {
+    avs_stream_inbuf_t stream = AVS_STREAM_INBUF_STATIC_INITIALIZER;
+    avs_stream_inbuf_set_buffer(&stream, data, size);
+    avs_persistence_context_t ctx =
+            avs_persistence_restore_context_create((avs_stream_t *) &stream);
+    if (use_descriptors) {
+        AVS_UNIT_ASSERT_SUCCESS(avs_persistence_fields(
+                &ctx, object, FIELDS_TEST_DESCRIPTORS,
+                AVS_ARRAY_SIZE(FIELDS_TEST_DESCRIPTORS), version));
+    } else {
+        AVS_UNIT_ASSERT_SUCCESS(fields_test_handler(&ctx, object, version));
+    }
+    AVS_UNIT_ASSERT_EQUAL(stream.buffer_offset, size);
+}
+
+AVS_UNIT_TEST(persistence, fields_compatible_with_hand_written) {
+    for (uint8_t version = 1; version <= 2; ++version) {
+        fields_test_t object;
+        fields_test_init(&object);
+
+        void *expected_data;
+        size_t expected_size;
+        fields_test_store(&object, version, false, &expected_data,
+                          &expected_size);
+        void *data;
+        size_t size;
+        fields_test_store(&object, version, true, &data, &size);
+        AVS_UNIT_ASSERT_EQUAL(size, expected_size);
+        AVS_UNIT_ASSERT_EQUAL_BYTES_SIZED(data, expected_data, size);
+
+        for (int use_descriptors = 0; use_descriptors <= 1;
+             ++use_descriptors) {
+            fields_test_t restored;
+            memset(&restored, 0, sizeof(restored));
+            fields_test_restore(&restored, version, use_descriptors,
+                                use_descriptors ? expected_data : data,
+                                size);
+            fields_test_assert_equal(&restored, &object, version);
+            if (version < 2) {
+                AVS_UNIT_ASSERT_EQUAL(restored.added_in_v2, 0);
+            }
+            avs_free(restored.name);
+            avs_free(restored.description);
+        }
+        avs_free(expected_data);
+        avs_free(data);
+    }
+}
+
+AVS_UNIT_TEST(persistence, fields_null_string) {
+    fields_test_t object;
+    fields_test_init(&object);
+    object.name = NULL;
+
+    void *data;
+    size_t size;
+    fields_test_store(&object, 2, true, &data, &size);
+    fields_test_t restored;
+    memset(&restored, 0, sizeof(restored));
+    fields_test_restore(&restored, 2, false, data, size);
+    AVS_UNIT_ASSERT_NULL(restored.name);
+    AVS_UNIT_ASSERT_EQUAL_STRING(restored.description, "description");
+    avs_free(restored.description);
+    avs_free(data);
+}
+
+AVS_UNIT_TEST(persistence, versioned_fields) {
+    SCOPED_PERSISTENCE_TEST_ENV(env);
+
+    avs_persistence_context_t *store_ctx =
+            persistence_create_context(env, CONTEXT_STORE);
+    avs_persistence_context_t *restore_ctx =
+            persistence_create_context(env, CONTEXT_RESTORE);
+
+    fields_test_t object;
+    fields_test_init(&object);
+    // data persisted by code that did not know about version 2 yet
+    AVS_UNIT_ASSERT_SUCCESS(avs_persistence_versioned_fields(
+            store_ctx, &object, FIELDS_TEST_DESCRIPTORS,
+            AVS_ARRAY_SIZE(FIELDS_TEST_DESCRIPTORS), 1));
+    AVS_UNIT_ASSERT_SUCCESS(avs_persistence_versioned_fields(
+            store_ctx, &object, FIELDS_TEST_DESCRIPTORS,
+            AVS_ARRAY_SIZE(FIELDS_TEST_DESCRIPTORS), 2));
+
+    for (uint8_t version = 1; version <= 2; ++version) {
+        fields_test_t restored;
+        memset(&restored, 0, sizeof(restored));
+        restored.added_in_v2 = 42;
+        AVS_UNIT_ASSERT_SUCCESS(avs_persistence_versioned_fields(
+                restore_ctx, &restored, FIELDS_TEST_DESCRIPTORS,
+                AVS_ARRAY_SIZE(FIELDS_TEST_DESCRIPTORS), 2));
+        fields_test_assert_equal(&restored, &object, version);
+        if (version < 2) {
+            AVS_UNIT_ASSERT_EQUAL(restored.added_in_v2, 42);
+        }
+        avs_free(restored.name);
+        avs_free(restored.description);
+    }
+}
+
+AVS_UNIT_TEST(persistence, versioned_fields_newer_version) {
+    SCOPED_PERSISTENCE_TEST_ENV(env);
+
+    avs_persistence_context_t *store_ctx =
+            persistence_create_context(env, CONTEXT_STORE);
+    avs_persistence_context_t *restore_ctx =
+            persistence_create_context(env, CONTEXT_RESTORE);
+
+    uint8_t version = 3;
+    AVS_UNIT_ASSERT_SUCCESS(avs_persistence_u8(store_ctx, &version));
+
+    fields_test_t restored;
+    memset(&restored, 0, sizeof(restored));
+    avs_error_t err = avs_persistence_versioned_fields(
+            restore_ctx, &restored, FIELDS_TEST_DESCRIPTORS,
+            AVS_ARRAY_SIZE(FIELDS_TEST_DESCRIPTORS), 2);
+    AVS_UNIT_ASSERT_EQUAL(err.category, AVS_ERRNO_CATEGORY);
+    AVS_UNIT_ASSERT_EQUAL(err.code, AVS_EBADMSG);
+}
+
+AVS_UNIT_TEST(persistence, fields_truncated) {
+    fields_test_t object;
+    fields_test_init(&object);
+    void *data;
+    size_t size;
+    fields_test_store(&object, 2, true, &data, &size);
+
+    avs_stream_inbuf_t stream = AVS_STREAM_INBUF_STATIC_INITIALIZER;
+    avs_stream_inbuf_set_buffer(&stream, data, size - 1);
+    avs_persistence_context_t ctx =
+            avs_persistence_restore_context_create((avs_stream_t *) &stream);
+    fields_test_t restored;
+    memset(&restored, 0, sizeof(restored));
+    AVS_UNIT_ASSERT_FAILED(avs_persistence_fields(
+            &ctx, &restored, FIELDS_TEST_DESCRIPTORS,
+            AVS_ARRAY_SIZE(FIELDS_TEST_DESCRIPTORS), 2));
+    avs_free(restored.name);
+    avs_free(restored.description);
+    avs_free(data);
+}
+
+AVS_UNIT_TEST(persistence, fields_invalid_size) {
+    SCOPED_PERSISTENCE_TEST_ENV(env);
+
+    avs_persistence_context_t *store_ctx =
+            persistence_create_context(env, CONTEXT_STORE);
+
+    fields_test_t object;
+    fields_test_init(&object);
+    const avs_persistence_field_t fields[] = {
+        AVS_PERSISTENCE_FIELD(U8, fields_test_t, u8, 1),
+        AVS_PERSISTENCE_FIELD(U32, fields_test_t, u16, 1)
+    };
+    avs_error_t err = avs_persistence_fields(store_ctx, &object, fields,
+                                             AVS_ARRAY_SIZE(fields), 1);
+    AVS_UNIT_ASSERT_EQUAL(err.category, AVS_ERRNO_CATEGORY);
+    AVS_UNIT_ASSERT_EQUAL(err.code, AVS_EINVAL);
+}
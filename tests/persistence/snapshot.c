@@ -0,0 +1,184 @@
+/*
+ * Copyright 2021 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <avsystem/commons/avs_memory.h>
+#include <avsystem/commons/avs_persistence.h>
+#include <avsystem/commons/avs_unit_test.h>
+
+char *mkdtemp(char *dir_template);
+
+typedef struct {
+    char dir[sizeof("/tmp/test_snapshot-XXXXXX")];
+    char path[sizeof("/tmp/test_snapshot-XXXXXX/snapshot")];
+    char tmp_path[sizeof("/tmp/test_snapshot-XXXXXX/snapshot.tmp")];
+} snapshot_test_env_t;
+
+static void snapshot_test_env_init(snapshot_test_env_t *env) {
+    strcpy(env->dir, "/tmp/test_snapshot-XXXXXX");
+    AVS_UNIT_ASSERT_NOT_NULL(mkdtemp(env->dir));
+    sprintf(env->path, "%s/snapshot", env->dir);
+    sprintf(env->tmp_path, "%s/snapshot.tmp", env->dir);
+}
+
+static void snapshot_test_env_cleanup(snapshot_test_env_t *env) {
+    unlink(env->path);
+    unlink(env->tmp_path);
+    rmdir(env->dir);
+}
+
+static avs_error_t snapshot_u32_handler(avs_persistence_context_t *ctx,
+                                        void *value) {
+    return avs_persistence_u32(ctx, (uint32_t *) value);
+}
+
+static avs_error_t snapshot_failing_handler(avs_persistence_context_t *ctx,
+                                            void *value) {
+    avs_error_t err = avs_persistence_u32(ctx, (uint32_t *) value);
+    return avs_is_ok(err) ? avs_errno(AVS_EIO) : err;
+}
+
+AVS_UNIT_TEST(persistence_snapshot, store_restore) {
+    snapshot_test_env_t env;
+    snapshot_test_env_init(&env);
+
+    uint32_t value = 0xDEADBEEF;
+    uint64_t generation = 0;
+    AVS_UNIT_ASSERT_SUCCESS(avs_persistence_snapshot_store(
+            env.path, snapshot_u32_handler, &value, &generation));
+    AVS_UNIT_ASSERT_EQUAL(generation, 1);
+    AVS_UNIT_ASSERT_EQUAL(access(env.tmp_path, F_OK), -1);
+
+    value = 0xC0FFEE;
+    AVS_UNIT_ASSERT_SUCCESS(avs_persistence_snapshot_store(
+            env.path, snapshot_u32_handler, &value, &generation));
+    AVS_UNIT_ASSERT_EQUAL(generation, 2);
+
+    value = 0;
+    generation = 0;
+    AVS_UNIT_ASSERT_SUCCESS(avs_persistence_snapshot_restore(
+            env.path, snapshot_u32_handler, &value, &generation));
+    AVS_UNIT_ASSERT_EQUAL(value, 0xC0FFEE);
+    AVS_UNIT_ASSERT_EQUAL(generation, 2);
+
+    snapshot_test_env_cleanup(&env);
+}
+
+AVS_UNIT_TEST(persistence_snapshot, failed_store_keeps_previous) {
+    snapshot_test_env_t env;
+    snapshot_test_env_init(&env);
+
+    uint32_t value = 1234;
+    AVS_UNIT_ASSERT_SUCCESS(avs_persistence_snapshot_store(
+            env.path, snapshot_u32_handler, &value, NULL));
+
+    value = 5678;
+    AVS_UNIT_ASSERT_FAILED(avs_persistence_snapshot_store(
+            env.path, snapshot_failing_handler, &value, NULL));
+    AVS_UNIT_ASSERT_EQUAL(access(env.tmp_path, F_OK), -1);
+
+    uint64_t generation;
+    AVS_UNIT_ASSERT_SUCCESS(avs_persistence_snapshot_restore(
+            env.path, snapshot_u32_handler, &value, &generation));
+    AVS_UNIT_ASSERT_EQUAL(value, 1234);
+    AVS_UNIT_ASSERT_EQUAL(generation, 1);
+
+    snapshot_test_env_cleanup(&env);
+}
+
+AVS_UNIT_TEST(persistence_snapshot, corrupted_header) {
+    snapshot_test_env_t env;
+    snapshot_test_env_init(&env);
+
+    uint32_t value = 1234;
+    AVS_UNIT_ASSERT_SUCCESS(avs_persistence_snapshot_store(
+            env.path, snapshot_u32_handler, &value, NULL));
+
+    FILE *file = fopen(env.path, "r+b");
+    AVS_UNIT_ASSERT_NOT_NULL(file);
+    AVS_UNIT_ASSERT_SUCCESS(fseek(file, 14, SEEK_SET));
+    AVS_UNIT_ASSERT_EQUAL(fputc('X', file), 'X');
+    AVS_UNIT_ASSERT_SUCCESS(fclose(file));
+
+    avs_error_t err = avs_persistence_snapshot_restore(
+            env.path, snapshot_u32_handler, &value, NULL);
+    AVS_UNIT_ASSERT_EQUAL(err.category, AVS_ERRNO_CATEGORY);
+    AVS_UNIT_ASSERT_EQUAL(err.code, AVS_EBADMSG);
+
+    // generation counter cannot be determined, so the store is refused
+    value = 5678;
+    err = avs_persistence_snapshot_store(env.path, snapshot_u32_handler,
+                                         &value, NULL);
+    AVS_UNIT_ASSERT_EQUAL(err.category, AVS_ERRNO_CATEGORY);
+    AVS_UNIT_ASSERT_EQUAL(err.code, AVS_EBADMSG);
+    AVS_UNIT_ASSERT_EQUAL(access(env.tmp_path, F_OK), -1);
+
+    // generation counter starts over after removing the snapshot
+    AVS_UNIT_ASSERT_SUCCESS(unlink(env.path));
+    uint64_t generation;
+    AVS_UNIT_ASSERT_SUCCESS(avs_persistence_snapshot_store(
+            env.path, snapshot_u32_handler, &value, &generation));
+    AVS_UNIT_ASSERT_EQUAL(generation, 1);
+
+    snapshot_test_env_cleanup(&env);
+}
+
+AVS_UNIT_TEST(persistence_snapshot, interrupted_store) {
+    snapshot_test_env_t env;
+    snapshot_test_env_init(&env);
+
+    uint32_t value = 1234;
+    AVS_UNIT_ASSERT_SUCCESS(avs_persistence_snapshot_store(
+            env.path, snapshot_u32_handler, &value, NULL));
+    AVS_UNIT_ASSERT_SUCCESS(avs_persistence_snapshot_store(
+            env.path, snapshot_u32_handler, &value, NULL));
+
+    // simulate a store of generation 2 interrupted before the rename, with
+    // the previous snapshot corrupted
+    AVS_UNIT_ASSERT_SUCCESS(rename(env.path, env.tmp_path));
+    FILE *file = fopen(env.path, "wb");
+    AVS_UNIT_ASSERT_NOT_NULL(file);
+    AVS_UNIT_ASSERT_EQUAL(fputs("garbage", file), 1);
+    AVS_UNIT_ASSERT_SUCCESS(fclose(file));
+
+    uint64_t generation;
+    AVS_UNIT_ASSERT_SUCCESS(avs_persistence_snapshot_store(
+            env.path, snapshot_u32_handler, &value, &generation));
+    AVS_UNIT_ASSERT_EQUAL(generation, 3);
+    AVS_UNIT_ASSERT_EQUAL(access(env.tmp_path, F_OK), -1);
+
+    // a leftover temporary file with a higher generation is also honored
+    for (int i = 0; i < 4; ++i) {
+        AVS_UNIT_ASSERT_SUCCESS(avs_persistence_snapshot_store(
+                env.tmp_path, snapshot_u32_handler, &value, NULL));
+    }
+    AVS_UNIT_ASSERT_SUCCESS(avs_persistence_snapshot_store(
+            env.path, snapshot_u32_handler, &value, &generation));
+    AVS_UNIT_ASSERT_EQUAL(generation, 5);
+
+    snapshot_test_env_cleanup(&env);
+}
+
+AVS_UNIT_TEST(persistence_snapshot, missing_file) {
+    uint32_t value;
+    AVS_UNIT_ASSERT_FAILED(avs_persistence_snapshot_restore(
+            "/nonexistent/snapshot", snapshot_u32_handler, &value, NULL));
+}
@@ -1081,3 +1081,261 @@ AVS_UNIT_TEST(rbtree, clone_segfault) {
     AVS_UNIT_ASSERT_NULL(AVS_RBTREE_SIMPLE_CLONE(tree));
     AVS_RBTREE_DELETE(&tree);
 }
+
+static void assert_tree_contents(AVS_RBTREE(int) tree,
+                                 const int *expected,
+                                 size_t expected_size) {
+    size_t i = 0;
+    AVS_RBTREE_ELEM(int) it;
+
+    assert_rb_properties_hold(tree);
+    AVS_UNIT_ASSERT_EQUAL(expected_size, AVS_RBTREE_SIZE(tree));
+    AVS_RBTREE_FOREACH(it, tree) {
+        AVS_UNIT_ASSERT_TRUE(i < expected_size);
+        AVS_UNIT_ASSERT_EQUAL(expected[i++], *it);
+    }
+    AVS_UNIT_ASSERT_EQUAL(expected_size, i);
+}
+
+/* inserts values from first to last (inclusive) with given step, in a
+ * scrambled order so that the tree shape is not trivial */
+static void insert_range(AVS_RBTREE(int) tree, int first, int last, int step) {
+    int count = (last - first) / step + 1;
+    int i;
+
+    for (i = 0; i < count; ++i) {
+        AVS_RBTREE_ELEM(int) elem = AVS_RBTREE_ELEM_NEW(int);
+        AVS_UNIT_ASSERT_NOT_NULL(elem);
+        *elem = first + step * (int) (((unsigned) i * 7919u) % (unsigned) count);
+        AVS_UNIT_ASSERT_TRUE(elem == AVS_RBTREE_INSERT(tree, elem));
+    }
+}
+
+AVS_UNIT_TEST(rbtree, split) {
+    // clang-format off
+    AVS_RBTREE(int) tree = make_tree(
+                      8,
+              4,             12,
+          2,      6,     10,     14,
+        1,  3,  5,  7,  9, 11, 13, 15, 0);
+    // clang-format on
+    AVS_RBTREE(int) upper = AVS_RBTREE_NEW(int, int_comparator);
+    static const int EXPECTED_LOWER[] = { 1, 2, 3, 4, 5, 6 };
+    static const int EXPECTED_UPPER[] = { 7, 8, 9, 10, 11, 12, 13, 14, 15 };
+
+    AVS_RBTREE_SPLIT(tree, INTPTR(7), upper);
+    assert_tree_contents(tree, EXPECTED_LOWER,
+                         AVS_ARRAY_SIZE(EXPECTED_LOWER));
+    assert_tree_contents(upper, EXPECTED_UPPER,
+                         AVS_ARRAY_SIZE(EXPECTED_UPPER));
+
+    AVS_RBTREE_DELETE(&tree);
+    AVS_RBTREE_DELETE(&upper);
+}
+
+AVS_UNIT_TEST(rbtree, split_at_bounds) {
+    AVS_RBTREE(int) tree = make_tree(2, 4, 6, 0);
+    AVS_RBTREE(int) upper = AVS_RBTREE_NEW(int, int_comparator);
+    static const int EXPECTED[] = { 2, 4, 6 };
+
+    AVS_RBTREE_SPLIT(tree, INTPTR(7), upper);
+    assert_tree_contents(tree, EXPECTED, AVS_ARRAY_SIZE(EXPECTED));
+    assert_tree_contents(upper, NULL, 0);
+
+    AVS_RBTREE_SPLIT(tree, INTPTR(1), upper);
+    assert_tree_contents(tree, NULL, 0);
+    assert_tree_contents(upper, EXPECTED, AVS_ARRAY_SIZE(EXPECTED));
+
+    AVS_RBTREE_DELETE(&tree);
+    AVS_RBTREE_DELETE(&upper);
+}
+
+AVS_UNIT_TEST(rbtree, join) {
+    AVS_RBTREE(int) tree = make_tree(1, 2, 3, 0);
+    AVS_RBTREE(int) other = AVS_RBTREE_NEW(int, int_comparator);
+    static const int EXPECTED[] = { 1, 2, 3, 10, 20, 30, 40, 50 };
+
+    insert_range(other, 10, 50, 10);
+    AVS_UNIT_ASSERT_SUCCESS(AVS_RBTREE_JOIN(tree, other));
+    assert_tree_contents(tree, EXPECTED, AVS_ARRAY_SIZE(EXPECTED));
+    assert_tree_contents(other, NULL, 0);
+
+    /* joining an empty tree is a no-op */
+    AVS_UNIT_ASSERT_SUCCESS(AVS_RBTREE_JOIN(tree, other));
+    assert_tree_contents(tree, EXPECTED, AVS_ARRAY_SIZE(EXPECTED));
+
+    /* joining into an empty tree moves everything */
+    AVS_UNIT_ASSERT_SUCCESS(AVS_RBTREE_JOIN(other, tree));
+    assert_tree_contents(other, EXPECTED, AVS_ARRAY_SIZE(EXPECTED));
+    assert_tree_contents(tree, NULL, 0);
+
+    AVS_RBTREE_DELETE(&tree);
+    AVS_RBTREE_DELETE(&other);
+}
+
+AVS_UNIT_TEST(rbtree, join_overlapping) {
+    AVS_RBTREE(int) tree = make_tree(1, 5, 0);
+    AVS_RBTREE(int) other = make_tree(5, 6, 0);
+    static const int EXPECTED_TREE[] = { 1, 5 };
+    static const int EXPECTED_OTHER[] = { 5, 6 };
+
+    AVS_UNIT_ASSERT_FAILED(AVS_RBTREE_JOIN(tree, other));
+    assert_tree_contents(tree, EXPECTED_TREE, AVS_ARRAY_SIZE(EXPECTED_TREE));
+    assert_tree_contents(other, EXPECTED_OTHER,
+                         AVS_ARRAY_SIZE(EXPECTED_OTHER));
+
+    AVS_RBTREE_DELETE(&tree);
+    AVS_RBTREE_DELETE(&other);
+}
+
+AVS_UNIT_TEST(rbtree, join_different_heights) {
+    AVS_RBTREE(int) tree = AVS_RBTREE_NEW(int, int_comparator);
+    AVS_RBTREE(int) small = make_tree(1000, 0);
+    AVS_RBTREE(int) large = AVS_RBTREE_NEW(int, int_comparator);
+    AVS_RBTREE_ELEM(int) it;
+    int expected = 1;
+
+    insert_range(tree, 1, 500, 1);
+    AVS_UNIT_ASSERT_SUCCESS(AVS_RBTREE_JOIN(tree, small));
+    assert_rb_properties_hold(tree);
+
+    insert_range(large, 1001, 2000, 1);
+    AVS_UNIT_ASSERT_SUCCESS(AVS_RBTREE_JOIN(small, large));
+    AVS_UNIT_ASSERT_SUCCESS(AVS_RBTREE_JOIN(tree, small));
+    assert_rb_properties_hold(tree);
+    AVS_UNIT_ASSERT_EQUAL(AVS_RBTREE_SIZE(tree), 1501);
+
+    AVS_RBTREE_FOREACH(it, tree) {
+        AVS_UNIT_ASSERT_EQUAL(*it, expected);
+        expected = (expected == 500 ? 1000 : expected + 1);
+    }
+
+    AVS_RBTREE_DELETE(&tree);
+    AVS_RBTREE_DELETE(&small);
+    AVS_RBTREE_DELETE(&large);
+}
+
+AVS_UNIT_TEST(rbtree, erase_range) {
+    // clang-format off
+    AVS_RBTREE(int) tree = make_tree(
+                      8,
+              4,             12,
+          2,      6,     10,     14,
+        1,  3,  5,  7,  9, 11, 13, 15, 0);
+    // clang-format on
+    static const int EXPECTED[] = { 1, 2, 3, 12, 13, 14, 15 };
+
+    AVS_UNIT_ASSERT_EQUAL(AVS_RBTREE_ERASE_RANGE(tree, INTPTR(4), INTPTR(12)),
+                          8);
+    assert_tree_contents(tree, EXPECTED, AVS_ARRAY_SIZE(EXPECTED));
+
+    /* empty and inverted ranges */
+    AVS_UNIT_ASSERT_EQUAL(AVS_RBTREE_ERASE_RANGE(tree, INTPTR(4), INTPTR(12)),
+                          0);
+    AVS_UNIT_ASSERT_EQUAL(AVS_RBTREE_ERASE_RANGE(tree, INTPTR(13), INTPTR(2)),
+                          0);
+    assert_tree_contents(tree, EXPECTED, AVS_ARRAY_SIZE(EXPECTED));
+
+    AVS_UNIT_ASSERT_EQUAL(AVS_RBTREE_ERASE_RANGE(tree, INTPTR(0), INTPTR(100)),
+                          AVS_ARRAY_SIZE(EXPECTED));
+    assert_tree_contents(tree, NULL, 0);
+
+    AVS_RBTREE_DELETE(&tree);
+}
+
+AVS_UNIT_TEST(rbtree, erase_range_expiry) {
+    AVS_RBTREE(int) tree = AVS_RBTREE_NEW(int, int_comparator);
+    int now;
+
+    insert_range(tree, 1, 1000, 1);
+    for (now = 1; now <= 1001; now += 37) {
+        AVS_RBTREE_ERASE_RANGE(tree, AVS_RBTREE_FIRST(tree), INTPTR(now));
+        assert_rb_properties_hold(tree);
+        AVS_UNIT_ASSERT_EQUAL(AVS_RBTREE_SIZE(tree), (size_t) (1001 - now));
+        if (AVS_RBTREE_SIZE(tree)) {
+            AVS_UNIT_ASSERT_EQUAL(*AVS_RBTREE_FIRST(tree), now);
+        }
+    }
+
+    AVS_RBTREE_DELETE(&tree);
+}
+
+AVS_UNIT_TEST(rbtree, merge) {
+    AVS_RBTREE(int) tree = AVS_RBTREE_NEW(int, int_comparator);
+    AVS_RBTREE(int) other = AVS_RBTREE_NEW(int, int_comparator);
+    AVS_RBTREE_ELEM(int) it;
+    int expected = 0;
+
+    insert_range(tree, 0, 600, 2);
+    insert_range(other, 0, 900, 3);
+
+    /* multiples of 6 up to 600 are present in both trees */
+    AVS_UNIT_ASSERT_EQUAL(AVS_RBTREE_MERGE(tree, other), 301 - 101);
+    assert_rb_properties_hold(tree);
+    assert_rb_properties_hold(other);
+    AVS_UNIT_ASSERT_EQUAL(AVS_RBTREE_SIZE(tree), 301 + 301 - 101);
+    AVS_UNIT_ASSERT_EQUAL(AVS_RBTREE_SIZE(other), 101);
+
+    AVS_RBTREE_FOREACH(it, tree) {
+        while ((expected % 2 || expected > 600) && expected % 3) {
+            ++expected;
+        }
+        AVS_UNIT_ASSERT_EQUAL(*it, expected++);
+    }
+    AVS_UNIT_ASSERT_EQUAL(expected, 901);
+
+    expected = 0;
+    AVS_RBTREE_FOREACH(it, other) {
+        AVS_UNIT_ASSERT_EQUAL(*it, expected);
+        expected += 6;
+    }
+
+    AVS_RBTREE_DELETE(&tree);
+    AVS_RBTREE_DELETE(&other);
+}
+
+AVS_UNIT_TEST(rbtree, split_and_merge_repeatedly) {
+    AVS_RBTREE(int) tree = AVS_RBTREE_NEW(int, int_comparator);
+    AVS_RBTREE(int) other = AVS_RBTREE_NEW(int, int_comparator);
+    int i;
+
+    insert_range(tree, 0, 2000, 1);
+    /* black heights carried through split and join are checked by asserts in
+     * rb_join3(), so both operations are exercised at various positions */
+    for (i = 0; i < 50; ++i) {
+        int pivot = (i * 397) % 2001;
+        AVS_RBTREE_SPLIT(tree, INTPTR(pivot), other);
+        assert_rb_properties_hold(tree);
+        assert_rb_properties_hold(other);
+        AVS_UNIT_ASSERT_EQUAL(AVS_RBTREE_SIZE(tree), (size_t) pivot);
+        AVS_UNIT_ASSERT_EQUAL(AVS_RBTREE_SIZE(other), (size_t) (2001 - pivot));
+        if (i % 2) {
+            AVS_UNIT_ASSERT_EQUAL(AVS_RBTREE_MERGE(tree, other),
+                                  (size_t) (2001 - pivot));
+        } else {
+            AVS_UNIT_ASSERT_SUCCESS(AVS_RBTREE_JOIN(tree, other));
+        }
+        assert_rb_properties_hold(tree);
+        AVS_UNIT_ASSERT_EQUAL(AVS_RBTREE_SIZE(tree), 2001);
+        AVS_UNIT_ASSERT_EQUAL(AVS_RBTREE_SIZE(other), 0);
+    }
+
+    AVS_RBTREE_DELETE(&tree);
+    AVS_RBTREE_DELETE(&other);
+}
+
+AVS_UNIT_TEST(rbtree, merge_into_empty) {
+    AVS_RBTREE(int) tree = AVS_RBTREE_NEW(int, int_comparator);
+    AVS_RBTREE(int) other = make_tree(3, 1, 2, 0);
+    static const int EXPECTED[] = { 1, 2, 3 };
+
+    AVS_UNIT_ASSERT_EQUAL(AVS_RBTREE_MERGE(tree, other), 3);
+    assert_tree_contents(tree, EXPECTED, AVS_ARRAY_SIZE(EXPECTED));
+    assert_tree_contents(other, NULL, 0);
+
+    AVS_UNIT_ASSERT_EQUAL(AVS_RBTREE_MERGE(tree, other), 0);
+    assert_tree_contents(tree, EXPECTED, AVS_ARRAY_SIZE(EXPECTED));
+
+    AVS_RBTREE_DELETE(&tree);
+    AVS_RBTREE_DELETE(&other);
+}
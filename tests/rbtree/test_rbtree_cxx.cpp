@@ -15,3 +15,148 @@
  */
 
 #include "src/rbtree/avs_rbtree.c"
+
+#include <string>
+
+#include <avsystem/commons/avs_rbtree_cxx.hpp>
+
+AVS_UNIT_TEST(avsRbTree, insert_find_erase) {
+    avs::RbTree<int> tree;
+    AVS_UNIT_ASSERT_TRUE(tree.empty());
+    AVS_UNIT_ASSERT_TRUE(tree.begin() == tree.end());
+    AVS_UNIT_ASSERT_TRUE(tree.find(42) == tree.end());
+
+    for (int i = 0; i < 100; ++i) {
+        int value = (i * 37) % 100;
+        std::pair<avs::RbTree<int>::iterator, bool> result = tree.insert(value);
+        AVS_UNIT_ASSERT_TRUE(result.second);
+        AVS_UNIT_ASSERT_EQUAL(*result.first, value);
+    }
+    assert_rb_properties_hold(tree.get());
+    AVS_UNIT_ASSERT_EQUAL(tree.size(), 100);
+
+    std::pair<avs::RbTree<int>::iterator, bool> duplicate = tree.insert(50);
+    AVS_UNIT_ASSERT_FALSE(duplicate.second);
+    AVS_UNIT_ASSERT_EQUAL(*duplicate.first, 50);
+    AVS_UNIT_ASSERT_EQUAL(tree.size(), 100);
+
+    AVS_UNIT_ASSERT_EQUAL(*tree.find(17), 17);
+    AVS_UNIT_ASSERT_TRUE(tree.find(100) == tree.end());
+    AVS_UNIT_ASSERT_EQUAL(tree.count(99), 1);
+
+    AVS_UNIT_ASSERT_EQUAL(tree.erase(17), 1);
+    AVS_UNIT_ASSERT_EQUAL(tree.erase(17), 0);
+    AVS_UNIT_ASSERT_EQUAL(*tree.lower_bound(17), 18);
+    AVS_UNIT_ASSERT_EQUAL(*tree.upper_bound(16), 18);
+    AVS_UNIT_ASSERT_TRUE(tree.upper_bound(99) == tree.end());
+    assert_rb_properties_hold(tree.get());
+
+    /* the wrapped tree stays usable through the C API */
+    AVS_UNIT_ASSERT_EQUAL(*AVS_RBTREE_FIND(tree.get(), INTPTR(42)), 42);
+    AVS_UNIT_ASSERT_NULL(AVS_RBTREE_FIND(tree.get(), INTPTR(17)));
+}
+
+AVS_UNIT_TEST(avsRbTree, bidirectional_iteration) {
+    avs::RbTree<int> tree;
+    for (int i = 10; i > 0; --i) {
+        tree.insert(i);
+    }
+
+    int expected = 1;
+    for (avs::RbTree<int>::const_iterator it = tree.cbegin();
+         it != tree.cend();
+         ++it) {
+        AVS_UNIT_ASSERT_EQUAL(*it, expected++);
+    }
+    AVS_UNIT_ASSERT_EQUAL(expected, 11);
+
+    avs::RbTree<int>::iterator it = tree.end();
+    while (it != tree.begin()) {
+        --it;
+        AVS_UNIT_ASSERT_EQUAL(*it, --expected);
+    }
+    AVS_UNIT_ASSERT_EQUAL(expected, 1);
+
+    it = tree.begin();
+    while (it != tree.end()) {
+        it = (*it % 2) ? tree.erase(it) : ++it;
+    }
+    AVS_UNIT_ASSERT_EQUAL(tree.size(), 5);
+    AVS_UNIT_ASSERT_EQUAL(*tree.begin(), 2);
+}
+
+struct ReverseLength {
+    bool operator()(const std::string &a, const std::string &b) const {
+        return a.size() > b.size();
+    }
+};
+
+AVS_UNIT_TEST(avsRbTree, custom_comparator) {
+    avs::RbTree<std::string, ReverseLength> tree;
+    tree.insert("a");
+    tree.insert("ccc");
+    tree.insert("bb");
+    AVS_UNIT_ASSERT_FALSE(tree.insert("zz").second);
+
+    avs::RbTree<std::string, ReverseLength>::iterator it = tree.begin();
+    AVS_UNIT_ASSERT_EQUAL_STRING(it->c_str(), "ccc");
+    AVS_UNIT_ASSERT_EQUAL_STRING((++it)->c_str(), "bb");
+    AVS_UNIT_ASSERT_EQUAL_STRING((++it)->c_str(), "a");
+
+    /* lookups through the C API use the generated comparator */
+    std::string key = "xx";
+    AVS_UNIT_ASSERT_EQUAL_STRING(
+            AVS_RBTREE_FIND(tree.get(), &key)->c_str(), "bb");
+}
+
+AVS_UNIT_TEST(avsRbTree, adopt_and_release) {
+    AVS_RBTREE(int) c_tree = make_tree(3, 1, 2, 0);
+    {
+        avs::RbTree<int> tree(c_tree);
+        AVS_UNIT_ASSERT_EQUAL(tree.size(), 3);
+        AVS_UNIT_ASSERT_EQUAL(*tree.find(2), 2);
+        AVS_UNIT_ASSERT_TRUE(tree.insert(4).second);
+        AVS_UNIT_ASSERT_TRUE(tree.release() == c_tree);
+    }
+    AVS_UNIT_ASSERT_EQUAL(AVS_RBTREE_SIZE(c_tree), 4);
+    assert_rb_properties_hold(c_tree);
+    AVS_RBTREE_DELETE(&c_tree);
+}
+
+AVS_UNIT_TEST(avsRbTree, failing_alloc) {
+    avs::RbTree<int> tree;
+    AVS_UNIT_ASSERT_TRUE(tree.insert(1).second);
+
+    test_rb_alloc_null_countdown = 1;
+    std::pair<avs::RbTree<int>::iterator, bool> result = tree.insert(2);
+    AVS_UNIT_ASSERT_FALSE(result.second);
+    AVS_UNIT_ASSERT_TRUE(result.first == tree.end());
+    AVS_UNIT_ASSERT_EQUAL(tree.size(), 1);
+}
+
+#if __cplusplus >= 201103L
+#    include <memory>
+
+struct UniquePtrLess {
+    bool operator()(const std::unique_ptr<int> &a,
+                    const std::unique_ptr<int> &b) const {
+        return *a < *b;
+    }
+};
+
+AVS_UNIT_TEST(avsRbTree, move_only) {
+    avs::RbTree<std::unique_ptr<int>, UniquePtrLess> tree;
+    for (int i = 0; i < 10; ++i) {
+        AVS_UNIT_ASSERT_TRUE(tree.emplace(new int(i)).second);
+    }
+    std::unique_ptr<int> duplicate(new int(5));
+    AVS_UNIT_ASSERT_FALSE(tree.insert(std::move(duplicate)).second);
+    AVS_UNIT_ASSERT_FALSE(tree.emplace(new int(5)).second);
+    AVS_UNIT_ASSERT_EQUAL(tree.size(), 10);
+
+    avs::RbTree<std::unique_ptr<int>, UniquePtrLess> moved(std::move(tree));
+    AVS_UNIT_ASSERT_TRUE(tree.empty());
+    AVS_UNIT_ASSERT_EQUAL(**moved.lower_bound(std::unique_ptr<int>(new int(3))),
+                          3);
+}
+#endif
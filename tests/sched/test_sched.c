@@ -285,4 +285,196 @@ AVS_UNIT_TEST(sched, rescheduling_in_callback) {
     teardown_test(&env);
 }
 
+#ifdef AVS_COMMONS_SCHED_WITH_METRICS
+static void slow_task(avs_sched_t *sched, const void *duration) {
+    (void) sched;
+    mock_clock_advance(*(const avs_time_duration_t *) duration);
+}
+
+typedef struct {
+    int calls;
+    avs_sched_clb_t *clb;
+    avs_time_duration_t execution_time;
+} slow_job_report_t;
+
+static void slow_job_handler(avs_sched_t *sched,
+                             const char *job_name,
+                             avs_sched_clb_t *clb,
+                             avs_time_duration_t lateness,
+                             avs_time_duration_t execution_time,
+                             void *report_) {
+    (void) sched;
+    (void) job_name;
+    (void) lateness;
+    slow_job_report_t *report = (slow_job_report_t *) report_;
+    ++report->calls;
+    report->clb = clb;
+    report->execution_time = execution_time;
+}
+
+static size_t histogram_find_single_bucket(const avs_sched_histogram_t *hist) {
+    size_t result = AVS_SCHED_HISTOGRAM_BUCKETS;
+    for (size_t i = 0; i < AVS_SCHED_HISTOGRAM_BUCKETS; ++i) {
+        if (hist->buckets[i]) {
+            AVS_UNIT_ASSERT_EQUAL(result, AVS_SCHED_HISTOGRAM_BUCKETS);
+            AVS_UNIT_ASSERT_EQUAL(hist->buckets[i], 1);
+            result = i;
+        }
+    }
+    AVS_UNIT_ASSERT_NOT_EQUAL(result, AVS_SCHED_HISTOGRAM_BUCKETS);
+    return result;
+}
+
+AVS_UNIT_TEST(sched, histogram_buckets) {
+    AVS_UNIT_ASSERT_TRUE(avs_time_duration_equal(
+            avs_sched_histogram_bucket_lower_bound(0), AVS_TIME_DURATION_ZERO));
+    AVS_UNIT_ASSERT_TRUE(avs_time_duration_equal(
+            avs_sched_histogram_bucket_lower_bound(3),
+            avs_time_duration_from_scalar(3, AVS_TIME_US)));
+    AVS_UNIT_ASSERT_TRUE(avs_time_duration_equal(
+            avs_sched_histogram_bucket_lower_bound(4),
+            avs_time_duration_from_scalar(4, AVS_TIME_US)));
+    AVS_UNIT_ASSERT_TRUE(avs_time_duration_equal(
+            avs_sched_histogram_bucket_lower_bound(9),
+            avs_time_duration_from_scalar(10, AVS_TIME_US)));
+    for (size_t i = 1; i < AVS_SCHED_HISTOGRAM_BUCKETS; ++i) {
+        AVS_UNIT_ASSERT_TRUE(avs_time_duration_less(
+                avs_sched_histogram_bucket_lower_bound(i - 1),
+                avs_sched_histogram_bucket_lower_bound(i)));
+    }
+}
+
+AVS_UNIT_TEST(sched, metrics) {
+    sched_test_env_t env = setup_test();
+
+    slow_job_report_t report = { 0, NULL, AVS_TIME_DURATION_INVALID };
+    avs_sched_set_slow_job_handler(
+            env.sched, avs_time_duration_from_scalar(10, AVS_TIME_MS),
+            slow_job_handler, &report);
+
+    const avs_time_duration_t delay =
+            avs_time_duration_from_scalar(1, AVS_TIME_S);
+    const avs_time_duration_t slow =
+            avs_time_duration_from_scalar(50, AVS_TIME_MS);
+    avs_sched_handle_t cancelled = NULL;
+    AVS_UNIT_ASSERT_SUCCESS(AVS_SCHED_DELAYED(env.sched, NULL, delay, slow_task,
+                                              &slow, sizeof(slow)));
+    AVS_UNIT_ASSERT_SUCCESS(AVS_SCHED_DELAYED(env.sched, &cancelled, delay,
+                                              slow_task, &slow, sizeof(slow)));
+    AVS_UNIT_ASSERT_SUCCESS(
+            AVS_SCHED_DELAYED(env.sched, NULL, avs_time_duration_mul(delay, 2),
+                              slow_task, &AVS_TIME_DURATION_ZERO,
+                              sizeof(avs_time_duration_t)));
+    avs_sched_del(&cancelled);
+
+    avs_sched_metrics_t metrics;
+    avs_sched_metrics_get(env.sched, &metrics);
+    AVS_UNIT_ASSERT_EQUAL(metrics.queue_depth, 2);
+    AVS_UNIT_ASSERT_EQUAL(metrics.max_queue_depth, 3);
+    AVS_UNIT_ASSERT_EQUAL(metrics.jobs_executed, 0);
+
+    mock_clock_advance(avs_time_duration_add(
+            delay, avs_time_duration_from_scalar(300, AVS_TIME_US)));
+    avs_sched_run(env.sched);
+
+    avs_sched_metrics_get(env.sched, &metrics);
+    AVS_UNIT_ASSERT_EQUAL(metrics.queue_depth, 1);
+    AVS_UNIT_ASSERT_EQUAL(metrics.jobs_executed, 1);
+    AVS_UNIT_ASSERT_EQUAL(metrics.lateness.count, 1);
+    // 300 us falls into the [256 us, 320 us) bucket
+    AVS_UNIT_ASSERT_TRUE(avs_time_duration_equal(
+            avs_sched_histogram_bucket_lower_bound(
+                    histogram_find_single_bucket(&metrics.lateness)),
+            avs_time_duration_from_scalar(256, AVS_TIME_US)));
+    // 50 ms falls into the [49152 us, 57344 us) bucket
+    AVS_UNIT_ASSERT_TRUE(avs_time_duration_equal(
+            avs_sched_histogram_bucket_lower_bound(
+                    histogram_find_single_bucket(&metrics.execution_time)),
+            avs_time_duration_from_scalar(49152, AVS_TIME_US)));
+    AVS_UNIT_ASSERT_FALSE(
+            avs_time_duration_less(metrics.execution_time.max, slow));
+
+    AVS_UNIT_ASSERT_EQUAL(report.calls, 1);
+    AVS_UNIT_ASSERT_TRUE(report.clb == slow_task);
+    AVS_UNIT_ASSERT_TRUE(
+            avs_time_duration_equal(report.execution_time,
+                                    metrics.execution_time.max));
+
+    avs_sched_metrics_reset(env.sched);
+    avs_sched_metrics_get(env.sched, &metrics);
+    AVS_UNIT_ASSERT_EQUAL(metrics.queue_depth, 1);
+    AVS_UNIT_ASSERT_EQUAL(metrics.max_queue_depth, 1);
+    AVS_UNIT_ASSERT_EQUAL(metrics.jobs_executed, 0);
+    AVS_UNIT_ASSERT_EQUAL(metrics.execution_time.count, 0);
+
+    // fast job does not trigger the watchdog
+    mock_clock_advance(delay);
+    avs_sched_run(env.sched);
+    avs_sched_metrics_get(env.sched, &metrics);
+    AVS_UNIT_ASSERT_EQUAL(metrics.queue_depth, 0);
+    AVS_UNIT_ASSERT_EQUAL(metrics.jobs_executed, 1);
+    AVS_UNIT_ASSERT_EQUAL(report.calls, 1);
+
+    teardown_test(&env);
+}
+#endif // AVS_COMMONS_SCHED_WITH_METRICS
+
+#ifdef AVS_COMMONS_SCHED_WITH_POLLABLE_FD
+static bool fd_readable(int fd, int timeout_ms) {
+    struct pollfd pfd = {
+        .fd = fd,
+        .events = POLLIN
+    };
+    return poll(&pfd, 1, timeout_ms) > 0 && (pfd.revents & POLLIN);
+}
+
+AVS_UNIT_TEST(sched, pollable_fd_due_job) {
+    sched_test_env_t env = setup_test();
+
+    int fd = avs_sched_get_pollable_fd(env.sched);
+    AVS_UNIT_ASSERT_TRUE(fd >= 0);
+    AVS_UNIT_ASSERT_EQUAL(avs_sched_get_pollable_fd(env.sched), fd);
+    AVS_UNIT_ASSERT_FALSE(fd_readable(fd, 0));
+
+    int counter = 0;
+    AVS_UNIT_ASSERT_SUCCESS(AVS_SCHED_NOW(env.sched, NULL, increment_task,
+                                          &(int *) { &counter },
+                                          sizeof(int *)));
+    AVS_UNIT_ASSERT_TRUE(fd_readable(fd, 1000));
+    avs_sched_run(env.sched);
+    AVS_UNIT_ASSERT_EQUAL(1, counter);
+    AVS_UNIT_ASSERT_FALSE(fd_readable(fd, 0));
+
+    teardown_test(&env);
+}
+
+AVS_UNIT_TEST(sched, pollable_fd_rescheduled_job) {
+    sched_test_env_t env = setup_test();
+
+    int fd = avs_sched_get_pollable_fd(env.sched);
+    AVS_UNIT_ASSERT_TRUE(fd >= 0);
+
+    const avs_time_duration_t delay =
+            avs_time_duration_from_scalar(10, AVS_TIME_S);
+    int counter = 0;
+    avs_sched_handle_t task = NULL;
+    AVS_UNIT_ASSERT_SUCCESS(
+            AVS_SCHED_DELAYED(env.sched, &task, delay, increment_task,
+                              &(int *) { &counter }, sizeof(int *)));
+    // the job is not due yet, and the change has been consumed by run()
+    avs_sched_run(env.sched);
+    AVS_UNIT_ASSERT_EQUAL(0, counter);
+    AVS_UNIT_ASSERT_FALSE(fd_readable(fd, 50));
+
+    AVS_UNIT_ASSERT_SUCCESS(AVS_RESCHED_DELAYED(&task, AVS_TIME_DURATION_ZERO));
+    AVS_UNIT_ASSERT_TRUE(fd_readable(fd, 1000));
+    mock_clock_advance(avs_time_duration_from_scalar(1, AVS_TIME_MS));
+    avs_sched_run(env.sched);
+    AVS_UNIT_ASSERT_EQUAL(1, counter);
+    AVS_UNIT_ASSERT_FALSE(fd_readable(fd, 0));
+
+    teardown_test(&env);
+}
+#endif // AVS_COMMONS_SCHED_WITH_POLLABLE_FD
+
 #warning "TODO: More tests"
@@ -0,0 +1,311 @@
+/*
+ * Copyright 2021 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define _GNU_SOURCE // for sched_getcpu()
+#include <avs_commons_posix_init.h>
+
+#include <sched.h>
+#include <string.h>
+
+#include <avsystem/commons/avs_condvar.h>
+#include <avsystem/commons/avs_mutex.h>
+#include <avsystem/commons/avs_sched.h>
+#include <avsystem/commons/avs_unit_test.h>
+
+#define MODULE_NAME sched_group_test
+#include <avs_x_log_config.h>
+
+#define NUM_SHARDS 4
+#define NUM_KEYS 64
+#define JOBS_PER_KEY 16
+
+AVS_UNIT_GLOBAL_INIT(verbose) {
+    if (!verbose) {
+        avs_log_set_default_level(AVS_LOG_QUIET);
+    }
+}
+
+typedef struct {
+    avs_sched_group_t *group;
+    avs_mutex_t *mutex;
+    avs_condvar_t *condvar;
+    size_t jobs_done;
+    size_t jobs_per_shard[NUM_SHARDS];
+    unsigned last_seq[NUM_KEYS];
+    bool failed;
+    int cpu;
+    avs_sched_handle_t handle;
+} group_test_env_t;
+
+typedef struct {
+    group_test_env_t *env;
+    uint64_t key;
+    unsigned seq;
+} group_test_job_t;
+
+static void setup_env(group_test_env_t *env,
+                      const avs_sched_group_config_t *config) {
+    memset(env, 0, sizeof(*env));
+    AVS_UNIT_ASSERT_SUCCESS(avs_mutex_create(&env->mutex));
+    AVS_UNIT_ASSERT_SUCCESS(avs_condvar_create(&env->condvar));
+    AVS_UNIT_ASSERT_NOT_NULL(
+            (env->group = avs_sched_group_new("test", env, config)));
+}
+
+static void teardown_env(group_test_env_t *env) {
+    avs_sched_group_cleanup(&env->group);
+    AVS_UNIT_ASSERT_NULL(env->group);
+    avs_condvar_cleanup(&env->condvar);
+    avs_mutex_cleanup(&env->mutex);
+}
+
+static void job_done_locked(group_test_env_t *env) {
+    ++env->jobs_done;
+    avs_condvar_notify_all(env->condvar);
+}
+
+static void wait_for_jobs(group_test_env_t *env, size_t count) {
+    avs_time_monotonic_t deadline = avs_time_monotonic_add(
+            avs_time_monotonic_now(),
+            avs_time_duration_from_scalar(10, AVS_TIME_S));
+    AVS_UNIT_ASSERT_SUCCESS(avs_mutex_lock(env->mutex));
+    while (env->jobs_done < count) {
+        AVS_UNIT_ASSERT_SUCCESS(
+                avs_condvar_wait(env->condvar, env->mutex, deadline));
+    }
+    avs_mutex_unlock(env->mutex);
+}
+
+static void record_job(avs_sched_t *sched, const void *job_) {
+    const group_test_job_t *job = (const group_test_job_t *) job_;
+    group_test_env_t *env = job->env;
+    avs_mutex_lock(env->mutex);
+    if (sched != avs_sched_group_shard_for_key(env->group, job->key)
+            || avs_sched_data(sched) != env
+            || env->last_seq[job->key] + 1 != job->seq) {
+        env->failed = true;
+    }
+    env->last_seq[job->key] = job->seq;
+    for (size_t i = 0; i < NUM_SHARDS; ++i) {
+        if (avs_sched_group_shard(env->group, i) == sched) {
+            ++env->jobs_per_shard[i];
+        }
+    }
+    job_done_locked(env);
+    avs_mutex_unlock(env->mutex);
+}
+
+AVS_UNIT_TEST(sched_group, jobs_distributed_by_key) {
+    group_test_env_t env;
+    setup_env(&env, &(const avs_sched_group_config_t) {
+                        .num_shards = NUM_SHARDS
+                    });
+    AVS_UNIT_ASSERT_EQUAL(avs_sched_group_size(env.group), NUM_SHARDS);
+
+    for (unsigned seq = 1; seq <= JOBS_PER_KEY; ++seq) {
+        for (uint64_t key = 0; key < NUM_KEYS; ++key) {
+            group_test_job_t job = {
+                .env = &env,
+                .key = key,
+                .seq = seq
+            };
+            AVS_UNIT_ASSERT_SUCCESS(AVS_SCHED_GROUP_NOW(
+                    env.group, key, NULL, record_job, &job, sizeof(job)));
+        }
+    }
+    wait_for_jobs(&env, NUM_KEYS * JOBS_PER_KEY);
+    AVS_UNIT_ASSERT_FALSE(env.failed);
+    for (size_t i = 0; i < NUM_SHARDS; ++i) {
+        AVS_UNIT_ASSERT_TRUE(env.jobs_per_shard[i] > 0);
+    }
+
+#ifdef AVS_COMMONS_SCHED_WITH_METRICS
+    avs_sched_metrics_t metrics;
+    avs_sched_group_metrics_get(env.group, &metrics);
+    AVS_UNIT_ASSERT_EQUAL(metrics.jobs_executed, NUM_KEYS * JOBS_PER_KEY);
+    AVS_UNIT_ASSERT_EQUAL(metrics.execution_time.count,
+                          NUM_KEYS * JOBS_PER_KEY);
+#endif // AVS_COMMONS_SCHED_WITH_METRICS
+
+    teardown_env(&env);
+}
+
+static void never_executed_job(avs_sched_t *sched, const void *env_ptr) {
+    (void) sched;
+    group_test_env_t *env = *(group_test_env_t *const *) env_ptr;
+    avs_mutex_lock(env->mutex);
+    env->failed = true;
+    avs_mutex_unlock(env->mutex);
+}
+
+static void cancel_job(avs_sched_t *sched, const void *env_ptr) {
+    (void) sched;
+    group_test_env_t *env = *(group_test_env_t *const *) env_ptr;
+    avs_sched_del(&env->handle);
+    avs_mutex_lock(env->mutex);
+    job_done_locked(env);
+    avs_mutex_unlock(env->mutex);
+}
+
+AVS_UNIT_TEST(sched_group, cross_shard_cancellation) {
+    group_test_env_t env;
+    setup_env(&env, &(const avs_sched_group_config_t) {
+                        .num_shards = NUM_SHARDS
+                    });
+    group_test_env_t *env_ptr = &env;
+
+    uint64_t other_key = 1;
+    while (avs_sched_group_shard_for_key(env.group, other_key)
+           == avs_sched_group_shard_for_key(env.group, 0)) {
+        ++other_key;
+    }
+    AVS_UNIT_ASSERT_SUCCESS(AVS_SCHED_GROUP_DELAYED(
+            env.group, 0, &env.handle,
+            avs_time_duration_from_scalar(1, AVS_TIME_S), never_executed_job,
+            &env_ptr, sizeof(env_ptr)));
+    AVS_UNIT_ASSERT_NOT_NULL(env.handle);
+    AVS_UNIT_ASSERT_SUCCESS(AVS_SCHED_GROUP_NOW(env.group, other_key, NULL,
+                                                cancel_job, &env_ptr,
+                                                sizeof(env_ptr)));
+    wait_for_jobs(&env, 1);
+    AVS_UNIT_ASSERT_NULL(env.handle);
+
+    teardown_env(&env);
+    AVS_UNIT_ASSERT_FALSE(env.failed);
+}
+
+AVS_UNIT_TEST(sched_group, cleanup_aborts_pending_jobs) {
+    group_test_env_t env;
+    setup_env(&env, NULL);
+    AVS_UNIT_ASSERT_TRUE(avs_sched_group_size(env.group) > 0);
+    group_test_env_t *env_ptr = &env;
+
+    AVS_UNIT_ASSERT_SUCCESS(AVS_SCHED_GROUP_DELAYED(
+            env.group, 42, &env.handle,
+            avs_time_duration_from_scalar(1, AVS_TIME_S), never_executed_job,
+            &env_ptr, sizeof(env_ptr)));
+    AVS_UNIT_ASSERT_NOT_NULL(env.handle);
+
+    teardown_env(&env);
+    AVS_UNIT_ASSERT_NULL(env.handle);
+    AVS_UNIT_ASSERT_FALSE(env.failed);
+}
+
+#ifdef AVS_COMMONS_SCHED_WITH_METRICS
+AVS_UNIT_TEST(sched_group, max_queue_depth) {
+    group_test_env_t env;
+    setup_env(&env, &(const avs_sched_group_config_t) {
+                        .num_shards = 2
+                    });
+    group_test_env_t *env_ptr = &env;
+    const size_t depths[] = { 3, 2 };
+    for (size_t i = 0; i < AVS_ARRAY_SIZE(depths); ++i) {
+        for (size_t j = 0; j < depths[i]; ++j) {
+            AVS_UNIT_ASSERT_SUCCESS(AVS_SCHED_DELAYED(
+                    avs_sched_group_shard(env.group, i), NULL,
+                    avs_time_duration_from_scalar(1, AVS_TIME_HOUR),
+                    never_executed_job, &env_ptr, sizeof(env_ptr)));
+        }
+    }
+
+    avs_sched_metrics_t metrics;
+    avs_sched_group_metrics_get(env.group, &metrics);
+    AVS_UNIT_ASSERT_EQUAL(metrics.queue_depth, 5);
+    AVS_UNIT_ASSERT_EQUAL(metrics.max_queue_depth, 3);
+
+    teardown_env(&env);
+    AVS_UNIT_ASSERT_FALSE(env.failed);
+}
+#endif // AVS_COMMONS_SCHED_WITH_METRICS
+
+#ifdef __linux__
+static void record_cpu_job(avs_sched_t *sched, const void *env_ptr) {
+    (void) sched;
+    group_test_env_t *env = *(group_test_env_t *const *) env_ptr;
+    avs_mutex_lock(env->mutex);
+    env->cpu = sched_getcpu();
+    job_done_locked(env);
+    avs_mutex_unlock(env->mutex);
+}
+
+AVS_UNIT_TEST(sched_group, pinned_threads) {
+    cpu_set_t allowed;
+    AVS_UNIT_ASSERT_SUCCESS(sched_getaffinity(0, sizeof(allowed), &allowed));
+    unsigned cpu = 0;
+    while (!CPU_ISSET(cpu, &allowed)) {
+        ++cpu;
+    }
+
+    group_test_env_t env;
+    setup_env(&env, &(const avs_sched_group_config_t) {
+                        .num_shards = 1,
+                        .pin_threads = true,
+                        .cpus = &cpu
+                    });
+    group_test_env_t *env_ptr = &env;
+    AVS_UNIT_ASSERT_SUCCESS(AVS_SCHED_GROUP_NOW(
+            env.group, 0, NULL, record_cpu_job, &env_ptr, sizeof(env_ptr)));
+    wait_for_jobs(&env, 1);
+    AVS_UNIT_ASSERT_EQUAL(env.cpu, (int) cpu);
+    teardown_env(&env);
+}
+
+AVS_UNIT_TEST(sched_group, default_pinning_in_restricted_cpuset) {
+    cpu_set_t allowed;
+    AVS_UNIT_ASSERT_SUCCESS(sched_getaffinity(0, sizeof(allowed), &allowed));
+    unsigned last_cpu = CPU_SETSIZE - 1;
+    while (!CPU_ISSET(last_cpu, &allowed)) {
+        --last_cpu;
+    }
+    // simulate a cpuset that does not contain CPU 0
+    cpu_set_t restricted;
+    CPU_ZERO(&restricted);
+    CPU_SET(last_cpu, &restricted);
+    AVS_UNIT_ASSERT_SUCCESS(
+            sched_setaffinity(0, sizeof(restricted), &restricted));
+
+    group_test_env_t env;
+    memset(&env, 0, sizeof(env));
+    env.group = avs_sched_group_new("test", &env,
+                                    &(const avs_sched_group_config_t) {
+                                        .num_shards = 2,
+                                        .pin_threads = true
+                                    });
+    AVS_UNIT_ASSERT_SUCCESS(sched_setaffinity(0, sizeof(allowed), &allowed));
+    AVS_UNIT_ASSERT_NOT_NULL(env.group);
+    AVS_UNIT_ASSERT_SUCCESS(avs_mutex_create(&env.mutex));
+    AVS_UNIT_ASSERT_SUCCESS(avs_condvar_create(&env.condvar));
+
+    group_test_env_t *env_ptr = &env;
+    AVS_UNIT_ASSERT_SUCCESS(AVS_SCHED_NOW(avs_sched_group_shard(env.group, 1),
+                                          NULL, record_cpu_job, &env_ptr,
+                                          sizeof(env_ptr)));
+    wait_for_jobs(&env, 1);
+    AVS_UNIT_ASSERT_EQUAL(env.cpu, (int) last_cpu);
+    teardown_env(&env);
+}
+
+AVS_UNIT_TEST(sched_group, invalid_cpu) {
+    const unsigned cpu = CPU_SETSIZE;
+    AVS_UNIT_ASSERT_NULL(avs_sched_group_new(
+            "test", NULL,
+            &(const avs_sched_group_config_t) {
+                .num_shards = 1,
+                .pin_threads = true,
+                .cpus = &cpu
+            }));
+}
+#endif // __linux__
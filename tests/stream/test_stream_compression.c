@@ -0,0 +1,522 @@
+/*
+ * Copyright 2021 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <avsystem/commons/avs_stream_membuf.h>
+#include <avsystem/commons/avs_stream_simple_io.h>
+#include <avsystem/commons/avs_unit_test.h>
+#include <avsystem/commons/avs_utils.h>
+
+#include "src/stream/compression/avs_compression_filter.h"
+
+#define TEST_DATA_SIZE 10000
+#define COMPRESSED_MAX_SIZE (TEST_DATA_SIZE + 1024)
+
+static const char DICTIONARY[] = "compression commons avsystem stream";
+
+static char TEST_DATA[TEST_DATA_SIZE];
+
+static void fill_test_data(void) {
+    static const char *const WORDS[] = { "avsystem ", "commons ", "stream ",
+                                         "compression ", "lorem ", "ipsum " };
+    avs_rand_seed_t seed = 1234;
+    size_t offset = 0;
+    while (offset < sizeof(TEST_DATA)) {
+        const char *word =
+                WORDS[(avs_rand32_r(&seed) >> 28) % AVS_ARRAY_SIZE(WORDS)];
+        size_t length = AVS_MIN(strlen(word), sizeof(TEST_DATA) - offset);
+        memcpy(TEST_DATA + offset, word, length);
+        offset += length;
+    }
+}
+
+/* Drains the membuf into the buffer */
+static size_t read_membuf(avs_stream_t *membuf, char *buffer, size_t size) {
+    size_t offset = 0;
+    bool finished = false;
+    while (!finished) {
+        size_t bytes_read;
+        AVS_UNIT_ASSERT_SUCCESS(avs_stream_read(membuf, &bytes_read, &finished,
+                                                buffer + offset,
+                                                size - offset));
+        offset += bytes_read;
+        AVS_UNIT_ASSERT_TRUE(offset < size || finished);
+    }
+    return offset;
+}
+
+/*
+ * Writes the data to a compressing decorator over a membuf, in uneven chunks
+ * to exercise buffer boundaries, and returns the size of the compressed data
+ * stored in @p out_compressed.
+ */
+static size_t compress(const avs_stream_compression_config_t *config,
+                       const void *data,
+                       size_t size,
+                       char *out_compressed) {
+    avs_stream_t *membuf = avs_stream_membuf_create();
+    AVS_UNIT_ASSERT_NOT_NULL(membuf);
+    avs_stream_t *stream = membuf;
+    AVS_UNIT_ASSERT_SUCCESS(avs_stream_deflate_create(&stream, config));
+    AVS_UNIT_ASSERT_TRUE(stream != membuf);
+    for (size_t offset = 0; offset < size; offset += 777) {
+        AVS_UNIT_ASSERT_SUCCESS(
+                avs_stream_write(stream, (const char *) data + offset,
+                                 AVS_MIN(777, size - offset)));
+    }
+    AVS_UNIT_ASSERT_SUCCESS(avs_stream_finish_message(stream));
+    size_t compressed_size =
+            read_membuf(membuf, out_compressed, COMPRESSED_MAX_SIZE);
+    AVS_UNIT_ASSERT_SUCCESS(avs_stream_cleanup(&stream));
+    return compressed_size;
+}
+
+static avs_stream_t *
+inflate_buffer(const avs_stream_compression_config_t *config,
+               const void *compressed,
+               size_t compressed_size) {
+    avs_stream_t *stream = avs_stream_membuf_create();
+    AVS_UNIT_ASSERT_NOT_NULL(stream);
+    AVS_UNIT_ASSERT_SUCCESS(
+            avs_stream_write(stream, compressed, compressed_size));
+    AVS_UNIT_ASSERT_SUCCESS(avs_stream_inflate_create(&stream, config));
+    return stream;
+}
+
+/* Reads a single decompressed message */
+static avs_error_t read_message(avs_stream_t *stream,
+                                char *buffer,
+                                size_t buffer_size,
+                                size_t *out_size) {
+    bool finished = false;
+    *out_size = 0;
+    while (!finished) {
+        size_t bytes_read;
+        avs_error_t err =
+                avs_stream_read(stream, &bytes_read, &finished,
+                                buffer + *out_size, buffer_size - *out_size);
+        if (avs_is_err(err)) {
+            return err;
+        }
+        *out_size += bytes_read;
+        AVS_UNIT_ASSERT_TRUE(*out_size < buffer_size || finished);
+    }
+    return AVS_OK;
+}
+
+static size_t roundtrip(const avs_stream_compression_config_t *config) {
+    static char compressed[COMPRESSED_MAX_SIZE];
+    static char decompressed[TEST_DATA_SIZE + 1];
+    fill_test_data();
+
+    size_t compressed_size =
+            compress(config, TEST_DATA, sizeof(TEST_DATA), compressed);
+    AVS_UNIT_ASSERT_TRUE(compressed_size > 0);
+    AVS_UNIT_ASSERT_TRUE(compressed_size < sizeof(TEST_DATA) / 2);
+
+    avs_stream_t *stream =
+            inflate_buffer(config, compressed, compressed_size);
+    size_t size;
+    AVS_UNIT_ASSERT_SUCCESS(
+            read_message(stream, decompressed, sizeof(decompressed), &size));
+    AVS_UNIT_ASSERT_EQUAL(size, sizeof(TEST_DATA));
+    AVS_UNIT_ASSERT_EQUAL_BYTES_SIZED(decompressed, TEST_DATA,
+                                      sizeof(TEST_DATA));
+    AVS_UNIT_ASSERT_SUCCESS(avs_stream_cleanup(&stream));
+    return compressed_size;
+}
+
+#ifdef AVS_COMMONS_STREAM_WITH_ZLIB
+AVS_UNIT_TEST(stream_compression, roundtrip_zlib_formats) {
+    static const avs_stream_compression_format_t FORMATS[] = {
+        AVS_STREAM_COMPRESSION_ZLIB, AVS_STREAM_COMPRESSION_GZIP,
+        AVS_STREAM_COMPRESSION_RAW_DEFLATE
+    };
+    for (size_t i = 0; i < AVS_ARRAY_SIZE(FORMATS); ++i) {
+        roundtrip(&(const avs_stream_compression_config_t) {
+            .format = FORMATS[i],
+            /* small buffers make the decorators loop a lot */
+            .buffer_size = 16
+        });
+    }
+}
+
+AVS_UNIT_TEST(stream_compression, headers) {
+    char compressed[COMPRESSED_MAX_SIZE];
+    AVS_UNIT_ASSERT_EQUAL(
+            compress(&(const avs_stream_compression_config_t) {
+                         .format = AVS_STREAM_COMPRESSION_GZIP
+                     },
+                     "x", 1, compressed),
+            21);
+    AVS_UNIT_ASSERT_EQUAL_BYTES_SIZED(compressed, "\x1f\x8b\x08", 3);
+
+    AVS_UNIT_ASSERT_EQUAL(
+            compress(&(const avs_stream_compression_config_t) {
+                         .format = AVS_STREAM_COMPRESSION_ZLIB,
+                         .level = 9
+                     },
+                     "x", 1, compressed),
+            9);
+    AVS_UNIT_ASSERT_EQUAL_BYTES_SIZED(compressed, "\x78\xda", 2);
+
+    /* RFC 7692, section 7.2.3.1, but with the BFINAL bit set */
+    AVS_UNIT_ASSERT_EQUAL(
+            compress(&(const avs_stream_compression_config_t) {
+                         .format = AVS_STREAM_COMPRESSION_RAW_DEFLATE
+                     },
+                     "Hello", 5, compressed),
+            7);
+    AVS_UNIT_ASSERT_EQUAL_BYTES_SIZED(compressed,
+                                      "\xf3\x48\xcd\xc9\xc9\x07\x00", 7);
+}
+
+AVS_UNIT_TEST(stream_compression, levels) {
+    size_t fast = roundtrip(&(const avs_stream_compression_config_t) {
+        .format = AVS_STREAM_COMPRESSION_ZLIB,
+        .level = 1
+    });
+    size_t best = roundtrip(&(const avs_stream_compression_config_t) {
+        .format = AVS_STREAM_COMPRESSION_ZLIB,
+        .level = 9
+    });
+    AVS_UNIT_ASSERT_TRUE(best <= fast);
+
+    avs_stream_t *stream = avs_stream_membuf_create();
+    AVS_UNIT_ASSERT_FAILED(avs_stream_deflate_create(
+            &stream, &(const avs_stream_compression_config_t) {
+                         .format = AVS_STREAM_COMPRESSION_ZLIB,
+                         .level = 10
+                     }));
+    AVS_UNIT_ASSERT_FAILED(avs_stream_deflate_create(
+            &stream, &(const avs_stream_compression_config_t) {
+                         .format = AVS_STREAM_COMPRESSION_ZLIB,
+                         .window_bits = 16
+                     }));
+    AVS_UNIT_ASSERT_SUCCESS(avs_stream_cleanup(&stream));
+}
+
+AVS_UNIT_TEST(stream_compression, dictionary) {
+    static const avs_stream_compression_format_t FORMATS[] = {
+        AVS_STREAM_COMPRESSION_ZLIB, AVS_STREAM_COMPRESSION_RAW_DEFLATE
+    };
+    static const char MESSAGE[] = "avsystem commons stream compression";
+    for (size_t i = 0; i < AVS_ARRAY_SIZE(FORMATS); ++i) {
+        avs_stream_compression_config_t config = {
+            .format = FORMATS[i]
+        };
+        char compressed[COMPRESSED_MAX_SIZE];
+        size_t plain_size =
+                compress(&config, MESSAGE, strlen(MESSAGE), compressed);
+
+        config.dictionary = DICTIONARY;
+        config.dictionary_size = strlen(DICTIONARY);
+        size_t dict_size =
+                compress(&config, MESSAGE, strlen(MESSAGE), compressed);
+        AVS_UNIT_ASSERT_TRUE(dict_size < plain_size);
+        roundtrip(&config);
+
+        char decompressed[sizeof(MESSAGE)];
+        size_t size;
+        avs_stream_t *stream = inflate_buffer(&config, compressed, dict_size);
+        AVS_UNIT_ASSERT_SUCCESS(read_message(stream, decompressed,
+                                             sizeof(decompressed), &size));
+        AVS_UNIT_ASSERT_EQUAL(size, strlen(MESSAGE));
+        AVS_UNIT_ASSERT_EQUAL_BYTES_SIZED(decompressed, MESSAGE, size);
+        AVS_UNIT_ASSERT_SUCCESS(avs_stream_cleanup(&stream));
+
+        /* decompression without the dictionary fails */
+        config.dictionary = NULL;
+        config.dictionary_size = 0;
+        stream = inflate_buffer(&config, compressed, dict_size);
+        AVS_UNIT_ASSERT_FAILED(read_message(stream, decompressed,
+                                            sizeof(decompressed), &size));
+        AVS_UNIT_ASSERT_SUCCESS(avs_stream_cleanup(&stream));
+    }
+
+    avs_stream_t *stream = avs_stream_membuf_create();
+    AVS_UNIT_ASSERT_FAILED(avs_stream_deflate_create(
+            &stream, &(const avs_stream_compression_config_t) {
+                         .format = AVS_STREAM_COMPRESSION_GZIP,
+                         .dictionary = DICTIONARY,
+                         .dictionary_size = sizeof(DICTIONARY) - 1
+                     }));
+    AVS_UNIT_ASSERT_SUCCESS(avs_stream_cleanup(&stream));
+}
+
+AVS_UNIT_TEST(stream_compression, multiple_messages) {
+    const avs_stream_compression_config_t config = {
+        .format = AVS_STREAM_COMPRESSION_GZIP
+    };
+    avs_stream_t *membuf = avs_stream_membuf_create();
+    AVS_UNIT_ASSERT_NOT_NULL(membuf);
+    avs_stream_t *stream = membuf;
+    AVS_UNIT_ASSERT_SUCCESS(avs_stream_deflate_create(&stream, &config));
+    AVS_UNIT_ASSERT_SUCCESS(avs_stream_write(stream, "first", 5));
+    AVS_UNIT_ASSERT_SUCCESS(avs_stream_finish_message(stream));
+    AVS_UNIT_ASSERT_SUCCESS(avs_stream_write(stream, "second", 6));
+    AVS_UNIT_ASSERT_SUCCESS(avs_stream_finish_message(stream));
+    char compressed[COMPRESSED_MAX_SIZE];
+    size_t compressed_size =
+            read_membuf(membuf, compressed, sizeof(compressed));
+    AVS_UNIT_ASSERT_SUCCESS(avs_stream_cleanup(&stream));
+
+    /* concatenated gzip members */
+    stream = inflate_buffer(&config, compressed, compressed_size);
+    char buf[16];
+    size_t size;
+    AVS_UNIT_ASSERT_SUCCESS(read_message(stream, buf, sizeof(buf), &size));
+    AVS_UNIT_ASSERT_EQUAL(size, 5);
+    AVS_UNIT_ASSERT_EQUAL_BYTES_SIZED(buf, "first", 5);
+    AVS_UNIT_ASSERT_SUCCESS(read_message(stream, buf, sizeof(buf), &size));
+    AVS_UNIT_ASSERT_EQUAL(size, 6);
+    AVS_UNIT_ASSERT_EQUAL_BYTES_SIZED(buf, "second", 6);
+    AVS_UNIT_ASSERT_SUCCESS(read_message(stream, buf, sizeof(buf), &size));
+    AVS_UNIT_ASSERT_EQUAL(size, 0);
+    AVS_UNIT_ASSERT_SUCCESS(avs_stream_cleanup(&stream));
+}
+
+AVS_UNIT_TEST(stream_compression, truncated) {
+    const avs_stream_compression_config_t config = {
+        .format = AVS_STREAM_COMPRESSION_ZLIB
+    };
+    fill_test_data();
+    char compressed[COMPRESSED_MAX_SIZE];
+    size_t compressed_size =
+            compress(&config, TEST_DATA, sizeof(TEST_DATA), compressed);
+
+    avs_stream_t *stream =
+            inflate_buffer(&config, compressed, compressed_size - 1);
+    static char decompressed[TEST_DATA_SIZE + 1];
+    size_t size;
+    avs_error_t err =
+            read_message(stream, decompressed, sizeof(decompressed), &size);
+    AVS_UNIT_ASSERT_TRUE(err.category == AVS_ERRNO_CATEGORY
+                         && err.code == AVS_EIO);
+    AVS_UNIT_ASSERT_SUCCESS(avs_stream_cleanup(&stream));
+}
+
+AVS_UNIT_TEST(stream_compression, reset) {
+    const avs_stream_compression_config_t config = {
+        .format = AVS_STREAM_COMPRESSION_RAW_DEFLATE,
+        .dictionary = DICTIONARY,
+        .dictionary_size = sizeof(DICTIONARY) - 1
+    };
+    avs_stream_t *membuf = avs_stream_membuf_create();
+    AVS_UNIT_ASSERT_NOT_NULL(membuf);
+    avs_stream_t *stream = membuf;
+    AVS_UNIT_ASSERT_SUCCESS(avs_stream_deflate_create(&stream, &config));
+    fill_test_data();
+    AVS_UNIT_ASSERT_SUCCESS(
+            avs_stream_write(stream, TEST_DATA, sizeof(TEST_DATA)));
+    AVS_UNIT_ASSERT_SUCCESS(avs_stream_reset(stream));
+    AVS_UNIT_ASSERT_SUCCESS(avs_stream_write(stream, "stream", 6));
+    AVS_UNIT_ASSERT_SUCCESS(avs_stream_finish_message(stream));
+    char compressed[COMPRESSED_MAX_SIZE];
+    size_t compressed_size =
+            read_membuf(membuf, compressed, sizeof(compressed));
+    AVS_UNIT_ASSERT_SUCCESS(avs_stream_cleanup(&stream));
+
+    stream = inflate_buffer(&config, compressed, compressed_size);
+    char buf[16];
+    size_t size;
+    AVS_UNIT_ASSERT_SUCCESS(read_message(stream, buf, sizeof(buf), &size));
+    AVS_UNIT_ASSERT_EQUAL(size, 6);
+    AVS_UNIT_ASSERT_EQUAL_BYTES_SIZED(buf, "stream", 6);
+
+    /* the decompressor is reusable after reset as well */
+    AVS_UNIT_ASSERT_SUCCESS(avs_stream_reset(stream));
+    AVS_UNIT_ASSERT_SUCCESS(avs_stream_write(
+            ((inflate_stream_t *) stream)->backend, compressed,
+            compressed_size));
+    AVS_UNIT_ASSERT_SUCCESS(read_message(stream, buf, sizeof(buf), &size));
+    AVS_UNIT_ASSERT_EQUAL(size, 6);
+    AVS_UNIT_ASSERT_EQUAL_BYTES_SIZED(buf, "stream", 6);
+    AVS_UNIT_ASSERT_SUCCESS(avs_stream_cleanup(&stream));
+}
+
+typedef struct {
+    char data[COMPRESSED_MAX_SIZE];
+    size_t size;
+} output_ctx_t;
+
+static int output_writer(void *ctx_, const void *buffer, size_t *inout_size) {
+    output_ctx_t *ctx = (output_ctx_t *) ctx_;
+    AVS_UNIT_ASSERT_TRUE(ctx->size + *inout_size <= sizeof(ctx->data));
+    memcpy(ctx->data + ctx->size, buffer, *inout_size);
+    ctx->size += *inout_size;
+    return 0;
+}
+
+AVS_UNIT_TEST(stream_compression, cleanup_finishes_stream) {
+    const avs_stream_compression_config_t config = {
+        .format = AVS_STREAM_COMPRESSION_GZIP
+    };
+    output_ctx_t ctx = { .size = 0 };
+    avs_stream_t *stream = avs_stream_simple_output_create(output_writer, &ctx);
+    AVS_UNIT_ASSERT_NOT_NULL(stream);
+    AVS_UNIT_ASSERT_SUCCESS(avs_stream_deflate_create(&stream, &config));
+    AVS_UNIT_ASSERT_SUCCESS(avs_stream_write(stream, "unfinished", 10));
+    AVS_UNIT_ASSERT_SUCCESS(avs_stream_cleanup(&stream));
+
+    stream = inflate_buffer(&config, ctx.data, ctx.size);
+    char buf[16];
+    size_t size;
+    AVS_UNIT_ASSERT_SUCCESS(read_message(stream, buf, sizeof(buf), &size));
+    AVS_UNIT_ASSERT_EQUAL(size, 10);
+    AVS_UNIT_ASSERT_EQUAL_BYTES_SIZED(buf, "unfinished", 10);
+    AVS_UNIT_ASSERT_SUCCESS(avs_stream_cleanup(&stream));
+}
+
+AVS_UNIT_TEST(stream_compression, filter_sync_flush) {
+    const avs_stream_compression_config_t config = {
+        .format = AVS_STREAM_COMPRESSION_RAW_DEFLATE
+    };
+    avs_stream_t *filter =
+            _avs_stream_compression_filter_create(true, &config, 64, 64);
+    AVS_UNIT_ASSERT_NOT_NULL(filter);
+    AVS_UNIT_ASSERT_SUCCESS(avs_stream_write(filter, "Hello", 5));
+    AVS_UNIT_ASSERT_SUCCESS(_avs_stream_compression_filter_sync_flush(filter));
+    char buf[64];
+    size_t bytes_read;
+    bool finished;
+    AVS_UNIT_ASSERT_SUCCESS(
+            avs_stream_read(filter, &bytes_read, &finished, buf, sizeof(buf)));
+    AVS_UNIT_ASSERT_FALSE(finished);
+    /* RFC 7692, section 7.2.3.1, followed by the empty stored block */
+    AVS_UNIT_ASSERT_EQUAL(bytes_read, 11);
+    AVS_UNIT_ASSERT_EQUAL_BYTES_SIZED(
+            buf, "\xf2\x48\xcd\xc9\xc9\x07\x00\x00\x00\xff\xff", 11);
+    AVS_UNIT_ASSERT_SUCCESS(avs_stream_cleanup(&filter));
+}
+#endif // AVS_COMMONS_STREAM_WITH_ZLIB
+
+#ifdef AVS_COMMONS_STREAM_WITH_ZSTD
+AVS_UNIT_TEST(stream_compression, roundtrip_zstd) {
+    size_t fast = roundtrip(&(const avs_stream_compression_config_t) {
+        .format = AVS_STREAM_COMPRESSION_ZSTD,
+        .level = 1,
+        .buffer_size = 16
+    });
+    size_t best = roundtrip(&(const avs_stream_compression_config_t) {
+        .format = AVS_STREAM_COMPRESSION_ZSTD,
+        .level = 19
+    });
+    AVS_UNIT_ASSERT_TRUE(best <= fast);
+    roundtrip(&(const avs_stream_compression_config_t) {
+        .format = AVS_STREAM_COMPRESSION_ZSTD,
+        .dictionary = DICTIONARY,
+        .dictionary_size = sizeof(DICTIONARY) - 1
+    });
+}
+
+AVS_UNIT_TEST(stream_compression, zstd_multiple_messages) {
+    const avs_stream_compression_config_t config = {
+        .format = AVS_STREAM_COMPRESSION_ZSTD
+    };
+    avs_stream_t *membuf = avs_stream_membuf_create();
+    AVS_UNIT_ASSERT_NOT_NULL(membuf);
+    avs_stream_t *stream = membuf;
+    AVS_UNIT_ASSERT_SUCCESS(avs_stream_deflate_create(&stream, &config));
+    AVS_UNIT_ASSERT_SUCCESS(avs_stream_write(stream, "first", 5));
+    AVS_UNIT_ASSERT_SUCCESS(avs_stream_finish_message(stream));
+    AVS_UNIT_ASSERT_SUCCESS(avs_stream_write(stream, "second", 6));
+    AVS_UNIT_ASSERT_SUCCESS(avs_stream_finish_message(stream));
+    char compressed[COMPRESSED_MAX_SIZE];
+    size_t compressed_size =
+            read_membuf(membuf, compressed, sizeof(compressed));
+    AVS_UNIT_ASSERT_SUCCESS(avs_stream_cleanup(&stream));
+    /* zstd frame magic number */
+    AVS_UNIT_ASSERT_EQUAL_BYTES_SIZED(compressed, "\x28\xb5\x2f\xfd", 4);
+
+    /* concatenated zstd frames */
+    stream = inflate_buffer(&config, compressed, compressed_size);
+    char buf[16];
+    size_t size;
+    AVS_UNIT_ASSERT_SUCCESS(read_message(stream, buf, sizeof(buf), &size));
+    AVS_UNIT_ASSERT_EQUAL(size, 5);
+    AVS_UNIT_ASSERT_EQUAL_BYTES_SIZED(buf, "first", 5);
+    AVS_UNIT_ASSERT_SUCCESS(read_message(stream, buf, sizeof(buf), &size));
+    AVS_UNIT_ASSERT_EQUAL(size, 6);
+    AVS_UNIT_ASSERT_EQUAL_BYTES_SIZED(buf, "second", 6);
+    AVS_UNIT_ASSERT_SUCCESS(read_message(stream, buf, sizeof(buf), &size));
+    AVS_UNIT_ASSERT_EQUAL(size, 0);
+    AVS_UNIT_ASSERT_SUCCESS(avs_stream_cleanup(&stream));
+}
+
+AVS_UNIT_TEST(stream_compression, zstd_truncated) {
+    const avs_stream_compression_config_t config = {
+        .format = AVS_STREAM_COMPRESSION_ZSTD
+    };
+    fill_test_data();
+    char compressed[COMPRESSED_MAX_SIZE];
+    size_t compressed_size =
+            compress(&config, TEST_DATA, sizeof(TEST_DATA), compressed);
+
+    avs_stream_t *stream =
+            inflate_buffer(&config, compressed, compressed_size - 1);
+    static char decompressed[TEST_DATA_SIZE + 1];
+    size_t size;
+    avs_error_t err =
+            read_message(stream, decompressed, sizeof(decompressed), &size);
+    AVS_UNIT_ASSERT_TRUE(err.category == AVS_ERRNO_CATEGORY
+                         && err.code == AVS_EIO);
+    AVS_UNIT_ASSERT_SUCCESS(avs_stream_cleanup(&stream));
+}
+
+AVS_UNIT_TEST(stream_compression, zstd_dictionary_required) {
+    const avs_stream_compression_config_t config = {
+        .format = AVS_STREAM_COMPRESSION_ZSTD,
+        .dictionary = DICTIONARY,
+        .dictionary_size = sizeof(DICTIONARY) - 1
+    };
+    static const char MESSAGE[] = "avsystem commons stream compression";
+    char compressed[COMPRESSED_MAX_SIZE];
+    size_t compressed_size =
+            compress(&config, MESSAGE, strlen(MESSAGE), compressed);
+
+    avs_stream_t *stream = inflate_buffer(
+            &(const avs_stream_compression_config_t) {
+                .format = AVS_STREAM_COMPRESSION_ZSTD
+            },
+            compressed, compressed_size);
+    char decompressed[sizeof(MESSAGE)];
+    size_t size;
+    AVS_UNIT_ASSERT_FAILED(read_message(stream, decompressed,
+                                        sizeof(decompressed), &size));
+    AVS_UNIT_ASSERT_SUCCESS(avs_stream_cleanup(&stream));
+}
+
+AVS_UNIT_TEST(stream_compression, zstd_invalid_window) {
+    avs_stream_t *stream = avs_stream_membuf_create();
+    AVS_UNIT_ASSERT_NOT_NULL(stream);
+    AVS_UNIT_ASSERT_FAILED(avs_stream_deflate_create(
+            &stream, &(const avs_stream_compression_config_t) {
+                         .format = AVS_STREAM_COMPRESSION_ZSTD,
+                         .window_bits = 5
+                     }));
+    AVS_UNIT_ASSERT_SUCCESS(avs_stream_cleanup(&stream));
+}
+#else  // AVS_COMMONS_STREAM_WITH_ZSTD
+AVS_UNIT_TEST(stream_compression, zstd_unsupported) {
+    avs_stream_t *stream = avs_stream_membuf_create();
+    AVS_UNIT_ASSERT_NOT_NULL(stream);
+    AVS_UNIT_ASSERT_FAILED(avs_stream_deflate_create(
+            &stream, &(const avs_stream_compression_config_t) {
+                         .format = AVS_STREAM_COMPRESSION_ZSTD
+                     }));
+    AVS_UNIT_ASSERT_SUCCESS(avs_stream_cleanup(&stream));
+}
+#endif // AVS_COMMONS_STREAM_WITH_ZSTD
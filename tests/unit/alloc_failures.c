@@ -0,0 +1,100 @@
+/*
+ * Copyright 2021 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <avs_commons_posix_init.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/wait.h>
+
+#include <avsystem/commons/avs_unit_test.h>
+
+/**
+ * Runs the alloc_fixture test program with @p args, storing its standard
+ * output and standard error in @p output.
+ *
+ * @returns Exit status of the program, or -1 if it did not exit normally.
+ */
+static int run_fixture(const char *args, char *output, size_t output_size) {
+    char command[1024];
+    AVS_UNIT_ASSERT_TRUE(
+            snprintf(command, sizeof(command),
+                     // leaks are deliberate and reported by avs_unit itself
+                     "ASAN_OPTIONS=detect_leaks=0 '%s' %s 2>&1",
+                     AVS_UNIT_ALLOC_FIXTURE, args)
+            < (int) sizeof(command));
+    FILE *pipe = popen(command, "r");
+    AVS_UNIT_ASSERT_NOT_NULL(pipe);
+    size_t length = fread(output, 1, output_size - 1, pipe);
+    output[length] = '\0';
+    int status = pclose(pipe);
+    return (status != -1 && WIFEXITED(status)) ? WEXITSTATUS(status) : -1;
+}
+
+AVS_UNIT_TEST(alloc_failures, fixture_passes_without_injection) {
+    char output[4096];
+    AVS_UNIT_ASSERT_EQUAL(run_fixture("", output, sizeof(output)), 0);
+}
+
+AVS_UNIT_TEST(alloc_failures, handled_failures_pass) {
+    char output[4096];
+    AVS_UNIT_ASSERT_EQUAL(run_fixture("-a checked", output, sizeof(output)),
+                          0);
+}
+
+AVS_UNIT_TEST(alloc_failures, leak_fails_test) {
+    char output[4096];
+    AVS_UNIT_ASSERT_EQUAL(run_fixture("-a leaky", output, sizeof(output)), 1);
+    AVS_UNIT_ASSERT_NULL(strstr(
+            output, "leaks_on_failure: memory leaked when allocation #1"));
+    AVS_UNIT_ASSERT_NOT_NULL(strstr(
+            output, "leaks_on_failure: memory leaked when allocation #2 "
+                    "failed\nleaked 16 bytes allocated in allocation #1\n"));
+}
+
+AVS_UNIT_TEST(alloc_failures, crash_fails_test) {
+    char output[4096];
+    AVS_UNIT_ASSERT_EQUAL(run_fixture("-a crashy", output, sizeof(output)), 1);
+    AVS_UNIT_ASSERT_NOT_NULL(strstr(output, "crashes_on_failure: crashed"));
+    AVS_UNIT_ASSERT_NOT_NULL(
+            strstr(output, "--alloc-fail-at=1 crashy crashes_on_failure'"));
+}
+
+AVS_UNIT_TEST(alloc_failures, max_runs_limit) {
+    char output[4096];
+    // only the first allocation fails, which does not leak
+    AVS_UNIT_ASSERT_EQUAL(run_fixture("--alloc-failures=1 leaky", output,
+                                      sizeof(output)),
+                          0);
+}
+
+AVS_UNIT_TEST(alloc_failures, fail_at_reports_leak) {
+    char output[4096];
+    AVS_UNIT_ASSERT_EQUAL(run_fixture("--alloc-fail-at=2 leaky", output,
+                                      sizeof(output)),
+                          1);
+    AVS_UNIT_ASSERT_NOT_NULL(strstr(output, "failing allocation #2\n"));
+    AVS_UNIT_ASSERT_NOT_NULL(
+            strstr(output, "leaked 16 bytes allocated in allocation #1\n"));
+}
+
+AVS_UNIT_TEST(alloc_failures, fail_at_unreached_allocation) {
+    char output[4096];
+    AVS_UNIT_ASSERT_EQUAL(run_fixture("--alloc-fail-at=3 leaky", output,
+                                      sizeof(output)),
+                          0);
+    AVS_UNIT_ASSERT_NOT_NULL(strstr(output, "allocation #3 was not reached"));
+}
@@ -0,0 +1,61 @@
+/*
+ * Copyright 2021 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Test cases with deliberate allocation failure handling bugs, run by
+ * tests/unit/alloc_failures.c through the avs_unit command line. They all
+ * pass when run normally.
+ */
+
+#include <avs_commons_init.h>
+
+#include <stdlib.h>
+
+#include <avsystem/commons/avs_memory.h>
+#include <avsystem/commons/avs_unit_test.h>
+
+AVS_UNIT_TEST(checked, handles_failures) {
+    char *first = (char *) avs_malloc(16);
+    char *second = (char *) avs_malloc(32);
+    if (first && second) {
+        AVS_UNIT_ASSERT_TRUE(first != second);
+    }
+    avs_free(first);
+    avs_free(second);
+}
+
+AVS_UNIT_TEST(leaky, leaks_on_failure) {
+    char *first = (char *) avs_malloc(16);
+    if (!first) {
+        return;
+    }
+    char *second = (char *) avs_malloc(32);
+    if (!second) {
+        // BUG: the first block is not freed
+        return;
+    }
+    avs_free(first);
+    avs_free(second);
+}
+
+AVS_UNIT_TEST(crashy, crashes_on_failure) {
+    char *ptr = (char *) avs_malloc(16);
+    if (!ptr) {
+        // stands for a failed assert() in the code under test
+        abort();
+    }
+    avs_free(ptr);
+}
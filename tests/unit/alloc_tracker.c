@@ -0,0 +1,96 @@
+/*
+ * Copyright 2021 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <avs_commons_init.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#include <avsystem/commons/avs_memory.h>
+#include <avsystem/commons/avs_unit_test.h>
+
+#include "src/unit/avs_alloc_tracker.h"
+
+static size_t g_injected_allocation;
+
+static void on_injected(size_t allocation_number) {
+    g_injected_allocation = allocation_number;
+}
+
+AVS_UNIT_TEST(alloc_tracker, nth_allocation_fails) {
+    void *ptrs[4];
+    g_injected_allocation = 0;
+    _avs_unit_alloc_tracker_start(3, on_injected);
+    ptrs[0] = avs_malloc(8);
+    ptrs[1] = avs_calloc(2, 8);
+    ptrs[2] = avs_malloc(8);
+    ptrs[3] = avs_realloc(NULL, 8);
+    size_t outstanding = _avs_unit_alloc_tracker_outstanding();
+    for (size_t i = 0; i < AVS_ARRAY_SIZE(ptrs); ++i) {
+        avs_free(ptrs[i]);
+    }
+    size_t leaks = _avs_unit_alloc_tracker_outstanding();
+    _avs_unit_alloc_tracker_stop();
+
+    AVS_UNIT_ASSERT_NOT_NULL(ptrs[0]);
+    AVS_UNIT_ASSERT_NOT_NULL(ptrs[1]);
+    AVS_UNIT_ASSERT_NULL(ptrs[2]);
+    AVS_UNIT_ASSERT_NOT_NULL(ptrs[3]);
+    AVS_UNIT_ASSERT_EQUAL(g_injected_allocation, 3);
+    AVS_UNIT_ASSERT_EQUAL(outstanding, 3);
+    AVS_UNIT_ASSERT_EQUAL(leaks, 0);
+}
+
+AVS_UNIT_TEST(alloc_tracker, paused_allocations_are_not_counted) {
+    _avs_unit_alloc_tracker_start(1, NULL);
+    _avs_unit_alloc_tracker_pause();
+    void *untracked = avs_malloc(8);
+    _avs_unit_alloc_tracker_resume();
+    void *failed = avs_malloc(8);
+    size_t outstanding = _avs_unit_alloc_tracker_outstanding();
+    _avs_unit_alloc_tracker_stop();
+    avs_free(untracked);
+
+    AVS_UNIT_ASSERT_NOT_NULL(untracked);
+    AVS_UNIT_ASSERT_NULL(failed);
+    AVS_UNIT_ASSERT_EQUAL(outstanding, 0);
+}
+
+AVS_UNIT_TEST(alloc_tracker, leak_is_reported) {
+    _avs_unit_alloc_tracker_start(0, NULL);
+    void *freed = avs_malloc(8);
+    void *leaked = avs_malloc(24);
+    leaked = avs_realloc(leaked, 40);
+    avs_free(freed);
+    _avs_unit_alloc_tracker_stop();
+
+    char report[4096] = "";
+    FILE *file = tmpfile();
+    AVS_UNIT_ASSERT_NOT_NULL(file);
+    size_t leaks = _avs_unit_alloc_tracker_report_leaks(file);
+    rewind(file);
+    size_t report_length = fread(report, 1, sizeof(report) - 1, file);
+    report[report_length] = '\0';
+    fclose(file);
+    avs_free(leaked);
+
+    AVS_UNIT_ASSERT_EQUAL(leaks, 1);
+    AVS_UNIT_ASSERT_NOT_NULL(
+            strstr(report, "leaked 40 bytes allocated in allocation #2\n"));
+    AVS_UNIT_ASSERT_NOT_NULL(strstr(report, "40 bytes leaked in 1 blocks\n"));
+    // the records are discarded after reporting
+    AVS_UNIT_ASSERT_EQUAL(_avs_unit_alloc_tracker_outstanding(), 0);
+}
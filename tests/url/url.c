@@ -505,3 +505,192 @@ AVS_UNIT_TEST(url_unescape, null_character) {
     AVS_UNIT_ASSERT_EQUAL_STRING(data + 9, "@vsystem");
     AVS_UNIT_ASSERT_EQUAL(length, 17);
 }
+
+typedef struct {
+    const char *ref;
+    const char *expected;
+} resolve_test_case_t;
+
+static void assert_resolved(const char *base_str,
+                            const resolve_test_case_t *cases,
+                            size_t num_cases) {
+    avs_url_t *base = avs_url_parse(base_str);
+    AVS_UNIT_ASSERT_NOT_NULL(base);
+    for (size_t i = 0; i < num_cases; ++i) {
+        char buf[128];
+        avs_url_t *resolved = avs_url_resolve(base, cases[i].ref);
+        AVS_UNIT_ASSERT_NOT_NULL(resolved);
+        AVS_UNIT_ASSERT_SUCCESS(avs_url_format(resolved, buf, sizeof(buf)));
+        AVS_UNIT_ASSERT_EQUAL_STRING(buf, cases[i].expected);
+        avs_url_free(resolved);
+    }
+    avs_url_free(base);
+}
+
+AVS_UNIT_TEST(url_resolve, rfc3986_normal_examples) {
+    static const resolve_test_case_t CASES[] = {
+        { "g:h", "g:h" },
+        { "g", "http://a/b/c/g" },
+        { "./g", "http://a/b/c/g" },
+        { "g/", "http://a/b/c/g/" },
+        { "/g", "http://a/g" },
+        // avs_url always stores a non-empty path if the host is present
+        { "//g", "http://g/" },
+        { "?y", "http://a/b/c/d;p?y" },
+        { "g?y", "http://a/b/c/g?y" },
+        { "#s", "http://a/b/c/d;p?q#s" },
+        { "g#s", "http://a/b/c/g#s" },
+        { "g?y#s", "http://a/b/c/g?y#s" },
+        { ";x", "http://a/b/c/;x" },
+        { "g;x", "http://a/b/c/g;x" },
+        { "g;x?y#s", "http://a/b/c/g;x?y#s" },
+        { "", "http://a/b/c/d;p?q" },
+        { ".", "http://a/b/c/" },
+        { "./", "http://a/b/c/" },
+        { "..", "http://a/b/" },
+        { "../", "http://a/b/" },
+        { "../g", "http://a/b/g" },
+        { "../..", "http://a/" },
+        { "../../", "http://a/" },
+        { "../../g", "http://a/g" }
+    };
+    assert_resolved("http://a/b/c/d;p?q", CASES, AVS_ARRAY_SIZE(CASES));
+}
+
+AVS_UNIT_TEST(url_resolve, rfc3986_abnormal_examples) {
+    static const resolve_test_case_t CASES[] = {
+        { "../../../g", "http://a/g" },
+        { "../../../../g", "http://a/g" },
+        { "/./g", "http://a/g" },
+        { "/../g", "http://a/g" },
+        { "g.", "http://a/b/c/g." },
+        { ".g", "http://a/b/c/.g" },
+        { "g..", "http://a/b/c/g.." },
+        { "..g", "http://a/b/c/..g" },
+        { "./../g", "http://a/b/g" },
+        { "./g/.", "http://a/b/c/g/" },
+        { "g/./h", "http://a/b/c/g/h" },
+        { "g/../h", "http://a/b/c/h" },
+        { "g;x=1/./y", "http://a/b/c/g;x=1/y" },
+        { "g;x=1/../y", "http://a/b/c/y" },
+        { "g?y/./x", "http://a/b/c/g?y/./x" },
+        { "g?y/../x", "http://a/b/c/g?y/../x" },
+        { "g#s/./x", "http://a/b/c/g#s/./x" },
+        { "g#s/../x", "http://a/b/c/g#s/../x" },
+        { "http:g", "http:g" }
+    };
+    assert_resolved("http://a/b/c/d;p?q", CASES, AVS_ARRAY_SIZE(CASES));
+}
+
+AVS_UNIT_TEST(url_resolve, base_with_credentials_and_port) {
+    static const resolve_test_case_t CASES[] = {
+        { "/x?y", "https://us%40er:p%7Ess@[::1]:4433/x?y" },
+        { "//other/", "https://other/" }
+    };
+    assert_resolved("https://us%40er:p%7ess@[::1]:4433/a/b", CASES,
+                    AVS_ARRAY_SIZE(CASES));
+}
+
+AVS_UNIT_TEST(url_resolve, base_without_protocol) {
+    avs_url_t *base = avs_url_parse_lenient("//a/b");
+    AVS_UNIT_ASSERT_NOT_NULL(base);
+    AVS_UNIT_ASSERT_NULL(avs_url_resolve(base, "c"));
+    avs_url_free(base);
+}
+
+static void assert_normalized(const char *input, const char *expected) {
+    char buf[128];
+    avs_url_t *url = avs_url_parse_lenient(input);
+    AVS_UNIT_ASSERT_NOT_NULL(url);
+    avs_url_normalize(url);
+    AVS_UNIT_ASSERT_SUCCESS(avs_url_format(url, buf, sizeof(buf)));
+    AVS_UNIT_ASSERT_EQUAL_STRING(buf, expected);
+    avs_url_free(url);
+}
+
+AVS_UNIT_TEST(url_normalize, case_and_port) {
+    assert_normalized("HTTP://Example.COM:80/Path", "http://example.com/Path");
+    assert_normalized("https://example.com:0443/", "https://example.com/");
+    assert_normalized("https://example.com:80/", "https://example.com:80/");
+    assert_normalized("coaps://example.com:5684", "coaps://example.com/");
+    assert_normalized("foo://example.com:80/", "foo://example.com:80/");
+    assert_normalized("http://example.com:/", "http://example.com/");
+}
+
+AVS_UNIT_TEST(url_normalize, percent_encoding_and_dot_segments) {
+    assert_normalized("http://a/%7efoo/%2e%2E/b%2fc%3f?q=%4a%2a",
+                      "http://a/b%2Fc%3F?q=J%2A");
+    assert_normalized("http://a/./b/../c/.", "http://a/c/");
+    assert_normalized("http://a/b?x=/../y", "http://a/b?x=/../y");
+    assert_normalized("//a/../b", "//a/../b");
+}
+
+AVS_UNIT_TEST(url_build, all_components) {
+    char buf[128];
+    AVS_UNIT_ASSERT_SUCCESS(avs_url_build(
+            buf, sizeof(buf),
+            &(const avs_url_components_t) {
+                .protocol = "coaps",
+                .user = "user@domain",
+                .password = "p:ss word",
+                .host = "fe80::1",
+                .port = "5684",
+                .path = "/rd",
+                .query = "ep=name&lt=60"
+            }));
+    AVS_UNIT_ASSERT_EQUAL_STRING(
+            buf, "coaps://user%40domain:p%3Ass%20word@[fe80::1]:5684/rd?"
+                 "ep=name&lt=60");
+
+    avs_url_t *url = avs_url_parse(buf);
+    AVS_UNIT_ASSERT_NOT_NULL(url);
+    AVS_UNIT_ASSERT_EQUAL_STRING(avs_url_user(url), "user@domain");
+    AVS_UNIT_ASSERT_EQUAL_STRING(avs_url_password(url), "p:ss word");
+    AVS_UNIT_ASSERT_EQUAL_STRING(avs_url_host(url), "fe80::1");
+    AVS_UNIT_ASSERT_EQUAL_STRING(avs_url_path(url), "/rd?ep=name&lt=60");
+    avs_url_free(url);
+}
+
+AVS_UNIT_TEST(url_build, minimal) {
+    char buf[16];
+    AVS_UNIT_ASSERT_SUCCESS(avs_url_build(buf, sizeof(buf),
+                                          &(const avs_url_components_t) {
+                                              .path = "a/b"
+                                          }));
+    AVS_UNIT_ASSERT_EQUAL_STRING(buf, "a/b");
+    AVS_UNIT_ASSERT_SUCCESS(avs_url_build(buf, sizeof(buf),
+                                          &(const avs_url_components_t) {
+                                              .protocol = "http",
+                                              .host = "a"
+                                          }));
+    AVS_UNIT_ASSERT_EQUAL_STRING(buf, "http://a");
+}
+
+AVS_UNIT_TEST(url_build, invalid) {
+    char buf[64];
+    AVS_UNIT_ASSERT_FAILED(avs_url_build(buf, sizeof(buf),
+                                         &(const avs_url_components_t) {
+                                             .protocol = "http",
+                                             .port = "80",
+                                             .path = "/"
+                                         }));
+    AVS_UNIT_ASSERT_FAILED(avs_url_build(buf, sizeof(buf),
+                                         &(const avs_url_components_t) {
+                                             .protocol = "http",
+                                             .host = "a",
+                                             .path = "b"
+                                         }));
+}
+
+AVS_UNIT_TEST(url_build, buffer_too_small) {
+    static const char URL[] = "http://example.com/path";
+    avs_url_t *url = avs_url_parse(URL);
+    AVS_UNIT_ASSERT_NOT_NULL(url);
+    char buf[sizeof(URL)];
+    AVS_UNIT_ASSERT_FAILED(avs_url_format(url, buf, sizeof(buf) - 1));
+    AVS_UNIT_ASSERT_EQUAL(buf[sizeof(buf) - 2], '\0');
+    AVS_UNIT_ASSERT_FAILED(avs_url_format(url, NULL, 0));
+    AVS_UNIT_ASSERT_SUCCESS(avs_url_format(url, buf, sizeof(buf)));
+    AVS_UNIT_ASSERT_EQUAL_STRING(buf, URL);
+    avs_url_free(url);
+}
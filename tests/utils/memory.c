@@ -16,7 +16,11 @@
 
 #include <avs_commons_init.h>
 
+#include <stdbool.h>
+#include <string.h>
+
 #include <avsystem/commons/avs_defs.h>
+#include <avsystem/commons/avs_memory.h>
 #include <avsystem/commons/avs_unit_test.h>
 
 AVS_UNIT_TEST(align_pointer, correct_alignment) {
@@ -68,3 +72,111 @@ AVS_UNIT_TEST(aligned_stack_allocation, correct_alignment) {
     AVS_ALIGNED_VLA(char, D, 16, long double);
     AVS_UNIT_ASSERT_TRUE((unsigned long) D % AVS_ALIGNOF(long double) == 0);
 }
+
+#ifdef AVS_COMMONS_UTILS_WITH_STANDARD_ALLOCATOR_HOOKS
+static struct {
+    bool deny;
+    size_t allow_calls;
+    size_t last_size;
+    void *last_old_ptr;
+    void *last_new_ptr;
+    void *last_freed;
+} g_hook_calls;
+
+static bool test_allow_allocation(size_t size) {
+    ++g_hook_calls.allow_calls;
+    g_hook_calls.last_size = size;
+    return !g_hook_calls.deny;
+}
+
+static void test_allocated(void *old_ptr, void *new_ptr, size_t size) {
+    g_hook_calls.last_old_ptr = old_ptr;
+    g_hook_calls.last_new_ptr = new_ptr;
+    g_hook_calls.last_size = size;
+}
+
+static void test_freed(void *ptr) {
+    g_hook_calls.last_freed = ptr;
+}
+
+static const avs_memory_hooks_t TEST_HOOKS = {
+    .allow_allocation = test_allow_allocation,
+    .allocated = test_allocated,
+    .freed = test_freed
+};
+
+AVS_UNIT_TEST(memory_hooks, denied_allocations_fail) {
+    memset(&g_hook_calls, 0, sizeof(g_hook_calls));
+    g_hook_calls.deny = true;
+    avs_memory_set_hooks(&TEST_HOOKS);
+    void *malloced = avs_malloc(16);
+    void *calloced = avs_calloc(4, 8);
+    void *realloced = avs_realloc(NULL, 16);
+    avs_memory_set_hooks(NULL);
+
+    AVS_UNIT_ASSERT_NULL(malloced);
+    AVS_UNIT_ASSERT_NULL(calloced);
+    AVS_UNIT_ASSERT_NULL(realloced);
+    AVS_UNIT_ASSERT_EQUAL(g_hook_calls.allow_calls, 3);
+    AVS_UNIT_ASSERT_NULL(g_hook_calls.last_new_ptr);
+}
+
+AVS_UNIT_TEST(memory_hooks, allocations_are_reported) {
+    memset(&g_hook_calls, 0, sizeof(g_hook_calls));
+    avs_memory_set_hooks(&TEST_HOOKS);
+    void *ptr = avs_calloc(4, 8);
+    void *calloced = g_hook_calls.last_new_ptr;
+    size_t calloced_size = g_hook_calls.last_size;
+    void *calloced_old_ptr = g_hook_calls.last_old_ptr;
+
+    void *new_ptr = avs_realloc(ptr, 64);
+    void *realloced = g_hook_calls.last_new_ptr;
+    size_t realloced_size = g_hook_calls.last_size;
+    void *realloced_old_ptr = g_hook_calls.last_old_ptr;
+
+    avs_free(new_ptr);
+    avs_free(NULL);
+    avs_memory_set_hooks(NULL);
+
+    AVS_UNIT_ASSERT_NOT_NULL(ptr);
+    AVS_UNIT_ASSERT_TRUE(calloced == ptr);
+    AVS_UNIT_ASSERT_EQUAL(calloced_size, 32);
+    AVS_UNIT_ASSERT_NULL(calloced_old_ptr);
+
+    AVS_UNIT_ASSERT_NOT_NULL(new_ptr);
+    AVS_UNIT_ASSERT_TRUE(realloced == new_ptr);
+    AVS_UNIT_ASSERT_EQUAL(realloced_size, 64);
+    AVS_UNIT_ASSERT_TRUE(realloced_old_ptr == ptr);
+
+    // freeing NULL is not reported
+    AVS_UNIT_ASSERT_TRUE(g_hook_calls.last_freed == new_ptr);
+    AVS_UNIT_ASSERT_EQUAL(g_hook_calls.allow_calls, 2);
+}
+
+AVS_UNIT_TEST(memory_hooks, overflowing_calloc_is_not_reported) {
+    memset(&g_hook_calls, 0, sizeof(g_hook_calls));
+    avs_memory_set_hooks(&TEST_HOOKS);
+    void *ptr = avs_calloc(SIZE_MAX / 4 + 1, 8);
+    avs_memory_set_hooks(NULL);
+
+    AVS_UNIT_ASSERT_NULL(ptr);
+    AVS_UNIT_ASSERT_EQUAL(g_hook_calls.allow_calls, 0);
+    AVS_UNIT_ASSERT_NULL(g_hook_calls.last_new_ptr);
+}
+
+AVS_UNIT_TEST(memory_hooks, realloc_to_zero_is_reported_as_free) {
+    void *ptr = avs_malloc(16);
+    AVS_UNIT_ASSERT_NOT_NULL(ptr);
+
+    memset(&g_hook_calls, 0, sizeof(g_hook_calls));
+    g_hook_calls.deny = true;
+    avs_memory_set_hooks(&TEST_HOOKS);
+    void *result = avs_realloc(ptr, 0);
+    avs_memory_set_hooks(NULL);
+
+    // freeing is never denied
+    AVS_UNIT_ASSERT_EQUAL(g_hook_calls.allow_calls, 0);
+    AVS_UNIT_ASSERT_TRUE(g_hook_calls.last_freed == ptr);
+    avs_free(result);
+}
+#endif // AVS_COMMONS_UTILS_WITH_STANDARD_ALLOCATOR_HOOKS
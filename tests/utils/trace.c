@@ -0,0 +1,111 @@
+/*
+ * Copyright 2021 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <avsystem/commons/avs_unit_test.h>
+
+typedef struct {
+    char data[1024];
+    size_t size;
+} trace_output_t;
+
+static int write_to_output(void *output_, const char *data, size_t size) {
+    trace_output_t *output = (trace_output_t *) output_;
+    if (size >= sizeof(output->data) - output->size) {
+        return -1;
+    }
+    memcpy(output->data + output->size, data, size);
+    output->size += size;
+    output->data[output->size] = '\0';
+    return 0;
+}
+
+static size_t count_occurrences(const char *haystack, const char *needle) {
+    size_t result = 0;
+    while ((haystack = strstr(haystack, needle))) {
+        ++result;
+        ++haystack;
+    }
+    return result;
+}
+
+AVS_UNIT_TEST(trace, disabled) {
+    trace_output_t output = { "", 0 };
+    AVS_TRACE_BEGIN("test", "nothing");
+    AVS_TRACE_END("test", "nothing");
+    AVS_UNIT_ASSERT_NULL(g_rings);
+    AVS_UNIT_ASSERT_FAILED(
+            avs_trace_export_chrome_json(write_to_output, &output));
+    AVS_UNIT_ASSERT_FAILED(avs_trace_init(0));
+}
+
+AVS_UNIT_TEST(trace, export) {
+    trace_output_t output = { "", 0 };
+    AVS_UNIT_ASSERT_SUCCESS(avs_trace_init(3));
+    AVS_UNIT_ASSERT_EQUAL(g_capacity, 4);
+    AVS_UNIT_ASSERT_FAILED(avs_trace_init(3));
+
+    AVS_TRACE_BEGIN("test", "outer");
+    AVS_TRACE_BEGIN("test", "with \"quotes\"");
+    AVS_TRACE_END("test", "with \"quotes\"");
+    AVS_TRACE_END("test", "outer");
+
+    AVS_UNIT_ASSERT_SUCCESS(
+            avs_trace_export_chrome_json(write_to_output, &output));
+    AVS_UNIT_ASSERT_EQUAL(strncmp(output.data, "{\"traceEvents\":[{", 17), 0);
+    AVS_UNIT_ASSERT_EQUAL(count_occurrences(output.data, "\"tid\":1}"), 4);
+    AVS_UNIT_ASSERT_EQUAL(count_occurrences(output.data, "\"ph\":\"B\""), 2);
+    AVS_UNIT_ASSERT_EQUAL(count_occurrences(output.data, "\"ph\":\"E\""), 2);
+    AVS_UNIT_ASSERT_EQUAL(
+            count_occurrences(output.data, "\"name\":\"with \\\"quotes\\\"\""),
+            2);
+    AVS_UNIT_ASSERT_NOT_NULL(strstr(output.data, "\"name\":\"outer\""));
+    AVS_UNIT_ASSERT_NOT_NULL(
+            strstr(output.data, "],\"displayTimeUnit\":\"ns\"}\n"));
+
+    avs_trace_cleanup();
+    AVS_UNIT_ASSERT_NULL(g_rings);
+}
+
+AVS_UNIT_TEST(trace, ring_overflow) {
+    trace_output_t output = { "", 0 };
+    AVS_UNIT_ASSERT_SUCCESS(avs_trace_init(2));
+
+    AVS_TRACE_BEGIN("test", "first");
+    AVS_TRACE_END("test", "first");
+    AVS_TRACE_BEGIN("test", "second");
+    AVS_TRACE_END("test", "second");
+
+    AVS_UNIT_ASSERT_SUCCESS(
+            avs_trace_export_chrome_json(write_to_output, &output));
+    AVS_UNIT_ASSERT_NULL(strstr(output.data, "first"));
+    AVS_UNIT_ASSERT_EQUAL(count_occurrences(output.data, "\"second\""), 2);
+
+    // too small output buffer
+    output.size = sizeof(output.data) - 16;
+    AVS_UNIT_ASSERT_FAILED(
+            avs_trace_export_chrome_json(write_to_output, &output));
+
+    avs_trace_cleanup();
+
+    // ring buffers are reallocated after reinitialization
+    output.size = 0;
+    AVS_UNIT_ASSERT_SUCCESS(avs_trace_init(2));
+    AVS_TRACE_BEGIN("test", "third");
+    AVS_UNIT_ASSERT_SUCCESS(
+            avs_trace_export_chrome_json(write_to_output, &output));
+    AVS_UNIT_ASSERT_EQUAL(count_occurrences(output.data, "\"name\":"), 1);
+    avs_trace_cleanup();
+}
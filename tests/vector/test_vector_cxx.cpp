@@ -15,3 +15,178 @@
  */
 
 #include "src/vector/avs_vector.c"
+
+#include <algorithm>
+#include <string>
+
+#include <avsystem/commons/avs_utils.h>
+#include <avsystem/commons/avs_vector_cxx.hpp>
+
+/* std::string is not trivially relocatable when it uses the small string
+ * optimization, so a simple heap-allocated string is used instead */
+class HeapString {
+    char *str_;
+
+public:
+    HeapString(const char *str) : str_(avs_strdup(str)) {}
+
+    HeapString(const HeapString &other) : str_(avs_strdup(other.str_)) {}
+
+    ~HeapString() {
+        avs_free(str_);
+    }
+
+    const char *c_str() const {
+        return str_;
+    }
+
+    size_t size() const {
+        return strlen(str_);
+    }
+
+private:
+    HeapString &operator=(const HeapString &);
+};
+
+AVS_UNIT_TEST(avsVector, push_and_access) {
+    avs::Vector<HeapString> vec;
+    AVS_UNIT_ASSERT_TRUE(vec.empty());
+    AVS_UNIT_ASSERT_TRUE(vec.begin() == vec.end());
+
+    for (int i = 0; i < 100; ++i) {
+        std::string value(static_cast<size_t>(i), 'x');
+        AVS_UNIT_ASSERT_TRUE(vec.push_back(value.c_str()) != vec.end());
+    }
+    AVS_UNIT_ASSERT_EQUAL(vec.size(), 100);
+    AVS_UNIT_ASSERT_EQUAL(AVS_VECTOR_SIZE(vec.get()), 100);
+    for (size_t i = 0; i < vec.size(); ++i) {
+        AVS_UNIT_ASSERT_EQUAL(vec[i].size(), i);
+    }
+
+    avs::Vector<HeapString>::iterator it = vec.erase(vec.begin() + 10);
+    AVS_UNIT_ASSERT_EQUAL(it->size(), 11);
+    AVS_UNIT_ASSERT_EQUAL(vec.size(), 99);
+    vec.pop_back();
+    AVS_UNIT_ASSERT_EQUAL(vec.back().size(), 98);
+
+    it = vec.insert(vec.begin() + 10, "0123456789");
+    AVS_UNIT_ASSERT_EQUAL_STRING(it->c_str(), "0123456789");
+    AVS_UNIT_ASSERT_EQUAL(vec[9].size(), 9);
+    AVS_UNIT_ASSERT_EQUAL(vec[11].size(), 11);
+}
+
+AVS_UNIT_TEST(avsVector, sorted_operations) {
+    avs::Vector<int> vec;
+    for (int i = 0; i < 50; ++i) {
+        vec.push_back((i * 37) % 50);
+    }
+    vec.sort();
+    for (int i = 0; i < 50; ++i) {
+        AVS_UNIT_ASSERT_EQUAL(vec[static_cast<size_t>(i)], i);
+    }
+
+    vec.sort(std::greater<int>());
+    AVS_UNIT_ASSERT_EQUAL(vec.front(), 49);
+    AVS_UNIT_ASSERT_EQUAL(vec.back(), 0);
+    vec.sort();
+
+    AVS_UNIT_ASSERT_EQUAL(*vec.lower_bound(20), 20);
+    AVS_UNIT_ASSERT_EQUAL(*vec.upper_bound(20), 21);
+    AVS_UNIT_ASSERT_TRUE(vec.upper_bound(49) == vec.end());
+
+    AVS_UNIT_ASSERT_EQUAL(*vec.insert_sorted(20), 20);
+    AVS_UNIT_ASSERT_EQUAL(*vec.insert_sorted(100), 100);
+    AVS_UNIT_ASSERT_EQUAL(*vec.insert_sorted(-1), -1);
+    AVS_UNIT_ASSERT_EQUAL(vec.size(), 53);
+    for (size_t i = 1; i < vec.size(); ++i) {
+        AVS_UNIT_ASSERT_TRUE(vec[i - 1] <= vec[i]);
+    }
+}
+
+AVS_UNIT_TEST(avsVector, binary_search_with_duplicates) {
+    for (int size = 0; size < 20; ++size) {
+        avs::Vector<int> vec;
+        for (int i = 0; i < size; ++i) {
+            // every value appears twice: 0, 0, 2, 2, 4, 4, ...
+            vec.push_back(i / 2 * 2);
+        }
+        for (int value = -1; value <= size + 1; ++value) {
+            AVS_UNIT_ASSERT_TRUE(vec.lower_bound(value)
+                                 == std::lower_bound(vec.begin(), vec.end(),
+                                                     value));
+            AVS_UNIT_ASSERT_TRUE(vec.upper_bound(value)
+                                 == std::upper_bound(vec.begin(), vec.end(),
+                                                     value));
+        }
+    }
+}
+
+AVS_UNIT_TEST(avsVector, self_aliasing_insert) {
+    avs::Vector<HeapString> vec;
+    vec.push_back("first");
+    // some of these insertions reallocate the vector
+    for (int i = 0; i < 40; ++i) {
+        AVS_UNIT_ASSERT_TRUE(vec.push_back(vec[0]) != vec.end());
+    }
+    AVS_UNIT_ASSERT_EQUAL(vec.size(), 41);
+    for (size_t i = 0; i < vec.size(); ++i) {
+        AVS_UNIT_ASSERT_EQUAL_STRING(vec[i].c_str(), "first");
+    }
+
+    // the inserted value is shifted to make room for itself
+    vec.back().~HeapString();
+    new (&vec.back()) HeapString("last");
+    AVS_UNIT_ASSERT_TRUE(vec.insert(vec.begin(), vec.back()) != vec.end());
+    AVS_UNIT_ASSERT_EQUAL_STRING(vec.front().c_str(), "last");
+    AVS_UNIT_ASSERT_EQUAL_STRING(vec[1].c_str(), "first");
+    AVS_UNIT_ASSERT_EQUAL_STRING(vec.back().c_str(), "last");
+    AVS_UNIT_ASSERT_TRUE(vec.insert(vec.begin() + 1, vec[1]) != vec.end());
+    AVS_UNIT_ASSERT_EQUAL_STRING(vec[1].c_str(), "first");
+    AVS_UNIT_ASSERT_EQUAL(vec.size(), 43);
+
+    avs::Vector<int> sorted;
+    for (int i = 0; i < 40; ++i) {
+        AVS_UNIT_ASSERT_TRUE(sorted.insert_sorted(i) != sorted.end());
+        AVS_UNIT_ASSERT_TRUE(sorted.insert_sorted(sorted[0]) != sorted.end());
+    }
+    AVS_UNIT_ASSERT_EQUAL(sorted.size(), 80);
+    AVS_UNIT_ASSERT_EQUAL(sorted[40], 0);
+    AVS_UNIT_ASSERT_EQUAL(sorted[41], 1);
+}
+
+AVS_UNIT_TEST(avsVector, adopt_and_release) {
+    AVS_VECTOR(int) c_vec = AVS_VECTOR_NEW(int);
+    int value = 42;
+    AVS_UNIT_ASSERT_SUCCESS(AVS_VECTOR_PUSH(&c_vec, &value));
+    {
+        avs::Vector<int> vec(c_vec);
+        AVS_UNIT_ASSERT_EQUAL(vec.size(), 1);
+        AVS_UNIT_ASSERT_EQUAL(vec[0], 42);
+        vec.push_back(43);
+        c_vec = vec.release();
+    }
+    AVS_UNIT_ASSERT_EQUAL(AVS_VECTOR_SIZE(c_vec), 2);
+    AVS_UNIT_ASSERT_EQUAL(*AVS_VECTOR_BACK(c_vec), 43);
+    AVS_VECTOR_DELETE(&c_vec);
+}
+
+#if __cplusplus >= 201103L
+#    include <memory>
+
+AVS_UNIT_TEST(avsVector, move_only) {
+    avs::Vector<std::unique_ptr<int> > vec;
+    for (int i = 0; i < 20; ++i) {
+        AVS_UNIT_ASSERT_TRUE(vec.emplace_back(new int(i)) != vec.end());
+    }
+    vec.insert(vec.begin(), std::unique_ptr<int>(new int(-1)));
+    vec.erase(vec.begin() + 5);
+    AVS_UNIT_ASSERT_EQUAL(vec.size(), 20);
+    AVS_UNIT_ASSERT_EQUAL(*vec.front(), -1);
+    AVS_UNIT_ASSERT_EQUAL(*vec[5], 5);
+    AVS_UNIT_ASSERT_EQUAL(*vec.back(), 19);
+
+    avs::Vector<std::unique_ptr<int> > moved(std::move(vec));
+    AVS_UNIT_ASSERT_TRUE(vec.empty());
+    AVS_UNIT_ASSERT_EQUAL(moved.size(), 20);
+}
+#endif
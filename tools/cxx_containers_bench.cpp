@@ -0,0 +1,220 @@
+/*
+ * Copyright 2021 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Benchmark of the C++ container wrappers (avs::RbTree, avs::Vector), which
+ * inline the comparator, against the equivalent AVS_RBTREE / AVS_VECTOR macros
+ * that call it through a function pointer:
+ * - tree insertion: avs::RbTree::insert vs. AVS_RBTREE_INSERT,
+ * - tree lookup: avs::RbTree::find vs. AVS_RBTREE_FIND,
+ * - sorting: avs::Vector::sort vs. AVS_VECTOR_SORT,
+ * - binary search: avs::Vector::lower_bound vs. bsearch() on AVS_VECTOR data,
+ *   as AVS_VECTOR has no search operation of its own.
+ *
+ * All operations use the same pseudo-random int keys. Lookups are repeated
+ * ROUNDS times and the fastest round is reported.
+ *
+ * Example build, using an avs_commons build directory:
+ *
+ *   c++ -O2 -I<build>/include_public -Iinclude_public \
+ *       tools/cxx_containers_bench.cpp -L<build>/output/lib \
+ *       -lavs_rbtree -lavs_vector -lavs_utils -lm -o cxx_containers_bench
+ *
+ * Usage: cxx_containers_bench [ELEMENTS [LOOKUPS]]
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include <avsystem/commons/avs_rbtree_cxx.hpp>
+#include <avsystem/commons/avs_time.h>
+#include <avsystem/commons/avs_vector_cxx.hpp>
+
+namespace {
+
+// lookups are repeated, alternating between C++ and C, and the fastest round
+// is reported, to reduce the influence of noise
+const unsigned ROUNDS = 5;
+
+volatile std::size_t g_sink;
+
+double min_time(double best, double current) {
+    return best == 0.0 || current < best ? current : best;
+}
+
+int int_cmp(const void *a_, const void *b_) {
+    int a = *static_cast<const int *>(a_);
+    int b = *static_cast<const int *>(b_);
+    return a < b ? -1 : (a > b ? 1 : 0);
+}
+
+double elapsed_since(avs_time_monotonic_t start) {
+    return avs_time_duration_to_fscalar(
+            avs_time_monotonic_diff(avs_time_monotonic_now(), start),
+            AVS_TIME_S);
+}
+
+void report(const char *name, std::size_t ops, double cxx, double c) {
+    std::printf("%-14s %9lu ops: C++ %9.3f ms, C %9.3f ms, speedup %5.2fx\n",
+                name, static_cast<unsigned long>(ops), cxx * 1e3, c * 1e3,
+                c / cxx);
+}
+
+std::vector<int> random_keys(std::size_t count, unsigned seed) {
+    std::vector<int> keys(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        // xorshift32, so that results do not depend on the libc rand()
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        keys[i] = static_cast<int>(seed & 0x7FFFFFFF);
+    }
+    return keys;
+}
+
+void bench_rbtree(const std::vector<int> &keys,
+                  const std::vector<int> &lookups) {
+    avs::RbTree<int> cxx_tree;
+    avs_time_monotonic_t start = avs_time_monotonic_now();
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+        cxx_tree.insert(keys[i]);
+    }
+    double cxx_insert = elapsed_since(start);
+
+    AVS_RBTREE(int) c_tree = AVS_RBTREE_NEW(int, int_cmp);
+    if (!c_tree) {
+        std::abort();
+    }
+    start = avs_time_monotonic_now();
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+        AVS_RBTREE_ELEM(int) elem = AVS_RBTREE_ELEM_NEW(int);
+        if (!elem) {
+            std::abort();
+        }
+        *elem = keys[i];
+        if (AVS_RBTREE_INSERT(c_tree, elem) != elem) {
+            AVS_RBTREE_ELEM_DELETE_DETACHED(&elem);
+        }
+    }
+    double c_insert = elapsed_since(start);
+    if (AVS_RBTREE_SIZE(c_tree) != cxx_tree.size()) {
+        std::abort();
+    }
+    report("rbtree insert", keys.size(), cxx_insert, c_insert);
+
+    double cxx_find = 0.0;
+    double c_find = 0.0;
+    for (unsigned round = 0; round < ROUNDS; ++round) {
+        std::size_t found = 0;
+        start = avs_time_monotonic_now();
+        for (std::size_t i = 0; i < lookups.size(); ++i) {
+            found += (cxx_tree.find(lookups[i]) != cxx_tree.end());
+        }
+        cxx_find = min_time(cxx_find, elapsed_since(start));
+
+        std::size_t c_found = 0;
+        start = avs_time_monotonic_now();
+        for (std::size_t i = 0; i < lookups.size(); ++i) {
+            c_found += (AVS_RBTREE_FIND(c_tree, &lookups[i]) != NULL);
+        }
+        c_find = min_time(c_find, elapsed_since(start));
+        if (found != c_found) {
+            std::abort();
+        }
+        g_sink += found;
+    }
+    report("rbtree find", lookups.size(), cxx_find, c_find);
+
+    AVS_RBTREE_DELETE(&c_tree);
+}
+
+void bench_vector(const std::vector<int> &keys,
+                  const std::vector<int> &lookups) {
+    avs::Vector<int> cxx_vec;
+    AVS_VECTOR(int) c_vec = AVS_VECTOR_NEW(int);
+    if (!c_vec || !cxx_vec.reserve(keys.size())
+            || AVS_VECTOR_RESERVE(&c_vec, keys.size())) {
+        std::abort();
+    }
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+        int key = keys[i];
+        if (cxx_vec.push_back(key) == cxx_vec.end()
+                || AVS_VECTOR_PUSH(&c_vec, &key)) {
+            std::abort();
+        }
+    }
+
+    avs_time_monotonic_t start = avs_time_monotonic_now();
+    cxx_vec.sort();
+    double cxx_sort = elapsed_since(start);
+
+    start = avs_time_monotonic_now();
+    AVS_VECTOR_SORT(&c_vec, int_cmp);
+    double c_sort = elapsed_since(start);
+    report("vector sort", keys.size(), cxx_sort, c_sort);
+
+    double cxx_search = 0.0;
+    double c_search = 0.0;
+    for (unsigned round = 0; round < ROUNDS; ++round) {
+        std::size_t found = 0;
+        start = avs_time_monotonic_now();
+        for (std::size_t i = 0; i < lookups.size(); ++i) {
+            avs::Vector<int>::iterator it = cxx_vec.lower_bound(lookups[i]);
+            found += (it != cxx_vec.end() && *it == lookups[i]);
+        }
+        cxx_search = min_time(cxx_search, elapsed_since(start));
+
+        std::size_t c_found = 0;
+        start = avs_time_monotonic_now();
+        for (std::size_t i = 0; i < lookups.size(); ++i) {
+            c_found += (std::bsearch(&lookups[i], *c_vec,
+                                     AVS_VECTOR_SIZE(c_vec), sizeof(int),
+                                     int_cmp)
+                        != NULL);
+        }
+        c_search = min_time(c_search, elapsed_since(start));
+        if (found != c_found) {
+            std::abort();
+        }
+        g_sink += found;
+    }
+    report("vector search", lookups.size(), cxx_search, c_search);
+
+    AVS_VECTOR_DELETE(&c_vec);
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    std::size_t elements = 1000000;
+    std::size_t lookup_count = 1000000;
+    if (argc > 1) {
+        elements = std::strtoul(argv[1], NULL, 10);
+    }
+    if (argc > 2) {
+        lookup_count = std::strtoul(argv[2], NULL, 10);
+    }
+    std::vector<int> keys = random_keys(elements, 2463534242u);
+    // half of the lookups hit existing keys
+    std::vector<int> lookups = random_keys(lookup_count, 88675123u);
+    for (std::size_t i = 0; i < lookups.size(); i += 2) {
+        lookups[i] = keys[lookups[i] % keys.size()];
+    }
+    bench_rbtree(keys, lookups);
+    bench_vector(keys, lookups);
+    return 0;
+}
@@ -0,0 +1,286 @@
+/*
+ * Copyright 2021 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Benchmark of batching DTLS records using AVS_NET_SOCKET_OPT_CORK.
+ *
+ * An avs_net DTLS client sends MESSAGES messages of SIZE bytes each, in bursts
+ * of BURST messages, to a forked child process running a plain OpenSSL DTLS
+ * server over the loopback interface. The server acknowledges each burst, so
+ * that no datagrams are lost. Each burst is sent either:
+ * - "uncorked": one record per datagram,
+ * - "corked": with AVS_NET_SOCKET_OPT_CORK enabled for the duration of the
+ *   burst.
+ *
+ * Reported are: messages and datagrams per second, and the average number of
+ * records per datagram, as observed by the server.
+ *
+ * Example build, using an avs_commons build directory with the OpenSSL
+ * backend:
+ *
+ *   cc -O2 -std=gnu99 -I<build>/include_public -Iinclude_public \
+ *       tools/dtls_cork_bench.c -L<build>/output/lib \
+ *       -lavs_net_openssl -lavs_crypto_openssl -lavs_stream -lavs_buffer \
+ *       -lavs_log -lavs_compat_threading_pthread -lavs_list -lavs_utils \
+ *       -lssl -lcrypto -lpthread -lm -o dtls_cork_bench
+ *
+ * Usage: dtls_cork_bench [MESSAGES [BURST [SIZE]]]
+ */
+
+#define _GNU_SOURCE
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <openssl/bio.h>
+#include <openssl/ssl.h>
+
+#include <avsystem/commons/avs_prng.h>
+#include <avsystem/commons/avs_socket.h>
+#include <avsystem/commons/avs_time.h>
+
+#define PSK_IDENTITY "bench"
+#define PSK_KEY "0123456789abcdef"
+
+#define MAX_MESSAGE_SIZE 1024
+
+static unsigned long g_datagrams_received;
+
+static unsigned int server_psk_cb(SSL *ssl,
+                                  const char *identity,
+                                  unsigned char *psk,
+                                  unsigned int max_psk_len) {
+    (void) ssl;
+    if (strcmp(identity, PSK_IDENTITY)
+            || max_psk_len < sizeof(PSK_KEY) - 1) {
+        return 0;
+    }
+    memcpy(psk, PSK_KEY, sizeof(PSK_KEY) - 1);
+    return sizeof(PSK_KEY) - 1;
+}
+
+static long count_datagrams_cb(BIO *bio,
+                               int oper,
+                               const char *argp,
+                               size_t len,
+                               int argi,
+                               long argl,
+                               int ret,
+                               size_t *processed) {
+    (void) bio;
+    (void) argp;
+    (void) len;
+    (void) argi;
+    (void) argl;
+    (void) processed;
+    if (oper == (BIO_CB_READ | BIO_CB_RETURN) && ret > 0) {
+        ++g_datagrams_received;
+    }
+    return ret;
+}
+
+/* receives all messages, acknowledging each burst, and writes the number of
+ * datagrams received to result_fd */
+static void run_server(int fd, int result_fd, unsigned messages,
+                       unsigned burst) {
+    struct sockaddr_storage peer;
+    socklen_t peer_length = sizeof(peer);
+    char byte;
+    if (recvfrom(fd, &byte, 1, MSG_PEEK, (struct sockaddr *) &peer,
+                 &peer_length)
+                    < 0
+            || connect(fd, (struct sockaddr *) &peer, peer_length)) {
+        _exit(1);
+    }
+
+    SSL_CTX *ctx = SSL_CTX_new(DTLS_server_method());
+    if (!ctx || !SSL_CTX_set_cipher_list(ctx, "PSK")) {
+        _exit(1);
+    }
+    SSL_CTX_set_psk_server_callback(ctx, server_psk_cb);
+    SSL *ssl = SSL_new(ctx);
+    BIO *bio = BIO_new_dgram(fd, BIO_NOCLOSE);
+    if (!ssl || !bio) {
+        _exit(1);
+    }
+    BIO_set_callback_ex(bio, count_datagrams_cb);
+    SSL_set_bio(ssl, bio, bio);
+    if (SSL_accept(ssl) <= 0) {
+        _exit(1);
+    }
+    g_datagrams_received = 0;
+
+    char buf[MAX_MESSAGE_SIZE];
+    for (unsigned i = 1; i <= messages; ++i) {
+        if (SSL_read(ssl, buf, sizeof(buf)) <= 0) {
+            _exit(1);
+        }
+        if (!(i % burst) || i == messages) {
+            SSL_write(ssl, "", 1);
+        }
+    }
+    if (write(result_fd, &g_datagrams_received, sizeof(g_datagrams_received))
+            != (ssize_t) sizeof(g_datagrams_received)) {
+        _exit(1);
+    }
+    SSL_free(ssl);
+    SSL_CTX_free(ctx);
+    _exit(0);
+}
+
+static int set_cork(avs_net_socket_t *socket, bool enabled) {
+    avs_net_socket_opt_value_t value = {
+        .flag = enabled
+    };
+    return avs_is_ok(avs_net_socket_set_opt(socket, AVS_NET_SOCKET_OPT_CORK,
+                                            value))
+                   ? 0
+                   : -1;
+}
+
+static int run_client(const char *port,
+                      bool corked,
+                      unsigned messages,
+                      unsigned burst,
+                      size_t size,
+                      double *out_seconds) {
+    avs_crypto_prng_ctx_t *prng = avs_crypto_prng_new(NULL, NULL);
+    avs_net_ssl_configuration_t config = {
+        .version = AVS_NET_SSL_VERSION_TLSv1_2,
+        .security = avs_net_security_info_from_psk((avs_net_psk_info_t) {
+            .psk = PSK_KEY,
+            .psk_size = sizeof(PSK_KEY) - 1,
+            .identity = PSK_IDENTITY,
+            .identity_size = sizeof(PSK_IDENTITY) - 1
+        }),
+        .backend_configuration = {
+            .address_family = AVS_NET_AF_INET4
+        },
+        .prng_ctx = prng
+    };
+    avs_net_socket_t *socket = NULL;
+    int result = -1;
+    if (!prng || avs_is_err(avs_net_dtls_socket_create(&socket, &config))
+            || avs_is_err(avs_net_socket_connect(socket, "127.0.0.1", port))) {
+        fprintf(stderr, "could not connect\n");
+        goto finish;
+    }
+
+    char message[MAX_MESSAGE_SIZE];
+    memset(message, 'x', size);
+    avs_time_monotonic_t start = avs_time_monotonic_now();
+    for (unsigned sent = 0; sent < messages;) {
+        if (corked && set_cork(socket, true)) {
+            goto finish;
+        }
+        for (unsigned i = 0; i < burst && sent < messages; ++i, ++sent) {
+            if (avs_is_err(avs_net_socket_send(socket, message, size))) {
+                fprintf(stderr, "send failed\n");
+                goto finish;
+            }
+        }
+        if (corked && set_cork(socket, false)) {
+            goto finish;
+        }
+        char ack;
+        size_t received;
+        if (avs_is_err(avs_net_socket_receive(socket, &received, &ack, 1))) {
+            fprintf(stderr, "receive failed\n");
+            goto finish;
+        }
+    }
+    *out_seconds = avs_time_duration_to_fscalar(
+            avs_time_monotonic_diff(avs_time_monotonic_now(), start),
+            AVS_TIME_S);
+    result = 0;
+finish:
+    avs_net_socket_cleanup(&socket);
+    avs_crypto_prng_free(&prng);
+    return result;
+}
+
+static int
+run_mode(bool corked, unsigned messages, unsigned burst, size_t size) {
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in addr;
+    socklen_t addr_length = sizeof(addr);
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    int result_pipe[2];
+    if (fd < 0 || bind(fd, (struct sockaddr *) &addr, sizeof(addr))
+            || getsockname(fd, (struct sockaddr *) &addr, &addr_length)
+            || pipe(result_pipe)) {
+        perror("could not create server socket");
+        return -1;
+    }
+    char port[16];
+    snprintf(port, sizeof(port), "%u", (unsigned) ntohs(addr.sin_port));
+
+    fflush(stdout);
+    pid_t child = fork();
+    if (child < 0) {
+        perror("fork");
+        return -1;
+    } else if (!child) {
+        close(result_pipe[0]);
+        run_server(fd, result_pipe[1], messages, burst);
+    }
+    close(fd);
+    close(result_pipe[1]);
+
+    double seconds = 0.0;
+    int result = run_client(port, corked, messages, burst, size, &seconds);
+    unsigned long datagrams = 0;
+    if (read(result_pipe[0], &datagrams, sizeof(datagrams))
+            != (ssize_t) sizeof(datagrams)) {
+        result = -1;
+    }
+    close(result_pipe[0]);
+    waitpid(child, NULL, 0);
+    if (result) {
+        return result;
+    }
+
+    printf("%-10s %14.0f %14.0f %12.2f\n", corked ? "corked" : "uncorked",
+           (double) messages / seconds, (double) datagrams / seconds,
+           datagrams ? (double) messages / (double) datagrams : 0.0);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    unsigned messages = argc > 1 ? (unsigned) atoi(argv[1]) : 100000;
+    unsigned burst = argc > 2 ? (unsigned) atoi(argv[2]) : 10;
+    size_t size = argc > 3 ? (size_t) atoi(argv[3]) : 32;
+    if (!messages || !burst || !size || size > MAX_MESSAGE_SIZE) {
+        fprintf(stderr, "Usage: %s [MESSAGES [BURST [SIZE]]]\n", argv[0]);
+        return 1;
+    }
+    printf("%u messages of %u bytes, in bursts of %u\n", messages,
+           (unsigned) size, burst);
+    printf("%-10s %14s %14s %12s\n", "mode", "messages/s", "datagrams/s",
+           "msgs/dgram");
+    int result = 0;
+    result |= run_mode(false, messages, burst, size);
+    result |= run_mode(true, messages, burst, size);
+    return result ? 1 : 0;
+}
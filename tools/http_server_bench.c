@@ -0,0 +1,179 @@
+/*
+ * Copyright 2021 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Requests-per-second benchmark of avs_http_server over loopback.
+ *
+ * The server runs in the main thread, driven by avs_http_server_wait() and
+ * avs_sched_run(). Each client thread opens a single keep-alive connection and
+ * issues GET requests sequentially, waiting for each response. Optionally,
+ * every client may pipeline several requests at once.
+ *
+ * Example build, using an avs_commons build directory with
+ * WITH_AVS_HTTP_SERVER enabled and without TLS:
+ *
+ *   cc -O2 -std=gnu99 -I<build>/include_public -Iinclude_public \
+ *       tools/http_server_bench.c -L<build>/output/lib \
+ *       -lavs_http -lavs_sched -lavs_url -lavs_stream_net -lavs_stream_md5 \
+ *       -lavs_stream -lavs_net_nosec -lavs_buffer -lavs_algorithm -lavs_log \
+ *       -lavs_compat_threading_pthread -lavs_list -lavs_utils -lcrypto -lz \
+ *       -lpthread -lm -o http_server_bench
+ *
+ * Usage: http_server_bench [CLIENTS [REQUESTS_PER_CLIENT [PIPELINE_DEPTH]]]
+ */
+
+#define _GNU_SOURCE
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <avsystem/commons/avs_http_server.h>
+#include <avsystem/commons/avs_log.h>
+
+static const char REQUEST[] = "GET /hello HTTP/1.1\r\n"
+                              "Host: localhost\r\n"
+                              "\r\n";
+static const char RESPONSE[] = "HTTP/1.1 200 OK\r\n"
+                               "Content-Type: text/plain\r\n"
+                               "Content-Length: 5\r\n"
+                               "\r\n"
+                               "Hello";
+
+static size_t g_clients = 4;
+static size_t g_requests_per_client = 20000;
+static size_t g_pipeline_depth = 1;
+static uint16_t g_port;
+static volatile size_t g_clients_done;
+
+static avs_error_t hello_handler(avs_http_server_request_t *request,
+                                 void *arg) {
+    (void) arg;
+    return avs_http_server_respond(request, 200, "text/plain", "Hello", 5);
+}
+
+static int read_exactly(int fd, char *buf, size_t size) {
+    while (size) {
+        ssize_t result = recv(fd, buf, size, 0);
+        if (result <= 0) {
+            return -1;
+        }
+        buf += result;
+        size -= (size_t) result;
+    }
+    return 0;
+}
+
+static void *client_thread(void *unused) {
+    (void) unused;
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(g_port),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK)
+    };
+    if (connect(fd, (struct sockaddr *) &addr, sizeof(addr))) {
+        perror("connect");
+        abort();
+    }
+    size_t request_size = sizeof(REQUEST) - 1;
+    size_t response_size = sizeof(RESPONSE) - 1;
+    char *requests = (char *) malloc(request_size * g_pipeline_depth);
+    char *responses = (char *) malloc(response_size * g_pipeline_depth);
+    for (size_t i = 0; i < g_pipeline_depth; ++i) {
+        memcpy(requests + i * request_size, REQUEST, request_size);
+    }
+    for (size_t i = 0; i < g_requests_per_client; i += g_pipeline_depth) {
+        if (send(fd, requests, request_size * g_pipeline_depth, 0)
+                        != (ssize_t) (request_size * g_pipeline_depth)
+                || read_exactly(fd, responses,
+                                response_size * g_pipeline_depth)
+                || memcmp(responses, RESPONSE, response_size)) {
+            fprintf(stderr, "unexpected response\n");
+            abort();
+        }
+    }
+    free(requests);
+    free(responses);
+    close(fd);
+    __atomic_add_fetch(&g_clients_done, 1, __ATOMIC_RELAXED);
+    return NULL;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc > 1) {
+        g_clients = (size_t) strtoul(argv[1], NULL, 10);
+    }
+    if (argc > 2) {
+        g_requests_per_client = (size_t) strtoul(argv[2], NULL, 10);
+    }
+    if (argc > 3) {
+        g_pipeline_depth = (size_t) strtoul(argv[3], NULL, 10);
+    }
+    if (!g_pipeline_depth) {
+        g_pipeline_depth = 1;
+    }
+    avs_log_set_default_level(AVS_LOG_WARNING);
+
+    avs_sched_t *sched = avs_sched_new("http_server_bench", NULL);
+    avs_http_server_t *server = avs_http_server_new(
+            sched, &(const avs_http_server_config_t) {
+                       .address = "127.0.0.1",
+                       .max_connections = g_clients
+                   });
+    char port[sizeof("65535")];
+    if (!server
+            || avs_http_server_add_route(server, "GET", "/hello",
+                                         hello_handler, NULL)
+            || avs_is_err(avs_http_server_get_local_port(server, port,
+                                                         sizeof(port)))) {
+        fprintf(stderr, "could not start server\n");
+        return 1;
+    }
+    g_port = (uint16_t) atoi(port);
+
+    avs_time_monotonic_t start = avs_time_monotonic_now();
+    pthread_t *clients = (pthread_t *) calloc(g_clients, sizeof(pthread_t));
+    for (size_t i = 0; i < g_clients; ++i) {
+        pthread_create(&clients[i], NULL, client_thread, NULL);
+    }
+    while (__atomic_load_n(&g_clients_done, __ATOMIC_RELAXED) < g_clients) {
+        avs_http_server_wait(server,
+                             avs_time_duration_from_scalar(10, AVS_TIME_MS));
+        avs_sched_run(sched);
+    }
+    double elapsed = avs_time_duration_to_fscalar(
+            avs_time_monotonic_diff(avs_time_monotonic_now(), start),
+            AVS_TIME_S);
+    for (size_t i = 0; i < g_clients; ++i) {
+        pthread_join(clients[i], NULL);
+    }
+    free(clients);
+
+    printf("%zu clients, pipeline depth %zu: %.0f requests/s\n", g_clients,
+           g_pipeline_depth,
+           (double) (g_clients * g_requests_per_client) / elapsed);
+    avs_http_server_cleanup(&server);
+    avs_sched_cleanup(&sched);
+    return 0;
+}
@@ -0,0 +1,318 @@
+/*
+ * Copyright 2021 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Benchmark of avs_io_ring: many concurrent TCP ping-pong connections over the
+ * loopback interface, driven by:
+ * - a readiness-based loop using poll() and non-blocking send()/recv(), as
+ *   done by avs_net sockets,
+ * - avs_io_ring using io_uring (if available),
+ * - avs_io_ring in the poll() fallback mode.
+ *
+ * A forked child process echoes everything it receives. Each connection
+ * exchanges ROUND_TRIPS 64-byte messages; the total number of round trips per
+ * second is reported.
+ *
+ * Example build, using an avs_commons build directory:
+ *
+ *   cc -O2 -std=gnu99 -I<build>/include_public -Iinclude_public \
+ *       tools/io_ring_bench.c -L<build>/output/lib \
+ *       -lavs_net_nosec -lavs_stream -lavs_buffer -lavs_log \
+ *       -lavs_compat_threading_pthread -lavs_list -lavs_utils -lpthread -lm \
+ *       -o io_ring_bench
+ *
+ * Usage: io_ring_bench [CONNECTIONS [ROUND_TRIPS]]
+ */
+
+#define _GNU_SOURCE
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <avsystem/commons/avs_io_ring.h>
+#include <avsystem/commons/avs_time.h>
+
+#define MESSAGE_SIZE 64
+
+typedef struct {
+    avs_io_ring_t *ring;
+    int fd;
+    unsigned remaining;
+    size_t received;
+    bool failed;
+    char buf[MESSAGE_SIZE];
+} connection_t;
+
+static void run_echo_server(int listening_fd, unsigned connections) {
+    struct pollfd *fds =
+            (struct pollfd *) calloc(connections, sizeof(struct pollfd));
+    for (unsigned i = 0; i < connections; ++i) {
+        fds[i].fd = accept(listening_fd, NULL, NULL);
+        fds[i].events = POLLIN;
+    }
+    close(listening_fd);
+    unsigned open_connections = connections;
+    while (open_connections && poll(fds, connections, -1) > 0) {
+        for (unsigned i = 0; i < connections; ++i) {
+            if (fds[i].fd < 0 || !fds[i].revents) {
+                continue;
+            }
+            char buf[MESSAGE_SIZE * 4];
+            ssize_t result = recv(fds[i].fd, buf, sizeof(buf), 0);
+            if (result <= 0 || send(fds[i].fd, buf, (size_t) result, 0) < 0) {
+                close(fds[i].fd);
+                fds[i].fd = -1;
+                --open_connections;
+            }
+        }
+    }
+    free(fds);
+}
+
+static int connect_all(connection_t *conns,
+                       unsigned connections,
+                       const struct sockaddr_in *addr) {
+    for (unsigned i = 0; i < connections; ++i) {
+        int one = 1;
+        conns[i].fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (conns[i].fd < 0
+                || connect(conns[i].fd, (const struct sockaddr *) addr,
+                           sizeof(*addr))
+                || setsockopt(conns[i].fd, IPPROTO_TCP, TCP_NODELAY, &one,
+                              sizeof(one))) {
+            perror("connect");
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int run_poll_loop(connection_t *conns, unsigned connections) {
+    struct pollfd *fds =
+            (struct pollfd *) calloc(connections, sizeof(struct pollfd));
+    unsigned active = 0;
+    for (unsigned i = 0; i < connections; ++i) {
+        fds[i].fd = conns[i].fd;
+        fds[i].events = POLLIN;
+        if (conns[i].remaining) {
+            send(conns[i].fd, conns[i].buf, MESSAGE_SIZE, MSG_NOSIGNAL);
+            ++active;
+        }
+    }
+    int result = 0;
+    while (active) {
+        if (poll(fds, connections, -1) < 0) {
+            result = -1;
+            break;
+        }
+        for (unsigned i = 0; i < connections; ++i) {
+            connection_t *conn = &conns[i];
+            if (!fds[i].revents) {
+                continue;
+            }
+            ssize_t received =
+                    recv(conn->fd, conn->buf + conn->received,
+                         MESSAGE_SIZE - conn->received, MSG_DONTWAIT);
+            if (received <= 0) {
+                if (received < 0 && errno == EAGAIN) {
+                    continue;
+                }
+                result = -1;
+                active = 0;
+                break;
+            }
+            conn->received += (size_t) received;
+            if (conn->received < MESSAGE_SIZE) {
+                continue;
+            }
+            conn->received = 0;
+            if (--conn->remaining) {
+                send(conn->fd, conn->buf, MESSAGE_SIZE, MSG_NOSIGNAL);
+            } else {
+                fds[i].fd = -1;
+                --active;
+            }
+        }
+    }
+    free(fds);
+    return result;
+}
+
+static void on_recv(void *conn_, avs_error_t err, size_t result);
+
+static void on_send(void *conn_, avs_error_t err, size_t result) {
+    connection_t *conn = (connection_t *) conn_;
+    (void) result;
+    if (avs_is_err(err)) {
+        conn->failed = true;
+    }
+}
+
+static void start_round_trip(connection_t *conn) {
+    conn->received = 0;
+    if (avs_is_err(avs_io_ring_send(conn->ring, conn->fd, conn->buf,
+                                    MESSAGE_SIZE, on_send, conn))
+            || avs_is_err(avs_io_ring_recv(conn->ring, conn->fd, conn->buf,
+                                           MESSAGE_SIZE, on_recv, conn))) {
+        conn->failed = true;
+    }
+}
+
+static void on_recv(void *conn_, avs_error_t err, size_t result) {
+    connection_t *conn = (connection_t *) conn_;
+    if (avs_is_err(err) || !result) {
+        conn->failed = true;
+        return;
+    }
+    conn->received += result;
+    if (conn->received < MESSAGE_SIZE) {
+        if (avs_is_err(avs_io_ring_recv(conn->ring, conn->fd,
+                                        conn->buf + conn->received,
+                                        MESSAGE_SIZE - conn->received, on_recv,
+                                        conn))) {
+            conn->failed = true;
+        }
+    } else if (--conn->remaining) {
+        start_round_trip(conn);
+    }
+}
+
+static int run_io_ring(connection_t *conns,
+                       unsigned connections,
+                       bool disable_io_uring) {
+    avs_io_ring_t *ring = NULL;
+    avs_io_ring_config_t config = {
+        .queue_size = 3 * (size_t) connections,
+        .disable_io_uring = disable_io_uring
+    };
+    if (avs_is_err(avs_io_ring_create(&ring, &config))) {
+        return -1;
+    }
+    if (!disable_io_uring && !avs_io_ring_is_native(ring)) {
+        fprintf(stderr, "io_uring not available\n");
+        avs_io_ring_cleanup(&ring);
+        return -1;
+    }
+    for (unsigned i = 0; i < connections; ++i) {
+        conns[i].ring = ring;
+        if (conns[i].remaining) {
+            start_round_trip(&conns[i]);
+        }
+    }
+    int result = 0;
+    while (avs_io_ring_pending(ring)) {
+        if (avs_is_err(avs_io_ring_wait(ring, AVS_TIME_MONOTONIC_INVALID))) {
+            result = -1;
+            break;
+        }
+    }
+    for (unsigned i = 0; i < connections; ++i) {
+        if (conns[i].failed || conns[i].remaining) {
+            result = -1;
+        }
+    }
+    avs_io_ring_cleanup(&ring);
+    return result;
+}
+
+typedef enum { MODE_POLL_LOOP, MODE_IO_URING, MODE_FALLBACK } bench_mode_t;
+
+static const char *const MODE_NAMES[] = { "poll loop", "io_ring native",
+                                          "io_ring fallback" };
+
+static int run_mode(bench_mode_t mode, unsigned connections, unsigned round_trips) {
+    int listening_fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    socklen_t addr_size = sizeof(addr);
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (listening_fd < 0
+            || bind(listening_fd, (struct sockaddr *) &addr, sizeof(addr))
+            || listen(listening_fd, (int) connections)
+            || getsockname(listening_fd, (struct sockaddr *) &addr,
+                           &addr_size)) {
+        perror("listen");
+        return -1;
+    }
+
+    fflush(stdout);
+    pid_t child = fork();
+    if (child < 0) {
+        perror("fork");
+        return -1;
+    } else if (!child) {
+        run_echo_server(listening_fd, connections);
+        _exit(0);
+    }
+    close(listening_fd);
+
+    connection_t *conns =
+            (connection_t *) calloc(connections, sizeof(connection_t));
+    int result = connect_all(conns, connections, &addr);
+    for (unsigned i = 0; i < connections; ++i) {
+        conns[i].remaining = round_trips;
+    }
+    avs_time_monotonic_t start = avs_time_monotonic_now();
+    if (!result) {
+        result = (mode == MODE_POLL_LOOP
+                          ? run_poll_loop(conns, connections)
+                          : run_io_ring(conns, connections,
+                                        mode == MODE_FALLBACK));
+    }
+    double seconds = avs_time_duration_to_fscalar(
+            avs_time_monotonic_diff(avs_time_monotonic_now(), start),
+            AVS_TIME_S);
+    for (unsigned i = 0; i < connections; ++i) {
+        if (conns[i].fd >= 0) {
+            close(conns[i].fd);
+        }
+    }
+    free(conns);
+    waitpid(child, NULL, 0);
+
+    if (result) {
+        fprintf(stderr, "%s: failed\n", MODE_NAMES[mode]);
+        return -1;
+    }
+    printf("%-18s %12.0f round trips/s\n", MODE_NAMES[mode],
+           (double) connections * round_trips / seconds);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    unsigned connections = argc > 1 ? (unsigned) atoi(argv[1]) : 64;
+    unsigned round_trips = argc > 2 ? (unsigned) atoi(argv[2]) : 10000;
+    if (!connections || !round_trips) {
+        fprintf(stderr, "Usage: %s [CONNECTIONS [ROUND_TRIPS]]\n", argv[0]);
+        return 1;
+    }
+    printf("%u connections, %u round trips each\n", connections, round_trips);
+    int result = 0;
+    for (int mode = MODE_POLL_LOOP; mode <= MODE_FALLBACK; ++mode) {
+        result |= run_mode((bench_mode_t) mode, connections, round_trips);
+    }
+    return result ? 1 : 0;
+}
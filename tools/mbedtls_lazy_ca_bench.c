@@ -0,0 +1,251 @@
+/*
+ * Copyright 2021 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Benchmark of eager vs. lazy loading of trusted certificates from a
+ * directory (WITH_MBEDTLS_LAZY_CA_PATH).
+ *
+ * The mode is chosen at build time, so the benchmark needs to be built twice:
+ * against an avs_commons build directory configured with
+ * WITH_MBEDTLS_LAZY_CA_PATH=OFF, and against one configured with
+ * WITH_MBEDTLS_LAZY_CA_PATH=ON.
+ *
+ * Two phases are measured, with trusted certificates loaded from CA_DIR:
+ * - "setup": SOCKETS TLS client sockets are created and kept alive at the same
+ *   time. Reported are the average creation time and the heap memory in use
+ *   per socket. In the eager mode, the whole directory is parsed for each
+ *   socket; in the lazy mode, it is only indexed once.
+ * - "handshake": HANDSHAKES consecutive connections are made to a forked
+ *   child process running an avs_net TLS server over the loopback interface,
+ *   using SERVER_CERT and SERVER_KEY. Reported is the average time of creating
+ *   a socket and performing a handshake, which includes verification of the
+ *   server certificate, i.e. loading its issuers in the lazy mode.
+ *
+ * The certificates generated by tools/generate-certs.sh may be used; the
+ * server certificate is issued for "localhost", and CA_DIR needs to contain
+ * its issuer, e.g. a copy of /etc/ssl/certs with root.crt added.
+ *
+ * Example build, using an avs_commons build directory with the mbed TLS
+ * backend:
+ *
+ *   cc -O2 -std=gnu99 -I<build>/include_public -Iinclude_public \
+ *       tools/mbedtls_lazy_ca_bench.c -L<build>/output/lib \
+ *       -lavs_net_mbedtls -lavs_crypto_mbedtls -lavs_stream -lavs_buffer \
+ *       -lavs_log -lavs_compat_threading_pthread -lavs_list -lavs_utils \
+ *       -lmbedtls -lmbedx509 -lmbedcrypto -lpthread -lm \
+ *       -o mbedtls_lazy_ca_bench
+ *
+ * Usage: mbedtls_lazy_ca_bench CA_DIR SERVER_CERT SERVER_KEY
+ *                              [SOCKETS [HANDSHAKES]]
+ */
+
+#define _GNU_SOURCE
+#include <malloc.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <avsystem/commons/avs_crypto_pki.h>
+#include <avsystem/commons/avs_log.h>
+#include <avsystem/commons/avs_prng.h>
+#include <avsystem/commons/avs_socket.h>
+#include <avsystem/commons/avs_time.h>
+
+#ifdef AVS_COMMONS_WITH_MBEDTLS_LAZY_CA_PATH
+#    define MODE "lazy"
+#else // AVS_COMMONS_WITH_MBEDTLS_LAZY_CA_PATH
+#    define MODE "eager"
+#endif // AVS_COMMONS_WITH_MBEDTLS_LAZY_CA_PATH
+
+static avs_crypto_prng_ctx_t *g_prng;
+
+static avs_net_ssl_configuration_t client_config(const char *ca_dir) {
+    avs_net_ssl_configuration_t config;
+    memset(&config, 0, sizeof(config));
+    config.version = AVS_NET_SSL_VERSION_TLSv1_2;
+    config.security = avs_net_security_info_from_certificates(
+            (avs_net_certificate_info_t) {
+                .server_cert_validation = true,
+                .ignore_system_trust_store = true,
+                .trusted_certs =
+                        avs_crypto_certificate_chain_info_from_path(ca_dir)
+            });
+    config.backend_configuration.address_family = AVS_NET_AF_INET4;
+    config.prng_ctx = g_prng;
+    return config;
+}
+
+static size_t heap_in_use(void) {
+    return mallinfo2().uordblks;
+}
+
+static double elapsed_seconds(avs_time_monotonic_t start) {
+    return avs_time_duration_to_fscalar(
+            avs_time_monotonic_diff(avs_time_monotonic_now(), start),
+            AVS_TIME_S);
+}
+
+static int run_setup(const char *ca_dir, unsigned sockets) {
+    avs_net_socket_t **created =
+            (avs_net_socket_t **) calloc(sockets, sizeof(*created));
+    if (!created) {
+        return -1;
+    }
+    avs_net_ssl_configuration_t config = client_config(ca_dir);
+    size_t heap_before = heap_in_use();
+    avs_time_monotonic_t start = avs_time_monotonic_now();
+    int result = 0;
+    for (unsigned i = 0; i < sockets; ++i) {
+        if (avs_is_err(avs_net_ssl_socket_create(&created[i], &config))) {
+            fprintf(stderr, "could not create socket\n");
+            result = -1;
+            break;
+        }
+    }
+    if (!result) {
+        double seconds = elapsed_seconds(start);
+        size_t heap = heap_in_use() - heap_before;
+        printf("%-6s %-10s %12.1f us/socket %12.1f KiB/socket\n", MODE,
+               "setup", seconds * 1e6 / sockets,
+               (double) heap / 1024.0 / sockets);
+    }
+    for (unsigned i = 0; i < sockets; ++i) {
+        avs_net_socket_cleanup(&created[i]);
+    }
+    free(created);
+    return result;
+}
+
+static int run_server(avs_net_socket_t *listening,
+                      const char *server_cert,
+                      const char *server_key,
+                      unsigned handshakes) {
+    avs_net_ssl_configuration_t config;
+    memset(&config, 0, sizeof(config));
+    config.version = AVS_NET_SSL_VERSION_TLSv1_2;
+    config.security = avs_net_security_info_from_certificates(
+            (avs_net_certificate_info_t) {
+                .client_cert = avs_crypto_certificate_chain_info_from_file(
+                        server_cert),
+                .client_key = avs_crypto_private_key_info_from_file(server_key,
+                                                                    NULL)
+            });
+    config.prng_ctx = g_prng;
+    for (unsigned i = 0; i < handshakes; ++i) {
+        avs_net_socket_t *tcp_socket = NULL;
+        avs_net_socket_t *ssl_socket = NULL;
+        char byte;
+        size_t received;
+        // decorating an accepted socket performs the server-side handshake
+        if (avs_is_err(avs_net_tcp_socket_create(&tcp_socket, NULL))
+                || avs_is_err(avs_net_socket_accept(listening, tcp_socket))
+                || avs_is_err(avs_net_ssl_socket_create(&ssl_socket, &config))
+                || avs_is_err(avs_net_socket_decorate(ssl_socket, tcp_socket))
+                || avs_is_err(avs_net_socket_receive(ssl_socket, &received,
+                                                     &byte, 1))) {
+            return 1;
+        }
+        avs_net_socket_cleanup(&ssl_socket);
+    }
+    return 0;
+}
+
+static int run_handshakes(const char *ca_dir,
+                          const char *server_cert,
+                          const char *server_key,
+                          unsigned handshakes) {
+    avs_net_socket_t *listening = NULL;
+    char port[16] = "";
+    if (avs_is_err(avs_net_tcp_socket_create(&listening, NULL))
+            || avs_is_err(avs_net_socket_bind(listening, "127.0.0.1", "0"))
+            || avs_is_err(avs_net_socket_get_local_port(listening, port,
+                                                        sizeof(port)))) {
+        fprintf(stderr, "could not bind\n");
+        avs_net_socket_cleanup(&listening);
+        return -1;
+    }
+
+    fflush(stdout);
+    pid_t child = fork();
+    if (child < 0) {
+        perror("fork");
+        avs_net_socket_cleanup(&listening);
+        return -1;
+    } else if (child == 0) {
+        _exit(run_server(listening, server_cert, server_key, handshakes));
+    }
+    avs_net_socket_cleanup(&listening);
+
+    avs_net_ssl_configuration_t config = client_config(ca_dir);
+    int result = 0;
+    avs_time_monotonic_t start = avs_time_monotonic_now();
+    for (unsigned i = 0; !result && i < handshakes; ++i) {
+        avs_net_socket_t *socket = NULL;
+        if (avs_is_err(avs_net_ssl_socket_create(&socket, &config))
+                || avs_is_err(avs_net_socket_connect(socket, "localhost",
+                                                     port))
+                || avs_is_err(avs_net_socket_send(socket, "!", 1))) {
+            fprintf(stderr, "handshake failed\n");
+            result = -1;
+        }
+        avs_net_socket_cleanup(&socket);
+    }
+    double seconds = elapsed_seconds(start);
+    if (result) {
+        kill(child, SIGTERM);
+    }
+    int status;
+    if (waitpid(child, &status, 0) != child || !WIFEXITED(status)
+            || WEXITSTATUS(status)) {
+        fprintf(stderr, "server process failed\n");
+        result = -1;
+    }
+    if (!result) {
+        printf("%-6s %-10s %12.1f us/handshake\n", MODE, "handshake",
+               seconds * 1e6 / handshakes);
+    }
+    return result;
+}
+
+int main(int argc, char *argv[]) {
+    unsigned sockets = argc > 4 ? (unsigned) atoi(argv[4]) : 100;
+    unsigned handshakes = argc > 5 ? (unsigned) atoi(argv[5]) : 200;
+    if (argc < 4 || !sockets || !handshakes) {
+        fprintf(stderr,
+                "Usage: %s CA_DIR SERVER_CERT SERVER_KEY "
+                "[SOCKETS [HANDSHAKES]]\n",
+                argv[0]);
+        return 1;
+    }
+    avs_log_set_default_level(AVS_LOG_QUIET);
+    if (!(g_prng = avs_crypto_prng_new(NULL, NULL))) {
+        fprintf(stderr, "could not create PRNG\n");
+        return 1;
+    }
+
+    printf("trusted certificates from %s, %u sockets, %u handshakes\n",
+           argv[1], sockets, handshakes);
+    int result = 0;
+    if (run_setup(argv[1], sockets)
+            || run_handshakes(argv[1], argv[2], argv[3], handshakes)) {
+        result = 1;
+    }
+    avs_crypto_prng_free(&g_prng);
+    return result;
+}
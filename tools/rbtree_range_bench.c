@@ -0,0 +1,192 @@
+/*
+ * Copyright 2021 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Benchmark of AVS_RBTREE bulk operations against their element-by-element
+ * equivalents:
+ * - AVS_RBTREE_ERASE_RANGE vs. AVS_RBTREE_LOWER_BOUND followed by repeated
+ *   AVS_RBTREE_DELETE_ELEM,
+ * - AVS_RBTREE_MERGE vs. repeated AVS_RBTREE_DETACH of the first element of
+ *   the source tree and AVS_RBTREE_INSERT into the destination tree, both for
+ *   interleaved keys and for a source tree that sorts entirely after the
+ *   destination tree.
+ *
+ * Only the operation itself is timed; trees are rebuilt before each run.
+ *
+ * Example build, using an avs_commons build directory:
+ *
+ *   cc -O2 -std=gnu99 -I<build>/include_public -Iinclude_public \
+ *       tools/rbtree_range_bench.c -L<build>/output/lib \
+ *       -lavs_rbtree -lavs_utils -lm -o rbtree_range_bench
+ *
+ * Usage: rbtree_range_bench [TREE_SIZE [RUNS]]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <avsystem/commons/avs_rbtree.h>
+#include <avsystem/commons/avs_time.h>
+
+static int int_cmp(const void *a_, const void *b_) {
+    int a = *(const int *) a_;
+    int b = *(const int *) b_;
+    return a < b ? -1 : (a > b ? 1 : 0);
+}
+
+static double elapsed_since(avs_time_monotonic_t start) {
+    return avs_time_duration_to_fscalar(
+            avs_time_monotonic_diff(avs_time_monotonic_now(), start),
+            AVS_TIME_S);
+}
+
+/* Creates a tree of values first, first + step, ... (count values). */
+static AVS_RBTREE(int) make_tree(int first, int step, size_t count) {
+    AVS_RBTREE(int) tree = AVS_RBTREE_NEW(int, int_cmp);
+    if (!tree) {
+        abort();
+    }
+    for (size_t i = 0; i < count; ++i) {
+        AVS_RBTREE_ELEM(int) elem = AVS_RBTREE_ELEM_NEW(int);
+        if (!elem) {
+            abort();
+        }
+        *elem = first + (int) i * step;
+        if (AVS_RBTREE_INSERT(tree, elem) != elem) {
+            abort();
+        }
+    }
+    return tree;
+}
+
+static double erase_range_bulk(size_t size, int begin, int end) {
+    AVS_RBTREE(int) tree = make_tree(0, 1, size);
+    avs_time_monotonic_t start = avs_time_monotonic_now();
+    size_t erased = AVS_RBTREE_ERASE_RANGE(tree, &begin, &end);
+    double elapsed = elapsed_since(start);
+    if (erased != (size_t) (end - begin)) {
+        abort();
+    }
+    AVS_RBTREE_DELETE(&tree);
+    return elapsed;
+}
+
+static double erase_range_loop(size_t size, int begin, int end) {
+    AVS_RBTREE(int) tree = make_tree(0, 1, size);
+    avs_time_monotonic_t start = avs_time_monotonic_now();
+    AVS_RBTREE_ELEM(int) elem = AVS_RBTREE_LOWER_BOUND(tree, &begin);
+    while (elem && *elem < end) {
+        AVS_RBTREE_ELEM(int) next = AVS_RBTREE_ELEM_NEXT(elem);
+        AVS_RBTREE_DELETE_ELEM(tree, &elem);
+        elem = next;
+    }
+    double elapsed = elapsed_since(start);
+    if (AVS_RBTREE_SIZE(tree) != size - (size_t) (end - begin)) {
+        abort();
+    }
+    AVS_RBTREE_DELETE(&tree);
+    return elapsed;
+}
+
+static double merge_bulk(AVS_RBTREE(int) dst, AVS_RBTREE(int) src) {
+    size_t expected = AVS_RBTREE_SIZE(src);
+    avs_time_monotonic_t start = avs_time_monotonic_now();
+    size_t moved = AVS_RBTREE_MERGE(dst, src);
+    double elapsed = elapsed_since(start);
+    if (moved != expected) {
+        abort();
+    }
+    AVS_RBTREE_DELETE(&dst);
+    AVS_RBTREE_DELETE(&src);
+    return elapsed;
+}
+
+static double merge_loop(AVS_RBTREE(int) dst, AVS_RBTREE(int) src) {
+    size_t expected = AVS_RBTREE_SIZE(dst) + AVS_RBTREE_SIZE(src);
+    avs_time_monotonic_t start = avs_time_monotonic_now();
+    AVS_RBTREE_ELEM(int) elem;
+    while ((elem = AVS_RBTREE_FIRST(src))) {
+        AVS_RBTREE_DETACH(src, elem);
+        if (AVS_RBTREE_INSERT(dst, elem) != elem) {
+            abort();
+        }
+    }
+    double elapsed = elapsed_since(start);
+    if (AVS_RBTREE_SIZE(dst) != expected) {
+        abort();
+    }
+    AVS_RBTREE_DELETE(&dst);
+    AVS_RBTREE_DELETE(&src);
+    return elapsed;
+}
+
+static void report(const char *name, size_t count, double bulk, double loop) {
+    printf("%-28s %8zu elems: bulk %9.3f ms, loop %9.3f ms, speedup %6.1fx\n",
+           name, count, bulk * 1e3, loop * 1e3, loop / bulk);
+}
+
+int main(int argc, char *argv[]) {
+    size_t size = 1000000;
+    unsigned runs = 5;
+    if (argc > 1) {
+        size = (size_t) strtoul(argv[1], NULL, 10);
+    }
+    if (argc > 2) {
+        runs = (unsigned) strtoul(argv[2], NULL, 10);
+    }
+
+    static const size_t ERASE_DIVISORS[] = { 1000, 100, 10, 2 };
+    for (size_t i = 0;
+         i < sizeof(ERASE_DIVISORS) / sizeof(ERASE_DIVISORS[0]);
+         ++i) {
+        int count = (int) (size / ERASE_DIVISORS[i]);
+        int begin = (int) (size / 2) - count / 2;
+        double bulk = 0.0, loop = 0.0;
+        for (unsigned run = 0; run < runs; ++run) {
+            bulk += erase_range_bulk(size, begin, begin + count);
+            loop += erase_range_loop(size, begin, begin + count);
+        }
+        report("erase range", (size_t) count, bulk / runs, loop / runs);
+    }
+
+    static const size_t MERGE_DIVISORS[] = { 1000, 10, 1 };
+    for (size_t i = 0;
+         i < sizeof(MERGE_DIVISORS) / sizeof(MERGE_DIVISORS[0]);
+         ++i) {
+        size_t count = size / MERGE_DIVISORS[i];
+        int stride = (int) (size / count);
+        double bulk = 0.0, loop = 0.0;
+        for (unsigned run = 0; run < runs; ++run) {
+            // src keys fall between even dst keys, spread over the whole tree
+            bulk += merge_bulk(make_tree(0, 2, size),
+                               make_tree(1, 2 * stride, count));
+            loop += merge_loop(make_tree(0, 2, size),
+                               make_tree(1, 2 * stride, count));
+        }
+        report("merge interleaved", count, bulk / runs, loop / runs);
+
+        bulk = loop = 0.0;
+        for (unsigned run = 0; run < runs; ++run) {
+            // all src keys sort after dst keys
+            bulk += merge_bulk(make_tree(0, 1, size),
+                               make_tree((int) size, 1, count));
+            loop += merge_loop(make_tree(0, 1, size),
+                               make_tree((int) size, 1, count));
+        }
+        report("merge disjoint", count, bulk / runs, loop / runs);
+    }
+    return 0;
+}
@@ -0,0 +1,249 @@
+/*
+ * Copyright 2021 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Example and benchmark of a single-threaded event loop that waits on an
+ * avs_net UDP socket and an avs_sched scheduler at the same time.
+ *
+ * A forked child process sends datagrams to the socket at a fixed rate, while
+ * JOBS periodic jobs are executed every PERIOD_MS milliseconds. Two ways of
+ * waiting are compared:
+ * - "pollable fd": the descriptor returned by avs_sched_get_pollable_fd() is
+ *   polled together with the socket, with the timeout limited by
+ *   avs_sched_time_to_next(),
+ * - "1 ms spin": only the socket is polled, with a fixed 1 ms timeout, which is
+ *   the usual workaround without a pollable scheduler.
+ *
+ * Reported are: job lateness (average and maximum), number of loop iterations
+ * and CPU time used by the event loop.
+ *
+ * Example build, using an avs_commons build directory:
+ *
+ *   cc -O2 -std=gnu99 -I<build>/include_public -Iinclude_public \
+ *       tools/sched_event_loop_bench.c -L<build>/output/lib \
+ *       -lavs_net_nosec -lavs_sched -lavs_stream -lavs_buffer -lavs_log \
+ *       -lavs_compat_threading_pthread -lavs_list -lavs_utils -lpthread -lm \
+ *       -o sched_event_loop_bench
+ *
+ * Usage: sched_event_loop_bench [SECONDS [JOBS [PERIOD_MS]]]
+ */
+
+#define _GNU_SOURCE
+#include <inttypes.h>
+#include <limits.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <avsystem/commons/avs_sched.h>
+#include <avsystem/commons/avs_socket.h>
+#include <avsystem/commons/avs_time.h>
+#include <avsystem/commons/avs_utils.h>
+
+#define PACKETS_PER_SECOND 1000
+
+static const avs_net_socket_configuration_t SOCKET_CONFIG = {
+    .address_family = AVS_NET_AF_INET4
+};
+
+typedef struct {
+    avs_time_duration_t period;
+    avs_time_monotonic_t deadline;
+    uint64_t executed;
+    avs_time_duration_t total_lateness;
+    avs_time_duration_t max_lateness;
+} bench_stats_t;
+
+typedef struct {
+    bench_stats_t *stats;
+    avs_time_monotonic_t instant;
+} job_args_t;
+
+static void periodic_job(avs_sched_t *sched, const void *args_) {
+    const job_args_t *args = (const job_args_t *) args_;
+    bench_stats_t *stats = args->stats;
+    avs_time_duration_t lateness =
+            avs_time_monotonic_diff(avs_time_monotonic_now(), args->instant);
+    ++stats->executed;
+    stats->total_lateness = avs_time_duration_add(stats->total_lateness,
+                                                  lateness);
+    if (avs_time_duration_less(stats->max_lateness, lateness)) {
+        stats->max_lateness = lateness;
+    }
+    job_args_t next = {
+        .stats = stats,
+        .instant = avs_time_monotonic_add(args->instant, stats->period)
+    };
+    if (avs_time_monotonic_before(next.instant, stats->deadline)) {
+        AVS_SCHED_AT(sched, NULL, next.instant, periodic_job, &next,
+                     sizeof(next));
+    }
+}
+
+static void run_sender(const char *port, double seconds) {
+    avs_net_socket_t *socket = NULL;
+    if (avs_is_err(avs_net_udp_socket_create(&socket, &SOCKET_CONFIG))
+            || avs_is_err(avs_net_socket_connect(socket, "127.0.0.1", port))) {
+        _exit(1);
+    }
+    unsigned packets = (unsigned) (seconds * PACKETS_PER_SECOND);
+    for (unsigned i = 0; i < packets; ++i) {
+        avs_net_socket_send(socket, "ping", 4);
+        usleep(1000000 / PACKETS_PER_SECOND);
+    }
+    avs_net_socket_cleanup(&socket);
+    _exit(0);
+}
+
+static int poll_timeout_ms(avs_sched_t *sched) {
+    int64_t timeout_ms;
+    avs_time_duration_t remaining = avs_sched_time_to_next(sched);
+    if (avs_time_duration_to_scalar(&timeout_ms, AVS_TIME_MS, remaining)) {
+        return -1;
+    }
+    /* rounded up, so that the job is due after waking up */
+    if (avs_time_duration_less(
+                avs_time_duration_from_scalar(timeout_ms, AVS_TIME_MS),
+                remaining)) {
+        ++timeout_ms;
+    }
+    return (int) AVS_MIN(timeout_ms, INT_MAX);
+}
+
+static double cpu_seconds(void) {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (double) (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec)
+           + (double) (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+static int run_mode(bool use_pollable_fd,
+                    double seconds,
+                    unsigned jobs,
+                    unsigned period_ms) {
+    avs_net_socket_t *socket = NULL;
+    char port[16];
+    if (avs_is_err(avs_net_udp_socket_create(&socket, &SOCKET_CONFIG))
+            || avs_is_err(avs_net_socket_bind(socket, "127.0.0.1", "0"))
+            || avs_is_err(avs_net_socket_get_local_port(socket, port,
+                                                        sizeof(port)))) {
+        fprintf(stderr, "could not bind\n");
+        avs_net_socket_cleanup(&socket);
+        return -1;
+    }
+    avs_sched_t *sched = avs_sched_new("bench", NULL);
+    if (!sched) {
+        avs_net_socket_cleanup(&socket);
+        return -1;
+    }
+
+    fflush(stdout);
+    pid_t child = fork();
+    if (child < 0) {
+        perror("fork");
+        return -1;
+    } else if (!child) {
+        run_sender(port, seconds);
+    }
+
+    bench_stats_t stats;
+    memset(&stats, 0, sizeof(stats));
+    stats.period = avs_time_duration_from_scalar(period_ms, AVS_TIME_MS);
+    avs_time_monotonic_t start = avs_time_monotonic_now();
+    stats.deadline = avs_time_monotonic_add(
+            start, avs_time_duration_from_fscalar(seconds, AVS_TIME_S));
+    /* jobs are spread evenly over the period */
+    avs_time_duration_t spacing =
+            avs_time_duration_div(stats.period, (int32_t) jobs);
+    for (unsigned i = 0; i < jobs; ++i) {
+        job_args_t args = {
+            .stats = &stats,
+            .instant = avs_time_monotonic_add(
+                    start, avs_time_duration_mul(spacing, (int32_t) i))
+        };
+        AVS_SCHED_AT(sched, NULL, args.instant, periodic_job, &args,
+                     sizeof(args));
+    }
+
+    struct pollfd fds[2];
+    memset(fds, 0, sizeof(fds));
+    fds[0].fd = *(const int *) avs_net_socket_get_system(socket);
+    fds[0].events = POLLIN;
+    nfds_t nfds = 1;
+    if (use_pollable_fd) {
+        fds[1].fd = avs_sched_get_pollable_fd(sched);
+        fds[1].events = POLLIN;
+        nfds = 2;
+    }
+
+    uint64_t iterations = 0;
+    uint64_t packets = 0;
+    double cpu_start = cpu_seconds();
+    while (avs_time_monotonic_before(avs_time_monotonic_now(),
+                                     stats.deadline)) {
+        ++iterations;
+        int timeout_ms = use_pollable_fd ? poll_timeout_ms(sched) : 1;
+        if (poll(fds, nfds, timeout_ms) > 0 && (fds[0].revents & POLLIN)) {
+            char buf[64];
+            size_t received;
+            if (avs_is_ok(avs_net_socket_receive(socket, &received, buf,
+                                                 sizeof(buf)))) {
+                ++packets;
+            }
+        }
+        avs_sched_run(sched);
+    }
+    double cpu_used = cpu_seconds() - cpu_start;
+    waitpid(child, NULL, 0);
+
+    printf("%-12s %10.1f us %10.1f us %12" PRIu64 " %10" PRIu64
+           " %9.3f s\n",
+           use_pollable_fd ? "pollable fd" : "1 ms spin",
+           stats.executed
+                   ? avs_time_duration_to_fscalar(stats.total_lateness,
+                                                  AVS_TIME_US)
+                             / (double) stats.executed
+                   : 0.0,
+           avs_time_duration_to_fscalar(stats.max_lateness, AVS_TIME_US),
+           iterations, packets, cpu_used);
+
+    avs_sched_cleanup(&sched);
+    avs_net_socket_cleanup(&socket);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    double seconds = argc > 1 ? atof(argv[1]) : 5.0;
+    unsigned jobs = argc > 2 ? (unsigned) atoi(argv[2]) : 10;
+    unsigned period_ms = argc > 3 ? (unsigned) atoi(argv[3]) : 10;
+    if (seconds <= 0.0 || !jobs || !period_ms) {
+        fprintf(stderr, "Usage: %s [SECONDS [JOBS [PERIOD_MS]]]\n", argv[0]);
+        return 1;
+    }
+    printf("%u jobs every %u ms, %d packets/s, %.1f s\n", jobs, period_ms,
+           PACKETS_PER_SECOND, seconds);
+    printf("%-12s %13s %13s %12s %10s %11s\n", "mode", "avg lateness",
+           "max lateness", "iterations", "packets", "CPU time");
+    int result = 0;
+    result |= run_mode(true, seconds, jobs, period_ms);
+    result |= run_mode(false, seconds, jobs, period_ms);
+    return result ? 1 : 0;
+}
@@ -0,0 +1,177 @@
+/*
+ * Copyright 2021 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Throughput benchmark of avs_sched_group compared to a single scheduler shared
+ * by the same number of worker threads.
+ *
+ * Producer threads schedule jobs for "now" with random affinity keys; each job
+ * performs a small amount of CPU work. The time between starting the producers
+ * and completing the last job is measured.
+ *
+ * Example build, using an avs_commons build directory with
+ * WITH_SCHEDULER_GROUPS enabled:
+ *
+ *   cc -O2 -std=gnu99 -I<build>/include_public -Iinclude_public \
+ *       tools/sched_group_bench.c -L<build>/output/lib \
+ *       -lavs_sched -lavs_compat_threading_pthread -lavs_list -lavs_log \
+ *       -lavs_utils -lpthread -lm -o sched_group_bench
+ *
+ * Usage: sched_group_bench [THREADS [JOBS_PER_PRODUCER [WORK]]]
+ */
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <avsystem/commons/avs_log.h>
+#include <avsystem/commons/avs_sched.h>
+
+#define NUM_PRODUCERS 4
+
+static size_t g_threads = 4;
+static size_t g_jobs_per_producer = 250000;
+static unsigned g_work = 200;
+
+static volatile size_t g_jobs_done;
+static volatile int g_stop_workers;
+static volatile uint32_t g_sink;
+
+typedef struct {
+    avs_sched_t *shared;
+    avs_sched_group_t *group;
+    unsigned seed;
+} producer_t;
+
+static void bench_job(avs_sched_t *sched, const void *data) {
+    (void) sched;
+    uint32_t x = *(const uint32_t *) data;
+    for (unsigned i = 0; i < g_work; ++i) {
+        x = x * 1664525u + 1013904223u;
+    }
+    g_sink = x;
+    __atomic_add_fetch(&g_jobs_done, 1, __ATOMIC_RELAXED);
+}
+
+static void *producer_thread(void *producer_) {
+    producer_t *producer = (producer_t *) producer_;
+    for (size_t i = 0; i < g_jobs_per_producer; ++i) {
+        uint32_t key = (uint32_t) rand_r(&producer->seed);
+        avs_sched_t *sched =
+                producer->group
+                        ? avs_sched_group_shard_for_key(producer->group, key)
+                        : producer->shared;
+        if (AVS_SCHED_NOW(sched, NULL, bench_job, &key, sizeof(key))) {
+            abort();
+        }
+    }
+    return NULL;
+}
+
+static void *shared_worker_thread(void *sched_) {
+    avs_sched_t *sched = (avs_sched_t *) sched_;
+    while (!__atomic_load_n(&g_stop_workers, __ATOMIC_RELAXED)) {
+        avs_sched_wait_for_next(sched,
+                                avs_time_duration_from_scalar(10,
+                                                              AVS_TIME_MS));
+        avs_sched_run(sched);
+    }
+    return NULL;
+}
+
+static double run(avs_sched_t *shared, avs_sched_group_t *group) {
+    size_t total = NUM_PRODUCERS * g_jobs_per_producer;
+    g_jobs_done = 0;
+    g_stop_workers = 0;
+
+    pthread_t *workers = NULL;
+    if (shared) {
+        workers = (pthread_t *) calloc(g_threads, sizeof(pthread_t));
+        for (size_t i = 0; i < g_threads; ++i) {
+            pthread_create(&workers[i], NULL, shared_worker_thread, shared);
+        }
+    }
+
+    avs_time_monotonic_t start = avs_time_monotonic_now();
+    pthread_t producers[NUM_PRODUCERS];
+    producer_t producer_args[NUM_PRODUCERS];
+    for (size_t i = 0; i < NUM_PRODUCERS; ++i) {
+        producer_args[i] = (producer_t) {
+            .shared = shared,
+            .group = group,
+            .seed = (unsigned) i + 1
+        };
+        pthread_create(&producers[i], NULL, producer_thread, &producer_args[i]);
+    }
+    for (size_t i = 0; i < NUM_PRODUCERS; ++i) {
+        pthread_join(producers[i], NULL);
+    }
+    while (__atomic_load_n(&g_jobs_done, __ATOMIC_RELAXED) < total) {
+        sched_yield();
+    }
+    double elapsed = avs_time_duration_to_fscalar(
+            avs_time_monotonic_diff(avs_time_monotonic_now(), start),
+            AVS_TIME_S);
+
+    if (shared) {
+        __atomic_store_n(&g_stop_workers, 1, __ATOMIC_RELAXED);
+        for (size_t i = 0; i < g_threads; ++i) {
+            pthread_join(workers[i], NULL);
+        }
+        free(workers);
+    }
+    return (double) total / elapsed;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc > 1) {
+        g_threads = (size_t) strtoul(argv[1], NULL, 10);
+    }
+    if (argc > 2) {
+        g_jobs_per_producer = (size_t) strtoul(argv[2], NULL, 10);
+    }
+    if (argc > 3) {
+        g_work = (unsigned) strtoul(argv[3], NULL, 10);
+    }
+    avs_log_set_default_level(AVS_LOG_WARNING);
+
+    avs_sched_t *shared = avs_sched_new("shared", NULL);
+    printf("shared scheduler, %zu workers: %.0f jobs/s\n", g_threads,
+           run(shared, NULL));
+    avs_sched_cleanup(&shared);
+
+    avs_sched_group_t *group = avs_sched_group_new(
+            "group", NULL,
+            &(const avs_sched_group_config_t) {
+                .num_shards = g_threads
+            });
+    printf("scheduler group, %zu shards:  %.0f jobs/s\n", g_threads,
+           run(NULL, group));
+    avs_sched_group_cleanup(&group);
+
+    group = avs_sched_group_new("pinned", NULL,
+                                &(const avs_sched_group_config_t) {
+                                    .num_shards = g_threads,
+                                    .pin_threads = true
+                                });
+    if (group) {
+        printf("pinned group, %zu shards:     %.0f jobs/s\n", g_threads,
+               run(NULL, group));
+        avs_sched_group_cleanup(&group);
+    }
+    return 0;
+}
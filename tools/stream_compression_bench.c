@@ -0,0 +1,225 @@
+/*
+ * Copyright 2021 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Throughput benchmark of the compression stream decorators, over membuf and
+ * file streams.
+ *
+ * Log-like input data is compressed in 4 KiB writes and then decompressed in
+ * 4 KiB reads. Throughput is reported in terms of uncompressed data.
+ *
+ * Example build, using an avs_commons build directory:
+ *
+ *   cc -O2 -std=gnu99 -I<build>/include_public -Iinclude_public \
+ *       tools/stream_compression_bench.c -L<build>/output/lib \
+ *       -lavs_stream_compression -lavs_stream -lavs_buffer -lavs_log \
+ *       -lavs_list -lavs_compat_threading_pthread -lavs_utils -lz -lpthread \
+ *       -lm \
+ *       -o stream_compression_bench
+ *
+ * (add -lzstd if the library was built with WITH_AVS_STREAM_ZSTD)
+ *
+ * Usage: stream_compression_bench [SIZE_MB [TEMP_FILE]]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <avsystem/commons/avs_log.h>
+#include <avsystem/commons/avs_stream_compression.h>
+#include <avsystem/commons/avs_stream_file.h>
+#include <avsystem/commons/avs_stream_membuf.h>
+#include <avsystem/commons/avs_time.h>
+#include <avsystem/commons/avs_utils.h>
+
+#define CHUNK_SIZE 4096
+
+typedef struct {
+    const char *name;
+    avs_stream_compression_format_t format;
+    int level;
+} bench_case_t;
+
+static const bench_case_t CASES[] = {
+    { "zlib-1", AVS_STREAM_COMPRESSION_ZLIB, 1 },
+    { "zlib-6", AVS_STREAM_COMPRESSION_ZLIB, 6 },
+    { "zlib-9", AVS_STREAM_COMPRESSION_ZLIB, 9 },
+    { "gzip-6", AVS_STREAM_COMPRESSION_GZIP, 6 },
+    { "raw-6", AVS_STREAM_COMPRESSION_RAW_DEFLATE, 6 },
+#ifdef AVS_COMMONS_STREAM_WITH_ZSTD
+    { "zstd-1", AVS_STREAM_COMPRESSION_ZSTD, 1 },
+    { "zstd-3", AVS_STREAM_COMPRESSION_ZSTD, 3 },
+    { "zstd-19", AVS_STREAM_COMPRESSION_ZSTD, 19 },
+#endif // AVS_COMMONS_STREAM_WITH_ZSTD
+};
+
+static double elapsed_since(avs_time_monotonic_t start) {
+    return avs_time_duration_to_fscalar(
+            avs_time_monotonic_diff(avs_time_monotonic_now(), start),
+            AVS_TIME_S);
+}
+
+static void check(bool condition, const char *what) {
+    if (!condition) {
+        fprintf(stderr, "%s failed\n", what);
+        exit(EXIT_FAILURE);
+    }
+}
+
+static char *generate_input(size_t size) {
+    static const char *const LEVELS[] = { "DEBUG", "INFO", "WARNING",
+                                          "ERROR" };
+    char *data = (char *) malloc(size);
+    check(data, "malloc");
+    avs_rand_seed_t seed = 42;
+    size_t offset = 0;
+    unsigned long counter = 0;
+    while (offset < size) {
+        char line[128];
+        int length = snprintf(
+                line, sizeof(line),
+                "2021-03-%02u 12:%02u:%02u.%03u %s [module_%u] request %lu "
+                "finished, status %u\n",
+                1 + avs_rand32_r(&seed) % 28, avs_rand32_r(&seed) % 60,
+                avs_rand32_r(&seed) % 60, avs_rand32_r(&seed) % 1000,
+                LEVELS[(avs_rand32_r(&seed) >> 28) % 4],
+                (avs_rand32_r(&seed) >> 28) % 8, counter++,
+                200 + (avs_rand32_r(&seed) >> 28) % 4);
+        size_t to_copy = AVS_MIN((size_t) length, size - offset);
+        memcpy(data + offset, line, to_copy);
+        offset += to_copy;
+    }
+    return data;
+}
+
+/* Writes the data in CHUNK_SIZE pieces and finishes the message */
+static void write_all(avs_stream_t *stream, const char *data, size_t size) {
+    for (size_t offset = 0; offset < size; offset += CHUNK_SIZE) {
+        check(avs_is_ok(avs_stream_write(stream, data + offset,
+                                         AVS_MIN(CHUNK_SIZE, size - offset))),
+              "write");
+    }
+    check(avs_is_ok(avs_stream_finish_message(stream)), "finish_message");
+}
+
+/* Reads a whole message in CHUNK_SIZE pieces; returns its size */
+static size_t read_all(avs_stream_t *stream, char *out, size_t out_size) {
+    size_t offset = 0;
+    bool finished = false;
+    while (!finished) {
+        size_t bytes_read;
+        size_t chunk = AVS_MIN(CHUNK_SIZE, out_size - offset);
+        check(avs_is_ok(avs_stream_read(stream, &bytes_read, &finished,
+                                        out + offset, chunk)),
+              "read");
+        offset += bytes_read;
+        check(offset < out_size || finished, "output size");
+    }
+    return offset;
+}
+
+static void bench_membuf(const bench_case_t *bench_case,
+                         const char *data,
+                         char *scratch,
+                         size_t size) {
+    const avs_stream_compression_config_t config = {
+        .format = bench_case->format,
+        .level = bench_case->level
+    };
+    avs_stream_t *membuf = avs_stream_membuf_create();
+    check(membuf, "membuf_create");
+    avs_stream_t *stream = membuf;
+    check(!avs_stream_deflate_create(&stream, &config), "deflate_create");
+    avs_time_monotonic_t start = avs_time_monotonic_now();
+    write_all(stream, data, size);
+    double compress_time = elapsed_since(start);
+    /* the backend remains valid until the decorator is cleaned up */
+    size_t compressed_size = read_all(membuf, scratch, size + size / 2);
+    avs_stream_cleanup(&stream);
+
+    stream = avs_stream_membuf_create();
+    check(stream, "membuf_create");
+    check(avs_is_ok(avs_stream_write(stream, scratch, compressed_size)),
+          "write");
+    check(!avs_stream_inflate_create(&stream, &config), "inflate_create");
+    start = avs_time_monotonic_now();
+    check(read_all(stream, scratch, size + 1) == size, "decompressed size");
+    double decompress_time = elapsed_since(start);
+    check(!memcmp(scratch, data, size), "decompressed data");
+    avs_stream_cleanup(&stream);
+
+    printf("%-8s membuf  ratio %6.2f%%  compress %8.1f MB/s  "
+           "decompress %8.1f MB/s\n",
+           bench_case->name, 100.0 * (double) compressed_size / (double) size,
+           (double) size / 1e6 / compress_time,
+           (double) size / 1e6 / decompress_time);
+}
+
+static void bench_file(const bench_case_t *bench_case,
+                       const char *path,
+                       const char *data,
+                       char *scratch,
+                       size_t size) {
+    const avs_stream_compression_config_t config = {
+        .format = bench_case->format,
+        .level = bench_case->level
+    };
+    avs_time_monotonic_t start = avs_time_monotonic_now();
+    avs_stream_t *stream = avs_stream_file_create(path, AVS_STREAM_FILE_WRITE);
+    check(stream, "file_create");
+    check(!avs_stream_deflate_create(&stream, &config), "deflate_create");
+    write_all(stream, data, size);
+    check(avs_is_ok(avs_stream_cleanup(&stream)), "cleanup");
+    double compress_time = elapsed_since(start);
+
+    start = avs_time_monotonic_now();
+    stream = avs_stream_file_create(path, AVS_STREAM_FILE_READ);
+    check(stream, "file_create");
+    check(!avs_stream_inflate_create(&stream, &config), "inflate_create");
+    check(read_all(stream, scratch, size + 1) == size, "decompressed size");
+    avs_stream_cleanup(&stream);
+    double decompress_time = elapsed_since(start);
+    check(!memcmp(scratch, data, size), "decompressed data");
+
+    printf("%-8s file                   compress %8.1f MB/s  "
+           "decompress %8.1f MB/s\n",
+           bench_case->name, (double) size / 1e6 / compress_time,
+           (double) size / 1e6 / decompress_time);
+}
+
+int main(int argc, char *argv[]) {
+    size_t size_mb = argc > 1 ? strtoul(argv[1], NULL, 10) : 16;
+    const char *path = argc > 2 ? argv[2] : "stream_compression_bench.tmp";
+    size_t size = size_mb * 1024 * 1024;
+    check(size > 0, "size");
+    avs_log_set_default_level(AVS_LOG_WARNING);
+
+    char *data = generate_input(size);
+    char *scratch = (char *) malloc(size + size / 2);
+    check(scratch, "malloc");
+
+    printf("%zu MiB of input, %d-byte chunks\n", size_mb, CHUNK_SIZE);
+    for (size_t i = 0; i < AVS_ARRAY_SIZE(CASES); ++i) {
+        bench_membuf(&CASES[i], data, scratch, size);
+        bench_file(&CASES[i], path, data, scratch, size);
+    }
+    remove(path);
+
+    free(scratch);
+    free(data);
+    return 0;
+}
@@ -0,0 +1,259 @@
+/*
+ * Copyright 2021 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Latency and throughput benchmark of avs_net stream sockets: TCP over the
+ * loopback interface vs. Unix domain sockets (filesystem and abstract
+ * addresses).
+ *
+ * For each transport, a forked child process accepts a single connection and:
+ * - echoes ROUND_TRIPS 64-byte messages back, which measures the round-trip
+ *   latency,
+ * - then consumes SIZE_MB megabytes sent in 64 KiB chunks and acknowledges
+ *   them with a single byte, which measures the throughput.
+ *
+ * Example build, using an avs_commons build directory:
+ *
+ *   cc -O2 -std=gnu99 -I<build>/include_public -Iinclude_public \
+ *       tools/unix_socket_bench.c -L<build>/output/lib \
+ *       -lavs_net_nosec -lavs_stream -lavs_buffer -lavs_log \
+ *       -lavs_compat_threading_pthread -lavs_list -lavs_utils -lpthread -lm \
+ *       -o unix_socket_bench
+ *
+ * Usage: unix_socket_bench [SIZE_MB [ROUND_TRIPS]]
+ *
+ * Example results (release build, Linux 6.18, 1 CPU Xeon, defaults, range of
+ * 3 runs):
+ *
+ *   transport         round trip        throughput
+ *   tcp-loopback     16.1-17.9 us   3020-3307 MB/s
+ *   unix-path         9.5-10.2 us   4180-4513 MB/s
+ *   unix-abstract     9.3-10.6 us   3857-4490 MB/s
+ */
+
+#define _GNU_SOURCE
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <avsystem/commons/avs_log.h>
+#include <avsystem/commons/avs_socket.h>
+#include <avsystem/commons/avs_time.h>
+
+#define MESSAGE_SIZE 64
+#define CHUNK_SIZE (64 * 1024)
+
+typedef struct {
+    const char *name;
+    avs_net_af_t family;
+    const char *address;
+    const char *port;
+} transport_t;
+
+static avs_error_t receive_exactly(avs_net_socket_t *socket,
+                                   void *buffer,
+                                   size_t size) {
+    size_t received = 0;
+    while (received < size) {
+        size_t bytes_received;
+        avs_error_t err =
+                avs_net_socket_receive(socket, &bytes_received,
+                                       (char *) buffer + received,
+                                       size - received);
+        if (avs_is_err(err)) {
+            return err;
+        } else if (!bytes_received) {
+            return AVS_EOF;
+        }
+        received += bytes_received;
+    }
+    return AVS_OK;
+}
+
+static int run_server(avs_net_socket_t *listening,
+                      const avs_net_socket_configuration_t *config,
+                      unsigned round_trips,
+                      size_t total_size) {
+    static char buffer[CHUNK_SIZE];
+    avs_net_socket_t *socket = NULL;
+    if (avs_is_err(avs_net_tcp_socket_create(&socket, config))
+            || avs_is_err(avs_net_socket_accept(listening, socket))) {
+        return 1;
+    }
+    avs_net_socket_cleanup(&listening);
+    for (unsigned i = 0; i < round_trips; ++i) {
+        if (avs_is_err(receive_exactly(socket, buffer, MESSAGE_SIZE))
+                || avs_is_err(
+                           avs_net_socket_send(socket, buffer, MESSAGE_SIZE))) {
+            return 1;
+        }
+    }
+    size_t received = 0;
+    while (received < total_size) {
+        size_t bytes_received;
+        if (avs_is_err(avs_net_socket_receive(socket, &bytes_received, buffer,
+                                              sizeof(buffer)))
+                || !bytes_received) {
+            return 1;
+        }
+        received += bytes_received;
+    }
+    if (avs_is_err(avs_net_socket_send(socket, "!", 1))) {
+        return 1;
+    }
+    avs_net_socket_cleanup(&socket);
+    return 0;
+}
+
+static double elapsed_seconds(avs_time_monotonic_t start) {
+    return avs_time_duration_to_fscalar(
+            avs_time_monotonic_diff(avs_time_monotonic_now(), start),
+            AVS_TIME_S);
+}
+
+static int run_client(const transport_t *transport,
+                      const avs_net_socket_configuration_t *config,
+                      const char *port,
+                      unsigned round_trips,
+                      size_t total_size) {
+    static char buffer[CHUNK_SIZE];
+    avs_net_socket_t *socket = NULL;
+    if (avs_is_err(avs_net_tcp_socket_create(&socket, config))
+            || avs_is_err(avs_net_socket_connect(socket, transport->address,
+                                                 port))) {
+        fprintf(stderr, "%s: could not connect\n", transport->name);
+        avs_net_socket_cleanup(&socket);
+        return -1;
+    }
+
+    avs_time_monotonic_t start = avs_time_monotonic_now();
+    for (unsigned i = 0; i < round_trips; ++i) {
+        if (avs_is_err(avs_net_socket_send(socket, buffer, MESSAGE_SIZE))
+                || avs_is_err(receive_exactly(socket, buffer, MESSAGE_SIZE))) {
+            fprintf(stderr, "%s: round trip failed\n", transport->name);
+            avs_net_socket_cleanup(&socket);
+            return -1;
+        }
+    }
+    double latency_us = elapsed_seconds(start) * 1e6 / round_trips;
+
+    start = avs_time_monotonic_now();
+    for (size_t sent = 0; sent < total_size; sent += CHUNK_SIZE) {
+        if (avs_is_err(avs_net_socket_send(socket, buffer, CHUNK_SIZE))) {
+            fprintf(stderr, "%s: send failed\n", transport->name);
+            avs_net_socket_cleanup(&socket);
+            return -1;
+        }
+    }
+    if (avs_is_err(receive_exactly(socket, buffer, 1))) {
+        fprintf(stderr, "%s: no acknowledgement\n", transport->name);
+        avs_net_socket_cleanup(&socket);
+        return -1;
+    }
+    double seconds = elapsed_seconds(start);
+    avs_net_socket_cleanup(&socket);
+
+    printf("%-14s %10.2f us %12.1f MB/s\n", transport->name, latency_us,
+           (double) total_size / (1024.0 * 1024.0) / seconds);
+    return 0;
+}
+
+static bool is_unix_path(const transport_t *transport) {
+    return transport->family == AVS_NET_AF_UNIX && transport->address[0] != '@';
+}
+
+static int run_transport(const transport_t *transport,
+                         unsigned round_trips,
+                         size_t total_size) {
+    avs_net_socket_configuration_t config;
+    memset(&config, 0, sizeof(config));
+    config.address_family = transport->family;
+    config.reuse_addr = 1;
+
+    if (is_unix_path(transport)) {
+        unlink(transport->address);
+    }
+    avs_net_socket_t *listening = NULL;
+    char port[16] = "";
+    if (avs_is_err(avs_net_tcp_socket_create(&listening, &config))
+            || avs_is_err(avs_net_socket_bind(listening, transport->address,
+                                              transport->port))
+            || avs_is_err(avs_net_socket_get_local_port(listening, port,
+                                                        sizeof(port)))) {
+        fprintf(stderr, "%s: could not bind\n", transport->name);
+        avs_net_socket_cleanup(&listening);
+        return -1;
+    }
+
+    pid_t child = fork();
+    if (child < 0) {
+        perror("fork");
+        avs_net_socket_cleanup(&listening);
+        return -1;
+    } else if (child == 0) {
+        _exit(run_server(listening, &config, round_trips, total_size));
+    }
+    avs_net_socket_cleanup(&listening);
+
+    int result = run_client(transport, &config, port, round_trips, total_size);
+    int status;
+    if (waitpid(child, &status, 0) != child || !WIFEXITED(status)
+            || WEXITSTATUS(status)) {
+        fprintf(stderr, "%s: server process failed\n", transport->name);
+        result = -1;
+    }
+    if (is_unix_path(transport)) {
+        unlink(transport->address);
+    }
+    return result;
+}
+
+int main(int argc, char *argv[]) {
+    size_t size_mb = argc > 1 ? (size_t) atoi(argv[1]) : 512;
+    unsigned round_trips = argc > 2 ? (unsigned) atoi(argv[2]) : 20000;
+    if (!size_mb || !round_trips) {
+        fprintf(stderr, "Usage: %s [SIZE_MB [ROUND_TRIPS]]\n", argv[0]);
+        return 1;
+    }
+    avs_log_set_default_level(AVS_LOG_QUIET);
+
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/avs_unix_bench_%d.sock", (int) getpid());
+    char abstract[64];
+    snprintf(abstract, sizeof(abstract), "@avs_unix_bench_%d", (int) getpid());
+    const transport_t transports[] = {
+        { "tcp-loopback", AVS_NET_AF_INET4, "127.0.0.1", "0" },
+        { "unix-path", AVS_NET_AF_UNIX, path, NULL },
+#ifdef __linux__
+        { "unix-abstract", AVS_NET_AF_UNIX, abstract, NULL },
+#endif // __linux__
+    };
+
+    printf("%zu MB, %u round trips of %d bytes\n", size_mb, round_trips,
+           MESSAGE_SIZE);
+    printf("%-14s %13s %17s\n", "transport", "round trip", "throughput");
+    int result = 0;
+    for (size_t i = 0; i < sizeof(transports) / sizeof(*transports); ++i) {
+        if (run_transport(&transports[i], round_trips,
+                          size_mb * 1024 * 1024)) {
+            result = 1;
+        }
+    }
+    return result;
+}